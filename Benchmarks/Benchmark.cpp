@@ -0,0 +1,147 @@
+﻿#include "Benchmark.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace Benchmark {
+
+	namespace
+	{
+		const void* volatile s_sink = nullptr;
+
+		/// Reads the cases of a report written by Finish; an unreadable file gives none.
+		std::map<std::string, double> ReadReport(const std::string& path, bool& ok)
+		{
+			std::map<std::string, double> times;
+			std::ifstream file(path);
+			ok = static_cast<bool>(file);
+			std::string line;
+			while (std::getline(file, line))
+			{
+				const size_t name = line.find("\"name\": \"");
+				const size_t time = line.find("\"ns_per_op\": ");
+				if (name == std::string::npos || time == std::string::npos)
+				{
+					continue;
+				}
+				const size_t nameStart = name + 9;
+				const size_t nameEnd = line.find('"', nameStart);
+				times[line.substr(nameStart, nameEnd - nameStart)] = std::strtod(line.c_str() + time + 13, nullptr);
+			}
+			return times;
+		}
+	}
+
+	void Keep(const void* value) noexcept
+	{
+		s_sink = value;
+	}
+
+	Suite::Suite(std::string name, int argc, char** argv)
+		: m_name(std::move(name))
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const bool hasValue = i + 1 < argc;
+			if (std::strcmp(argv[i], "--filter") == 0 && hasValue)
+			{
+				m_filter = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--output") == 0 && hasValue)
+			{
+				m_output = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--baseline") == 0 && hasValue)
+			{
+				m_baseline = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--threshold") == 0 && hasValue)
+			{
+				m_threshold = std::strtod(argv[++i], nullptr);
+				m_usageError = m_usageError || !(m_threshold >= 1.0);
+			}
+			else
+			{
+				std::fprintf(stderr, "unknown or incomplete option: %s\n", argv[i]);
+				m_usageError = true;
+			}
+		}
+	}
+
+	bool Suite::Selected(const std::string& name) const
+	{
+		return !m_usageError && (m_filter.empty() || name.find(m_filter) != std::string::npos);
+	}
+
+	int Suite::Finish()
+	{
+		if (m_usageError)
+		{
+			std::fprintf(stderr, "usage: [--filter TEXT] [--output FILE] [--baseline FILE] [--threshold RATIO >= 1]\n");
+			return 2;
+		}
+
+		std::ostringstream report;
+		report << "{\n  \"suite\": \"" << m_name << "\",\n  \"results\": [\n";
+		for (size_t i = 0; i < m_results.size(); ++i)
+		{
+			char time[32];
+			std::snprintf(time, sizeof(time), "%.1f", m_results[i].nanosecondsPerOperation);
+			report << "    { \"name\": \"" << m_results[i].name << "\", \"ns_per_op\": " << time
+				<< ", \"iterations\": " << m_results[i].iterations << " }" << (i + 1 < m_results.size() ? ",\n" : "\n");
+		}
+		report << "  ]\n}\n";
+
+		if (m_output.empty())
+		{
+			std::fputs(report.str().c_str(), stdout);
+		}
+		else
+		{
+			std::ofstream file(m_output, std::ios::binary | std::ios::trunc);
+			file << report.str();
+			if (!file)
+			{
+				std::fprintf(stderr, "cannot write %s\n", m_output.c_str());
+				return 2;
+			}
+		}
+
+		if (m_baseline.empty())
+		{
+			return 0;
+		}
+		bool ok = false;
+		const std::map<std::string, double> baseline = ReadReport(m_baseline, ok);
+		if (!ok)
+		{
+			std::fprintf(stderr, "cannot read %s\n", m_baseline.c_str());
+			return 2;
+		}
+		int regressions = 0;
+		for (const Result& result : m_results)
+		{
+			const auto found = baseline.find(result.name);
+			if (found == baseline.end())
+			{
+				std::fprintf(stderr, "%-40s %12.1f ns/op  (not in the baseline)\n", result.name.c_str(), result.nanosecondsPerOperation);
+				continue;
+			}
+			const double ratio = result.nanosecondsPerOperation / found->second;
+			const bool regressed = ratio > m_threshold;
+			regressions += regressed ? 1 : 0;
+			std::fprintf(stderr, "%-40s %12.1f ns/op  baseline %12.1f  x%.2f%s\n", result.name.c_str(),
+				result.nanosecondsPerOperation, found->second, ratio, regressed ? "  REGRESSION" : "");
+		}
+		if (regressions != 0)
+		{
+			std::fprintf(stderr, "%d case(s) slower than %.2f times the baseline\n", regressions, m_threshold);
+			return 1;
+		}
+		return 0;
+	}
+
+}
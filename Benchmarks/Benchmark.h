@@ -0,0 +1,101 @@
+﻿#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Benchmark {
+
+	/// <summary>
+	/// Keeps the compiler from optimizing away a value a benchmark computes.
+	/// </summary>
+	void Keep(const void* value) noexcept;
+
+	/// <summary>
+	/// The time of one case.
+	/// </summary>
+	struct Result
+	{
+		std::string name;
+		double nanosecondsPerOperation;
+		uint64_t iterations;                // per sample
+	};
+
+	/// <summary>
+	/// Runs the cases of a benchmark executable and reports them as JSON.
+	/// </summary>
+	/// <remarks>
+	/// Options:
+	///   --filter TEXT        runs only the cases whose name contains TEXT
+	///   --output FILE        writes the JSON report to FILE instead of stdout
+	///   --baseline FILE      compares with a report written earlier
+	///   --threshold RATIO    fails a case slower than RATIO times its baseline (default 1.5)
+	/// A case runs in samples of at least 10 ms after a calibration run; its time is the fastest
+	/// sample, which is the least disturbed by the rest of the system.
+	/// </remarks>
+	class Suite
+	{
+	public:
+		Suite(std::string name, int argc, char** argv);
+
+		/// <summary>
+		/// Times body, which performs one operation per call.
+		/// </summary>
+		template <class Body>
+		void Run(const std::string& name, Body&& body)
+		{
+			if (!Selected(name))
+			{
+				return;
+			}
+			auto sample = [&body](uint64_t iterations) {
+				const auto start = std::chrono::steady_clock::now();
+				for (uint64_t i = 0; i < iterations; ++i)
+				{
+					body();
+				}
+				return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+			};
+			Record(name, sample);
+		}
+
+		/// <summary>
+		/// Writes the report and checks it against the baseline.
+		/// </summary>
+		/// <returns>The exit code: 0, 1 if a case regressed, 2 on a usage or I/O error.</returns>
+		int Finish();
+
+	private:
+		template <class Sample>
+		void Record(const std::string& name, Sample& sample)
+		{
+			uint64_t iterations = 1;
+			while (sample(iterations) < MinimumSampleNanoseconds && iterations < (uint64_t(1) << 40))
+			{
+				iterations *= 2;
+			}
+			double best = sample(iterations);
+			for (int i = 1; i < Samples; ++i)
+			{
+				const double elapsed = sample(iterations);
+				best = elapsed < best ? elapsed : best;
+			}
+			m_results.push_back({ name, best / static_cast<double>(iterations), iterations });
+		}
+
+		bool Selected(const std::string& name) const;
+
+		static constexpr double MinimumSampleNanoseconds = 10e6;
+		static constexpr int Samples = 5;
+
+		std::string m_name;
+		std::string m_filter;
+		std::string m_output;
+		std::string m_baseline;
+		double m_threshold = 1.5;
+		bool m_usageError = false;
+		std::vector<Result> m_results;
+	};
+
+}
@@ -0,0 +1,53 @@
+﻿// Times the tab layout kernel of DyadicLayout.cpp as tabs grow: replaying the "splitPane" actions
+// on exact geometry, and turning the panes into grid rows and columns (insertion sort below 32
+// panes, radix sort above).
+
+#include "DyadicLayout.h"
+#include "Benchmark.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	/// count deterministic splits, each of a pane chosen among those already created.
+	std::vector<PaneSplit> MakeSplits(size_t count)
+	{
+		std::vector<PaneSplit> splits;
+		uint32_t seed = 0x9E3779B9u;
+		for (size_t i = 0; i < count; ++i)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			const uint32_t focused = static_cast<uint32_t>((seed >> 8) % (i + 1));
+			splits.push_back({ focused, static_cast<SplitDirection>(seed >> 30) });
+		}
+		return splits;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Benchmark::Suite suite("DyadicLayout", argc, argv);
+
+	for (size_t count : { 4, 16, 64, 256, 1024, 4096 })
+	{
+		const std::vector<PaneSplit> splits = MakeSplits(count - 1);
+		std::vector<DyadicRect> panes(count);
+		std::vector<GridPlacement> placements(count);
+
+		suite.Run("Replay/" + std::to_string(count), [&] {
+			DyadicLayout::Replay(splits.data(), splits.size(), panes.data());
+			Benchmark::Keep(panes.data());
+		});
+		suite.Run("ComputeGrid/" + std::to_string(count), [&] {
+			int32_t rows = 0;
+			int32_t columns = 0;
+			DyadicLayout::ComputeGrid(panes.data(), panes.size(), placements.data(), rows, columns);
+			Benchmark::Keep(placements.data());
+		});
+	}
+
+	return suite.Finish();
+}
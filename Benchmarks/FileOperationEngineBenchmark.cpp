@@ -0,0 +1,113 @@
+﻿// Times FileOperationEngine on 500 synthetic LocalState folders: copying them with 1 and 4
+// workers against a bare copy_file loop, copying through the snapshot store, and copying then
+// deleting them through the trash (a delete needs something to delete on every run).
+
+#include "FileOperationEngine.h"
+#include "FolderScanner.h"
+#include "LayoutCorpus.h"
+#include "SnapshotStore.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr uint32_t FolderCount = 500;
+
+	const std::u16string_view LayoutFiles[] = { u"settings.json", u"state.json", u"elevated-state.json" };
+
+	/// Runs one operation to the end, draining the completions as the UI does.
+	size_t Drain(FileOperationEngine& engine)
+	{
+		size_t taken = 0;
+		FileOperationCompletion completion;
+		while (true)
+		{
+			const bool finished = engine.IsFinished();
+			while (engine.TryTake(completion))
+			{
+				taken += completion.error ? 0 : 1;
+			}
+			if (finished)
+			{
+				return taken;
+			}
+		}
+	}
+
+	size_t Copy(const SnapshotStore* store, const fs::path& trash, const std::vector<FileCopyJob>& jobs, unsigned workers)
+	{
+		FileOperationEngine engine(store, trash);
+		engine.StartCopy(jobs.data(), jobs.size(), LayoutFiles, 3, workers);
+		return Drain(engine);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Benchmark::Suite suite("FileOperationEngine", argc, argv);
+
+	std::error_code ec;
+	const fs::path work = fs::temp_directory_path() / ("wtlm-file-operations-" + std::to_string(FolderCount));
+	const fs::path root = work / "corpus";
+	const fs::path trash = work / "trash";
+	const LayoutCorpusShape shape{ 36, FolderCount, 1, 3, 2, 8, true };
+	fs::remove_all(work, ec);
+	if (!LayoutCorpus::Generate(root, shape, ec))
+	{
+		std::fprintf(stderr, "cannot write the corpus under %s: %s\n", root.string().c_str(), ec.message().c_str());
+		return 2;
+	}
+
+	std::vector<FileCopyJob> jobs;
+	std::vector<fs::path> copies;
+	for (const fs::path& folder : FolderScanner::EnumerateSubfolders(root))
+	{
+		jobs.push_back(FileCopyJob{ folder, work / "copies" / folder.filename() });
+		copies.push_back(jobs.back().target);
+	}
+
+	const std::string folderCount = std::to_string(FolderCount);
+	suite.Run("CopyFileLoop/" + folderCount, [&] {
+		std::error_code copyError;
+		for (const FileCopyJob& job : jobs)
+		{
+			fs::create_directories(job.target, copyError);
+			for (std::u16string_view name : LayoutFiles)
+			{
+				const fs::path file{ std::u16string(name) };
+				fs::copy_file(job.source / file, job.target / file, fs::copy_options::overwrite_existing, copyError);
+			}
+		}
+	});
+	for (unsigned workers : { 1u, 4u })
+	{
+		suite.Run("Copy/" + folderCount + "/" + std::to_string(workers), [&] {
+			const size_t copied = Copy(nullptr, trash, jobs, workers);
+			Benchmark::Keep(&copied);
+		});
+	}
+
+	const SnapshotStore store(work / "objects");
+	suite.Run("CopyThroughStore/" + folderCount, [&] {
+		const size_t copied = Copy(&store, trash, jobs, 1);
+		Benchmark::Keep(&copied);
+	});
+	suite.Run("CopyThenDelete/" + folderCount, [&] {
+		Copy(nullptr, trash, jobs, 1);
+		FileOperationEngine engine(nullptr, trash);
+		engine.StartDelete(copies.data(), copies.size(), 1);
+		const size_t deleted = Drain(engine);
+		Benchmark::Keep(&deleted);
+	});
+
+	const int result = suite.Finish();
+	fs::remove_all(work, ec);
+	return result;
+}
@@ -0,0 +1,96 @@
+﻿// Times FolderScanner over 10,000 synthetic LocalState folders with 1 to 8 workers. The work per
+// folder is what a native folder load does before the managed model is built: stat the three
+// layout files and extract the settings.json profiles from a mapping.
+
+#include "FolderScanner.h"
+#include "LayoutCache.h"
+#include "LayoutCorpus.h"
+#include "MappedFile.h"
+#include "SettingsProfileScanner.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr uint32_t FolderCount = 10000;
+
+	struct ScanContext
+	{
+		const std::vector<fs::path>* folders;
+	};
+
+	void* LoadFolder(void* context, size_t index)
+	{
+		const fs::path& folder = (*static_cast<ScanContext*>(context)->folders)[index];
+		CacheSourceKey keys[LayoutCacheSourceCount];
+		LayoutCache::CaptureSources(folder, keys, false);
+
+		MappedFile settings;
+		std::vector<SettingsProfileFields> profiles;
+		if (settings.Open(folder / "settings.json"))
+		{
+			SettingsProfileScanner::Extract(settings.data(), settings.size(), profiles);
+		}
+		return reinterpret_cast<void*>(profiles.size() + 1);
+	}
+
+	/// Runs one scan to the end, draining the results as the UI does.
+	size_t Scan(const std::vector<fs::path>& folders, unsigned workers)
+	{
+		ScanContext context{ &folders };
+		FolderScanner scanner;
+		scanner.Start(folders.size(), &LoadFolder, &context, workers);
+		size_t taken = 0;
+		FolderScanCompletion completion;
+		while (true)
+		{
+			const bool finished = scanner.IsFinished();
+			while (scanner.TryTake(completion))
+			{
+				++taken;
+			}
+			if (finished)
+			{
+				return taken;
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Benchmark::Suite suite("FolderScanner", argc, argv);
+
+	std::error_code ec;
+	const fs::path root = fs::temp_directory_path() / ("wtlm-folder-scanner-" + std::to_string(FolderCount));
+	const LayoutCorpusShape shape{ 30, FolderCount, 1, 2, 2, 8, false };
+	if (!LayoutCorpus::Generate(root, shape, ec))
+	{
+		std::fprintf(stderr, "cannot write the corpus under %s: %s\n", root.string().c_str(), ec.message().c_str());
+		return 2;
+	}
+
+	const std::vector<fs::path> folders = FolderScanner::EnumerateSubfolders(root);
+	suite.Run("EnumerateSubfolders/" + std::to_string(FolderCount), [&] {
+		std::vector<fs::path> listed = FolderScanner::EnumerateSubfolders(root);
+		Benchmark::Keep(listed.data());
+	});
+	for (unsigned workers : { 1u, 2u, 4u, 8u })
+	{
+		suite.Run("Scan/" + std::to_string(FolderCount) + "/" + std::to_string(workers), [&] {
+			const size_t taken = Scan(folders, workers);
+			Benchmark::Keep(&taken);
+		});
+	}
+
+	const int result = suite.Finish();
+	fs::remove_all(root, ec);
+	return result;
+}
@@ -0,0 +1,89 @@
+﻿// Times the flat C launch API against a backend that starts nothing, which leaves the cost of the
+// ABI layer itself: validating and converting the request, the handle, a wait and the close. One
+// case has no environment, the other an environment of 16 entries.
+
+#include "LaunchApi.h"
+#include "TerminalLauncher.h"
+#include "Benchmark.h"
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	struct ExitedLaunch : TerminalLaunch
+	{
+		uint32_t ProcessId() const noexcept override
+		{
+			return 4242;
+		}
+
+		LaunchWaitResult Wait(uint32_t, uint32_t& exitCode, LaunchError&) override
+		{
+			exitCode = 0;
+			return LaunchWaitResult::Exited;
+		}
+	};
+
+	struct NullBackend : LaunchBackend
+	{
+		std::unique_ptr<TerminalLaunch> Start(const TerminalLaunchRequest&, LaunchError&) override
+		{
+			return std::make_unique<ExitedLaunch>();
+		}
+	};
+
+	WTLM_String String(const std::u16string& text)
+	{
+		return { reinterpret_cast<const uint16_t*>(text.data()), static_cast<uint32_t>(text.size()), 0 };
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Benchmark::Suite suite("LaunchApi", argc, argv);
+	LaunchBackend::Install(std::make_shared<NullBackend>());
+
+	const std::u16string application = u"C:\\Program Files\\WindowsApps\\Microsoft.WindowsTerminal_1.21.3231.0_x64__8wekyb3d8bbwe\\wt.exe";
+	const std::u16string commandLine = u"wt.exe -w new --profile \"PowerShell\" --startingDirectory \"C:\\Users\\me\\src\"";
+	const std::u16string hook = u"C:\\Program Files\\WTLayoutManager\\WTLayoutManagerHook.dll";
+	std::u16string environment;
+	for (int i = 0; i < 16; ++i)
+	{
+		environment += u"WTLM_VARIABLE_" + std::u16string(1, static_cast<char16_t>(u'A' + i)) + u"=C:\\Users\\me\\AppData\\Local";
+		environment += u'\0';
+	}
+
+	WTLM_LaunchRequest request{};
+	request.size = sizeof(WTLM_LaunchRequest);
+	request.applicationPath = String(application);
+	request.commandLine = String(commandLine);
+	request.hookPath = String(hook);
+	request.priority = 2;
+
+	int failures = 0;
+	const auto launch = [&] {
+		WTLM_Launch* handle = nullptr;
+		uint32_t exitCode = 1;
+		if (WTLM_StartLaunch(&request, &handle, nullptr) != WTLM_OK
+			|| WTLM_WaitLaunch(handle, WTLM_WAIT_INFINITE, &exitCode, nullptr) != WTLM_OK)
+		{
+			++failures;
+		}
+		WTLM_CloseLaunch(handle);
+	};
+	suite.Run("StartWaitClose", launch);
+	request.environment = String(environment);
+	suite.Run("StartWaitClose/environment16", launch);
+
+	LaunchBackend::Install(nullptr);
+	if (failures != 0)
+	{
+		std::fprintf(stderr, "%d launch(es) failed\n", failures);
+		return 2;
+	}
+	return suite.Finish();
+}
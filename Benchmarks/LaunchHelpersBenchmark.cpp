@@ -0,0 +1,165 @@
+﻿// Times the launch helpers of WinApiHelpers.cpp and the global allocator of New/new.cpp, compiled
+// unchanged against the shims in Shim/. The shims stand in for the system calls, so the numbers
+// measure the code around them: copying, searching and allocating, not the kernel.
+
+#include "WinApiHelpers.h"
+#include "LauncherArguments.h"
+#include "Benchmark.h"
+#include "Shim.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	/// A deterministic environment of a developer machine: the usual variables, a long PATH, and
+	/// tool variables up to count in all.
+	std::vector<std::wstring> MakeEnvironment(size_t count)
+	{
+		std::vector<std::wstring> entries = {
+			L"ALLUSERSPROFILE=C:\\ProgramData",
+			L"APPDATA=C:\\Users\\developer\\AppData\\Roaming",
+			L"COMPUTERNAME=WORKSTATION-042",
+			L"ComSpec=C:\\WINDOWS\\system32\\cmd.exe",
+			L"HOMEDRIVE=C:",
+			L"HOMEPATH=\\Users\\developer",
+			L"LOCALAPPDATA=C:\\Users\\developer\\AppData\\Local",
+			L"NUMBER_OF_PROCESSORS=16",
+			L"OS=Windows_NT",
+			L"PATHEXT=.COM;.EXE;.BAT;.CMD;.VBS;.VBE;.JS;.JSE;.WSF;.WSH;.MSC;.PY;.PYW",
+			L"PROCESSOR_ARCHITECTURE=AMD64",
+			L"ProgramFiles=C:\\Program Files",
+			L"PSModulePath=C:\\Users\\developer\\Documents\\WindowsPowerShell\\Modules;C:\\Program Files\\WindowsPowerShell\\Modules",
+			L"SystemRoot=C:\\WINDOWS",
+			L"TEMP=C:\\Users\\developer\\AppData\\Local\\Temp",
+			L"USERNAME=developer",
+			L"USERPROFILE=C:\\Users\\developer",
+		};
+		std::wstring path = L"Path=";
+		for (int i = 0; i < 40; ++i)
+		{
+			path += L"C:\\Program Files\\Vendor" + std::to_wstring(i) + L"\\Tool\\bin;";
+		}
+		entries.push_back(path);
+
+		uint32_t seed = 0x2545F491u;
+		while (entries.size() < count)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			std::wstring entry = L"TOOL_" + std::to_wstring(entries.size()) + L"_HOME=C:\\Tools\\";
+			entry.append(10 + seed % 90, L'a' + static_cast<wchar_t>(seed % 26));
+			entries.push_back(std::move(entry));
+		}
+		entries.resize(count);
+		return entries;
+	}
+
+	/// What a launch adds to the environment of the terminal.
+	const std::vector<std::wstring> LaunchVariables = {
+		L"WT_DEFAULT_LOCALSTATE=C:\\Users\\developer\\AppData\\Local\\Packages\\Microsoft.WindowsTerminal_8wekyb3d8bbwe\\LocalState",
+		L"WT_REDIRECT_LOCALSTATE=C:\\Users\\developer\\AppData\\Local\\WTLayoutManager\\LocalState\\Work layout",
+		L"WT_HOOK_DLL_PATH=C:\\Program Files\\WTLayoutManager\\WTHook.dll",
+	};
+
+	std::wstring JoinEnvironment(const std::vector<std::wstring>& entries)
+	{
+		std::wstring joined;
+		for (const std::wstring& entry : entries)
+		{
+			joined += entry;
+			joined += L';';
+		}
+		return joined;
+	}
+
+	/// count processes, the terminal started by the launcher last.
+	std::vector<Shim::Process> MakeProcesses(uint32_t count, uint32_t launcherId)
+	{
+		const wchar_t* names[] = { L"svchost.exe", L"explorer.exe", L"msedge.exe", L"RuntimeBroker.exe", L"conhost.exe" };
+		std::vector<Shim::Process> processes;
+		for (uint32_t i = 0; i + 1 < count; ++i)
+		{
+			processes.push_back({ 100 + 4 * i, 100 + 4 * (i / 3), names[i % 5] });
+		}
+		processes.push_back({ 99996, launcherId, L"WindowsTerminal.exe" });
+		return processes;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Benchmark::Suite suite("LaunchHelpers", argc, argv);
+
+	for (size_t count : { 100, 200, 300 })
+	{
+		Shim::SetEnvironment(MakeEnvironment(count));
+		suite.Run("CreateMergedEnvironmentBlock/" + std::to_string(count), [] {
+			LPWSTR block = WinApiHelpers::CreateMergedEnvironmentBlock(LaunchVariables);
+			Benchmark::Keep(block);
+			delete[] block;
+		});
+	}
+
+	const std::wstring asciiPath = L"C:\\Users\\developer\\AppData\\Local\\WTLayoutManager\\LocalState\\Work layout\\settings.json";
+	const std::wstring mixedPath = L"C:\\Users\\d\u00e9veloppeur\\AppData\\Local\\WTLayoutManager\\LocalState\\\u4f5c\u696d\u30ec\u30a4\u30a2\u30a6\u30c8\\settings.json";
+	suite.Run("WideToUtf8/ascii", [&] {
+		std::string utf8 = WinApiHelpers::WideToUtf8(asciiPath);
+		Benchmark::Keep(utf8.data());
+	});
+	suite.Run("WideToUtf8/mixed", [&] {
+		std::string utf8 = WinApiHelpers::WideToUtf8(mixedPath);
+		Benchmark::Keep(utf8.data());
+	});
+
+	const std::wstring environment = JoinEnvironment(LaunchVariables);
+	const std::wstring commandLine = L"\"C:\\Program Files\\WindowsApps\\Microsoft.WindowsTerminal\\wt.exe\" -w new --title \"Work \\\"main\\\"\"";
+	suite.Run("QuoteArgument/path", [&] {
+		std::wstring quoted = LauncherArguments::QuoteArgument(asciiPath);
+		Benchmark::Keep(quoted.data());
+	});
+	suite.Run("QuoteArgument/command_line", [&] {
+		std::wstring quoted = LauncherArguments::QuoteArgument(commandLine);
+		Benchmark::Keep(quoted.data());
+	});
+	suite.Run("QuoteArgument/environment", [&] {
+		std::wstring quoted = LauncherArguments::QuoteArgument(environment);
+		Benchmark::Keep(quoted.data());
+	});
+	suite.Run("splitEnvBlock/3", [&] {
+		std::vector<std::wstring> entries = LauncherArguments::SplitEnvironment(environment);
+		Benchmark::Keep(entries.data());
+	});
+	const std::wstring largeEnvironment = JoinEnvironment(MakeEnvironment(32));
+	suite.Run("splitEnvBlock/32", [&] {
+		std::vector<std::wstring> entries = LauncherArguments::SplitEnvironment(largeEnvironment);
+		Benchmark::Keep(entries.data());
+	});
+
+	constexpr DWORD launcherId = 7000;
+	for (uint32_t count : { 100, 400 })
+	{
+		Shim::SetProcesses(MakeProcesses(count, launcherId));
+		suite.Run("GetWindowsTerminalHandle/" + std::to_string(count), [] {
+			HandlePtr terminal = WinApiHelpers::GetWindowsTerminalHandle(launcherId);
+			Benchmark::Keep(terminal.get());
+		});
+	}
+
+	for (size_t size : { 16, 256, 4096 })
+	{
+		suite.Run("operator_new_delete/" + std::to_string(size), [size] {
+			void* block = ::operator new(size);
+			Benchmark::Keep(block);
+			::operator delete(block);
+		});
+	}
+	suite.Run("operator_new_delete_array/1024", [] {
+		char* block = new char[1024];
+		Benchmark::Keep(block);
+		delete[] block;
+	});
+
+	return suite.Finish();
+}
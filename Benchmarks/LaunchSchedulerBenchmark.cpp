@@ -0,0 +1,84 @@
+﻿// Times the launch scheduler: the admission queue through a whole workspace restore, and the fake
+// backend replaying that restore under each launch policy on a virtual clock. The simulated times
+// to ready of every policy are printed to stderr; they depend only on the modelled machine and
+// workspace, so they are the same on every run.
+
+#include "LaunchScheduler.h"
+#include "Benchmark.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	constexpr int Terminals = 15;
+
+	struct NamedPolicy
+	{
+		const char* name;
+		uint32_t window;
+		LaunchPriority priority;
+		CorePlacement placement;
+		bool stagger;
+	};
+
+	const NamedPolicy Policies[] = {
+		{ "all-at-once", 0, LaunchPriority::Normal, CorePlacement::Any, false },
+		{ "window4", 4, LaunchPriority::Normal, CorePlacement::Any, false },
+		{ "window8", 8, LaunchPriority::Normal, CorePlacement::Any, false },
+		{ "stagger-window4", 4, LaunchPriority::Normal, CorePlacement::Any, true },
+		{ "window4-below-normal", 4, LaunchPriority::BelowNormal, CorePlacement::Any, false },
+		{ "window4-efficiency", 4, LaunchPriority::Normal, CorePlacement::Efficiency, false },
+		{ "window4-performance", 4, LaunchPriority::Normal, CorePlacement::Performance, false },
+		{ "window8-efficiency", 8, LaunchPriority::Normal, CorePlacement::Efficiency, false },
+	};
+}
+
+int main(int argc, char** argv)
+{
+	Benchmark::Suite suite("LaunchScheduler", argc, argv);
+
+	// Every terminal is queued at once and finishes in admission order, as a restore does.
+	suite.Run("Queue/" + std::to_string(Terminals), [] {
+		LaunchQueue queue(4);
+		uint64_t ids[Terminals];
+		for (int i = 0; i < Terminals; ++i)
+		{
+			ids[i] = queue.Submit(i % 3, false);
+		}
+		for (uint64_t id : ids)
+		{
+			if (queue.MayResume(id))
+			{
+				queue.Resume(id);
+			}
+			queue.Finish(id);
+		}
+		Benchmark::Keep(&queue);
+	});
+
+	WorkspaceModel model;
+	for (int i = 0; i < Terminals; ++i)
+	{
+		model.terminalWork.push_back(400.0 + (i * 37) % 200);
+	}
+	std::fprintf(stderr, "%-22s %8s %8s %8s %10s\n", "policy", "first", "all", "mean", "foreground");
+	for (const NamedPolicy& named : Policies)
+	{
+		LaunchPolicy policy;
+		policy.priority = named.priority;
+		policy.placement = named.placement;
+		policy.staggerResume = named.stagger;
+		SimulationResult result{};
+		suite.Run(std::string("Simulate/") + named.name, [&] {
+			result = LaunchSimulation::Run(model, policy, named.window);
+		});
+		std::fprintf(stderr, "%-22s %8.0f %8.0f %8.0f %10.2f\n", named.name, result.firstReadyMilliseconds,
+			result.allReadyMilliseconds, result.meanReadyMilliseconds, result.foregroundShare);
+	}
+
+	return suite.Finish();
+}
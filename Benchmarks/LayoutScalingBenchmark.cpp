@@ -0,0 +1,334 @@
+﻿// Times the layout load paths on LayoutCorpus trees while one dimension of the corpus grows at a
+// time from a small baseline: snapshots, windows per file, tabs per window, split depth and
+// profiles. For every step it times
+//   Parse     reading every settings.json (profile extraction) and state file (tab actions),
+//   Replay    the pane geometry and grid of every tab,
+//   ColdScan  a first folder load on the scanner: parse, replay and write the sidecar cache,
+//   WarmScan  every later load: open and validate the sidecar cache.
+// The size of each corpus and the peak resident memory of the process after its step are printed
+// to stderr; the peak only grows, so read it along one dimension.
+
+#include "DyadicLayout.h"
+#include "FolderScanner.h"
+#include "LayoutCache.h"
+#include "LayoutCorpus.h"
+#include "MappedFile.h"
+#include "SettingsProfileScanner.h"
+#include "Benchmark.h"
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr uint32_t CacheSchema = 1;
+
+	/// One tab: the splits that created its panes after the first one.
+	struct TabActions
+	{
+		std::vector<PaneSplit> splits;
+	};
+
+	/// What a folder load reads from the files of one folder.
+	struct FolderLayout
+	{
+		std::vector<std::u16string> profiles;  // name, icon, name, icon, ...
+		std::vector<TabActions> tabs[LayoutCacheSourceCount];
+	};
+
+	std::string_view ValueAfter(std::string_view json, size_t from, std::string_view key, size_t end)
+	{
+		const size_t at = json.find(key, from);
+		if (at == std::string_view::npos || at >= end)
+		{
+			return std::string_view();
+		}
+		const size_t start = at + key.size();
+		const size_t stop = json.find_first_of("\",}", start);
+		return json.substr(start, (stop == std::string_view::npos ? json.size() : stop) - start);
+	}
+
+	SplitDirection ToDirection(std::string_view split) noexcept
+	{
+		return split == "left" ? SplitDirection::Left
+			: split == "right" ? SplitDirection::Right
+			: split == "up" ? SplitDirection::Up
+			: split == "down" ? SplitDirection::Down
+			: SplitDirection::None;
+	}
+
+	/// Reads the tab actions of a state file: newTab starts a tab, focusPane moves the focus and
+	/// splitPane splits the focused pane, which hands the focus to the new one. This covers the
+	/// compact actions LayoutCorpus writes, not every form of state.json.
+	void ReadTabs(std::string_view json, std::vector<TabActions>& tabs)
+	{
+		constexpr std::string_view Action = "\"action\":\"";
+		uint32_t focused = 0;
+		uint32_t panes = 0;
+		for (size_t at = json.find(Action); at != std::string_view::npos;)
+		{
+			const size_t next = json.find(Action, at + Action.size());
+			const size_t end = next == std::string_view::npos ? json.size() : next;
+			const std::string_view action = ValueAfter(json, at, Action, end);
+			if (action == "newTab")
+			{
+				tabs.emplace_back();
+				focused = 0;
+				panes = 1;
+			}
+			else if (action == "focusPane" && !tabs.empty())
+			{
+				focused = static_cast<uint32_t>(std::stoul(std::string(ValueAfter(json, at, "\"id\":", end))));
+			}
+			else if (action == "splitPane" && !tabs.empty())
+			{
+				tabs.back().splits.push_back({ focused, ToDirection(ValueAfter(json, at, "\"split\":\"", end)) });
+				focused = panes++;
+			}
+			at = next;
+		}
+	}
+
+	bool ReadFolder(const fs::path& folder, FolderLayout& layout)
+	{
+		MappedFile settings;
+		std::vector<SettingsProfileFields> fields;
+		if (!settings.Open(folder / LayoutCache::SourceNames[0]) || !SettingsProfileScanner::Extract(settings.data(), settings.size(), fields))
+		{
+			return false;
+		}
+		layout.profiles.resize(fields.size() * 2);
+		for (size_t i = 0; i < fields.size(); ++i)
+		{
+			SettingsProfileScanner::Decode(fields[i].name, layout.profiles[2 * i]);
+			SettingsProfileScanner::Decode(fields[i].icon, layout.profiles[2 * i + 1]);
+		}
+		for (uint32_t source = 1; source < LayoutCacheSourceCount; ++source)
+		{
+			MappedFile state;
+			if (state.Open(folder / LayoutCache::SourceNames[source]))
+			{
+				ReadTabs(std::string_view(reinterpret_cast<const char*>(state.data()), state.size()), layout.tabs[source]);
+			}
+		}
+		return true;
+	}
+
+	/// Replays one tab; panes and placements are scratch buffers reused across tabs.
+	void ReplayTab(const TabActions& tab, std::vector<DyadicRect>& panes, std::vector<GridPlacement>& placements, int32_t& rows, int32_t& columns)
+	{
+		panes.resize(tab.splits.size() + 1);
+		placements.resize(panes.size());
+		DyadicLayout::Replay(tab.splits.data(), tab.splits.size(), panes.data());
+		DyadicLayout::ComputeGrid(panes.data(), panes.size(), placements.data(), rows, columns);
+	}
+
+	/// A first load: parses the files, replays the tabs and writes the sidecar cache.
+	void* LoadCold(void* context, size_t index)
+	{
+		const fs::path& folder = (*static_cast<const std::vector<fs::path>*>(context))[index];
+		CacheSourceKey keys[LayoutCacheSourceCount];
+		LayoutCache::CaptureSources(folder, keys, true);
+		FolderLayout layout;
+		if (!ReadFolder(folder, layout))
+		{
+			return nullptr;
+		}
+
+		LayoutCacheWriter writer;
+		writer.BeginFile(0, false);
+		for (size_t i = 0; i < layout.profiles.size(); i += 2)
+		{
+			writer.AddProfile(layout.profiles[i], layout.profiles[i + 1]);
+		}
+		std::vector<DyadicRect> panes;
+		std::vector<GridPlacement> placements;
+		for (uint32_t source = 1; source < LayoutCacheSourceCount; ++source)
+		{
+			if (!keys[source].present)
+			{
+				continue;
+			}
+			writer.BeginFile(source, true);
+			for (const TabActions& tab : layout.tabs[source])
+			{
+				int32_t rows = 0;
+				int32_t columns = 0;
+				ReplayTab(tab, panes, placements, rows, columns);
+				writer.BeginTab(std::u16string_view(), rows, columns);
+				for (size_t pane = 0; pane < panes.size(); ++pane)
+				{
+					writer.AddPane(layout.profiles.empty() ? std::u16string_view() : layout.profiles[0],
+						std::u16string_view(), std::u16string_view(), std::u16string_view(), std::u16string_view(),
+						DyadicLayout::ToDouble(panes[pane].x), DyadicLayout::ToDouble(panes[pane].y),
+						DyadicLayout::ToDouble(panes[pane].width), DyadicLayout::ToDouble(panes[pane].height),
+						placements[pane]);
+				}
+			}
+		}
+		return writer.Save(folder, CacheSchema, keys) ? context : nullptr;
+	}
+
+	/// A later load: the sidecar cache replaces parsing.
+	void* LoadWarm(void* context, size_t index)
+	{
+		const fs::path& folder = (*static_cast<const std::vector<fs::path>*>(context))[index];
+		LayoutCacheReader reader;
+		CacheSourceKey current[LayoutCacheSourceCount];
+		return reader.Open(folder, CacheSchema, current) == CacheStatus::Fresh ? context : nullptr;
+	}
+
+	/// Runs one scan to the end, draining the results as the UI does.
+	size_t Scan(std::vector<fs::path>& folders, FolderScanWork work)
+	{
+		FolderScanner scanner;
+		scanner.Start(folders.size(), work, &folders);
+		size_t loaded = 0;
+		FolderScanCompletion completion;
+		while (true)
+		{
+			const bool finished = scanner.IsFinished();
+			while (scanner.TryTake(completion))
+			{
+				loaded += completion.result != nullptr ? 1 : 0;
+			}
+			if (finished)
+			{
+				return loaded;
+			}
+		}
+	}
+
+	uint64_t PeakResidentBytes()
+	{
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters{};
+		return ::K32GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize : 0;
+#else
+		rusage usage{};
+		return ::getrusage(RUSAGE_SELF, &usage) == 0 ? static_cast<uint64_t>(usage.ru_maxrss) * 1024 : 0;
+#endif
+	}
+
+	struct Sweep
+	{
+		const char* dimension;
+		uint32_t LayoutCorpusShape::* member;
+		std::vector<uint32_t> values;
+	};
+}
+
+int main(int argc, char** argv)
+{
+	Benchmark::Suite suite("LayoutScaling", argc, argv);
+
+	const LayoutCorpusShape baseline{ 38, 20, 1, 4, 2, 20, true };
+	const Sweep sweeps[] = {
+		{ "snapshots", &LayoutCorpusShape::snapshotCount, { 10, 100, 1000 } },
+		{ "windows", &LayoutCorpusShape::windowCount, { 1, 4, 16 } },
+		{ "tabs", &LayoutCorpusShape::tabCount, { 1, 8, 64 } },
+		{ "splitDepth", &LayoutCorpusShape::splitDepth, { 0, 2, 4, 6, 8 } },
+		{ "profiles", &LayoutCorpusShape::profileCount, { 10, 100, 1000 } },
+	};
+
+	std::error_code ec;
+	const fs::path work = fs::temp_directory_path() / "wtlm-layout-scaling";
+	for (const Sweep& sweep : sweeps)
+	{
+		for (uint32_t value : sweep.values)
+		{
+			const std::string step = std::string(sweep.dimension) + "=" + std::to_string(value);
+			LayoutCorpusShape shape = baseline;
+			shape.*sweep.member = value;
+			fs::remove_all(work, ec);
+			if (!LayoutCorpus::Generate(work, shape, ec))
+			{
+				std::fprintf(stderr, "cannot write the corpus under %s: %s\n", work.string().c_str(), ec.message().c_str());
+				return 2;
+			}
+			std::vector<fs::path> folders = FolderScanner::EnumerateSubfolders(work);
+
+			std::vector<FolderLayout> layouts(folders.size());
+			suite.Run("Parse/" + step, [&] {
+				for (size_t i = 0; i < folders.size(); ++i)
+				{
+					layouts[i] = FolderLayout();
+					ReadFolder(folders[i], layouts[i]);
+				}
+			});
+
+			std::vector<DyadicRect> panes;
+			std::vector<GridPlacement> placements;
+			suite.Run("Replay/" + step, [&] {
+				for (const FolderLayout& layout : layouts)
+				{
+					for (const std::vector<TabActions>& tabs : layout.tabs)
+					{
+						for (const TabActions& tab : tabs)
+						{
+							int32_t rows = 0;
+							int32_t columns = 0;
+							ReplayTab(tab, panes, placements, rows, columns);
+							Benchmark::Keep(placements.data());
+						}
+					}
+				}
+			});
+
+			size_t loaded = 0;
+			suite.Run("ColdScan/" + step, [&] {
+				loaded = Scan(folders, &LoadCold);
+			});
+			const bool cold = loaded == folders.size();
+			suite.Run("WarmScan/" + step, [&] {
+				loaded = Scan(folders, &LoadWarm);
+			});
+			if (!cold || loaded != folders.size())
+			{
+				std::fprintf(stderr, "%s: %zu of %zu folders loaded\n", step.c_str(), loaded, folders.size());
+				return 2;
+			}
+
+			uintmax_t bytes = 0;
+			size_t files = 0;
+			for (const fs::directory_entry& entry : fs::recursive_directory_iterator(work))
+			{
+				if (entry.path().extension() == ".json")
+				{
+					bytes += entry.file_size();
+					++files;
+				}
+			}
+			size_t paneCount = 0;
+			for (const FolderLayout& layout : layouts)
+			{
+				for (const std::vector<TabActions>& tabs : layout.tabs)
+				{
+					for (const TabActions& tab : tabs)
+					{
+						paneCount += tab.splits.size() + 1;
+					}
+				}
+			}
+			std::fprintf(stderr, "%-16s %6zu files %11ju bytes %8zu panes, peak resident %ju KB\n",
+				step.c_str(), files, bytes, paneCount, static_cast<uintmax_t>(PeakResidentBytes() / 1024));
+		}
+	}
+
+	fs::remove_all(work, ec);
+	return suite.Finish();
+}
@@ -0,0 +1,77 @@
+﻿// Times NativeLog: a filtered-out Write, which is what most launch-path log calls cost, and whole
+// sessions that start the log, queue records from one or four threads and stop it, which writes
+// every record. A session without records gives the start and stop cost to subtract. The ring
+// holds every record of a session, so none is dropped; the drop count is printed to stderr.
+
+#include "NativeLog.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr int SessionRecords = 1000;
+
+	void WriteRecords(int count, int first)
+	{
+		for (int i = first; i < first + count; ++i)
+		{
+			NativeLog::Write(LogLevel::Warning, "launch.discovery_retry", 0x80070005u,
+				{ { "attempt", i }, { "pid", 4242u }, { "exe", "C:\\Program Files\\WindowsApps\\wt.exe" } });
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Benchmark::Suite suite("NativeLog", argc, argv);
+
+	std::error_code ec;
+	NativeLogOptions options;
+	options.directory = fs::temp_directory_path() / "wtlm-native-log";
+	options.baseName = "benchmark";
+	options.maxFileBytes = 4 * 1024 * 1024;
+	options.maxFiles = 2;
+	options.minimumLevel = LogLevel::Info;
+	options.capacity = 4096;
+	fs::remove_all(options.directory, ec);
+
+	{
+		NativeLogSession session(options);
+		suite.Run("Write/filtered", [] {
+			NativeLog::Write(LogLevel::Debug, "launch.discovery_retry", 0, { { "attempt", 1 } });
+		});
+	}
+
+	suite.Run("Session/empty", [&] {
+		NativeLogSession session(options);
+	});
+	suite.Run("Session/" + std::to_string(SessionRecords) + "_records", [&] {
+		NativeLogSession session(options);
+		WriteRecords(SessionRecords, 0);
+	});
+	suite.Run("Session/4x" + std::to_string(SessionRecords / 4) + "_records", [&] {
+		NativeLogSession session(options);
+		std::vector<std::thread> producers;
+		for (int p = 0; p < 4; ++p)
+		{
+			producers.emplace_back(WriteRecords, SessionRecords / 4, p * (SessionRecords / 4));
+		}
+		for (std::thread& producer : producers)
+		{
+			producer.join();
+		}
+	});
+
+	std::fprintf(stderr, "%llu record(s) dropped\n", static_cast<unsigned long long>(NativeLog::Dropped()));
+	const int result = suite.Finish();
+	fs::remove_all(options.directory, ec);
+	return result;
+}
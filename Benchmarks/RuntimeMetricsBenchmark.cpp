@@ -0,0 +1,42 @@
+﻿// Times the cost of publishing to the shared metrics page on the hot path: a counter add, a
+// histogram record, a scoped timer, and, for the reader side, copying the page.
+
+#include "RuntimeMetrics.h"
+#include "Benchmark.h"
+#include <cstdint>
+#include <cstdio>
+
+using namespace WTLayoutManager::Services;
+
+int main(int argc, char** argv)
+{
+	Benchmark::Suite suite("RuntimeMetrics", argc, argv);
+
+	// Maps the page before the first timed update.
+	RuntimeMetrics::Add(MetricCounter::HookEventsDropped, 0);
+
+	suite.Run("Add", [] {
+		RuntimeMetrics::Add(MetricCounter::HookEventsDropped);
+	});
+	uint64_t microseconds = 0;
+	suite.Run("Record", [&] {
+		RuntimeMetrics::Record(MetricHistogram::HookInit, ++microseconds & 0xFFFF);
+	});
+	suite.Run("MetricTimer", [] {
+		MetricTimer timer(MetricHistogram::HookInit);
+	});
+
+	MetricsReader reader;
+	if (!reader.Open())
+	{
+		std::fprintf(stderr, "cannot open the metrics page %s\n", RuntimeMetrics::PageName);
+		return 2;
+	}
+	MetricsSnapshot snapshot{};
+	suite.Run("Read", [&] {
+		reader.Read(snapshot);
+		Benchmark::Keep(&snapshot);
+	});
+
+	return suite.Finish();
+}
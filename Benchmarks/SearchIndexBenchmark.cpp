@@ -0,0 +1,104 @@
+﻿// Times SearchIndex over 5,000 synthetic snapshots of about 15 pieces each, drawn from a 20-word
+// vocabulary so that broad terms match most of them:
+//   Upsert/5000     indexing every snapshot into an empty index,
+//   Upsert/one      replacing the text of one snapshot in the full index,
+//   Query/selective a long term found in a handful of snapshots,
+//   Query/short     a one- to three-character term, answered from its posting list,
+//   Query/broad     two long terms that each match most snapshots.
+
+#include "SearchIndex.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	constexpr uint32_t SnapshotCount = 5000;
+
+	const char16_t* const Vocabulary[] = {
+		u"Ubuntu", u"PowerShell", u"pwsh", u"cmd", u"Developer", u"build", u"logs", u"tail", u"git", u"status",
+		u"C:\\src", u"D:\\work", u"server", u"client", u"watch", u"tests", u"release", u"debug", u"Azure", u"ssh" };
+
+	struct Snapshot
+	{
+		std::vector<std::u16string> texts;
+		std::vector<SearchText> pieces;
+	};
+
+	std::vector<Snapshot> MakeSnapshots()
+	{
+		std::mt19937 random(32);
+		std::vector<Snapshot> snapshots(SnapshotCount);
+		for (uint32_t id = 0; id < SnapshotCount; ++id)
+		{
+			Snapshot& snapshot = snapshots[id];
+			const size_t pieces = 10 + random() % 11;
+			const std::string number = std::to_string(id);
+			snapshot.texts.push_back(u"LocalState_" + std::u16string(Vocabulary[random() % 20]) + u"_" + std::u16string(number.begin(), number.end()));
+			for (size_t piece = 1; piece < pieces; ++piece)
+			{
+				std::u16string text = Vocabulary[random() % 20];
+				for (uint32_t word = random() % 3; word > 0; --word)
+				{
+					text += random() % 2 ? u" " : u"\\";
+					text += Vocabulary[random() % 20];
+				}
+				snapshot.texts.push_back(std::move(text));
+			}
+			for (size_t piece = 0; piece < snapshot.texts.size(); ++piece)
+			{
+				const SearchField field = piece == 0 ? SearchField::FolderName : static_cast<SearchField>(1 + piece % 4);
+				snapshot.pieces.push_back(SearchText{ field, snapshot.texts[piece] });
+			}
+		}
+		return snapshots;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Benchmark::Suite suite("SearchIndex", argc, argv);
+
+	const std::vector<Snapshot> snapshots = MakeSnapshots();
+	suite.Run("Upsert/" + std::to_string(SnapshotCount), [&] {
+		SearchIndex index;
+		for (uint32_t id = 0; id < SnapshotCount; ++id)
+		{
+			index.Upsert(id, snapshots[id].pieces.data(), snapshots[id].pieces.size());
+		}
+		Benchmark::Keep(&index);
+	});
+
+	SearchIndex index;
+	for (uint32_t id = 0; id < SnapshotCount; ++id)
+	{
+		index.Upsert(id, snapshots[id].pieces.data(), snapshots[id].pieces.size());
+	}
+	uint32_t next = 0;
+	suite.Run("Upsert/one", [&] {
+		const uint32_t id = next++ % SnapshotCount;
+		index.Upsert(id, snapshots[id].pieces.data(), snapshots[id].pieces.size());
+	});
+
+	std::vector<SearchHit> hits;
+	size_t counts[3] = {};
+	suite.Run("Query/selective", [&] {
+		counts[0] = index.Query(u"_4242", hits);
+	});
+	suite.Run("Query/short", [&] {
+		counts[1] = index.Query(u"Git", hits);
+	});
+	suite.Run("Query/broad", [&] {
+		counts[2] = index.Query(u"server build", hits);
+	});
+	std::fprintf(stderr, "%zu snapshots; hits: selective %zu, short %zu, broad %zu\n", index.Size(), counts[0], counts[1], counts[2]);
+	if (index.Size() != SnapshotCount || counts[0] != 1 || counts[2] < SnapshotCount / 4)
+	{
+		return 2;
+	}
+	return suite.Finish();
+}
@@ -0,0 +1,278 @@
+﻿// Times SettingsProfileScanner::Extract on generated settings.json files of growing size, against
+// a full DOM parse of the same files followed by the same lookup. Like real settings files, the
+// fixtures are dominated by schemes and actions, which the scanner skips without materializing.
+
+#include "SettingsProfileScanner.h"
+#include "Benchmark.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	/// A settings.json with the given number of profiles, color schemes and key bindings, with the
+	/// comments and trailing commas Windows Terminal tolerates.
+	std::string MakeSettings(size_t profiles, size_t schemes, size_t actions)
+	{
+		std::string json = "{\n    \"$schema\": \"https://aka.ms/terminal-profiles-schema\",\n";
+		json += "    // Generated fixture.\n    \"actions\": [\n";
+		for (size_t i = 0; i < actions; ++i)
+		{
+			json += "        { \"command\": { \"action\": \"sendInput\", \"input\": \"echo " + std::to_string(i)
+				+ "\\r\" }, \"keys\": \"ctrl+alt+" + std::to_string(i % 10) + "\" },\n";
+		}
+		json += "    ],\n    \"profiles\": {\n        \"defaults\": { \"font\": { \"face\": \"Cascadia Mono\" } },\n";
+		json += "        \"list\": [\n";
+		for (size_t i = 0; i < profiles; ++i)
+		{
+			json += "            {\n                \"guid\": \"{61c54bbd-c2c6-5271-96e7-" + std::to_string(100000000000 + i) + "}\",\n";
+			json += "                \"name\": \"Profile \\u00e9 " + std::to_string(i) + "\",\n";
+			json += "                \"commandline\": \"C:\\\\Windows\\\\System32\\\\cmd.exe /k title " + std::to_string(i) + "\",\n";
+			json += "                \"icon\": \"ms-appx:///ProfileIcons/{0caa0dad-35be-5f56-a8ff-afceeeaa6101}.png\",\n";
+			json += i % 4 == 3 ? "                \"hidden\": true,\n" : "                \"hidden\": false,\n";
+			json += "                \"colorScheme\": \"Scheme " + std::to_string(i) + "\"\n            },\n";
+		}
+		json += "        ]\n    },\n    /* Color schemes. */\n    \"schemes\": [\n";
+		const char* colors[] = { "background", "black", "blue", "brightBlack", "brightBlue", "brightCyan", "brightGreen",
+			"brightPurple", "brightRed", "brightWhite", "brightYellow", "cursorColor", "cyan", "foreground", "green",
+			"purple", "red", "selectionBackground", "white", "yellow" };
+		for (size_t i = 0; i < schemes; ++i)
+		{
+			json += "        {\n            \"name\": \"Scheme " + std::to_string(i) + "\",\n";
+			for (const char* color : colors)
+			{
+				json += "            \"" + std::string(color) + "\": \"#" + std::to_string(100000 + (i * 7919) % 900000) + "\",\n";
+			}
+			json += "        },\n";
+		}
+		json += "    ],\n    \"themes\": []\n}\n";
+		return json;
+	}
+
+	/// A minimal materializing JSON parser with the same comment and trailing comma tolerance, standing
+	/// in for a DOM deserializer: every value is built, every string decoded.
+	class Dom
+	{
+	public:
+		struct Value
+		{
+			enum class Kind { Null, Boolean, Number, String, Array, Object } kind = Kind::Null;
+			std::string scalar;
+			std::u16string text;
+			std::vector<Value> items;
+			std::vector<std::pair<std::u16string, Value>> members;
+
+			const Value* Find(const std::u16string& key) const
+			{
+				for (const auto& member : members)
+				{
+					if (member.first == key)
+					{
+						return &member.second;
+					}
+				}
+				return nullptr;
+			}
+		};
+
+		Dom(const char* begin, const char* end) : m_p(begin), m_end(end) {}
+
+		bool Parse(Value& value)
+		{
+			return ParseValue(value) && SkipTrivia() && m_p == m_end;
+		}
+
+	private:
+		bool SkipTrivia()
+		{
+			while (m_p < m_end)
+			{
+				const char c = *m_p;
+				if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+				{
+					++m_p;
+				}
+				else if (c == '/' && m_end - m_p > 1 && m_p[1] == '/')
+				{
+					while (m_p < m_end && *m_p != '\n')
+					{
+						++m_p;
+					}
+				}
+				else if (c == '/' && m_end - m_p > 1 && m_p[1] == '*')
+				{
+					m_p += 2;
+					while (m_end - m_p > 1 && !(m_p[0] == '*' && m_p[1] == '/'))
+					{
+						++m_p;
+					}
+					if (m_end - m_p < 2)
+					{
+						return false;
+					}
+					m_p += 2;
+				}
+				else
+				{
+					break;
+				}
+			}
+			return true;
+		}
+
+		bool ParseString(std::u16string& text)
+		{
+			const char* start = ++m_p;
+			while (m_p < m_end && *m_p != '"')
+			{
+				m_p += *m_p == '\\' ? 2 : 1;
+			}
+			if (m_p >= m_end)
+			{
+				return false;
+			}
+			const bool ok = SettingsProfileScanner::Decode(std::string_view(start, static_cast<size_t>(m_p - start)), text);
+			++m_p;
+			return ok;
+		}
+
+		template <class Item>
+		bool ParseList(char close, Item item)
+		{
+			++m_p;
+			while (true)
+			{
+				if (!SkipTrivia() || m_p >= m_end)
+				{
+					return false;
+				}
+				if (*m_p == close)
+				{
+					++m_p;
+					return true;
+				}
+				if (!item() || !SkipTrivia() || m_p >= m_end)
+				{
+					return false;
+				}
+				if (*m_p == ',')
+				{
+					++m_p;
+				}
+				else if (*m_p != close)
+				{
+					return false;
+				}
+			}
+		}
+
+		bool ParseValue(Value& value)
+		{
+			if (!SkipTrivia() || m_p >= m_end)
+			{
+				return false;
+			}
+			switch (*m_p)
+			{
+			case '"':
+				value.kind = Value::Kind::String;
+				return ParseString(value.text);
+			case '[':
+				value.kind = Value::Kind::Array;
+				return ParseList(']', [&] {
+					value.items.emplace_back();
+					return ParseValue(value.items.back());
+				});
+			case '{':
+				value.kind = Value::Kind::Object;
+				return ParseList('}', [&] {
+					value.members.emplace_back();
+					auto& member = value.members.back();
+					if (*m_p != '"' || !ParseString(member.first) || !SkipTrivia() || m_p >= m_end || *m_p != ':')
+					{
+						return false;
+					}
+					++m_p;
+					return ParseValue(member.second);
+				});
+			default:
+			{
+				const char* start = m_p;
+				while (m_p < m_end && *m_p != ',' && *m_p != '}' && *m_p != ']' && *m_p != ' ' && *m_p != '\n' && *m_p != '\r')
+				{
+					++m_p;
+				}
+				value.scalar.assign(start, m_p);
+				value.kind = value.scalar == "null" ? Value::Kind::Null
+					: value.scalar == "true" || value.scalar == "false" ? Value::Kind::Boolean
+					: Value::Kind::Number;
+				return m_p > start;
+			}
+			}
+		}
+
+		const char* m_p;
+		const char* m_end;
+	};
+
+	/// Parses the whole document, then reads the names of profiles.list.
+	size_t DomProfileNames(const std::string& json)
+	{
+		Dom::Value root;
+		if (!Dom(json.data(), json.data() + json.size()).Parse(root))
+		{
+			return 0;
+		}
+		const Dom::Value* profiles = root.Find(u"profiles");
+		const Dom::Value* list = profiles ? profiles->Find(u"list") : nullptr;
+		size_t names = 0;
+		for (const Dom::Value& profile : list ? list->items : std::vector<Dom::Value>())
+		{
+			const Dom::Value* name = profile.Find(u"name");
+			names += name && name->kind == Dom::Value::Kind::String ? 1 : 0;
+		}
+		return names;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Benchmark::Suite suite("SettingsProfileScanner", argc, argv);
+
+	struct Fixture
+	{
+		const char* name;
+		size_t profiles;
+		size_t schemes;
+		size_t actions;
+	};
+	for (const Fixture& fixture : { Fixture{ "typical", 12, 10, 150 }, Fixture{ "large", 50, 300, 3000 }, Fixture{ "huge", 200, 1000, 10000 } })
+	{
+		const std::string json = MakeSettings(fixture.profiles, fixture.schemes, fixture.actions);
+		if (DomProfileNames(json) != fixture.profiles)
+		{
+			return 2;
+		}
+
+		std::vector<SettingsProfileFields> profiles;
+		suite.Run(std::string("Extract/") + fixture.name, [&] {
+			SettingsProfileScanner::Extract(reinterpret_cast<const uint8_t*>(json.data()), json.size(), profiles);
+			std::u16string name;
+			for (const SettingsProfileFields& profile : profiles)
+			{
+				SettingsProfileScanner::Decode(profile.name, name);
+			}
+			Benchmark::Keep(profiles.data());
+		});
+		suite.Run(std::string("FullDom/") + fixture.name, [&] {
+			const size_t names = DomProfileNames(json);
+			Benchmark::Keep(&names);
+		});
+	}
+
+	return suite.Finish();
+}
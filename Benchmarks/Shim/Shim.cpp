@@ -0,0 +1,399 @@
+﻿#include <windows.h>
+#include <tlhelp32.h>
+#include <strsafe.h>
+#include <detours.h>
+#include "Shim.h"
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <wctype.h>
+
+// The shim's own state is kept in malloc'd memory, so the heap the benchmarks measure (New/new.cpp
+// on top of HeapAlloc) only sees the allocations of the code under test.
+
+namespace
+{
+	thread_local DWORD s_lastError = ERROR_SUCCESS;
+
+	wchar_t* s_environment = nullptr;       // double NUL terminated
+	size_t s_environmentLength = 0;         // in characters, both NULs included
+
+	PROCESSENTRY32W* s_processes = nullptr;
+	size_t s_processCount = 0;
+
+	enum class Kind { Snapshot, Process };
+
+	struct Object
+	{
+		Kind kind;
+		size_t next;                        // a snapshot's next entry
+		DWORD processId;
+	};
+
+	HANDLE NewObject(Kind kind, DWORD processId)
+	{
+		Object* object = static_cast<Object*>(std::malloc(sizeof(Object)));
+		object->kind = kind;
+		object->next = 0;
+		object->processId = processId;
+		return object;
+	}
+
+	BOOL NotImplemented()
+	{
+		SetLastError(ERROR_CALL_NOT_IMPLEMENTED);
+		return FALSE;
+	}
+
+	bool ReadEntry(HANDLE snapshot, PROCESSENTRY32W* entry)
+	{
+		Object* object = static_cast<Object*>(snapshot);
+		if (object->next >= s_processCount)
+		{
+			SetLastError(ERROR_CALL_NOT_IMPLEMENTED);
+			return false;
+		}
+		*entry = s_processes[object->next++];
+		return true;
+	}
+}
+
+namespace Shim {
+
+	void SetEnvironment(const std::vector<std::wstring>& entries)
+	{
+		size_t length = 1;
+		for (const std::wstring& entry : entries)
+		{
+			length += entry.size() + 1;
+		}
+		std::free(s_environment);
+		s_environment = static_cast<wchar_t*>(std::malloc(length * sizeof(wchar_t)));
+		s_environmentLength = length;
+		wchar_t* cursor = s_environment;
+		for (const std::wstring& entry : entries)
+		{
+			wmemcpy(cursor, entry.c_str(), entry.size() + 1);
+			cursor += entry.size() + 1;
+		}
+		*cursor = L'\0';
+	}
+
+	void SetProcesses(const std::vector<Process>& processes)
+	{
+		std::free(s_processes);
+		s_processes = static_cast<PROCESSENTRY32W*>(std::calloc(processes.size() + 1, sizeof(PROCESSENTRY32W)));
+		s_processCount = processes.size();
+		for (size_t i = 0; i < processes.size(); ++i)
+		{
+			PROCESSENTRY32W& entry = s_processes[i];
+			entry.dwSize = sizeof(entry);
+			entry.th32ProcessID = processes[i].processId;
+			entry.th32ParentProcessID = processes[i].parentProcessId;
+			entry.cntThreads = 1;
+			wcsncpy(entry.szExeFile, processes[i].exeFile.c_str(), MAX_PATH - 1);
+		}
+	}
+
+}
+
+DWORD GetLastError()
+{
+	return s_lastError;
+}
+
+void SetLastError(DWORD error)
+{
+	s_lastError = error;
+}
+
+HANDLE GetProcessHeap()
+{
+	static int heap;
+	return &heap;
+}
+
+LPVOID HeapAlloc(HANDLE, DWORD flags, size_t bytes)
+{
+	return (flags & HEAP_ZERO_MEMORY) ? std::calloc(1, bytes) : std::malloc(bytes);
+}
+
+BOOL HeapFree(HANDLE, DWORD, LPVOID memory)
+{
+	std::free(memory);
+	return TRUE;
+}
+
+BOOL HeapValidate(HANDLE, DWORD, LPCVOID)
+{
+	// The heap walk of the real HeapValidate has no counterpart in glibc; its cost is not measured.
+	return TRUE;
+}
+
+HANDLE LocalFree(HANDLE memory)
+{
+	std::free(memory);
+	return nullptr;
+}
+
+LPWCH GetEnvironmentStringsW()
+{
+	// Like the system, hand out a copy the caller frees.
+	if (s_environment == nullptr)
+	{
+		Shim::SetEnvironment({});
+	}
+	wchar_t* copy = static_cast<wchar_t*>(std::malloc(s_environmentLength * sizeof(wchar_t)));
+	wmemcpy(copy, s_environment, s_environmentLength);
+	return copy;
+}
+
+BOOL FreeEnvironmentStringsW(LPWCH block)
+{
+	std::free(block);
+	return TRUE;
+}
+
+int lstrlenW(LPCWSTR string)
+{
+	return string != nullptr ? static_cast<int>(wcslen(string)) : 0;
+}
+
+int _wcsicmp(const wchar_t* left, const wchar_t* right)
+{
+	return wcscasecmp(left, right);
+}
+
+int _wcsnicmp(const wchar_t* left, const wchar_t* right, size_t count)
+{
+	return wcsncasecmp(left, right, count);
+}
+
+HRESULT StringCchCopyW(LPWSTR destination, size_t count, LPCWSTR source)
+{
+	if (count == 0)
+	{
+		return STRSAFE_E_INSUFFICIENT_BUFFER;
+	}
+	size_t i = 0;
+	for (; i + 1 < count && source[i] != L'\0'; ++i)
+	{
+		destination[i] = source[i];
+	}
+	destination[i] = L'\0';
+	return source[i] == L'\0' ? S_OK : STRSAFE_E_INSUFFICIENT_BUFFER;
+}
+
+int WideCharToMultiByte(unsigned, DWORD, LPCWSTR wide, int wideLength, LPSTR multiByte, int multiByteLength, LPCSTR, BOOL*)
+{
+	// wchar_t holds a code point here, so there are no surrogate pairs to join.
+	int length = 0;
+	for (int i = 0; i < wideLength; ++i)
+	{
+		const uint32_t c = static_cast<uint32_t>(wide[i]);
+		char bytes[4];
+		int count;
+		if (c < 0x80)
+		{
+			bytes[0] = static_cast<char>(c);
+			count = 1;
+		}
+		else if (c < 0x800)
+		{
+			bytes[0] = static_cast<char>(0xC0 | (c >> 6));
+			bytes[1] = static_cast<char>(0x80 | (c & 0x3F));
+			count = 2;
+		}
+		else if (c < 0x10000)
+		{
+			bytes[0] = static_cast<char>(0xE0 | (c >> 12));
+			bytes[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+			bytes[2] = static_cast<char>(0x80 | (c & 0x3F));
+			count = 3;
+		}
+		else
+		{
+			bytes[0] = static_cast<char>(0xF0 | (c >> 18));
+			bytes[1] = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+			bytes[2] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+			bytes[3] = static_cast<char>(0x80 | (c & 0x3F));
+			count = 4;
+		}
+		if (multiByteLength != 0)
+		{
+			if (length + count > multiByteLength)
+			{
+				SetLastError(ERROR_INSUFFICIENT_BUFFER);
+				return 0;
+			}
+			memcpy(multiByte + length, bytes, count);
+		}
+		length += count;
+	}
+	return length;
+}
+
+DWORD FormatMessageW(DWORD, LPCVOID, DWORD, DWORD, LPWSTR, DWORD, void*)
+{
+	return NotImplemented();
+}
+
+void Sleep(DWORD milliseconds)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+BOOL CloseHandle(HANDLE handle)
+{
+	if (handle == nullptr || handle == INVALID_HANDLE_VALUE)
+	{
+		return NotImplemented();
+	}
+	std::free(handle);
+	return TRUE;
+}
+
+HANDLE CreateToolhelp32Snapshot(DWORD, DWORD)
+{
+	return NewObject(Kind::Snapshot, 0);
+}
+
+BOOL Process32FirstW(HANDLE snapshot, PROCESSENTRY32W* entry)
+{
+	static_cast<Object*>(snapshot)->next = 0;
+	return ReadEntry(snapshot, entry) ? TRUE : FALSE;
+}
+
+BOOL Process32NextW(HANDLE snapshot, PROCESSENTRY32W* entry)
+{
+	return ReadEntry(snapshot, entry) ? TRUE : FALSE;
+}
+
+HANDLE OpenProcess(DWORD, BOOL, DWORD processId)
+{
+	for (size_t i = 0; i < s_processCount; ++i)
+	{
+		if (s_processes[i].th32ProcessID == processId)
+		{
+			return NewObject(Kind::Process, processId);
+		}
+	}
+	SetLastError(ERROR_CALL_NOT_IMPLEMENTED);
+	return nullptr;
+}
+
+HANDLE GetCurrentProcess()
+{
+	return INVALID_HANDLE_VALUE;
+}
+
+DWORD GetCurrentProcessId()
+{
+	return 4;
+}
+
+DWORD GetProcessId(HANDLE process)
+{
+	return process != nullptr && process != INVALID_HANDLE_VALUE ? static_cast<Object*>(process)->processId : GetCurrentProcessId();
+}
+
+BOOL DuplicateHandle(HANDLE, HANDLE, HANDLE, HANDLE*, DWORD, BOOL, DWORD)
+{
+	return NotImplemented();
+}
+
+BOOL SetPriorityClass(HANDLE, DWORD)
+{
+	return NotImplemented();
+}
+
+BOOL GetProcessAffinityMask(HANDLE, PDWORD_PTR, PDWORD_PTR)
+{
+	return NotImplemented();
+}
+
+BOOL SetProcessAffinityMask(HANDLE, DWORD_PTR)
+{
+	return NotImplemented();
+}
+
+DWORD WaitForInputIdle(HANDLE, DWORD)
+{
+	NotImplemented();
+	return static_cast<DWORD>(-1);
+}
+
+BOOL GetSystemCpuSetInformation(PSYSTEM_CPU_SET_INFORMATION, ULONG, PULONG returnedLength, HANDLE, ULONG)
+{
+	*returnedLength = 0;
+	return NotImplemented();
+}
+
+BOOL EnumWindows(WNDENUMPROC, LPARAM)
+{
+	return TRUE;
+}
+
+DWORD GetWindowThreadProcessId(HWND, LPDWORD processId)
+{
+	*processId = 0;
+	return 0;
+}
+
+BOOL IsWindowVisible(HWND)
+{
+	return FALSE;
+}
+
+HWND GetWindow(HWND, unsigned)
+{
+	return nullptr;
+}
+
+BOOL IsIconic(HWND)
+{
+	return FALSE;
+}
+
+BOOL ShowWindow(HWND, int)
+{
+	return FALSE;
+}
+
+BOOL SetForegroundWindow(HWND)
+{
+	return NotImplemented();
+}
+
+HANDLE CreateNamedPipeW(LPCWSTR, DWORD, DWORD, DWORD, DWORD, DWORD, DWORD, LPSECURITY_ATTRIBUTES)
+{
+	NotImplemented();
+	return INVALID_HANDLE_VALUE;
+}
+
+HANDLE CreateFileW(LPCWSTR, DWORD, DWORD, LPSECURITY_ATTRIBUTES, DWORD, DWORD, HANDLE)
+{
+	NotImplemented();
+	return INVALID_HANDLE_VALUE;
+}
+
+BOOL GetNamedPipeServerProcessId(HANDLE, PULONG)
+{
+	return NotImplemented();
+}
+
+BOOL WriteFile(HANDLE, LPCVOID, DWORD, LPDWORD, LPOVERLAPPED)
+{
+	return NotImplemented();
+}
+
+BOOL ReadFile(HANDLE, LPVOID, DWORD, LPDWORD, LPOVERLAPPED)
+{
+	return NotImplemented();
+}
+
+BOOL DetourCreateProcessWithDllExW(LPCWSTR, LPWSTR, LPSECURITY_ATTRIBUTES, LPSECURITY_ATTRIBUTES, BOOL, DWORD, LPVOID, LPCWSTR,
+	LPSTARTUPINFOW, LPPROCESS_INFORMATION, LPCSTR, PDETOUR_CREATE_PROCESS_ROUTINEW)
+{
+	return NotImplemented();
+}
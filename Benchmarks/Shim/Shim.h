@@ -0,0 +1,29 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Shim {
+
+	/// <summary>
+	/// A process listed by the shimmed CreateToolhelp32Snapshot.
+	/// </summary>
+	struct Process
+	{
+		uint32_t processId;
+		uint32_t parentProcessId;
+		std::wstring exeFile;
+	};
+
+	/// <summary>
+	/// Sets the block GetEnvironmentStringsW returns, one NAME=VALUE entry per element.
+	/// </summary>
+	void SetEnvironment(const std::vector<std::wstring>& entries);
+
+	/// <summary>
+	/// Sets the processes CreateToolhelp32Snapshot lists, in order. OpenProcess succeeds for them only.
+	/// </summary>
+	void SetProcesses(const std::vector<Process>& processes);
+
+}
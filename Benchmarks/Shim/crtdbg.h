@@ -0,0 +1,26 @@
+﻿#pragma once
+
+// A stand-in for the MSVC runtime's <crtdbg.h> and the vcruntime macros that New/new.h uses; see windows.h.
+
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#define _VCRT_EXPORT_STD
+#define _VCRT_ALLOCATOR
+#define _NODISCARD
+#define __CRTDECL
+#define _CRT_PACKING 8
+
+#define _FREE_BLOCK 0
+#define _NORMAL_BLOCK 1
+#define _CrtDbgBreak() std::abort()
+#define _ASSERTE(expression) ((void)0)
+
+// new.h builds its exceptions with std::exception(const char*, int), which only the MSVC runtime
+// has; the message is dropped here. The standard headers the shimmed sources use are included
+// above, so the macro cannot reach their declarations.
+#define exception(...) exception()
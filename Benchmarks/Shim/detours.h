@@ -0,0 +1,12 @@
+﻿#pragma once
+
+// A stand-in for Detours' <detours.h>; see windows.h.
+
+#include <windows.h>
+
+typedef BOOL (WINAPI* PDETOUR_CREATE_PROCESS_ROUTINEW)(LPCWSTR, LPWSTR, LPSECURITY_ATTRIBUTES, LPSECURITY_ATTRIBUTES,
+	BOOL, DWORD, LPVOID, LPCWSTR, LPSTARTUPINFOW, LPPROCESS_INFORMATION);
+
+BOOL DetourCreateProcessWithDllExW(LPCWSTR applicationName, LPWSTR commandLine, LPSECURITY_ATTRIBUTES processAttributes,
+	LPSECURITY_ATTRIBUTES threadAttributes, BOOL inheritHandles, DWORD creationFlags, LPVOID environment, LPCWSTR currentDirectory,
+	LPSTARTUPINFOW startupInfo, LPPROCESS_INFORMATION processInformation, LPCSTR dllName, PDETOUR_CREATE_PROCESS_ROUTINEW createProcess);
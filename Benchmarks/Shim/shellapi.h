@@ -0,0 +1,26 @@
+﻿#pragma once
+
+// A stand-in for <shellapi.h>; see windows.h.
+
+#include <windows.h>
+
+#define SEE_MASK_NOCLOSEPROCESS 0x00000040
+
+typedef struct _SHELLEXECUTEINFOW
+{
+	DWORD cbSize;
+	ULONG fMask;
+	HWND hwnd;
+	LPCWSTR lpVerb;
+	LPCWSTR lpFile;
+	LPCWSTR lpParameters;
+	LPCWSTR lpDirectory;
+	int nShow;
+	HINSTANCE hInstApp;
+	void* lpIDList;
+	LPCWSTR lpClass;
+	HKEY hkeyClass;
+	DWORD dwHotKey;
+	HANDLE hIcon;
+	HANDLE hProcess;
+} SHELLEXECUTEINFOW;
@@ -0,0 +1,11 @@
+﻿#pragma once
+
+// A stand-in for <strsafe.h>; see windows.h.
+
+#include <windows.h>
+
+#define S_OK 0
+#define STRSAFE_E_INSUFFICIENT_BUFFER (static_cast<HRESULT>(0x8007007A))
+
+HRESULT StringCchCopyW(LPWSTR destination, size_t count, LPCWSTR source);
+#define StringCchCopy StringCchCopyW
@@ -0,0 +1,30 @@
+﻿#pragma once
+
+// A stand-in for <tlhelp32.h>; see windows.h. The snapshot lists the processes set with
+// Shim::SetProcesses.
+
+#include <windows.h>
+
+#define TH32CS_SNAPPROCESS 0x00000002
+
+typedef struct tagPROCESSENTRY32W
+{
+	DWORD dwSize;
+	DWORD cntUsage;
+	DWORD th32ProcessID;
+	ULONG_PTR th32DefaultHeapID;
+	DWORD th32ModuleID;
+	DWORD cntThreads;
+	DWORD th32ParentProcessID;
+	LONG pcPriClassBase;
+	DWORD dwFlags;
+	WCHAR szExeFile[MAX_PATH];
+} PROCESSENTRY32W;
+
+typedef PROCESSENTRY32W PROCESSENTRY32;
+
+HANDLE CreateToolhelp32Snapshot(DWORD flags, DWORD processId);
+BOOL Process32FirstW(HANDLE snapshot, PROCESSENTRY32W* entry);
+BOOL Process32NextW(HANDLE snapshot, PROCESSENTRY32W* entry);
+#define Process32First Process32FirstW
+#define Process32Next Process32NextW
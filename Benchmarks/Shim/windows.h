@@ -0,0 +1,207 @@
+﻿#pragma once
+
+// A stand-in for <windows.h> that lets WinApiHelpers.cpp and New/new.cpp compile unchanged on Linux,
+// so the benchmarks measure the real code. Only what those two files use is declared. The calls the
+// benchmarks exercise (the process heap, the environment block, the process snapshot, UTF-8
+// conversion) are backed by Shim.cpp; every other call fails with ERROR_CALL_NOT_IMPLEMENTED.
+// _WIN32 stays undefined, so the portable headers keep their POSIX branches.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+
+typedef int BOOL;
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef uint32_t ULONG;
+typedef int32_t LONG;
+typedef uint64_t ULONGLONG;
+typedef uintptr_t ULONG_PTR;
+typedef uintptr_t DWORD_PTR;
+typedef intptr_t LONG_PTR;
+typedef uintptr_t WPARAM;
+typedef intptr_t LPARAM;
+typedef LONG HRESULT;
+typedef void* HANDLE;
+typedef void* LPVOID;
+typedef const void* LPCVOID;
+typedef char CHAR;
+typedef wchar_t WCHAR;
+typedef wchar_t TCHAR;
+typedef char* LPSTR;
+typedef const char* LPCSTR;
+typedef WCHAR* LPWSTR;
+typedef WCHAR* LPWCH;
+typedef WCHAR* LPTSTR;
+typedef const WCHAR* LPCWSTR;
+typedef const WCHAR* LPCTSTR;
+typedef DWORD* LPDWORD;
+typedef ULONG* PULONG;
+typedef DWORD_PTR* PDWORD_PTR;
+typedef struct HWND__* HWND;
+typedef struct HINSTANCE__* HINSTANCE;
+typedef struct HKEY__* HKEY;
+
+#define TRUE 1
+#define FALSE 0
+#define WINAPI
+#define CALLBACK
+#define MAX_PATH 260
+#define INVALID_HANDLE_VALUE (reinterpret_cast<HANDLE>(static_cast<intptr_t>(-1)))
+#define FAILED(hr) (static_cast<HRESULT>(hr) < 0)
+#define ZeroMemory(destination, length) memset((destination), 0, (length))
+
+// SAL annotations
+#define _In_
+#define _In_opt_
+#define _Inout_opt_
+#define _Out_
+#define _Ret_notnull_
+#define _Post_writable_byte_size_(size)
+
+// Structured exception handling; a C++ exception stands in for a structured one.
+#define __try try
+#define __except(filter) catch (...)
+#define EXCEPTION_EXECUTE_HANDLER 1
+
+#define ERROR_SUCCESS 0
+#define ERROR_INVALID_DATA 13
+#define ERROR_INSUFFICIENT_BUFFER 122
+#define ERROR_CALL_NOT_IMPLEMENTED 120
+
+DWORD GetLastError();
+void SetLastError(DWORD error);
+
+// Process heap
+#define HEAP_GENERATE_EXCEPTIONS 0x00000004
+#define HEAP_ZERO_MEMORY 0x00000008
+
+HANDLE GetProcessHeap();
+LPVOID HeapAlloc(HANDLE heap, DWORD flags, size_t bytes);
+BOOL HeapFree(HANDLE heap, DWORD flags, LPVOID memory);
+BOOL HeapValidate(HANDLE heap, DWORD flags, LPCVOID memory);
+HANDLE LocalFree(HANDLE memory);
+
+// Environment and strings
+LPWCH GetEnvironmentStringsW();
+BOOL FreeEnvironmentStringsW(LPWCH block);
+int lstrlenW(LPCWSTR string);
+#define lstrlen lstrlenW
+int _wcsicmp(const wchar_t* left, const wchar_t* right);
+int _wcsnicmp(const wchar_t* left, const wchar_t* right, size_t count);
+
+#define CP_UTF8 65001
+int WideCharToMultiByte(unsigned codePage, DWORD flags, LPCWSTR wide, int wideLength,
+	LPSTR multiByte, int multiByteLength, LPCSTR defaultChar, BOOL* usedDefaultChar);
+
+#define FORMAT_MESSAGE_ALLOCATE_BUFFER 0x00000100
+#define FORMAT_MESSAGE_IGNORE_INSERTS 0x00000200
+#define FORMAT_MESSAGE_FROM_SYSTEM 0x00001000
+#define LANG_NEUTRAL 0x00
+#define SUBLANG_DEFAULT 0x01
+#define MAKELANGID(primary, sub) ((static_cast<WORD>(sub) << 10) | static_cast<WORD>(primary))
+DWORD FormatMessageW(DWORD flags, LPCVOID source, DWORD messageId, DWORD languageId, LPWSTR buffer, DWORD size, void* arguments);
+#define FormatMessage FormatMessageW
+
+void Sleep(DWORD milliseconds);
+
+// Processes and handles
+#define SYNCHRONIZE 0x00100000
+#define PROCESS_DUP_HANDLE 0x0040
+#define PROCESS_SET_INFORMATION 0x0200
+#define PROCESS_QUERY_INFORMATION 0x0400
+#define PROCESS_QUERY_LIMITED_INFORMATION 0x1000
+#define DUPLICATE_CLOSE_SOURCE 0x00000001
+
+#define IDLE_PRIORITY_CLASS 0x00000040
+#define BELOW_NORMAL_PRIORITY_CLASS 0x00004000
+#define NORMAL_PRIORITY_CLASS 0x00000020
+#define ABOVE_NORMAL_PRIORITY_CLASS 0x00008000
+#define HIGH_PRIORITY_CLASS 0x00000080
+
+typedef struct _SECURITY_ATTRIBUTES
+{
+	DWORD nLength;
+	LPVOID lpSecurityDescriptor;
+	BOOL bInheritHandle;
+} SECURITY_ATTRIBUTES, *LPSECURITY_ATTRIBUTES;
+
+typedef struct _STARTUPINFOW
+{
+	DWORD cb;
+} STARTUPINFOW, *LPSTARTUPINFOW;
+
+typedef struct _PROCESS_INFORMATION
+{
+	HANDLE hProcess;
+	HANDLE hThread;
+	DWORD dwProcessId;
+	DWORD dwThreadId;
+} PROCESS_INFORMATION, *LPPROCESS_INFORMATION;
+
+BOOL CloseHandle(HANDLE handle);
+HANDLE OpenProcess(DWORD access, BOOL inherit, DWORD processId);
+HANDLE GetCurrentProcess();
+DWORD GetCurrentProcessId();
+DWORD GetProcessId(HANDLE process);
+BOOL DuplicateHandle(HANDLE sourceProcess, HANDLE source, HANDLE targetProcess, HANDLE* target, DWORD access, BOOL inherit, DWORD options);
+BOOL SetPriorityClass(HANDLE process, DWORD priorityClass);
+BOOL GetProcessAffinityMask(HANDLE process, PDWORD_PTR processMask, PDWORD_PTR systemMask);
+BOOL SetProcessAffinityMask(HANDLE process, DWORD_PTR mask);
+DWORD WaitForInputIdle(HANDLE process, DWORD milliseconds);
+
+typedef enum _CPU_SET_INFORMATION_TYPE
+{
+	CpuSetInformation
+} CPU_SET_INFORMATION_TYPE;
+
+typedef struct _SYSTEM_CPU_SET_INFORMATION
+{
+	DWORD Size;
+	CPU_SET_INFORMATION_TYPE Type;
+	struct
+	{
+		DWORD Id;
+		WORD Group;
+		BYTE LogicalProcessorIndex;
+		BYTE CoreIndex;
+		BYTE LastLevelCacheIndex;
+		BYTE NumaNodeIndex;
+		BYTE EfficiencyClass;
+	} CpuSet;
+} SYSTEM_CPU_SET_INFORMATION, *PSYSTEM_CPU_SET_INFORMATION;
+
+BOOL GetSystemCpuSetInformation(PSYSTEM_CPU_SET_INFORMATION information, ULONG length, PULONG returnedLength, HANDLE process, ULONG flags);
+
+// Windows
+#define GW_OWNER 4
+#define SW_HIDE 0
+#define SW_RESTORE 9
+typedef BOOL (CALLBACK* WNDENUMPROC)(HWND, LPARAM);
+BOOL EnumWindows(WNDENUMPROC callback, LPARAM parameter);
+DWORD GetWindowThreadProcessId(HWND window, LPDWORD processId);
+BOOL IsWindowVisible(HWND window);
+HWND GetWindow(HWND window, unsigned command);
+BOOL IsIconic(HWND window);
+BOOL ShowWindow(HWND window, int command);
+BOOL SetForegroundWindow(HWND window);
+
+// Pipes and files
+#define GENERIC_WRITE 0x40000000
+#define OPEN_EXISTING 3
+#define PIPE_ACCESS_INBOUND 0x00000001
+#define FILE_FLAG_FIRST_PIPE_INSTANCE 0x00080000
+#define PIPE_TYPE_MESSAGE 0x00000004
+#define PIPE_READMODE_MESSAGE 0x00000002
+#define PIPE_WAIT 0x00000000
+#define PIPE_REJECT_REMOTE_CLIENTS 0x00000008
+
+typedef struct _OVERLAPPED OVERLAPPED, *LPOVERLAPPED;
+
+HANDLE CreateNamedPipeW(LPCWSTR name, DWORD openMode, DWORD pipeMode, DWORD maxInstances, DWORD outBufferSize, DWORD inBufferSize, DWORD defaultTimeOut, LPSECURITY_ATTRIBUTES attributes);
+HANDLE CreateFileW(LPCWSTR name, DWORD access, DWORD shareMode, LPSECURITY_ATTRIBUTES attributes, DWORD disposition, DWORD flags, HANDLE templateFile);
+BOOL GetNamedPipeServerProcessId(HANDLE pipe, PULONG serverProcessId);
+BOOL WriteFile(HANDLE file, LPCVOID buffer, DWORD bytes, LPDWORD written, LPOVERLAPPED overlapped);
+BOOL ReadFile(HANDLE file, LPVOID buffer, DWORD bytes, LPDWORD read, LPOVERLAPPED overlapped);
@@ -0,0 +1,164 @@
+﻿// Times SnapshotArchive on an export of 300 synthetic LocalState folders: writing the archive
+// against copying the same files one by one, opening it, reading one file and extracting one
+// folder. The archive size is printed to stderr against the raw files and, where a tar with
+// gzip is on the path, against a tar.gz of the same folders.
+
+#include "LayoutCorpus.h"
+#include "SnapshotArchive.h"
+#include "Benchmark.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr uint32_t FolderCount = 300;
+
+	const std::u16string_view LayoutFiles[] = { u"settings.json", u"state.json", u"elevated-state.json" };
+
+	std::u16string Utf16(const std::string& ascii)
+	{
+		return std::u16string(ascii.begin(), ascii.end());
+	}
+
+	bool WriteArchive(const fs::path& archive, const std::vector<fs::path>& folders)
+	{
+		SnapshotArchiveWriter writer;
+		std::error_code ec;
+		if (!writer.Create(archive, ec))
+		{
+			return false;
+		}
+		for (const fs::path& folder : folders)
+		{
+			if (!writer.AddFolder(Utf16(folder.filename().string()), folder, LayoutFiles, 3, ec))
+			{
+				return false;
+			}
+		}
+		return writer.Commit(ec);
+	}
+
+	/// What an export without the archive does: a copy of every layout file under one folder.
+	void CopyFolders(const fs::path& target, const std::vector<fs::path>& folders)
+	{
+		std::error_code ec;
+		fs::remove_all(target, ec);
+		for (const fs::path& folder : folders)
+		{
+			const fs::path copy = target / folder.filename();
+			fs::create_directories(copy, ec);
+			for (std::u16string_view name : LayoutFiles)
+			{
+				const fs::path file{ std::u16string(name) };
+				fs::copy_file(folder / file, copy / file, ec);
+			}
+		}
+	}
+
+	uintmax_t TreeSize(const fs::path& root)
+	{
+		uintmax_t size = 0;
+		for (const fs::directory_entry& entry : fs::recursive_directory_iterator(root))
+		{
+			size += entry.is_regular_file() ? entry.file_size() : 0;
+		}
+		return size;
+	}
+
+	/// Reports the size and time of a tar.gz of the corpus; skipped when tar is not available.
+	void ReportTarGzip(const fs::path& root, const fs::path& tarball, uintmax_t rawSize)
+	{
+		const std::string command = "tar czf \"" + tarball.string() + "\" -C \"" + root.string() + "\" . 2>"
+#ifdef _WIN32
+			"NUL";
+#else
+			"/dev/null";
+#endif
+		const auto start = std::chrono::steady_clock::now();
+		if (std::system(command.c_str()) != 0 || !fs::exists(tarball))
+		{
+			std::fprintf(stderr, "tar.gz: not measured, tar is not available\n");
+			return;
+		}
+		const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+		std::fprintf(stderr, "tar.gz: %ju bytes for %ju bytes of files, in %.1f ms\n",
+			static_cast<uintmax_t>(fs::file_size(tarball)), rawSize, elapsed.count());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Benchmark::Suite suite("SnapshotArchive", argc, argv);
+
+	std::error_code ec;
+	const fs::path work = fs::temp_directory_path() / ("wtlm-snapshot-archive-" + std::to_string(FolderCount));
+	const fs::path root = work / "corpus";
+	const fs::path archive = work / "export.wtla";
+	const LayoutCorpusShape shape{ 35, FolderCount, 1, 4, 3, 12, true };
+	if (!LayoutCorpus::Generate(root, shape, ec))
+	{
+		std::fprintf(stderr, "cannot write the corpus under %s: %s\n", root.string().c_str(), ec.message().c_str());
+		return 2;
+	}
+
+	std::vector<fs::path> folders;
+	for (const fs::directory_entry& entry : fs::directory_iterator(root))
+	{
+		folders.push_back(entry.path());
+	}
+	if (!WriteArchive(archive, folders))
+	{
+		std::fprintf(stderr, "cannot write %s\n", archive.string().c_str());
+		return 2;
+	}
+	const uintmax_t rawSize = TreeSize(root);
+	std::fprintf(stderr, "archive: %ju bytes for %ju bytes of files\n", static_cast<uintmax_t>(fs::file_size(archive)), rawSize);
+	ReportTarGzip(root, work / "export.tar.gz", rawSize);
+
+	const std::string folderCount = std::to_string(FolderCount);
+	suite.Run("Write/" + folderCount, [&] {
+		const bool written = WriteArchive(archive, folders);
+		Benchmark::Keep(&written);
+	});
+	suite.Run("CopyFiles/" + folderCount, [&] {
+		CopyFolders(work / "copies", folders);
+	});
+	suite.Run("Open/" + folderCount, [&] {
+		SnapshotArchiveReader reader;
+		const bool opened = reader.Open(archive, ec);
+		Benchmark::Keep(&opened);
+	});
+
+	// Alternates between two folders so that every read decompresses its block.
+	SnapshotArchiveReader reader;
+	if (!reader.Open(archive, ec))
+	{
+		std::fprintf(stderr, "cannot open %s: %s\n", archive.string().c_str(), ec.message().c_str());
+		return 2;
+	}
+	size_t folder = 0;
+	std::string content;
+	suite.Run("ReadFile/state.json", [&] {
+		folder = folder == 0 ? reader.FolderCount() - 1 : 0;
+		const bool read = reader.ReadFile(folder, 1, content, ec);
+		Benchmark::Keep(&read);
+	});
+	suite.Run("Extract/one_folder", [&] {
+		folder = folder == 0 ? reader.FolderCount() - 1 : 0;
+		const bool extracted = reader.Extract(folder, work / "extracted", ec);
+		Benchmark::Keep(&extracted);
+	});
+
+	const int result = suite.Finish();
+	fs::remove_all(work, ec);
+	return result;
+}
@@ -0,0 +1,161 @@
+﻿// Times SnapshotHistory on a synthetic history of a 20-tab state.json: appending a version,
+// opening the history, and restoring a checkpoint and the delta versions after it, up to the
+// last one before the next checkpoint, which replays the longest chain. The storage the history
+// takes against full copies is printed to stderr.
+
+#include "SnapshotHistory.h"
+#include "Benchmark.h"
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr uint32_t StateSource = 1;
+	constexpr size_t VersionCount = 461;
+
+	/// A window of tabs, each a newTab followed by its splits.
+	struct Layout
+	{
+		std::vector<std::string> titles;
+		std::vector<std::string> directories;
+		std::vector<int> splits;
+		int focused = 0;
+
+		std::string Render() const
+		{
+			std::string json = "{\n    \"persistedWindowLayouts\": [\n        {\n            \"tabLayout\": [\n";
+			for (size_t tab = 0; tab < titles.size(); ++tab)
+			{
+				json += "                { \"action\": \"newTab\", \"profile\": \"PowerShell\", \"tabTitle\": \"" + titles[tab]
+					+ "\", \"startingDirectory\": \"" + directories[tab] + "\" },\n";
+				for (int split = 0; split < splits[tab]; ++split)
+				{
+					json += "                { \"action\": \"splitPane\", \"profile\": \"Command Prompt\", \"split\": \""
+						+ std::string(split % 2 ? "down" : "right") + "\", \"splitMode\": \"duplicate\", \"size\": 0.5 },\n";
+				}
+			}
+			json += "                { \"action\": \"switchToTab\", \"index\": " + std::to_string(focused) + " }\n";
+			json += "            ],\n            \"initialPosition\": \"120,80\",\n";
+			json += "            \"initialSize\": { \"height\": 900.0, \"width\": 1600.0 },\n            \"launchMode\": \"default\"\n";
+			json += "        }\n    ]\n}\n";
+			return json;
+		}
+	};
+
+	/// Versions of a 20-tab window: each step renames, splits, closes or opens a tab, or moves the focus.
+	std::vector<std::string> MakeVersions(size_t count)
+	{
+		Layout layout;
+		for (int tab = 0; tab < 20; ++tab)
+		{
+			layout.titles.push_back("Tab " + std::to_string(tab));
+			layout.directories.push_back("C:\\\\Source\\\\Repository" + std::to_string(tab));
+			layout.splits.push_back(tab % 4);
+		}
+
+		std::vector<std::string> versions;
+		uint32_t seed = 0x6A09E667u;
+		while (versions.size() < count)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			const size_t tab = (seed >> 8) % layout.titles.size();
+			switch ((seed >> 24) % 5)
+			{
+			case 0:
+				layout.titles[tab] = "Tab " + std::to_string(versions.size());
+				break;
+			case 1:
+				layout.splits[tab] = (layout.splits[tab] + 1) % 6;
+				break;
+			case 2:
+				if (layout.titles.size() > 15)
+				{
+					layout.titles.erase(layout.titles.begin() + static_cast<ptrdiff_t>(tab));
+					layout.directories.erase(layout.directories.begin() + static_cast<ptrdiff_t>(tab));
+					layout.splits.erase(layout.splits.begin() + static_cast<ptrdiff_t>(tab));
+					break;
+				}
+				[[fallthrough]];
+			case 3:
+				layout.titles.insert(layout.titles.begin() + static_cast<ptrdiff_t>(tab), "New " + std::to_string(versions.size()));
+				layout.directories.insert(layout.directories.begin() + static_cast<ptrdiff_t>(tab),
+					"C:\\\\Source\\\\Repository" + std::to_string(100 + versions.size()));
+				layout.splits.insert(layout.splits.begin() + static_cast<ptrdiff_t>(tab), 1);
+				break;
+			default:
+				layout.focused = static_cast<int>(tab);
+				break;
+			}
+			versions.push_back(layout.Render());
+		}
+		return versions;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Benchmark::Suite suite("SnapshotHistory", argc, argv);
+
+	const fs::path folder = fs::temp_directory_path() / "wtlm-snapshot-history-benchmark";
+	std::error_code ec;
+	fs::remove_all(folder, ec);
+	fs::create_directories(folder, ec);
+	const fs::path path = SnapshotHistory::PathFor(folder);
+	const std::vector<std::string> versions = MakeVersions(VersionCount + 1);
+
+	size_t fullBytes = 0;
+	{
+		SnapshotHistory history;
+		bool appended = false;
+		if (!history.Open(path, SnapshotHistory::DefaultCheckpointInterval, ec))
+		{
+			std::fprintf(stderr, "cannot open %s: %s\n", path.string().c_str(), ec.message().c_str());
+			return 2;
+		}
+		for (size_t i = 0; i < VersionCount; ++i)
+		{
+			history.Append(StateSource, versions[i], appended, ec);
+			fullBytes += versions[i].size();
+		}
+	}
+	std::fprintf(stderr, "%zu versions: %ju bytes of history for %zu bytes of full copies\n",
+		VersionCount, static_cast<uintmax_t>(fs::file_size(path, ec)), fullBytes);
+
+	suite.Run("Open/" + std::to_string(VersionCount), [&] {
+		SnapshotHistory history;
+		history.Open(path, SnapshotHistory::DefaultCheckpointInterval, ec);
+		Benchmark::Keep(&history);
+	});
+
+	SnapshotHistory history;
+	history.Open(path, SnapshotHistory::DefaultCheckpointInterval, ec);
+	// The last complete checkpoint interval: a checkpoint followed by its 15 deltas.
+	const size_t checkpoint = (VersionCount / SnapshotHistory::DefaultCheckpointInterval - 1) * SnapshotHistory::DefaultCheckpointInterval;
+	for (size_t offset : { size_t{ 0 }, size_t{ 1 }, size_t{ 7 }, size_t{ SnapshotHistory::DefaultCheckpointInterval - 1 } })
+	{
+		std::string content;
+		suite.Run("Restore/checkpoint+" + std::to_string(offset), [&] {
+			history.Restore(checkpoint + offset, content, ec);
+			Benchmark::Keep(content.data());
+		});
+	}
+
+	// Alternates between two versions, so every call appends a delta.
+	size_t next = 0;
+	suite.Run("Append/20_tabs", [&] {
+		bool appended = false;
+		history.Append(StateSource, versions[VersionCount - 1 + (next++ & 1)], appended, ec);
+		Benchmark::Keep(&appended);
+	});
+
+	const int result = suite.Finish();
+	fs::remove_all(folder, ec);
+	return result;
+}
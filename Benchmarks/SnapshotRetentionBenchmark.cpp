@@ -0,0 +1,109 @@
+﻿// Times the retention policy over 2,000 LocalState copies: the plan (measuring every copy on a
+// FolderScanner and evaluating the budget), the evaluation alone, and one prune that deletes the
+// evicted copies through FileOperationEngine, timed once since it removes them. The copies have
+// random sizes and last runs, one in twenty is pinned and one is registered as running.
+
+#include "FileOperationEngine.h"
+#include "InstanceRegistry.h"
+#include "SnapshotRetention.h"
+#include "SnapshotStore.h"
+#include "Benchmark.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr int CopyCount = 2000;
+
+	void WriteFile(const fs::path& path, size_t bytes)
+	{
+		std::ofstream(path, std::ios::binary) << std::string(bytes, 'x');
+	}
+
+	std::wstring RegistryKey(const fs::path& folder)
+	{
+#if defined(_WIN32)
+		return folder.wstring();
+#else
+		const std::u32string text = folder.u32string();
+		return std::wstring(text.begin(), text.end());
+#endif
+	}
+
+	uint32_t CurrentProcessId()
+	{
+#if defined(_WIN32)
+		return ::GetCurrentProcessId();
+#else
+		return static_cast<uint32_t>(::getpid());
+#endif
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Benchmark::Suite suite("SnapshotRetention", argc, argv);
+
+	std::error_code ec;
+	const fs::path work = fs::temp_directory_path() / "wtlm-snapshot-retention";
+	const fs::path copies = work / "copies";
+	fs::remove_all(work, ec);
+	std::mt19937_64 random(49);
+	const auto now = fs::file_time_type::clock::now();
+	for (int i = 0; i < CopyCount; ++i)
+	{
+		const fs::path copy = copies / ("LocalState_" + std::to_string(i));
+		fs::create_directories(copy, ec);
+		WriteFile(copy / "settings.json", 2000 + random() % 30000);
+		WriteFile(copy / "state.json", 500 + random() % 5000);
+		fs::last_write_time(copy / "state.json", now - std::chrono::minutes(random() % (60 * 24 * 365)), ec);
+		if (i % 20 == 0)
+		{
+			SnapshotRetention::SetPinned(copy, true, ec);
+		}
+	}
+	RegisteredInstance running(RegistryKey(copies / "LocalState_1"), CurrentProcessId(), false);
+	const RetentionPolicy policy{ 300, 0 };
+
+	RetentionReport report;
+	suite.Run("Plan/" + std::to_string(CopyCount), [&] {
+		report = SnapshotRetention::Plan(copies, policy);
+	});
+	const std::vector<RetentionEntry> entries = report.entries;
+	suite.Run("Evaluate/" + std::to_string(CopyCount), [&] {
+		report = SnapshotRetention::Evaluate(entries, policy);
+	});
+
+	const std::vector<fs::path> evicted = SnapshotRetention::Evicted(report);
+	SnapshotStore store(work / "objects");
+	FileOperationEngine engine(&store, work / "trash");
+	const auto start = std::chrono::steady_clock::now();
+	engine.StartDelete(evicted.data(), evicted.size());
+	engine.Wait();
+	const double pruneMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	const RetentionReport after = SnapshotRetention::Plan(copies, policy);
+	std::fprintf(stderr, "pruned %zu of %d copies in %.1f ms; a second plan keeps %u and evicts %u\n",
+		evicted.size(), CopyCount, pruneMilliseconds, after.keptCount, after.evictedCount);
+
+	fs::remove_all(work, ec);
+	if (after.evictedCount != 0 || after.keptCount != report.keptCount)
+	{
+		return 2;
+	}
+	return suite.Finish();
+}
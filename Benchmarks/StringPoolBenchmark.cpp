@@ -0,0 +1,166 @@
+﻿// Measures what interning saves on the strings a folder load keeps: the profile names and icons of
+// every settings.json, and the profiles, tab titles, command lines and starting directories of every
+// state file, over a 1,000-snapshot LayoutCorpus. The strings are kept once as owned copies and once
+// as ids of a StringPool; the growth of the resident set for each is printed to stderr. Then it times
+//   Intern/hit     interning a string the pool already has,
+//   Intern/corpus  interning every kept string into a fresh pool,
+//   Copy/corpus    copying every kept string into a vector, as the parsers did before.
+
+#include "LayoutCorpus.h"
+#include "SettingsProfileScanner.h"
+#include "StringPool.h"
+#include "Benchmark.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	const LayoutCorpusShape Shape{ 47, 1000, 1, 4, 2, 20, true };
+
+	/// The pane and tab members of a state file a load keeps.
+	constexpr std::string_view StateKeys[] = { "\"profile\":\"", "\"tabTitle\":\"", "\"commandline\":\"", "\"startingDirectory\":\"" };
+
+	uint64_t ResidentBytes()
+	{
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters{};
+		return ::K32GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters)) ? counters.WorkingSetSize : 0;
+#else
+		unsigned long long size = 0;
+		unsigned long long resident = 0;
+		FILE* statm = std::fopen("/proc/self/statm", "r");
+		if (statm == nullptr)
+		{
+			return 0;
+		}
+		const int read = std::fscanf(statm, "%llu %llu", &size, &resident);
+		std::fclose(statm);
+		return read == 2 ? resident * static_cast<uint64_t>(::sysconf(_SC_PAGESIZE)) : 0;
+#endif
+	}
+
+	/// The raw contents of a JSON string starting at from, up to its closing quote.
+	std::string_view RawString(std::string_view json, size_t from)
+	{
+		size_t end = from;
+		while (end < json.size() && json[end] != '"')
+		{
+			end += json[end] == '\\' ? 2 : 1;
+		}
+		return json.substr(from, (end < json.size() ? end : json.size()) - from);
+	}
+
+	/// Calls keep with every string a load of one snapshot keeps, decoded.
+	template <class Keep>
+	void ForEachKeptString(uint32_t snapshot, Keep&& keep)
+	{
+		std::u16string text;
+		const std::string settings = LayoutCorpus::RenderSettings(Shape, snapshot);
+		std::vector<SettingsProfileFields> profiles;
+		SettingsProfileScanner::Extract(reinterpret_cast<const uint8_t*>(settings.data()), settings.size(), profiles);
+		for (const SettingsProfileFields& profile : profiles)
+		{
+			for (std::string_view raw : { profile.name, profile.icon })
+			{
+				if (raw.data() != nullptr && SettingsProfileScanner::Decode(raw, text))
+				{
+					keep(text);
+				}
+			}
+		}
+		for (bool elevated : { false, true })
+		{
+			const std::string state = LayoutCorpus::RenderState(Shape, snapshot, elevated);
+			for (std::string_view key : StateKeys)
+			{
+				for (size_t at = state.find(key); at != std::string::npos; at = state.find(key, at + key.size()))
+				{
+					if (SettingsProfileScanner::Decode(RawString(state, at + key.size()), text))
+					{
+						keep(text);
+					}
+				}
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Benchmark::Suite suite("StringPool", argc, argv);
+
+	// Ids first: the copies that follow cannot reuse memory the pool holds.
+	StringPool pool;
+	std::vector<uint32_t> ids;
+	const uint64_t beforePool = ResidentBytes();
+	for (uint32_t snapshot = 0; snapshot < Shape.snapshotCount; ++snapshot)
+	{
+		ForEachKeptString(snapshot, [&](const std::u16string& text) { ids.push_back(pool.Intern(text)); });
+	}
+	const uint64_t poolGrowth = ResidentBytes() - beforePool;
+
+	std::vector<std::u16string> copies;
+	const uint64_t beforeCopies = ResidentBytes();
+	for (uint32_t snapshot = 0; snapshot < Shape.snapshotCount; ++snapshot)
+	{
+		ForEachKeptString(snapshot, [&](const std::u16string& text) { copies.push_back(text); });
+	}
+	const uint64_t copiesGrowth = ResidentBytes() - beforeCopies;
+
+	if (copies.size() != ids.size())
+	{
+		std::fprintf(stderr, "%zu copies but %zu ids\n", copies.size(), ids.size());
+		return 2;
+	}
+	for (size_t i = 0; i < ids.size(); ++i)
+	{
+		if (pool.View(ids[i]) != copies[i])
+		{
+			std::fprintf(stderr, "string %zu does not round-trip through the pool\n", i);
+			return 2;
+		}
+	}
+	const StringPoolStats stats = pool.Stats();
+	std::fprintf(stderr, "%u snapshots: %zu kept strings, %u distinct (%.1f%% hits)\n", Shape.snapshotCount,
+		ids.size(), stats.strings, 100.0 * static_cast<double>(stats.hits) / static_cast<double>(stats.lookups));
+	std::fprintf(stderr, "resident growth: %ju KiB as owned copies, %ju KiB as pool ids (arena %ju KiB)\n",
+		static_cast<uintmax_t>(copiesGrowth / 1024), static_cast<uintmax_t>(poolGrowth / 1024),
+		static_cast<uintmax_t>(stats.arenaBytes / 1024));
+
+	const uint32_t hit = pool.Intern(copies[0]);
+	suite.Run("Intern/hit", [&] {
+		Benchmark::Keep(&hit);
+		const uint32_t id = pool.Intern(copies[0]);
+		Benchmark::Keep(&id);
+	});
+	suite.Run("Intern/corpus", [&] {
+		StringPool fresh;
+		for (const std::u16string& text : copies)
+		{
+			const uint32_t id = fresh.Intern(text);
+			Benchmark::Keep(&id);
+		}
+	});
+	suite.Run("Copy/corpus", [&] {
+		std::vector<std::u16string> kept;
+		kept.reserve(copies.size());
+		for (const std::u16string& text : copies)
+		{
+			kept.push_back(text);
+		}
+		Benchmark::Keep(kept.data());
+	});
+	return suite.Finish();
+}
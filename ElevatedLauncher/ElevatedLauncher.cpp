@@ -2,91 +2,71 @@
 #include <windows.h>
 #include <tchar.h>
 #include <strsafe.h>
-#include <iostream>
 #include <string>
 #include <vector>
-#include <algorithm>   // std::find_if, std::remove_if
 #include "WinApiHelpers.h"
+#include "LauncherArguments.h"
+#include "NativeLog.h"
+#include "RuntimeMetrics.h"
+#include "ResourceAccounting.h"
+#include "InstanceRegistry.h"
 
 using namespace WTLayoutManager::Services;
 
-// Trim leading / trailing spaces or tabs – optional, but handy.
 /**
- * Removes leading and trailing whitespace from a wide string.
- *
- * @param s Reference to the wide string to be trimmed in-place
- * @remarks Uses a lambda function to identify non-whitespace characters
- * @remarks Modifies the input string by removing spaces and tabs from both ends
- */
-static inline void trim(std::wstring& s)
-{
-    auto not_space = [](wchar_t ch) { return ch != L' ' && ch != L'\t'; };
-
-    s.erase(s.begin(), std::find_if(s.begin(), s.end(), not_space));         // left trim
-    s.erase(std::find_if(s.rbegin(), s.rend(), not_space).base(), s.end());  // right trim
-}
-
-// Decode "Name=Value;Name2=Value2" → vector<wstring>
-/**
- * Splits an environment block string into individual environment variable entries.
- *
- * Parses a semicolon-delimited string of environment variables, trimming whitespace 
- * from each entry and filtering out empty entries.
- *
- * @param envStr A wide string containing environment variables in "NAME=VALUE" format
- * @return A vector of individual environment variable entries
- * @remarks Handles multiple environment variables separated by semicolons
- * @remarks Whitespace around each entry is automatically trimmed
+ * Returns the log folder shared with WTLayoutManager: %LOCALAPPDATA%\WTLayoutManager\logs.
  */
-static std::vector<std::wstring> splitEnvBlock(const std::wstring& envStr)
+static std::wstring logDirectory()
 {
-    std::vector<std::wstring> result;
-
-    std::wstring::size_type start = 0;
-    while (start < envStr.length())
+    wchar_t buffer[MAX_PATH];
+    DWORD length = GetEnvironmentVariableW(L"LOCALAPPDATA", buffer, MAX_PATH);
+    if (length == 0 || length >= MAX_PATH)
     {
-        auto next = envStr.find(L';', start);
-        if (next == std::wstring::npos)
-        {
-            next = envStr.length();          // last segment
-        }
-
-        std::wstring token = envStr.substr(start, next - start);
-        trim(token);                         // optional
-
-        if (!token.empty())
-        {
-            result.push_back(std::move(token));
-        }
-
-        start = next + 1;                    // skip the semicolon
+        return std::wstring();
     }
-    return result;
+    return std::wstring(buffer, length) + L"\\WTLayoutManager\\logs";
 }
 
-
 /**
  * Entry point for the elevated launcher application.
  *
  * Launches a target process with optional custom environment variables.
- * Expects exactly 4 command-line arguments:
+ * Expects 4 command-line arguments:
  * - Target application path
  * - Target command line
  * - Encoded environment block
+ * - Hook DLL path
+ * and optionally a launch policy, as formatted by LaunchScheduler::FormatPolicy, the LocalState folder
+ * and the name of a handoff pipe created by WinApiHelpers::CreateHandoffPipe.
+ *
+ * With a handoff pipe the launcher gives the caller a handle to the terminal and exits as soon as the
+ * terminal runs; the caller registers and waits for it. Otherwise, or if the handoff fails, the
+ * launcher registers the terminal and stays until it exits.
  *
  * @param argc Number of command-line arguments
  * @param argv Array of command-line argument strings
- * @return Process exit code of the launched application, or -1 if an error occurs
+ * @return 0 once the terminal is handed over, else the exit code of the launched application, or -1 if an error occurs
+ * @remarks The launcher runs hidden, so failures are written to ElevatedLauncher.log in the log folder
  */
 int wmain(int argc, wchar_t *argv[])
 {
-    // We expect exactly three parameters:
+    NativeLogOptions logOptions;
+    logOptions.directory = logDirectory();
+    logOptions.baseName = "ElevatedLauncher";
+    NativeLogSession log(logOptions);
+
+    // We expect four parameters and two optional ones:
     // argv[1] = target application path
     // argv[2] = target command line
     // argv[3] = encoded environment block (e.g. "VAR1=Value1;VAR2=Value2")
-    if (argc != 5)
+    // argv[4] = hook DLL path
+    // argv[5] = optional launch policy (e.g. "priority=2;placement=0;affinity=0;queue=0;stagger=0")
+    // argv[6] = optional LocalState folder the terminal is registered as running
+    // argv[7] = optional handoff pipe name; empty to stay until the terminal exits
+    LaunchPolicy policy;
+    if (argc < 5 || argc > 8 || (argc >= 6 && !LaunchScheduler::ParsePolicy(argv[5], policy)))
     {
-        std::wcerr << L"Usage: LauncherExe.exe <applicationPath> <commandLine> <envBlock> <hookLib>" << std::endl;
+        NativeLog::Write(LogLevel::Error, "launcher.usage", ERROR_BAD_ARGUMENTS, { LogArg("argc", argc) });
         return -1;
     }
 
@@ -99,15 +79,25 @@ int wmain(int argc, wchar_t *argv[])
     // Here we assume the environment variables are separated by semicolons.
     // For example: "MY_VAR1=Value1;MY_VAR2=Value2"
     std::wstring envStr(envParam);
-    DWORD dwCreationFlags = NORMAL_PRIORITY_CLASS | CREATE_NEW_CONSOLE | CREATE_NEW_PROCESS_GROUP | CREATE_SUSPENDED;
+    DWORD dwCreationFlags = WinApiHelpers::PriorityClassFlag(policy.priority) | CREATE_NEW_CONSOLE | CREATE_NEW_PROCESS_GROUP | CREATE_SUSPENDED;
     std::unique_ptr<wchar_t[]> envCopy(nullptr);
     if (envStr.size())
     {
-        std::vector<std::wstring> additional = splitEnvBlock(envStr);
+        std::vector<std::wstring> additional = LauncherArguments::SplitEnvironment(envStr);
         envCopy.reset(WinApiHelpers::CreateMergedEnvironmentBlock(additional));
         dwCreationFlags |= CREATE_UNICODE_ENVIRONMENT;
     }
 
+    // The app opens the container by this process's id to account for the terminal; the limits of the
+    // policy are enforced on it.
+    std::error_code accountError;
+    std::unique_ptr<ProcessTreeAccount> account = ProcessTreeAccount::Create(policy.limits,
+        ProcessTreeAccount::LauncherAccountName(GetCurrentProcessId()).c_str(), accountError);
+    if (!account)
+    {
+        NativeLog::Write(LogLevel::Warning, "launcher.accounting", static_cast<uint32_t>(accountError.value()), { LogArg("app", targetApp) });
+    }
+
     STARTUPINFOEXW si{ sizeof(si) };
     si.StartupInfo.wShowWindow = SW_SHOWDEFAULT;
     process_info_raii pi;
@@ -129,25 +119,51 @@ int wmain(int argc, wchar_t *argv[])
 
     if (!success)
     {
-        std::wcerr << L"CreateProcess failed." << std::endl;
+        NativeLog::Write(LogLevel::Error, "launcher.create_process", GetLastError(), { LogArg("app", targetApp) });
         return -1;
     }
 
+    if (!WinApiHelpers::ApplyLaunchPolicy(pi.pi.hProcess, policy))
+    {
+        NativeLog::Write(LogLevel::Warning, "launcher.policy", GetLastError(), { LogArg("app", targetApp) });
+    }
+    if (account && !account->Assign(pi.pi.dwProcessId, accountError))
+    {
+        NativeLog::Write(LogLevel::Warning, "launcher.accounting", static_cast<uint32_t>(accountError.value()), { LogArg("app", targetApp) });
+    }
+
     success = ResumeThread(pi.pi.hThread);
 
     HandlePtr piHandle = WinApiHelpers::GetWindowsTerminalHandle(pi.pi.dwProcessId);
     if (piHandle.get() == nullptr)
     {
-        std::wcerr << L"GetWindowsTerminalHandle failed." << std::endl;
+        NativeLog::Write(LogLevel::Error, "launcher.terminal_not_found", GetLastError(), { LogArg("pid", pi.pi.dwProcessId) });
         return -1;
     }
+    // The priority class is not inherited above normal; the affinity already is.
+    SetPriorityClass(piHandle.get(), WinApiHelpers::PriorityClassFlag(policy.priority));
+
+    // Hand the terminal to the caller instead of staying resident; its job object outlives this
+    // process since the terminal is in it.
+    if (argc >= 8 && argv[7][0] != L'\0')
+    {
+        if (WinApiHelpers::SendHandoff(argv[7], piHandle.get()))
+        {
+            return 0;
+        }
+        NativeLog::Write(LogLevel::Warning, "launcher.handoff", GetLastError(), { LogArg("pid", pi.pi.dwProcessId) });
+    }
+
+    RegisteredInstance registered(argc >= 7 ? argv[6] : L"", GetProcessId(piHandle.get()), true);
 
     // Wait for the target process to exit.
+    RuntimeMetrics::Add(MetricCounter::WatchedProcesses);
     WaitForSingleObject(piHandle.get(), INFINITE);
+    RuntimeMetrics::Add(MetricCounter::WatchedProcesses, -1);
     DWORD exitCode = 0;
     if (!GetExitCodeProcess(piHandle.get(), &exitCode))
     {
-        std::wcerr << L"GetExitCodeProcess failed." << std::endl;
+        NativeLog::Write(LogLevel::Error, "launcher.exit_code", GetLastError(), { LogArg("pid", pi.pi.dwProcessId) });
         return -1;
     }
 
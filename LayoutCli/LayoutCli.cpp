@@ -0,0 +1,879 @@
+﻿#include "pch.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include "FileOperationEngine.h"
+#include "FolderScanner.h"
+#include "InstanceRegistry.h"
+#include "LaunchApi.h"
+#include "SnapshotRetention.h"
+#include "SnapshotStore.h"
+
+namespace fs = std::filesystem;
+using namespace WTLayoutManager::Services;
+
+static constexpr const char* Usage =
+    "Usage: LayoutCli [--family <package family>] [--data <local app data>] <command> ...\n"
+    "  list\n"
+    "  duplicate <folder> [--name <new folder name>]\n"
+    "  delete <folder>...\n"
+    "  pin <folder>... | unpin <folder>...\n"
+    "  prune [--max-count <n>] [--max-bytes <n>] [--save] [--dry-run]\n"
+    "  launch [--elevated] [--wait] [--batch <file>] --terminal <wt.exe> [--hook <dll>] [--launcher <exe>] [<folder>...]\n"
+    "A folder is LocalState for the default one, the name of a copy, or a path.\n";
+
+/// The files a LocalState folder is listed with, and the ones a duplicate takes along.
+static constexpr const char* LayoutFiles[] = { "state.json", "elevated-state.json", "settings.json" };
+static constexpr std::u16string_view CopiedFiles[] = { u"settings.json", u"state.json" };
+
+/**
+ * Builds one JSON document in memory and writes it to stdout at the end, as UTF-8.
+ */
+class JsonWriter
+{
+public:
+    ~JsonWriter()
+    {
+        m_out += '\n';
+        std::fwrite(m_out.data(), 1, m_out.size(), stdout);
+        std::fflush(stdout);
+    }
+
+    void BeginObject() { Separator(); m_out += '{'; m_first.push_back(true); }
+    void EndObject() { m_out += '}'; m_first.pop_back(); }
+    void BeginArray() { Separator(); m_out += '['; m_first.push_back(true); }
+    void EndArray() { m_out += ']'; m_first.pop_back(); }
+
+    void Key(const char* name)
+    {
+        Separator();
+        Quote(name);
+        m_out += ':';
+        m_afterKey = true;
+    }
+
+    void String(std::string_view utf8) { Separator(); Quote(utf8); }
+    void Path(const fs::path& path)
+    {
+        const std::u8string text = path.u8string();
+        String(std::string_view(reinterpret_cast<const char*>(text.data()), text.size()));
+    }
+    void Number(long long value) { Separator(); m_out += std::to_string(value); }
+    void Bool(bool value) { Separator(); m_out += value ? "true" : "false"; }
+    void Null() { Separator(); m_out += "null"; }
+
+private:
+    void Separator()
+    {
+        if (m_afterKey)
+        {
+            m_afterKey = false;
+            return;
+        }
+        if (!m_first.empty())
+        {
+            if (!m_first.back())
+                m_out += ',';
+            m_first.back() = false;
+        }
+    }
+
+    void Quote(std::string_view text)
+    {
+        m_out += '"';
+        for (char ch : text)
+        {
+            const unsigned char c = static_cast<unsigned char>(ch);
+            if (ch == '"' || ch == '\\')
+            {
+                m_out += '\\';
+                m_out += ch;
+            }
+            else if (c < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                m_out += escaped;
+            }
+            else
+            {
+                m_out += ch;
+            }
+        }
+        m_out += '"';
+    }
+
+    std::string m_out;
+    std::vector<bool> m_first;
+    bool m_afterKey = false;
+};
+
+/**
+ * Converts UTF-8 to a path.
+ */
+static fs::path FromUtf8(std::string_view text)
+{
+    return fs::path(std::u8string(reinterpret_cast<const char8_t*>(text.data()), text.size()));
+}
+
+/**
+ * Returns the UTF-8 form of a path.
+ */
+static std::string ToUtf8(const fs::path& path)
+{
+    const std::u8string text = path.u8string();
+    return std::string(reinterpret_cast<const char*>(text.data()), text.size());
+}
+
+/**
+ * Returns the wide form of a path the instance registry keys folders by; UTF-32 where wchar_t is
+ * 32 bits wide, whatever the locale.
+ */
+static std::wstring ToWide(const fs::path& path)
+{
+#if defined(_WIN32)
+    return path.wstring();
+#else
+    const std::u32string text = path.u32string();
+    return std::wstring(text.begin(), text.end());
+#endif
+}
+
+/**
+ * Returns the local application data folder: %LOCALAPPDATA% on Windows; elsewhere $LOCALAPPDATA,
+ * $XDG_DATA_HOME or ~/.local/share.
+ */
+static fs::path LocalAppData()
+{
+#if defined(_WIN32)
+    wchar_t* value = nullptr;
+    size_t length = 0;
+    fs::path folder;
+    if (_wdupenv_s(&value, &length, L"LOCALAPPDATA") == 0 && value != nullptr)
+        folder = value;
+    std::free(value);
+    return folder;
+#else
+    if (const char* value = std::getenv("LOCALAPPDATA"))
+        return value;
+    if (const char* value = std::getenv("XDG_DATA_HOME"))
+        return value;
+    const char* home = std::getenv("HOME");
+    return fs::path(home != nullptr ? home : ".") / ".local" / "share";
+#endif
+}
+
+/**
+ * Milliseconds since the Unix epoch of a file time.
+ */
+static long long UnixMilliseconds(fs::file_time_type time)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::file_clock::to_sys(time).time_since_epoch()).count();
+}
+
+struct Options
+{
+    std::string family = "Microsoft.WindowsTerminal_8wekyb3d8bbwe";
+    fs::path data;
+    fs::path self;
+};
+
+static fs::path DefaultFolder(const Options& options)
+{
+    return options.data / "Packages" / FromUtf8(options.family) / "LocalState";
+}
+
+static fs::path CustomBase(const Options& options)
+{
+    return options.data / "WTLayoutManager" / FromUtf8(options.family);
+}
+
+/**
+ * Resolves a folder argument: "LocalState" is the default folder, a bare name a copy, anything else a path.
+ */
+static fs::path Resolve(const Options& options, const std::string& argument)
+{
+    if (argument == "LocalState")
+        return DefaultFolder(options);
+    const fs::path path = FromUtf8(argument);
+    if (path.has_parent_path() || path.is_absolute())
+        return fs::absolute(path).lexically_normal();
+    return CustomBase(options) / path;
+}
+
+static bool IsDefault(const Options& options, const fs::path& folder)
+{
+    return folder.lexically_normal() == DefaultFolder(options).lexically_normal();
+}
+
+/**
+ * Writes the process id of the terminal running a folder, or null.
+ */
+static void WriteRunning(JsonWriter& json, const fs::path& folder, bool elevated)
+{
+    RunningInstance instance{};
+    if (InstanceRegistry::Find(ToWide(folder), elevated, instance))
+        json.Number(instance.processId);
+    else
+        json.Null();
+}
+
+/**
+ * Lists the default LocalState folder and every copy, with their layout files and the terminals running them.
+ */
+static int List(const Options& options)
+{
+    std::vector<fs::path> copies = FolderScanner::EnumerateSubfolders(CustomBase(options));
+    std::sort(copies.begin(), copies.end());
+    std::vector<fs::path> folders{ DefaultFolder(options) };
+    folders.insert(folders.end(), copies.begin(), copies.end());
+
+    JsonWriter json;
+    json.BeginObject();
+    json.Key("snapshots");
+    json.BeginArray();
+    for (const fs::path& folder : folders)
+    {
+        const bool isDefault = IsDefault(options, folder);
+        json.BeginObject();
+        json.Key("name");
+        json.String(isDefault ? "LocalState" : ToUtf8(folder.filename()));
+        json.Key("path");
+        json.Path(folder);
+        json.Key("default");
+        json.Bool(isDefault);
+        json.Key("pinned");
+        json.Bool(!isDefault && SnapshotRetention::IsPinned(folder));
+
+        long long lastRun = -1;
+        json.Key("files");
+        json.BeginArray();
+        for (const char* name : LayoutFiles)
+        {
+            std::error_code ec;
+            const fs::path file = folder / name;
+            const uintmax_t size = fs::file_size(file, ec);
+            const fs::file_time_type modified = ec ? fs::file_time_type() : fs::last_write_time(file, ec);
+            if (ec)
+                continue;
+            json.BeginObject();
+            json.Key("name");
+            json.String(name);
+            json.Key("size");
+            json.Number(static_cast<long long>(size));
+            json.Key("modifiedUnixMs");
+            json.Number(UnixMilliseconds(modified));
+            json.EndObject();
+            if (std::string_view(name) == "state.json")
+                lastRun = UnixMilliseconds(modified);
+        }
+        json.EndArray();
+        json.Key("lastRunUnixMs");
+        if (lastRun >= 0)
+            json.Number(lastRun);
+        else
+            json.Null();
+        json.Key("runningPid");
+        WriteRunning(json, folder, false);
+        json.Key("runningElevatedPid");
+        WriteRunning(json, folder, true);
+        json.EndObject();
+    }
+    json.EndArray();
+    json.EndObject();
+    return 0;
+}
+
+/**
+ * Copies the settings and the state of a folder into a new copy, through the shared snapshot store.
+ */
+static int Duplicate(const Options& options, const fs::path& source, std::string name)
+{
+    if (name.empty())
+    {
+        char stamp[32];
+        const std::time_t now = std::time(nullptr);
+        std::tm local{};
+#if defined(_WIN32)
+        localtime_s(&local, &now);
+#else
+        localtime_r(&now, &local);
+#endif
+        std::strftime(stamp, sizeof(stamp), "LocalState_%Y%m%d_%H%M%S", &local);
+        name = stamp;
+    }
+    const fs::path target = CustomBase(options) / FromUtf8(name);
+
+    std::error_code ec;
+    if (!fs::is_directory(source, ec))
+        ec = std::make_error_code(std::errc::no_such_file_or_directory);
+    else if (fs::exists(target))
+        ec = std::make_error_code(std::errc::file_exists);
+    else
+    {
+        const fs::path root = options.data / "WTLayoutManager";
+        SnapshotStore store(root / "objects");
+        FileOperationEngine engine(&store, root / "trash");
+        const FileCopyJob job{ source, target };
+        engine.StartCopy(&job, 1, CopiedFiles, std::size(CopiedFiles), 1);
+        engine.Wait();
+        FileOperationCompletion completion{};
+        if (engine.TryTake(completion))
+            ec = completion.error;
+    }
+
+    JsonWriter json;
+    json.BeginObject();
+    json.Key("source");
+    json.Path(source);
+    json.Key("path");
+    json.Path(target);
+    json.Key("name");
+    json.String(name);
+    json.Key("error");
+    if (ec)
+        json.String(ec.message());
+    else
+        json.Null();
+    json.EndObject();
+    return ec ? 1 : 0;
+}
+
+/**
+ * Deletes copies; the default folder and folders a terminal runs are refused.
+ */
+static int Delete(const Options& options, const std::vector<fs::path>& folders)
+{
+    std::vector<std::string> errors(folders.size());
+    std::vector<fs::path> deleted;
+    std::vector<size_t> deletedIndex;
+    for (size_t i = 0; i < folders.size(); ++i)
+    {
+        RunningInstance instance{};
+        std::error_code ec;
+        if (IsDefault(options, folders[i]))
+            errors[i] = "the default LocalState folder cannot be deleted";
+        else if (!fs::is_directory(folders[i], ec))
+            errors[i] = std::make_error_code(std::errc::no_such_file_or_directory).message();
+        else if (InstanceRegistry::Find(ToWide(folders[i]), false, instance) || InstanceRegistry::Find(ToWide(folders[i]), true, instance))
+            errors[i] = "a terminal runs the folder";
+        else
+        {
+            deleted.push_back(folders[i]);
+            deletedIndex.push_back(i);
+        }
+    }
+
+    if (!deleted.empty())
+    {
+        const fs::path root = options.data / "WTLayoutManager";
+        SnapshotStore store(root / "objects");
+        FileOperationEngine engine(&store, root / "trash");
+        engine.StartDelete(deleted.data(), deleted.size());
+        engine.Wait();
+        FileOperationCompletion completion{};
+        while (engine.TryTake(completion))
+        {
+            if (completion.error)
+                errors[deletedIndex[completion.job]] = completion.error.message();
+        }
+    }
+
+    int status = 0;
+    JsonWriter json;
+    json.BeginObject();
+    json.Key("deleted");
+    json.BeginArray();
+    for (size_t i = 0; i < folders.size(); ++i)
+    {
+        json.BeginObject();
+        json.Key("path");
+        json.Path(folders[i]);
+        json.Key("error");
+        if (errors[i].empty())
+            json.Null();
+        else
+        {
+            json.String(errors[i]);
+            status = 1;
+        }
+        json.EndObject();
+    }
+    json.EndArray();
+    json.EndObject();
+    return status;
+}
+
+/**
+ * Pins or unpins copies, protecting them from pruning.
+ */
+static int Pin(const Options& options, const std::vector<fs::path>& folders, bool pinned)
+{
+    int status = 0;
+    JsonWriter json;
+    json.BeginObject();
+    json.Key(pinned ? "pinned" : "unpinned");
+    json.BeginArray();
+    for (const fs::path& folder : folders)
+    {
+        std::error_code ec;
+        if (IsDefault(options, folder))
+            ec = std::make_error_code(std::errc::operation_not_permitted);
+        else
+            SnapshotRetention::SetPinned(folder, pinned, ec);
+        json.BeginObject();
+        json.Key("path");
+        json.Path(folder);
+        json.Key("error");
+        if (ec)
+        {
+            json.String(ec.message());
+            status = 1;
+        }
+        else
+            json.Null();
+        json.EndObject();
+    }
+    json.EndArray();
+    json.EndObject();
+    return status;
+}
+
+static const char* ActionName(RetentionAction action)
+{
+    switch (action)
+    {
+    case RetentionAction::KeepPinned:
+        return "pinned";
+    case RetentionAction::KeepRunning:
+        return "running";
+    case RetentionAction::Evict:
+        return "evict";
+    default:
+        return "keep";
+    }
+}
+
+/**
+ * Applies the retention policy to the copies: the saved one, with the limits given on the command line
+ * instead. Prints the plan, then deletes the evicted copies unless this is a dry run.
+ */
+static int Prune(const Options& options, const RetentionPolicy& policy, bool dryRun)
+{
+    const RetentionReport report = SnapshotRetention::Plan(CustomBase(options), policy);
+    const std::vector<fs::path> evicted = dryRun ? std::vector<fs::path>() : SnapshotRetention::Evicted(report);
+    std::vector<std::string> errors(evicted.size());
+    if (!evicted.empty())
+    {
+        const fs::path root = options.data / "WTLayoutManager";
+        SnapshotStore store(root / "objects");
+        FileOperationEngine engine(&store, root / "trash");
+        engine.StartDelete(evicted.data(), evicted.size());
+        engine.Wait();
+        FileOperationCompletion completion{};
+        while (engine.TryTake(completion))
+        {
+            if (completion.error)
+                errors[completion.job] = completion.error.message();
+        }
+    }
+
+    int status = 0;
+    size_t next = evicted.size();   // evicted lists the copies least recently run first
+    JsonWriter json;
+    json.BeginObject();
+    json.Key("maxCount");
+    json.Number(policy.maxCount);
+    json.Key("maxBytes");
+    json.Number(static_cast<long long>(policy.maxBytes));
+    json.Key("dryRun");
+    json.Bool(dryRun);
+    json.Key("keptCount");
+    json.Number(report.keptCount);
+    json.Key("keptBytes");
+    json.Number(static_cast<long long>(report.keptBytes));
+    json.Key("evictedCount");
+    json.Number(report.evictedCount);
+    json.Key("evictedBytes");
+    json.Number(static_cast<long long>(report.evictedBytes));
+    json.Key("snapshots");
+    json.BeginArray();
+    for (const RetentionEntry& entry : report.entries)
+    {
+        json.BeginObject();
+        json.Key("path");
+        json.Path(entry.folder);
+        json.Key("lastRunUnixMs");
+        if (entry.hasLastRun)
+            json.Number(entry.lastRunUnixMs);
+        else
+            json.Null();
+        json.Key("bytes");
+        json.Number(static_cast<long long>(entry.bytes));
+        json.Key("action");
+        json.String(ActionName(entry.action));
+        if (entry.action == RetentionAction::Evict && !dryRun)
+        {
+            const std::string& error = errors[--next];
+            json.Key("error");
+            if (error.empty())
+                json.Null();
+            else
+            {
+                json.String(error);
+                status = 1;
+            }
+        }
+        json.EndObject();
+    }
+    json.EndArray();
+    json.EndObject();
+    return status;
+}
+
+/**
+ * Parses a non-negative decimal limit.
+ */
+static bool ParseLimit(const std::string& text, unsigned long long& value)
+{
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+    errno = 0;
+    value = std::strtoull(text.c_str(), nullptr, 10);
+    return errno == 0;
+}
+
+struct LaunchSettings
+{
+    fs::path terminal;
+    fs::path hook;
+    fs::path launcher;
+    bool elevated = false;
+    bool wait = false;
+};
+
+struct LaunchOutcome
+{
+    std::string status;         // "started", "exited", "running" or "failed"
+    uint32_t processId = 0;
+    uint32_t exitCode = 0;
+    WTLM_Status error = WTLM_OK;
+    WTLM_LaunchError detail{};
+};
+
+static WTLM_String View(const std::u16string& text)
+{
+    return WTLM_String{ reinterpret_cast<const uint16_t*>(text.data()), static_cast<uint32_t>(text.size()), 0 };
+}
+
+/**
+ * Launches the terminal of one folder through the flat launch API, as the app does, unless one runs it.
+ */
+static LaunchOutcome LaunchFolder(const Options& options, const LaunchSettings& settings, const fs::path& folder)
+{
+    LaunchOutcome outcome;
+    RunningInstance instance{};
+    if (InstanceRegistry::Find(ToWide(folder), settings.elevated, instance))
+    {
+        outcome.status = "running";
+        outcome.processId = instance.processId;
+        return outcome;
+    }
+
+    if (!IsDefault(options, folder))
+    {
+        // Windows Terminal rewrites its files in place; give it private copies of the shared ones.
+        std::error_code ec;
+        SnapshotStore(options.data / "WTLayoutManager" / "objects").Detach(folder, ec);
+        if (ec)
+        {
+            outcome.status = "failed";
+            outcome.error = WTLM_E_FAILED;
+            outcome.detail.systemError = static_cast<uint32_t>(ec.value());
+            std::snprintf(outcome.detail.event, sizeof(outcome.detail.event), "%s", "launch.detach");
+            return outcome;
+        }
+    }
+
+    const std::u16string application = settings.terminal.u16string();
+    const std::u16string commandLine = u"\"" + application + u"\"";
+    const std::u16string hook = settings.hook.u16string();
+    const std::u16string launcher = settings.launcher.u16string();
+    const std::u16string localState = folder.u16string();
+    std::u16string environment;
+    environment += u"WT_DEFAULT_LOCALSTATE=" + DefaultFolder(options).u16string() + u'\0';
+    environment += u"WT_REDIRECT_LOCALSTATE=" + localState + u'\0';
+    environment += u"WT_HOOK_DLL_PATH=" + hook + u'\0';
+
+    WTLM_LaunchRequest request{};
+    request.size = sizeof(request);
+    request.flags = settings.elevated ? WTLM_LAUNCH_ELEVATED : 0;
+    request.applicationPath = View(application);
+    request.commandLine = View(commandLine);
+    request.hookPath = View(hook);
+    request.environment = View(environment);
+    request.launcherPath = settings.elevated ? View(launcher) : WTLM_String{};
+    request.localStateFolder = View(localState);
+    request.priority = 2;   // normal
+
+    WTLM_Launch* launch = nullptr;
+    outcome.error = WTLM_StartLaunch(&request, &launch, &outcome.detail);
+    if (outcome.error != WTLM_OK)
+    {
+        outcome.status = "failed";
+        return outcome;
+    }
+    outcome.status = "started";
+    if (settings.wait)
+    {
+        outcome.error = WTLM_WaitLaunch(launch, WTLM_WAIT_INFINITE, &outcome.exitCode, &outcome.detail);
+        outcome.status = outcome.error == WTLM_OK ? "exited" : "failed";
+    }
+    outcome.processId = WTLM_GetLaunchProcessId(launch);
+    WTLM_CloseLaunch(launch);
+    return outcome;
+}
+
+/**
+ * Launches every folder at once; the shared launch scheduler bounds how many start together.
+ */
+static int Launch(const Options& options, const LaunchSettings& settings, const std::vector<fs::path>& folders)
+{
+    std::vector<LaunchOutcome> outcomes(folders.size());
+    std::vector<std::thread> threads;
+    threads.reserve(folders.size());
+    for (size_t i = 0; i < folders.size(); ++i)
+        threads.emplace_back([&, i]() { outcomes[i] = LaunchFolder(options, settings, folders[i]); });
+    for (std::thread& thread : threads)
+        thread.join();
+
+    int status = 0;
+    JsonWriter json;
+    json.BeginObject();
+    json.Key("launches");
+    json.BeginArray();
+    for (size_t i = 0; i < folders.size(); ++i)
+    {
+        const LaunchOutcome& outcome = outcomes[i];
+        json.BeginObject();
+        json.Key("path");
+        json.Path(folders[i]);
+        json.Key("status");
+        json.String(outcome.status);
+        json.Key("pid");
+        if (outcome.processId != 0)
+            json.Number(outcome.processId);
+        else
+            json.Null();
+        if (outcome.status == "exited")
+        {
+            json.Key("exitCode");
+            json.Number(outcome.exitCode);
+        }
+        if (outcome.status == "failed")
+        {
+            json.Key("error");
+            json.Number(outcome.error);
+            json.Key("event");
+            json.String(outcome.detail.event);
+            json.Key("systemError");
+            json.Number(outcome.detail.systemError);
+            status = 1;
+        }
+        json.EndObject();
+    }
+    json.EndArray();
+    json.EndObject();
+    return status;
+}
+
+/**
+ * Reads a batch file: one folder per line; blank lines and lines starting with # are skipped.
+ */
+static bool ReadBatch(const fs::path& file, std::vector<std::string>& folders)
+{
+    std::ifstream input(file, std::ios::binary);
+    if (!input)
+        return false;
+    std::string line;
+    bool first = true;
+    while (std::getline(input, line))
+    {
+        if (first && line.compare(0, 3, "\xEF\xBB\xBF") == 0)
+            line.erase(0, 3);
+        first = false;
+        const size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos || line[begin] == '#')
+            continue;
+        const size_t end = line.find_last_not_of(" \t\r");
+        folders.push_back(line.substr(begin, end - begin + 1));
+    }
+    return true;
+}
+
+/**
+ * Runs a command; the arguments are UTF-8.
+ *
+ * @return 0 on success, 1 if an operation failed, 2 on a usage error.
+ */
+static int Run(const fs::path& self, const std::vector<std::string>& args)
+{
+    Options options;
+    options.self = self;
+    options.data = LocalAppData();
+
+    size_t next = 0;
+    while (next + 1 < args.size() && (args[next] == "--family" || args[next] == "--data"))
+    {
+        if (args[next] == "--family")
+            options.family = args[next + 1];
+        else
+            options.data = FromUtf8(args[next + 1]);
+        next += 2;
+    }
+    if (next >= args.size() || options.data.empty())
+    {
+        std::fputs(Usage, stderr);
+        return 2;
+    }
+
+    const std::string command = args[next++];
+    std::vector<std::string> operands;
+    std::string name;
+    std::vector<std::string> batch;
+    LaunchSettings settings;
+    std::string maxCount;
+    std::string maxBytes;
+    bool save = false;
+    bool dryRun = false;
+    settings.hook = options.data / "WTLayoutManager" / "bin" / (sizeof(void*) == 8 ? "WTLocalStateHook64.dll" : "WTLocalStateHook32.dll");
+    settings.launcher = self.parent_path() / "ElevatedLauncher.exe";
+    for (; next < args.size(); ++next)
+    {
+        const std::string& arg = args[next];
+        const bool hasValue = next + 1 < args.size();
+        if (arg == "--elevated")
+            settings.elevated = true;
+        else if (arg == "--wait")
+            settings.wait = true;
+        else if (arg == "--save")
+            save = true;
+        else if (arg == "--dry-run")
+            dryRun = true;
+        else if (arg == "--max-count" && hasValue)
+            maxCount = args[++next];
+        else if (arg == "--max-bytes" && hasValue)
+            maxBytes = args[++next];
+        else if (arg == "--name" && hasValue)
+            name = args[++next];
+        else if (arg == "--terminal" && hasValue)
+            settings.terminal = FromUtf8(args[++next]);
+        else if (arg == "--hook" && hasValue)
+            settings.hook = FromUtf8(args[++next]);
+        else if (arg == "--launcher" && hasValue)
+            settings.launcher = FromUtf8(args[++next]);
+        else if (arg == "--batch" && hasValue)
+        {
+            if (!ReadBatch(FromUtf8(args[++next]), operands))
+            {
+                std::fprintf(stderr, "Cannot read the batch file %s.\n", args[next].c_str());
+                return 2;
+            }
+        }
+        else if (arg.compare(0, 2, "--") == 0)
+        {
+            std::fputs(Usage, stderr);
+            return 2;
+        }
+        else
+            operands.push_back(arg);
+    }
+
+    std::vector<fs::path> folders;
+    for (const std::string& operand : operands)
+        folders.push_back(Resolve(options, operand));
+
+    if (command == "list" && folders.empty())
+        return List(options);
+    if (command == "duplicate" && folders.size() == 1)
+        return Duplicate(options, folders[0], name);
+    if (command == "delete" && !folders.empty())
+        return Delete(options, folders);
+    if (command == "launch" && !folders.empty() && !settings.terminal.empty())
+        return Launch(options, settings, folders);
+    if ((command == "pin" || command == "unpin") && !folders.empty())
+        return Pin(options, folders, command == "pin");
+    if (command == "prune" && folders.empty())
+    {
+        RetentionPolicy policy = SnapshotRetention::LoadPolicy(CustomBase(options));
+        unsigned long long limit = 0;
+        if (!maxCount.empty())
+        {
+            if (!ParseLimit(maxCount, limit) || limit > UINT32_MAX)
+            {
+                std::fputs(Usage, stderr);
+                return 2;
+            }
+            policy.maxCount = static_cast<uint32_t>(limit);
+        }
+        if (!maxBytes.empty())
+        {
+            if (!ParseLimit(maxBytes, limit))
+            {
+                std::fputs(Usage, stderr);
+                return 2;
+            }
+            policy.maxBytes = limit;
+        }
+        std::error_code ec;
+        if (save && !SnapshotRetention::SavePolicy(CustomBase(options), policy, ec))
+        {
+            std::fprintf(stderr, "Cannot save the retention policy: %s\n", ec.message().c_str());
+            return 1;
+        }
+        return Prune(options, policy, dryRun);
+    }
+
+    std::fputs(Usage, stderr);
+    return 2;
+}
+
+/**
+ * Lists, duplicates, deletes, pins, prunes and launches Windows Terminal layouts without starting WTLayoutManager.
+ *
+ * Every command prints one JSON document to stdout. Folders are those of one terminal package, the
+ * stable Windows Terminal unless --family names another; there is no package discovery, so launch
+ * takes the path of wt.exe. Launches go through the flat launch API with the same environment the
+ * app uses, all at once and bounded by the shared launch scheduler; a folder whose terminal already
+ * runs is reported as running instead. Prune applies the retention policy the app applies after
+ * loading the copies. Only launch needs Windows.
+ *
+ * @return 0 on success, 1 if an operation failed, 2 on a usage error.
+ */
+#if defined(_WIN32)
+int wmain(int argc, wchar_t* argv[])
+{
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i)
+        args.push_back(ToUtf8(fs::path(argv[i])));
+    return Run(fs::absolute(argv[0]), args);
+}
+#else
+int main(int argc, char* argv[])
+{
+    return Run(fs::absolute(argv[0]), std::vector<std::string>(argv + 1, argv + argc));
+}
+#endif
@@ -0,0 +1,110 @@
+﻿#include "pch.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "RuntimeMetrics.h"
+
+using namespace WTLayoutManager::Services;
+
+/**
+ * Prints the counters and histograms of a snapshot.
+ *
+ * @param current The snapshot to print.
+ * @param previous The previous snapshot in watch mode, for the deltas; nullptr to print totals only.
+ */
+static void Print(const MetricsSnapshot& current, const MetricsSnapshot* previous)
+{
+    std::printf("%-30s %14s", "counter", "value");
+    if (previous)
+        std::printf(" %10s", "delta");
+    std::printf("\n");
+    for (size_t i = 0; i < MetricCounterCount; ++i)
+    {
+        std::printf("%-30s %14lld", RuntimeMetrics::CounterName(static_cast<MetricCounter>(i)),
+            static_cast<long long>(current.counters[i]));
+        if (previous)
+            std::printf(" %+10lld", static_cast<long long>(current.counters[i] - previous->counters[i]));
+        std::printf("\n");
+    }
+
+    std::printf("\n%-30s %10s %12s %12s %12s %12s", "histogram", "count", "mean_us", "p50_us", "p90_us", "p99_us");
+    if (previous)
+        std::printf(" %10s", "delta");
+    std::printf("\n");
+    for (size_t i = 0; i < MetricHistogramCount; ++i)
+    {
+        const MetricsSnapshot::Histogram& h = current.histograms[i];
+        const unsigned long long mean = h.count ? static_cast<unsigned long long>(h.sum / h.count) : 0;
+        std::printf("%-30s %10llu %12llu %12llu %12llu %12llu",
+            RuntimeMetrics::HistogramName(static_cast<MetricHistogram>(i)),
+            static_cast<unsigned long long>(h.count), mean,
+            static_cast<unsigned long long>(RuntimeMetrics::Quantile(h, 0.50)),
+            static_cast<unsigned long long>(RuntimeMetrics::Quantile(h, 0.90)),
+            static_cast<unsigned long long>(RuntimeMetrics::Quantile(h, 0.99)));
+        if (previous)
+            std::printf(" %+10lld", static_cast<long long>(h.count - previous->histograms[i].count));
+        std::printf("\n");
+    }
+    std::fflush(stdout);
+}
+
+/**
+ * Prints the runtime metrics that WTLayoutManager, its launchers and its native helpers publish in the
+ * shared metrics page.
+ *
+ * Usage: MetricsReader [--watch <milliseconds>]
+ *
+ * Without arguments the page is printed once. With --watch it is printed every interval, with the change of
+ * every counter since the previous print, until the reader is stopped; the reader waits for the page if no
+ * process has published it yet. Quantiles are the upper bounds of power-of-two buckets.
+ *
+ * @return 0 on success, 1 if the page does not exist, 2 on a usage error.
+ */
+int main(int argc, char* argv[])
+{
+    long intervalMs = 0;
+    if (argc == 3 && std::strcmp(argv[1], "--watch") == 0)
+    {
+        char* end = nullptr;
+        intervalMs = std::strtol(argv[2], &end, 10);
+        if (end == argv[2] || *end != '\0' || intervalMs <= 0)
+            intervalMs = -1;
+    }
+    if (argc != 1 && intervalMs <= 0)
+    {
+        std::fprintf(stderr, "Usage: MetricsReader [--watch <milliseconds>]\n");
+        return 2;
+    }
+
+    MetricsReader reader;
+    if (intervalMs == 0)
+    {
+        MetricsSnapshot snapshot{};
+        if (!reader.Open() || !reader.Read(snapshot))
+        {
+            std::fprintf(stderr, "No process has published runtime metrics yet.\n");
+            return 1;
+        }
+        Print(snapshot, nullptr);
+        return 0;
+    }
+
+    const auto interval = std::chrono::milliseconds(intervalMs);
+    while (!reader.Open())
+        std::this_thread::sleep_for(interval);
+
+    MetricsSnapshot previous{};
+    MetricsSnapshot current{};
+    reader.Read(previous);
+    Print(previous, nullptr);
+    for (;;)
+    {
+        std::this_thread::sleep_for(interval);
+        reader.Read(current);
+        std::printf("\n");
+        Print(current, &previous);
+        previous = current;
+    }
+}
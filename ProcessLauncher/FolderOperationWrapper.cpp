@@ -0,0 +1,219 @@
+﻿#include "pch.h"
+#include "new.h"
+#include "FileOperationEngine.h"
+#include "SnapshotStore.h"
+#include "FolderOperationWrapper.h"
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <vcclr.h>
+#include <msclr/marshal_cppstd.h>
+
+using namespace msclr::interop;
+using namespace System::Collections::Generic;
+using namespace WTLayoutManager::Services;
+
+static std::filesystem::path ToPath(System::String^ s, const wchar_t* name)
+{
+	if (s == nullptr)
+	{
+		throw gcnew System::ArgumentNullException(gcnew System::String(name));
+	}
+	return std::filesystem::path(marshal_as<std::wstring>(s));
+}
+
+/**
+ * Creates the managed exception for a folder that failed.
+ *
+ * @param deleting true for a delete, false for a copy.
+ * @param path The folder concerned.
+ * @param ec The error.
+ */
+static System::Exception^ ToException(bool deleting, System::String^ path, const std::error_code& ec)
+{
+	if (ec == std::errc::operation_canceled)
+	{
+		return gcnew System::OperationCanceledException();
+	}
+	return gcnew System::IO::IOException(System::String::Format(L"{0} '{1}': {2}",
+		deleting ? L"Failed to delete" : L"Failed to copy", path, gcnew System::String(ec.message().c_str())));
+}
+
+FolderOperation::FolderOperation(LocalStateStore^ store, System::String^ trashDirectory, array<System::String^>^ paths, bool deleting)
+	: m_engine(nullptr), m_store(store), m_paths(paths), m_deleting(deleting), m_drained(false)
+{
+	const SnapshotStore* native = store != nullptr ? static_cast<const SnapshotStore*>(store->NativeStore) : nullptr;
+	m_engine = new FileOperationEngine(native, ToPath(trashDirectory, L"trashDirectory"));
+}
+
+void FolderOperation::Register(System::Threading::CancellationToken cancellationToken)
+{
+	m_registration = cancellationToken.Register(gcnew System::Action(this, &FolderOperation::Cancel));
+}
+
+/**
+ * Starts copying folders.
+ *
+ * @param store The store the files are placed through; null for plain copies.
+ * @param trashDirectory Where folders left by failed copies are moved before being deleted.
+ * @param folders Pairs of (source folder, target folder).
+ * @param fileNames The file names to copy; null copies every file.
+ * @param cancellationToken Cancels the operation when signalled.
+ * @return The running operation; dispose it to cancel and wait for the copy threads.
+ */
+FolderOperation^ FolderOperation::StartCopy(
+	LocalStateStore^ store,
+	System::String^ trashDirectory,
+	IEnumerable<KeyValuePair<System::String^, System::String^>>^ folders,
+	IEnumerable<System::String^>^ fileNames,
+	System::Threading::CancellationToken cancellationToken)
+{
+	if (folders == nullptr)
+	{
+		throw gcnew System::ArgumentNullException(L"folders");
+	}
+
+	List<System::String^>^ paths = gcnew List<System::String^>();
+	std::vector<FileCopyJob> jobs;
+	for each (KeyValuePair<System::String^, System::String^> folder in folders)
+	{
+		jobs.push_back(FileCopyJob{ ToPath(folder.Key, L"folders"), ToPath(folder.Value, L"folders") });
+		paths->Add(folder.Key);
+	}
+
+	std::vector<std::u16string> names;
+	if (fileNames != nullptr)
+	{
+		for each (System::String^ name in fileNames)
+		{
+			pin_ptr<const wchar_t> chars = PtrToStringChars(name);
+			names.emplace_back(reinterpret_cast<const char16_t*>(chars), name->Length);
+		}
+	}
+	std::vector<std::u16string_view> views(names.begin(), names.end());
+
+	FolderOperation^ operation = gcnew FolderOperation(store, trashDirectory, paths->ToArray(), false);
+	if (!static_cast<FileOperationEngine*>(operation->m_engine)->StartCopy(
+		jobs.data(), jobs.size(), fileNames != nullptr ? views.data() : nullptr, views.size()))
+	{
+		delete operation;
+		throw gcnew System::Exception(L"Failed to start the folder copy.");
+	}
+	operation->Register(cancellationToken);
+	return operation;
+}
+
+/**
+ * Starts deleting folders.
+ *
+ * @param store The store whose shared files the folders may link to; null for plain deletes.
+ * @param trashDirectory Where the folders are moved before being deleted; on the same volume as the folders.
+ * @param folders The folders.
+ * @param cancellationToken Cancels the operation when signalled.
+ * @return The running operation; dispose it to cancel and wait for the delete threads.
+ */
+FolderOperation^ FolderOperation::StartDelete(
+	LocalStateStore^ store,
+	System::String^ trashDirectory,
+	IEnumerable<System::String^>^ folders,
+	System::Threading::CancellationToken cancellationToken)
+{
+	if (folders == nullptr)
+	{
+		throw gcnew System::ArgumentNullException(L"folders");
+	}
+
+	array<System::String^>^ paths = (gcnew List<System::String^>(folders))->ToArray();
+	std::vector<std::filesystem::path> natives;
+	for each (System::String^ path in paths)
+	{
+		natives.push_back(ToPath(path, L"folders"));
+	}
+
+	FolderOperation^ operation = gcnew FolderOperation(store, trashDirectory, paths, true);
+	if (!static_cast<FileOperationEngine*>(operation->m_engine)->StartDelete(natives.data(), natives.size()))
+	{
+		delete operation;
+		throw gcnew System::Exception(L"Failed to start the folder delete.");
+	}
+	operation->Register(cancellationToken);
+	return operation;
+}
+
+/**
+ * Takes finished folders from the completion queue.
+ *
+ * @param maxCount Maximum number of results to take.
+ * @return The results; empty if none is ready.
+ */
+List<FolderOperationResult^>^ FolderOperation::Drain(int maxCount)
+{
+	List<FolderOperationResult^>^ results = gcnew List<FolderOperationResult^>();
+	FileOperationEngine* engine = static_cast<FileOperationEngine*>(m_engine);
+	if (engine == nullptr)
+	{
+		return results;
+	}
+
+	// Read the finished flag first: once it is set, everything pushed before it is visible.
+	const bool finished = engine->IsFinished();
+	FileOperationCompletion completion;
+	while (results->Count < maxCount && engine->TryTake(completion))
+	{
+		FolderOperationResult^ result = gcnew FolderOperationResult();
+		result->Index = static_cast<int>(completion.job);
+		result->Path = m_paths[result->Index];
+		if (completion.error)
+		{
+			result->Error = ToException(m_deleting, result->Path, completion.error);
+		}
+		results->Add(result);
+	}
+	if (finished && results->Count < maxCount)
+	{
+		m_drained = true;
+	}
+	return results;
+}
+
+FolderOperationProgress FolderOperation::Progress::get()
+{
+	FolderOperationProgress progress;
+	if (m_engine != nullptr)
+	{
+		const FileOperationProgress native = static_cast<FileOperationEngine*>(m_engine)->Progress();
+		progress.FoldersTotal = static_cast<int>(native.jobsTotal);
+		progress.FoldersDone = static_cast<int>(native.jobsDone);
+		progress.FoldersFailed = static_cast<int>(native.jobsFailed);
+		progress.FilesDone = static_cast<long long>(native.filesDone);
+		progress.BytesDone = static_cast<long long>(native.bytesDone);
+	}
+	return progress;
+}
+
+bool FolderOperation::IsCompleted::get()
+{
+	return m_drained || m_engine == nullptr;
+}
+
+void FolderOperation::Cancel()
+{
+	if (m_engine != nullptr)
+	{
+		static_cast<FileOperationEngine*>(m_engine)->Cancel();
+	}
+}
+
+FolderOperation::~FolderOperation()
+{
+	safe_cast<System::IDisposable^>(m_registration)->Dispose();
+	this->!FolderOperation();
+}
+
+FolderOperation::!FolderOperation()
+{
+	// Cancels and joins the engine's threads.
+	delete static_cast<FileOperationEngine*>(m_engine);
+	m_engine = nullptr;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "SnapshotStoreWrapper.h"
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// The outcome of one folder of a bulk operation.
+    /// </summary>
+    public ref class FolderOperationResult
+    {
+    public:
+        /// <summary>
+        /// Position of the folder in the list passed to StartCopy or StartDelete.
+        /// </summary>
+        property int Index;
+
+        /// <summary>
+        /// The folder copied or deleted.
+        /// </summary>
+        property System::String^ Path;
+
+        /// <summary>
+        /// Null on success; an OperationCanceledException if the operation was cancelled while the folder was being copied.
+        /// </summary>
+        property System::Exception^ Error;
+    };
+
+    /// <summary>
+    /// Counters of a running bulk operation.
+    /// </summary>
+    public value struct FolderOperationProgress
+    {
+        property int FoldersTotal;
+        property int FoldersDone;
+        property int FoldersFailed;
+        property long long FilesDone;
+        property long long BytesDone;
+    };
+
+    /// <summary>
+    /// Copies or deletes LocalState folders on native background threads. A copy removes what it created if it fails;
+    /// a delete renames the folder into the trash directory before deleting it, so a locked folder is left intact.
+    /// Results are drained by one consumer, typically the UI thread.
+    /// </summary>
+    public ref class FolderOperation sealed
+    {
+    public:
+        /// <summary>
+        /// Starts copying folders, given as (source, target) pairs, through the store. Only the named files are copied.
+        /// </summary>
+        static FolderOperation^ StartCopy(
+            LocalStateStore^ store,
+            System::String^ trashDirectory,
+            System::Collections::Generic::IEnumerable<System::Collections::Generic::KeyValuePair<System::String^, System::String^>>^ folders,
+            System::Collections::Generic::IEnumerable<System::String^>^ fileNames,
+            System::Threading::CancellationToken cancellationToken);
+
+        /// <summary>
+        /// Starts deleting folders, then collects the store's unused files.
+        /// </summary>
+        static FolderOperation^ StartDelete(
+            LocalStateStore^ store,
+            System::String^ trashDirectory,
+            System::Collections::Generic::IEnumerable<System::String^>^ folders,
+            System::Threading::CancellationToken cancellationToken);
+
+        /// <summary>
+        /// Takes up to maxCount finished folders, in completion order.
+        /// </summary>
+        System::Collections::Generic::List<FolderOperationResult^>^ Drain(int maxCount);
+
+        /// <summary>
+        /// Reads the counters.
+        /// </summary>
+        property FolderOperationProgress Progress { FolderOperationProgress get(); }
+
+        /// <summary>
+        /// True once every folder has finished (or the operation was cancelled) and every result was drained.
+        /// </summary>
+        property bool IsCompleted { bool get(); }
+
+        /// <summary>
+        /// Stops starting folders and interrupts running copies.
+        /// </summary>
+        void Cancel();
+
+        ~FolderOperation();
+        !FolderOperation();
+
+    private:
+        FolderOperation(LocalStateStore^ store, System::String^ trashDirectory, array<System::String^>^ paths, bool deleting);
+        void Register(System::Threading::CancellationToken cancellationToken);
+
+        void* m_engine;
+        LocalStateStore^ m_store;
+        array<System::String^>^ m_paths;
+        bool m_deleting;
+        System::Threading::CancellationTokenRegistration m_registration;
+        bool m_drained;
+    };
+}
@@ -0,0 +1,227 @@
+﻿#include "pch.h"
+#include "new.h"
+#include "FolderScanner.h"
+#include "FolderScanWrapper.h"
+#include <filesystem>
+#include <string>
+#include <vcclr.h>
+#include <msclr/marshal_cppstd.h>
+
+using namespace msclr::interop;
+using namespace System::Collections::Generic;
+using namespace System::Runtime::InteropServices;
+using namespace WTLayoutManager::Services;
+
+/**
+ * Native state shared with the scanner threads: the folders and the managed work delegate.
+ */
+struct FolderScanContext
+{
+	gcroot<array<ScannedFolder^>^> folders;
+	gcroot<System::Func<ScannedFolder^, System::Object^>^> work;
+};
+
+/**
+ * Runs the managed work for one folder on a scanner thread.
+ *
+ * Exceptions are captured in the result instead of escaping into the native thread.
+ *
+ * @param context The FolderScanContext.
+ * @param index Index of the folder.
+ * @return A GCHandle to the FolderScanResult.
+ */
+static void* RunFolderWork(void* context, size_t index)
+{
+	FolderScanContext* scan = static_cast<FolderScanContext*>(context);
+	FolderScanResult^ result = gcnew FolderScanResult();
+	array<ScannedFolder^>^ folders = scan->folders;
+	result->Folder = folders[static_cast<int>(index)];
+	try
+	{
+		result->Value = scan->work->Invoke(result->Folder);
+	}
+	catch (System::Exception^ e)
+	{
+		result->Error = e;
+	}
+	return GCHandle::ToIntPtr(GCHandle::Alloc(result)).ToPointer();
+}
+
+/**
+ * Takes ownership of a result handle produced by RunFolderWork.
+ */
+static FolderScanResult^ TakeResult(void* handle)
+{
+	GCHandle gc = GCHandle::FromIntPtr(System::IntPtr(handle));
+	FolderScanResult^ result = safe_cast<FolderScanResult^>(gc.Target);
+	gc.Free();
+	return result;
+}
+
+/**
+ * Lists the immediate subfolders of a folder.
+ *
+ * @param folderPath The folder to list.
+ * @return The subfolder paths.
+ */
+List<System::String^>^ FolderScan::EnumerateSubfolders(System::String^ folderPath)
+{
+	List<System::String^>^ paths = gcnew List<System::String^>();
+	if (folderPath == nullptr)
+	{
+		return paths;
+	}
+	for (const std::filesystem::path& path : FolderScanner::EnumerateSubfolders(std::filesystem::path(marshal_as<std::wstring>(folderPath))))
+	{
+		paths->Add(gcnew System::String(path.c_str()));
+	}
+	return paths;
+}
+
+FolderScan::FolderScan(array<ScannedFolder^>^ folders, System::Func<ScannedFolder^, System::Object^>^ work)
+	: m_scanner(new FolderScanner()), m_context(new FolderScanContext()), m_drained(false)
+{
+	FolderScanContext* context = static_cast<FolderScanContext*>(m_context);
+	context->folders = folders;
+	context->work = work;
+}
+
+/**
+ * Starts the scan.
+ *
+ * @param folders The folders; their Index is set to their position.
+ * @param work Called once per folder on a scanner thread.
+ * @param cancellationToken Cancels the scan when signalled.
+ * @return The running scan; dispose it to cancel and wait for the scanner threads.
+ */
+FolderScan^ FolderScan::Start(
+	IEnumerable<ScannedFolder^>^ folders,
+	System::Func<ScannedFolder^, System::Object^>^ work,
+	System::Threading::CancellationToken cancellationToken)
+{
+	if (folders == nullptr || work == nullptr)
+	{
+		throw gcnew System::ArgumentNullException(folders == nullptr ? L"folders" : L"work");
+	}
+
+	array<ScannedFolder^>^ list = (gcnew List<ScannedFolder^>(folders))->ToArray();
+	for (int i = 0; i < list->Length; ++i)
+	{
+		list[i]->Index = i;
+	}
+
+	FolderScan^ scan = gcnew FolderScan(list, work);
+	if (!static_cast<FolderScanner*>(scan->m_scanner)->Start(static_cast<size_t>(list->Length), &RunFolderWork, scan->m_context))
+	{
+		delete scan;
+		throw gcnew System::Exception(L"Failed to start the folder scan.");
+	}
+	scan->m_registration = cancellationToken.Register(gcnew System::Action(scan, &FolderScan::Cancel));
+	return scan;
+}
+
+/**
+ * Takes finished folders from the completion queue.
+ *
+ * @param maxCount Maximum number of results to take.
+ * @return The results; empty if none is ready.
+ */
+List<FolderScanResult^>^ FolderScan::Drain(int maxCount)
+{
+	List<FolderScanResult^>^ results = gcnew List<FolderScanResult^>();
+	FolderScanner* scanner = static_cast<FolderScanner*>(m_scanner);
+	if (scanner == nullptr)
+	{
+		return results;
+	}
+
+	// Read the finished flag first: once it is set, everything pushed before it is visible.
+	const bool finished = scanner->IsFinished();
+	FolderScanCompletion completion;
+	while (results->Count < maxCount && scanner->TryTake(completion))
+	{
+		results->Add(TakeResult(completion.result));
+	}
+	if (finished && results->Count < maxCount)
+	{
+		m_drained = true;
+	}
+	return results;
+}
+
+bool FolderScan::IsCompleted::get()
+{
+	return m_drained || m_scanner == nullptr;
+}
+
+void FolderScan::Cancel()
+{
+	if (m_scanner != nullptr)
+	{
+		static_cast<FolderScanner*>(m_scanner)->Cancel();
+	}
+}
+
+/**
+ * Cancels the scanner, waits for its threads, releases the handles of results that were never
+ * drained and frees the native state.
+ *
+ * The threads run managed work, so this must not run on the finalizer thread.
+ */
+static void ReleaseScanner(FolderScanner* scanner, FolderScanContext* context)
+{
+	if (scanner != nullptr)
+	{
+		scanner->Cancel();
+		scanner->Wait();
+		FolderScanCompletion completion;
+		while (scanner->TryTake(completion))
+		{
+			GCHandle::FromIntPtr(System::IntPtr(completion.result)).Free();
+		}
+		delete scanner;
+	}
+	delete context;
+}
+
+/**
+ * Releases the native state of a finalized scan on a thread pool thread.
+ *
+ * @param state The scanner and the context, as an array of two IntPtr.
+ */
+void FolderScan::ReleaseDetached(System::Object^ state)
+{
+	array<System::IntPtr>^ native = safe_cast<array<System::IntPtr>^>(state);
+	ReleaseScanner(static_cast<FolderScanner*>(native[0].ToPointer()), static_cast<FolderScanContext*>(native[1].ToPointer()));
+}
+
+/**
+ * Cancels the scan and waits for the scanner threads.
+ */
+FolderScan::~FolderScan()
+{
+	safe_cast<System::IDisposable^>(m_registration)->Dispose();
+	ReleaseScanner(static_cast<FolderScanner*>(m_scanner), static_cast<FolderScanContext*>(m_context));
+	m_scanner = nullptr;
+	m_context = nullptr;
+}
+
+/**
+ * Only cancels the scan: joining threads that call back into managed code could stall finalization.
+ * The threads are waited for and the native state freed on the thread pool.
+ */
+FolderScan::!FolderScan()
+{
+	if (m_scanner == nullptr && m_context == nullptr)
+	{
+		return;
+	}
+	if (m_scanner != nullptr)
+	{
+		static_cast<FolderScanner*>(m_scanner)->Cancel();
+	}
+	System::Threading::ThreadPool::QueueUserWorkItem(gcnew System::Threading::WaitCallback(&FolderScan::ReleaseDetached),
+		gcnew array<System::IntPtr>{ System::IntPtr(m_scanner), System::IntPtr(m_context) });
+	m_scanner = nullptr;
+	m_context = nullptr;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// A LocalState folder queued for scanning.
+    /// </summary>
+    public ref class ScannedFolder
+    {
+    public:
+        property System::String^ Path;
+        property System::String^ Name;
+        property bool IsDefault;
+
+        /// <summary>
+        /// Position of the folder in the list passed to FolderScan::Start.
+        /// </summary>
+        property int Index;
+    };
+
+    /// <summary>
+    /// The outcome of the work run for one folder: its return value, or the exception it threw.
+    /// </summary>
+    public ref class FolderScanResult
+    {
+    public:
+        property ScannedFolder^ Folder;
+        property System::Object^ Value;
+        property System::Exception^ Error;
+    };
+
+    /// <summary>
+    /// Runs per-folder work on the native work-stealing scanner and streams the results back.
+    /// The work delegate runs on scanner threads and must not block on the UI thread.
+    /// Results are drained by one consumer, typically a dispatcher timer on the UI thread.
+    /// Dispose the scan to cancel it and wait for the scanner threads; a finalized scan is only cancelled.
+    /// </summary>
+    public ref class FolderScan sealed
+    {
+    public:
+        /// <summary>
+        /// Lists the immediate subfolders of a folder; empty if it does not exist.
+        /// </summary>
+        static System::Collections::Generic::List<System::String^>^ EnumerateSubfolders(System::String^ folderPath);
+
+        /// <summary>
+        /// Starts running work for every folder. Cancelling the token stops folders that have not started yet.
+        /// </summary>
+        static FolderScan^ Start(
+            System::Collections::Generic::IEnumerable<ScannedFolder^>^ folders,
+            System::Func<ScannedFolder^, System::Object^>^ work,
+            System::Threading::CancellationToken cancellationToken);
+
+        /// <summary>
+        /// Takes up to maxCount finished folders, in completion order.
+        /// </summary>
+        System::Collections::Generic::List<FolderScanResult^>^ Drain(int maxCount);
+
+        /// <summary>
+        /// True once every folder has finished (or the scan was cancelled) and every result was drained.
+        /// </summary>
+        property bool IsCompleted { bool get(); }
+
+        /// <summary>
+        /// Stops handing out folders that have not started yet.
+        /// </summary>
+        void Cancel();
+
+        ~FolderScan();
+        !FolderScan();
+
+    private:
+        FolderScan(array<ScannedFolder^>^ folders, System::Func<ScannedFolder^, System::Object^>^ work);
+        static void ReleaseDetached(System::Object^ state);
+
+        void* m_scanner;
+        void* m_context;
+        System::Threading::CancellationTokenRegistration m_registration;
+        bool m_drained;
+    };
+}
@@ -0,0 +1,107 @@
+﻿#include "pch.h"
+#include "new.h"
+#include "SearchIndex.h"
+#include "FolderSearchWrapper.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <vcclr.h>
+
+using namespace System::Collections::Generic;
+using namespace WTLayoutManager::Services;
+
+/**
+ * Copies a managed string into a UTF-16 string; null yields an empty string.
+ */
+static std::u16string ToUtf16(System::String^ s)
+{
+	if (s == nullptr)
+	{
+		return std::u16string();
+	}
+	pin_ptr<const wchar_t> chars = PtrToStringChars(s);
+	return std::u16string(reinterpret_cast<const char16_t*>(chars), s->Length);
+}
+
+FolderSearchIndex::FolderSearchIndex()
+	: m_index(new SearchIndex())
+{
+}
+
+/**
+ * Indexes the text of a folder.
+ *
+ * @param id The folder id.
+ * @param texts The pieces of text; null strings are skipped.
+ */
+void FolderSearchIndex::Upsert(int id, IEnumerable<KeyValuePair<FolderSearchField, System::String^>>^ texts)
+{
+	if (texts == nullptr)
+	{
+		throw gcnew System::ArgumentNullException(L"texts");
+	}
+
+	std::vector<std::u16string> storage;
+	std::vector<SearchField> fields;
+	for each (KeyValuePair<FolderSearchField, System::String^> text in texts)
+	{
+		if (!System::String::IsNullOrEmpty(text.Value))
+		{
+			storage.push_back(ToUtf16(text.Value));
+			fields.push_back(static_cast<SearchField>(text.Key));
+		}
+	}
+
+	std::vector<SearchText> pieces;
+	pieces.reserve(storage.size());
+	for (size_t i = 0; i < storage.size(); ++i)
+	{
+		pieces.push_back(SearchText{ fields[i], storage[i] });
+	}
+	static_cast<SearchIndex*>(m_index)->Upsert(static_cast<uint32_t>(id), pieces.data(), pieces.size());
+}
+
+bool FolderSearchIndex::Remove(int id)
+{
+	return static_cast<SearchIndex*>(m_index)->Remove(static_cast<uint32_t>(id));
+}
+
+void FolderSearchIndex::Clear()
+{
+	static_cast<SearchIndex*>(m_index)->Clear();
+}
+
+int FolderSearchIndex::Count::get()
+{
+	return static_cast<int>(static_cast<SearchIndex*>(m_index)->Size());
+}
+
+/**
+ * Runs a query against the index.
+ *
+ * @param query The search text.
+ * @return The matching folder ids, best first; empty for a blank query.
+ */
+List<int>^ FolderSearchIndex::Query(System::String^ query)
+{
+	std::vector<SearchHit> hits;
+	static_cast<SearchIndex*>(m_index)->Query(ToUtf16(query), hits);
+
+	List<int>^ ids = gcnew List<int>(static_cast<int>(hits.size()));
+	for (const SearchHit& hit : hits)
+	{
+		ids->Add(static_cast<int>(hit.id));
+	}
+	return ids;
+}
+
+FolderSearchIndex::~FolderSearchIndex()
+{
+	this->!FolderSearchIndex();
+}
+
+FolderSearchIndex::!FolderSearchIndex()
+{
+	delete static_cast<SearchIndex*>(m_index);
+	m_index = nullptr;
+}
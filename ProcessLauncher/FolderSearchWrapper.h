@@ -0,0 +1,57 @@
+#pragma once
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// The part of a snapshot a piece of searchable text comes from; earlier fields rank higher.
+    /// </summary>
+    public enum class FolderSearchField
+    {
+        FolderName,
+        TabTitle,
+        ProfileName,
+        StartingDirectory,
+        Commandline
+    };
+
+    /// <summary>
+    /// Incremental native n-gram index over the searchable text of the listed folders.
+    /// Folders are identified by caller-chosen ids; queries return the matching ids, best first.
+    /// Not thread-safe: use it from the UI thread only.
+    /// </summary>
+    public ref class FolderSearchIndex sealed
+    {
+    public:
+        FolderSearchIndex();
+
+        /// <summary>
+        /// Adds a folder, or replaces the text of one that is already indexed.
+        /// </summary>
+        void Upsert(
+            int id,
+            System::Collections::Generic::IEnumerable<System::Collections::Generic::KeyValuePair<FolderSearchField, System::String^>>^ texts);
+
+        /// <summary>
+        /// Removes a folder; returns false if it was not indexed.
+        /// </summary>
+        bool Remove(int id);
+
+        /// <summary>
+        /// Removes every folder.
+        /// </summary>
+        void Clear();
+
+        property int Count { int get(); }
+
+        /// <summary>
+        /// Returns the ids of the folders matching every whitespace separated term of the query (case-insensitive
+        /// substring match), ranked by field and match position.
+        /// </summary>
+        System::Collections::Generic::List<int>^ Query(System::String^ query);
+
+        ~FolderSearchIndex();
+        !FolderSearchIndex();
+
+    private:
+        void* m_index;
+    };
+}
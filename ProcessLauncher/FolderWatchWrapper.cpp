@@ -0,0 +1,86 @@
+﻿#include "pch.h"
+#include "new.h"
+#include "FolderWatcher.h"
+#include "LayoutCache.h"
+#include "FolderWatchWrapper.h"
+#include <filesystem>
+#include <string>
+#include <msclr/marshal_cppstd.h>
+
+using namespace msclr::interop;
+using namespace System::Collections::Generic;
+using namespace WTLayoutManager::Services;
+
+FolderWatch::FolderWatch()
+	: m_watcher(new FolderWatcher())
+{
+}
+
+/**
+ * Starts watching the LocalState folders.
+ *
+ * @param defaultFolderPath The default LocalState folder.
+ * @param customBasePath The folder holding the LocalState copies; it may not exist yet.
+ * @return The running watcher; dispose it to stop watching.
+ */
+FolderWatch^ FolderWatch::Start(System::String^ defaultFolderPath, System::String^ customBasePath)
+{
+	if (defaultFolderPath == nullptr || customBasePath == nullptr)
+	{
+		throw gcnew System::ArgumentNullException(defaultFolderPath == nullptr ? L"defaultFolderPath" : L"customBasePath");
+	}
+
+	FolderWatch^ watch = gcnew FolderWatch();
+	if (!static_cast<FolderWatcher*>(watch->m_watcher)->Start(
+		std::filesystem::path(marshal_as<std::wstring>(defaultFolderPath)),
+		std::filesystem::path(marshal_as<std::wstring>(customBasePath))))
+	{
+		delete watch;
+		throw gcnew System::Exception(L"Failed to start the folder watcher.");
+	}
+	return watch;
+}
+
+/**
+ * Takes the published deltas.
+ *
+ * @return The deltas; empty if nothing changed.
+ */
+List<FolderDelta^>^ FolderWatch::Drain()
+{
+	List<FolderDelta^>^ deltas = gcnew List<FolderDelta^>();
+	FolderWatcher* watcher = static_cast<FolderWatcher*>(m_watcher);
+	if (watcher == nullptr)
+	{
+		return deltas;
+	}
+
+	FolderChange change;
+	while (watcher->TryTake(change))
+	{
+		FolderDelta^ delta = gcnew FolderDelta();
+		delta->Kind = static_cast<FolderDeltaKind>(change.kind);
+		delta->FolderPath = change.folder.empty() ? nullptr : gcnew System::String(change.folder.c_str());
+		delta->ChangedFiles = gcnew List<System::String^>();
+		for (size_t i = 0; i < LayoutCacheSourceCount; ++i)
+		{
+			if (change.sources & (1u << i))
+			{
+				delta->ChangedFiles->Add(gcnew System::String(LayoutCache::SourceNames[i]));
+			}
+		}
+		deltas->Add(delta);
+	}
+	return deltas;
+}
+
+FolderWatch::~FolderWatch()
+{
+	this->!FolderWatch();
+}
+
+FolderWatch::!FolderWatch()
+{
+	delete static_cast<FolderWatcher*>(m_watcher);
+	m_watcher = nullptr;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// What happened to a LocalState folder.
+    /// </summary>
+    public enum class FolderDeltaKind
+    {
+        Added,
+        Removed,
+        Changed,
+        Rescan
+    };
+
+    /// <summary>
+    /// One coalesced change reported by FolderWatch.
+    /// </summary>
+    public ref class FolderDelta
+    {
+    public:
+        property FolderDeltaKind Kind;
+
+        /// <summary>
+        /// The folder; null for Rescan.
+        /// </summary>
+        property System::String^ FolderPath;
+
+        /// <summary>
+        /// Changed: the names of the source files that were written (settings.json, state.json, elevated-state.json).
+        /// </summary>
+        property System::Collections::Generic::List<System::String^>^ ChangedFiles;
+    };
+
+    /// <summary>
+    /// Watches the default LocalState folder and the LocalState copies under the custom base folder,
+    /// and reports coalesced, stable per-folder changes. Deltas are drained by one consumer.
+    /// </summary>
+    public ref class FolderWatch sealed
+    {
+    public:
+        /// <summary>
+        /// Starts watching. Throws if the watcher thread cannot be started.
+        /// </summary>
+        static FolderWatch^ Start(System::String^ defaultFolderPath, System::String^ customBasePath);
+
+        /// <summary>
+        /// Takes every delta published so far, in publication order.
+        /// </summary>
+        System::Collections::Generic::List<FolderDelta^>^ Drain();
+
+        ~FolderWatch();
+        !FolderWatch();
+
+    private:
+        FolderWatch();
+
+        void* m_watcher;
+    };
+}
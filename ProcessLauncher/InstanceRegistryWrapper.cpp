@@ -0,0 +1,43 @@
+﻿#include "pch.h"
+#include "new.h"
+#include "WinApiHelpers.h"
+#include "InstanceRegistry.h"
+#include "InstanceRegistryWrapper.h"
+#include <string>
+#include <msclr/marshal_cppstd.h>
+
+using namespace msclr::interop;
+using namespace WTLayoutManager::Services;
+
+bool RunningTerminals::IsRunning(System::String^ folder, bool elevated)
+{
+	if (folder == nullptr)
+	{
+		throw gcnew System::ArgumentNullException(L"folder");
+	}
+	RunningInstance instance;
+	return InstanceRegistry::Find(marshal_as<std::wstring>(folder), elevated, instance);
+}
+
+/**
+ * Focuses the terminal registered for a folder.
+ *
+ * @param folder The LocalState folder.
+ * @param elevated Whether to look for the elevated terminal.
+ * @return true if its window is now in the foreground.
+ */
+bool RunningTerminals::Focus(System::String^ folder, bool elevated)
+{
+	if (folder == nullptr)
+	{
+		throw gcnew System::ArgumentNullException(L"folder");
+	}
+	RunningInstance instance;
+	return InstanceRegistry::Find(marshal_as<std::wstring>(folder), elevated, instance) &&
+		WinApiHelpers::FocusProcessWindow(instance.processId);
+}
+
+int RunningTerminals::Sweep()
+{
+	return static_cast<int>(InstanceRegistry::Sweep());
+}
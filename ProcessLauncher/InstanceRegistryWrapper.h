@@ -0,0 +1,28 @@
+#pragma once
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// Finds the terminals running a LocalState folder, whichever app instance or elevated launcher
+    /// started them.
+    /// </summary>
+    public ref class RunningTerminals
+    {
+    public:
+        /// <summary>
+        /// Returns whether a terminal with the given elevation runs the folder.
+        /// </summary>
+        static bool IsRunning(System::String^ folder, bool elevated);
+
+        /// <summary>
+        /// Brings the window of the terminal running the folder to the foreground.
+        /// </summary>
+        /// <returns>false if no such terminal runs, or it has no window yet.</returns>
+        static bool Focus(System::String^ folder, bool elevated);
+
+        /// <summary>
+        /// Removes the entries of terminals that exited without unregistering.
+        /// </summary>
+        /// <returns>The number of entries removed.</returns>
+        static int Sweep();
+    };
+}
@@ -0,0 +1,114 @@
+﻿#include "pch.h"
+#include "new.h"
+#include "StringPool.h"
+#include "InternedStringsWrapper.h"
+#include <string_view>
+#include <vcclr.h>
+
+using namespace WTLayoutManager::Services;
+
+/**
+ * Interns a managed string.
+ *
+ * @param s The string, or null.
+ * @return The pooled instance; s itself if it is the first of its value.
+ */
+System::String^ InternedStrings::Intern(System::String^ s)
+{
+	if (s == nullptr)
+	{
+		return nullptr;
+	}
+	unsigned int id;
+	{
+		pin_ptr<const wchar_t> chars = PtrToStringChars(s);
+		id = StringPool::Shared().Intern(std::u16string_view(reinterpret_cast<const char16_t*>(chars), s->Length));
+	}
+	array<System::String^>^ strings = s_strings;
+	if (strings != nullptr && id < static_cast<unsigned int>(strings->Length))
+	{
+		System::String^ pooled = strings[id];
+		if (pooled != nullptr)
+		{
+			return pooled;
+		}
+	}
+	return Publish(id, s);
+}
+
+int InternedStrings::Count::get()
+{
+	return static_cast<int>(StringPool::Shared().Stats().strings);
+}
+
+long long InternedStrings::ArenaBytes::get()
+{
+	return static_cast<long long>(StringPool::Shared().Stats().arenaBytes);
+}
+
+/**
+ * Returns the managed instance of a pool id, creating it the first time.
+ *
+ * Lookups read the current table without locking; a table replaced by a concurrent growth only
+ * sends the reader to Publish.
+ *
+ * @param id An id of StringPool::Shared().
+ * @return The string, or null for StringPool::NullId.
+ */
+System::String^ InternedStrings::FromId(unsigned int id)
+{
+	if (id == StringPool::NullId)
+	{
+		return nullptr;
+	}
+	array<System::String^>^ strings = s_strings;
+	if (strings != nullptr && id < static_cast<unsigned int>(strings->Length))
+	{
+		System::String^ s = strings[id];
+		if (s != nullptr)
+		{
+			return s;
+		}
+	}
+	return Publish(id, nullptr);
+}
+
+/**
+ * Stores the managed instance of an id unless another thread stored one first.
+ *
+ * @param id The pool id.
+ * @param candidate The instance to store, or null to create it from the pooled characters.
+ * @return The stored instance.
+ */
+System::String^ InternedStrings::Publish(unsigned int id, System::String^ candidate)
+{
+	System::Threading::Monitor::Enter(s_lock);
+	try
+	{
+		array<System::String^>^ strings = s_strings;
+		if (strings == nullptr || id >= static_cast<unsigned int>(strings->Length))
+		{
+			int length = strings == nullptr ? 1024 : strings->Length * 2;
+			while (static_cast<unsigned int>(length) <= id)
+			{
+				length *= 2;
+			}
+			System::Array::Resize(strings, length);
+			s_strings = strings;
+		}
+		if (strings[id] == nullptr)
+		{
+			if (candidate == nullptr)
+			{
+				const std::u16string_view text = StringPool::Shared().View(id);
+				candidate = gcnew System::String(reinterpret_cast<const wchar_t*>(text.data()), 0, static_cast<int>(text.size()));
+			}
+			strings[id] = candidate;
+		}
+		return strings[id];
+	}
+	finally
+	{
+		System::Threading::Monitor::Exit(s_lock);
+	}
+}
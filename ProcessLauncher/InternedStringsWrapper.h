@@ -0,0 +1,42 @@
+#pragma once
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// Provides managed access to the native process-wide string pool.
+    /// </summary>
+    /// <remarks>
+    /// Each pooled string has one managed instance, shared by every snapshot it appears in: the wrappers
+    /// turn the pool ids of parsed profiles, icons and layouts into these instances, and managed parsers
+    /// pass the strings they keep through Intern. The pool only grows.
+    /// </remarks>
+    public ref class InternedStrings
+    {
+    public:
+        /// <summary>
+        /// Returns the pooled instance equal to s, pooling s itself the first time; null yields null.
+        /// </summary>
+        static System::String^ Intern(System::String^ s);
+
+        /// <summary>
+        /// Number of distinct strings in the pool.
+        /// </summary>
+        static property int Count { int get(); }
+
+        /// <summary>
+        /// Bytes of the native arena holding their characters.
+        /// </summary>
+        static property long long ArenaBytes { long long get(); }
+
+    internal:
+        /// <summary>
+        /// Returns the managed instance of a pool id; StringPool::NullId yields null.
+        /// </summary>
+        static System::String^ FromId(unsigned int id);
+
+    private:
+        static System::String^ Publish(unsigned int id, System::String^ candidate);
+
+        static array<System::String^>^ s_strings;
+        static initonly System::Object^ s_lock = gcnew System::Object();
+    };
+}
@@ -0,0 +1,47 @@
+﻿#include "pch.h"
+#include "new.h"
+#include "LaunchPlan.h"
+#include "LaunchPlanWrapper.h"
+#include <memory>
+#include <string>
+
+using namespace WTLayoutManager::Services;
+
+static System::String^ ToManaged(const std::wstring& s)
+{
+	return gcnew System::String(s.c_str(), 0, static_cast<int>(s.size()));
+}
+
+TerminalLaunchPlan::TerminalLaunchPlan(void* plan)
+	: m_plan(plan)
+{
+	const LaunchPlan& native = **static_cast<std::shared_ptr<const LaunchPlan>*>(plan);
+	m_packageFolder = ToManaged(native.Source().packageFolder);
+	m_localStateFolder = ToManaged(native.Source().localStateFolder);
+	m_applicationPath = ToManaged(native.Request().applicationPath);
+	m_elevated = !native.Source().launcherPath.empty();
+}
+
+bool TerminalLaunchPlan::IsCurrent::get()
+{
+	return m_plan != nullptr && (*static_cast<std::shared_ptr<const LaunchPlan>*>(m_plan))->IsCurrent();
+}
+
+void TerminalLaunchPlan::InvalidateAll()
+{
+	LaunchPlan::InvalidateAll();
+}
+
+TerminalLaunchPlan::~TerminalLaunchPlan()
+{
+	this->!TerminalLaunchPlan();
+}
+
+/**
+ * Releases the plan; a launch started from it keeps its own reference until it returns.
+ */
+TerminalLaunchPlan::!TerminalLaunchPlan()
+{
+	delete static_cast<std::shared_ptr<const LaunchPlan>*>(m_plan);
+	m_plan = nullptr;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// The launch of one LocalState copy with one terminal package, resolved and prebuilt once by
+    /// ProcessLauncher.CompilePlan and started by ProcessLauncher.Launch or Start without probing the
+    /// package or building any string. A plan goes stale when InvalidateAll is called; compile it again then.
+    /// </summary>
+    public ref class TerminalLaunchPlan sealed
+    {
+    public:
+        /// <summary>
+        /// The installed location of the terminal package the plan was compiled for.
+        /// </summary>
+        property System::String^ PackageFolder { System::String^ get() { return m_packageFolder; } }
+
+        property System::String^ LocalStateFolder { System::String^ get() { return m_localStateFolder; } }
+
+        /// <summary>
+        /// The terminal executable found in the package.
+        /// </summary>
+        property System::String^ ApplicationPath { System::String^ get() { return m_applicationPath; } }
+
+        property bool IsElevated { bool get() { return m_elevated; } }
+
+        /// <summary>
+        /// False once InvalidateAll was called after the plan was compiled.
+        /// </summary>
+        property bool IsCurrent { bool get(); }
+
+        /// <summary>
+        /// Marks every plan compiled so far as stale, after the terminal packages were reread or the hook replaced.
+        /// </summary>
+        static void InvalidateAll();
+
+        ~TerminalLaunchPlan();
+        !TerminalLaunchPlan();
+
+    internal:
+        /// <summary>
+        /// Takes over a native plan, a heap allocated std::shared_ptr of a LaunchPlan.
+        /// </summary>
+        TerminalLaunchPlan(void* plan);
+
+        /// <summary>
+        /// The native plan, for ProcessLauncher.Launch.
+        /// </summary>
+        property void* NativePlan { void* get() { return m_plan; } }
+
+    private:
+        void* m_plan;
+        System::String^ m_packageFolder;
+        System::String^ m_localStateFolder;
+        System::String^ m_applicationPath;
+        bool m_elevated;
+    };
+}
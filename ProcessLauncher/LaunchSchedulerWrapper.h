@@ -0,0 +1,72 @@
+#pragma once
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// The priority class of a launched terminal, in the order of the native LaunchPriority.
+    /// </summary>
+    public enum class TerminalPriority
+    {
+        Idle,
+        BelowNormal,
+        Normal,
+        AboveNormal,
+        High
+    };
+
+    /// <summary>
+    /// The cores a launched terminal may run on, in the order of the native CorePlacement.
+    /// </summary>
+    public enum class TerminalPlacement
+    {
+        Any,
+        Efficiency,
+        Performance
+    };
+
+    /// <summary>
+    /// How one terminal is launched and queued.
+    /// </summary>
+    public ref class TerminalLaunchPolicy
+    {
+    public:
+        TerminalLaunchPolicy()
+        {
+            Priority = TerminalPriority::Normal;
+            Placement = TerminalPlacement::Any;
+        }
+
+        property TerminalPriority Priority;
+        property TerminalPlacement Placement;
+
+        /// <summary>
+        /// Explicit processors of the first processor group; 0 lets Placement decide.
+        /// </summary>
+        property long long AffinityMask;
+
+        /// <summary>
+        /// Queued launches start highest first, then in the order they were made.
+        /// </summary>
+        property int QueuePriority;
+
+        /// <summary>
+        /// Resume the terminal only once the previous staggered terminal shows its window.
+        /// </summary>
+        property bool StaggerResume;
+
+        /// <summary>
+        /// The LocalState folder the terminal runs: its resource usage is recorded for it (see TerminalResources)
+        /// and it is registered as running it (see RunningTerminals).
+        /// </summary>
+        property System::String^ LocalStateFolder;
+
+        /// <summary>
+        /// Caps the memory the terminal and everything it starts commit together; 0 for no cap.
+        /// </summary>
+        property long long MemoryLimitBytes;
+
+        /// <summary>
+        /// Caps the share of all processors the terminal tree may use, 1 to 100; 0 for no cap.
+        /// </summary>
+        property int CpuRateLimitPercent;
+    };
+}
@@ -0,0 +1,172 @@
+﻿#include "pch.h"
+#include "new.h"
+#include "SnapshotArchive.h"
+#include "LayoutCache.h"
+#include "LayoutArchiveWrapper.h"
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vcclr.h>
+
+using namespace System::Collections::Generic;
+using namespace WTLayoutManager::Services;
+
+static std::u16string ToUtf16(System::String^ s)
+{
+	pin_ptr<const wchar_t> chars = PtrToStringChars(s);
+	return std::u16string(reinterpret_cast<const char16_t*>(chars), s->Length);
+}
+
+static System::String^ ToManaged(std::u16string_view v)
+{
+	return gcnew System::String(reinterpret_cast<const wchar_t*>(v.data()), 0, static_cast<int>(v.size()));
+}
+
+static std::filesystem::path ToPath(System::String^ s)
+{
+	return std::filesystem::path(ToUtf16(s));
+}
+
+static System::IO::IOException^ ToException(System::String^ what, System::String^ path, const std::error_code& ec)
+{
+	return gcnew System::IO::IOException(System::String::Format(L"{0} '{1}': {2}", what, path,
+		gcnew System::String(ec.message().c_str())));
+}
+
+/**
+ * Writes an archive of LocalState folders.
+ *
+ * @param archivePath The archive to create or replace.
+ * @param folders Pairs of (name in the archive, folder path).
+ */
+void LayoutArchive::Export(System::String^ archivePath, IEnumerable<KeyValuePair<System::String^, System::String^>>^ folders)
+{
+	if (archivePath == nullptr || folders == nullptr)
+	{
+		throw gcnew System::ArgumentNullException(archivePath == nullptr ? L"archivePath" : L"folders");
+	}
+
+	std::u16string names[LayoutCacheSourceCount];
+	std::u16string_view fileNames[LayoutCacheSourceCount];
+	for (size_t i = 0; i < LayoutCacheSourceCount; ++i)
+	{
+		const std::string_view source = LayoutCache::SourceNames[i];
+		names[i].assign(source.begin(), source.end());
+		fileNames[i] = names[i];
+	}
+
+	SnapshotArchiveWriter writer;
+	std::error_code ec;
+	if (!writer.Create(ToPath(archivePath), ec))
+	{
+		throw ToException(L"Failed to create", archivePath, ec);
+	}
+	for each (KeyValuePair<System::String^, System::String^> folder in folders)
+	{
+		if (folder.Key == nullptr || folder.Value == nullptr)
+		{
+			throw gcnew System::ArgumentException(L"Folder names and paths must not be null.", L"folders");
+		}
+		if (!writer.AddFolder(ToUtf16(folder.Key), ToPath(folder.Value), fileNames, LayoutCacheSourceCount, ec))
+		{
+			throw ToException(L"Failed to archive", folder.Value, ec);
+		}
+	}
+	if (!writer.Commit(ec))
+	{
+		throw ToException(L"Failed to write", archivePath, ec);
+	}
+}
+
+LayoutArchive::LayoutArchive(System::String^ archivePath)
+	: m_reader(nullptr), m_archivePath(archivePath)
+{
+	if (archivePath == nullptr)
+	{
+		throw gcnew System::ArgumentNullException(L"archivePath");
+	}
+
+	SnapshotArchiveReader* reader = new SnapshotArchiveReader();
+	std::error_code ec;
+	if (!reader->Open(ToPath(archivePath), ec))
+	{
+		delete reader;
+		throw ToException(L"Failed to open", archivePath, ec);
+	}
+	m_reader = reader;
+
+	m_folderNames = gcnew List<System::String^>(static_cast<int>(reader->FolderCount()));
+	for (size_t i = 0; i < reader->FolderCount(); ++i)
+	{
+		m_folderNames->Add(ToManaged(reader->Folder(i).name));
+	}
+}
+
+IReadOnlyList<System::String^>^ LayoutArchive::FolderNames::get()
+{
+	return m_folderNames->AsReadOnly();
+}
+
+/**
+ * Reads one file of an archived folder.
+ *
+ * @param folder The folder index.
+ * @param fileName The file name, compared case-insensitively.
+ * @return The file's text (UTF-8), or null if the folder has no such file.
+ */
+System::String^ LayoutArchive::ReadFile(int folder, System::String^ fileName)
+{
+	const SnapshotArchiveReader* reader = static_cast<SnapshotArchiveReader*>(m_reader);
+	if (folder < 0 || static_cast<size_t>(folder) >= reader->FolderCount())
+	{
+		throw gcnew System::ArgumentOutOfRangeException(L"folder");
+	}
+
+	const uint32_t fileCount = reader->Folder(static_cast<size_t>(folder)).fileCount;
+	for (uint32_t i = 0; i < fileCount; ++i)
+	{
+		if (!System::String::Equals(ToManaged(reader->File(static_cast<size_t>(folder), i).name), fileName, System::StringComparison::OrdinalIgnoreCase))
+		{
+			continue;
+		}
+		std::string content;
+		std::error_code ec;
+		if (!reader->ReadFile(static_cast<size_t>(folder), i, content, ec))
+		{
+			throw ToException(L"Failed to read", m_archivePath, ec);
+		}
+		return System::Text::Encoding::UTF8->GetString(reinterpret_cast<unsigned char*>(content.data()), static_cast<int>(content.size()));
+	}
+	return nullptr;
+}
+
+void LayoutArchive::Extract(int folder, System::String^ targetPath)
+{
+	const SnapshotArchiveReader* reader = static_cast<SnapshotArchiveReader*>(m_reader);
+	if (folder < 0 || static_cast<size_t>(folder) >= reader->FolderCount())
+	{
+		throw gcnew System::ArgumentOutOfRangeException(L"folder");
+	}
+	if (targetPath == nullptr)
+	{
+		throw gcnew System::ArgumentNullException(L"targetPath");
+	}
+
+	std::error_code ec;
+	if (!reader->Extract(static_cast<size_t>(folder), ToPath(targetPath), ec))
+	{
+		throw ToException(L"Failed to extract to", targetPath, ec);
+	}
+}
+
+LayoutArchive::~LayoutArchive()
+{
+	this->!LayoutArchive();
+}
+
+LayoutArchive::!LayoutArchive()
+{
+	delete static_cast<SnapshotArchiveReader*>(m_reader);
+	m_reader = nullptr;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// Single-file archive of LocalState folders, used to move layouts between machines. Each folder's JSON
+    /// files are stored as one compressed block, identical files once, behind an index, so a folder can be
+    /// listed, previewed or extracted without reading the others. Failures throw IOException.
+    /// </summary>
+    public ref class LayoutArchive sealed
+    {
+    public:
+        /// <summary>
+        /// Writes an archive of folders, given as (name in the archive, folder path) pairs. The layout files
+        /// (settings.json, state.json, elevated-state.json) of each folder are stored.
+        /// </summary>
+        static void Export(
+            System::String^ archivePath,
+            System::Collections::Generic::IEnumerable<System::Collections::Generic::KeyValuePair<System::String^, System::String^>>^ folders);
+
+        /// <summary>
+        /// Opens an archive; only its index is read.
+        /// </summary>
+        LayoutArchive(System::String^ archivePath);
+
+        /// <summary>
+        /// The names of the archived folders, in archive order.
+        /// </summary>
+        property System::Collections::Generic::IReadOnlyList<System::String^>^ FolderNames
+        {
+            System::Collections::Generic::IReadOnlyList<System::String^>^ get();
+        }
+
+        /// <summary>
+        /// Returns the text of one file of an archived folder, or null if the folder has no such file.
+        /// </summary>
+        System::String^ ReadFile(int folder, System::String^ fileName);
+
+        /// <summary>
+        /// Writes the files of an archived folder into a folder, which is created if needed.
+        /// </summary>
+        void Extract(int folder, System::String^ targetPath);
+
+        ~LayoutArchive();
+        !LayoutArchive();
+
+    private:
+        void* m_reader;
+        System::String^ m_archivePath;
+        System::Collections::Generic::List<System::String^>^ m_folderNames;
+    };
+}
@@ -0,0 +1,232 @@
+﻿#include "pch.h"
+#include "new.h"
+#include "LayoutCache.h"
+#include "RuntimeMetrics.h"
+#include "StringPool.h"
+#include "LayoutCacheWrapper.h"
+#include "InternedStringsWrapper.h"
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vcclr.h>
+#include <msclr/marshal_cppstd.h>
+
+using namespace msclr::interop;
+using namespace System::Collections::Generic;
+using namespace WTLayoutManager::Services;
+
+/**
+ * Copies a managed string into UTF-16 storage owned by the caller.
+ *
+ * @param s The managed string; null yields an empty string.
+ * @return The UTF-16 copy.
+ */
+static std::u16string ToUtf16(System::String^ s)
+{
+	if (s == nullptr)
+	{
+		return std::u16string();
+	}
+	pin_ptr<const wchar_t> chars = PtrToStringChars(s);
+	return std::u16string(reinterpret_cast<const char16_t*>(chars), s->Length);
+}
+
+/**
+ * Returns a view that keeps the distinction between a null and an empty managed string.
+ */
+static std::u16string_view ViewOf(System::String^ s, const std::u16string& storage)
+{
+	return s == nullptr ? std::u16string_view() : std::u16string_view(storage);
+}
+
+/**
+ * Returns the pooled managed string of a cached string view; null views yield a null string.
+ */
+static System::String^ ToManaged(std::u16string_view v)
+{
+	return InternedStrings::FromId(StringPool::Shared().Intern(v));
+}
+
+static std::filesystem::path ToPath(System::String^ s)
+{
+	return std::filesystem::path(marshal_as<std::wstring>(s));
+}
+
+// --------------------------------------------------------------------------
+
+LayoutCacheSnapshot::LayoutCacheSnapshot(System::String^ folderPath)
+	: FolderPath(folderPath), Keys(new CacheSourceKey[LayoutCacheSourceCount]{})
+{
+}
+
+LayoutCacheSnapshot::~LayoutCacheSnapshot()
+{
+	this->!LayoutCacheSnapshot();
+}
+
+LayoutCacheSnapshot::!LayoutCacheSnapshot()
+{
+	delete[] static_cast<CacheSourceKey*>(Keys);
+	Keys = nullptr;
+}
+
+// --------------------------------------------------------------------------
+
+/**
+ * Captures size, modification time and content hash of the folder's source files.
+ *
+ * @param folderPath The LocalState folder.
+ * @return The snapshot to pass to Save once the files are parsed.
+ */
+LayoutCacheSnapshot^ LayoutCacheStore::Capture(System::String^ folderPath)
+{
+	LayoutCacheSnapshot^ snapshot = gcnew LayoutCacheSnapshot(folderPath);
+	auto& keys = *reinterpret_cast<CacheSourceKey(*)[LayoutCacheSourceCount]>(snapshot->Keys);
+	LayoutCache::CaptureSources(ToPath(folderPath), keys, true);
+	return snapshot;
+}
+
+/**
+ * Loads the cached files of a folder directly from the mapped sidecar.
+ *
+ * @param folderPath The LocalState folder.
+ * @return The cached files, or nullptr if the cache cannot be used.
+ */
+List<CachedFile^>^ LayoutCacheStore::TryLoad(System::String^ folderPath)
+{
+	LayoutCacheReader reader;
+	CacheSourceKey current[LayoutCacheSourceCount]{};
+	if (reader.Open(ToPath(folderPath), static_cast<uint32_t>(Schema), current) != CacheStatus::Fresh)
+	{
+		RuntimeMetrics::Add(MetricCounter::LayoutCacheMisses);
+		return nullptr;
+	}
+	RuntimeMetrics::Add(MetricCounter::LayoutCacheHits);
+
+	const CacheHeader& header = reader.header();
+	List<CachedFile^>^ files = gcnew List<CachedFile^>(static_cast<int>(header.fileCount));
+	for (uint32_t f = 0; f < header.fileCount; ++f)
+	{
+		const CacheFileRecord& file = reader.files()[f];
+		const CacheSourceKey& key = current[file.source];
+
+		CachedFile^ cachedFile = gcnew CachedFile();
+		cachedFile->FileName = gcnew System::String(LayoutCache::SourceNames[file.source]);
+		cachedFile->Size = static_cast<long long>(key.size);
+		cachedFile->LastModified = System::DateTime::FromFileTime(key.lastWriteTime);
+
+		for (uint32_t p = 0; p < file.profileCount; ++p)
+		{
+			const CacheProfileRecord& profile = reader.profiles()[file.firstProfile + p];
+			CachedProfile^ cachedProfile = gcnew CachedProfile();
+			cachedProfile->ProfileName = ToManaged(reader.str(profile.name));
+			cachedProfile->IconPath = ToManaged(reader.str(profile.icon));
+			cachedFile->Profiles->Add(cachedProfile);
+		}
+
+		if (file.flags & CacheFileHasTabs)
+		{
+			cachedFile->Tabs = gcnew List<CachedTab^>(static_cast<int>(file.tabCount));
+			for (uint32_t t = 0; t < file.tabCount; ++t)
+			{
+				const CacheTabRecord& tab = reader.tabs()[file.firstTab + t];
+				CachedTab^ cachedTab = gcnew CachedTab();
+				cachedTab->TabTitle = ToManaged(reader.str(tab.title));
+				cachedTab->GridRows = tab.rows;
+				cachedTab->GridColumns = tab.columns;
+
+				for (uint32_t p = 0; p < tab.paneCount; ++p)
+				{
+					const CachePaneRecord& pane = reader.panes()[tab.firstPane + p];
+					CachedPane^ cachedPane = gcnew CachedPane();
+					cachedPane->ProfileName = ToManaged(reader.str(pane.profile));
+					cachedPane->Icon = ToManaged(reader.str(pane.icon));
+					cachedPane->Commandline = ToManaged(reader.str(pane.commandline));
+					cachedPane->StartingDirectory = ToManaged(reader.str(pane.startingDirectory));
+					cachedPane->SplitDirection = ToManaged(reader.str(pane.splitDirection));
+					cachedPane->X = pane.x;
+					cachedPane->Y = pane.y;
+					cachedPane->Width = pane.width;
+					cachedPane->Height = pane.height;
+					cachedPane->GridRow = pane.placement.row;
+					cachedPane->GridColumn = pane.placement.column;
+					cachedPane->GridRowSpan = pane.placement.rowSpan;
+					cachedPane->GridColumnSpan = pane.placement.columnSpan;
+					cachedTab->Panes->Add(cachedPane);
+				}
+				cachedFile->Tabs->Add(cachedTab);
+			}
+		}
+		files->Add(cachedFile);
+	}
+	return files;
+}
+
+/**
+ * Serializes the parsed files into the folder's sidecar cache.
+ *
+ * @param snapshot The keys captured by Capture before the files were parsed.
+ * @param files The parsed files.
+ * @return true if the cache was written.
+ */
+bool LayoutCacheStore::Save(LayoutCacheSnapshot^ snapshot, IEnumerable<CachedFile^>^ files)
+{
+	if (snapshot == nullptr || snapshot->Keys == nullptr || files == nullptr)
+	{
+		return false;
+	}
+
+	LayoutCacheWriter writer;
+	for each (CachedFile^ file in files)
+	{
+		std::string name = marshal_as<std::string>(file->FileName);
+		uint32_t source = 0;
+		while (source < LayoutCacheSourceCount && name != LayoutCache::SourceNames[source])
+		{
+			++source;
+		}
+		if (source == LayoutCacheSourceCount)
+		{
+			return false; // not a tracked source file; the cache would never validate
+		}
+
+		writer.BeginFile(source, file->Tabs != nullptr);
+		if (file->Profiles != nullptr)
+		{
+			for each (CachedProfile^ profile in file->Profiles)
+			{
+				std::u16string profileName = ToUtf16(profile->ProfileName);
+				std::u16string iconPath = ToUtf16(profile->IconPath);
+				writer.AddProfile(ViewOf(profile->ProfileName, profileName), ViewOf(profile->IconPath, iconPath));
+			}
+		}
+		if (file->Tabs != nullptr)
+		{
+			for each (CachedTab^ tab in file->Tabs)
+			{
+				std::u16string title = ToUtf16(tab->TabTitle);
+				writer.BeginTab(ViewOf(tab->TabTitle, title), tab->GridRows, tab->GridColumns);
+				for each (CachedPane^ pane in tab->Panes)
+				{
+					std::u16string profileName = ToUtf16(pane->ProfileName);
+					std::u16string icon = ToUtf16(pane->Icon);
+					std::u16string commandline = ToUtf16(pane->Commandline);
+					std::u16string startingDirectory = ToUtf16(pane->StartingDirectory);
+					std::u16string split = ToUtf16(pane->SplitDirection);
+					GridPlacement placement{ pane->GridRow, pane->GridColumn, pane->GridRowSpan, pane->GridColumnSpan };
+					writer.AddPane(
+						ViewOf(pane->ProfileName, profileName),
+						ViewOf(pane->Icon, icon),
+						ViewOf(pane->Commandline, commandline),
+						ViewOf(pane->StartingDirectory, startingDirectory),
+						ViewOf(pane->SplitDirection, split),
+						pane->X, pane->Y, pane->Width, pane->Height,
+						placement);
+				}
+			}
+		}
+	}
+
+	const auto& keys = *reinterpret_cast<const CacheSourceKey(*)[LayoutCacheSourceCount]>(snapshot->Keys);
+	return writer.Save(ToPath(snapshot->FolderPath), static_cast<uint32_t>(Schema), keys);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// A visible settings.json profile with its resolved icon, as stored in the sidecar cache.
+    /// </summary>
+    public ref class CachedProfile
+    {
+    public:
+        property System::String^ ProfileName;
+        property System::String^ IconPath;
+    };
+
+    /// <summary>
+    /// A replayed pane, as stored in the sidecar cache.
+    /// </summary>
+    public ref class CachedPane
+    {
+    public:
+        property System::String^ ProfileName;
+        property System::String^ Icon;
+        property System::String^ Commandline;
+        property System::String^ StartingDirectory;
+        property System::String^ SplitDirection;
+        property double X;
+        property double Y;
+        property double Width;
+        property double Height;
+        property int GridRow;
+        property int GridColumn;
+        property int GridRowSpan;
+        property int GridColumnSpan;
+    };
+
+    /// <summary>
+    /// A replayed tab, as stored in the sidecar cache.
+    /// </summary>
+    public ref class CachedTab
+    {
+    public:
+        CachedTab() { Panes = gcnew System::Collections::Generic::List<CachedPane^>(); }
+
+        property System::String^ TabTitle;
+        property int GridRows;
+        property int GridColumns;
+        property System::Collections::Generic::List<CachedPane^>^ Panes;
+    };
+
+    /// <summary>
+    /// One source file of a LocalState folder with everything parsed from it.
+    /// Tabs is null when the file did not produce tab states.
+    /// </summary>
+    public ref class CachedFile
+    {
+    public:
+        CachedFile() { Profiles = gcnew System::Collections::Generic::List<CachedProfile^>(); }
+
+        property System::String^ FileName;
+        property System::DateTime LastModified;
+        property long long Size;
+        property System::Collections::Generic::List<CachedProfile^>^ Profiles;
+        property System::Collections::Generic::List<CachedTab^>^ Tabs;
+    };
+
+    /// <summary>
+    /// Size, timestamp and content hash of a folder's source files, captured before they are parsed.
+    /// </summary>
+    public ref class LayoutCacheSnapshot
+    {
+    public:
+        ~LayoutCacheSnapshot();
+        !LayoutCacheSnapshot();
+
+    internal:
+        LayoutCacheSnapshot(System::String^ folderPath);
+
+        System::String^ FolderPath;
+        void* Keys;
+    };
+
+    /// <summary>
+    /// Provides managed access to the per-folder binary sidecar cache of parsed profiles and layouts.
+    /// </summary>
+    public ref class LayoutCacheStore
+    {
+    public:
+        /// <summary>
+        /// Version of the parsing rules that produced the cached records.
+        /// Bump it whenever profile / icon resolution or layout replay changes, so old caches are discarded.
+        /// </summary>
+        static const int Schema = 1;
+
+        /// <summary>
+        /// Captures the source file keys of a folder; call before parsing so the cache never
+        /// claims to describe contents written after the parse started.
+        /// </summary>
+        static LayoutCacheSnapshot^ Capture(System::String^ folderPath);
+
+        /// <summary>
+        /// Returns the cached files of a folder, or null if the cache is missing, stale or corrupt.
+        /// </summary>
+        static System::Collections::Generic::List<CachedFile^>^ TryLoad(System::String^ folderPath);
+
+        /// <summary>
+        /// Writes the cache of the folder the snapshot was captured from.
+        /// Returns false if the cache could not be written; this never affects the parsed data.
+        /// </summary>
+        static bool Save(LayoutCacheSnapshot^ snapshot, System::Collections::Generic::IEnumerable<CachedFile^>^ files);
+    };
+}
@@ -0,0 +1,137 @@
+﻿#include "pch.h"
+#include "new.h"
+#include "SnapshotHistory.h"
+#include "LayoutCache.h"
+#include "MappedFile.h"
+#include "LayoutHistoryWrapper.h"
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <msclr/marshal_cppstd.h>
+
+using namespace msclr::interop;
+using namespace WTLayoutManager::Services;
+
+static std::filesystem::path ToPath(System::String^ s)
+{
+	return std::filesystem::path(marshal_as<std::wstring>(s));
+}
+
+static System::IO::IOException^ ToException(System::String^ what, System::String^ path, const std::error_code& ec)
+{
+	return gcnew System::IO::IOException(System::String::Format(L"{0} '{1}': {2}", what, path,
+		gcnew System::String(ec.message().c_str())));
+}
+
+/**
+ * Returns the index of a file name in LayoutCache::SourceNames, used as the history source id.
+ *
+ * @param fileName The file name, compared case-insensitively.
+ * @return The index; throws ArgumentException for other files.
+ */
+static uint32_t SourceOf(System::String^ fileName)
+{
+	for (size_t i = 0; i < LayoutCacheSourceCount; ++i)
+	{
+		if (System::String::Equals(fileName, gcnew System::String(LayoutCache::SourceNames[i]), System::StringComparison::OrdinalIgnoreCase))
+		{
+			return static_cast<uint32_t>(i);
+		}
+	}
+	throw gcnew System::ArgumentException(System::String::Format(L"'{0}' is not a layout file.", fileName), L"fileName");
+}
+
+LayoutHistory::LayoutHistory(System::String^ folderPath)
+	: m_history(nullptr), m_folderPath(folderPath)
+{
+	if (folderPath == nullptr)
+	{
+		throw gcnew System::ArgumentNullException(L"folderPath");
+	}
+
+	SnapshotHistory* history = new SnapshotHistory();
+	std::error_code ec;
+	if (!history->Open(SnapshotHistory::PathFor(ToPath(folderPath)), SnapshotHistory::DefaultCheckpointInterval, ec))
+	{
+		delete history;
+		throw ToException(L"Failed to open the history of", folderPath, ec);
+	}
+	m_history = history;
+}
+
+/**
+ * Records the current content of a file of the folder.
+ *
+ * @param fileName One of LayoutCache::SourceNames.
+ * @return true if a new version was recorded.
+ */
+bool LayoutHistory::Record(System::String^ fileName)
+{
+	const uint32_t source = SourceOf(fileName);
+	MappedFile file;
+	if (!file.Open(ToPath(m_folderPath) / LayoutCache::SourceNames[source]))
+	{
+		return false;
+	}
+
+	bool appended = false;
+	std::error_code ec;
+	if (!static_cast<SnapshotHistory*>(m_history)->Append(
+		source, std::string_view(reinterpret_cast<const char*>(file.data()), file.size()), appended, ec))
+	{
+		throw ToException(L"Failed to record the history of", m_folderPath, ec);
+	}
+	return appended;
+}
+
+int LayoutHistory::Count::get()
+{
+	return static_cast<int>(static_cast<SnapshotHistory*>(m_history)->Count());
+}
+
+bool LayoutHistory::CanUndo::get()
+{
+	const SnapshotHistory* history = static_cast<SnapshotHistory*>(m_history);
+	return history->Count() != 0 && history->Previous(history->Count() - 1) >= 0;
+}
+
+/**
+ * Restores the previous version of the most recently changed file.
+ *
+ * @return The name of the restored file.
+ */
+System::String^ LayoutHistory::Undo()
+{
+	SnapshotHistory* history = static_cast<SnapshotHistory*>(m_history);
+	const ptrdiff_t previous = history->Count() ? history->Previous(history->Count() - 1) : -1;
+	if (previous < 0)
+	{
+		throw gcnew System::InvalidOperationException(L"There is no earlier version to restore.");
+	}
+
+	HistoryRecord record;
+	if (!history->GetRecord(static_cast<size_t>(previous), record) || record.source >= LayoutCacheSourceCount)
+	{
+		throw gcnew System::IO::InvalidDataException(L"The history refers to an unknown file.");
+	}
+	System::String^ fileName = gcnew System::String(LayoutCache::SourceNames[record.source]);
+	std::error_code ec;
+	if (!history->RestoreFile(static_cast<size_t>(previous), ToPath(m_folderPath) / LayoutCache::SourceNames[record.source], ec))
+	{
+		throw ToException(L"Failed to restore", fileName, ec);
+	}
+	Record(fileName);
+	return fileName;
+}
+
+LayoutHistory::~LayoutHistory()
+{
+	this->!LayoutHistory();
+}
+
+LayoutHistory::!LayoutHistory()
+{
+	delete static_cast<SnapshotHistory*>(m_history);
+	m_history = nullptr;
+}
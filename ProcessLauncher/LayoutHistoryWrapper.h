@@ -0,0 +1,42 @@
+#pragma once
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// Version history of the JSON files of one LocalState copy, stored as checkpoints and structural deltas
+    /// in a single file inside the folder. Failures throw IOException.
+    /// </summary>
+    public ref class LayoutHistory sealed
+    {
+    public:
+        /// <summary>
+        /// Opens the history of a LocalState folder; a folder without history starts empty.
+        /// </summary>
+        LayoutHistory(System::String^ folderPath);
+
+        /// <summary>
+        /// Records the current content of a file of the folder (settings.json, state.json or
+        /// elevated-state.json). Returns false if the file is missing or unchanged since its last version.
+        /// </summary>
+        bool Record(System::String^ fileName);
+
+        property int Count { int get(); }
+
+        /// <summary>
+        /// True when the newest version has an earlier version of the same file to go back to.
+        /// </summary>
+        property bool CanUndo { bool get(); }
+
+        /// <summary>
+        /// Restores the file of the newest version to its previous version and records the result, so an
+        /// undo can itself be undone. Returns the name of the restored file.
+        /// </summary>
+        System::String^ Undo();
+
+        ~LayoutHistory();
+        !LayoutHistory();
+
+    private:
+        void* m_history;
+        System::String^ m_folderPath;
+    };
+}
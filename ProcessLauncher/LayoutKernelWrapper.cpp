@@ -0,0 +1,72 @@
+﻿#include "pch.h"
+#include "new.h"
+#include "DyadicLayout.h"
+#include "LayoutKernelWrapper.h"
+#include <memory>
+
+using namespace WTLayoutManager::Services;
+
+/**
+ * Replays the splits of one tab and computes the grid rows / columns of its panes.
+ *
+ * The splits are replayed by the native kernel on exact dyadic geometry, which then sorts and
+ * deduplicates the pane edges; no tolerance comparison takes place.
+ *
+ * @param focused Index of the pane split by every action.
+ * @param directions Side of the new pane for every action (SplitDirection values; others mean None).
+ * @param x Receives the left edge of every pane.
+ * @param y Receives the top edge of every pane.
+ * @param width Receives the width of every pane.
+ * @param height Receives the height of every pane.
+ * @param placements Receives row, column, rowSpan, columnSpan per pane.
+ * @param rows Receives the number of grid rows.
+ * @param columns Receives the number of grid columns.
+ */
+void LayoutKernel::Replay(
+	array<int>^ focused,
+	array<int>^ directions,
+	array<double>^ x,
+	array<double>^ y,
+	array<double>^ width,
+	array<double>^ height,
+	array<int>^ placements,
+	int% rows,
+	int% columns)
+{
+	int splitCount = focused->Length;
+	int count = splitCount + 1;
+	if (directions->Length != splitCount || x->Length != count || y->Length != count || width->Length != count
+		|| height->Length != count || placements->Length != count * 4)
+	{
+		throw gcnew System::ArgumentException(L"Split, pane geometry and placement arrays must have matching lengths.");
+	}
+
+	std::unique_ptr<PaneSplit[]> splits(new PaneSplit[splitCount > 0 ? splitCount : 1]);
+	for (int i = 0; i < splitCount; ++i)
+	{
+		const int direction = directions[i];
+		splits[i].focused = focused[i] >= 0 ? static_cast<uint32_t>(focused[i]) : UINT32_MAX;
+		splits[i].direction = direction >= 0 && direction < static_cast<int>(SplitDirection::None)
+			? static_cast<SplitDirection>(direction)
+			: SplitDirection::None;
+	}
+
+	std::unique_ptr<DyadicRect[]> panes(new DyadicRect[count]);
+	DyadicLayout::Replay(splits.get(), static_cast<size_t>(splitCount), panes.get());
+	for (int i = 0; i < count; ++i)
+	{
+		x[i] = DyadicLayout::ToDouble(panes[i].x);
+		y[i] = DyadicLayout::ToDouble(panes[i].y);
+		width[i] = DyadicLayout::ToDouble(panes[i].width);
+		height[i] = DyadicLayout::ToDouble(panes[i].height);
+	}
+
+	static_assert(sizeof(GridPlacement) == 4 * sizeof(int), "GridPlacement must map onto 4 ints per pane");
+	pin_ptr<int> out = &placements[0];
+	int32_t nativeRows = 0;
+	int32_t nativeColumns = 0;
+	DyadicLayout::ComputeGrid(panes.get(), static_cast<size_t>(count), reinterpret_cast<GridPlacement*>(out), nativeRows, nativeColumns);
+
+	rows = nativeRows;
+	columns = nativeColumns;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// Provides managed access to the native tab layout kernel.
+    /// </summary>
+    public ref class LayoutKernel
+    {
+    public:
+        /// <summary>
+        /// Replays the "splitPane" actions of one tab and computes the grid rows / columns of its panes.
+        /// Split i creates pane i + 1: focused[i] is the index of the pane it splits and directions[i] the side
+        /// of the new pane (0 left, 1 right, 2 up, 3 down; any other value gives the new pane no area).
+        /// The geometry stays exact (dyadic rationals) throughout; x, y, width and height receive it as
+        /// fractions of the tab in [0, 1], one entry per pane.
+        /// placements receives row, column, rowSpan and columnSpan for every pane (4 entries per pane).
+        /// Throws an ArgumentException if the arrays do not have matching lengths.
+        /// </summary>
+        static void Replay(
+            array<int>^ focused,
+            array<int>^ directions,
+            array<double>^ x,
+            array<double>^ y,
+            array<double>^ width,
+            array<double>^ height,
+            array<int>^ placements,
+            [System::Runtime::InteropServices::Out] int% rows,
+            [System::Runtime::InteropServices::Out] int% columns);
+    };
+}
@@ -0,0 +1,32 @@
+﻿#include "pch.h"
+#include "new.h"
+#include "NativeLog.h"
+#include "NativeLogWrapper.h"
+#include <msclr/marshal_cppstd.h>
+
+using namespace WTLayoutManager::Services;
+
+/**
+ * Starts the native log.
+ *
+ * @param directory The log folder; created if needed.
+ * @param baseName The file name without extension.
+ * @return true if the log is running.
+ */
+bool NativeLogging::Start(System::String^ directory, System::String^ baseName)
+{
+	if (System::String::IsNullOrEmpty(directory) || System::String::IsNullOrEmpty(baseName))
+	{
+		throw gcnew System::ArgumentException("A log directory and base name are required.");
+	}
+	NativeLogOptions options;
+	options.directory = std::filesystem::path(msclr::interop::marshal_as<std::wstring>(directory));
+	options.baseName = msclr::interop::marshal_as<std::string>(baseName);
+	std::error_code ec;
+	return NativeLog::Start(options, ec);
+}
+
+void NativeLogging::Stop()
+{
+	NativeLog::Stop();
+}
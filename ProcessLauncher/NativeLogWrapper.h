@@ -0,0 +1,21 @@
+#pragma once
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// Starts and stops the native structured log that the launch code writes to.
+    /// </summary>
+    public ref class NativeLogging
+    {
+    public:
+        /// <summary>
+        /// Starts writing baseName.log (rolled over to baseName.1.log and so on) in directory.
+        /// </summary>
+        /// <returns>false if the folder or the file cannot be created; records are then discarded.</returns>
+        static bool Start(System::String^ directory, System::String^ baseName);
+
+        /// <summary>
+        /// Writes every queued record and closes the log.
+        /// </summary>
+        static void Stop();
+    };
+}
@@ -1,6 +1,10 @@
 ﻿#include "pch.h"
 #include "new.h"
 #include "WinApiHelpers.h"
+#include "NativeLog.h"
+#include "LaunchScheduler.h"
+#include "TerminalLauncher.h"
+#include "LaunchPlan.h"
 #include "ProcessLauncherWrapper.h"
 #include <windows.h>
 #include <strsafe.h>
@@ -20,6 +24,11 @@
 using namespace msclr::interop;
 using namespace WTLayoutManager::Services;
 
+static_assert(static_cast<int>(TerminalPriority::High) == static_cast<int>(LaunchPriority::High),
+	"TerminalPriority must mirror LaunchPriority");
+static_assert(static_cast<int>(TerminalPlacement::Performance) == static_cast<int>(CorePlacement::Performance),
+	"TerminalPlacement must mirror CorePlacement");
+
 /**
  * Formats a process exit code into a human-readable string.
  *
@@ -42,202 +51,435 @@ static std::wstring FormatProcessExitCode(int exitCode)
 }
 
 /**
- * Properly quotes an argument by escaping internal quotes.
+ * Returns the exception for a launch the backend could not start or wait for; the backend logged it.
  *
- * @param arg The argument to be quoted.
+ * @param error The failed call.
  *
- * @return The quoted argument as a wstring.
+ * @return A Win32Exception carrying the system message of the error.
  */
-static std::wstring QuoteArgument(const std::wstring& arg)
+static System::Exception^ LaunchFailure(const LaunchError& error)
 {
-	std::wstringstream result;
-	result << L"\"";
-	for (wchar_t ch : arg) {
-		if (ch == L'\"') {
-			result << L"\\\"";
-		} else {
-			result << ch;
-		}
-	}
-	result << L"\"";
-	return result.str();
+	return gcnew System::ComponentModel::Win32Exception(static_cast<int>(error.code));
 }
 
-
 /**
- * Launches a process with a custom environment block.
- * Returns the exit code of the process.
- * Throws an exception if the process could not be started.
- * @param applicationPath Path to the application executable
- * @param commandLine Command line arguments
- * @param envBlock Encoded environment block (e.g. "VAR1=Value1;VAR2=Value2")
+ * Logs a launched process that exited with an error and returns the exception to throw.
+ *
+ * @param event The log event.
+ * @param exitCode The exit code; the exception keeps it as its ErrorCode.
+ * @param appPath The application that was launched.
+ *
+ * @return An ExternalException with the formatted exit code as its message.
  */
-int ProcessLauncher::LaunchProcess(System::String^ applicationPath, System::String^ commandLine, System::String^ envBlock, System::String^ hookPath)
+static System::Exception^ ExitFailure(const char* event, DWORD exitCode, const wchar_t* appPath)
 {
-	msclr::auto_handle<msclr::interop::marshal_context> ctx(gcnew msclr::interop::marshal_context());
-	const wchar_t* appPath = ctx->marshal_as<const wchar_t*>(applicationPath);
-	const wchar_t* cmdRaw = ctx->marshal_as<const wchar_t*>(commandLine);
-	const wchar_t* hookRaw = ctx->marshal_as<const wchar_t*>(hookPath);
+	NativeLog::Write(LogLevel::Warning, event, exitCode, { LogArg("app", appPath) });
+	std::wstring message = FormatProcessExitCode(static_cast<int>(exitCode));
+	return gcnew System::Runtime::InteropServices::ExternalException(
+		gcnew System::String(message.c_str(), 0, static_cast<int>(message.size())), static_cast<int>(exitCode));
+}
 
-	// 1. ----- DUPLICATE COMMAND LINE --------------------------------------
-	size_t cmdLen = wcslen(cmdRaw) + 1;
-	std::unique_ptr<wchar_t[]> cmdLine(new wchar_t[cmdLen]);
-	if (FAILED(StringCchCopyW(cmdLine.get(), cmdLen, cmdRaw)))
+/**
+ * Converts a managed launch policy.
+ *
+ * @param policy The policy, or null for the default one.
+ *
+ * @return The native policy.
+ */
+static LaunchPolicy ToNativePolicy(TerminalLaunchPolicy^ policy)
+{
+	LaunchPolicy native;
+	if (policy != nullptr)
 	{
-		throw gcnew System::Exception(ctx->marshal_as<System::String^>(WinApiHelpers::GetLastErrorMessage()));
+		native.priority = static_cast<LaunchPriority>(policy->Priority);
+		native.placement = static_cast<CorePlacement>(policy->Placement);
+		native.affinityMask = static_cast<uint64_t>(policy->AffinityMask);
+		native.queuePriority = policy->QueuePriority;
+		native.staggerResume = policy->StaggerResume;
+		if (policy->MemoryLimitBytes < 0 || policy->CpuRateLimitPercent < 0 || policy->CpuRateLimitPercent > 100)
+		{
+			throw gcnew System::ArgumentOutOfRangeException(L"policy");
+		}
+		native.limits.memoryBytes = static_cast<uint64_t>(policy->MemoryLimitBytes);
+		native.limits.cpuRatePercent = static_cast<uint32_t>(policy->CpuRateLimitPercent);
 	}
+	return native;
+}
 
-	// 2. ----- SPLIT envBlock → vector<wstring> ---------------------------
-	std::vector<std::wstring> additional;
+/**
+ * Converts the arguments of a launch.
+ *
+ * @param launcherPath The elevated launcher, or null for a direct launch.
+ * @param envBlock Encoded environment block (e.g. "VAR1=Value1;VAR2=Value2"); blank entries are skipped.
+ * @param policy The launch policy, or null for the default one.
+ *
+ * @return The native request.
+ */
+static TerminalLaunchRequest ToNativeRequest(System::String^ launcherPath, System::String^ applicationPath, System::String^ commandLine, System::String^ envBlock, System::String^ hookPath, TerminalLaunchPolicy^ policy)
+{
+	TerminalLaunchRequest request;
+	request.policy = ToNativePolicy(policy);
+	request.applicationPath = marshal_as<std::wstring>(applicationPath);
+	request.commandLine = marshal_as<std::wstring>(commandLine);
+	request.hookPath = marshal_as<std::wstring>(hookPath);
+	if (launcherPath != nullptr)
+	{
+		request.launcherPath = marshal_as<std::wstring>(launcherPath);
+	}
+	if (policy != nullptr && policy->LocalStateFolder != nullptr)
+	{
+		request.localStateFolder = marshal_as<std::wstring>(policy->LocalStateFolder);
+	}
 	if (!System::String::IsNullOrEmpty(envBlock))
 	{
-		array<System::String^>^ parts = envBlock->Split(L';');
-		for each (System::String^ part in parts)
+		for each (System::String^ part in envBlock->Split(L';'))
 		{
-			if (System::String::IsNullOrWhiteSpace(part))
-				continue;      // skip empty
-
-			additional.emplace_back(ctx->marshal_as<const wchar_t*>(part));
+			if (!System::String::IsNullOrWhiteSpace(part))
+			{
+				request.environment.push_back(marshal_as<std::wstring>(part));
+			}
 		}
 	}
+	return request;
+}
+
+/**
+ * Starts a launch through the shared backend and waits for its terminal to exit.
+ *
+ * @param request The launch.
+ *
+ * @return 0; a terminal exiting with another code is reported as an exception.
+ */
+static int RunToExit(const TerminalLaunchRequest& request)
+{
+	std::shared_ptr<LaunchBackend> backend = LaunchBackend::Current();
+	if (!backend)
+	{
+		throw gcnew System::PlatformNotSupportedException();
+	}
 
-	// 3. ----- MERGE with parent environment ------------------------------
-	std::unique_ptr<wchar_t[]> merged;
-	DWORD dwCreationFlags = NORMAL_PRIORITY_CLASS | CREATE_NEW_CONSOLE | CREATE_NEW_PROCESS_GROUP | CREATE_SUSPENDED;
-	if (!additional.empty())
+	LaunchError error;
+	std::unique_ptr<TerminalLaunch> launch = backend->Start(request, error);
+	if (!launch)
 	{
-		merged.reset(WinApiHelpers::CreateMergedEnvironmentBlock(additional));
-		dwCreationFlags |= CREATE_UNICODE_ENVIRONMENT;
+		throw LaunchFailure(error);
 	}
 
-	STARTUPINFOEXW si{ sizeof(si) };
-	si.StartupInfo.wShowWindow = SW_SHOWDEFAULT;
-	process_info_raii pi;
+	uint32_t exitCode = 0;
+	if (launch->Wait(LaunchBackend::Infinite, exitCode, error) != LaunchWaitResult::Exited)
+	{
+		throw LaunchFailure(error);
+	}
+	if (exitCode != 0)
+	{
+		throw ExitFailure("launch.exited", exitCode, request.applicationPath.c_str());
+	}
+	return static_cast<int>(exitCode);
+}
 
-	std::wstring hookW(hookRaw);
-	std::string hook = WinApiHelpers::WideToUtf8(hookW);
-	BOOL success = WinApiHelpers::DetourCreateProcessWithDllExWrap(
-		appPath,            // or retrieved from argv
-		cmdLine.get(),      // command line (inherit)
-		nullptr, nullptr,   // security attrs
-		FALSE,              // inherit handles
-		dwCreationFlags,
-		merged.get(),       // Custom environment block
-		nullptr,            // cwd
-		&si.StartupInfo,
-		(PROCESS_INFORMATION*) pi,
-		hook.c_str(),       // *** injected DLL
-		nullptr);           // default create-process routine
+/**
+ * Starts a launch through the shared backend and hands it to a session that waits for it.
+ *
+ * @param request The launch.
+ *
+ * @return The session; it completes when the terminal exits.
+ */
+static TerminalSession^ StartSession(const TerminalLaunchRequest& request)
+{
+	std::shared_ptr<LaunchBackend> backend = LaunchBackend::Current();
+	if (!backend)
+	{
+		throw gcnew System::PlatformNotSupportedException();
+	}
 
-	std::wstring err = WinApiHelpers::GetLastErrorMessage();
-	if (!success)
+	LaunchError error;
+	std::unique_ptr<TerminalLaunch> launch = backend->Start(request, error);
+	if (!launch)
 	{
-		throw gcnew System::Exception(ctx->marshal_as<System::String^>(WinApiHelpers::GetLastErrorMessage()));
+		throw LaunchFailure(error);
 	}
+	System::String^ applicationPath = gcnew System::String(request.applicationPath.c_str(), 0, static_cast<int>(request.applicationPath.size()));
+	return gcnew TerminalSession(launch.release(), applicationPath);
+}
 
-	//success = DebugActiveProcess(pi.dwProcessId);
-	success = ResumeThread(pi.pi.hThread);
+TerminalSession::BorrowedWaitHandle::BorrowedWaitHandle(System::IntPtr handle)
+{
+	SafeWaitHandle = gcnew Microsoft::Win32::SafeHandles::SafeWaitHandle(handle, false);
+}
 
-	HandlePtr piHandle = WinApiHelpers::GetWindowsTerminalHandle(pi.pi.dwProcessId);
-	if (piHandle.get() == nullptr)
+TerminalSession::TerminalSession(void* launch, System::String^ applicationPath)
+	: m_launch(launch), m_applicationPath(applicationPath), m_lock(gcnew System::Object())
+{
+	m_exited = gcnew System::Threading::Tasks::TaskCompletionSource<int>(
+		System::Threading::Tasks::TaskCreationOptions::RunContinuationsAsynchronously);
+	m_processId = static_cast<int>(static_cast<TerminalLaunch*>(launch)->ProcessId());
+	System::Threading::Monitor::Enter(m_lock);
+	try
 	{
-		throw gcnew System::Exception(ctx->marshal_as<System::String^>(WinApiHelpers::GetLastErrorMessage()));
+		Arm();
 	}
-	//HandlePtr piHandle(pi.pi.hProcess);
+	finally
+	{
+		System::Threading::Monitor::Exit(m_lock);
+	}
+}
 
-	// Wait for the process to exit.
-	WaitForSingleObject(piHandle.get(), INFINITE);
+/**
+ * Releases a launch that never completed; a session that is still waiting is kept alive by its wait.
+ */
+TerminalSession::!TerminalSession()
+{
+	delete static_cast<TerminalLaunch*>(m_launch);
+	m_launch = nullptr;
+}
 
-	merged.reset();
-	cmdLine.reset();
+/**
+ * Registers a one-shot thread pool wait on the handle of the launch's next step, replacing the
+ * previous one, or queues a blocking wait if the backend has no handle. Called with m_lock held, so
+ * a wait that fires at once runs after the registration is stored.
+ */
+void TerminalSession::Arm()
+{
+	if (m_registration != nullptr)
+	{
+		m_registration->Unregister(nullptr);
+		m_registration = nullptr;
+	}
+	void* handle = static_cast<TerminalLaunch*>(m_launch)->WaitHandle();
+	if (handle == nullptr)
+	{
+		System::Threading::ThreadPool::QueueUserWorkItem(gcnew System::Threading::WaitCallback(this, &TerminalSession::OnBlockingWait));
+		return;
+	}
+	m_waitHandle = gcnew BorrowedWaitHandle(System::IntPtr(handle));
+	m_registration = System::Threading::ThreadPool::RegisterWaitForSingleObject(m_waitHandle,
+		gcnew System::Threading::WaitOrTimerCallback(this, &TerminalSession::OnSignalled), nullptr, System::Threading::Timeout::Infinite, true);
+}
 
-	DWORD exitCode = 0;
-	if (!GetExitCodeProcess(piHandle.get(), &exitCode))
+/**
+ * Advances the launch once its handle is signalled: an elevated launcher that handed the terminal
+ * over is followed by a wait on the terminal, a terminal that exited completes the session.
+ */
+void TerminalSession::OnSignalled(System::Object^ state, bool timedOut)
+{
+	System::Threading::Monitor::Enter(m_lock);
+	try
 	{
-		throw gcnew System::Exception(ctx->marshal_as<System::String^>(WinApiHelpers::GetLastErrorMessage()));
+		if (Step(0))
+		{
+			Release();
+		}
+		else
+		{
+			Arm();
+		}
 	}
+	finally
+	{
+		System::Threading::Monitor::Exit(m_lock);
+	}
+}
 
-	if (exitCode != 0)
+/**
+ * Waits for a launch of a backend without wait handles on a thread pool thread.
+ */
+void TerminalSession::OnBlockingWait(System::Object^ state)
+{
+	System::Threading::Monitor::Enter(m_lock);
+	try
 	{
-		throw gcnew System::Exception(ctx->marshal_as<System::String^>(FormatProcessExitCode(exitCode)));
+		Step(LaunchBackend::Infinite);
+		Release();
 	}
+	finally
+	{
+		System::Threading::Monitor::Exit(m_lock);
+	}
+}
 
-	return static_cast<int>(exitCode);
+/**
+ * Waits for the launch and completes the session if it is done.
+ *
+ * @param timeoutMilliseconds How long to wait.
+ *
+ * @return false if the terminal still runs.
+ */
+bool TerminalSession::Step(unsigned int timeoutMilliseconds)
+{
+	TerminalLaunch* launch = static_cast<TerminalLaunch*>(m_launch);
+	uint32_t exitCode = 0;
+	LaunchError error;
+	const LaunchWaitResult result = launch->Wait(timeoutMilliseconds, exitCode, error);
+	m_processId = static_cast<int>(launch->ProcessId());
+	if (result == LaunchWaitResult::Timeout)
+	{
+		return false;
+	}
+	if (result == LaunchWaitResult::Failed)
+	{
+		m_exited->TrySetException(LaunchFailure(error));
+	}
+	else if (exitCode != 0)
+	{
+		m_exited->TrySetException(ExitFailure("launch.exited", exitCode, marshal_as<std::wstring>(m_applicationPath).c_str()));
+	}
+	else
+	{
+		m_exited->TrySetResult(0);
+	}
+	return true;
+}
+
+/**
+ * Drops the wait and the native launch once the session completed.
+ */
+void TerminalSession::Release()
+{
+	if (m_registration != nullptr)
+	{
+		m_registration->Unregister(nullptr);
+		m_registration = nullptr;
+	}
+	m_waitHandle = nullptr;
+	delete static_cast<TerminalLaunch*>(m_launch);
+	m_launch = nullptr;
+}
+
+
+/**
+ * Launches a process with a custom environment block.
+ * Returns the exit code of the process.
+ * Throws an exception if the process could not be started.
+ * @param applicationPath Path to the application executable
+ * @param commandLine Command line arguments
+ * @param envBlock Encoded environment block (e.g. "VAR1=Value1;VAR2=Value2")
+ */
+int ProcessLauncher::LaunchProcess(System::String^ applicationPath, System::String^ commandLine, System::String^ envBlock, System::String^ hookPath)
+{
+	return LaunchProcess(applicationPath, commandLine, envBlock, hookPath, nullptr);
+}
+
+/**
+ * Launches a process with a custom environment block and a launch policy.
+ *
+ * The launch waits for a slot of the shared scheduler, creates the process suspended at the policy's
+ * priority, restricts its affinity (inherited by the terminal it starts), resumes it when the scheduler
+ * allows, and keeps the slot until the terminal's window is ready. The sequence is the native
+ * TerminalLauncher's, shared with the flat launch API.
+ * @param policy The launch policy, or null for the default one
+ */
+int ProcessLauncher::LaunchProcess(System::String^ applicationPath, System::String^ commandLine, System::String^ envBlock, System::String^ hookPath, TerminalLaunchPolicy^ policy)
+{
+	return RunToExit(ToNativeRequest(nullptr, applicationPath, commandLine, envBlock, hookPath, policy));
 }
 
 /**
  * Launches an elevated process via a launcher executable.
  * The launcher (with a UAC manifest) starts the target process using the provided encoded environment block.
- * Returns the exit code of the target process.
+ * Returns the session of the target process once the launcher runs.
  * Throws an exception if the launcher could not be started.
  * @param launcherPath Path to the launcher executable
  * @param applicationPath Path to the target application executable
  * @param commandLine Command line arguments
  * @param envBlock Encoded environment block (e.g. "VAR1=Value1;VAR2=Value2")
  */
-int ProcessLauncher::LaunchProcessElevated(System::String^ launcherPath, System::String^ applicationPath, System::String^ commandLine, System::String^ envBlock, System::String^ hookPath)
+TerminalSession^ ProcessLauncher::LaunchProcessElevated(System::String^ launcherPath, System::String^ applicationPath, System::String^ commandLine, System::String^ envBlock, System::String^ hookPath)
 {
-	msclr::auto_handle<msclr::interop::marshal_context> ctx(gcnew msclr::interop::marshal_context());
-	const wchar_t* _launcher = ctx->marshal_as<const wchar_t*>(launcherPath);
-	const wchar_t* _appPath = ctx->marshal_as<const wchar_t*>(applicationPath);
-	const wchar_t* _cmdLine = ctx->marshal_as<const wchar_t*>(commandLine);
-	const wchar_t* _env = ctx->marshal_as<const wchar_t*>(envBlock);
-	const wchar_t* _hook = ctx->marshal_as<const wchar_t*>(hookPath);
-
-	std::wstring launcher(_launcher);
-	std::wstring appPath(_appPath);
-	std::wstring cmdLine(_cmdLine);
-	std::wstring env(_env);
-	std::wstring hook(_hook);
-
-	// Helper lambda to properly quote an argument by escaping internal quotes.
-	//auto QuoteArgument = [](const std::wstring& arg) -> std::wstring {
-	//	std::wstringstream result;
-	//	result << L"\"";
-	//	for (wchar_t ch : arg) {
-	//		if (ch == L'\"') {
-	//			result << L"\\\"";
-	//		}
-	//		else {
-	//			result << ch;
-	//		}
-	//	}
-	//	result << L"\"";
-	//	return result.str();
-	//};
-
-	std::wstring parameters = QuoteArgument(appPath) + L" " + QuoteArgument(cmdLine) + L" " + QuoteArgument(env) + L" " + QuoteArgument(hook);
-
-	shellexecuteinfow_raii sei;
-	sei.sei.cbSize = sizeof(sei);
-	sei.sei.fMask = SEE_MASK_NOCLOSEPROCESS;
-	sei.sei.lpVerb = L"runas"; // Request elevation (UAC prompt)
-	sei.sei.lpFile = launcher.c_str();
-	sei.sei.lpParameters = parameters.c_str();
-	sei.sei.nShow = SW_HIDE;
+	return LaunchProcessElevated(launcherPath, applicationPath, commandLine, envBlock, hookPath, nullptr);
+}
 
-	if (!ShellExecuteEx((SHELLEXECUTEINFOW*)sei))
+/**
+ * Launches an elevated process via a launcher executable, with a launch policy.
+ *
+ * The policy and the LocalState folder are passed to the launcher, which applies the policy to the
+ * target process. Once the terminal runs, the launcher hands a handle to it back through a pipe and
+ * exits, and the session registers the terminal and waits for it on the thread pool. If the pipe cannot
+ * be created or the handoff fails, the launcher registers the terminal and stays until it exits, as it
+ * used to, and the session waits for the launcher instead. The scheduler slot is held until the
+ * launcher has started.
+ * @param policy The launch policy, or null for the default one
+ */
+TerminalSession^ ProcessLauncher::LaunchProcessElevated(System::String^ launcherPath, System::String^ applicationPath, System::String^ commandLine, System::String^ envBlock, System::String^ hookPath, TerminalLaunchPolicy^ policy)
+{
+	if (launcherPath == nullptr)
 	{
-		throw gcnew System::Exception(ctx->marshal_as<System::String^>(WinApiHelpers::GetLastErrorMessage()));
+		throw gcnew System::ArgumentNullException(L"launcherPath");
 	}
+	return StartSession(ToNativeRequest(launcherPath, applicationPath, commandLine, envBlock, hookPath, policy));
+}
 
-	// Wait for the launcher executable to complete.
-	WaitForSingleObject(sei.sei.hProcess, INFINITE);
+/**
+ * Compiles the launch plan of a LocalState copy.
+ *
+ * The package is probed and the request built here, off the click path; see LaunchPlan.
+ * @param packageFolder The installed location of the terminal package
+ * @param defaultLocalState The package's own LocalState, which the hook redirects from
+ * @param localStateFolder The copy the terminal runs on
+ * @param launcherPath The elevated launcher, or null for a direct launch
+ * @param policy The launch policy, or null for the default one
+ */
+TerminalLaunchPlan^ ProcessLauncher::CompilePlan(System::String^ packageFolder, System::String^ defaultLocalState, System::String^ localStateFolder, System::String^ hookPath, System::String^ launcherPath, TerminalLaunchPolicy^ policy)
+{
+	if (packageFolder == nullptr || defaultLocalState == nullptr || localStateFolder == nullptr || hookPath == nullptr)
+	{
+		throw gcnew System::ArgumentNullException(packageFolder == nullptr ? L"packageFolder"
+			: defaultLocalState == nullptr ? L"defaultLocalState"
+			: localStateFolder == nullptr ? L"localStateFolder" : L"hookPath");
+	}
 
-	DWORD exitCode = 0;
-	if (!GetExitCodeProcess(sei.sei.hProcess, &exitCode))
+	LaunchPlanSource source;
+	source.packageFolder = marshal_as<std::wstring>(packageFolder);
+	source.defaultLocalState = marshal_as<std::wstring>(defaultLocalState);
+	source.localStateFolder = marshal_as<std::wstring>(localStateFolder);
+	source.hookPath = marshal_as<std::wstring>(hookPath);
+	if (launcherPath != nullptr)
 	{
-		throw gcnew System::Exception(ctx->marshal_as<System::String^>(WinApiHelpers::GetLastErrorMessage()));
+		source.launcherPath = marshal_as<std::wstring>(launcherPath);
 	}
+	source.policy = ToNativePolicy(policy);
 
-	if (exitCode == -1)
+	std::wstring missingFile;
+	std::error_code ec;
+	std::shared_ptr<const LaunchPlan> plan = LaunchPlan::Compile(source, missingFile, ec);
+	if (!plan)
 	{
-		throw gcnew System::Exception(ctx->marshal_as<System::String^>(WinApiHelpers::GetLastErrorMessage()));
+		System::String^ file = gcnew System::String(missingFile.c_str(), 0, static_cast<int>(missingFile.size()));
+		throw gcnew System::IO::FileNotFoundException(System::String::Format(L"File not found.\n{0}", file), file);
 	}
-	else if (exitCode != 0)
+	return gcnew TerminalLaunchPlan(new std::shared_ptr<const LaunchPlan>(std::move(plan)));
+}
+
+/**
+ * Launches a compiled plan and waits for its terminal to exit.
+ *
+ * The plan is kept alive by a reference of its own for as long as the launch runs, so the managed
+ * plan may be replaced or disposed meanwhile.
+ * @param plan The plan
+ */
+int ProcessLauncher::Launch(TerminalLaunchPlan^ plan)
+{
+	if (plan == nullptr || plan->NativePlan == nullptr)
 	{
-		throw gcnew System::Exception(ctx->marshal_as<System::String^>(FormatProcessExitCode(exitCode)));
+		throw gcnew System::ArgumentNullException(L"plan");
 	}
+	const std::shared_ptr<const LaunchPlan> native = *static_cast<std::shared_ptr<const LaunchPlan>*>(plan->NativePlan);
+	System::GC::KeepAlive(plan);
+	return RunToExit(native->Request());
+}
 
-	return static_cast<int>(exitCode);
+/**
+ * Starts a compiled plan without waiting for its terminal to exit.
+ *
+ * The launch keeps what it needs of the plan, which may be replaced or disposed once this returns.
+ * @param plan The plan
+ */
+TerminalSession^ ProcessLauncher::Start(TerminalLaunchPlan^ plan)
+{
+	if (plan == nullptr || plan->NativePlan == nullptr)
+	{
+		throw gcnew System::ArgumentNullException(L"plan");
+	}
+	const std::shared_ptr<const LaunchPlan> native = *static_cast<std::shared_ptr<const LaunchPlan>*>(plan->NativePlan);
+	System::GC::KeepAlive(plan);
+	return StartSession(native->Request());
 }
@@ -1,6 +1,59 @@
 #pragma once
 
+#include "LaunchSchedulerWrapper.h"
+#include "LaunchPlanWrapper.h"
+
 namespace WTLayoutManager::Services{
+    /// <summary>
+    /// A started terminal, waited for on the thread pool: no thread is held while it runs.
+    /// </summary>
+    public ref class TerminalSession sealed
+    {
+    public:
+        /// <summary>
+        /// The terminal process, or 0 while an elevated launch has not handed it over yet.
+        /// </summary>
+        property int ProcessId { int get() { return m_processId; } }
+
+        /// <summary>
+        /// Completes with 0 once the terminal exits; faults as ProcessLauncher.Launch throws, with an
+        /// ExternalException for another exit code and a Win32Exception if the terminal could not be waited for.
+        /// </summary>
+        property System::Threading::Tasks::Task<int>^ Exited { System::Threading::Tasks::Task<int>^ get() { return m_exited->Task; } }
+
+        !TerminalSession();
+
+    internal:
+        /// <summary>
+        /// Takes over a native TerminalLaunch and starts waiting for it.
+        /// </summary>
+        TerminalSession(void* launch, System::String^ applicationPath);
+
+    private:
+        /// <summary>
+        /// A native handle the thread pool can wait on; the launch owns the handle.
+        /// </summary>
+        ref class BorrowedWaitHandle sealed : System::Threading::WaitHandle
+        {
+        public:
+            BorrowedWaitHandle(System::IntPtr handle);
+        };
+
+        void Arm();
+        void OnSignalled(System::Object^ state, bool timedOut);
+        void OnBlockingWait(System::Object^ state);
+        bool Step(unsigned int timeoutMilliseconds);
+        void Release();
+
+        void* m_launch;
+        System::String^ m_applicationPath;
+        System::Threading::Tasks::TaskCompletionSource<int>^ m_exited;
+        System::Threading::WaitHandle^ m_waitHandle;
+        System::Threading::RegisteredWaitHandle^ m_registration;
+        System::Object^ m_lock;
+        int m_processId;
+    };
+
     /// <summary>
     /// Provides methods for launching processes with custom environment configurations.
     /// </summary>
@@ -14,13 +67,46 @@ namespace WTLayoutManager::Services{
         /// </summary>
         static int LaunchProcess(System::String^ applicationPath, System::String^ commandLine, System::String^ envBlock, System::String^ hookPath);
 
+        /// <summary>
+        /// Launches a process as LaunchProcess does, queued in the shared launch scheduler and started
+        /// with the priority and processor placement of policy (null for the default policy).
+        /// </summary>
+        static int LaunchProcess(System::String^ applicationPath, System::String^ commandLine, System::String^ envBlock, System::String^ hookPath, TerminalLaunchPolicy^ policy);
+
         /// <summary>
         /// Launches an elevated process via a launcher executable.
         /// The launcher (with a UAC manifest) starts the target process using the provided encoded environment block.
-        /// Returns the exit code of the target process.
+        /// Returns once the launcher runs, with the session the terminal is handed over to; no thread waits for it.
         /// Throws an exception if the launcher could not be started.
         /// </summary>
-        static int LaunchProcessElevated(System::String^ launcherPath, System::String^ applicationPath, System::String^ commandLine, System::String^ envBlock, System::String^ hookPath);
+        static TerminalSession^ LaunchProcessElevated(System::String^ launcherPath, System::String^ applicationPath, System::String^ commandLine, System::String^ envBlock, System::String^ hookPath);
+
+        /// <summary>
+        /// Launches an elevated process as LaunchProcessElevated does; the launcher applies policy
+        /// (null for the default policy) to the target process.
+        /// </summary>
+        static TerminalSession^ LaunchProcessElevated(System::String^ launcherPath, System::String^ applicationPath, System::String^ commandLine, System::String^ envBlock, System::String^ hookPath, TerminalLaunchPolicy^ policy);
+
+        /// <summary>
+        /// Resolves the terminal of a package (wt.exe, else wtd.exe) and prebuilds the launch of a LocalState
+        /// copy with the hook redirecting defaultLocalState to it. launcherPath is the elevated launcher, or
+        /// null for a direct launch; the LocalStateFolder of policy is ignored.
+        /// Throws FileNotFoundException if the terminal or the hook is missing.
+        /// </summary>
+        static TerminalLaunchPlan^ CompilePlan(System::String^ packageFolder, System::String^ defaultLocalState, System::String^ localStateFolder, System::String^ hookPath, System::String^ launcherPath, TerminalLaunchPolicy^ policy);
+
+        /// <summary>
+        /// Launches a compiled plan as LaunchProcess does, elevated or not.
+        /// Returns the exit code of the terminal; throws as LaunchProcess does.
+        /// </summary>
+        static int Launch(TerminalLaunchPlan^ plan);
+
+        /// <summary>
+        /// Starts a compiled plan and returns once the terminal runs, or for an elevated plan once the
+        /// launcher runs, with the session that completes when the terminal exits.
+        /// Throws an exception if the terminal or the launcher could not be started.
+        /// </summary>
+        static TerminalSession^ Start(TerminalLaunchPlan^ plan);
     };
 
     /// <summary>
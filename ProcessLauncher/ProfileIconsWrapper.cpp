@@ -0,0 +1,56 @@
+﻿#include "pch.h"
+#include "new.h"
+#include "ProfileIconResolver.h"
+#include "ProfileIconsWrapper.h"
+#include "InternedStringsWrapper.h"
+#include <string>
+#include <string_view>
+#include <vcclr.h>
+
+using namespace WTLayoutManager::Services;
+
+/**
+ * Returns a view of a managed string's characters; null yields an empty view.
+ *
+ * The caller must keep the string pinned while the view is in use.
+ */
+static std::u16string_view ViewOf(const wchar_t* chars, System::String^ s)
+{
+	if (s == nullptr)
+	{
+		return std::u16string_view();
+	}
+	return std::u16string_view(reinterpret_cast<const char16_t*>(chars), s->Length);
+}
+
+/**
+ * Resolves the icon of a profile through the native memoized resolver.
+ *
+ * @param guid The profile guid.
+ * @param icon The profile icon.
+ * @param source The profile source.
+ * @param name The profile name.
+ * @return A file path or a pack URI of a bundled asset, one instance per distinct icon.
+ */
+System::String^ ProfileIcons::Resolve(System::String^ guid, System::String^ icon, System::String^ source, System::String^ name)
+{
+	pin_ptr<const wchar_t> guidChars = PtrToStringChars(guid); // PtrToStringChars maps null to null
+	pin_ptr<const wchar_t> iconChars = PtrToStringChars(icon);
+	pin_ptr<const wchar_t> sourceChars = PtrToStringChars(source);
+	pin_ptr<const wchar_t> nameChars = PtrToStringChars(name);
+
+	const uint32_t resolved = ProfileIconResolver::ResolveId(
+		ViewOf(guidChars, guid),
+		ViewOf(iconChars, icon),
+		ViewOf(sourceChars, source),
+		ViewOf(nameChars, name));
+	return InternedStrings::FromId(resolved);
+}
+
+/**
+ * Clears the native memo.
+ */
+void ProfileIcons::Reset()
+{
+	ProfileIconResolver::ClearMemo();
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// Provides managed access to the native, process-wide memoized profile icon resolver.
+    /// </summary>
+    public ref class ProfileIcons
+    {
+    public:
+        /// <summary>
+        /// Returns the icon file path or bundled asset pack URI for a settings.json profile.
+        /// Null arguments are treated as missing fields.
+        /// </summary>
+        static System::String^ Resolve(System::String^ guid, System::String^ icon, System::String^ source, System::String^ name);
+
+        /// <summary>
+        /// Forgets every memoized icon, so the next lookups probe the file system again.
+        /// </summary>
+        static void Reset();
+    };
+}
@@ -0,0 +1,56 @@
+﻿#include "pch.h"
+#include "new.h"
+#include "ResourceAccounting.h"
+#include "ResourceAccountingWrapper.h"
+#include <string>
+#include <vector>
+#include <msclr/marshal_cppstd.h>
+
+using namespace msclr::interop;
+using namespace WTLayoutManager::Services;
+
+static TerminalResourceUsage^ ToManaged(const FolderResources& resources)
+{
+	TerminalResourceUsage^ usage = gcnew TerminalResourceUsage();
+	usage->Folder = gcnew System::String(resources.folder.c_str(), 0, static_cast<int>(resources.folder.size()));
+	usage->CpuTime = System::TimeSpan::FromTicks(static_cast<long long>(resources.usage.cpuMicroseconds) * 10);
+	usage->PeakMemoryBytes = static_cast<long long>(resources.usage.peakMemoryBytes);
+	usage->ReadBytes = static_cast<long long>(resources.usage.readBytes);
+	usage->WriteBytes = static_cast<long long>(resources.usage.writeBytes);
+	usage->ActiveProcesses = static_cast<int>(resources.usage.activeProcesses);
+	usage->TotalProcesses = static_cast<int>(resources.usage.totalProcesses);
+	usage->Launches = static_cast<int>(resources.launches);
+	usage->RunningTerminals = static_cast<int>(resources.running);
+	return usage;
+}
+
+/**
+ * Reads the usage recorded for a folder.
+ *
+ * @param folder The LocalState folder, as passed in TerminalLaunchPolicy.LocalStateFolder.
+ * @return The usage, or null.
+ */
+TerminalResourceUsage^ TerminalResources::ForFolder(System::String^ folder)
+{
+	if (folder == nullptr)
+	{
+		throw gcnew System::ArgumentNullException(L"folder");
+	}
+	FolderResources resources;
+	if (!ResourceLedger::Shared().Find(marshal_as<std::wstring>(folder), resources))
+	{
+		return nullptr;
+	}
+	return ToManaged(resources);
+}
+
+array<TerminalResourceUsage^>^ TerminalResources::Snapshot()
+{
+	const std::vector<FolderResources> folders = ResourceLedger::Shared().Snapshot();
+	array<TerminalResourceUsage^>^ usages = gcnew array<TerminalResourceUsage^>(static_cast<int>(folders.size()));
+	for (int i = 0; i < usages->Length; ++i)
+	{
+		usages[i] = ToManaged(folders[i]);
+	}
+	return usages;
+}
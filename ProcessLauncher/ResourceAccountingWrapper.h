@@ -0,0 +1,46 @@
+#pragma once
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// What the terminals launched for one LocalState folder used, in this run of the app.
+    /// </summary>
+    public ref class TerminalResourceUsage
+    {
+    public:
+        property System::String^ Folder;
+
+        /// <summary>
+        /// User and kernel time of every process of every launch.
+        /// </summary>
+        property System::TimeSpan CpuTime;
+
+        /// <summary>
+        /// The highest memory use of one launch, all of its processes together.
+        /// </summary>
+        property long long PeakMemoryBytes;
+        property long long ReadBytes;
+        property long long WriteBytes;
+        property int ActiveProcesses;
+        property int TotalProcesses;
+        property int Launches;
+        property int RunningTerminals;
+    };
+
+    /// <summary>
+    /// Reads the per-folder resource ledger the launches record into; running terminals are sampled
+    /// every two seconds.
+    /// </summary>
+    public ref class TerminalResources
+    {
+    public:
+        /// <summary>
+        /// Returns the usage of one folder, or null if no terminal was launched for it.
+        /// </summary>
+        static TerminalResourceUsage^ ForFolder(System::String^ folder);
+
+        /// <summary>
+        /// Returns the usage of every folder a terminal was launched for.
+        /// </summary>
+        static array<TerminalResourceUsage^>^ Snapshot();
+    };
+}
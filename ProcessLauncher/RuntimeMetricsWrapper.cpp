@@ -0,0 +1,39 @@
+﻿#include "pch.h"
+#include "new.h"
+#include "RuntimeMetrics.h"
+#include "RuntimeMetricsWrapper.h"
+
+using namespace WTLayoutManager::Services;
+
+static_assert(static_cast<size_t>(RuntimeCounter::HookEventsDropped) + 1 == MetricCounterCount,
+	"RuntimeCounter must mirror MetricCounter");
+static_assert(static_cast<size_t>(RuntimeHistogram::HookInit) + 1 == MetricHistogramCount,
+	"RuntimeHistogram must mirror MetricHistogram");
+
+/**
+ * Adds to a native counter.
+ *
+ * @param counter The counter.
+ * @param delta The amount; negative to lower a gauge.
+ */
+void MetricsPublisher::Add(RuntimeCounter counter, long long delta)
+{
+	RuntimeMetrics::Add(static_cast<MetricCounter>(counter), delta);
+}
+
+void MetricsPublisher::Increment(RuntimeCounter counter)
+{
+	RuntimeMetrics::Add(static_cast<MetricCounter>(counter), 1);
+}
+
+/**
+ * Records a duration in a native histogram.
+ *
+ * @param histogram The histogram.
+ * @param elapsed The duration; negative durations count as zero.
+ */
+void MetricsPublisher::Record(RuntimeHistogram histogram, System::TimeSpan elapsed)
+{
+	const long long micros = elapsed.Ticks / 10; // a tick is 100 ns
+	RuntimeMetrics::Record(static_cast<MetricHistogram>(histogram), micros > 0 ? static_cast<uint64_t>(micros) : 0);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// The counters of the shared metrics page, in the order of the native MetricCounter.
+    /// </summary>
+    public enum class RuntimeCounter
+    {
+        LaunchesStarted,
+        LaunchesSucceeded,
+        LaunchesFailed,
+        NormalLaunches,
+        ElevatedLaunches,
+        TerminalDiscoveryRetries,
+        TerminalDiscoveryTimeouts,
+        StateParses,
+        SettingsParses,
+        LayoutCacheHits,
+        LayoutCacheMisses,
+        ProfileIconHits,
+        ProfileIconMisses,
+        WatchedProcesses,
+        HookAttaches,
+        HookFileOpensRewritten,
+        HookRedirectFailures,
+        HookEventsDropped
+    };
+
+    /// <summary>
+    /// The duration histograms of the shared metrics page, in the order of the native MetricHistogram.
+    /// </summary>
+    public enum class RuntimeHistogram
+    {
+        TerminalDiscovery,
+        StateParse,
+        SettingsParse,
+        FolderLoad,
+        HookAttach,
+        HookInit
+    };
+
+    /// <summary>
+    /// Publishes managed measurements in the native shared metrics page, next to the launcher's.
+    /// </summary>
+    public ref class MetricsPublisher
+    {
+    public:
+        /// <summary>
+        /// Adds delta to a counter.
+        /// </summary>
+        static void Add(RuntimeCounter counter, long long delta);
+
+        /// <summary>
+        /// Adds one to a counter.
+        /// </summary>
+        static void Increment(RuntimeCounter counter);
+
+        /// <summary>
+        /// Records a duration, with microsecond resolution.
+        /// </summary>
+        static void Record(RuntimeHistogram histogram, System::TimeSpan elapsed);
+    };
+}
@@ -0,0 +1,99 @@
+﻿#include "pch.h"
+#include "new.h"
+#include "MappedFile.h"
+#include "SettingsProfileScanner.h"
+#include "StringPool.h"
+#include "SettingsProfileWrapper.h"
+#include "InternedStringsWrapper.h"
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <msclr/marshal_cppstd.h>
+
+using namespace msclr::interop;
+using namespace System::Collections::Generic;
+using namespace WTLayoutManager::Services;
+
+/**
+ * Decodes a raw JSON string view into a pooled managed string.
+ *
+ * @param raw The view returned by the scanner; a null view yields a null string.
+ * @param scratch Reusable decoding buffer.
+ * @param value Receives the managed string.
+ * @return false if the string contains an invalid escape sequence.
+ */
+static bool ToManaged(std::string_view raw, std::u16string& scratch, System::String^% value)
+{
+	value = nullptr;
+	if (raw.data() == nullptr)
+	{
+		return true;
+	}
+	if (!SettingsProfileScanner::Decode(raw, scratch))
+	{
+		return false;
+	}
+	value = InternedStrings::FromId(StringPool::Shared().Intern(scratch));
+	return true;
+}
+
+/**
+ * Extracts the profiles of a settings.json file.
+ *
+ * The file is mapped and scanned in place; only profiles.list is visited and only the name,
+ * hidden, icon, source and guid fields are turned into managed strings.
+ *
+ * @param filePath Path of the settings.json file.
+ * @return The profiles in file order, or nullptr if the file could not be read by the scanner.
+ */
+List<SettingsProfile^>^ SettingsProfileReader::Read(System::String^ filePath)
+{
+	if (filePath == nullptr)
+	{
+		return nullptr;
+	}
+
+	MappedFile file;
+	if (!file.Open(std::filesystem::path(marshal_as<std::wstring>(filePath))))
+	{
+		return nullptr;
+	}
+
+	std::vector<SettingsProfileFields> fields;
+	if (!SettingsProfileScanner::Extract(file.data(), file.size(), fields))
+	{
+		return nullptr;
+	}
+
+	List<SettingsProfile^>^ profiles = gcnew List<SettingsProfile^>(static_cast<int>(fields.size()));
+	std::u16string scratch;
+	for (const SettingsProfileFields& f : fields)
+	{
+		SettingsProfile^ profile = gcnew SettingsProfile();
+		System::String^ value;
+		if (!ToManaged(f.name, scratch, value))
+		{
+			return nullptr;
+		}
+		profile->Name = value;
+		if (!ToManaged(f.icon, scratch, value))
+		{
+			return nullptr;
+		}
+		profile->Icon = value;
+		if (!ToManaged(f.source, scratch, value))
+		{
+			return nullptr;
+		}
+		profile->Source = value;
+		if (!ToManaged(f.guid, scratch, value))
+		{
+			return nullptr;
+		}
+		profile->Guid = value;
+		profile->Hidden = f.hidden;
+		profiles->Add(profile);
+	}
+	return profiles;
+}
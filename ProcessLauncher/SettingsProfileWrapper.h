@@ -0,0 +1,31 @@
+#pragma once
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// The fields of one settings.json profile read by the native on-demand scanner.
+    /// String properties are null when the field is missing or null in the file.
+    /// </summary>
+    public ref class SettingsProfile
+    {
+    public:
+        property System::String^ Name;
+        property System::String^ Icon;
+        property System::String^ Source;
+        property System::String^ Guid;
+        property bool Hidden;
+    };
+
+    /// <summary>
+    /// Provides managed access to the native settings.json profile scanner.
+    /// </summary>
+    public ref class SettingsProfileReader
+    {
+    public:
+        /// <summary>
+        /// Maps a settings.json file and extracts profiles.list without parsing the rest of the document.
+        /// Returns nullptr if the file cannot be mapped or the scanner finds it malformed, so the caller
+        /// can fall back to a full parse (which reports the error).
+        /// </summary>
+        static System::Collections::Generic::List<SettingsProfile^>^ Read(System::String^ filePath);
+    };
+}
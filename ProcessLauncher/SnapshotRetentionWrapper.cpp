@@ -0,0 +1,112 @@
+﻿#include "pch.h"
+#include "new.h"
+#include "SnapshotRetention.h"
+#include "SnapshotRetentionWrapper.h"
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <msclr/marshal_cppstd.h>
+
+using namespace msclr::interop;
+using namespace System::Collections::Generic;
+using namespace WTLayoutManager::Services;
+
+static_assert(static_cast<int>(RetentionDecision::Evict) == static_cast<int>(RetentionAction::Evict),
+	"RetentionDecision must mirror RetentionAction");
+
+static std::filesystem::path ToPath(System::String^ s, const wchar_t* name)
+{
+	if (s == nullptr)
+	{
+		throw gcnew System::ArgumentNullException(gcnew System::String(name));
+	}
+	return std::filesystem::path(marshal_as<std::wstring>(s));
+}
+
+static System::IO::IOException^ ToException(System::String^ what, System::String^ path, const std::error_code& ec)
+{
+	return gcnew System::IO::IOException(System::String::Format(L"{0} '{1}': {2}", what, path,
+		gcnew System::String(ec.message().c_str())));
+}
+
+RetentionBudget^ RetentionBudget::Load(System::String^ baseFolder)
+{
+	const RetentionPolicy policy = SnapshotRetention::LoadPolicy(ToPath(baseFolder, L"baseFolder"));
+	RetentionBudget^ budget = gcnew RetentionBudget();
+	budget->MaxCount = static_cast<int>(std::min<uint32_t>(policy.maxCount, INT32_MAX));
+	budget->MaxBytes = static_cast<long long>(std::min<uint64_t>(policy.maxBytes, INT64_MAX));
+	return budget;
+}
+
+void RetentionBudget::Save(System::String^ baseFolder)
+{
+	RetentionPolicy policy;
+	policy.maxCount = MaxCount > 0 ? static_cast<uint32_t>(MaxCount) : 0;
+	policy.maxBytes = MaxBytes > 0 ? static_cast<uint64_t>(MaxBytes) : 0;
+	std::error_code ec;
+	if (!SnapshotRetention::SavePolicy(ToPath(baseFolder, L"baseFolder"), policy, ec))
+	{
+		throw ToException(L"Failed to save the retention budget of", baseFolder, ec);
+	}
+}
+
+/**
+ * Plans the retention of the copies under a folder.
+ *
+ * @param baseFolder The folder holding the copies.
+ * @param budget The budget.
+ * @return The plan; no copy is deleted.
+ */
+RetentionPlan^ LocalStateRetention::Plan(System::String^ baseFolder, RetentionBudget^ budget)
+{
+	if (budget == nullptr)
+	{
+		throw gcnew System::ArgumentNullException(L"budget");
+	}
+	RetentionPolicy policy;
+	policy.maxCount = budget->MaxCount > 0 ? static_cast<uint32_t>(budget->MaxCount) : 0;
+	policy.maxBytes = budget->MaxBytes > 0 ? static_cast<uint64_t>(budget->MaxBytes) : 0;
+	const RetentionReport report = SnapshotRetention::Plan(ToPath(baseFolder, L"baseFolder"), policy);
+
+	RetentionPlan^ plan = gcnew RetentionPlan();
+	plan->Copies = gcnew List<RetainedCopy^>(static_cast<int>(report.entries.size()));
+	plan->Evicted = gcnew List<System::String^>(static_cast<int>(report.evictedCount));
+	for (const RetentionEntry& entry : report.entries)
+	{
+		RetainedCopy^ copy = gcnew RetainedCopy();
+		copy->Path = gcnew System::String(entry.folder.wstring().c_str());
+		if (entry.hasLastRun)
+		{
+			copy->LastRun = System::DateTimeOffset::FromUnixTimeMilliseconds(entry.lastRunUnixMs).LocalDateTime;
+		}
+		copy->Bytes = static_cast<long long>(entry.bytes);
+		copy->IsPinned = entry.pinned;
+		copy->IsRunning = entry.running;
+		copy->Decision = static_cast<RetentionDecision>(entry.action);
+		plan->Copies->Add(copy);
+	}
+	for (const std::filesystem::path& folder : SnapshotRetention::Evicted(report))
+	{
+		plan->Evicted->Add(gcnew System::String(folder.wstring().c_str()));
+	}
+	plan->KeptCount = static_cast<int>(report.keptCount);
+	plan->KeptBytes = static_cast<long long>(report.keptBytes);
+	plan->EvictedCount = static_cast<int>(report.evictedCount);
+	plan->EvictedBytes = static_cast<long long>(report.evictedBytes);
+	return plan;
+}
+
+bool LocalStateRetention::IsPinned(System::String^ folder)
+{
+	return SnapshotRetention::IsPinned(ToPath(folder, L"folder"));
+}
+
+void LocalStateRetention::SetPinned(System::String^ folder, bool pinned)
+{
+	std::error_code ec;
+	if (!SnapshotRetention::SetPinned(ToPath(folder, L"folder"), pinned, ec))
+	{
+		throw ToException(pinned ? L"Failed to pin" : L"Failed to unpin", folder, ec);
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// What the retention budget decided for a LocalState copy.
+    /// </summary>
+    public enum class RetentionDecision
+    {
+        Keep,
+        KeepPinned,
+        KeepRunning,
+        Evict
+    };
+
+    /// <summary>
+    /// The count and size budget of the LocalState copies of one terminal package; 0 leaves a limit off.
+    /// </summary>
+    public ref class RetentionBudget sealed
+    {
+    public:
+        property int MaxCount;
+        property long long MaxBytes;
+
+        property bool IsLimited { bool get() { return MaxCount > 0 || MaxBytes > 0; } }
+
+        /// <summary>
+        /// Reads the budget saved next to the copies; no limits if none was saved.
+        /// </summary>
+        static RetentionBudget^ Load(System::String^ baseFolder);
+
+        /// <summary>
+        /// Saves the budget next to the copies. Throws IOException on failure.
+        /// </summary>
+        void Save(System::String^ baseFolder);
+    };
+
+    /// <summary>
+    /// A LocalState copy as the budget sees it.
+    /// </summary>
+    public ref class RetainedCopy sealed
+    {
+    public:
+        property System::String^ Path;
+        /// <summary>
+        /// The last write of the copy's state.json; null if it has none.
+        /// </summary>
+        property System::Nullable<System::DateTime> LastRun;
+        property long long Bytes;
+        property bool IsPinned;
+        property bool IsRunning;
+        property RetentionDecision Decision;
+    };
+
+    /// <summary>
+    /// The decisions of a budget over every copy, most recently run first. Nothing is deleted by a plan.
+    /// </summary>
+    public ref class RetentionPlan sealed
+    {
+    public:
+        property System::Collections::Generic::List<RetainedCopy^>^ Copies;
+        property int KeptCount;
+        property long long KeptBytes;
+        property int EvictedCount;
+        property long long EvictedBytes;
+
+        /// <summary>
+        /// The folders to delete, least recently run first; pass them to FolderOperation::StartDelete.
+        /// </summary>
+        property System::Collections::Generic::List<System::String^>^ Evicted;
+    };
+
+    /// <summary>
+    /// Keeps the LocalState copies within their budget: the least recently run ones go first, pinned copies
+    /// and copies a terminal runs are never evicted.
+    /// </summary>
+    public ref class LocalStateRetention abstract sealed
+    {
+    public:
+        /// <summary>
+        /// Measures the copies under a folder, on native threads, and applies the budget to them.
+        /// </summary>
+        static RetentionPlan^ Plan(System::String^ baseFolder, RetentionBudget^ budget);
+
+        static bool IsPinned(System::String^ folder);
+
+        /// <summary>
+        /// Pins or unpins a copy. Throws IOException on failure.
+        /// </summary>
+        static void SetPinned(System::String^ folder, bool pinned);
+    };
+}
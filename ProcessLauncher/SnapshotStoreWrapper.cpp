@@ -0,0 +1,99 @@
+﻿#include "pch.h"
+#include "new.h"
+#include "SnapshotStore.h"
+#include "SnapshotStoreWrapper.h"
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <msclr/marshal_cppstd.h>
+
+using namespace msclr::interop;
+using namespace WTLayoutManager::Services;
+
+static std::filesystem::path ToPath(System::String^ s, const wchar_t* name)
+{
+	if (s == nullptr)
+	{
+		throw gcnew System::ArgumentNullException(gcnew System::String(name));
+	}
+	return std::filesystem::path(marshal_as<std::wstring>(s));
+}
+
+/**
+ * Creates the managed exception for a failed file operation.
+ *
+ * @param what The operation, used as the message prefix.
+ * @param path The file or folder concerned.
+ * @param ec The error.
+ */
+static System::IO::IOException^ ToException(System::String^ what, System::String^ path, const std::error_code& ec)
+{
+	return gcnew System::IO::IOException(System::String::Format(L"{0} '{1}': {2}", what, path,
+		gcnew System::String(ec.message().c_str())));
+}
+
+LocalStateStore::LocalStateStore(System::String^ objectsDirectory)
+	: m_store(new SnapshotStore(ToPath(objectsDirectory, L"objectsDirectory")))
+{
+}
+
+/**
+ * Places a file into a LocalState copy.
+ *
+ * @param sourceFile The file to copy.
+ * @param targetFile The file to create.
+ * @return How the file was placed.
+ */
+LocalStatePlacement LocalStateStore::Place(System::String^ sourceFile, System::String^ targetFile)
+{
+	std::error_code ec;
+	const SnapshotPlacement placement = static_cast<SnapshotStore*>(m_store)->Place(
+		ToPath(sourceFile, L"sourceFile"), ToPath(targetFile, L"targetFile"), ec);
+	switch (placement)
+	{
+	case SnapshotPlacement::Reflinked:
+		return LocalStatePlacement::Reflinked;
+	case SnapshotPlacement::Linked:
+		return LocalStatePlacement::Linked;
+	case SnapshotPlacement::Copied:
+		return LocalStatePlacement::Copied;
+	default:
+		throw ToException(L"Failed to copy to", targetFile, ec);
+	}
+}
+
+int LocalStateStore::Detach(System::String^ folderPath)
+{
+	std::error_code ec;
+	const size_t detached = static_cast<SnapshotStore*>(m_store)->Detach(ToPath(folderPath, L"folderPath"), ec);
+	if (ec)
+	{
+		throw ToException(L"Failed to detach", folderPath, ec);
+	}
+	return static_cast<int>(detached);
+}
+
+void LocalStateStore::RemoveTree(System::String^ folderPath)
+{
+	std::error_code ec;
+	if (!static_cast<SnapshotStore*>(m_store)->RemoveTree(ToPath(folderPath, L"folderPath"), ec))
+	{
+		throw ToException(L"Failed to delete", folderPath, ec);
+	}
+}
+
+long long LocalStateStore::CollectGarbage()
+{
+	return static_cast<long long>(static_cast<SnapshotStore*>(m_store)->CollectGarbage().bytes);
+}
+
+LocalStateStore::~LocalStateStore()
+{
+	this->!LocalStateStore();
+}
+
+LocalStateStore::!LocalStateStore()
+{
+	delete static_cast<SnapshotStore*>(m_store);
+	m_store = nullptr;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+namespace WTLayoutManager::Services {
+    /// <summary>
+    /// How a file was placed into a LocalState copy.
+    /// </summary>
+    public enum class LocalStatePlacement
+    {
+        Reflinked,
+        Linked,
+        Copied
+    };
+
+    /// <summary>
+    /// Content-addressed store shared by the LocalState copies: identical settings.json/state.json files
+    /// are stored once and linked (or cloned) into every copy. Copies must be detached before Windows Terminal
+    /// runs on them, and removed through RemoveTree so the shared read-only files can be deleted.
+    /// </summary>
+    public ref class LocalStateStore sealed
+    {
+    public:
+        /// <summary>
+        /// Creates a store over an object directory, which should be on the same volume as the copies.
+        /// </summary>
+        LocalStateStore(System::String^ objectsDirectory);
+
+        /// <summary>
+        /// Places a copy of sourceFile at targetFile, replacing it. Throws IOException on failure.
+        /// </summary>
+        LocalStatePlacement Place(System::String^ sourceFile, System::String^ targetFile);
+
+        /// <summary>
+        /// Gives a LocalState copy private writable files; returns the number of files detached.
+        /// Throws IOException if a shared file could not be detached.
+        /// </summary>
+        int Detach(System::String^ folderPath);
+
+        /// <summary>
+        /// Deletes a LocalState copy. Throws IOException if something could not be deleted.
+        /// </summary>
+        void RemoveTree(System::String^ folderPath);
+
+        /// <summary>
+        /// Deletes the stored files no copy uses any more; returns the number of bytes freed.
+        /// </summary>
+        long long CollectGarbage();
+
+        ~LocalStateStore();
+        !LocalStateStore();
+
+    internal:
+        /// <summary>
+        /// The native SnapshotStore, for other wrappers that work through the store.
+        /// </summary>
+        property void* NativeStore { void* get() { return m_store; } }
+
+    private:
+        void* m_store;
+    };
+}
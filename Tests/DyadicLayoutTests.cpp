@@ -0,0 +1,78 @@
+﻿#include "Test.h"
+#include "DyadicLayout.h"
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	constexpr uint64_t Half = DyadicLayout::Unit / 2;
+	constexpr uint64_t Quarter = DyadicLayout::Unit / 4;
+
+	bool Equal(const DyadicRect& a, const DyadicRect& b)
+	{
+		return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+	}
+}
+
+TEST(ReplaysSplitsOfTheFocusedPane)
+{
+	// Right of the first pane, then down of the new one, then left of the first one.
+	const PaneSplit splits[] = {
+		{ 0, SplitDirection::Right },
+		{ 1, SplitDirection::Down },
+		{ 0, SplitDirection::Left },
+	};
+	DyadicRect panes[4];
+	DyadicLayout::Replay(splits, 3, panes);
+
+	CHECK(Equal(panes[0], DyadicRect{ Quarter, 0, Quarter, DyadicLayout::Unit }));
+	CHECK(Equal(panes[1], DyadicRect{ Half, 0, Half, Half }));
+	CHECK(Equal(panes[2], DyadicRect{ Half, Half, Half, Half }));
+	CHECK(Equal(panes[3], DyadicRect{ 0, 0, Quarter, DyadicLayout::Unit }));
+
+	GridPlacement placements[4];
+	int32_t rows = 0;
+	int32_t columns = 0;
+	DyadicLayout::ComputeGrid(panes, 4, placements, rows, columns);
+	CHECK(rows == 2);
+	CHECK(columns == 3);
+	CHECK(placements[0].column == 1 && placements[0].rowSpan == 2);
+	CHECK(placements[2].row == 1 && placements[2].column == 2);
+	CHECK(placements[3].column == 0 && placements[3].columnSpan == 1);
+}
+
+TEST(ReplayGivesUnknownSplitsNoArea)
+{
+	const PaneSplit splits[] = {
+		{ 0, SplitDirection::None },
+		{ 5, SplitDirection::Down },
+		{ 0, SplitDirection::Up },
+	};
+	DyadicRect panes[4];
+	DyadicLayout::Replay(splits, 3, panes);
+
+	const DyadicRect empty{ 0, 0, 0, 0 };
+	CHECK(Equal(panes[1], empty));
+	CHECK(Equal(panes[2], empty));
+	CHECK(Equal(panes[3], DyadicRect{ 0, 0, DyadicLayout::Unit, Half }));
+	CHECK(Equal(panes[0], DyadicRect{ 0, Half, DyadicLayout::Unit, Half }));
+}
+
+TEST(ReplayStopsHalvingAtFullPrecision)
+{
+	// Every split halves the new pane again; past 63 halvings the new panes share the last one.
+	std::vector<PaneSplit> splits;
+	for (uint32_t i = 0; i < 70; ++i)
+	{
+		splits.push_back({ i, SplitDirection::Right });
+	}
+	std::vector<DyadicRect> panes(splits.size() + 1);
+	DyadicLayout::Replay(splits.data(), splits.size(), panes.data());
+
+	CHECK(panes[63].width == 1);
+	CHECK(Equal(panes[64], panes[63]));
+	CHECK(Equal(panes[70], panes[63]));
+	CHECK(panes[62].width == 1);
+	CHECK(panes[63].x + panes[63].width == DyadicLayout::Unit);
+}
@@ -0,0 +1,213 @@
+﻿#include "Test.h"
+#include "FileOperationEngine.h"
+#include "SnapshotStore.h"
+#include <string>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	const std::u16string_view LayoutFiles[] = { u"settings.json", u"state.json" };
+
+	/// Waits for the operation and takes every completion, indexed by job.
+	std::vector<FileOperationCompletion> Drain(FileOperationEngine& engine)
+	{
+		engine.Wait();
+		CHECK(engine.IsFinished());
+		std::vector<FileOperationCompletion> completions;
+		FileOperationCompletion completion;
+		while (engine.TryTake(completion))
+		{
+			completions.push_back(completion);
+		}
+		return completions;
+	}
+
+	/// A LocalState folder with the layout files, a file that is not one and a subfolder.
+	fs::path MakeFolder(const fs::path& folder)
+	{
+		Tests::WriteFile(folder / "settings.json", "{\"profiles\":{\"list\":[]}}");
+		Tests::WriteFile(folder / "State.JSON", "{\"persistedWindowLayouts\":[]}");
+		Tests::WriteFile(folder / "notes.txt", "not a layout file");
+		Tests::WriteFile(folder / "backup" / "state.json", "{}");
+		return folder;
+	}
+}
+
+TEST(CopiesSelectedFiles)
+{
+	Tests::TempFolder folder;
+	const FileCopyJob jobs[] = {
+		{ MakeFolder(folder / "a"), folder / "copies" / "a" },
+		{ MakeFolder(folder / "b"), folder / "copies" / "b" },
+	};
+	FileOperationEngine engine(nullptr, folder / "trash");
+	CHECK(engine.StartCopy(jobs, 2, LayoutFiles, 2, 2));
+	const std::vector<FileOperationCompletion> completions = Drain(engine);
+	CHECK(completions.size() == 2);
+	for (const FileOperationCompletion& completion : completions)
+	{
+		CHECK(completion.job < 2);
+		CHECK(!completion.error);
+	}
+
+	// Names match without regard to case, in subfolders too.
+	for (const FileCopyJob& job : jobs)
+	{
+		CHECK(Tests::ReadFile(job.target / "settings.json") == Tests::ReadFile(job.source / "settings.json"));
+		CHECK(Tests::ReadFile(job.target / "State.JSON") == Tests::ReadFile(job.source / "State.JSON"));
+		CHECK(Tests::ReadFile(job.target / "backup" / "state.json") == "{}");
+		CHECK(!fs::exists(job.target / "notes.txt"));
+	}
+
+	const FileOperationProgress progress = engine.Progress();
+	CHECK(progress.jobsTotal == 2);
+	CHECK(progress.jobsDone == 2);
+	CHECK(progress.jobsFailed == 0);
+	CHECK(progress.filesDone == 6);
+	CHECK(progress.bytesDone == 2 * (fs::file_size(jobs[0].source / "settings.json") + fs::file_size(jobs[0].source / "State.JSON") + 2));
+}
+
+TEST(CopiesEveryFileWithoutNames)
+{
+	Tests::TempFolder folder;
+	const FileCopyJob job{ MakeFolder(folder / "a"), folder / "copy" };
+	FileOperationEngine engine(nullptr, folder / "trash");
+	CHECK(engine.StartCopy(&job, 1, nullptr, 0));
+	CHECK(Drain(engine).size() == 1);
+	CHECK(Tests::ReadFile(job.target / "notes.txt") == "not a layout file");
+	CHECK(engine.Progress().filesDone == 4);
+}
+
+TEST(CopiesThroughTheStore)
+{
+	Tests::TempFolder folder;
+	const SnapshotStore store(folder / "objects", false);
+	const FileCopyJob jobs[] = {
+		{ MakeFolder(folder / "a"), folder / "copies" / "a" },
+		{ MakeFolder(folder / "b"), folder / "copies" / "b" },
+	};
+	FileOperationEngine engine(&store, folder / "trash");
+	CHECK(engine.StartCopy(jobs, 2, LayoutFiles, 2));
+	CHECK(Drain(engine).size() == 2);
+
+	// Both copies and the store share one file per distinct content.
+	CHECK(fs::hard_link_count(jobs[0].target / "settings.json") == 3);
+	CHECK(fs::hard_link_count(jobs[1].target / "State.JSON") == 3);
+	CHECK(Tests::ReadFile(jobs[1].target / "settings.json") == Tests::ReadFile(jobs[1].source / "settings.json"));
+}
+
+TEST(ReportsAMissingSource)
+{
+	Tests::TempFolder folder;
+	const FileCopyJob jobs[] = {
+		{ folder / "missing", folder / "copies" / "missing" },
+		{ MakeFolder(folder / "a"), folder / "copies" / "a" },
+	};
+	FileOperationEngine engine(nullptr, folder / "trash");
+	CHECK(engine.StartCopy(jobs, 2, LayoutFiles, 2));
+	for (const FileOperationCompletion& completion : Drain(engine))
+	{
+		CHECK(!completion.error == (completion.job == 1));
+	}
+	CHECK(!fs::exists(jobs[0].target));
+	CHECK(engine.Progress().jobsDone == 2);
+	CHECK(engine.Progress().jobsFailed == 1);
+}
+
+TEST(DeletesThroughTheTrash)
+{
+	Tests::TempFolder folder;
+	const fs::path trash = folder / "trash";
+	const fs::path folders[] = { MakeFolder(folder / "a"), MakeFolder(folder / "b"), folder / "missing" };
+
+	// What an earlier delete could not remove.
+	Tests::WriteFile(trash / "leftover.0123456789abcdef" / "state.json", "{}");
+
+	FileOperationEngine engine(nullptr, trash);
+	CHECK(engine.StartDelete(folders, 3));
+	const std::vector<FileOperationCompletion> completions = Drain(engine);
+	CHECK(completions.size() == 3);
+	for (const FileOperationCompletion& completion : completions)
+	{
+		CHECK(!completion.error);
+	}
+	CHECK(!fs::exists(folders[0]));
+	CHECK(!fs::exists(folders[1]));
+	CHECK(fs::is_empty(trash));
+	CHECK(engine.Progress().jobsTotal == 3);
+	CHECK(engine.Progress().jobsDone == 3);
+}
+
+TEST(CollectsGarbageAfterDelete)
+{
+	Tests::TempFolder folder;
+	const SnapshotStore store(folder / "objects", false);
+	const FileCopyJob job{ MakeFolder(folder / "a"), folder / "copy" };
+	{
+		FileOperationEngine engine(&store, folder / "trash");
+		CHECK(engine.StartCopy(&job, 1, LayoutFiles, 2));
+		Drain(engine);
+	}
+	CHECK(!fs::is_empty(folder / "objects"));
+
+	FileOperationEngine engine(&store, folder / "trash");
+	CHECK(engine.StartDelete(&job.target, 1));
+	Drain(engine);
+	CHECK(!fs::exists(job.target));
+	for (const fs::directory_entry& entry : fs::recursive_directory_iterator(folder / "objects"))
+	{
+		CHECK(!entry.is_regular_file());
+	}
+}
+
+TEST(CancelledBeforeStartRunsNothing)
+{
+	Tests::TempFolder folder;
+	const FileCopyJob job{ MakeFolder(folder / "a"), folder / "copy" };
+	FileOperationEngine engine(nullptr, folder / "trash");
+	engine.Cancel();
+	CHECK(engine.StartCopy(&job, 1, LayoutFiles, 2));
+	CHECK(Drain(engine).empty());
+	CHECK(!fs::exists(job.target));
+	CHECK(engine.Progress().jobsDone == 0);
+}
+
+TEST(StartsOnlyOnce)
+{
+	Tests::TempFolder folder;
+	const FileCopyJob job{ MakeFolder(folder / "a"), folder / "copy" };
+	FileOperationEngine engine(nullptr, folder / "trash");
+	CHECK(engine.IsFinished());
+	CHECK(engine.StartCopy(&job, 1, LayoutFiles, 2));
+	CHECK(!engine.StartCopy(&job, 1, LayoutFiles, 2));
+	CHECK(!engine.StartDelete(&job.source, 1));
+	CHECK(Drain(engine).size() == 1);
+	CHECK(fs::exists(job.source));
+}
+
+TEST(CopyFileContentsReplacesTheTarget)
+{
+	Tests::TempFolder folder;
+	std::string large(3 * 1024 * 1024 + 17, '\0');
+	for (size_t i = 0; i < large.size(); ++i)
+	{
+		large[i] = static_cast<char>(i * 131 + (i >> 12));
+	}
+	Tests::WriteFile(folder / "large", large);
+	Tests::WriteFile(folder / "small", "{}");
+	Tests::WriteFile(folder / "empty", "");
+
+	std::error_code ec;
+	CHECK(FileOperationEngine::CopyFileContents(folder / "large", folder / "target", ec));
+	CHECK(Tests::ReadFile(folder / "target") == large);
+	CHECK(FileOperationEngine::CopyFileContents(folder / "small", folder / "target", ec));
+	CHECK(Tests::ReadFile(folder / "target") == "{}");
+	CHECK(FileOperationEngine::CopyFileContents(folder / "empty", folder / "target", ec));
+	CHECK(fs::file_size(folder / "target") == 0);
+
+	CHECK(!FileOperationEngine::CopyFileContents(folder / "missing", folder / "target", ec));
+	CHECK(ec);
+}
@@ -0,0 +1,161 @@
+﻿#include "Test.h"
+#include "FolderScanner.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	// Counts the calls per index; every 7th folder is slow, so idle workers have ranges to steal.
+	struct CountingWork
+	{
+		explicit CountingWork(size_t count) : calls(new std::atomic<int>[count]), count(count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				calls[i].store(0);
+			}
+		}
+
+		static void* Run(void* context, size_t index)
+		{
+			CountingWork& self = *static_cast<CountingWork*>(context);
+			self.calls[index].fetch_add(1);
+			if (index % 7 == 0)
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+			}
+			return reinterpret_cast<void*>(index + 1);
+		}
+
+		std::unique_ptr<std::atomic<int>[]> calls;
+		size_t count;
+	};
+
+	// Drains the scanner until it has finished and every result was taken.
+	std::vector<FolderScanCompletion> Drain(FolderScanner& scanner)
+	{
+		std::vector<FolderScanCompletion> completions;
+		FolderScanCompletion completion;
+		while (true)
+		{
+			const bool finished = scanner.IsFinished();
+			while (scanner.TryTake(completion))
+			{
+				completions.push_back(completion);
+			}
+			if (finished)
+			{
+				return completions;
+			}
+			std::this_thread::yield();
+		}
+	}
+}
+
+TEST(RunsEveryFolderOnce)
+{
+	for (unsigned workers : { 1u, 2u, 4u, 8u, 0u })
+	{
+		for (size_t count : { size_t{ 1 }, size_t{ 3 }, size_t{ 1000 } })
+		{
+			CountingWork work(count);
+			FolderScanner scanner;
+			CHECK(scanner.Start(count, &CountingWork::Run, &work, workers));
+			std::vector<FolderScanCompletion> completions = Drain(scanner);
+			scanner.Wait();
+
+			CHECK(completions.size() == count);
+			std::sort(completions.begin(), completions.end(),
+				[](const FolderScanCompletion& a, const FolderScanCompletion& b) { return a.index < b.index; });
+			for (size_t i = 0; i < completions.size(); ++i)
+			{
+				CHECK(completions[i].index == i);
+				CHECK(completions[i].result == reinterpret_cast<void*>(i + 1));
+				CHECK(work.calls[i].load() == 1);
+			}
+		}
+	}
+}
+
+TEST(FinishesAnEmptyScan)
+{
+	CountingWork work(1);
+	FolderScanner scanner;
+	CHECK(scanner.Start(0, &CountingWork::Run, &work, 4));
+	CHECK(scanner.IsFinished());
+	FolderScanCompletion completion;
+	CHECK(!scanner.TryTake(completion));
+	CHECK(work.calls[0].load() == 0);
+}
+
+TEST(StartsOnlyOnce)
+{
+	CountingWork work(4);
+	FolderScanner scanner;
+	CHECK(scanner.Start(4, &CountingWork::Run, &work, 2));
+	CHECK(!scanner.Start(4, &CountingWork::Run, &work, 2));
+	scanner.Wait();
+	CHECK(Drain(scanner).size() == 4);
+}
+
+TEST(CancelStopsHandingOutFolders)
+{
+	// The first folder of each worker blocks until the scan is cancelled.
+	struct BlockingWork
+	{
+		std::atomic<bool> released{ false };
+		std::atomic<int> started{ 0 };
+
+		static void* Run(void* context, size_t)
+		{
+			BlockingWork& self = *static_cast<BlockingWork*>(context);
+			self.started.fetch_add(1);
+			while (!self.released.load())
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			return nullptr;
+		}
+	} work;
+
+	constexpr size_t count = 10000;
+	FolderScanner scanner;
+	CHECK(scanner.Start(count, &BlockingWork::Run, &work, 4));
+	while (work.started.load() == 0)
+	{
+		std::this_thread::yield();
+	}
+	scanner.Cancel();
+	work.released.store(true);
+	scanner.Wait();
+
+	CHECK(scanner.IsFinished());
+	const size_t done = Drain(scanner).size();
+	CHECK(done >= 1);
+	CHECK(done <= 4);
+	CHECK(static_cast<size_t>(work.started.load()) == done);
+}
+
+TEST(EnumeratesSubfoldersOnly)
+{
+	Tests::TempFolder folder;
+	Tests::WriteFile(folder / "LocalState" / "settings.json", "{}");
+	Tests::WriteFile(folder / "LocalState_20250101_120000" / "state.json", "{}");
+	Tests::WriteFile(folder / "notes.txt", "");
+
+	std::vector<std::filesystem::path> subfolders = FolderScanner::EnumerateSubfolders(folder.path());
+	std::sort(subfolders.begin(), subfolders.end());
+	CHECK(subfolders.size() == 2);
+	if (subfolders.size() == 2)
+	{
+		CHECK(subfolders[0].filename() == "LocalState");
+		CHECK(subfolders[1].filename() == "LocalState_20250101_120000");
+	}
+	CHECK(FolderScanner::EnumerateSubfolders(folder / "missing").empty());
+}
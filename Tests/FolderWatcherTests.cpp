@@ -0,0 +1,183 @@
+﻿#include "Test.h"
+#include "FolderWatcher.h"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr uint32_t QuietMilliseconds = 200;
+	constexpr uint32_t StateBit = 1u << 1;      // LayoutCache::SourceNames: settings.json, state.json, ...
+	constexpr uint32_t SettingsBit = 1u << 0;
+
+	/// A default LocalState folder and a base folder with one copy, watched once the copy is announced.
+	struct Watched
+	{
+		Tests::TempFolder folder;
+		fs::path defaultFolder = folder / "LocalState";
+		fs::path base = folder / "Copies";
+		fs::path existing = base / "Existing";
+		FolderWatcher watcher;
+
+		Watched()
+		{
+			Tests::WriteFile(defaultFolder / "settings.json", "{}");
+			Tests::WriteFile(existing / "state.json", "{}");
+			CHECK(watcher.Start(defaultFolder, base, QuietMilliseconds));
+			// The copies are announced once every watch is in place.
+			const std::vector<FolderChange> initial = Take(1);
+			CHECK(initial.size() == 1 && initial[0].kind == FolderChangeKind::Added && initial[0].folder == existing);
+		}
+
+		/// Takes deltas until count arrived or the watcher was quiet for several intervals.
+		std::vector<FolderChange> Take(size_t count, uint32_t patienceMilliseconds = 10 * QuietMilliseconds)
+		{
+			std::vector<FolderChange> changes;
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(patienceMilliseconds);
+			while (changes.size() < count && std::chrono::steady_clock::now() < deadline)
+			{
+				FolderChange change;
+				if (watcher.TryTake(change))
+				{
+					changes.push_back(change);
+				}
+				else
+				{
+					std::this_thread::sleep_for(std::chrono::milliseconds(5));
+				}
+			}
+			return changes;
+		}
+
+		/// Checks that nothing is published for a while.
+		bool Quiet(uint32_t milliseconds)
+		{
+			return Take(1, milliseconds).empty();
+		}
+	};
+
+	void Sleep(uint32_t milliseconds)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+	}
+}
+
+TEST(ReportsCopiesAddedAndRemoved)
+{
+	Watched w;
+	fs::create_directories(w.base / "Work");
+	std::vector<FolderChange> changes = w.Take(1);
+	CHECK(changes.size() == 1);
+	CHECK(changes.size() == 1 && changes[0].kind == FolderChangeKind::Added && changes[0].folder == w.base / "Work");
+
+	// Files written in a new copy right away are reported as changes of it.
+	Tests::WriteFile(w.base / "Work" / "state.json", "{\"tabs\":[]}");
+	changes = w.Take(1);
+	CHECK(changes.size() == 1 && changes[0].kind == FolderChangeKind::Changed && changes[0].sources == StateBit);
+
+	fs::remove_all(w.base / "Work");
+	changes = w.Take(1);
+	CHECK(changes.size() == 1 && changes[0].kind == FolderChangeKind::Removed && changes[0].folder == w.base / "Work");
+
+	// Created and deleted within one interval: published once, as it is on disk by then.
+	fs::create_directories(w.base / "Brief");
+	fs::remove(w.base / "Brief");
+	changes = w.Take(2, 4 * QuietMilliseconds);
+	CHECK(changes.size() == 1 && changes[0].kind == FolderChangeKind::Removed && changes[0].folder == w.base / "Brief");
+}
+
+TEST(CoalescesABurstOfWrites)
+{
+	Watched w;
+	for (int i = 0; i < 20; ++i)
+	{
+		Tests::WriteFile(w.existing / "state.json", "{\"write\":" + std::to_string(i) + "}");
+		if (i == 10)
+		{
+			Tests::WriteFile(w.existing / "settings.json", "{\"profiles\":[]}");
+		}
+		Sleep(QuietMilliseconds / 10);
+	}
+	Tests::WriteFile(w.existing / "notes.txt", "not a source file");
+	Tests::WriteFile(w.defaultFolder / "state.json", "{}");
+
+	std::vector<FolderChange> changes = w.Take(3);
+	CHECK(changes.size() == 2);
+	bool copy = false;
+	bool defaultFolder = false;
+	for (const FolderChange& change : changes)
+	{
+		CHECK(change.kind == FolderChangeKind::Changed);
+		copy = copy || (change.folder == w.existing && change.sources == (StateBit | SettingsBit));
+		defaultFolder = defaultFolder || (change.folder == w.defaultFolder && change.sources == StateBit);
+	}
+	CHECK(copy);
+	CHECK(defaultFolder);
+	CHECK(w.Quiet(3 * QuietMilliseconds));
+}
+
+TEST(IgnoresFilesThatAreNotSources)
+{
+	Watched w;
+	Tests::WriteFile(w.existing / "notes.txt", "x");
+	Tests::WriteFile(w.defaultFolder / "settings.json.bak", "x");
+	fs::create_directories(w.existing / "Nested");
+	Tests::WriteFile(w.existing / "Nested" / "state.json", "x");
+	CHECK(w.Quiet(4 * QuietMilliseconds));
+}
+
+TEST(HoldsBackAHalfWrittenFile)
+{
+	Watched w;
+	const std::string complete = "{\"tabs\":[{\"title\":\"one\"},{\"title\":\"two\"}]}";
+
+	// The writer stalls for longer than the quiet interval halfway through, as a terminal saving a
+	// large state.json may: the first sample sees the half-written file, which nothing confirms.
+	Tests::WriteFile(w.existing / "state.json", complete.substr(0, complete.size() / 2));
+	CHECK(w.Quiet(QuietMilliseconds * 3 / 2));
+	Tests::WriteFile(w.existing / "state.json", complete);
+
+	std::vector<FolderChange> changes = w.Take(1);
+	CHECK(changes.size() == 1 && changes[0].kind == FolderChangeKind::Changed && changes[0].folder == w.existing);
+	CHECK(Tests::ReadFile(w.existing / "state.json") == complete);
+	CHECK(w.Quiet(3 * QuietMilliseconds));
+}
+
+TEST(AsksForARescanWhenTheBaseFolderGoes)
+{
+	Watched w;
+	fs::remove_all(w.base);
+	std::vector<FolderChange> changes = w.Take(4, 4 * QuietMilliseconds);
+	bool rescan = false;
+	for (const FolderChange& change : changes)
+	{
+		rescan = rescan || change.kind == FolderChangeKind::Rescan;
+	}
+	CHECK(rescan);
+
+	// The base folder is watched again once it is back, and its copies announced.
+	fs::create_directories(w.base / "Restored");
+	changes = w.Take(1, 5000);
+	CHECK(changes.size() == 1 && changes[0].kind == FolderChangeKind::Added && changes[0].folder == w.base / "Restored");
+}
+
+TEST(StopsAndKeepsPublishedDeltas)
+{
+	Watched w;
+	CHECK(!w.watcher.Start(w.defaultFolder, w.base, QuietMilliseconds));
+	fs::create_directories(w.base / "Late");
+	Sleep(3 * QuietMilliseconds);
+	w.watcher.Stop();
+	w.watcher.Stop();
+
+	FolderChange change;
+	CHECK(w.watcher.TryTake(change));
+	CHECK(change.kind == FolderChangeKind::Added && change.folder == w.base / "Late");
+	fs::create_directories(w.base / "Unwatched");
+	Sleep(2 * QuietMilliseconds);
+	CHECK(!w.watcher.TryTake(change));
+}
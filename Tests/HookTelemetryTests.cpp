@@ -0,0 +1,40 @@
+﻿#include "Test.h"
+#include "HookTelemetryChannel.h"
+
+using namespace WTLayoutManager::Services;
+
+TEST(AdvertisesNothingWithoutAHook)
+{
+	HookTelemetryChannel channel;
+	CHECK(channel.Capabilities() == 0);
+	CHECK(channel.Create());
+	CHECK(channel.Capabilities() == 0);
+
+	HookEvent events[4];
+	CHECK(channel.Read(events, 4) == 0);
+	CHECK(channel.Totals().lanes == 0);
+}
+
+TEST(WriterAdvertisesAndReports)
+{
+	HookTelemetryChannel channel;
+	CHECK(channel.Create());
+
+	HookTelemetryWriter writer;
+	CHECK(writer.Open(channel.Name().c_str()));
+	CHECK((channel.Capabilities() & HookReportsProcesses) != 0);
+
+	writer.Add(HookCounter::FileOpens, 3);
+	writer.Post(HookEventKind::InitCompleted, 0, 42);
+	HookEvent events[4];
+	CHECK(channel.Read(events, 4) == 2);
+	CHECK(events[0].kind == HookEventKind::Attached);
+	CHECK(events[1].kind == HookEventKind::InitCompleted);
+	CHECK(events[1].durationNanoseconds == 42);
+	CHECK(channel.Totals().lanes == 1);
+	CHECK(channel.Totals().counters[static_cast<size_t>(HookCounter::FileOpens)] == 3);
+
+	// The flag outlives the hook: a closed writer has still advertised.
+	writer.Close();
+	CHECK((channel.Capabilities() & HookReportsProcesses) != 0);
+}
@@ -0,0 +1,386 @@
+﻿#include "Test.h"
+#include "InstanceRegistry.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	// The slot layout and state encoding of InstanceRegistry.cpp, to plant claims a writer abandoned.
+	struct alignas(64) Slot
+	{
+		std::atomic<uint64_t> state;
+		std::atomic<uint64_t> pathHash;
+		std::atomic<uint64_t> processStartTime;
+		std::atomic<uint64_t> registeredUnixMs;
+		std::atomic<uint32_t> processId;
+		std::atomic<uint32_t> ownerProcessId;
+		std::atomic<uint64_t> flags;
+		std::atomic<uint64_t> claim;
+	};
+
+	constexpr uint64_t KindMask = 3;
+	constexpr uint64_t Writing = 1;
+	constexpr uint64_t Dead = 3;
+
+	Slot* MapSlots()
+	{
+		InstanceRegistry::Snapshot();   // creates the page
+#if defined(_WIN32)
+		HANDLE mapping = ::OpenFileMappingW(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, InstanceRegistry::PageName);
+		void* view = mapping == nullptr ? nullptr : ::MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0);
+		if (mapping != nullptr)
+		{
+			::CloseHandle(mapping);
+		}
+		return static_cast<Slot*>(view);
+#else
+		const int fd = ::shm_open(InstanceRegistry::PageName, O_RDWR, 0600);
+		void* view = fd < 0 ? MAP_FAILED : ::mmap(nullptr, sizeof(Slot) * InstanceRegistry::Capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (fd >= 0)
+		{
+			::close(fd);
+		}
+		return view == MAP_FAILED ? nullptr : static_cast<Slot*>(view);
+#endif
+	}
+
+	uint64_t UnixMilliseconds()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count());
+	}
+
+	/// Turns the first free slot on a folder's probe path into a claim that was never published.
+	/// @param stamped Whether the claimer got as far as stamping its claim time.
+	size_t PlantClaim(Slot* slots, std::wstring_view folder, uint32_t owner, bool stamped, uint64_t claimedUnixMs)
+	{
+		const uint64_t hash = InstanceRegistry::HashPath(folder);
+		for (size_t probe = 0; probe < InstanceRegistry::Capacity; ++probe)
+		{
+			const size_t index = static_cast<size_t>(hash + probe) & (InstanceRegistry::Capacity - 1);
+			Slot& slot = slots[index];
+			uint64_t state = slot.state.load();
+			if ((state & KindMask) == 0 || (state & KindMask) == Dead)
+			{
+				const uint64_t claim = ((((state & 0xFFFFFFFC) + 4) & 0xFFFFFFFF) | Writing) | (static_cast<uint64_t>(owner) << 32);
+				if (slot.state.compare_exchange_strong(state, claim))
+				{
+					slot.registeredUnixMs = stamped ? claimedUnixMs : 0;
+					slot.claim = stamped ? claim : 0;
+					return index;
+				}
+			}
+		}
+		CHECK(!"the table is full");
+		return 0;
+	}
+
+	size_t SlotOf(uint64_t token)
+	{
+		return static_cast<size_t>(token >> 48) - 1;
+	}
+
+	/// Ends a planted claim, so the next run of the tests finds the slot free.
+	void Release(Slot* slots, size_t index)
+	{
+		uint64_t state = slots[index].state.load();
+		if ((state & KindMask) == Writing)
+		{
+			slots[index].state.compare_exchange_strong(state, (((state & 0xFFFFFFFC) + 4) & 0xFFFFFFFF) | Dead);
+		}
+	}
+
+	uint32_t CurrentProcessId()
+	{
+#if defined(_WIN32)
+		return ::GetCurrentProcessId();
+#else
+		return static_cast<uint32_t>(::getpid());
+#endif
+	}
+
+	/// A folder path no other test process uses.
+	std::wstring Folder(const char* name)
+	{
+		const std::string text = "C:\\Tests\\InstanceRegistry\\" + std::to_string(CurrentProcessId()) + "\\" + name;
+		return std::wstring(text.begin(), text.end());
+	}
+
+	/// A process that stays alive until Stop, whose id can be registered as a terminal.
+	class Child
+	{
+	public:
+		Child()
+		{
+#if defined(_WIN32)
+			wchar_t path[MAX_PATH];
+			::GetModuleFileNameW(nullptr, path, MAX_PATH);
+			STARTUPINFOW startup{ sizeof(startup) };
+			CHECK(::CreateProcessW(path, nullptr, nullptr, nullptr, FALSE, CREATE_SUSPENDED, nullptr, nullptr, &startup, &m_process));
+			m_id = m_process.dwProcessId;
+#else
+			const pid_t pid = ::fork();
+			if (pid == 0)
+			{
+				::pause();
+				::_exit(0);
+			}
+			CHECK(pid > 0);
+			m_id = static_cast<uint32_t>(pid);
+#endif
+		}
+
+		~Child()
+		{
+			Stop();
+		}
+
+		Child(const Child&) = delete;
+		Child& operator=(const Child&) = delete;
+
+		uint32_t Id() const
+		{
+			return m_id;
+		}
+
+		/// Ends the process and waits until it is gone, reaped included.
+		void Stop()
+		{
+			if (m_id == 0)
+			{
+				return;
+			}
+#if defined(_WIN32)
+			::TerminateProcess(m_process.hProcess, 1);
+			::WaitForSingleObject(m_process.hProcess, INFINITE);
+			::CloseHandle(m_process.hThread);
+			::CloseHandle(m_process.hProcess);
+#else
+			::kill(static_cast<pid_t>(m_id), SIGKILL);
+			::waitpid(static_cast<pid_t>(m_id), nullptr, 0);
+#endif
+			m_id = 0;
+		}
+
+	private:
+		uint32_t m_id = 0;
+#if defined(_WIN32)
+		PROCESS_INFORMATION m_process{};
+#endif
+	};
+
+	/// The id of a process that has just exited.
+	uint32_t ExitedProcessId()
+	{
+		Child child;
+		const uint32_t id = child.Id();
+		child.Stop();
+		return id;
+	}
+}
+
+TEST(HashesPathsIgnoringCaseAndSeparators)
+{
+	CHECK(InstanceRegistry::HashPath(L"C:\\Users\\Me\\LocalState\\") == InstanceRegistry::HashPath(L"c:/users/me/localstate"));
+	CHECK(InstanceRegistry::HashPath(L"C:\\Users\\Me\\LocalState") != InstanceRegistry::HashPath(L"C:\\Users\\Me\\LocalState2"));
+}
+
+TEST(RegistersFindsAndUnregisters)
+{
+	const std::wstring folder = Folder("Basic");
+	RunningInstance instance{};
+	CHECK(!InstanceRegistry::Find(folder, false, instance));
+
+	const uint64_t token = InstanceRegistry::Register(folder, CurrentProcessId(), false);
+	CHECK(token != 0);
+	CHECK(InstanceRegistry::Find(folder + L"\\", false, instance));
+	CHECK(instance.processId == CurrentProcessId());
+	CHECK(instance.ownerProcessId == CurrentProcessId());
+	CHECK(instance.pathHash == InstanceRegistry::HashPath(folder));
+	CHECK(!instance.elevated);
+	CHECK(!InstanceRegistry::Find(folder, true, instance));
+
+	const std::vector<RunningInstance> instances = InstanceRegistry::Snapshot();
+	CHECK(std::count_if(instances.begin(), instances.end(), [&](const RunningInstance& entry) {
+		return entry.pathHash == InstanceRegistry::HashPath(folder) && entry.ownerProcessId == CurrentProcessId();
+	}) == 1);
+
+	InstanceRegistry::Unregister(token);
+	CHECK(!InstanceRegistry::Find(folder, false, instance));
+	InstanceRegistry::Unregister(token);   // already gone
+	InstanceRegistry::Unregister(0);
+
+	{
+		RegisteredInstance scoped(folder, CurrentProcessId(), true);
+		CHECK(InstanceRegistry::Find(folder, true, instance));
+		CHECK(instance.elevated);
+	}
+	CHECK(!InstanceRegistry::Find(folder, true, instance));
+}
+
+TEST(RefusesProcessesThatExited)
+{
+	CHECK(InstanceRegistry::Register(Folder("Exited"), ExitedProcessId(), false) == 0);
+}
+
+TEST(ReusesTheSlotOfAnExitedTerminal)
+{
+	const std::wstring folder = Folder("Reuse");
+	Child terminal;
+	const uint64_t first = InstanceRegistry::Register(folder, terminal.Id(), false);
+	CHECK(first != 0);
+	RunningInstance instance{};
+	CHECK(InstanceRegistry::Find(folder, false, instance));
+	CHECK(instance.processId == terminal.Id());
+
+	terminal.Stop();
+	CHECK(!InstanceRegistry::Find(folder, false, instance));
+	const uint64_t second = InstanceRegistry::Register(folder, CurrentProcessId(), false);
+	CHECK(second != 0);
+	CHECK(SlotOf(second) == SlotOf(first));
+
+	// The stale token no longer matches the slot's new entry.
+	InstanceRegistry::Unregister(first);
+	CHECK(InstanceRegistry::Find(folder, false, instance));
+	InstanceRegistry::Unregister(second);
+
+	Child swept;
+	const uint64_t third = InstanceRegistry::Register(Folder("Sweep"), swept.Id(), true);
+	CHECK(third != 0);
+	swept.Stop();
+	CHECK(InstanceRegistry::Sweep() >= 1);
+	const std::vector<RunningInstance> instances = InstanceRegistry::Snapshot();
+	CHECK(std::none_of(instances.begin(), instances.end(), [&](const RunningInstance& entry) {
+		return entry.pathHash == InstanceRegistry::HashPath(Folder("Sweep"));
+	}));
+}
+
+TEST(ReclaimsClaimsOfWritersThatExited)
+{
+	Slot* slots = MapSlots();
+	CHECK(slots != nullptr);
+	if (slots == nullptr)
+	{
+		return;
+	}
+
+	// Exited before stamping the claim, and after.
+	for (bool stamped : { false, true })
+	{
+		const std::wstring folder = Folder(stamped ? "DeadStamped" : "DeadClaimer");
+		const size_t claim = PlantClaim(slots, folder, ExitedProcessId(), stamped, UnixMilliseconds());
+		const uint64_t token = InstanceRegistry::Register(folder, CurrentProcessId(), false);
+		CHECK(token != 0);
+		CHECK(SlotOf(token) == claim);
+		InstanceRegistry::Unregister(token);
+	}
+
+	const size_t swept = PlantClaim(slots, Folder("DeadSwept"), ExitedProcessId(), false, 0);
+	CHECK(InstanceRegistry::Sweep() >= 1);
+	CHECK((slots[swept].state.load() & KindMask) == Dead);
+}
+
+TEST(ReclaimsStaleClaimsOnly)
+{
+	Slot* slots = MapSlots();
+	CHECK(slots != nullptr);
+	if (slots == nullptr)
+	{
+		return;
+	}
+
+	const std::wstring stale = Folder("Stale");
+	const size_t old = PlantClaim(slots, stale, CurrentProcessId(), true, UnixMilliseconds() - 60000);
+	const uint64_t token = InstanceRegistry::Register(stale, CurrentProcessId(), false);
+	CHECK(SlotOf(token) == old);
+	InstanceRegistry::Unregister(token);
+
+	// A live writer's fresh claim is left alone, and so is one not stamped yet, whatever time the
+	// slot's previous entry left behind.
+	for (bool stamped : { true, false })
+	{
+		const std::wstring folder = Folder(stamped ? "Fresh" : "Unstamped");
+		const size_t claim = PlantClaim(slots, folder, CurrentProcessId(), stamped, stamped ? UnixMilliseconds() : 0);
+		const uint64_t other = InstanceRegistry::Register(folder, CurrentProcessId(), false);
+		CHECK(other != 0);
+		CHECK(SlotOf(other) != claim);
+		CHECK((slots[claim].state.load() & KindMask) == Writing);
+		InstanceRegistry::Unregister(other);
+		Release(slots, claim);
+	}
+}
+
+TEST(RegistersConcurrently)
+{
+	constexpr int Threads = 8;
+	constexpr int PerThread = 8;
+	const std::wstring shared = Folder("Shared");
+	std::vector<std::vector<uint64_t>> tokens(Threads);
+	std::atomic<bool> go{ false };
+	std::vector<std::thread> threads;
+	for (int t = 0; t < Threads; ++t)
+	{
+		threads.emplace_back([&, t] {
+			while (!go.load())
+			{
+				std::this_thread::yield();
+			}
+			for (int i = 0; i < PerThread; ++i)
+			{
+				const std::wstring folder = i % 2 ? shared : Folder(("Own" + std::to_string(t * PerThread + i)).c_str());
+				tokens[t].push_back(InstanceRegistry::Register(folder, CurrentProcessId(), i % 4 == 1));
+			}
+		});
+	}
+	go = true;
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	std::vector<size_t> slotsUsed;
+	for (const std::vector<uint64_t>& list : tokens)
+	{
+		for (uint64_t token : list)
+		{
+			CHECK(token != 0);
+			slotsUsed.push_back(SlotOf(token));
+		}
+	}
+	std::sort(slotsUsed.begin(), slotsUsed.end());
+	CHECK(std::adjacent_find(slotsUsed.begin(), slotsUsed.end()) == slotsUsed.end());
+
+	const std::vector<RunningInstance> instances = InstanceRegistry::Snapshot();
+	CHECK(std::count_if(instances.begin(), instances.end(), [&](const RunningInstance& entry) {
+		return entry.ownerProcessId == CurrentProcessId();
+	}) == Threads * PerThread);
+	RunningInstance instance{};
+	CHECK(InstanceRegistry::Find(shared, false, instance));
+	CHECK(InstanceRegistry::Find(shared, true, instance));
+
+	for (const std::vector<uint64_t>& list : tokens)
+	{
+		for (uint64_t token : list)
+		{
+			InstanceRegistry::Unregister(token);
+		}
+	}
+	CHECK(!InstanceRegistry::Find(shared, false, instance));
+	CHECK(!InstanceRegistry::Find(shared, true, instance));
+}
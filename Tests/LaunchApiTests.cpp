@@ -0,0 +1,284 @@
+﻿#include "Test.h"
+#include "LaunchApi.h"
+#include "TerminalLauncher.h"
+#include <cstring>
+#include <memory>
+#include <string>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	// A terminal that runs until the test lets it exit, or whose wait fails.
+	struct FakeLaunch : TerminalLaunch
+	{
+		uint32_t processId = 0;
+		bool exited = false;
+		bool failWait = false;
+		uint32_t exitCode = 0;
+		int* waits = nullptr;
+
+		uint32_t ProcessId() const noexcept override
+		{
+			return processId;
+		}
+
+		LaunchWaitResult Wait(uint32_t, uint32_t& code, LaunchError& error) override
+		{
+			++*waits;
+			if (failWait)
+			{
+				error = { "launch.wait", 6 };
+				return LaunchWaitResult::Failed;
+			}
+			if (!exited)
+			{
+				return LaunchWaitResult::Timeout;
+			}
+			code = exitCode;
+			return LaunchWaitResult::Exited;
+		}
+	};
+
+	// Records the requests it gets and hands out FakeLaunches, or fails with a set error.
+	struct FakeBackend : LaunchBackend
+	{
+		TerminalLaunchRequest last;
+		int starts = 0;
+		int waits = 0;
+		LaunchError failure;
+		FakeLaunch* started = nullptr;
+
+		std::unique_ptr<TerminalLaunch> Start(const TerminalLaunchRequest& request, LaunchError& error) override
+		{
+			++starts;
+			last = request;
+			if (failure.event != nullptr)
+			{
+				error = failure;
+				return nullptr;
+			}
+			auto launch = std::make_unique<FakeLaunch>();
+			launch->processId = 4000 + starts;
+			launch->waits = &waits;
+			started = launch.get();
+			return launch;
+		}
+	};
+
+	// Installs a fake backend for one test and restores the default one after it.
+	struct InstalledFake
+	{
+		std::shared_ptr<FakeBackend> backend = std::make_shared<FakeBackend>();
+
+		InstalledFake()
+		{
+			LaunchBackend::Install(backend);
+		}
+
+		~InstalledFake()
+		{
+			LaunchBackend::Install(nullptr);
+		}
+	};
+
+	WTLM_String String(const std::u16string& text)
+	{
+		return { reinterpret_cast<const uint16_t*>(text.data()), static_cast<uint32_t>(text.size()), 0 };
+	}
+
+	// The strings a request borrows, kept alive with it.
+	struct Request
+	{
+		std::u16string application = u"C:\\Program Files\\WindowsApps\\wt.exe";
+		std::u16string commandLine = u"wt.exe -w new";
+		std::u16string hook = u"C:\\WTLM\\Hook.dll";
+		std::u16string environment;
+		std::u16string launcher;
+		std::u16string localState;
+		WTLM_LaunchRequest request{};
+
+		WTLM_LaunchRequest& Get()
+		{
+			request.size = sizeof(WTLM_LaunchRequest);
+			request.applicationPath = String(application);
+			request.commandLine = String(commandLine);
+			request.hookPath = String(hook);
+			request.environment = String(environment);
+			request.launcherPath = String(launcher);
+			request.localStateFolder = String(localState);
+			request.priority = 2;
+			return request;
+		}
+	};
+
+	WTLM_Status Start(WTLM_LaunchRequest& request, WTLM_LaunchError* error = nullptr)
+	{
+		// Not null, so that a failed start must clear it.
+		WTLM_Launch* launch = reinterpret_cast<WTLM_Launch*>(&request);
+		const WTLM_Status status = WTLM_StartLaunch(&request, &launch, error);
+		CHECK((status == WTLM_OK) == (launch != nullptr));
+		WTLM_CloseLaunch(launch);
+		return status;
+	}
+}
+
+TEST(ReportsItsVersion)
+{
+	CHECK(WTLM_GetApiVersion() == WTLM_LAUNCH_API_VERSION);
+}
+
+TEST(ConvertsRequests)
+{
+	InstalledFake fake;
+	Request r;
+	r.commandLine = u"wt.exe -p \"\u00c9cole \U0001F600\"";
+	r.environment = std::u16string(u"A=1\0B=x;y\0\0C=3", 14);
+	r.localState = u"C:\\Snapshots\\a";
+	WTLM_LaunchRequest& request = r.Get();
+	request.flags = WTLM_LAUNCH_STAGGER_RESUME;
+	request.priority = 1;
+	request.placement = 1;
+	request.affinityMask = 0x0F;
+	request.memoryLimitBytes = 1ull << 30;
+	request.cpuRatePercent = 50;
+	request.queuePriority = -2;
+	CHECK(Start(request) == WTLM_OK);
+
+	const TerminalLaunchRequest& native = fake.backend->last;
+	CHECK(native.applicationPath == L"C:\\Program Files\\WindowsApps\\wt.exe");
+	CHECK(native.commandLine == L"wt.exe -p \"\u00c9cole \U0001F600\"");
+	CHECK(native.hookPath == L"C:\\WTLM\\Hook.dll");
+	CHECK(native.launcherPath.empty());
+	CHECK(native.localStateFolder == L"C:\\Snapshots\\a");
+	CHECK(native.environment.size() == 3);
+	CHECK(native.environment.size() == 3 && native.environment[1] == L"B=x;y" && native.environment[2] == L"C=3");
+	CHECK(native.policy.priority == LaunchPriority::BelowNormal);
+	CHECK(native.policy.placement == CorePlacement::Efficiency);
+	CHECK(native.policy.affinityMask == 0x0F);
+	CHECK(native.policy.staggerResume);
+	CHECK(native.policy.limits.memoryBytes == 1ull << 30);
+	CHECK(native.policy.limits.cpuRatePercent == 50);
+	CHECK(native.policy.queuePriority == -2);
+
+	// An elevated launch names its launcher.
+	r.launcher = u"C:\\WTLM\\ElevatedLauncher.exe";
+	r.Get().flags = WTLM_LAUNCH_ELEVATED;
+	CHECK(Start(r.request) == WTLM_OK);
+	CHECK(fake.backend->last.launcherPath == L"C:\\WTLM\\ElevatedLauncher.exe");
+	CHECK(!fake.backend->last.policy.staggerResume);
+}
+
+TEST(RejectsInvalidRequests)
+{
+	InstalledFake fake;
+	WTLM_Launch* launch = nullptr;
+	CHECK(WTLM_StartLaunch(nullptr, &launch, nullptr) == WTLM_E_INVALID_ARGUMENT);
+	Request valid;
+	CHECK(WTLM_StartLaunch(&valid.Get(), nullptr, nullptr) == WTLM_E_INVALID_ARGUMENT);
+
+	const auto rejected = [](auto edit) {
+		Request r;
+		WTLM_LaunchRequest& request = r.Get();
+		edit(r, request);
+		return Start(request);
+	};
+	CHECK(rejected([](Request&, WTLM_LaunchRequest& q) { q.size -= 8; }) == WTLM_E_VERSION);
+	CHECK(rejected([](Request&, WTLM_LaunchRequest& q) { q.flags = 0x4; }) == WTLM_E_INVALID_ARGUMENT);
+	CHECK(rejected([](Request&, WTLM_LaunchRequest& q) { q.priority = 5; }) == WTLM_E_INVALID_ARGUMENT);
+	CHECK(rejected([](Request&, WTLM_LaunchRequest& q) { q.placement = -1; }) == WTLM_E_INVALID_ARGUMENT);
+	CHECK(rejected([](Request&, WTLM_LaunchRequest& q) { q.cpuRatePercent = 101; }) == WTLM_E_INVALID_ARGUMENT);
+	CHECK(rejected([](Request&, WTLM_LaunchRequest& q) { q.applicationPath = WTLM_String{}; }) == WTLM_E_INVALID_ARGUMENT);
+	CHECK(rejected([](Request&, WTLM_LaunchRequest& q) { q.hookPath = WTLM_String{}; }) == WTLM_E_INVALID_ARGUMENT);
+	CHECK(rejected([](Request&, WTLM_LaunchRequest& q) { q.commandLine.chars = nullptr; }) == WTLM_E_INVALID_ARGUMENT);
+	CHECK(rejected([](Request&, WTLM_LaunchRequest& q) { q.flags = WTLM_LAUNCH_ELEVATED; }) == WTLM_E_INVALID_ARGUMENT);
+	CHECK(rejected([](Request& r, WTLM_LaunchRequest& q) {
+		r.launcher = u"C:\\WTLM\\ElevatedLauncher.exe";
+		q.launcherPath = String(r.launcher);
+	}) == WTLM_E_INVALID_ARGUMENT);
+	CHECK(fake.backend->starts == 0);
+}
+
+TEST(ReportsBackendFailures)
+{
+	InstalledFake fake;
+	fake.backend->failure = { "launch.create_process_with_a_long_event_name_that_does_not_fit_the_struct", 740 };
+	Request r;
+	WTLM_LaunchError error;
+	std::memset(&error, 0x7F, sizeof(error));
+	CHECK(Start(r.Get(), &error) == WTLM_E_FAILED);
+	CHECK(error.systemError == 740);
+	CHECK(std::strlen(error.event) == sizeof(error.event) - 1);
+	CHECK(std::strncmp(error.event, "launch.create_process_with", 26) == 0);
+
+	// A later success clears the error.
+	fake.backend->failure = LaunchError();
+	CHECK(Start(r.Get(), &error) == WTLM_OK);
+	CHECK(error.systemError == 0);
+	CHECK(error.event[0] == '\0');
+}
+
+TEST(WaitsForTheTerminal)
+{
+	InstalledFake fake;
+	Request r;
+	WTLM_Launch* launch = nullptr;
+	CHECK(WTLM_StartLaunch(&r.Get(), &launch, nullptr) == WTLM_OK);
+	CHECK(WTLM_GetLaunchProcessId(launch) == 4001);
+	CHECK(WTLM_GetLaunchProcessId(nullptr) == 0);
+
+	uint32_t exitCode = 99;
+	CHECK(WTLM_WaitLaunch(launch, 0, &exitCode, nullptr) == WTLM_TIMEOUT);
+	CHECK(exitCode == 99);
+	CHECK(WTLM_WaitLaunch(launch, 0, nullptr, nullptr) == WTLM_E_INVALID_ARGUMENT);
+	CHECK(WTLM_WaitLaunch(nullptr, 0, &exitCode, nullptr) == WTLM_E_INVALID_ARGUMENT);
+
+	fake.backend->started->exited = true;
+	fake.backend->started->exitCode = 3;
+	CHECK(WTLM_WaitLaunch(launch, WTLM_WAIT_INFINITE, &exitCode, nullptr) == WTLM_OK);
+	CHECK(exitCode == 3);
+	CHECK(WTLM_WaitLaunch(launch, 0, &exitCode, nullptr) == WTLM_OK);
+	CHECK(exitCode == 3);
+
+	fake.backend->started->failWait = true;
+	WTLM_LaunchError error{};
+	CHECK(WTLM_WaitLaunch(launch, 0, &exitCode, &error) == WTLM_E_FAILED);
+	CHECK(error.systemError == 6);
+	CHECK(std::strcmp(error.event, "launch.wait") == 0);
+	WTLM_CloseLaunch(launch);
+	WTLM_CloseLaunch(nullptr);
+}
+
+TEST(LaunchesKeepTheirBackend)
+{
+	InstalledFake first;
+	Request r;
+	WTLM_Launch* launch = nullptr;
+	CHECK(WTLM_StartLaunch(&r.Get(), &launch, nullptr) == WTLM_OK);
+
+	// Replacing the backend, even by the test's end, leaves the started launch working.
+	{
+		InstalledFake second;
+		uint32_t exitCode = 0;
+		CHECK(WTLM_WaitLaunch(launch, 0, &exitCode, nullptr) == WTLM_TIMEOUT);
+		CHECK(first.backend->waits == 1);
+		CHECK(second.backend->waits == 0);
+	}
+	std::weak_ptr<FakeBackend> backend = first.backend;
+	first.backend.reset();
+	LaunchBackend::Install(nullptr);
+	CHECK(!backend.expired());
+	WTLM_CloseLaunch(launch);
+	CHECK(backend.expired());
+}
+
+TEST(UnsupportedWithoutBackend)
+{
+	LaunchBackend::Install(nullptr);
+	if (LaunchBackend::Current())
+	{
+		return;     // Windows has a real default backend
+	}
+	Request r;
+	CHECK(Start(r.Get()) == WTLM_E_UNSUPPORTED);
+}
@@ -0,0 +1,201 @@
+﻿#include "Test.h"
+#include "LaunchPlan.h"
+#include "LauncherArguments.h"
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	/// A package folder, a hook and a LocalState copy to compile plans from.
+	struct Package
+	{
+		Tests::TempFolder folder;
+		LaunchPlanSource source;
+
+		explicit Package(bool elevated = false)
+		{
+			Tests::WriteFile(folder / "Package" / "wtd.exe", "MZ");
+			Tests::WriteFile(folder / "Hook.dll", "MZ");
+			source.packageFolder = (folder / "Package").wstring();
+			source.defaultLocalState = (folder / "LocalState").wstring();
+			source.localStateFolder = (folder / "Copies" / "Work").wstring();
+			source.hookPath = (folder / "Hook.dll").wstring();
+			if (elevated)
+			{
+				source.launcherPath = (folder / "ElevatedLauncher.exe").wstring();
+			}
+		}
+
+		std::shared_ptr<const LaunchPlan> Compile() const
+		{
+			std::wstring missing;
+			std::error_code ec;
+			std::shared_ptr<const LaunchPlan> plan = LaunchPlan::Compile(source, missing, ec);
+			CHECK(plan != nullptr);
+			CHECK(!ec);
+			CHECK(missing.empty());
+			return plan;
+		}
+	};
+
+	/// The NUL separated entries of an environment block, up to its terminating empty entry.
+	std::vector<std::wstring> Entries(const wchar_t* block)
+	{
+		std::vector<std::wstring> entries;
+		for (const wchar_t* entry = block; *entry != L'\0'; entry += entries.back().size() + 1)
+		{
+			entries.emplace_back(entry);
+		}
+		return entries;
+	}
+
+	bool EndsWith(const std::vector<std::wstring>& entries, const std::vector<std::wstring>& tail)
+	{
+		return entries.size() >= tail.size() && std::equal(tail.begin(), tail.end(), entries.end() - tail.size());
+	}
+}
+
+TEST(ResolvesTheTerminalInProbeOrder)
+{
+	Package package;
+	const std::shared_ptr<const LaunchPlan> fallback = package.Compile();
+	const fs::path wtd = fs::path(package.source.packageFolder) / "wtd.exe";
+	CHECK(fallback->Request().applicationPath == wtd.wstring());
+	CHECK(fallback->Request().commandLine == L"\"" + wtd.wstring() + L"\"");
+
+	// wt.exe wins once it exists; a compiled plan keeps what it resolved.
+	Tests::WriteFile(fs::path(package.source.packageFolder) / "wt.exe", "MZ");
+	const std::shared_ptr<const LaunchPlan> preferred = package.Compile();
+	CHECK(preferred->Request().applicationPath == (fs::path(package.source.packageFolder) / "wt.exe").wstring());
+	CHECK(fallback->Request().applicationPath == wtd.wstring());
+}
+
+TEST(ReportsTheMissingFile)
+{
+	Package package;
+	std::wstring missing = L"stale";
+	std::error_code ec = std::make_error_code(std::errc::io_error);
+
+	LaunchPlanSource empty = package.source;
+	empty.packageFolder = (package.folder / "Empty").wstring();
+	CHECK(LaunchPlan::Compile(empty, missing, ec) == nullptr);
+	CHECK(ec == std::errc::no_such_file_or_directory);
+	CHECK(missing == (package.folder / "Empty" / "wtd.exe").wstring());   // the last one looked for
+
+	LaunchPlanSource noHook = package.source;
+	noHook.hookPath = (package.folder / "Missing.dll").wstring();
+	CHECK(LaunchPlan::Compile(noHook, missing, ec) == nullptr);
+	CHECK(missing == noHook.hookPath);
+
+	CHECK(LaunchPlan::Compile(package.source, missing, ec) != nullptr);
+	CHECK(missing.empty());
+	CHECK(!ec);
+}
+
+TEST(BuildsTheDirectLaunchOnce)
+{
+	Package package;
+	package.source.policy.priority = LaunchPriority::AboveNormal;
+	package.source.policy.queuePriority = 4;
+	const std::shared_ptr<const LaunchPlan> plan = package.Compile();
+	const TerminalLaunchRequest& request = plan->Request();
+	CHECK(request.hookPath == package.source.hookPath);
+	CHECK(request.localStateFolder == package.source.localStateFolder);
+	CHECK(request.launcherPath.empty());
+	CHECK(request.policy.priority == LaunchPriority::AboveNormal);
+	CHECK(request.policy.queuePriority == 4);
+	CHECK(request.environment == (std::vector<std::wstring>{
+		L"WT_DEFAULT_LOCALSTATE=" + package.source.defaultLocalState,
+		L"WT_REDIRECT_LOCALSTATE=" + package.source.localStateFolder,
+		L"WT_HOOK_DLL_PATH=" + package.source.hookPath }));
+
+	const CompiledLaunchRequest& compiled = *request.compiled;
+	CHECK(std::wstring(compiled.commandLine.data()) == request.commandLine);
+	CHECK(compiled.commandLine.size() == request.commandLine.size() + 1);
+	const std::u8string hook = fs::path(package.source.hookPath).u8string();
+	CHECK(compiled.hookPath == std::string(hook.begin(), hook.end()));
+	CHECK(compiled.launcherHead.empty());
+
+	// The redirect variables follow the inherited ones; each launch only names its channel.
+	const std::vector<std::wstring> named = Entries(compiled.EnvironmentBlock(L"wtlm-1").get());
+	CHECK(EndsWith(named, { request.environment[0], request.environment[1], request.environment[2], L"WT_HOOK_TELEMETRY=wtlm-1" }));
+	CHECK(Entries(compiled.EnvironmentBlock(L"").get()).back() == L"WT_HOOK_TELEMETRY=");
+}
+
+TEST(LaunchesManyTimesFromOnePlan)
+{
+	Package package;
+	const std::shared_ptr<const LaunchPlan> plan = package.Compile();
+	const std::shared_ptr<const CompiledLaunchRequest> compiled = plan->Request().compiled;
+
+	// Launches from several threads share the compiled forms and differ only in their channel.
+	constexpr int Threads = 4;
+	constexpr int PerThread = 50;
+	std::vector<int> mismatches(Threads, 0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < Threads; ++t)
+	{
+		threads.emplace_back([&, t] {
+			for (int i = 0; i < PerThread; ++i)
+			{
+				const std::wstring channel = L"wtlm-" + std::to_wstring(t * PerThread + i);
+				const std::vector<std::wstring> entries = Entries(plan->Request().compiled->EnvironmentBlock(channel).get());
+				mismatches[t] += entries.back() != L"WT_HOOK_TELEMETRY=" + channel || plan->Request().compiled != compiled;
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	CHECK(mismatches == std::vector<int>(Threads, 0));
+}
+
+TEST(CarriesThePolicyToTheElevatedLauncher)
+{
+	Package package(true);
+	package.source.policy.priority = LaunchPriority::High;
+	package.source.policy.placement = CorePlacement::Performance;
+	package.source.policy.queuePriority = -2;
+	package.source.policy.staggerResume = true;
+	package.source.policy.limits.cpuRatePercent = 50;
+	const std::shared_ptr<const LaunchPlan> plan = package.Compile();
+	const TerminalLaunchRequest& request = plan->Request();
+	CHECK(request.launcherPath == package.source.launcherPath);
+	CHECK(request.compiled->environment.empty());
+
+	const std::wstring parameters = request.compiled->LauncherParameters(L"wtlm-9", L"pipe-9");
+	const std::wstring policy = LaunchScheduler::FormatPolicy(request.policy);
+	CHECK(parameters.find(L" " + LauncherArguments::QuoteArgument(policy) + L" " + LauncherArguments::QuoteArgument(request.localStateFolder)
+		+ L" \"pipe-9\"") != std::wstring::npos);
+	CHECK(parameters.find(L";WT_HOOK_TELEMETRY=wtlm-9;\"") != std::wstring::npos);
+
+	LaunchPolicy parsed;
+	CHECK(LaunchScheduler::ParsePolicy(policy, parsed));
+	CHECK(parsed.priority == LaunchPriority::High);
+	CHECK(parsed.placement == CorePlacement::Performance);
+	CHECK(parsed.queuePriority == -2);
+	CHECK(parsed.staggerResume);
+	CHECK(parsed.limits.cpuRatePercent == 50);
+
+	// Without a pipe the launcher still gets its last argument, empty.
+	const std::wstring unpiped = request.compiled->LauncherParameters(L"", L"");
+	CHECK(unpiped.size() > 3 && unpiped.compare(unpiped.size() - 3, 3, L" \"\"") == 0);
+}
+
+TEST(InvalidationMakesPlansStale)
+{
+	Package package;
+	const std::shared_ptr<const LaunchPlan> before = package.Compile();
+	CHECK(before->IsCurrent());
+	LaunchPlan::InvalidateAll();
+	CHECK(!before->IsCurrent());
+	const std::shared_ptr<const LaunchPlan> after = package.Compile();
+	CHECK(after->IsCurrent());
+	CHECK(after->Source().localStateFolder == before->Source().localStateFolder);
+}
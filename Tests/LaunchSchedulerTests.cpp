@@ -0,0 +1,253 @@
+﻿#include "Test.h"
+#include "LaunchScheduler.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	// The workspace the simulation benchmark restores: 15 terminals of 400 to 600 ms of work.
+	WorkspaceModel Workspace()
+	{
+		WorkspaceModel model;
+		for (int i = 0; i < 15; ++i)
+		{
+			model.terminalWork.push_back(400.0 + (i * 37) % 200);
+		}
+		return model;
+	}
+
+	// Runs launches of one policy on threads through a scheduler and returns the most that were
+	// between Admit and Finish, and between WaitResume and Finish, at once.
+	void RunLaunches(LaunchScheduler& scheduler, const LaunchPolicy& policy, int count, int& maxAdmitted, int& maxResumed)
+	{
+		std::atomic<int> admitted{ 0 };
+		std::atomic<int> resumed{ 0 };
+		std::atomic<int> admittedPeak{ 0 };
+		std::atomic<int> resumedPeak{ 0 };
+		const auto raise = [](std::atomic<int>& peak, int value) {
+			int seen = peak.load();
+			while (value > seen && !peak.compare_exchange_weak(seen, value))
+			{
+			}
+		};
+		std::vector<std::thread> launches;
+		for (int i = 0; i < count; ++i)
+		{
+			launches.emplace_back([&] {
+				LaunchSlot slot(scheduler, policy);
+				raise(admittedPeak, ++admitted);
+				slot.WaitResume();
+				raise(resumedPeak, ++resumed);
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+				--resumed;
+				--admitted;
+			});
+		}
+		for (std::thread& launch : launches)
+		{
+			launch.join();
+		}
+		maxAdmitted = admittedPeak;
+		maxResumed = resumedPeak;
+	}
+}
+
+TEST(QueueAdmitsUpToTheWindow)
+{
+	LaunchQueue queue(2);
+	const uint64_t first = queue.Submit(0, false);
+	const uint64_t second = queue.Submit(0, false);
+	const uint64_t third = queue.Submit(0, false);
+	CHECK(queue.IsAdmitted(first));
+	CHECK(queue.IsAdmitted(second));
+	CHECK(!queue.IsAdmitted(third));
+	CHECK(!queue.MayResume(third));
+	CHECK(queue.ActiveCount() == 2);
+	CHECK(queue.PendingCount() == 1);
+
+	queue.Finish(first);
+	CHECK(queue.IsAdmitted(third));
+	CHECK(queue.ActiveCount() == 2);
+	CHECK(queue.PendingCount() == 0);
+
+	// A window of 0 still admits one launch.
+	LaunchQueue narrow(0);
+	CHECK(narrow.Window() == 1);
+	CHECK(narrow.IsAdmitted(narrow.Submit(0, false)));
+}
+
+TEST(QueueAdmitsByPriorityThenSubmission)
+{
+	LaunchQueue queue(1);
+	const uint64_t running = queue.Submit(0, false);
+	const uint64_t low = queue.Submit(0, false);
+	const uint64_t high = queue.Submit(5, false);
+	const uint64_t laterHigh = queue.Submit(5, false);
+	CHECK(queue.IsAdmitted(running));
+
+	queue.Finish(running);
+	CHECK(queue.IsAdmitted(high));
+	CHECK(!queue.IsAdmitted(laterHigh));
+	queue.Finish(high);
+	CHECK(queue.IsAdmitted(laterHigh));
+	CHECK(!queue.IsAdmitted(low));
+	queue.Finish(laterHigh);
+	CHECK(queue.IsAdmitted(low));
+}
+
+TEST(QueueFinishesPendingLaunches)
+{
+	// A launch that fails before admission leaves the queue without taking a slot.
+	LaunchQueue queue(1);
+	const uint64_t running = queue.Submit(0, false);
+	const uint64_t cancelled = queue.Submit(0, false);
+	const uint64_t next = queue.Submit(0, false);
+	queue.Finish(cancelled);
+	CHECK(queue.PendingCount() == 1);
+	queue.Finish(running);
+	CHECK(queue.IsAdmitted(next));
+	CHECK(!queue.IsAdmitted(cancelled));
+	CHECK(queue.ActiveCount() == 1);
+}
+
+TEST(QueueStaggersResume)
+{
+	LaunchQueue queue(4);
+	const uint64_t first = queue.Submit(0, true);
+	const uint64_t second = queue.Submit(0, true);
+	const uint64_t third = queue.Submit(0, true);
+	const uint64_t plain = queue.Submit(0, false);
+	CHECK(queue.MayResume(first));
+	CHECK(!queue.MayResume(second));
+	CHECK(queue.MayResume(plain));
+
+	// The next staggered launch waits until the resumed one finished, then they go in admission order.
+	queue.Resume(first);
+	CHECK(!queue.MayResume(first));
+	CHECK(!queue.MayResume(second));
+	queue.Finish(first);
+	CHECK(queue.MayResume(second));
+	CHECK(!queue.MayResume(third));
+	queue.Resume(second);
+	queue.Finish(second);
+	CHECK(queue.MayResume(third));
+}
+
+TEST(SchedulerBoundsConcurrentLaunches)
+{
+	LaunchScheduler scheduler(3);
+	int maxAdmitted = 0;
+	int maxResumed = 0;
+	RunLaunches(scheduler, LaunchPolicy(), 12, maxAdmitted, maxResumed);
+	CHECK(maxAdmitted >= 1);
+	CHECK(maxAdmitted <= 3);
+	CHECK(maxResumed <= 3);
+}
+
+TEST(SchedulerResumesStaggeredLaunchesOneAtATime)
+{
+	LaunchScheduler scheduler(4);
+	LaunchPolicy policy;
+	policy.staggerResume = true;
+	int maxAdmitted = 0;
+	int maxResumed = 0;
+	RunLaunches(scheduler, policy, 8, maxAdmitted, maxResumed);
+	CHECK(maxAdmitted <= 4);
+	CHECK(maxResumed == 1);
+}
+
+TEST(PlacementMaskSelectsAnEfficiencyClass)
+{
+	const std::vector<uint8_t> hybrid = { 1, 1, 0, 0, 0, 0 };
+	CHECK(LaunchScheduler::PlacementMask(hybrid, CorePlacement::Performance) == 0x03);
+	CHECK(LaunchScheduler::PlacementMask(hybrid, CorePlacement::Efficiency) == 0x3C);
+	CHECK(LaunchScheduler::PlacementMask(hybrid, CorePlacement::Any) == 0);
+	CHECK(LaunchScheduler::PlacementMask({ 0, 0, 0, 0 }, CorePlacement::Performance) == 0);
+	CHECK(LaunchScheduler::PlacementMask({}, CorePlacement::Efficiency) == 0);
+
+	// Only the first 64 processors fit a mask.
+	std::vector<uint8_t> wide(80, 0);
+	wide[70] = 1;
+	CHECK(LaunchScheduler::PlacementMask(wide, CorePlacement::Performance) == 0);
+	wide[63] = 1;
+	CHECK(LaunchScheduler::PlacementMask(wide, CorePlacement::Performance) == uint64_t{ 1 } << 63);
+}
+
+TEST(PolicyRoundTrips)
+{
+	LaunchPolicy policy;
+	policy.priority = LaunchPriority::BelowNormal;
+	policy.placement = CorePlacement::Efficiency;
+	policy.affinityMask = 0xF0F0F0F0F0F0F0F0ull;
+	policy.queuePriority = -3;
+	policy.staggerResume = true;
+	policy.limits.memoryBytes = 512ull * 1024 * 1024;
+	policy.limits.cpuRatePercent = 25;
+
+	LaunchPolicy parsed;
+	CHECK(LaunchScheduler::ParsePolicy(LaunchScheduler::FormatPolicy(policy), parsed));
+	CHECK(parsed.priority == policy.priority);
+	CHECK(parsed.placement == policy.placement);
+	CHECK(parsed.affinityMask == policy.affinityMask);
+	CHECK(parsed.queuePriority == policy.queuePriority);
+	CHECK(parsed.staggerResume);
+	CHECK(parsed.limits.memoryBytes == policy.limits.memoryBytes);
+	CHECK(parsed.limits.cpuRatePercent == 25);
+
+	// Missing keys keep their value and unknown keys are ignored.
+	LaunchPolicy partial = policy;
+	CHECK(LaunchScheduler::ParsePolicy(L"queue=7;colour=2", partial));
+	CHECK(partial.queuePriority == 7);
+	CHECK(partial.priority == LaunchPriority::BelowNormal);
+}
+
+TEST(PolicyRejectsMalformedValues)
+{
+	for (const wchar_t* text : { L"priority=9", L"placement=-1", L"stagger=2", L"cpurate=101", L"affinity=-1",
+		L"queue=x", L"memory=", L"queue=99999999999" })
+	{
+		LaunchPolicy policy;
+		policy.queuePriority = 4;
+		CHECK(!LaunchScheduler::ParsePolicy(text, policy));
+		CHECK(policy.queuePriority == 4);
+	}
+}
+
+TEST(SimulationComparesPolicies)
+{
+	const WorkspaceModel model = Workspace();
+	LaunchPolicy policy;
+	const SimulationResult allAtOnce = LaunchSimulation::Run(model, policy, 0);
+	const SimulationResult window4 = LaunchSimulation::Run(model, policy, 4);
+	CHECK(allAtOnce.firstReadyMilliseconds > model.createMilliseconds);
+	CHECK(allAtOnce.firstReadyMilliseconds <= allAtOnce.meanReadyMilliseconds);
+	CHECK(allAtOnce.meanReadyMilliseconds <= allAtOnce.allReadyMilliseconds);
+
+	// A window gets the first terminals up sooner and leaves the foreground load more of the CPU.
+	CHECK(window4.firstReadyMilliseconds < allAtOnce.firstReadyMilliseconds);
+	CHECK(window4.meanReadyMilliseconds < allAtOnce.meanReadyMilliseconds);
+	CHECK(window4.foregroundShare > allAtOnce.foregroundShare);
+
+	// Staggering serializes the restore.
+	policy.staggerResume = true;
+	const SimulationResult staggered = LaunchSimulation::Run(model, policy, 4);
+	CHECK(staggered.allReadyMilliseconds > window4.allReadyMilliseconds * 2);
+
+	// Below the foreground's priority, launches never take its CPU.
+	policy.staggerResume = false;
+	policy.priority = LaunchPriority::BelowNormal;
+	CHECK(LaunchSimulation::Run(model, policy, 4).foregroundShare > 0.999);
+
+	// Confined to the slower cores, the restore takes longer.
+	policy.priority = LaunchPriority::Normal;
+	policy.placement = CorePlacement::Efficiency;
+	CHECK(LaunchSimulation::Run(model, policy, 4).allReadyMilliseconds > window4.allReadyMilliseconds);
+
+	const SimulationResult empty = LaunchSimulation::Run(WorkspaceModel(), LaunchPolicy(), 4);
+	CHECK(empty.allReadyMilliseconds == 0);
+	CHECK(empty.foregroundShare == 1);
+}
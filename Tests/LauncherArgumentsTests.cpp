@@ -0,0 +1,42 @@
+﻿#include "Test.h"
+#include "LauncherArguments.h"
+#include "TerminalLauncher.h"
+
+using namespace WTLayoutManager::Services;
+
+TEST(QuotesArguments)
+{
+	CHECK(LauncherArguments::QuoteArgument(L"") == L"\"\"");
+	CHECK(LauncherArguments::QuoteArgument(L"C:\\Program Files\\wt.exe") == L"\"C:\\Program Files\\wt.exe\"");
+	CHECK(LauncherArguments::QuoteArgument(L"say \"hi\"") == L"\"say \\\"hi\\\"\"");
+}
+
+TEST(SplitsEnvironment)
+{
+	const std::vector<std::wstring> entries = LauncherArguments::SplitEnvironment(L" A=1 ;;\tB=two words\t;C=;");
+	CHECK(entries.size() == 3);
+	CHECK(entries.size() == 3 && entries[0] == L"A=1" && entries[1] == L"B=two words" && entries[2] == L"C=");
+	CHECK(LauncherArguments::SplitEnvironment(L"").empty());
+	CHECK(LauncherArguments::SplitEnvironment(L" ; ;").empty());
+}
+
+TEST(RoundTripsTheLauncherParameters)
+{
+	// The launcher's environment argument, as an elevated launch builds it, splits back into the
+	// request's entries and the telemetry channel.
+	TerminalLaunchRequest request;
+	request.applicationPath = L"C:\\Program Files\\WindowsApps\\wt.exe";
+	request.commandLine = L"wt.exe -p \"cmd\"";
+	request.hookPath = L"C:\\WTLM\\Hook.dll";
+	request.environment = { L"WT_SESSION=1", L"PATH=C:\\bin" };
+	request.launcherPath = L"C:\\WTLM\\ElevatedLauncher.exe";
+	const std::wstring parameters = CompiledLaunchRequest::Build(request)->LauncherParameters(L"wtlm-7", L"pipe-7");
+
+	const std::wstring environment = LauncherArguments::QuoteArgument(L"WT_SESSION=1;PATH=C:\\bin;WT_HOOK_TELEMETRY=wtlm-7;");
+	CHECK(parameters.find(LauncherArguments::QuoteArgument(request.commandLine) + L" " + environment + L" ") != std::wstring::npos);
+	CHECK(parameters.size() > 8 && parameters.compare(parameters.size() - 8, 8, L"\"pipe-7\"") == 0);
+
+	const std::vector<std::wstring> entries = LauncherArguments::SplitEnvironment(environment.substr(1, environment.size() - 2));
+	CHECK(entries.size() == 3);
+	CHECK(entries.size() == 3 && entries[1] == L"PATH=C:\\bin" && entries[2] == L"WT_HOOK_TELEMETRY=wtlm-7");
+}
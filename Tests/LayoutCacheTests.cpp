@@ -0,0 +1,251 @@
+﻿#include "Test.h"
+#include "ContentHash.h"
+#include "LayoutCache.h"
+#include <chrono>
+#include <cstring>
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr uint32_t Schema = 7;
+
+	// A LocalState folder with settings.json and state.json, cached with two profiles and one
+	// two-pane tab.
+	struct CachedFolder
+	{
+		Tests::TempFolder folder;
+
+		CachedFolder()
+		{
+			Tests::WriteFile(folder / "settings.json", "{\"profiles\":{\"list\":[]}}");
+			Tests::WriteFile(folder / "state.json", "{\"persistedWindowLayouts\":[]}");
+			Save();
+		}
+
+		void Save()
+		{
+			CacheSourceKey keys[LayoutCacheSourceCount];
+			LayoutCache::CaptureSources(folder.path(), keys, true);
+
+			LayoutCacheWriter writer;
+			writer.BeginFile(0, false);
+			writer.AddProfile(u"Command Prompt", u"ms-appx:///ProfileIcons/cmd.png");
+			writer.AddProfile(u"PowerShell", u"ms-appx:///ProfileIcons/pwsh.png");
+			writer.BeginFile(1, true);
+			writer.BeginTab(std::u16string_view(), 1, 2);
+			writer.AddPane(u"Command Prompt", u"ms-appx:///ProfileIcons/cmd.png", u"cmd.exe /k", u"C:\\",
+				std::u16string_view(), 0.0, 0.0, 0.5, 1.0, GridPlacement{ 0, 0, 1, 1 });
+			writer.AddPane(u"PowerShell", u"ms-appx:///ProfileIcons/pwsh.png", std::u16string_view(), u"",
+				u"right", 0.5, 0.0, 0.5, 1.0, GridPlacement{ 0, 1, 1, 1 });
+			CHECK(writer.Save(folder.path(), Schema, keys));
+		}
+
+		CacheStatus Open(uint32_t schema = Schema)
+		{
+			CacheSourceKey current[LayoutCacheSourceCount];
+			return reader.Open(folder.path(), schema, current);
+		}
+
+		// Moves the modification time of a source file without changing its contents.
+		void Touch(const char* name)
+		{
+			const fs::path path = folder / name;
+			fs::last_write_time(path, fs::last_write_time(path) + std::chrono::seconds(5));
+		}
+
+		fs::path CachePath() const
+		{
+			return LayoutCache::PathFor(folder.path());
+		}
+
+		LayoutCacheReader reader;
+	};
+
+	// Reads the cache image, lets the caller edit it and writes it back; the payload hash is
+	// recomputed when asked so that only the edit itself can fail validation.
+	template <typename Edit>
+	void EditCache(const fs::path& path, bool rehash, Edit edit)
+	{
+		std::string image = Tests::ReadFile(path);
+		CHECK(image.size() > sizeof(CacheHeader));
+		CacheHeader header;
+		std::memcpy(&header, image.data(), sizeof(header));
+		edit(header, image);
+		if (rehash)
+		{
+			header.payloadHash = ContentHash::Hash64(image.data() + sizeof(CacheHeader), image.size() - sizeof(CacheHeader));
+		}
+		std::memcpy(&image[0], &header, sizeof(header));
+		Tests::WriteFile(path, image);
+	}
+}
+
+TEST(RoundTripsRecords)
+{
+	CachedFolder cached;
+	CHECK(cached.Open() == CacheStatus::Fresh);
+
+	const LayoutCacheReader& r = cached.reader;
+	CHECK(r.header().fileCount == 2);
+	CHECK(r.header().profileCount == 2);
+	CHECK(r.header().tabCount == 1);
+	CHECK(r.header().paneCount == 2);
+
+	CHECK(r.files()[0].source == 0);
+	CHECK(r.files()[0].flags == 0);
+	CHECK(r.files()[0].profileCount == 2);
+	CHECK(r.files()[1].source == 1);
+	CHECK(r.files()[1].flags == CacheFileHasTabs);
+	CHECK(r.files()[1].tabCount == 1);
+
+	CHECK(r.str(r.profiles()[0].name) == u"Command Prompt");
+	CHECK(r.str(r.profiles()[1].icon) == u"ms-appx:///ProfileIcons/pwsh.png");
+
+	CHECK(r.str(r.tabs()[0].title).data() == nullptr);
+	CHECK(r.tabs()[0].rows == 1);
+	CHECK(r.tabs()[0].columns == 2);
+	CHECK(r.tabs()[0].paneCount == 2);
+
+	const CachePaneRecord& left = r.panes()[0];
+	CHECK(r.str(left.profile) == u"Command Prompt");
+	CHECK(r.str(left.commandline) == u"cmd.exe /k");
+	CHECK(r.str(left.startingDirectory) == u"C:\\");
+	CHECK(r.str(left.splitDirection).data() == nullptr);
+	CHECK(left.width == 0.5);
+
+	const CachePaneRecord& right = r.panes()[1];
+	CHECK(r.str(right.commandline).data() == nullptr);
+	CHECK(r.str(right.startingDirectory).data() != nullptr);
+	CHECK(r.str(right.startingDirectory).empty());
+	CHECK(r.str(right.splitDirection) == u"right");
+	CHECK(right.x == 0.5);
+	CHECK(right.placement.column == 1);
+
+	// Identical strings are stored once.
+	CHECK(left.profile.offset == r.profiles()[0].name.offset);
+	CHECK(left.icon.offset == r.profiles()[0].icon.offset);
+}
+
+TEST(MissingWithoutCache)
+{
+	Tests::TempFolder folder;
+	Tests::WriteFile(folder / "settings.json", "{}");
+	LayoutCacheReader reader;
+	CacheSourceKey current[LayoutCacheSourceCount];
+	CHECK(reader.Open(folder.path(), Schema, current) == CacheStatus::Missing);
+}
+
+TEST(FreshAfterTouch)
+{
+	CachedFolder cached;
+	cached.Touch("settings.json");
+	cached.Touch("state.json");
+	CHECK(cached.Open() == CacheStatus::Fresh);
+}
+
+TEST(StaleAfterSameSizeEdit)
+{
+	CachedFolder cached;
+	Tests::WriteFile(cached.folder / "state.json", "{\"persistedWindowLayoutz\":[]}");
+	cached.Touch("state.json");
+	CHECK(cached.Open() == CacheStatus::Stale);
+}
+
+TEST(StaleAfterResizingEdit)
+{
+	CachedFolder cached;
+	Tests::WriteFile(cached.folder / "settings.json", "{\"profiles\":{\"list\":[{}]}}");
+	CHECK(cached.Open() == CacheStatus::Stale);
+}
+
+TEST(StaleAfterAddedFile)
+{
+	CachedFolder cached;
+	Tests::WriteFile(cached.folder / "elevated-state.json", "{}");
+	CHECK(cached.Open() == CacheStatus::Stale);
+}
+
+TEST(StaleAfterDeletedFile)
+{
+	CachedFolder cached;
+	fs::remove(cached.folder / "state.json");
+	CHECK(cached.Open() == CacheStatus::Stale);
+}
+
+TEST(FreshAgainAfterResave)
+{
+	CachedFolder cached;
+	Tests::WriteFile(cached.folder / "elevated-state.json", "{}");
+	CHECK(cached.Open() == CacheStatus::Stale);
+	cached.Save();
+	CHECK(cached.Open() == CacheStatus::Fresh);
+}
+
+TEST(StaleAfterSchemaBump)
+{
+	CachedFolder cached;
+	CHECK(cached.Open(Schema + 1) == CacheStatus::Stale);
+}
+
+TEST(CorruptAfterFormatVersionBump)
+{
+	CachedFolder cached;
+	EditCache(cached.CachePath(), false, [](CacheHeader& header, std::string&) { header.version = LayoutCache::Version + 1; });
+	CHECK(cached.Open() == CacheStatus::Corrupt);
+}
+
+TEST(CorruptWithBadMagic)
+{
+	CachedFolder cached;
+	EditCache(cached.CachePath(), false, [](CacheHeader& header, std::string&) { header.magic ^= 0xFF; });
+	CHECK(cached.Open() == CacheStatus::Corrupt);
+}
+
+TEST(CorruptWithBadPayloadHash)
+{
+	CachedFolder cached;
+	EditCache(cached.CachePath(), false, [](CacheHeader&, std::string& image) { image.back() ^= 0x01; });
+	CHECK(cached.Open() == CacheStatus::Corrupt);
+}
+
+TEST(CorruptWhenTruncated)
+{
+	CachedFolder cached;
+	std::string image = Tests::ReadFile(cached.CachePath());
+	image.resize(image.size() - 8);
+	Tests::WriteFile(cached.CachePath(), image);
+	CHECK(cached.Open() == CacheStatus::Corrupt);
+
+	Tests::WriteFile(cached.CachePath(), image.substr(0, sizeof(CacheHeader) / 2));
+	CHECK(cached.Open() == CacheStatus::Corrupt);
+}
+
+TEST(CorruptWithSectionOutOfBounds)
+{
+	CachedFolder cached;
+	EditCache(cached.CachePath(), true, [](CacheHeader& header, std::string&) { header.paneCount += 100; });
+	CHECK(cached.Open() == CacheStatus::Corrupt);
+}
+
+TEST(CorruptWithPaneStringOutOfBounds)
+{
+	// Each pane string is checked on its own: the payload hash is valid, only the offset is wrong.
+	const auto commandline = [](CachePaneRecord& pane) -> CacheString& { return pane.commandline; };
+	const auto startingDirectory = [](CachePaneRecord& pane) -> CacheString& { return pane.startingDirectory; };
+	for (CacheString& (*field)(CachePaneRecord&) : { +commandline, +startingDirectory })
+	{
+		CachedFolder cached;
+		EditCache(cached.CachePath(), true, [field](CacheHeader& header, std::string& image)
+			{
+				CachePaneRecord pane;
+				char* record = &image[header.panesOffset];
+				std::memcpy(&pane, record, sizeof(pane));
+				field(pane).offset = static_cast<uint32_t>(header.stringsLength);
+				field(pane).length = 1;
+				std::memcpy(record, &pane, sizeof(pane));
+			});
+		CHECK(cached.Open() == CacheStatus::Corrupt);
+	}
+}
@@ -0,0 +1,236 @@
+﻿#include "Test.h"
+#include "InstanceRegistry.h"
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr const char* Family = "Microsoft.WindowsTerminal_8wekyb3d8bbwe";
+	const std::string Settings = "{\"profiles\":{\"list\":[{\"name\":\"cmd\"}]}}";
+	const std::string State = "{\"persistedWindowLayouts\":[]}";
+
+	struct CliResult
+	{
+		int status;
+		std::string output;
+		std::string errors;
+	};
+
+	fs::path FromUtf8(const std::string& text)
+	{
+		return fs::path(std::u8string(text.begin(), text.end()));
+	}
+
+	// A local app data folder with the default LocalState folder of the stable terminal and the copies
+	// the test makes, and LayoutCli run against it.
+	struct DataFolder
+	{
+		Tests::TempFolder folder;
+		fs::path data = folder / "data";
+		fs::path localState = data / "Packages" / Family / "LocalState";
+		fs::path copies = data / "WTLayoutManager" / Family;
+
+		DataFolder()
+		{
+			Tests::WriteFile(localState / "settings.json", Settings);
+			Tests::WriteFile(localState / "state.json", State);
+		}
+
+		// Makes a copy whose state.json was last written the given number of minutes ago.
+		fs::path Copy(const std::string& name, int minutesAgo)
+		{
+			const fs::path copy = copies / FromUtf8(name);
+			Tests::WriteFile(copy / "settings.json", Settings);
+			Tests::WriteFile(copy / "state.json", State);
+			fs::last_write_time(copy / "state.json", fs::file_time_type::clock::now() - std::chrono::minutes(minutesAgo));
+			return copy;
+		}
+
+		CliResult Run(const std::string& arguments) const
+		{
+			const fs::path output = folder / "output.json";
+			const fs::path errors = folder / "errors.txt";
+			std::string command = "\"" LAYOUTCLI_PATH "\" --data \"" + data.string() + "\" " + arguments
+				+ " > \"" + output.string() + "\" 2> \"" + errors.string() + "\"";
+#if defined(_WIN32)
+			command = "\"" + command + "\"";    // cmd strips the outer quotes
+#endif
+			int status = std::system(command.c_str());
+#if !defined(_WIN32)
+			status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+			return { status, Tests::ReadFile(output), Tests::ReadFile(errors) };
+		}
+	};
+
+	bool Contains(const std::string& text, const std::string& part)
+	{
+		return text.find(part) != std::string::npos;
+	}
+
+	// The key the instance registry has a folder under, as LayoutCli computes it.
+	std::wstring RegistryKey(const fs::path& folder)
+	{
+#if defined(_WIN32)
+		return folder.wstring();
+#else
+		const std::u32string text = folder.u32string();
+		return std::wstring(text.begin(), text.end());
+#endif
+	}
+
+	uint32_t CurrentProcessId()
+	{
+#if defined(_WIN32)
+		return ::GetCurrentProcessId();
+#else
+		return static_cast<uint32_t>(::getpid());
+#endif
+	}
+}
+
+TEST(ListsTheDefaultFolderAndCopies)
+{
+	DataFolder d;
+	d.Copy("Work", 5);
+	const CliResult result = d.Run("list");
+	CHECK(result.status == 0);
+	CHECK(Contains(result.output, "{\"snapshots\":[{\"name\":\"LocalState\","));
+	CHECK(Contains(result.output, "\"default\":true"));
+	CHECK(Contains(result.output, "\"name\":\"Work\",\"path\":"));
+	CHECK(Contains(result.output, "\"default\":false,\"pinned\":false"));
+	CHECK(Contains(result.output, "{\"name\":\"settings.json\",\"size\":" + std::to_string(Settings.size()) + ","));
+	CHECK(Contains(result.output, "\"runningPid\":null"));
+	CHECK(!Contains(result.output, "elevated-state.json"));
+}
+
+TEST(DuplicatesFolders)
+{
+	DataFolder d;
+	const CliResult result = d.Run("duplicate LocalState --name \"\xC3\x89quipe\"");
+	CHECK(result.status == 0);
+	CHECK(Contains(result.output, "\"name\":\"\xC3\x89quipe\",\"error\":null"));
+	const fs::path copy = d.copies / FromUtf8("\xC3\x89quipe");
+	CHECK(Tests::ReadFile(copy / "settings.json") == Settings);
+	CHECK(Tests::ReadFile(copy / "state.json") == State);
+
+	// An existing copy is not overwritten, and a missing source is reported.
+	CHECK(d.Run("duplicate LocalState --name \"\xC3\x89quipe\"").status == 1);
+	const CliResult missing = d.Run("duplicate Missing --name Other");
+	CHECK(missing.status == 1);
+	CHECK(!Contains(missing.output, "\"error\":null"));
+	CHECK(!fs::exists(d.copies / "Other"));
+}
+
+TEST(DeletesCopiesButNotTheDefaultFolder)
+{
+	DataFolder d;
+	const fs::path copy = d.Copy("Old", 5);
+	const CliResult result = d.Run("delete Old LocalState");
+	CHECK(result.status == 1);
+	CHECK(Contains(result.output, "\"error\":null"));
+	CHECK(Contains(result.output, "the default LocalState folder cannot be deleted"));
+	CHECK(!fs::exists(copy));
+	CHECK(fs::exists(d.localState / "state.json"));
+}
+
+TEST(RefusesFoldersATerminalRuns)
+{
+	DataFolder d;
+	const fs::path copy = d.Copy("Busy", 5);
+	RegisteredInstance running(RegistryKey(copy), CurrentProcessId(), false);
+
+	const CliResult list = d.Run("list");
+	CHECK(Contains(list.output, "\"runningPid\":" + std::to_string(CurrentProcessId())));
+	const CliResult result = d.Run("delete Busy");
+	CHECK(result.status == 1);
+	CHECK(Contains(result.output, "a terminal runs the folder"));
+	CHECK(fs::exists(copy / "state.json"));
+}
+
+TEST(PinsAndPrunes)
+{
+	DataFolder d;
+	const fs::path oldest = d.Copy("Oldest", 30);
+	const fs::path older = d.Copy("Older", 20);
+	const fs::path newest = d.Copy("Newest", 10);
+	CHECK(d.Run("pin Oldest").status == 0);
+	CHECK(Contains(d.Run("list").output, "\"name\":\"Oldest\",\"path\":"));
+	CHECK(Contains(d.Run("list").output, "\"default\":false,\"pinned\":true"));
+	CHECK(d.Run("pin LocalState").status == 1);
+
+	const CliResult plan = d.Run("prune --max-count 2 --dry-run");
+	CHECK(plan.status == 0);
+	CHECK(Contains(plan.output, "\"maxCount\":2,\"maxBytes\":0,\"dryRun\":true"));
+	CHECK(Contains(plan.output, "\"action\":\"pinned\""));
+	CHECK(Contains(plan.output, "\"action\":\"evict\""));
+	CHECK(fs::exists(older));
+
+	CHECK(d.Run("prune --max-count 2").status == 0);
+	CHECK(fs::exists(oldest));
+	CHECK(!fs::exists(older));
+	CHECK(fs::exists(newest));
+
+	CHECK(d.Run("unpin Oldest").status == 0);
+	CHECK(Contains(d.Run("list").output, "\"default\":false,\"pinned\":false"));
+	CHECK(!Contains(d.Run("list").output, "\"pinned\":true"));
+}
+
+TEST(ReadsBatchFiles)
+{
+	DataFolder d;
+	d.Copy("First", 5);
+	d.Copy("Second", 5);
+	Tests::WriteFile(d.folder / "batch.txt", "\xEF\xBB\xBF# restored every morning\r\n  First  \r\n\r\nSecond\n");
+	const CliResult result = d.Run("launch --terminal wt.exe --batch \"" + (d.folder / "batch.txt").string() + "\"");
+	CHECK(Contains(result.output, "First\",\"status\":"));
+	CHECK(Contains(result.output, "Second\",\"status\":"));
+	CHECK(!Contains(result.output, "morning"));
+#if !defined(_WIN32)
+	// Launching needs Windows.
+	CHECK(result.status == 1);
+	CHECK(Contains(result.output, "\"status\":\"failed\",\"pid\":null,\"error\":-4"));
+#endif
+}
+
+TEST(DetachesCopiesBeforeLaunch)
+{
+	DataFolder d;
+	CHECK(d.Run("duplicate LocalState --name Shared").status == 0);
+	const fs::path settings = d.copies / "Shared" / "settings.json";
+	CHECK(Tests::ReadFile(settings) == Settings);
+
+	// Launching fails off Windows, after the copy got private, writable files.
+	d.Run("launch --terminal wt.exe Shared");
+	CHECK(fs::hard_link_count(settings) == 1);
+	CHECK((fs::status(settings).permissions() & fs::perms::owner_write) != fs::perms::none);
+	CHECK(Tests::ReadFile(settings) == Settings);
+	CHECK(fs::hard_link_count(d.localState / "settings.json") == 1);
+}
+
+TEST(RejectsUsageErrors)
+{
+	DataFolder d;
+	const CliResult none = d.Run("");
+	CHECK(none.status == 2);
+	CHECK(none.output.empty());
+	CHECK(Contains(none.errors, "Usage: LayoutCli"));
+	CHECK(d.Run("list --bogus").status == 2);
+	CHECK(d.Run("list Extra").status == 2);
+	CHECK(d.Run("launch First").status == 2);
+	CHECK(d.Run("prune --max-count -1").status == 2);
+	const CliResult batch = d.Run("launch --terminal wt.exe --batch missing.txt");
+	CHECK(batch.status == 2);
+	CHECK(Contains(batch.errors, "Cannot read the batch file missing.txt."));
+}
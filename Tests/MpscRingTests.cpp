@@ -0,0 +1,87 @@
+﻿#include "Test.h"
+#include "MpscRing.h"
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+
+TEST(RoundsCapacityToAPowerOfTwo)
+{
+	CHECK(MpscRing<int>(0).Capacity() == 2);
+	CHECK(MpscRing<int>(3).Capacity() == 4);
+	CHECK(MpscRing<int>(64).Capacity() == 64);
+	CHECK(MpscRing<int>(65).Capacity() == 128);
+}
+
+TEST(PopsInOrderAndRefusesWhenFull)
+{
+	MpscRing<int> ring(4);
+	for (int i = 0; i < 4; ++i)
+	{
+		CHECK(ring.TryPush([i](int& value) { value = i; }));
+	}
+	CHECK(!ring.TryPush([](int& value) { value = 99; }));
+
+	int popped = -1;
+	CHECK(ring.TryPop([&](const int& value) { popped = value; }));
+	CHECK(popped == 0);
+
+	// The freed cell is reused, after the values already queued.
+	CHECK(ring.TryPush([](int& value) { value = 4; }));
+	for (int expected = 1; expected <= 4; ++expected)
+	{
+		CHECK(ring.TryPop([&](const int& value) { popped = value; }));
+		CHECK(popped == expected);
+	}
+	CHECK(!ring.TryPop([](const int&) {}));
+}
+
+TEST(DeliversEveryPushOfConcurrentProducers)
+{
+	constexpr uint32_t Producers = 4;
+	constexpr uint32_t PerProducer = 50000;
+	MpscRing<uint64_t> ring(256);
+
+	std::vector<std::thread> producers;
+	for (uint32_t p = 0; p < Producers; ++p)
+	{
+		producers.emplace_back([&ring, p] {
+			for (uint32_t i = 0; i < PerProducer; ++i)
+			{
+				const uint64_t item = (uint64_t{ p } << 32) | i;
+				while (!ring.TryPush([item](uint64_t& value) { value = item; }))
+				{
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+
+	// Each producer's values arrive in the order it pushed them.
+	std::vector<uint32_t> next(Producers, 0);
+	uint64_t received = 0;
+	bool ordered = true;
+	while (received < uint64_t{ Producers } * PerProducer)
+	{
+		if (!ring.TryPop([&](const uint64_t& value) {
+				const uint32_t producer = static_cast<uint32_t>(value >> 32);
+				ordered = ordered && producer < Producers && static_cast<uint32_t>(value) == next[producer];
+				if (producer < Producers)
+				{
+					++next[producer];
+				}
+			}))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		++received;
+	}
+	for (std::thread& producer : producers)
+	{
+		producer.join();
+	}
+	CHECK(ordered);
+	CHECK(!ring.TryPop([](const uint64_t&) {}));
+}
@@ -0,0 +1,186 @@
+﻿#include "Test.h"
+#include "NativeLog.h"
+#include <string>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	// The ring is sized by the first Start of the process, so every test asks for the same capacity.
+	NativeLogOptions Options(const Tests::TempFolder& folder, LogLevel minimumLevel = LogLevel::Trace)
+	{
+		NativeLogOptions options;
+		options.directory = folder / "logs";
+		options.baseName = "test";
+		options.minimumLevel = minimumLevel;
+		options.capacity = 64;
+		return options;
+	}
+
+	std::vector<std::string> Lines(const fs::path& file)
+	{
+		std::vector<std::string> lines;
+		const std::string contents = Tests::ReadFile(file);
+		size_t start = 0;
+		for (size_t end = contents.find('\n'); end != std::string::npos; end = contents.find('\n', start))
+		{
+			lines.push_back(contents.substr(start, end - start));
+			start = end + 1;
+		}
+		CHECK(start == contents.size());
+		return lines;
+	}
+
+	bool Contains(const std::string& line, const std::string& part)
+	{
+		return line.find(part) != std::string::npos;
+	}
+}
+
+TEST(WritesLogfmtLines)
+{
+	Tests::TempFolder folder;
+	{
+		NativeLogSession session(Options(folder));
+		NativeLog::Write(LogLevel::Error, "launch.create_process", 5, {
+			{ "pid", -3 }, { "bytes", 7u }, { "app", "C:\\x y\\\"wt\".exe" }, { "title", L"Caf\u00e9" } });
+		NativeLog::Write(LogLevel::Info, "launch.done", 0, { { "plain", "value" }, { "empty", "" } });
+	}
+
+	const std::vector<std::string> lines = Lines(folder / "logs" / "test.log");
+	CHECK(lines.size() == 2);
+	if (lines.size() == 2)
+	{
+		// 2026-01-02T03:04:05.678901Z ERROR [1234] launch.create_process code=0x00000005 ...
+		CHECK(lines[0].size() > 28 && lines[0][10] == 'T' && lines[0][26] == 'Z');
+		CHECK(Contains(lines[0], " ERROR ["));
+		CHECK(Contains(lines[0], "] launch.create_process code=0x00000005 pid=-3 bytes=7 app=\"C:\\\\x y\\\\\\\"wt\\\".exe\" title=Caf\xc3\xa9"));
+		CHECK(Contains(lines[1], " INFO ["));
+		CHECK(Contains(lines[1], "] launch.done plain=value empty=\"\""));
+		CHECK(!Contains(lines[1], "code="));
+	}
+}
+
+TEST(FiltersByLevel)
+{
+	Tests::TempFolder folder;
+	{
+		NativeLogSession session(Options(folder, LogLevel::Warning));
+		CHECK(!NativeLog::Enabled(LogLevel::Info));
+		CHECK(NativeLog::Enabled(LogLevel::Warning));
+		NativeLog::Write(LogLevel::Debug, "test.debug", 0);
+		NativeLog::Write(LogLevel::Warning, "test.warning", 0);
+		NativeLog::Write(LogLevel::Error, "test.error", 0);
+	}
+	const std::vector<std::string> lines = Lines(folder / "logs" / "test.log");
+	CHECK(lines.size() == 2);
+	CHECK(lines.size() == 2 && Contains(lines[0], " WARN [") && Contains(lines[1], "test.error"));
+}
+
+TEST(IgnoresWritesWhileStopped)
+{
+	Tests::TempFolder folder;
+	NativeLog::Write(LogLevel::Error, "test.before", 0);
+	CHECK(!NativeLog::Enabled(LogLevel::Error));
+	{
+		NativeLogSession session(Options(folder));
+		NativeLog::Write(LogLevel::Error, "test.during", 0);
+	}
+	NativeLog::Write(LogLevel::Error, "test.after", 0);
+
+	// A second session appends to the same file.
+	{
+		NativeLogSession session(Options(folder));
+		NativeLog::Write(LogLevel::Error, "test.again", 0);
+	}
+	const std::vector<std::string> lines = Lines(folder / "logs" / "test.log");
+	CHECK(lines.size() == 2);
+	CHECK(lines.size() == 2 && Contains(lines[0], "test.during") && Contains(lines[1], "test.again"));
+}
+
+TEST(KeepsTheFirstArgumentsAndTruncatesText)
+{
+	Tests::TempFolder folder;
+	const std::string longText(300, 'x');
+	{
+		NativeLogSession session(Options(folder));
+		NativeLog::Write(LogLevel::Info, "test.args", 0, { { "a", 1 }, { "b", 2 }, { "c", 3 }, { "d", 4 }, { "e", 5 } });
+		NativeLog::Write(LogLevel::Info, "test.text", 0, { { "long", longText }, { "next", "y" } });
+		// Truncation stops before a character that does not fit whole.
+		NativeLog::Write(LogLevel::Info, "test.utf8", 0, { { "s", std::string(127, 'x') + "\xc3\xa9" } });
+	}
+	const std::vector<std::string> lines = Lines(folder / "logs" / "test.log");
+	CHECK(lines.size() == 3);
+	if (lines.size() == 3)
+	{
+		CHECK(Contains(lines[0], "a=1 b=2 c=3 d=4"));
+		CHECK(!Contains(lines[0], "e=5"));
+		const size_t value = lines[1].find("long=") + 5;
+		const size_t end = lines[1].find(' ', value);
+		CHECK(end != std::string::npos && end - value <= 128 && end - value > 100);
+		CHECK(Contains(lines[1], "next="));
+		CHECK(Contains(lines[2], "s=" + std::string(127, 'x')));
+		CHECK(!Contains(lines[2], "\xc3"));
+	}
+}
+
+TEST(RollsOverFiles)
+{
+	Tests::TempFolder folder;
+	NativeLogOptions options = Options(folder);
+	options.maxFileBytes = 2048;
+	options.maxFiles = 3;
+	// Each session writes about 1.2 KB; the flush that would pass 2 KB rolls the file first.
+	for (int session = 0; session < 6; ++session)
+	{
+		NativeLogSession scope(options);
+		for (int i = 0; i < 10; ++i)
+		{
+			NativeLog::Write(LogLevel::Info, "test.roll", 0, { { "session", session }, { "i", i }, { "pad", "0123456789012345678901234567890123456789012345678901234567890123" } });
+		}
+	}
+	const fs::path logs = folder / "logs";
+	CHECK(fs::exists(logs / "test.log"));
+	CHECK(fs::exists(logs / "test.1.log"));
+	CHECK(fs::exists(logs / "test.2.log"));
+	CHECK(!fs::exists(logs / "test.3.log"));
+	CHECK(fs::file_size(logs / "test.log") <= 2048);
+	CHECK(fs::file_size(logs / "test.1.log") <= 2048);
+
+	// The newest records are in test.log, the oldest kept ones in test.2.log.
+	const std::vector<std::string> newest = Lines(logs / "test.log");
+	CHECK(!newest.empty() && Contains(newest.back(), "session=5 i=9"));
+	CHECK(!Contains(Tests::ReadFile(logs / "test.2.log"), "session=5"));
+}
+
+TEST(CountsDroppedRecords)
+{
+	constexpr int Records = 20000;
+	Tests::TempFolder folder;
+	const uint64_t droppedBefore = NativeLog::Dropped();
+	{
+		NativeLogSession session(Options(folder));
+		for (int i = 0; i < Records; ++i)
+		{
+			NativeLog::Write(LogLevel::Info, "test.burst", 0, { { "i", i } });
+		}
+	}
+	const uint64_t dropped = NativeLog::Dropped() - droppedBefore;
+
+	// Every record is either written or counted, and the drops are reported in the file.
+	size_t written = 0;
+	uint64_t reported = 0;
+	for (const std::string& line : Lines(folder / "logs" / "test.log"))
+	{
+		written += Contains(line, "test.burst") ? 1 : 0;
+		const size_t count = line.find("log.dropped count=");
+		if (count != std::string::npos)
+		{
+			reported += std::stoull(line.substr(count + 18));
+		}
+	}
+	CHECK(written + dropped == Records);
+	CHECK(reported == dropped);
+}
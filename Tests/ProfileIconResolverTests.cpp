@@ -0,0 +1,165 @@
+﻿#include "Test.h"
+#include "ProfileIconResolver.h"
+#include <cstdlib>
+#include <string>
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	std::u16string Asset(std::u16string_view fileName)
+	{
+		return std::u16string(ProfileIconResolver::AssetUriPrefix) + std::u16string(fileName);
+	}
+
+	std::u16string Resolve(std::u16string_view guid, std::u16string_view icon, std::u16string_view source, std::u16string_view name)
+	{
+		ProfileIconResolver::ClearMemo();
+		return ProfileIconResolver::Resolve(guid, icon, source, name);
+	}
+
+	void SetVariable(const char* name, const std::string& value)
+	{
+#if defined(_WIN32)
+		::_putenv_s(name, value.c_str());
+#else
+		::setenv(name, value.c_str(), 1);
+#endif
+	}
+
+	/// One row of the old IconMappings table, and the rules around it: the profile and the asset it gets.
+	struct IconRow
+	{
+		std::u16string_view source;
+		std::u16string_view name;
+		std::u16string_view asset;
+	};
+
+	constexpr std::u16string_view Wsl = u"Windows.Terminal.Wsl";
+	constexpr std::u16string_view VisualStudio = u"Windows.Terminal.VisualStudio";
+
+	constexpr IconRow IconRows[] = {
+		// Each rule of the table, in its order.
+		{ Wsl, u"Ubuntu", u"wsl.png" },
+		{ u"Git", u"Git Bash", u"git-bash.png" },
+		{ VisualStudio, u"Developer Windows PowerShell for VS 2022", u"vs-powershell.png" },
+		{ VisualStudio, u"Developer PowerShell for VS 2022", u"vs-pwsh.png" },
+		{ VisualStudio, u"Developer Command Prompt for VS 2022", u"vs-cmd.png" },
+		{ u"", u"Windows PowerShell", u"powershell.png" },
+		{ u"Windows.Terminal.PowershellCore", u"PowerShell 7 Preview", u"pwsh-preview.png" },
+		{ u"Windows.Terminal.PowershellCore", u"PowerShell", u"pwsh.png" },
+
+		// The first matching rule wins.
+		{ Wsl, u"PowerShell on Ubuntu", u"wsl.png" },
+		{ u"Git", u"Windows PowerShell", u"git-bash.png" },
+		{ VisualStudio, u"Developer Windows PowerShell Preview", u"vs-powershell.png" },
+		{ u"", u"Windows PowerShell Preview", u"powershell.png" },
+
+		// Suffixes and names are matched as in C#: whole, and case-sensitively.
+		{ u"Windows.Terminal.Wsl.Extra", u"Ubuntu", u"cmd.png" },
+		{ u"GitHub", u"Shell", u"cmd.png" },
+		{ u"", u"powershell", u"cmd.png" },
+		{ VisualStudio, u"Developer Shell", u"cmd.png" },
+
+		// The fallback.
+		{ u"", u"Command Prompt", u"cmd.png" },
+		{ u"", u"", u"cmd.png" },
+	};
+}
+
+TEST(AppliesTheRulesToProfilesWithoutAnIcon)
+{
+	for (const IconRow& row : IconRows)
+	{
+		CHECK(Resolve(u"", u"", row.source, row.name) == Asset(row.asset));
+		CHECK(Resolve(u"{00000000-0000-0000-0000-000000000000}", u" \t", row.source, row.name) == Asset(row.asset));
+	}
+}
+
+TEST(PrefersTheAssetOfTheGuid)
+{
+	const std::u16string_view guid = u"{61c54bbd-c2c6-5271-96e7-009a87ff44bf}";
+	CHECK(Resolve(guid, u"", u"", u"Windows PowerShell") == Asset(std::u16string(guid) + u".png"));
+
+	// Looked up like a WPF resource, ignoring case, and kept as written.
+	const std::u16string_view upper = u"{61C54BBD-C2C6-5271-96E7-009A87FF44BF}";
+	CHECK(Resolve(upper, u"", u"", u"") == Asset(std::u16string(upper) + u".png"));
+	CHECK(Resolve(u"profiles\\{61c54bbd-c2c6-5271-96e7-009a87ff44bf}", u"", u"", u"") == Asset(std::u16string(guid) + u".png"));
+}
+
+TEST(UsesAnExplicitIcon)
+{
+	// ms-appx icons map onto the bundled asset of the same file name.
+	CHECK(Resolve(u"", u"ms-appx:///ProfileIcons/{9acb9455-ca41-5af7-950f-6bca1bc9722f}.png", Wsl, u"Ubuntu")
+		== Asset(u"{9acb9455-ca41-5af7-950f-6bca1bc9722f}.png"));
+
+	Tests::TempFolder folder;
+	Tests::WriteFile(folder / "icon.png", "png");
+	const std::u16string path = (folder / "icon.png").u16string();
+	CHECK(Resolve(u"{61c54bbd-c2c6-5271-96e7-009a87ff44bf}", path, u"Git", u"Git Bash") == path);
+
+	// Environment variables are expanded before the file is looked for.
+	SetVariable("WTLM_ICON_FOLDER", folder.path().string());
+	const std::u16string expanded = Resolve(u"", u"%WTLM_ICON_FOLDER%/icon.png", u"", u"");
+	CHECK(fs::equivalent(fs::path(expanded), folder / "icon.png"));
+
+	// A missing file falls back to the rules, not to the guid's asset.
+	const std::u16string missing = (folder / "missing.png").u16string();
+	CHECK(Resolve(u"{61c54bbd-c2c6-5271-96e7-009a87ff44bf}", missing, u"", u"PowerShell") == Asset(u"pwsh.png"));
+	CHECK(Resolve(u"", u"%WTLM_UNSET_ICON_VARIABLE%\\icon.png", u"", u"") == Asset(u"cmd.png"));
+}
+
+TEST(MemoizesUntilCleared)
+{
+	Tests::TempFolder folder;
+	const std::u16string path = (folder / "late.png").u16string();
+	ProfileIconResolver::ClearMemo();
+	const uint32_t before = ProfileIconResolver::ResolveId(u"", path, u"", u"PowerShell");
+	CHECK(ProfileIconResolver::ResolveId(u"", path, u"", u"PowerShell") == before);
+	CHECK(ProfileIconResolver::ResolveId(u"", path, u"", u"Windows PowerShell") != before);
+
+	// The file appearing is only noticed once the memo is cleared.
+	Tests::WriteFile(folder / "late.png", "png");
+	CHECK(ProfileIconResolver::Resolve(u"", path, u"", u"PowerShell") == Asset(u"pwsh.png"));
+	ProfileIconResolver::ClearMemo();
+	CHECK(ProfileIconResolver::Resolve(u"", path, u"", u"PowerShell") == path);
+
+	// Fields are kept apart in the key.
+	CHECK(ProfileIconResolver::Resolve(u"", u"", u"Gi", u"tPowerShell") == Asset(u"pwsh.png"));
+	CHECK(ProfileIconResolver::Resolve(u"", u"", u"Git", u"PowerShell") == Asset(u"git-bash.png"));
+}
+
+TEST(KnowsEveryBundledAsset)
+{
+	size_t assets = 0;
+	for (const fs::directory_entry& entry : fs::directory_iterator(WTLM_ASSETS_FOLDER))
+	{
+		if (entry.path().extension() != ".png")
+		{
+			continue;
+		}
+		++assets;
+		const std::u16string stem = entry.path().stem().u16string();
+		std::u16string upper = stem;
+		for (char16_t& c : upper)
+		{
+			c = c >= u'a' && c <= u'z' ? static_cast<char16_t>(c - (u'a' - u'A')) : c;
+		}
+		CHECK(ProfileIconResolver::IsBundledAsset(stem));
+		CHECK(ProfileIconResolver::IsBundledAsset(upper));
+		CHECK(Resolve(stem, u"", u"", u"") == Asset(stem + u".png"));
+	}
+	CHECK(assets >= 19);
+
+	// Every asset a rule picks is bundled.
+	for (const IconRow& row : IconRows)
+	{
+		CHECK(ProfileIconResolver::IsBundledAsset(row.asset.substr(0, row.asset.size() - 4)));
+	}
+
+	for (std::u16string_view stem : { u"", u"cmd.png", u"cmdx", u"cm", u"{61c54bbd-c2c6-5271-96e7-009a87ff44b0}", u"terminal-" })
+	{
+		CHECK(!ProfileIconResolver::IsBundledAsset(stem));
+	}
+}
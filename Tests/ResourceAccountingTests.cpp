@@ -0,0 +1,233 @@
+﻿#include "Test.h"
+#include "ResourceAccounting.h"
+#include <chrono>
+#include <string>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <ctime>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	constexpr uint64_t MiB = 1024 * 1024;
+
+#if !defined(_WIN32)
+	constexpr uint64_t BurnMicroseconds = 200000;
+	constexpr uint64_t TouchedBytes = 32 * MiB;
+
+	// Children of a process that may have other threads only use async-signal-safe calls until they exit.
+
+	/// Spends CPU time and keeps memory resident, as a busy shell would.
+	void Work()
+	{
+		void* memory = ::mmap(nullptr, TouchedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (memory != MAP_FAILED)
+		{
+			for (uint64_t offset = 0; offset < TouchedBytes; offset += 4096)
+			{
+				static_cast<volatile char*>(memory)[offset] = 1;
+			}
+		}
+		timespec now{};
+		do
+		{
+			::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+		} while (static_cast<uint64_t>(now.tv_sec) * 1000000 + static_cast<uint64_t>(now.tv_nsec) / 1000 < BurnMicroseconds);
+	}
+
+	void Signal(int fd)
+	{
+		const char byte = 1;
+		while (::write(fd, &byte, 1) < 0)
+		{
+		}
+	}
+
+	void Await(int fd)
+	{
+		char byte = 0;
+		while (::read(fd, &byte, 1) < 0)
+		{
+		}
+	}
+
+	/// A pipe whose ends are closed on destruction.
+	struct Pipe
+	{
+		int ends[2] = { -1, -1 };
+
+		Pipe()
+		{
+			CHECK(::pipe(ends) == 0);
+		}
+
+		~Pipe()
+		{
+			::close(ends[0]);
+			::close(ends[1]);
+		}
+
+		int Read() const { return ends[0]; }
+		int Write() const { return ends[1]; }
+	};
+#endif
+}
+
+TEST(AccountsNothingBeforeAProcessIsAssigned)
+{
+	std::error_code ec;
+	std::unique_ptr<ProcessTreeAccount> account = ProcessTreeAccount::Create(ResourceLimits{}, nullptr, ec);
+	CHECK(account != nullptr);
+	CHECK(!ec);
+	ResourceUsage usage;
+	usage.totalProcesses = 7;
+	CHECK(account->Sample(usage));
+	CHECK(usage.cpuMicroseconds == 0);
+	CHECK(usage.activeProcesses == 0);
+	CHECK(usage.totalProcesses == 0);
+
+	FolderResources resources;
+	CHECK(!ResourceLedger::Shared().Find(L"never launched", resources));
+}
+
+#if !defined(_WIN32)
+TEST(SumsTheUsageOfAProcessTree)
+{
+	Pipe ready;
+	Pipe releaseChild;
+	Pipe releaseGrandchild;
+	std::error_code ec;
+	std::unique_ptr<ProcessTreeAccount> account = ProcessTreeAccount::Create(ResourceLimits{}, nullptr, ec);
+	CHECK(account != nullptr);
+
+	// The child starts a grandchild; both work and report. Once the grandchild exits the child reaps
+	// it and reports again.
+	const pid_t child = ::fork();
+	if (child == 0)
+	{
+		const pid_t grandchild = ::fork();
+		if (grandchild == 0)
+		{
+			Work();
+			Signal(ready.Write());
+			Await(releaseGrandchild.Read());
+			::_exit(0);
+		}
+		Work();
+		Signal(ready.Write());
+		::waitpid(grandchild, nullptr, 0);
+		Signal(ready.Write());
+		Await(releaseChild.Read());
+		::_exit(0);
+	}
+	CHECK(child > 0);
+	CHECK(account->Assign(static_cast<uint32_t>(child), ec));
+	Await(ready.Read());
+	Await(ready.Read());
+
+	ResourceUsage usage;
+	CHECK(account->Sample(usage));
+	CHECK(usage.activeProcesses == 2);
+	CHECK(usage.totalProcesses == 2);
+	CHECK(usage.cpuMicroseconds >= 2 * BurnMicroseconds - 20000);   // clock ticks are 10 ms
+	CHECK(usage.peakMemoryBytes >= 2 * TouchedBytes);
+	CHECK(usage.peakMemoryBytes < 2 * TouchedBytes + 64 * MiB);
+
+	// An exited member keeps the usage last seen; reaping it does not count it again for its parent.
+	Signal(releaseGrandchild.Write());
+	Await(ready.Read());
+	ResourceUsage after;
+	CHECK(account->Sample(after));
+	CHECK(after.activeProcesses == 1);
+	CHECK(after.totalProcesses == 2);
+	CHECK(after.cpuMicroseconds >= usage.cpuMicroseconds);
+	CHECK(after.cpuMicroseconds < usage.cpuMicroseconds + BurnMicroseconds / 2);
+	CHECK(after.peakMemoryBytes == usage.peakMemoryBytes);
+
+	Signal(releaseChild.Write());
+	CHECK(::waitpid(child, nullptr, 0) == child);
+	CHECK(account->Sample(after));
+	CHECK(after.activeProcesses == 0);
+	CHECK(after.totalProcesses == 2);
+	CHECK(after.cpuMicroseconds >= usage.cpuMicroseconds);
+}
+
+TEST(AssigningAnExitedProcessFails)
+{
+	const pid_t child = ::fork();
+	if (child == 0)
+	{
+		::_exit(0);
+	}
+	CHECK(::waitpid(child, nullptr, 0) == child);
+	std::error_code ec;
+	std::unique_ptr<ProcessTreeAccount> account = ProcessTreeAccount::Create(ResourceLimits{}, nullptr, ec);
+	CHECK(!account->Assign(static_cast<uint32_t>(child), ec));
+	CHECK(ec == std::errc::no_such_process);
+}
+
+TEST(LedgerKeepsTheTotalsOfExitedLaunches)
+{
+	const std::wstring folder = L"/tmp/ResourceAccountingTests/LocalState";
+	ResourceLedger& ledger = ResourceLedger::Shared();
+	for (int launch = 1; launch <= 2; ++launch)
+	{
+		Pipe ready;
+		Pipe release;
+		std::error_code ec;
+		std::unique_ptr<ProcessTreeAccount> account = ProcessTreeAccount::Create(ResourceLimits{}, nullptr, ec);
+		const pid_t child = ::fork();
+		if (child == 0)
+		{
+			Work();
+			Signal(ready.Write());
+			Await(release.Read());
+			::_exit(0);
+		}
+		CHECK(child > 0);
+		CHECK(account->Assign(static_cast<uint32_t>(child), ec));
+		const uint64_t id = ledger.Track(folder, std::move(account));
+		Await(ready.Read());
+
+		// The sampler reports a running launch within one interval.
+		FolderResources resources;
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(3 * ResourceLedger::SampleIntervalMilliseconds);
+		while (ledger.Find(folder, resources) && resources.usage.activeProcesses == 0 && std::chrono::steady_clock::now() < deadline)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+		CHECK(resources.launches == static_cast<uint32_t>(launch));
+		CHECK(resources.running == 1);
+		CHECK(resources.usage.activeProcesses == 1);
+		CHECK(resources.usage.cpuMicroseconds >= static_cast<uint64_t>(launch) * BurnMicroseconds - 20000);
+		CHECK(resources.usage.peakMemoryBytes >= TouchedBytes);
+
+		// The terminal exits and is reaped before its launch is released, as when a launch waits for it.
+		Signal(release.Write());
+		CHECK(::waitpid(child, nullptr, 0) == child);
+		ledger.Release(id);
+		ledger.Release(id);   // already released
+		CHECK(ledger.Find(folder, resources));
+		CHECK(resources.launches == static_cast<uint32_t>(launch));
+		CHECK(resources.running == 0);
+		CHECK(resources.usage.activeProcesses == 0);
+		CHECK(resources.usage.totalProcesses == static_cast<uint32_t>(launch));
+		CHECK(resources.usage.cpuMicroseconds >= static_cast<uint64_t>(launch) * BurnMicroseconds - 20000);
+		CHECK(resources.usage.peakMemoryBytes >= TouchedBytes);
+		CHECK(resources.usage.peakMemoryBytes < 2 * TouchedBytes);   // the highest of one launch, not a sum
+	}
+
+	bool listed = false;
+	for (const FolderResources& resources : ledger.Snapshot())
+	{
+		listed = listed || resources.folder == folder;
+	}
+	CHECK(listed);
+}
+#endif
@@ -0,0 +1,174 @@
+﻿#include "Test.h"
+#include "RuntimeMetrics.h"
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	// Only the Windows launch and hook code touches these, so no other test process moves them; the
+	// checks still compare deltas, since the page outlives every process that maps it.
+	constexpr MetricCounter TestCounter = MetricCounter::HookEventsDropped;
+	constexpr MetricCounter TestGauge = MetricCounter::WatchedProcesses;
+	constexpr MetricHistogram TestHistogram = MetricHistogram::HookInit;
+
+	MetricsSnapshot Read()
+	{
+		MetricsReader reader;
+		MetricsSnapshot snapshot{};
+		CHECK(reader.Open());
+		CHECK(reader.Read(snapshot));
+		return snapshot;
+	}
+
+	int64_t Counter(const MetricsSnapshot& snapshot, MetricCounter counter)
+	{
+		return snapshot.counters[static_cast<size_t>(counter)];
+	}
+
+	const MetricsSnapshot::Histogram& HistogramOf(const MetricsSnapshot& snapshot, MetricHistogram histogram)
+	{
+		return snapshot.histograms[static_cast<size_t>(histogram)];
+	}
+}
+
+TEST(BucketsByBitWidth)
+{
+	CHECK(RuntimeMetrics::BucketOf(0) == 0);
+	CHECK(RuntimeMetrics::BucketOf(1) == 1);
+	CHECK(RuntimeMetrics::BucketOf(2) == 2);
+	CHECK(RuntimeMetrics::BucketOf(3) == 2);
+	CHECK(RuntimeMetrics::BucketOf(1023) == 10);
+	CHECK(RuntimeMetrics::BucketOf(1024) == 11);
+	CHECK(RuntimeMetrics::BucketOf(UINT64_MAX) == MetricBucketCount - 1);
+
+	CHECK(RuntimeMetrics::BucketUpperBound(0) == 1);
+	CHECK(RuntimeMetrics::BucketUpperBound(10) == 1024);
+	CHECK(RuntimeMetrics::BucketUpperBound(MetricBucketCount - 1) == UINT64_MAX);
+
+	// Every value lies below the bound of its bucket and at or above the bound of the one before.
+	for (uint64_t value : { uint64_t{ 0 }, uint64_t{ 1 }, uint64_t{ 5 }, uint64_t{ 4096 }, uint64_t{ 999999 }, uint64_t{ 1 } << 29 })
+	{
+		const size_t bucket = RuntimeMetrics::BucketOf(value);
+		CHECK(value < RuntimeMetrics::BucketUpperBound(bucket));
+		CHECK(bucket == 0 || value >= RuntimeMetrics::BucketUpperBound(bucket - 1));
+	}
+}
+
+TEST(EstimatesQuantilesFromBuckets)
+{
+	MetricsSnapshot::Histogram histogram{};
+	CHECK(RuntimeMetrics::Quantile(histogram, 0.5) == 0);
+
+	// 90 values in [64, 128), 9 in [1024, 2048), 1 in the open-ended last bucket.
+	histogram.buckets[RuntimeMetrics::BucketOf(100)] = 90;
+	histogram.buckets[RuntimeMetrics::BucketOf(1500)] = 9;
+	histogram.buckets[RuntimeMetrics::BucketOf(uint64_t{ 1 } << 40)] = 1;
+	CHECK(RuntimeMetrics::Quantile(histogram, 0.0) == 128);
+	CHECK(RuntimeMetrics::Quantile(histogram, 0.5) == 128);
+	CHECK(RuntimeMetrics::Quantile(histogram, 0.9) == 128);
+	CHECK(RuntimeMetrics::Quantile(histogram, 0.95) == 2048);
+	CHECK(RuntimeMetrics::Quantile(histogram, 0.99) == 2048);
+	CHECK(RuntimeMetrics::Quantile(histogram, 1.0) == UINT64_MAX);
+	CHECK(RuntimeMetrics::Quantile(histogram, 7.0) == UINT64_MAX);
+	CHECK(RuntimeMetrics::Quantile(histogram, -1.0) == 128);
+}
+
+TEST(NamesEveryMetric)
+{
+	std::vector<std::string> names;
+	for (size_t i = 0; i < MetricCounterCount; ++i)
+	{
+		names.emplace_back(RuntimeMetrics::CounterName(static_cast<MetricCounter>(i)));
+	}
+	for (size_t i = 0; i < MetricHistogramCount; ++i)
+	{
+		names.emplace_back(RuntimeMetrics::HistogramName(static_cast<MetricHistogram>(i)));
+	}
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		CHECK(!names[i].empty());
+		for (size_t j = 0; j < i; ++j)
+		{
+			CHECK(names[i] != names[j]);
+		}
+	}
+	CHECK(std::strcmp(RuntimeMetrics::CounterName(MetricCounter::Count), "") == 0);
+	CHECK(std::strcmp(RuntimeMetrics::HistogramName(MetricHistogram::Count), "") == 0);
+}
+
+TEST(PublishesToTheSharedPage)
+{
+	// The first update maps, and if needed creates, the page.
+	RuntimeMetrics::Add(TestCounter, 0);
+	const MetricsSnapshot before = Read();
+	CHECK(before.createdUnixMs != 0);
+
+	RuntimeMetrics::Add(TestCounter);
+	RuntimeMetrics::Add(TestCounter, 4);
+	RuntimeMetrics::Record(TestHistogram, 0);
+	RuntimeMetrics::Record(TestHistogram, 300);
+	RuntimeMetrics::Record(TestHistogram, 300);
+
+	const MetricsSnapshot after = Read();
+	CHECK(after.createdUnixMs == before.createdUnixMs);
+	CHECK(Counter(after, TestCounter) - Counter(before, TestCounter) == 5);
+	const MetricsSnapshot::Histogram& was = HistogramOf(before, TestHistogram);
+	const MetricsSnapshot::Histogram& is = HistogramOf(after, TestHistogram);
+	CHECK(is.count - was.count == 3);
+	CHECK(is.sum - was.sum == 600);
+	CHECK(is.buckets[0] - was.buckets[0] == 1);
+	CHECK(is.buckets[RuntimeMetrics::BucketOf(300)] - was.buckets[RuntimeMetrics::BucketOf(300)] == 2);
+}
+
+TEST(LowersTheGauge)
+{
+	RuntimeMetrics::Add(TestGauge, 0);
+	const int64_t before = Counter(Read(), TestGauge);
+	RuntimeMetrics::Add(TestGauge);
+	RuntimeMetrics::Add(TestGauge);
+	CHECK(Counter(Read(), TestGauge) == before + 2);
+	RuntimeMetrics::Add(TestGauge, -1);
+	RuntimeMetrics::Add(TestGauge, -1);
+	CHECK(Counter(Read(), TestGauge) == before);
+}
+
+TEST(TimesAScope)
+{
+	RuntimeMetrics::Add(TestCounter, 0);
+	const uint64_t before = HistogramOf(Read(), TestHistogram).count;
+	{
+		MetricTimer timer(TestHistogram);
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+	const MetricsSnapshot after = Read();
+	CHECK(HistogramOf(after, TestHistogram).count == before + 1);
+}
+
+TEST(CountsEveryConcurrentUpdate)
+{
+	constexpr int Threads = 4;
+	constexpr int Updates = 100000;
+	RuntimeMetrics::Add(TestCounter, 0);
+	const int64_t before = Counter(Read(), TestCounter);
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < Threads; ++t)
+	{
+		threads.emplace_back([] {
+			for (int i = 0; i < Updates; ++i)
+			{
+				RuntimeMetrics::Add(TestCounter);
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	CHECK(Counter(Read(), TestCounter) - before == Threads * Updates);
+}
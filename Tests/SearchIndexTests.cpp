@@ -0,0 +1,235 @@
+﻿#include "Test.h"
+#include "SearchIndex.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	std::vector<SearchHit> Query(const SearchIndex& index, std::u16string_view query)
+	{
+		std::vector<SearchHit> hits;
+		CHECK(index.Query(query, hits) == hits.size());
+		return hits;
+	}
+
+	std::vector<uint32_t> Ids(const std::vector<SearchHit>& hits)
+	{
+		std::vector<uint32_t> ids;
+		for (const SearchHit& hit : hits)
+		{
+			ids.push_back(hit.id);
+		}
+		return ids;
+	}
+
+	void Add(SearchIndex& index, uint32_t id, SearchField field, std::u16string_view text)
+	{
+		const SearchText piece{ field, text };
+		index.Upsert(id, &piece, 1);
+	}
+
+	std::u16string Folded(std::u16string_view text)
+	{
+		std::u16string folded;
+		SearchIndex::Fold(text, folded);
+		return folded;
+	}
+}
+
+TEST(FoldsCaseOfEveryCoveredScript)
+{
+	CHECK(Folded(u"Hello, World 123") == u"hello, world 123");
+	CHECK(Folded(u"ÀÉÎÕÜÞ ×÷ ß") == u"àéîõüþ ×÷ ß");
+	CHECK(Folded(u"ŁÓDŹ ĞÜŞ İ Ÿ") == u"łódź ğüş i ÿ");
+	CHECK(Folded(u"ΑΘΗΝΑ Ωμέγα") == u"αθηνα ωμέγα");
+	CHECK(Folded(u"ПРИВЕТ ЁЖ Ђ") == u"привет ёж ђ");
+
+	// Longer than one vector block, with ASCII blocks on both sides of accented ones.
+	CHECK(Folded(u"C:\\USERS\\ÉLODIE\\PROJECTS\\ŽIŽKOV\\BUILD") == u"c:\\users\\élodie\\projects\\žižkov\\build");
+	CHECK(Folded(u"").empty());
+}
+
+TEST(MatchesAcrossCaseButKeepsAccents)
+{
+	SearchIndex index;
+	Add(index, 1, SearchField::FolderName, u"École Été");
+	Add(index, 2, SearchField::FolderName, u"ecole");
+	Add(index, 3, SearchField::TabTitle, u"Привет мир");
+
+	CHECK(Ids(Query(index, u"ÉCOLE")) == std::vector<uint32_t>{ 1 });
+	CHECK(Ids(Query(index, u"éTé")) == std::vector<uint32_t>{ 1 });
+	CHECK(Ids(Query(index, u"ECOLE")) == std::vector<uint32_t>{ 2 });   // folding is case only: é is not e
+	CHECK(Ids(Query(index, u"ПРИВЕТ")) == std::vector<uint32_t>{ 3 });
+	CHECK(Ids(Query(index, u"МИР")) == std::vector<uint32_t>{ 3 });
+}
+
+TEST(RanksWholeTextThenPrefixThenWordThenSubstring)
+{
+	SearchIndex index;
+	Add(index, 1, SearchField::FolderName, u"rebuild");
+	Add(index, 2, SearchField::FolderName, u"my build");
+	Add(index, 3, SearchField::FolderName, u"build-tools");
+	Add(index, 4, SearchField::FolderName, u"build");
+	Add(index, 5, SearchField::FolderName, u"unrelated");
+
+	// Long terms are confirmed against the text, short ones come straight from the posting lists.
+	for (std::u16string_view term : { u"build", u"BUI" })
+	{
+		const std::vector<SearchHit> hits = Query(index, term);
+		CHECK(hits.size() == 4);
+		for (size_t i = 1; i < hits.size(); ++i)
+		{
+			CHECK(hits[i - 1].score >= hits[i].score);
+		}
+	}
+	CHECK(Ids(Query(index, u"build")) == (std::vector<uint32_t>{ 4, 3, 2, 1 }));
+
+	// "bui" is the whole text of no folder: prefixes tie and keep id order.
+	const std::vector<SearchHit> shortHits = Query(index, u"bui");
+	CHECK(Ids(shortHits) == (std::vector<uint32_t>{ 3, 4, 2, 1 }));
+	CHECK(shortHits[0].score == shortHits[1].score);
+}
+
+TEST(RanksByFieldAndSumsTerms)
+{
+	SearchIndex index;
+	Add(index, 1, SearchField::Commandline, u"pwsh.exe -NoLogo");
+	Add(index, 2, SearchField::StartingDirectory, u"C:\\pwsh");
+	Add(index, 3, SearchField::TabTitle, u"pwsh");
+	Add(index, 4, SearchField::FolderName, u"pwsh");
+	const SearchText both[] = { { SearchField::FolderName, u"Work" }, { SearchField::ProfileName, u"PowerShell pwsh" } };
+	index.Upsert(5, both, 2);
+
+	CHECK(Ids(Query(index, u"pwsh")) == (std::vector<uint32_t>{ 4, 3, 5, 1, 2 }));
+
+	// Every term must match, in any field; the scores add up.
+	const std::vector<SearchHit> hits = Query(index, u"  work\tPWSH ");
+	CHECK(Ids(hits) == std::vector<uint32_t>{ 5 });
+	CHECK(hits[0].score == Query(index, u"work")[0].score + Query(index, u"pwsh")[2].score);
+	CHECK(Query(index, u"work nologo").empty());
+}
+
+TEST(NeedsTheWholeTermNotJustItsTrigrams)
+{
+	SearchIndex index;
+	Add(index, 1, SearchField::FolderName, u"abcx bcd");
+	const SearchText pieces[] = { { SearchField::FolderName, u"xabc" }, { SearchField::TabTitle, u"bcdx" } };
+	index.Upsert(2, pieces, 2);
+
+	// Both documents have every trigram of "abcd"; in the second they are in separate pieces.
+	CHECK(Query(index, u"abcd").empty());
+	CHECK(Ids(Query(index, u"abc")) == (std::vector<uint32_t>{ 1, 2 }));
+	CHECK(Ids(Query(index, u"bcx bcd")) == std::vector<uint32_t>{ 1 });
+}
+
+TEST(UpsertReplacesTheText)
+{
+	SearchIndex index;
+	Add(index, 7, SearchField::FolderName, u"alpha");
+	Add(index, 8, SearchField::FolderName, u"alpine");
+	CHECK(Ids(Query(index, u"alp")) == (std::vector<uint32_t>{ 7, 8 }));
+
+	Add(index, 7, SearchField::TabTitle, u"beta");
+	CHECK(index.Size() == 2);
+	CHECK(Query(index, u"alpha").empty());
+	CHECK(Ids(Query(index, u"alp")) == std::vector<uint32_t>{ 8 });
+	CHECK(Ids(Query(index, u"beta")) == std::vector<uint32_t>{ 7 });
+
+	// Replacing with no text keeps the document but matches nothing.
+	index.Upsert(7, nullptr, 0);
+	CHECK(index.Size() == 2);
+	CHECK(Query(index, u"beta").empty());
+}
+
+TEST(RemoveAndClearForgetDocuments)
+{
+	SearchIndex index;
+	Add(index, 1, SearchField::FolderName, u"keep me");
+	Add(index, 2, SearchField::FolderName, u"drop me");
+
+	CHECK(index.Remove(2));
+	CHECK(!index.Remove(2));
+	CHECK(!index.Remove(3));
+	CHECK(index.Size() == 1);
+	CHECK(Query(index, u"drop").empty());
+	CHECK(Ids(Query(index, u"me")) == std::vector<uint32_t>{ 1 });
+
+	// A removed id can be indexed again.
+	Add(index, 2, SearchField::FolderName, u"back");
+	CHECK(Ids(Query(index, u"back")) == std::vector<uint32_t>{ 2 });
+
+	index.Clear();
+	CHECK(index.Size() == 0);
+	CHECK(Query(index, u"me").empty());
+	CHECK(Query(index, u"back").empty());
+}
+
+TEST(EmptyQueryMatchesNothing)
+{
+	SearchIndex index;
+	Add(index, 1, SearchField::FolderName, u"anything");
+
+	std::vector<SearchHit> hits{ SearchHit{ 9, 9 } };
+	CHECK(index.Query(u"", hits) == 0);
+	CHECK(hits.empty());
+	CHECK(Query(index, u" \t\r\n").empty());
+	CHECK(Query(SearchIndex(), u"anything").empty());
+}
+
+TEST(AgreesWithABruteForceScan)
+{
+	const std::u16string words[] = { u"Dev", u"build", u"PWSH", u"ubuntu", u"logs", u"Élan", u"bui", u"ildb", u"c:\\src", u"tail -f" };
+	std::mt19937 random(32);
+	SearchIndex index;
+	std::vector<std::vector<std::u16string>> documents(300);
+	for (uint32_t id = 0; id < documents.size(); ++id)
+	{
+		std::vector<SearchText> pieces;
+		for (int piece = 0; piece < 4; ++piece)
+		{
+			std::u16string text;
+			for (uint32_t word = random() % 3; word < 3; ++word)
+			{
+				text += words[random() % std::size(words)];
+				text += random() % 2 ? u" " : u"";
+			}
+			documents[id].push_back(text);
+		}
+		for (size_t piece = 0; piece < documents[id].size(); ++piece)
+		{
+			pieces.push_back(SearchText{ static_cast<SearchField>(piece), documents[id][piece] });
+		}
+		index.Upsert(id, pieces.data(), pieces.size());
+	}
+
+	for (std::u16string_view query : { u"b", u"bu", u"bui", u"build", u"uildb", u"ILDBU", u"élan", u"pwshdev",
+		u"dev logs", u"c:\\src\\", u"-f", u"zzz", u"logsbuild ubuntu" })
+	{
+		std::vector<uint32_t> expected;
+		for (uint32_t id = 0; id < documents.size(); ++id)
+		{
+			bool all = true;
+			std::u16string folded = Folded(query);
+			for (size_t begin = 0; all && begin < folded.size();)
+			{
+				size_t end = folded.find(u' ', begin);
+				end = end == std::u16string::npos ? folded.size() : end;
+				const std::u16string term = folded.substr(begin, end - begin);
+				begin = end + 1;
+				all = term.empty() || std::any_of(documents[id].begin(), documents[id].end(),
+					[&](const std::u16string& text) { return Folded(text).find(term) != std::u16string::npos; });
+			}
+			if (all)
+			{
+				expected.push_back(id);
+			}
+		}
+		std::vector<uint32_t> actual = Ids(Query(index, query));
+		std::sort(actual.begin(), actual.end());
+		CHECK(actual == expected);
+	}
+}
@@ -0,0 +1,167 @@
+﻿#include "Test.h"
+#include "SettingsProfileScanner.h"
+#include <string>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	bool Extract(const std::string& json, std::vector<SettingsProfileFields>& profiles)
+	{
+		return SettingsProfileScanner::Extract(reinterpret_cast<const uint8_t*>(json.data()), json.size(), profiles);
+	}
+
+	std::u16string Decoded(std::string_view raw)
+	{
+		std::u16string out;
+		CHECK(SettingsProfileScanner::Decode(raw, out));
+		return out;
+	}
+
+	// What Windows Terminal writes around the profiles: comments, trailing commas, and schemes,
+	// actions and themes holding every kind of value, including brackets and quotes in strings.
+	const std::string Settings = R"({
+    "$schema": "https://aka.ms/terminal-profiles-schema",
+    // The default profile is PowerShell.
+    "defaultProfile": "{61c54bbd-c2c6-5271-96e7-009a87ff44bf}",
+    "actions": [
+        { "command": { "action": "copy", "singleLine": false }, "keys": "ctrl+c" },
+        { "command": "paste", "keys": "ctrl+v", },
+        { "command": { "action": "sendInput", "input": "}]\"{[ /* not a comment */" } },
+    ],
+    /* Block comment with "quotes", } and ] inside. */
+    "profiles": {
+        "defaults": { "name": "not a profile", "font": { "face": "Cascadia Mono" } },
+        "list": [
+            {
+                "guid": "{61c54bbd-c2c6-5271-96e7-009a87ff44bf}",
+                "name": "Windows PowerShell",
+                "commandline": "%SystemRoot%\\System32\\WindowsPowerShell\\v1.0\\powershell.exe",
+                "hidden": false,
+            },
+            {
+                "guid": "{0caa0dad-35be-5f56-a8ff-afceeeaa6101}",
+                "name": "Command \"Prompt\"",
+                "icon": "C:\\Icons\\cmd.png",
+                "hidden": true
+            },
+            {
+                "name": "Ubuntu \u00e9t\u00e9 \ud83d\ude80",
+                "source": "Windows.Terminal.Wsl",
+                "icon": null,
+                "guid": 42,
+                "colorScheme": { "background": "#000000", "nested": [[1, 2], [3, [4]]] }
+            },
+        ],
+    },
+    "schemes": [ { "name": "Campbell", "black": "#0C0C0C", "values": [0.5, -1e3, true, null] } ],
+    "themes": [],
+}
+)";
+}
+
+TEST(ExtractsProfilesAndSkipsTheRest)
+{
+	std::vector<SettingsProfileFields> profiles;
+	CHECK(Extract(Settings, profiles));
+	CHECK(profiles.size() == 3);
+	if (profiles.size() != 3)
+	{
+		return;
+	}
+
+	CHECK(profiles[0].name == "Windows PowerShell");
+	CHECK(profiles[0].guid == "{61c54bbd-c2c6-5271-96e7-009a87ff44bf}");
+	CHECK(profiles[0].icon.data() == nullptr);
+	CHECK(profiles[0].source.data() == nullptr);
+	CHECK(!profiles[0].hidden);
+
+	// Raw views keep the escapes.
+	CHECK(profiles[1].name == "Command \\\"Prompt\\\"");
+	CHECK(profiles[1].icon == "C:\\\\Icons\\\\cmd.png");
+	CHECK(profiles[1].hidden);
+
+	// Null and non-string values count as missing.
+	CHECK(profiles[2].source == "Windows.Terminal.Wsl");
+	CHECK(profiles[2].icon.data() == nullptr);
+	CHECK(profiles[2].guid.data() == nullptr);
+	CHECK(!profiles[2].hidden);
+
+	// The views point into the input.
+	CHECK(profiles[0].name.data() > Settings.data() && profiles[0].name.data() < Settings.data() + Settings.size());
+}
+
+TEST(DecodesEscapesAndUtf8)
+{
+	std::vector<SettingsProfileFields> profiles;
+	CHECK(Extract(Settings, profiles));
+	CHECK(profiles.size() == 3);
+	if (profiles.size() != 3)
+	{
+		return;
+	}
+	CHECK(Decoded(profiles[1].name) == u"Command \"Prompt\"");
+	CHECK(Decoded(profiles[1].icon) == u"C:\\Icons\\cmd.png");
+	CHECK(Decoded(profiles[2].name) == u"Ubuntu \u00e9t\u00e9 \U0001F680");
+
+	CHECK(Decoded("caf\xc3\xa9 \xf0\x9f\x9a\x80") == u"caf\u00e9 \U0001F680");
+	CHECK(Decoded("tab\\tnew\\nline\\/") == u"tab\tnew\nline/");
+	CHECK(Decoded("bad \xff byte") == u"bad \uFFFD byte");
+
+	std::u16string out;
+	CHECK(!SettingsProfileScanner::Decode("\\x41", out));
+	CHECK(!SettingsProfileScanner::Decode("\\u12", out));
+	CHECK(!SettingsProfileScanner::Decode("trailing \\", out));
+}
+
+TEST(AcceptsLegacyProfileArrayAndBom)
+{
+	const std::string legacy = "\xEF\xBB\xBF{ \"profiles\": [ { \"name\": \"cmd\" }, 3, { \"name\": \"pwsh\", \"hidden\": true } ] }";
+	std::vector<SettingsProfileFields> profiles;
+	CHECK(Extract(legacy, profiles));
+	CHECK(profiles.size() == 2);
+	if (profiles.size() == 2)
+	{
+		CHECK(profiles[0].name == "cmd");
+		CHECK(profiles[1].name == "pwsh");
+		CHECK(profiles[1].hidden);
+	}
+}
+
+TEST(HandlesMissingAndRepeatedLists)
+{
+	std::vector<SettingsProfileFields> profiles;
+	CHECK(Extract("{ \"schemes\": [] }", profiles));
+	CHECK(profiles.empty());
+
+	CHECK(Extract("{ \"profiles\": { \"list\": [ { \"name\": \"a\" } ] }, \"profiles\": { \"list\": [] } }", profiles));
+	CHECK(profiles.empty());
+}
+
+TEST(RejectsMalformedDocuments)
+{
+	std::vector<SettingsProfileFields> profiles;
+	CHECK(!Extract("", profiles));
+	CHECK(!Extract("[]", profiles));
+	CHECK(!Extract("{ \"profiles\": { \"list\": [ { \"name\": \"unterminated } ] } }", profiles));
+	CHECK(!Extract("{ \"actions\": [ { \"keys\": \"ctrl+c\" } }", profiles));
+	CHECK(!Extract("{ \"themes\": [] /* unterminated comment }", profiles));
+	CHECK(!Extract("{ \"themes\": [] } trailing", profiles));
+	CHECK(!Extract("{ \"themes\": [] / }", profiles));
+}
+
+TEST(SkipsLongSubtreesAcrossBlockBoundaries)
+{
+	// Structural bytes at every offset within the 16-byte blocks the skip search reads.
+	std::string json = "{ \"actions\": [";
+	for (int i = 0; i < 200; ++i)
+	{
+		json += "{\"k\":\"" + std::string(static_cast<size_t>(i % 37), 'x') + "\\\"]}\"},";
+	}
+	json += "], \"profiles\": { \"list\": [ { \"name\": \"last\" } ] } }";
+
+	std::vector<SettingsProfileFields> profiles;
+	CHECK(Extract(json, profiles));
+	CHECK(profiles.size() == 1 && profiles[0].name == "last");
+}
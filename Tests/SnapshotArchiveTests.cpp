@@ -0,0 +1,222 @@
+﻿#include "Test.h"
+#include "SnapshotArchive.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	const std::u16string_view LayoutFiles[] = { u"settings.json", u"state.json", u"elevated-state.json" };
+
+	std::string RoundTrip(const std::string& raw)
+	{
+		std::string compressed;
+		SnapshotArchive::Compress(raw.data(), raw.size(), compressed);
+		std::string decompressed;
+		CHECK(SnapshotArchive::Decompress(compressed.data(), compressed.size(), raw.size(), decompressed));
+		return decompressed;
+	}
+
+	std::string Noise(size_t size, uint32_t seed)
+	{
+		std::string noise(size, '\0');
+		for (char& c : noise)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			c = static_cast<char>(seed >> 24);
+		}
+		return noise;
+	}
+
+	// Three snapshots sharing one settings.json; the last has no state.json.
+	struct Snapshots
+	{
+		Tests::TempFolder folder;
+		const std::string settings = "{ \"profiles\": { \"list\": [ { \"name\": \"cmd\" } ] } }";
+
+		Snapshots()
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				const fs::path snapshot = folder / ("LocalState_" + std::to_string(i));
+				Tests::WriteFile(snapshot / "settings.json", settings);
+				if (i < 2)
+				{
+					Tests::WriteFile(snapshot / "state.json", State(i));
+				}
+			}
+			Tests::WriteFile(folder / "LocalState_1" / "elevated-state.json", State(9));
+		}
+
+		static std::string State(int i)
+		{
+			return "{ \"persistedWindowLayouts\": [ { \"tabLayout\": [ { \"action\": \"newTab\", \"tabTitle\": \"tab "
+				+ std::to_string(i) + "\" } ] } ] }";
+		}
+
+		bool Write(const fs::path& archive, std::u16string_view firstName = u"LocalState_0")
+		{
+			SnapshotArchiveWriter writer;
+			std::error_code ec;
+			bool ok = writer.Create(archive, ec);
+			ok = ok && writer.AddFolder(firstName, folder / "LocalState_0", LayoutFiles, 3, ec);
+			ok = ok && writer.AddFolder(u"LocalState_1", folder / "LocalState_1", LayoutFiles, 3, ec);
+			ok = ok && writer.AddFolder(u"LocalState_2", folder / "LocalState_2", LayoutFiles, 3, ec);
+			return ok && writer.Commit(ec);
+		}
+	};
+}
+
+TEST(CodecRoundTrips)
+{
+	CHECK(RoundTrip("").empty());
+	CHECK(RoundTrip("a") == "a");
+	CHECK(RoundTrip("abcabcabcabcabcabcabcabcabcabc") == "abcabcabcabcabcabcabcabcabcabc");
+
+	const std::string noise = Noise(100000, 1);
+	CHECK(RoundTrip(noise) == noise);
+
+	// Matches longer than a token's length field and older than the window.
+	std::string repetitive;
+	const std::string chunk = Noise(70000, 2);
+	repetitive = chunk + std::string(5000, 'x') + chunk.substr(60000) + chunk;
+	CHECK(RoundTrip(repetitive) == repetitive);
+
+	std::string compressed;
+	const std::string json(20000, ' ');
+	SnapshotArchive::Compress(json.data(), json.size(), compressed);
+	CHECK(compressed.size() < 200);
+}
+
+TEST(CodecRejectsMalformedBlocks)
+{
+	const std::string raw = Noise(1000, 3) + std::string(1000, 'y');
+	std::string compressed;
+	SnapshotArchive::Compress(raw.data(), raw.size(), compressed);
+
+	std::string out;
+	CHECK(!SnapshotArchive::Decompress(compressed.data(), compressed.size(), raw.size() + 1, out));
+	CHECK(!SnapshotArchive::Decompress(compressed.data(), compressed.size(), raw.size() - 1, out));
+	CHECK(!SnapshotArchive::Decompress(compressed.data(), compressed.size() / 2, raw.size(), out));
+}
+
+TEST(ArchivesAndReadsFolders)
+{
+	Snapshots snapshots;
+	const fs::path archive = snapshots.folder / "export.wtla";
+	CHECK(snapshots.Write(archive, u"LocalState_0 été"));
+
+	SnapshotArchiveReader reader;
+	std::error_code ec;
+	CHECK(reader.Open(archive, ec));
+	CHECK(reader.FolderCount() == 3);
+	CHECK(reader.Folder(0).name == u"LocalState_0 été");
+	CHECK(reader.Folder(0).fileCount == 2);
+	CHECK(reader.Folder(1).fileCount == 3);
+	CHECK(reader.Folder(2).fileCount == 1);
+	CHECK(reader.File(1, 2).name == u"elevated-state.json");
+	CHECK(reader.File(1, 1).length == Snapshots::State(1).size());
+
+	// The shared settings.json has one hash.
+	CHECK(reader.File(0, 0).contentHash == reader.File(2, 0).contentHash);
+
+	std::string content;
+	CHECK(reader.ReadFile(2, 0, content, ec));
+	CHECK(content == snapshots.settings);
+	CHECK(reader.ReadFile(0, 1, content, ec));
+	CHECK(content == Snapshots::State(0));
+	CHECK(reader.ReadFile(1, 2, content, ec));
+	CHECK(content == Snapshots::State(9));
+	CHECK(!reader.ReadFile(2, 1, content, ec));
+}
+
+TEST(ExtractsAFolder)
+{
+	Snapshots snapshots;
+	const fs::path archive = snapshots.folder / "export.wtla";
+	CHECK(snapshots.Write(archive));
+
+	SnapshotArchiveReader reader;
+	std::error_code ec;
+	CHECK(reader.Open(archive, ec));
+	const fs::path target = snapshots.folder / "imported";
+	CHECK(reader.Extract(1, target, ec));
+	CHECK(Tests::ReadFile(target / "settings.json") == snapshots.settings);
+	CHECK(Tests::ReadFile(target / "state.json") == Snapshots::State(1));
+	CHECK(Tests::ReadFile(target / "elevated-state.json") == Snapshots::State(9));
+}
+
+TEST(StoresSharedFilesOnce)
+{
+	Snapshots snapshots;
+	const fs::path shared = snapshots.folder / "shared.wtla";
+	CHECK(snapshots.Write(shared));
+
+	// The same folders with a settings.json of the same size that differs in every snapshot.
+	for (int i = 0; i < 3; ++i)
+	{
+		Tests::WriteFile(snapshots.folder / ("LocalState_" + std::to_string(i)) / "settings.json", Noise(snapshots.settings.size(), 10 + i));
+	}
+	const fs::path distinct = snapshots.folder / "distinct.wtla";
+	CHECK(snapshots.Write(distinct));
+	CHECK(fs::file_size(shared) + 2 * snapshots.settings.size() / 2 < fs::file_size(distinct));
+}
+
+TEST(CommitsOnlyOnCommit)
+{
+	Snapshots snapshots;
+	const fs::path archive = snapshots.folder / "export.wtla";
+	Tests::WriteFile(archive, "previous");
+	{
+		SnapshotArchiveWriter writer;
+		std::error_code ec;
+		CHECK(writer.Create(archive, ec));
+		CHECK(writer.AddFolder(u"LocalState_0", snapshots.folder / "LocalState_0", LayoutFiles, 3, ec));
+	}
+	CHECK(Tests::ReadFile(archive) == "previous");
+	CHECK(snapshots.Write(archive));
+	CHECK(Tests::ReadFile(archive) != "previous");
+}
+
+TEST(RejectsNamesOutsideTheFolder)
+{
+	Snapshots snapshots;
+	SnapshotArchiveWriter writer;
+	std::error_code ec;
+	CHECK(writer.Create(snapshots.folder / "export.wtla", ec));
+	CHECK(!writer.AddFolder(u"..", snapshots.folder / "LocalState_0", LayoutFiles, 3, ec));
+	CHECK(!writer.AddFolder(u"a/b", snapshots.folder / "LocalState_0", LayoutFiles, 3, ec));
+	const std::u16string_view escaping[] = { u"..\\settings.json" };
+	CHECK(!writer.AddFolder(u"LocalState_0", snapshots.folder / "LocalState_0", escaping, 1, ec));
+}
+
+TEST(DetectsCorruption)
+{
+	Snapshots snapshots;
+	const fs::path archive = snapshots.folder / "export.wtla";
+	CHECK(snapshots.Write(archive));
+	const std::string image = Tests::ReadFile(archive);
+
+	SnapshotArchiveReader reader;
+	std::error_code ec;
+
+	// A damaged block fails only the reads that need it.
+	std::string damaged = image;
+	damaged[40] = static_cast<char>(damaged[40] ^ 0x20);
+	Tests::WriteFile(archive, damaged);
+	CHECK(reader.Open(archive, ec));
+	std::string content;
+	CHECK(!reader.ReadFile(0, 0, content, ec));
+
+	// A damaged index or a truncated file is rejected on open.
+	damaged = image;
+	damaged[image.size() - 40] = static_cast<char>(damaged[image.size() - 40] ^ 0x01);
+	Tests::WriteFile(archive, damaged);
+	CHECK(!reader.Open(archive, ec));
+
+	Tests::WriteFile(archive, image.substr(0, image.size() - 1));
+	CHECK(!reader.Open(archive, ec));
+}
@@ -0,0 +1,235 @@
+﻿#include "Test.h"
+#include "SnapshotHistory.h"
+#include <string>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr uint32_t State = 1;
+	constexpr uint32_t Settings = 0;
+
+	// A state.json whose window has the given tab titles, one newTab action each.
+	std::string MakeState(const std::vector<std::string>& titles, int focusedTab = 0)
+	{
+		std::string json = "{\n    \"persistedWindowLayouts\": [\n        {\n            \"tabLayout\": [\n";
+		for (size_t i = 0; i < titles.size(); ++i)
+		{
+			json += "                { \"action\": \"newTab\", \"profile\": \"Command Prompt\", \"tabTitle\": \"" + titles[i]
+				+ "\", \"startingDirectory\": \"C:\\\\Work\\\\" + std::to_string(i) + "\" },\n";
+		}
+		json += "                { \"action\": \"switchToTab\", \"index\": " + std::to_string(focusedTab) + " }\n";
+		json += "            ],\n            \"initialSize\": { \"height\": 600.0, \"width\": 1024.0 }\n        }\n    ]\n}\n";
+		return json;
+	}
+
+	// The JSON without the whitespace between tokens; delta versions restore re-indented.
+	std::string Compact(const std::string& json)
+	{
+		std::string compact;
+		bool inString = false;
+		for (size_t i = 0; i < json.size(); ++i)
+		{
+			const char c = json[i];
+			if (inString)
+			{
+				compact += c;
+				if (c == '\\' && i + 1 < json.size())
+				{
+					compact += json[++i];
+				}
+				else if (c == '"')
+				{
+					inString = false;
+				}
+			}
+			else if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+			{
+				inString = c == '"';
+				compact += c;
+			}
+		}
+		return compact;
+	}
+
+	bool Append(SnapshotHistory& history, uint32_t source, const std::string& content)
+	{
+		bool appended = false;
+		std::error_code ec;
+		CHECK(history.Append(source, content, appended, ec));
+		CHECK(!ec);
+		return appended;
+	}
+
+	std::string Restore(const SnapshotHistory& history, size_t index)
+	{
+		std::string content;
+		std::error_code ec;
+		CHECK(history.Restore(index, content, ec));
+		return content;
+	}
+
+	// Ten versions of a growing window: a tab is added or renamed at each step.
+	std::vector<std::string> MakeVersions()
+	{
+		std::vector<std::string> versions;
+		std::vector<std::string> titles = { "build" };
+		for (int i = 0; i < 10; ++i)
+		{
+			if (i % 3 == 2)
+			{
+				titles[titles.size() / 2] += " (renamed)";
+			}
+			else
+			{
+				titles.insert(titles.begin() + static_cast<ptrdiff_t>(titles.size() / 2), "tab \\u00e9 " + std::to_string(i));
+			}
+			versions.push_back(MakeState(titles, i % static_cast<int>(titles.size())));
+		}
+		return versions;
+	}
+}
+
+TEST(RestoresEveryVersion)
+{
+	Tests::TempFolder folder;
+	SnapshotHistory history;
+	std::error_code ec;
+	CHECK(history.Open(SnapshotHistory::PathFor(folder.path()), 4, ec));
+
+	const std::vector<std::string> versions = MakeVersions();
+	for (const std::string& version : versions)
+	{
+		CHECK(Append(history, State, version));
+	}
+	CHECK(history.Count() == versions.size());
+
+	for (size_t i = 0; i < versions.size(); ++i)
+	{
+		HistoryRecord record;
+		CHECK(history.GetRecord(i, record));
+		CHECK(record.source == State);
+		CHECK(record.checkpoint == (i % 4 == 0));
+		const std::string restored = Restore(history, i);
+		if (record.checkpoint)
+		{
+			CHECK(restored == versions[i]);
+		}
+		else
+		{
+			CHECK(Compact(restored) == Compact(versions[i]));
+			CHECK(record.storedSize < versions[i].size());
+		}
+	}
+}
+
+TEST(SkipsUnchangedContent)
+{
+	Tests::TempFolder folder;
+	SnapshotHistory history;
+	std::error_code ec;
+	CHECK(history.Open(SnapshotHistory::PathFor(folder.path()), 4, ec));
+	const std::string state = MakeState({ "a", "b" });
+	CHECK(Append(history, State, state));
+	CHECK(!Append(history, State, state));
+	CHECK(history.Count() == 1);
+}
+
+TEST(KeepsOneChainPerSource)
+{
+	Tests::TempFolder folder;
+	SnapshotHistory history;
+	std::error_code ec;
+	CHECK(history.Open(SnapshotHistory::PathFor(folder.path()), 16, ec));
+
+	// settings.json with comments is not strict JSON, so each of its versions is stored in full.
+	const std::string settings1 = "{\n    // comment\n    \"profiles\": { \"list\": [] },\n}\n";
+	const std::string settings2 = "{\n    // comment\n    \"profiles\": { \"list\": [ { \"name\": \"cmd\" } ] },\n}\n";
+	CHECK(Append(history, State, MakeState({ "a" })));
+	CHECK(Append(history, Settings, settings1));
+	CHECK(Append(history, State, MakeState({ "a", "b" })));
+	CHECK(Append(history, Settings, settings2));
+
+	CHECK(history.Latest(State) == 2);
+	CHECK(history.Latest(Settings) == 3);
+	CHECK(history.Latest(7) == -1);
+	CHECK(history.Previous(2) == 0);
+	CHECK(history.Previous(3) == 1);
+	CHECK(history.Previous(0) == -1);
+
+	HistoryRecord record;
+	CHECK(history.GetRecord(3, record));
+	CHECK(record.checkpoint);
+	CHECK(Restore(history, 3) == settings2);
+	CHECK(history.GetRecord(2, record));
+	CHECK(!record.checkpoint);
+	CHECK(!history.GetRecord(4, record));
+}
+
+TEST(ReopensAndDropsATornRecord)
+{
+	Tests::TempFolder folder;
+	const fs::path path = SnapshotHistory::PathFor(folder.path());
+	const std::vector<std::string> versions = MakeVersions();
+	{
+		SnapshotHistory history;
+		std::error_code ec;
+		CHECK(history.Open(path, 4, ec));
+		for (size_t i = 0; i < 6; ++i)
+		{
+			Append(history, State, versions[i]);
+		}
+	}
+
+	// A crash in the middle of the last append.
+	std::string image = Tests::ReadFile(path);
+	Tests::WriteFile(path, image.substr(0, image.size() - 5));
+
+	SnapshotHistory history;
+	std::error_code ec;
+	CHECK(history.Open(path, 4, ec));
+	CHECK(history.Count() == 5);
+	CHECK(Compact(Restore(history, 4)) == Compact(versions[4]));
+
+	// The next append overwrites the torn record.
+	CHECK(Append(history, State, versions[6]));
+	CHECK(history.Count() == 6);
+	CHECK(Compact(Restore(history, 5)) == Compact(versions[6]));
+
+	SnapshotHistory reopened;
+	CHECK(reopened.Open(path, 4, ec));
+	CHECK(reopened.Count() == 6);
+	CHECK(Compact(Restore(reopened, 5)) == Compact(versions[6]));
+}
+
+TEST(RestoresToAFile)
+{
+	Tests::TempFolder folder;
+	SnapshotHistory history;
+	std::error_code ec;
+	CHECK(history.Open(SnapshotHistory::PathFor(folder.path()), 4, ec));
+	const std::string state = MakeState({ "a" });
+	Append(history, State, state);
+	Append(history, State, MakeState({ "a", "b" }));
+
+	const fs::path target = folder / "state.json";
+	Tests::WriteFile(target, "overwritten");
+	CHECK(history.RestoreFile(0, target, ec));
+	CHECK(Tests::ReadFile(target) == state);
+}
+
+TEST(RejectsOtherFiles)
+{
+	Tests::TempFolder folder;
+	const fs::path path = SnapshotHistory::PathFor(folder.path());
+	Tests::WriteFile(path, "not a history file, but long enough to hold a header");
+	SnapshotHistory history;
+	std::error_code ec;
+	CHECK(!history.Open(path, 4, ec));
+
+	SnapshotHistory missing;
+	CHECK(missing.Open(folder / "missing" / "WTLayoutManager.history", 4, ec));
+	CHECK(missing.Count() == 0);
+}
@@ -0,0 +1,268 @@
+﻿#include "Test.h"
+#include "InstanceRegistry.h"
+#include "SnapshotRetention.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	RetentionEntry Entry(const fs::path& name, int64_t lastRun, uint64_t bytes, bool pinned = false, bool running = false)
+	{
+		RetentionEntry entry{};
+		entry.folder = name;
+		entry.lastRunUnixMs = lastRun;
+		entry.hasLastRun = true;
+		entry.bytes = bytes;
+		entry.files = 2;
+		entry.pinned = pinned;
+		entry.running = running;
+		entry.action = RetentionAction::Evict;    // ignored by Evaluate
+		return entry;
+	}
+
+	RetentionAction ActionOf(const RetentionReport& report, const char* name)
+	{
+		for (const RetentionEntry& entry : report.entries)
+		{
+			if (entry.folder == name)
+			{
+				return entry.action;
+			}
+		}
+		CHECK(!"no such entry");
+		return RetentionAction::Keep;
+	}
+
+	// Makes a copy whose state.json was last written the given number of minutes ago.
+	fs::path Copy(const Tests::TempFolder& base, const char* name, int minutesAgo, size_t bytes = 100)
+	{
+		const fs::path copy = base / name;
+		Tests::WriteFile(copy / "settings.json", std::string(bytes, 's'));
+		Tests::WriteFile(copy / "state.json", "{}");
+		fs::last_write_time(copy / "state.json", fs::file_time_type::clock::now() - std::chrono::minutes(minutesAgo));
+		return copy;
+	}
+
+	std::wstring RegistryKey(const fs::path& folder)
+	{
+#if defined(_WIN32)
+		return folder.wstring();
+#else
+		const std::u32string text = folder.u32string();
+		return std::wstring(text.begin(), text.end());
+#endif
+	}
+
+	uint32_t CurrentProcessId()
+	{
+#if defined(_WIN32)
+		return ::GetCurrentProcessId();
+#else
+		return static_cast<uint32_t>(::getpid());
+#endif
+	}
+}
+
+TEST(KeepsTheMostRecentlyRunCopies)
+{
+	const RetentionReport report = SnapshotRetention::Evaluate({
+		Entry("b", 200, 10), Entry("d", 400, 10), Entry("a", 100, 10), Entry("c", 300, 10) }, { 2, 0 });
+	CHECK(report.entries.size() == 4);
+	CHECK(report.entries[0].folder == "d");
+	CHECK(report.entries[3].folder == "a");
+	CHECK(ActionOf(report, "d") == RetentionAction::Keep);
+	CHECK(ActionOf(report, "c") == RetentionAction::Keep);
+	CHECK(ActionOf(report, "b") == RetentionAction::Evict);
+	CHECK(ActionOf(report, "a") == RetentionAction::Evict);
+	CHECK(report.keptCount == 2);
+	CHECK(report.keptBytes == 20);
+	CHECK(report.evictedCount == 2);
+	CHECK(report.evictedBytes == 20);
+
+	// Copies run at the same time are ordered by path, so the plan does not change between runs.
+	const RetentionReport tied = SnapshotRetention::Evaluate({ Entry("y", 100, 10), Entry("x", 100, 10) }, { 1, 0 });
+	CHECK(ActionOf(tied, "x") == RetentionAction::Keep);
+	CHECK(ActionOf(tied, "y") == RetentionAction::Evict);
+}
+
+TEST(KeepsEverythingWithoutLimits)
+{
+	const RetentionReport report = SnapshotRetention::Evaluate({ Entry("a", 100, 1u << 30), Entry("b", 200, 1u << 30) }, {});
+	CHECK(report.evictedCount == 0);
+	CHECK(report.keptBytes == 2ull << 30);
+}
+
+TEST(ProtectedCopiesUseTheBudget)
+{
+	// The pinned and the running copy are the oldest but fill the budget first.
+	const RetentionReport report = SnapshotRetention::Evaluate({
+		Entry("pinned", 100, 10, true), Entry("running", 200, 10, false, true), Entry("recent", 300, 10), Entry("newest", 400, 10) },
+		{ 3, 0 });
+	CHECK(ActionOf(report, "pinned") == RetentionAction::KeepPinned);
+	CHECK(ActionOf(report, "running") == RetentionAction::KeepRunning);
+	CHECK(ActionOf(report, "newest") == RetentionAction::Keep);
+	CHECK(ActionOf(report, "recent") == RetentionAction::Evict);
+
+	// Protected copies are kept even over the budget.
+	const RetentionReport over = SnapshotRetention::Evaluate({ Entry("a", 100, 50, true), Entry("b", 200, 50, true) }, { 1, 60 });
+	CHECK(over.evictedCount == 0);
+	CHECK(over.keptBytes == 100);
+}
+
+TEST(EvictsEveryOlderCopyOnceFull)
+{
+	// A large recent copy that does not fit is evicted, and the smaller older ones with it.
+	const RetentionReport report = SnapshotRetention::Evaluate({
+		Entry("newest", 400, 10), Entry("large", 300, 100), Entry("small", 200, 1), Entry("oldest", 100, 1) }, { 0, 50 });
+	CHECK(ActionOf(report, "newest") == RetentionAction::Keep);
+	CHECK(ActionOf(report, "large") == RetentionAction::Evict);
+	CHECK(ActionOf(report, "small") == RetentionAction::Evict);
+	CHECK(ActionOf(report, "oldest") == RetentionAction::Evict);
+	CHECK(report.keptBytes == 10);
+}
+
+TEST(HoldsItsInvariantsOnRandomCopies)
+{
+	std::mt19937_64 random(49);
+	for (int round = 0; round < 50; ++round)
+	{
+		std::vector<RetentionEntry> entries;
+		for (int i = 0; i < 200; ++i)
+		{
+			entries.push_back(Entry("c" + std::to_string(i), static_cast<int64_t>(random() % 1000), random() % 1000,
+				random() % 20 == 0, random() % 50 == 0));
+		}
+		const RetentionPolicy policy{ static_cast<uint32_t>(random() % 100), random() % 2 == 0 ? 0 : random() % 50000 };
+		const RetentionReport report = SnapshotRetention::Evaluate(entries, policy);
+
+		uint64_t protectedCount = 0;
+		uint64_t protectedBytes = 0;
+		int64_t oldestKept = INT64_MAX;
+		int64_t newestEvicted = INT64_MIN;
+		for (const RetentionEntry& entry : report.entries)
+		{
+			if (entry.pinned || entry.running)
+			{
+				CHECK(entry.action != RetentionAction::Evict);
+				++protectedCount;
+				protectedBytes += entry.bytes;
+			}
+			else if (entry.action == RetentionAction::Evict)
+			{
+				newestEvicted = std::max(newestEvicted, entry.lastRunUnixMs);
+			}
+			else
+			{
+				oldestKept = std::min(oldestKept, entry.lastRunUnixMs);
+			}
+		}
+		CHECK(newestEvicted <= oldestKept);
+		if (policy.maxCount != 0)
+		{
+			CHECK(report.keptCount <= std::max<uint64_t>(policy.maxCount, protectedCount));
+		}
+		if (policy.maxBytes != 0)
+		{
+			CHECK(report.keptBytes <= std::max(policy.maxBytes, protectedBytes));
+		}
+		CHECK(report.keptCount + report.evictedCount == entries.size());
+	}
+}
+
+TEST(RoundTripsThePolicyFile)
+{
+	Tests::TempFolder base;
+	CHECK(!SnapshotRetention::LoadPolicy(base.path()).IsLimited());
+
+	std::error_code ec;
+	CHECK(SnapshotRetention::SavePolicy(base / "copies", { 12, 1ull << 33 }, ec));
+	CHECK(!ec);
+	const RetentionPolicy loaded = SnapshotRetention::LoadPolicy(base / "copies");
+	CHECK(loaded.maxCount == 12);
+	CHECK(loaded.maxBytes == 1ull << 33);
+	CHECK(!fs::exists(base / "copies" / "WTLayoutManager.retention.tmp"));
+
+	// Unknown, negative and malformed lines are skipped.
+	Tests::WriteFile(base / "copies" / SnapshotRetention::PolicyFileName, "colour=blue\nmaxCount=-3\nmaxBytes=lots\nmaxBytes=500\n");
+	const RetentionPolicy partial = SnapshotRetention::LoadPolicy(base / "copies");
+	CHECK(partial.maxCount == 0);
+	CHECK(partial.maxBytes == 500);
+}
+
+TEST(PinsCopies)
+{
+	Tests::TempFolder base;
+	const fs::path copy = Copy(base, "a", 5);
+	std::error_code ec;
+	CHECK(!SnapshotRetention::IsPinned(copy));
+	CHECK(SnapshotRetention::SetPinned(copy, true, ec));
+	CHECK(SnapshotRetention::SetPinned(copy, true, ec));
+	CHECK(SnapshotRetention::IsPinned(copy));
+	CHECK(SnapshotRetention::SetPinned(copy, false, ec));
+	CHECK(SnapshotRetention::SetPinned(copy, false, ec));
+	CHECK(!SnapshotRetention::IsPinned(copy));
+
+	CHECK(!SnapshotRetention::SetPinned(base / "missing", true, ec));
+	CHECK(ec);
+	CHECK(!fs::exists(base / "missing"));
+}
+
+TEST(MeasuresCopies)
+{
+	Tests::TempFolder base;
+	const fs::path copy = Copy(base, "a", 60, 1000);
+	Tests::WriteFile(copy / "nested" / "extra.bin", std::string(24, 'x'));
+	std::error_code ec;
+	SnapshotRetention::SetPinned(copy, true, ec);
+
+	const RetentionEntry entry = SnapshotRetention::Measure(copy);
+	CHECK(entry.hasLastRun);
+	CHECK(entry.files == 4);
+	CHECK(entry.bytes == 1000 + 2 + 24);
+	CHECK(entry.pinned);
+	CHECK(!entry.running);
+	const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	CHECK(entry.lastRunUnixMs < now - 59 * 60 * 1000);
+	CHECK(entry.lastRunUnixMs > now - 61 * 60 * 1000);
+
+	// A copy that never ran counts from the folder's own time.
+	const fs::path fresh = base / "fresh";
+	Tests::WriteFile(fresh / "settings.json", "{}");
+	const RetentionEntry never = SnapshotRetention::Measure(fresh);
+	CHECK(!never.hasLastRun);
+	CHECK(never.lastRunUnixMs > now - 60 * 1000);
+
+	RegisteredInstance running(RegistryKey(fresh), CurrentProcessId(), true);
+	CHECK(SnapshotRetention::Measure(fresh).running);
+}
+
+TEST(PlansAndListsTheEvictedCopies)
+{
+	Tests::TempFolder base;
+	Copy(base, "oldest", 40);
+	Copy(base, "older", 30);
+	Copy(base, "recent", 20);
+	Copy(base, "newest", 10);
+	Tests::WriteFile(base / SnapshotRetention::PolicyFileName, "maxCount=2\n");
+
+	const RetentionReport report = SnapshotRetention::Plan(base.path(), SnapshotRetention::LoadPolicy(base.path()));
+	CHECK(report.entries.size() == 4);
+	CHECK(report.keptCount == 2);
+	const std::vector<fs::path> evicted = SnapshotRetention::Evicted(report);
+	CHECK(evicted.size() == 2);
+	CHECK(evicted.size() == 2 && evicted[0] == base / "oldest" && evicted[1] == base / "older");
+
+	// Planning deletes nothing.
+	CHECK(fs::exists(base / "oldest" / "state.json"));
+}
@@ -0,0 +1,175 @@
+﻿#include "Test.h"
+#include "ContentHash.h"
+#include "SnapshotStore.h"
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	const std::string Settings = "{\"profiles\":{\"list\":[{\"name\":\"cmd\"}]}}";
+
+	// A store without clones, so that every placement goes through the objects whatever the file
+	// system of the temp folder, and a source file to place.
+	struct StoreFolder
+	{
+		Tests::TempFolder folder;
+		SnapshotStore store{ folder / "objects", false };
+		fs::path source = folder / "live" / "settings.json";
+
+		StoreFolder()
+		{
+			Tests::WriteFile(source, Settings);
+		}
+
+		fs::path Object() const
+		{
+			uint64_t hash = 0;
+			CHECK(ContentHash::HashFile(source, hash));
+			return store.ObjectPath(hash, Settings.size());
+		}
+
+		SnapshotPlacement Place(const fs::path& target)
+		{
+			std::error_code ec;
+			const SnapshotPlacement placement = store.Place(source, target, ec);
+			CHECK(!ec);
+			return placement;
+		}
+	};
+
+	size_t CountFiles(const fs::path& folder)
+	{
+		size_t count = 0;
+		for (const fs::directory_entry& entry : fs::recursive_directory_iterator(folder))
+		{
+			count += entry.is_regular_file() ? 1 : 0;
+		}
+		return count;
+	}
+
+	bool OwnerWritable(const fs::path& path)
+	{
+		return (fs::status(path).permissions() & fs::perms::owner_write) != fs::perms::none;
+	}
+}
+
+TEST(DeduplicatesAcrossSnapshots)
+{
+	StoreFolder s;
+	const fs::path first = s.folder / "snapshots" / "a" / "settings.json";
+	const fs::path second = s.folder / "snapshots" / "b" / "settings.json";
+	fs::create_directories(first.parent_path());
+	fs::create_directories(second.parent_path());
+
+	CHECK(s.Place(first) == SnapshotPlacement::Linked);
+	CHECK(s.Place(second) == SnapshotPlacement::Linked);
+	CHECK(Tests::ReadFile(first) == Settings);
+	CHECK(Tests::ReadFile(second) == Settings);
+
+	// One object, linked from the store and from both snapshots.
+	CHECK(CountFiles(s.folder / "objects") == 1);
+	CHECK(fs::hard_link_count(s.Object()) == 3);
+	CHECK(!OwnerWritable(s.Object()));
+
+	// Placing again over a shared file replaces the link instead of writing through it.
+	CHECK(s.Place(first) == SnapshotPlacement::Linked);
+	CHECK(fs::hard_link_count(s.Object()) == 3);
+}
+
+TEST(CollectsObjectsByLinkCount)
+{
+	StoreFolder s;
+	const fs::path first = s.folder / "snapshots" / "a";
+	const fs::path second = s.folder / "snapshots" / "b";
+	fs::create_directories(first);
+	fs::create_directories(second);
+	s.Place(first / "settings.json");
+	s.Place(second / "settings.json");
+
+	SnapshotGarbage garbage = s.store.CollectGarbage();
+	CHECK(garbage.objects == 0);
+
+	std::error_code ec;
+	CHECK(s.store.RemoveTree(first, ec));
+	CHECK(!fs::exists(first));
+	CHECK(fs::hard_link_count(s.Object()) == 2);
+	garbage = s.store.CollectGarbage();
+	CHECK(garbage.objects == 0);
+	CHECK(fs::exists(s.Object()));
+
+	CHECK(s.store.RemoveTree(second, ec));
+	garbage = s.store.CollectGarbage();
+	CHECK(garbage.objects == 1);
+	CHECK(garbage.bytes == Settings.size());
+	CHECK(!fs::exists(s.Object()));
+}
+
+TEST(DetachesBeforeLaunch)
+{
+	StoreFolder s;
+	const fs::path snapshot = s.folder / "snapshots" / "a";
+	const fs::path target = snapshot / "settings.json";
+	fs::create_directories(snapshot);
+	CHECK(s.Place(target) == SnapshotPlacement::Linked);
+
+	std::error_code ec;
+	CHECK(s.store.Detach(snapshot, ec) == 1);
+	CHECK(!ec);
+	CHECK(fs::hard_link_count(target) == 1);
+	CHECK(OwnerWritable(target));
+	CHECK(Tests::ReadFile(target) == Settings);
+
+	// What the terminal writes stays in the snapshot; the object is no longer referenced.
+	Tests::WriteFile(target, "{}");
+	CHECK(Tests::ReadFile(s.Object()) == Settings);
+	CHECK(fs::hard_link_count(s.Object()) == 1);
+	CHECK(s.store.CollectGarbage().objects == 1);
+
+	// A detached snapshot has nothing left to detach.
+	CHECK(s.store.Detach(snapshot, ec) == 0);
+}
+
+TEST(CopiesOnHashCollision)
+{
+	StoreFolder s;
+	// An object under the source's hash and size with other contents, as a collision would leave it.
+	const fs::path object = s.Object();
+	const std::string other(Settings.size(), 'x');
+	Tests::WriteFile(object, other);
+
+	const fs::path target = s.folder / "snapshots" / "a" / "settings.json";
+	fs::create_directories(target.parent_path());
+	CHECK(s.Place(target) == SnapshotPlacement::Copied);
+	CHECK(Tests::ReadFile(target) == Settings);
+	CHECK(fs::hard_link_count(target) == 1);
+	CHECK(OwnerWritable(target));
+	CHECK(Tests::ReadFile(object) == other);
+}
+
+TEST(PlacesWithDefaultStore)
+{
+	// Clones where the temp folder's file system has them (FICLONE), links through the objects
+	// where it does not.
+	Tests::TempFolder folder;
+	const fs::path source = folder / "live" / "settings.json";
+	const fs::path target = folder / "snapshots" / "a" / "settings.json";
+	Tests::WriteFile(source, Settings);
+	fs::create_directories(target.parent_path());
+
+	SnapshotStore store(folder / "objects");
+	std::error_code ec;
+	const SnapshotPlacement placement = store.Place(source, target, ec);
+	CHECK(!ec);
+	CHECK(placement == SnapshotPlacement::Reflinked || placement == SnapshotPlacement::Linked);
+	CHECK(Tests::ReadFile(target) == Settings);
+	if (placement == SnapshotPlacement::Reflinked)
+	{
+		CHECK(!fs::exists(folder / "objects"));
+		CHECK(fs::hard_link_count(target) == 1);
+	}
+	else
+	{
+		CHECK(fs::hard_link_count(target) == 2);
+	}
+}
@@ -0,0 +1,142 @@
+﻿#include "Test.h"
+#include "StringPool.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	std::u16string Numbered(const char16_t* prefix, size_t i)
+	{
+		std::u16string text = prefix;
+		for (char c : std::to_string(i))
+		{
+			text += static_cast<char16_t>(c);
+		}
+		return text;
+	}
+}
+
+TEST(InternsEachStringOnce)
+{
+	StringPool pool;
+	const uint32_t cmd = pool.Intern(u"Command Prompt");
+	const uint32_t pwsh = pool.Intern(u"PowerShell");
+	CHECK(cmd != StringPool::NullId);
+	CHECK(pwsh != cmd);
+
+	// The same characters from another buffer get the same id and the same storage.
+	const std::u16string copy = u"Command Prompt";
+	CHECK(pool.Intern(copy) == cmd);
+	CHECK(pool.View(cmd) == u"Command Prompt");
+	CHECK(pool.View(cmd).data() != copy.data());
+	CHECK(pool.View(pool.Intern(copy)).data() == pool.View(cmd).data());
+
+	// Case matters: ids stand for exact strings.
+	CHECK(pool.Intern(u"command prompt") != cmd);
+
+	const StringPoolStats stats = pool.Stats();
+	CHECK(stats.strings == 3);
+	CHECK(stats.lookups == 5);
+	CHECK(stats.hits == 2);
+	CHECK(pool.Size() == 4);
+}
+
+TEST(KeepsNullAndEmptyApart)
+{
+	StringPool pool;
+	CHECK(pool.Intern(std::u16string_view()) == StringPool::NullId);
+	CHECK(pool.View(StringPool::NullId).data() == nullptr);
+
+	const uint32_t empty = pool.Intern(u"");
+	CHECK(empty != StringPool::NullId);
+	CHECK(pool.View(empty).data() != nullptr);
+	CHECK(pool.View(empty).empty());
+	CHECK(pool.Intern(std::u16string()) == empty);
+
+	// Unknown ids read as null.
+	CHECK(pool.View(pool.Size()).data() == nullptr);
+	CHECK(pool.View(0xFFFFFFFFu).data() == nullptr);
+}
+
+TEST(ViewsOutliveGrowth)
+{
+	// Entries are never released or moved: a view taken early stays valid while the arena, the
+	// id directory and the shards grow past their first blocks.
+	StringPool pool;
+	const uint32_t first = pool.Intern(u"first");
+	const std::u16string_view view = pool.View(first);
+	const std::u16string large(100000, u'x');
+	const uint32_t big = pool.Intern(large);
+
+	std::vector<uint32_t> ids;
+	for (size_t i = 0; i < 200000; ++i)
+	{
+		ids.push_back(pool.Intern(Numbered(u"tab ", i)));
+	}
+	CHECK(pool.View(first).data() == view.data());
+	CHECK(view == u"first");
+	CHECK(pool.View(big) == large);
+	bool intact = true;
+	for (size_t i = 0; i < ids.size(); i += 997)
+	{
+		intact = intact && pool.View(ids[i]) == Numbered(u"tab ", i);
+	}
+	CHECK(intact);
+	CHECK(pool.Stats().arenaBytes >= (large.size() + 200000 * 8) * sizeof(char16_t));
+}
+
+TEST(PoolsAreIndependent)
+{
+	StringPool one;
+	StringPool two;
+	two.Intern(u"only in two");
+	const uint32_t a = one.Intern(u"shared");
+	const uint32_t b = two.Intern(u"shared");
+	CHECK(a != b);
+	CHECK(one.View(a) == two.View(b));
+	CHECK(one.View(a).data() != two.View(b).data());
+	CHECK(&StringPool::Shared() == &StringPool::Shared());
+}
+
+TEST(AgreesOnIdsAcrossThreads)
+{
+	constexpr size_t Threads = 8;
+	constexpr size_t Strings = 5000;
+	StringPool pool;
+	std::vector<std::vector<uint32_t>> ids(Threads, std::vector<uint32_t>(Strings));
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < Threads; ++t)
+	{
+		// Every thread interns the same strings, each starting at another offset.
+		threads.emplace_back([&pool, &ids, t]() {
+			for (size_t i = 0; i < Strings; ++i)
+			{
+				const size_t n = (i + t * Strings / Threads) % Strings;
+				ids[t][n] = pool.Intern(Numbered(u"profile ", n));
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	bool agree = true;
+	for (size_t t = 1; t < Threads; ++t)
+	{
+		agree = agree && ids[t] == ids[0];
+	}
+	CHECK(agree);
+	CHECK(pool.Stats().strings == Strings);
+	CHECK(pool.Stats().lookups == Threads * Strings);
+	CHECK(pool.Stats().hits == (Threads - 1) * Strings);
+	bool match = true;
+	for (size_t n = 0; n < Strings; ++n)
+	{
+		match = match && pool.View(ids[0][n]) == Numbered(u"profile ", n);
+	}
+	CHECK(match);
+}
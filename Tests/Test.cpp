@@ -0,0 +1,87 @@
+﻿#include "Test.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace Tests {
+
+	namespace
+	{
+		struct Entry
+		{
+			const char* name;
+			TestFunction function;
+		};
+
+		std::vector<Entry>& Registry()
+		{
+			static std::vector<Entry> registry;
+			return registry;
+		}
+
+		int s_failures = 0;
+	}
+
+	Registration::Registration(const char* name, TestFunction function)
+	{
+		Registry().push_back({ name, function });
+	}
+
+	void Fail(const char* expression, const char* file, int line)
+	{
+		std::fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+		++s_failures;
+	}
+
+	TempFolder::TempFolder()
+	{
+		static std::atomic<unsigned> sequence{ 0 };
+		const auto ticks = std::chrono::steady_clock::now().time_since_epoch().count();
+		m_path = std::filesystem::temp_directory_path()
+			/ ("wtlm-test-" + std::to_string(ticks) + "-" + std::to_string(++sequence));
+		std::filesystem::create_directories(m_path);
+	}
+
+	TempFolder::~TempFolder()
+	{
+		std::error_code ignored;
+		std::filesystem::remove_all(m_path, ignored);
+	}
+
+	void WriteFile(const std::filesystem::path& path, const std::string& contents)
+	{
+		std::filesystem::create_directories(path.parent_path());
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file << contents;
+	}
+
+	std::string ReadFile(const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+}
+
+// Runs every test, or those whose name contains the first argument.
+int main(int argc, char** argv)
+{
+	int run = 0;
+	for (const Tests::Entry& test : Tests::Registry())
+	{
+		if (argc > 1 && std::strstr(test.name, argv[1]) == nullptr)
+		{
+			continue;
+		}
+		const int failuresBefore = Tests::s_failures;
+		test.function();
+		std::printf("%s %s\n", Tests::s_failures == failuresBefore ? "ok  " : "FAIL", test.name);
+		++run;
+	}
+	std::printf("%d test(s), %d failed check(s)\n", run, Tests::s_failures);
+	return Tests::s_failures == 0 && run > 0 ? 0 : 1;
+}
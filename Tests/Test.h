@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include <filesystem>
+#include <string>
+
+namespace Tests {
+
+	using TestFunction = void (*)();
+
+	/// <summary>
+	/// Adds a test to the executable's list; TEST does this for each test.
+	/// </summary>
+	struct Registration
+	{
+		Registration(const char* name, TestFunction function);
+	};
+
+	/// <summary>
+	/// Records a failed check of the running test; the test goes on.
+	/// </summary>
+	void Fail(const char* expression, const char* file, int line);
+
+	/// <summary>
+	/// A fresh, empty folder under the system temp folder, removed with its contents on destruction.
+	/// </summary>
+	class TempFolder
+	{
+	public:
+		TempFolder();
+		~TempFolder();
+
+		TempFolder(const TempFolder&) = delete;
+		TempFolder& operator=(const TempFolder&) = delete;
+
+		const std::filesystem::path& path() const noexcept { return m_path; }
+		std::filesystem::path operator/(const std::filesystem::path& relative) const { return m_path / relative; }
+
+	private:
+		std::filesystem::path m_path;
+	};
+
+	/// <summary>
+	/// Writes a file, creating its folder; replaces an existing one.
+	/// </summary>
+	void WriteFile(const std::filesystem::path& path, const std::string& contents);
+
+	/// <summary>
+	/// Reads a whole file; empty if it cannot be read.
+	/// </summary>
+	std::string ReadFile(const std::filesystem::path& path);
+
+}
+
+// Defines a test; every test of an executable runs in the order of definition.
+#define TEST(name) \
+	static void name(); \
+	static const Tests::Registration name##Registration(#name, name); \
+	static void name()
+
+// Checks a condition and reports it if it does not hold.
+#define CHECK(expression) \
+	((expression) ? (void)0 : Tests::Fail(#expression, __FILE__, __LINE__))
@@ -2,6 +2,7 @@
 using System.Configuration;
 using System.Data;
 using System.Diagnostics;
+using System.IO;
 using System.Security.Principal;
 using System.Windows;
 using WTLayoutManager.Services;
@@ -106,10 +107,29 @@ namespace WTLayoutManager
             //}
 
             base.OnStartup(e);
+
+            // Failures of the native launch code go to %LOCALAPPDATA%\WTLayoutManager\logs\WTLayoutManager.log.
+            NativeLogging.Start(
+                Path.Combine(Environment.GetFolderPath(Environment.SpecialFolder.LocalApplicationData), "WTLayoutManager", "logs"),
+                "WTLayoutManager");
+
+            // Drop the entries of terminals whose launcher crashed before unregistering them.
+            RunningTerminals.Sweep();
+
             var mainWindow = new MainWindow();
-            mainWindow.DataContext = new MainViewModel(new MessageBoxService());
+            mainWindow.DataContext = new MainViewModel(new MessageBoxService(), new FileDialogService());
             mainWindow.Show();
         }
+
+        /// <summary>
+        /// Handles the application exit event by writing out the native log.
+        /// </summary>
+        /// <param name="e">The event arguments for the application exit event.</param>
+        protected override void OnExit(ExitEventArgs e)
+        {
+            NativeLogging.Stop();
+            base.OnExit(e);
+        }
     }
 
 }
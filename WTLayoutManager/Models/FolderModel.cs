@@ -18,6 +18,7 @@ namespace WTLayoutManager.Models
         public string? Path { get; set; }
         public bool IsDefault { get; set; }
         public DateTime? LastRun { get; set; }
+        public bool IsPinned { get; set; }
         // Possibly store the sub-items here:
         public List<FileModel>? Files { get; set; }
     }
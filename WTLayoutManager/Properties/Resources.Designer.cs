@@ -123,6 +123,24 @@ namespace WTLayoutManager.Properties {
             }
         }
         
+        /// <summary>
+        ///   Looks up a localized string similar to Pin (never deleted when old folders are pruned).
+        /// </summary>
+        public static string ButtonTogglePin {
+            get {
+                return ResourceManager.GetString("ButtonTogglePin", resourceCulture);
+            }
+        }
+        
+        /// <summary>
+        ///   Looks up a localized string similar to Undo last layout change.
+        /// </summary>
+        public static string ButtonUndoLayoutChange {
+            get {
+                return ResourceManager.GetString("ButtonUndoLayoutChange", resourceCulture);
+            }
+        }
+        
         /// <summary>
         ///   Looks up a localized string similar to YES.
         /// </summary>
@@ -276,6 +294,15 @@ namespace WTLayoutManager.Properties {
             }
         }
         
+        /// <summary>
+        ///   Looks up a localized string similar to Cancel Copies and Deletes.
+        /// </summary>
+        public static string TooltipCancelFolderOperations {
+            get {
+                return ResourceManager.GetString("TooltipCancelFolderOperations", resourceCulture);
+            }
+        }
+        
         /// <summary>
         ///   Looks up a localized string similar to Clear search.
         /// </summary>
@@ -294,6 +321,24 @@ namespace WTLayoutManager.Properties {
             }
         }
         
+        /// <summary>
+        ///   Looks up a localized string similar to Export Folders.
+        /// </summary>
+        public static string TooltipExportFolders {
+            get {
+                return ResourceManager.GetString("TooltipExportFolders", resourceCulture);
+            }
+        }
+        
+        /// <summary>
+        ///   Looks up a localized string similar to Import Folders.
+        /// </summary>
+        public static string TooltipImportFolders {
+            get {
+                return ResourceManager.GetString("TooltipImportFolders", resourceCulture);
+            }
+        }
+        
         /// <summary>
         ///   Looks up a localized string similar to Reload Folders.
         /// </summary>
@@ -0,0 +1,52 @@
+﻿using Microsoft.Win32;
+using System.Windows;
+
+/// <summary>
+/// Provides the common open and save file dialogs.
+/// </summary>
+/// <remarks>
+/// Implements <see cref="IFileDialogService"/> with the Win32 dialogs, owned by the active window.
+/// </remarks>
+namespace WTLayoutManager.Services
+{
+    public class FileDialogService : IFileDialogService
+    {
+        /// <summary>
+        /// Retrieves the currently active window from the application's window collection.
+        /// </summary>
+        /// <returns>The active window, or null if no window is currently active.</returns>
+        private Window? GetOwnerWindow() => Application.Current.Windows.OfType<Window>().SingleOrDefault(x => x.IsActive);
+
+        /// <summary>
+        /// Asks for an existing file to open.
+        /// </summary>
+        /// <param name="filter">The file type filter, e.g. "Archives (*.wtla)|*.wtla".</param>
+        /// <returns>The chosen path, or null if the user cancelled.</returns>
+        public string? AskOpenFile(string filter)
+        {
+            var dialog = new OpenFileDialog
+            {
+                Filter = filter,
+                CheckFileExists = true
+            };
+            return dialog.ShowDialog(GetOwnerWindow()) == true ? dialog.FileName : null;
+        }
+
+        /// <summary>
+        /// Asks for a file to save to.
+        /// </summary>
+        /// <param name="filter">The file type filter, e.g. "Archives (*.wtla)|*.wtla".</param>
+        /// <param name="defaultFileName">The file name proposed to the user.</param>
+        /// <returns>The chosen path, or null if the user cancelled.</returns>
+        public string? AskSaveFile(string filter, string defaultFileName)
+        {
+            var dialog = new SaveFileDialog
+            {
+                Filter = filter,
+                FileName = defaultFileName,
+                OverwritePrompt = true
+            };
+            return dialog.ShowDialog(GetOwnerWindow()) == true ? dialog.FileName : null;
+        }
+    }
+}
\ No newline at end of file
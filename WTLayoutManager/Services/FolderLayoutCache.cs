@@ -0,0 +1,182 @@
+﻿using System.Collections.ObjectModel;
+using WTLayoutManager.Models;
+using WTLayoutManager.ViewModels;
+
+/// <summary>
+/// Bridges the parsed file models of a LocalState folder and its native binary sidecar cache.
+/// </summary>
+/// <remarks>
+/// A warm load maps the sidecar and rebuilds the file models from its records without touching JSON.
+/// The cache is invalidated by the native layer when a source file's size, timestamp or content changes.
+/// </remarks>
+namespace WTLayoutManager.Services
+{
+    public static class FolderLayoutCache
+    {
+        /// <summary>
+        /// Returns the file models of a folder from its sidecar cache.
+        /// </summary>
+        /// <param name="folderPath">The LocalState folder.</param>
+        /// <returns>The cached file models, or <c>null</c> if the cache is missing, stale or unreadable.</returns>
+        public static List<FileModel>? TryLoad(string folderPath)
+        {
+            try
+            {
+                var cached = LayoutCacheStore.TryLoad(folderPath);
+                return cached?.Select(ToFileModel).ToList();
+            }
+            catch (Exception)
+            {
+                return null;
+            }
+        }
+
+        /// <summary>
+        /// Captures the source file keys of a folder. Call before parsing its files.
+        /// </summary>
+        /// <param name="folderPath">The LocalState folder.</param>
+        /// <returns>The snapshot to pass to <see cref="Save"/>.</returns>
+        public static LayoutCacheSnapshot Capture(string folderPath)
+        {
+            return LayoutCacheStore.Capture(folderPath);
+        }
+
+        /// <summary>
+        /// Writes the parsed file models of a folder to its sidecar cache. Failures are ignored.
+        /// </summary>
+        /// <param name="snapshot">The snapshot captured before parsing.</param>
+        /// <param name="files">The parsed file models.</param>
+        public static void Save(LayoutCacheSnapshot snapshot, IEnumerable<FileModel> files)
+        {
+            try
+            {
+                LayoutCacheStore.Save(snapshot, files.Select(ToCachedFile).ToList());
+            }
+            catch (Exception)
+            {
+                // The cache is only an accelerator; the next load simply parses again.
+            }
+            finally
+            {
+                snapshot.Dispose();
+            }
+        }
+
+        /// <summary>
+        /// Rebuilds a file model from a cached file.
+        /// </summary>
+        private static FileModel ToFileModel(CachedFile file)
+        {
+            var profiles = new ObservableCollection<ProfileInfo>(file.Profiles.Select(p => new ProfileInfo
+            {
+                ProfileName = p.ProfileName,
+                IconPath = p.IconPath
+            }));
+
+            StateJsonTooltipViewModel? tabStates = null;
+            if (file.Tabs != null)
+            {
+                tabStates = new StateJsonTooltipViewModel();
+                foreach (var tab in file.Tabs)
+                {
+                    var tabVm = new TabStateViewModel
+                    {
+                        TabTitle = tab.TabTitle,
+                        GridRows = tab.GridRows,
+                        GridColumns = tab.GridColumns
+                    };
+                    foreach (var pane in tab.Panes)
+                    {
+                        tabVm.Panes.Add(new PaneViewModel
+                        {
+                            ProfileName = pane.ProfileName,
+                            Icon = pane.Icon,
+                            Commandline = pane.Commandline,
+                            StartingDirectory = pane.StartingDirectory,
+                            SplitDirection = pane.SplitDirection,
+                            X = pane.X,
+                            Y = pane.Y,
+                            Width = pane.Width,
+                            Height = pane.Height,
+                            GridRow = pane.GridRow,
+                            GridColumn = pane.GridColumn,
+                            GridRowSpan = pane.GridRowSpan,
+                            GridColumnSpan = pane.GridColumnSpan
+                        });
+                    }
+                    tabStates.TabStates.Add(tabVm);
+                }
+            }
+
+            return new FileModel
+            {
+                FileName = file.FileName,
+                LastModified = file.LastModified,
+                Size = file.Size,
+                Profiles = new SettingsJsonTooltipViewModel { Profiles = profiles },
+                TabStates = tabStates
+            };
+        }
+
+        /// <summary>
+        /// Converts a parsed file model into its cache representation.
+        /// </summary>
+        private static CachedFile ToCachedFile(FileModel file)
+        {
+            var cached = new CachedFile
+            {
+                FileName = file.FileName,
+                LastModified = file.LastModified,
+                Size = file.Size
+            };
+
+            if (file.Profiles != null)
+            {
+                foreach (var profile in file.Profiles.Profiles)
+                {
+                    cached.Profiles.Add(new CachedProfile
+                    {
+                        ProfileName = profile.ProfileName,
+                        IconPath = profile.IconPath
+                    });
+                }
+            }
+
+            if (file.TabStates != null)
+            {
+                cached.Tabs = new List<CachedTab>();
+                foreach (var tab in file.TabStates.TabStates)
+                {
+                    var cachedTab = new CachedTab
+                    {
+                        TabTitle = tab.TabTitle,
+                        GridRows = tab.GridRows,
+                        GridColumns = tab.GridColumns
+                    };
+                    foreach (var pane in tab.Panes)
+                    {
+                        cachedTab.Panes.Add(new CachedPane
+                        {
+                            ProfileName = pane.ProfileName,
+                            Icon = pane.Icon,
+                            Commandline = pane.Commandline,
+                            StartingDirectory = pane.StartingDirectory,
+                            SplitDirection = pane.SplitDirection,
+                            X = pane.X,
+                            Y = pane.Y,
+                            Width = pane.Width,
+                            Height = pane.Height,
+                            GridRow = pane.GridRow,
+                            GridColumn = pane.GridColumn,
+                            GridRowSpan = pane.GridRowSpan,
+                            GridColumnSpan = pane.GridColumnSpan
+                        });
+                    }
+                    cached.Tabs.Add(cachedTab);
+                }
+            }
+
+            return cached;
+        }
+    }
+}
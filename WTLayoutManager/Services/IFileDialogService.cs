@@ -0,0 +1,14 @@
+﻿namespace WTLayoutManager.Services
+{
+    /// <summary>
+    /// Provides methods for asking the user for a file to open or to save.
+    /// </summary>
+    /// <remarks>
+    /// This service abstracts the common file dialogs, so view models do not depend on WPF windows.
+    /// </remarks>
+    public interface IFileDialogService
+    {
+        string? AskOpenFile(string filter);
+        string? AskSaveFile(string filter, string defaultFileName);
+    }
+}
\ No newline at end of file
@@ -1,8 +1,7 @@
-﻿using System.IO;
+﻿using System.Diagnostics;
+using System.IO;
 using System.Text.Json;
-using System.Windows.Resources;
 using WTLayoutManager.Models;
-using System.Windows;
 
 /// <summary>
 /// Provides utility methods for parsing and processing Windows Terminal settings and profile configurations.
@@ -31,13 +30,7 @@ namespace WTLayoutManager.Services
             if (!File.Exists(filePath))
                 yield break;
 
-            var json = File.ReadAllText(filePath);
-            var settings = JsonSerializer.Deserialize<SettingsJson>(json, TerminalJsonOptions.SerializerOptions);
-
-            if (settings?.Profiles?.List == null)
-                yield break;
-
-            foreach (var profile in settings.Profiles.List)
+            foreach (var profile in ReadProfiles(filePath))
             {
                 if (string.IsNullOrWhiteSpace(profile.Name))
                     continue;
@@ -54,89 +47,61 @@ namespace WTLayoutManager.Services
         }
 
         /// <summary>
-        /// Determines whether the specified pack URI string refers to a resource that exists within the application's package.
+        /// Reads the profiles listed in a settings.json file.
         /// </summary>
-        /// <param name="packUriString">The pack URI string to check.</param>
-        /// <returns>true if the resource exists; otherwise, false.</returns>
-        public static bool ResourceExists(string packUriString)
+        /// <remarks>
+        /// The native scanner maps the file and visits only profiles.list, skipping schemes, actions and themes
+        /// without materializing them. If it cannot read the file, the whole document is deserialized instead,
+        /// which also reports any JSON error to the caller.
+        /// </remarks>
+        /// <param name="filePath">The file path to the settings.json file.</param>
+        /// <returns>The profiles in file order.</returns>
+        private static IEnumerable<Profile> ReadProfiles(string filePath)
         {
-            var uri = new Uri(packUriString, UriKind.Absolute);
-
+            long started = Stopwatch.GetTimestamp();
             try
             {
-                // Attempt to retrieve the resource stream
-                StreamResourceInfo resourceInfo = Application.GetResourceStream(uri);
-                // If resourceInfo is null, the resource doesn't exist
-                return resourceInfo != null;
+                var scanned = SettingsProfileReader.Read(filePath);
+                if (scanned != null)
+                {
+                    return scanned.Select(p => new Profile
+                    {
+                        Name = p.Name,
+                        Icon = p.Icon,
+                        Source = p.Source,
+                        GUID = p.Guid,
+                        Hidden = p.Hidden
+                    });
+                }
+
+                var json = File.ReadAllText(filePath);
+                var settings = JsonSerializer.Deserialize<SettingsJson>(json, TerminalJsonOptions.SerializerOptions);
+                return settings?.Profiles?.List ?? Enumerable.Empty<Profile>();
             }
-            catch
+            finally
             {
-                // If an exception is thrown, the resource doesn't exist
-                return false;
+                MetricsPublisher.Increment(RuntimeCounter.SettingsParses);
+                MetricsPublisher.Record(RuntimeHistogram.SettingsParse, Stopwatch.GetElapsedTime(started));
             }
         }
 
-        /// <summary>
-        /// Defines a list of icon mapping rules for different terminal profiles based on their source and name.
-        /// Each rule consists of a predicate function to match a profile and a corresponding icon path.
-        /// </summary>
-        private static readonly List<(Func<Profile, bool> Check, string Icon)> IconMappings = new List<(Func<Profile, bool>, string)>
-        {
-            (p => p?.Source?.EndsWith(".Wsl") == true, "pack://application:,,,/WTLayoutManager;component/Assets/wsl.png"),
-            (p => p?.Source?.EndsWith("Git") == true, "pack://application:,,,/WTLayoutManager;component/Assets/git-bash.png"),
-            (p => p?.Source?.EndsWith(".VisualStudio") == true && p?.Name?.Contains("Windows PowerShell") == true, "pack://application:,,,/WTLayoutManager;component/Assets/vs-powershell.png"),
-            (p => p?.Source?.EndsWith(".VisualStudio") == true && p?.Name?.Contains("PowerShell") == true, "pack://application:,,,/WTLayoutManager;component/Assets/vs-pwsh.png"),
-            (p => p?.Source?.EndsWith(".VisualStudio") == true && p?.Name?.Contains("Command Prompt") == true, "pack://application:,,,/WTLayoutManager;component/Assets/vs-cmd.png"),
-            (p => p?.Name?.Contains("Windows PowerShell") == true, "pack://application:,,,/WTLayoutManager;component/Assets/powershell.png"),
-            (p => p?.Name?.Contains("PowerShell") == true && p?.Name?.Contains("Preview") == true, "pack://application:,,,/WTLayoutManager;component/Assets/pwsh-preview.png"),
-            (p => p?.Name?.Contains("PowerShell") == true, "pack://application:,,,/WTLayoutManager;component/Assets/pwsh.png")
-        };
-
         /// <summary>
         /// Resolves the icon path for a given terminal profile.
-        /// If the profile's icon is empty, it will be resolved based on the profile's name and source.
-        /// If the profile's icon is not empty and starts with "ms-appx:///", it will be expanded to a valid resource path.
-        /// If the profile's icon is not empty and does not start with "ms-appx:///", it will be expanded to a valid file path using environment variables.
-        /// If the expanded icon path does not exist, it will be resolved based on the profile's name and source.
-        /// If the expanded icon path exists, it will be returned.
-        /// If the profile's icon is empty and the expanded icon path does not exist, the default fallback icon will be returned.
+        /// If the profile's icon is empty, a bundled Assets/{guid}.png is used when one exists, otherwise the icon is chosen from the profile's source and name.
+        /// If the profile's icon starts with "ms-appx:///", it is mapped onto the bundled asset with the same file name.
+        /// Otherwise the icon is expanded with environment variables and returned if the file exists, or chosen from the profile's source and name.
+        /// Profiles that match no source / name rule fall back to cmd.png.
         /// </summary>
+        /// <remarks>
+        /// Resolution happens in the native <see cref="ProfileIcons"/> resolver, which checks the bundled assets through a compile-time
+        /// perfect hash table, evaluates the source / name rules as a precomputed decision table and memoizes every result process-wide,
+        /// so a profile shared by many LocalState folders is resolved once per load.
+        /// </remarks>
         /// <param name="profile">The profile to resolve the icon path for.</param>
         /// <returns>The resolved icon path for the given profile.</returns>
         private static string ResolveIconPath(Profile profile)
         {
-            if (string.IsNullOrWhiteSpace(profile.Icon))
-            {
-                var guidImg = $"pack://application:,,,/WTLayoutManager;component/Assets/{Path.GetFileName(profile.GUID)}.png";
-                if (ResourceExists(guidImg))
-                    return guidImg;
-
-                // Iterate rules to select icon
-                foreach (var rule in IconMappings)
-                {
-                    if (rule.Check(profile))
-                        return rule.Icon;
-                }
-
-                // Default fallback
-                return "pack://application:,,,/WTLayoutManager;component/Assets/cmd.png";
-            }
-
-            // Handle non-empty profile.Icon logic as before…
-            if (profile.Icon.StartsWith("ms-appx:///"))
-                return $"pack://application:,,,/WTLayoutManager;component/Assets/{Path.GetFileName(profile.Icon)}";
-
-            var expandedIcon = Environment.ExpandEnvironmentVariables(profile.Icon);
-            if (Path.Exists(expandedIcon))
-                return expandedIcon;
-
-            foreach (var rule in IconMappings)
-            {
-                if (rule.Check(profile))
-                    return rule.Icon;
-            }
-
-            return "pack://application:,,,/WTLayoutManager;component/Assets/cmd.png";
+            return ProfileIcons.Resolve(profile.GUID, profile.Icon, profile.Source, profile.Name);
         }
     }
 }
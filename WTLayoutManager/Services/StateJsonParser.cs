@@ -1,4 +1,5 @@
-﻿using System.IO;
+﻿using System.Diagnostics;
+using System.IO;
 using System.Text.Json;
 using WTLayoutManager.Models;
 using WTLayoutManager.ViewModels;
@@ -25,9 +26,10 @@ namespace WTLayoutManager.Services
             public TabStateViewModel? CurrentTab { get; set; }
             public PaneViewModel? CurrentFocusedPane { get; set; }
             public List<TabStateViewModel> Tabs { get; } = new List<TabStateViewModel>();
+            // The "splitPane" actions of every tab: the index of the pane split and the side of the new pane.
+            public Dictionary<TabStateViewModel, List<(int Focused, int Direction)>> Splits { get; } = new();
         }
 
-        const double tolerance = 0.0001;
         // Define a delegate for the action handler:
         /// <summary>
         /// Defines a delegate for handling tab layout actions, specifying the method signature for action handler functions.
@@ -67,12 +69,14 @@ namespace WTLayoutManager.Services
         {
             context.CurrentTab = new TabStateViewModel
             {
-                TabTitle = action.TabTitle
+                TabTitle = InternedStrings.Intern(action.TabTitle)
             };
             var pane = new PaneViewModel
             {
-                ProfileName = action.Profile,
+                ProfileName = InternedStrings.Intern(action.Profile),
                 Icon = GetIconForProfile(action.Profile, profileIcons),
+                Commandline = InternedStrings.Intern(action.Commandline),
+                StartingDirectory = InternedStrings.Intern(action.StartingDirectory),
                 X = 0,
                 Y = 0,
                 Width = 1,
@@ -93,10 +97,11 @@ namespace WTLayoutManager.Services
         /// <param name="profileIcons">A dictionary mapping profile names to their corresponding icons.</param>
         /// <param name="context">The current tab context containing the current tab and focused pane.</param>
         /// <remarks>
-        /// The function supports splitting the focused pane in four directions: left, right, up, and down.
-        /// The newly created pane inherits the profile and icon information from the action. The geometry
-        /// of the focused pane is adjusted based on the split direction, and the new pane is added to the
-        /// current tab's collection of panes.
+        /// The newly created pane inherits the profile and icon information from the action and becomes the
+        /// focused pane. Only the split itself is recorded here: the geometry of all panes is computed from the
+        /// recorded splits by the native <see cref="LayoutKernel"/> once the whole layout has been replayed
+        /// (see <see cref="ComputeGridLayout"/>). The new pane takes the half of the focused pane on the
+        /// requested side (left, right, up or down); any other direction gives it no area.
         /// </remarks>
         private static void HandleSplitPane(
             TabLayoutAction action,
@@ -105,65 +110,32 @@ namespace WTLayoutManager.Services
         {
             if (context.CurrentTab != null && context.CurrentFocusedPane != null)
             {
-                // Clone the geometry of the currently focused pane.
-                double x = context.CurrentFocusedPane.X;
-                double y = context.CurrentFocusedPane.Y;
-                double w = context.CurrentFocusedPane.Width;
-                double h = context.CurrentFocusedPane.Height;
-                double newW, newH;
                 var splitDir = action.Split?.ToLowerInvariant();
                 PaneViewModel newPane = new()
                 {
-                    ProfileName = action.Profile,
+                    ProfileName = InternedStrings.Intern(action.Profile),
                     Icon = GetIconForProfile(action.Profile, profileIcons),
-                    SplitDirection = splitDir
+                    Commandline = InternedStrings.Intern(action.Commandline),
+                    StartingDirectory = InternedStrings.Intern(action.StartingDirectory),
+                    SplitDirection = InternedStrings.Intern(splitDir)
                 };
 
-                switch (splitDir)
+                // Values of the native SplitDirection.
+                int direction = splitDir switch
                 {
-                    case "left":
-                        newW = w / 2;
-                        // New pane occupies left half.
-                        newPane.X = x;
-                        newPane.Y = y;
-                        newPane.Width = newW;
-                        newPane.Height = h;
-                        // Focused pane becomes the right half.
-                        context.CurrentFocusedPane.X = x + newW;
-                        context.CurrentFocusedPane.Width = newW;
-                        break;
-                    case "right":
-                        newW = w / 2;
-                        // New pane occupies right half.
-                        newPane.X = x + newW;
-                        newPane.Y = y;
-                        newPane.Width = newW;
-                        newPane.Height = h;
-                        // Focused pane becomes the left half.
-                        context.CurrentFocusedPane.Width = newW;
-                        break;
-                    case "up":
-                        newH = h / 2;
-                        // New pane occupies the top half.
-                        newPane.X = x;
-                        newPane.Y = y;
-                        newPane.Width = w;
-                        newPane.Height = newH;
-                        // Focused pane becomes the bottom half.
-                        context.CurrentFocusedPane.Y = y + newH;
-                        context.CurrentFocusedPane.Height = newH;
-                        break;
-                    case "down":
-                        newH = h / 2;
-                        // New pane occupies the bottom half.
-                        newPane.X = x;
-                        newPane.Y = y + newH;
-                        newPane.Width = w;
-                        newPane.Height = newH;
-                        // Focused pane becomes the top half.
-                        context.CurrentFocusedPane.Height = newH;
-                        break;
+                    "left" => 0,
+                    "right" => 1,
+                    "up" => 2,
+                    "down" => 3,
+                    _ => -1
+                };
+                if (!context.Splits.TryGetValue(context.CurrentTab, out var splits))
+                {
+                    splits = new List<(int Focused, int Direction)>();
+                    context.Splits.Add(context.CurrentTab, splits);
                 }
+                splits.Add((context.CurrentTab.Panes.IndexOf(context.CurrentFocusedPane), direction));
+
                 // Add the new pane and update focus.
                 context.CurrentTab.Panes.Add(newPane);
                 context.CurrentFocusedPane = newPane;
@@ -268,6 +240,17 @@ namespace WTLayoutManager.Services
         /// This method will return <c>null</c> if the file does not exist or is not a valid state.json file. Otherwise, it will create a tooltip view model containing the state of the persisted window layout by parsing the state.json file and executing the specified actions.
         /// </remarks>
         public static StateJsonTooltipViewModel? ParseState(string filePath, Dictionary<string, string> profileIcons)
+        {
+            var state = ReadState(filePath);
+            return state == null ? null : Replay(state, profileIcons);
+        }
+
+        /// <summary>
+        /// Reads and deserializes a state.json or elevated-state.json file, without replaying its actions.
+        /// </summary>
+        /// <param name="filePath">The file path to the state file.</param>
+        /// <returns>The deserialized state, or <c>null</c> if the file does not exist or is not a valid state file.</returns>
+        public static StateJson? ReadState(string filePath)
         {
             var fileName = Path.GetFileName(filePath);
             if (!fileName.EndsWith("state.json"))
@@ -276,27 +259,51 @@ namespace WTLayoutManager.Services
             if (!File.Exists(filePath))
                 return null;
 
-            string json;
+            long started = Stopwatch.GetTimestamp();
             try
             {
-                json = File.ReadAllText(filePath);
-            }
-            catch (Exception)
-            {
-                return null;
-            }
+                string json;
+                try
+                {
+                    json = File.ReadAllText(filePath);
+                }
+                catch (Exception)
+                {
+                    return null;
+                }
 
-            StateJson? state;
-            try
-            {
-                state = JsonSerializer.Deserialize<StateJson>(json, TerminalJsonOptions.SerializerOptions);
-                if (state == null)
+                StateJson? state;
+                try
+                {
+                    state = JsonSerializer.Deserialize<StateJson>(json, TerminalJsonOptions.SerializerOptions);
+                    if (state == null)
+                        return null;
+                }
+                catch (Exception)
+                {
                     return null;
+                }
+                return state;
             }
-            catch (Exception)
+            finally
             {
-                return null;
+                MetricsPublisher.Increment(RuntimeCounter.StateParses);
+                MetricsPublisher.Record(RuntimeHistogram.StateParse, Stopwatch.GetElapsedTime(started));
             }
+        }
+
+        /// <summary>
+        /// Replays the tab layout of the first persisted window and computes the pane grid of every tab.
+        /// </summary>
+        /// <param name="state">A state read by <see cref="ReadState"/>.</param>
+        /// <param name="profileIcons">A dictionary mapping profile names to their corresponding icons.</param>
+        /// <returns>A tooltip view model containing the tabs of the window, or <c>null</c> if the state has no tab layout.</returns>
+        /// <remarks>
+        /// The strings the tabs and panes keep are passed through <see cref="InternedStrings"/>, so every snapshot of the same
+        /// settings shares one instance of each profile name, title, command line and starting directory.
+        /// </remarks>
+        public static StateJsonTooltipViewModel? Replay(StateJson state, Dictionary<string, string> profileIcons)
+        {
             if (state.PersistedWindowLayouts == null || state.PersistedWindowLayouts.Count == 0)
                 return null;
 
@@ -316,70 +323,62 @@ namespace WTLayoutManager.Services
                 }
             }
 
-            // For each tab, compute grid layout from pane geometries.
+            // For each tab, replay its splits and compute the grid layout of the resulting panes.
             foreach (var tab in context.Tabs)
             {
-                ComputeGridLayout(tab);
+                context.Splits.TryGetValue(tab, out var splits);
+                ComputeGridLayout(tab, splits);
                 tooltipVm.TabStates.Add(tab);
             }
             return tooltipVm;
         }
 
         /// <summary>
-        /// Compute grid placement for each pane using the geometry rectangles.
+        /// Compute the geometry and grid placement of each pane from the splits of the tab.
         /// </summary>
-        /// <param name="tab">The tab state view model containing the panes.</param>
+        /// <param name="tab">The tab state view model containing the panes, in the order they were created.</param>
+        /// <param name="splits">The splits recorded by <see cref="HandleSplitPane"/>; split i created pane i + 1.</param>
         /// <remarks>
-        /// This algorithm:
-        /// 1. Collects all unique X coordinates (pane.X and pane.X+pane.Width)
-        ///    and all unique Y coordinates (pane.Y and pane.Y+pane.Height).
-        /// 2. Sorts them and uses them as boundaries for grid columns and rows.
-        /// 3. For each pane, sets GridColumn and GridColumnSpan and similarly for rows.
+        /// The work is done by the native <see cref="LayoutKernel"/>, which:
+        /// 1. Replays the splits from the full tab on exact dyadic rationals (numerators over 2^63);
+        ///    every split halves a side, so no rounding takes place.
+        /// 2. Radix-sorts and deduplicates the X and Y edges, merging only identical numerators
+        ///    into one grid line, without any tolerance comparison.
+        /// 3. For each pane, returns its geometry, GridColumn and GridColumnSpan and similarly for rows.
         /// </remarks>
-        private static void ComputeGridLayout(TabStateViewModel tab)
+        private static void ComputeGridLayout(TabStateViewModel tab, List<(int Focused, int Direction)>? splits)
         {
-            var xCoords = new SortedSet<double>();
-            var yCoords = new SortedSet<double>();
-
-            foreach (var pane in tab.Panes)
+            int count = tab.Panes.Count;
+            int splitCount = count - 1;
+            var focused = new int[splitCount];
+            var directions = new int[splitCount];
+            for (int i = 0; i < splitCount; i++)
             {
-                xCoords.Add(pane.X);
-                xCoords.Add(pane.X + pane.Width);
-                yCoords.Add(pane.Y);
-                yCoords.Add(pane.Y + pane.Height);
+                (focused[i], directions[i]) = splits![i];
             }
 
-            // Convert to list for index lookup.
-            var xList = xCoords.ToList();
-            var yList = yCoords.ToList();
+            var x = new double[count];
+            var y = new double[count];
+            var width = new double[count];
+            var height = new double[count];
+            var placements = new int[count * 4];
+            LayoutKernel.Replay(focused, directions, x, y, width, height, placements, out int rows, out int columns);
 
             // The number of grid columns/rows.
-            tab.GridColumns = xList.Count - 1;
-            tab.GridRows = yList.Count - 1;
+            tab.GridColumns = columns;
+            tab.GridRows = rows;
 
-            foreach (var pane in tab.Panes)
+            for (int i = 0; i < count; i++)
             {
-                // Find the start column index.
-                int colStart = xList.FindIndex(x => Math.Abs(x - pane.X) < tolerance);
-                // Find the end column index.
-                int colEnd = xList.FindIndex(x => Math.Abs(x - (pane.X + pane.Width)) < tolerance);
-                if (colStart == -1 || colEnd == -1)
-                {
-                    colStart = 0;
-                    colEnd = 1;
-                }
-                pane.GridColumn = colStart;
-                pane.GridColumnSpan = colEnd - colStart;
-
-                int rowStart = yList.FindIndex(y => Math.Abs(y - pane.Y) < tolerance);
-                int rowEnd = yList.FindIndex(y => Math.Abs(y - (pane.Y + pane.Height)) < tolerance);
-                if (rowStart == -1 || rowEnd == -1)
-                {
-                    rowStart = 0;
-                    rowEnd = 1;
-                }
-                pane.GridRow = rowStart;
-                pane.GridRowSpan = rowEnd - rowStart;
+                var pane = tab.Panes[i];
+                pane.X = x[i];
+                pane.Y = y[i];
+                pane.Width = width[i];
+                pane.Height = height[i];
+                pane.GridRow = placements[i * 4];
+                pane.GridColumn = placements[i * 4 + 1];
+                pane.GridRowSpan = placements[i * 4 + 2];
+                pane.GridColumnSpan = placements[i * 4 + 3];
             }
         }
 
@@ -34,6 +34,31 @@ namespace WTLayoutManager.ViewModels
         private readonly Dictionary<string, Task<int>> _runningTerminals = new Dictionary<string, Task<int>>();
         private readonly Dictionary<string, Task<int>> _runningTerminalsAs = new Dictionary<string, Task<int>>();
 
+        /// <summary>
+        /// The launches of this folder with the selected terminal, compiled on the first Run and reused until
+        /// the terminal, the folder or the hook changes.
+        /// </summary>
+        private TerminalLaunchPlan? _launchPlan;
+        private TerminalLaunchPlan? _launchPlanAs;
+
+        /// <summary>
+        /// Store shared by all LocalState copies, so duplicates of the same settings.json/state.json take no extra space.
+        /// </summary>
+        private static readonly LocalStateStore _snapshotStore = new LocalStateStore(
+            System.IO.Path.Combine(Environment.GetFolderPath(Environment.SpecialFolder.LocalApplicationData), "WTLayoutManager", "objects"));
+
+        /// <summary>
+        /// Deleted folders are renamed into this folder before being deleted, so a folder with a locked file is left intact.
+        /// </summary>
+        private static readonly string _trashPath =
+            System.IO.Path.Combine(Environment.GetFolderPath(Environment.SpecialFolder.LocalApplicationData), "WTLayoutManager", "trash");
+
+        /// <summary>
+        /// The store and trash folder every delete goes through, including the pruning of old copies.
+        /// </summary>
+        internal static LocalStateStore SnapshotStore => _snapshotStore;
+        internal static string TrashPath => _trashPath;
+
         /// <summary>
         /// Represents a folder with its associated files and settings, including operations for running, duplicating, deleting, and editing the folder.
         /// </summary>
@@ -71,6 +96,7 @@ namespace WTLayoutManager.ViewModels
                     {
                         File.Replace(tmp, _dstHookPath, destinationBackupFileName: null, ignoreMetadataErrors: true);
                     }
+                    TerminalLaunchPlan.InvalidateAll();
                 }
                 finally
                 {
@@ -84,8 +110,10 @@ namespace WTLayoutManager.ViewModels
             // Initialize commands
             RunCommand = new RelayCommand(async _ => await ExecuteRunAsync());
             RunAsCommand = new RelayCommand(async _ => await ExecuteRunAsAsync());
-            DuplicateCommand = new RelayCommand(ExecuteDuplicate);
-            DeleteCommand = new RelayCommand(ExecuteDelete);
+            DuplicateCommand = new RelayCommand(async _ => await ExecuteDuplicateAsync(null));
+            DeleteCommand = new RelayCommand(async _ => await ExecuteDeleteAsync());
+            UndoLayoutChangeCommand = new RelayCommand(ExecuteUndoLayoutChange);
+            TogglePinCommand = new RelayCommand(ExecuteTogglePin);
             OpenFolderCommand = new RelayCommand(ExecuteOpenFolder);
             EditFolderCommand = new RelayCommand(ExecuteEditFolderCommand);
             ConfirmEditCommand = new RelayCommand(ExecuteConfirmEditCommand);
@@ -137,7 +165,7 @@ namespace WTLayoutManager.ViewModels
                 if (_folder.Name != value)
                 {
                     //_folder.Name = value;
-                    ExecuteDuplicateEx(null, value);
+                    _ = ExecuteDuplicateAsync(value);
                     OnPropertyChanged();
                 }
             }
@@ -165,6 +193,24 @@ namespace WTLayoutManager.ViewModels
 
         public bool IsDefault => _folder.IsDefault;
         public bool CanDelete => !_folder.IsDefault;
+        public bool CanUndoLayoutChange => !_folder.IsDefault;
+        public bool CanPin => !_folder.IsDefault;
+
+        /// <summary>
+        /// A pinned copy is never deleted by the retention budget.
+        /// </summary>
+        public bool IsPinned
+        {
+            get => _folder.IsPinned;
+            private set
+            {
+                if (_folder.IsPinned != value)
+                {
+                    _folder.IsPinned = value;
+                    OnPropertyChanged();
+                }
+            }
+        }
         public DateTime? LastRun
         {
             get => _folder.LastRun;
@@ -180,6 +226,49 @@ namespace WTLayoutManager.ViewModels
 
         public List<FileModel>? Files => _folder.Files; // or new ObservableCollection if needed
 
+        private string? _resourceUsageText;
+
+        /// <summary>
+        /// What the terminals launched for this folder used in this session, or null if none was launched.
+        /// </summary>
+        public string? ResourceUsageText
+        {
+            get => _resourceUsageText;
+            private set
+            {
+                if (_resourceUsageText != value)
+                {
+                    _resourceUsageText = value;
+                    OnPropertyChanged();
+                }
+            }
+        }
+
+        /// <summary>
+        /// Reads the folder's entry of the native resource ledger into <see cref="ResourceUsageText"/>.
+        /// </summary>
+        private void RefreshResourceUsage()
+        {
+            var usage = Path is { Length: > 0 } ? TerminalResources.ForFolder(Path) : null;
+            ResourceUsageText = usage == null
+                ? null
+                : $"CPU {usage.CpuTime.TotalSeconds:F1} s, peak memory {usage.PeakMemoryBytes / (1024 * 1024)} MB, " +
+                  $"read {usage.ReadBytes / (1024 * 1024)} MB, written {usage.WriteBytes / (1024 * 1024)} MB, " +
+                  $"{usage.TotalProcesses} processes in {usage.Launches} launches";
+        }
+
+        /// <summary>
+        /// Takes over the files and last run time of a freshly loaded model of the same folder,
+        /// used when the folder watcher reports that its JSON files changed on disk.
+        /// </summary>
+        /// <param name="folder">The reloaded folder model.</param>
+        public void Refresh(FolderModel folder)
+        {
+            _folder.Files = folder.Files;
+            OnPropertyChanged(nameof(Files));
+            LastRun = folder.LastRun;
+        }
+
         // Expand/Collapse handling in the main grid can be done at the MainViewModel level, or here with a boolean.
 
         // Commands
@@ -187,6 +276,8 @@ namespace WTLayoutManager.ViewModels
         public ICommand RunAsCommand { get; }
         public ICommand DuplicateCommand { get; }
         public ICommand DeleteCommand { get; }
+        public ICommand UndoLayoutChangeCommand { get; }
+        public ICommand TogglePinCommand { get; }
         public ICommand OpenFolderCommand { get; }
         public ICommand EditFolderCommand { get; }
         public ICommand ConfirmEditCommand { get; }
@@ -220,67 +311,54 @@ namespace WTLayoutManager.ViewModels
         }
 
         /// <summary>
-        /// Builds the command line for running a terminal executable with the given file name,
-        /// adding the "--localstate" option if the terminal version is at least 1.25.53104.5.
-        /// </summary>
-        /// <param name="terminalInfo">The terminal information, including the version</param>
-        /// <param name="fileName">The file name of the terminal executable</param>
-        /// <returns>The command line to run the terminal executable</returns>
-        private string BuildCommandLine(TerminalInfo terminalInfo, string fileName)
-        {
-            var commandLine = $"\"{fileName}\"";
-            //if (TerminalHasLocalStateParam(terminalInfo))
-            //{
-            //    commandLine += $" --localstate \"{Path}\"";
-            //}
-            return commandLine;
-        }
-
-        /// <summary>
-        /// Builds an environment block for the terminal executable, setting the <c>WT_BASE_SETTINGS_PATH</c>
-        /// environment variable to the path of the folder when the folder is not the default one and the
-        /// terminal version is at least 1.24.53104.5.
+        /// Returns the launch plan of this folder with a terminal, compiling it if there is none yet or the one
+        /// there is was made for another terminal or folder, or has gone stale.
         /// </summary>
-        /// <param name="terminalInfo">The terminal information, including the version</param>
-        /// <returns>The environment block to pass to the terminal executable</returns>
-        private string BuildEnvironmentBlock(TerminalInfo terminalInfo)
+        /// <remarks>
+        /// Compiling probes the package for wt.exe, then wtd.exe, checks the hook, and prebuilds the command line
+        /// and the environment that redirects the package's LocalState (<c>WT_DEFAULT_LOCALSTATE</c>) to this
+        /// folder (<c>WT_REDIRECT_LOCALSTATE</c>); later clicks launch the plan as it is.
+        /// </remarks>
+        /// <param name="terminalInfo">The terminal information, including the installation location path</param>
+        /// <param name="elevated">Whether the terminal runs elevated</param>
+        /// <returns>The plan</returns>
+        /// <exception cref="FileNotFoundException">The terminal or the hook is missing.</exception>
+        private TerminalLaunchPlan GetLaunchPlan(TerminalInfo terminalInfo, bool elevated)
         {
-            string defaultFolderPath = System.IO.Path.Combine(
-                Environment.GetFolderPath(Environment.SpecialFolder.LocalApplicationData),
-                "Packages",
-                terminalInfo.FamilyName,
-                "LocalState");
-
-            //defaultFolderPath = "C:\\Users\\dmitr\\AppData\\Local\\Microsoft\\Windows Terminal";
-
-            string envBlock = string.Empty;
-            //if (TerminalHasLocalStateParam(terminalInfo))
-            //{
-            //    // Single-null terminators per variable, ending with a double-null terminator.
-            //    envBlock += $";WT_BASE_SETTINGS_PATH={Path}";
-            //}
-            envBlock += $";WT_DEFAULT_LOCALSTATE={defaultFolderPath}";
-            envBlock += $";WT_REDIRECT_LOCALSTATE={Path}";
-            envBlock += $";WT_HOOK_DLL_PATH={_dstHookPath}";
-            return envBlock.TrimStart(';');
+            var plan = elevated ? _launchPlanAs : _launchPlan;
+            if (plan == null || !plan.IsCurrent || plan.PackageFolder != terminalInfo.InstalledLocationPath || plan.LocalStateFolder != Path)
+            {
+                string defaultFolderPath = System.IO.Path.Combine(
+                    Environment.GetFolderPath(Environment.SpecialFolder.LocalApplicationData),
+                    "Packages",
+                    terminalInfo.FamilyName,
+                    "LocalState");
+
+                plan = ProcessLauncher.CompilePlan(
+                    terminalInfo.InstalledLocationPath,
+                    defaultFolderPath,
+                    Path,
+                    _dstHookPath,
+                    elevated ? System.IO.Path.Combine(AppDomain.CurrentDomain.BaseDirectory, "ElevatedLauncher.exe") : null,
+                    new TerminalLaunchPolicy()
+                );
+                if (elevated)
+                    _launchPlanAs = plan;
+                else
+                    _launchPlan = plan;
+            }
+            return plan;
         }
 
         /// <summary>
-        /// Builds the path to the terminal executable given the terminal information.
-        /// Uses "WindowsTerminal.exe" as the default file name, and falls back to "wtd.exe" if that is not found.
+        /// Forgets a launch plan after a launch from it failed, so the next Run probes the package again.
         /// </summary>
-        /// <param name="terminalInfo">The terminal information, including the installation location path</param>
-        /// <returns>The path to the terminal executable</returns>
-        private string BuildTerminalPath(TerminalInfo terminalInfo)
+        private void DropLaunchPlan(bool elevated)
         {
-            //return "C:\\Users\\dmitr\\src\\terminal\\bin\\x64\\Debug\\WindowsTerminal\\WindowsTerminal.exe";
-            var fileName = System.IO.Path.Combine(terminalInfo.InstalledLocationPath, "wt.exe");
-            if (!File.Exists(fileName))
-            {
-                fileName = System.IO.Path.Combine(terminalInfo.InstalledLocationPath, "wtd.exe");
-            }
-
-            return fileName;
+            if (elevated)
+                _launchPlanAs = null;
+            else
+                _launchPlan = null;
         }
 
         /// <summary>
@@ -311,22 +389,28 @@ namespace WTLayoutManager.ViewModels
         /// passing the folder path as the "--localstate" option if the terminal version is at least 1.25.53104.5.
         /// Also sets the <c>WT_BASE_SETTINGS_PATH</c> environment variable to the path of the folder
         /// when the folder is not the default one and the terminal version is at least 1.24.53104.5.
+        /// The terminal is started from the folder's launch plan (see <see cref="GetLaunchPlan"/>).
         /// </summary>
         /// <param name="runningTerminals">The dictionary of running terminals, keyed by the folder path</param>
         /// <param name="alreadyRunningMessage">The message to show if the terminal is already running</param>
         /// <param name="propertyName">The name of the property to raise the PropertyChanged event for</param>
-        /// <param name="launchProcess">The function to launch the terminal executable</param>
+        /// <param name="elevated">Whether the terminal runs elevated, through the elevated launcher</param>
         /// <returns>A task that completes when the terminal executable exits</returns>
         private async Task ExecuteTerminalAsync(
             Dictionary<string, Task<int>> runningTerminals,
             string alreadyRunningMessage,
             string propertyName,
-            Func<string, string, string, string, Task<int>> launchProcess
+            bool elevated
         )
         {
             if (!ValidateFolderPath(Path))
                 return;
 
+            // A terminal started for this folder by another instance of the app, or before it restarted,
+            // is brought to the front instead of starting a second one on the same LocalState.
+            if (RunningTerminals.Focus(Path, elevated))
+                return;
+
             if (runningTerminals.ContainsKey(Path))
             {
                 _messageBoxService.ShowMessage(alreadyRunningMessage, "Warning", DialogType.Warning);
@@ -336,33 +420,36 @@ namespace WTLayoutManager.ViewModels
             var key = _parentViewModel.SelectedTerminal?.DisplayName;
             if (key != null && _parentViewModel.TerminalDict?.TryGetValue(key, out var terminalInfo) == true)
             {
-                var fileName = BuildTerminalPath(terminalInfo);
-                var commandLine = BuildCommandLine(terminalInfo, fileName);
-                var envBlock = BuildEnvironmentBlock(terminalInfo);
-                var hookPath = _dstHookPath;
-
-                if (!File.Exists(fileName))
+                TerminalLaunchPlan plan;
+                try
+                {
+                    plan = GetLaunchPlan(terminalInfo, elevated);
+                }
+                catch (FileNotFoundException ex)
                 {
-                    _messageBoxService.ShowMessage($"File not found.\n{fileName}", "Error", DialogType.Error);
+                    _messageBoxService.ShowMessage(ex.Message, "Error", DialogType.Error);
                     return;
                 }
 
-                if (!File.Exists(hookPath))
+                if (!IsDefault)
                 {
-                    _messageBoxService.ShowMessage($"File not found.\n{hookPath}", "Error", DialogType.Error);
-                    return;
+                    // Windows Terminal rewrites its files in place; give it private copies of the shared ones.
+                    _snapshotStore.Detach(Path);
+                    RecordHistory(_filesToCopy);
                 }
 
-                Task<int> launchTask = launchProcess(
-                    fileName,
-                    commandLine,
-                    envBlock,
-                    hookPath
-                );
+                // Starting blocks until the terminal (or the elevated launcher) runs; its exit is awaited without a thread.
+                Task<int> launchTask = Task.Run(() => ProcessLauncher.Start(plan).Exited);
                 runningTerminals.Add(Path, launchTask);
                 OnPropertyChanged(propertyName);
 
+                // The ledger samples running terminals every two seconds; follow it at a lower rate.
+                while (await Task.WhenAny(launchTask, Task.Delay(ResourceRefreshInterval)) != launchTask)
+                {
+                    RefreshResourceUsage();
+                }
                 int exitCode = await launchTask;
+                RefreshResourceUsage();
                 runningTerminals.Remove(Path);
                 OnPropertyChanged(propertyName);
 
@@ -390,17 +477,12 @@ namespace WTLayoutManager.ViewModels
                     _runningTerminals,
                     "Terminal is already running for this local state.",
                     nameof(CanRunTerminal),
-                    (fileName, commandLine, envBlock, hookPath) => Task.Run(() => ProcessLauncher.LaunchProcess(
-                        fileName,
-                        commandLine,
-                        envBlock,
-                        hookPath
-                        )
-                    )
+                    false
                 );
             }
             catch (Exception ex)
             {
+                DropLaunchPlan(false);
                 _runningTerminals.Remove(Path);
                 OnPropertyChanged(nameof(CanRunTerminal));
                 _messageBoxService.ShowMessage($"Failed to run terminal.\n{ex.Message}", "Error", DialogType.Error);
@@ -425,35 +507,30 @@ namespace WTLayoutManager.ViewModels
                     _runningTerminalsAs,
                     "Terminal Admin is already running for this local state.",
                     nameof(CanRunTerminalAs),
-                    (fileName, commandLine, envBlock, hookPath) => Task.Run(() => ProcessLauncher.LaunchProcessElevated(
-                        System.IO.Path.Combine(AppDomain.CurrentDomain.BaseDirectory, "ElevatedLauncher.exe"),
-                        fileName,
-                        commandLine,
-                        envBlock,
-                        hookPath
-                        )
-                    )
+                    true
                 );
             }
             catch (Exception ex)
             {
+                DropLaunchPlan(true);
                 _runningTerminalsAs.Remove(Path);
                 OnPropertyChanged(nameof(CanRunTerminalAs));
                 _messageBoxService.ShowMessage($"Failed to run terminal.\n{ex.Message}", "Error", DialogType.Error);
             }
         }
 
-        private void ExecuteDuplicate(object? parameter) { ExecuteDuplicateEx(parameter, null); }
-
         /// <summary>
         /// Duplicates the folder at <see cref="Path"/> by copying all files to a new folder
         /// with the same parent directory and a new name, then adds the new folder to the
         /// parent's <see cref="MainViewModel.Folders"/> collection.
         /// Optionally uses the <paramref name="exFolderName"/> if provided.
         /// </summary>
-        /// <param name="parameter">Ignored.</param>
+        /// <remarks>
+        /// The files are copied on background threads, through the shared snapshot store: cloned or hard linked
+        /// to a stored read-only copy when possible, copied otherwise. A cancelled or failed copy leaves nothing behind.
+        /// </remarks>
         /// <param name="exFolderName">Optional folder name to use for the new folder.</param>
-        private void ExecuteDuplicateEx(object? parameter, string? exFolderName)
+        private async Task ExecuteDuplicateAsync(string? exFolderName)
         {
             if (!ValidateFolderPath(Path))
                 return;
@@ -486,8 +563,18 @@ namespace WTLayoutManager.ViewModels
 
                         string destinationPath = System.IO.Path.Combine(customBasePath, newFolderName);
 
-                        // 3) Copy everything
-                        DirectoryCopy(Path, destinationPath);
+                        // 3) Copy everything in the background
+                        var operation = FolderOperation.StartCopy(
+                            _snapshotStore,
+                            _trashPath,
+                            new[] { new KeyValuePair<string, string>(Path, destinationPath) },
+                            _filesToCopy,
+                            _parentViewModel.FolderOperationToken);
+                        var results = await _parentViewModel.RunFolderOperationAsync(operation);
+                        if (results.Count == 0 || results[0].Error is OperationCanceledException)
+                            return;
+                        if (results[0].Error is Exception copyError)
+                            throw copyError;
 
                         // 4) Create a new FolderModel / FolderViewModel for the copy
                         var newFolderModel = new FolderModel
@@ -525,6 +612,7 @@ namespace WTLayoutManager.ViewModels
 
                         // 5) Add it to the parent's Folders collection => new row in DataGrid
                         var newFolderViewModel = new FolderViewModel(newFolderModel, _parentViewModel, _messageBoxService);
+                        newFolderViewModel.RecordHistory(_filesToCopy);
                         _parentViewModel.Folders.Add(newFolderViewModel);
                     }
                 }
@@ -539,52 +627,19 @@ namespace WTLayoutManager.ViewModels
             }
         }
 
-        private static readonly HashSet<string> _filesToCopy = new(StringComparer.OrdinalIgnoreCase) { "settings.json", "state.json" };
-
-        /// <summary>
-        /// Recursively copies a directory and all its contents to another directory.
-        /// </summary>
-        /// <param name="sourceDir">The source directory to copy from.</param>
-        /// <param name="destDir">The destination directory to copy to.</param>
-        private void DirectoryCopy(string sourceDir, string destDir)
-        {
-            var dirInfo = new DirectoryInfo(sourceDir);
-            if (!dirInfo.Exists)
-            {
-                throw new DirectoryNotFoundException($"Source directory not found: {sourceDir}");
-            }
-
-            Directory.CreateDirectory(destDir);
-
-            // Copy files
-            //foreach (FileInfo file in dirInfo.GetFiles())
-            foreach (FileInfo file in dirInfo.EnumerateFiles())
-            {
-                if (!_filesToCopy.Contains(file.Name))
-                    continue;                       // skip everything else
-
-                string targetFilePath = System.IO.Path.Combine(destDir, file.Name);
-                file.CopyTo(targetFilePath, true);
-            }
-
-            // Recursively copy subdirectories
-            foreach (DirectoryInfo subDir in dirInfo.GetDirectories())
-            {
-                string newDest = System.IO.Path.Combine(destDir, subDir.Name);
-                DirectoryCopy(subDir.FullName, newDest);
-            }
-        }
+        private static readonly TimeSpan ResourceRefreshInterval = TimeSpan.FromSeconds(5);
 
+        private static readonly HashSet<string> _filesToCopy = new(StringComparer.OrdinalIgnoreCase) { "settings.json", "state.json" };
 
         /// <summary>
         /// Deletes a folder and all its contents from disk and from the parent view model's Folders collection.
         /// </summary>
         /// <remarks>
         /// If the folder is the default LocalState folder, it will not be deleted.
-        /// If the folder is locked (e.g. Terminal is running), an IOException or UnauthorizedAccessException will be thrown.
+        /// The folder is renamed into the trash and deleted on a background thread. If a file in it is locked
+        /// (e.g. Terminal is running), the rename fails and the folder is left as it was.
         /// </remarks>
-        /// <param name="parameter">Ignored.</param>
-        private void ExecuteDelete(object? parameter)
+        private async Task ExecuteDeleteAsync()
         {
             if (!ValidateFolderPath(Path))
                 return;
@@ -603,9 +658,13 @@ namespace WTLayoutManager.ViewModels
 
                 if (_messageBoxService.Confirm($"Are you sure you want to delete '{Name}'?"))
                 {
-                    // Attempt to delete from disk
-                    Directory.Delete(Path, true); // true => recursive
-                                                  // If it's locked, an IOException or UnauthorizedAccessException might be thrown
+                    // Delete from disk, including the read-only files shared with other copies
+                    var operation = FolderOperation.StartDelete(_snapshotStore, _trashPath, new[] { Path }, _parentViewModel.FolderOperationToken);
+                    var results = await _parentViewModel.RunFolderOperationAsync(operation);
+                    if (results.Count == 0)
+                        return;
+                    if (results[0].Error is Exception deleteError)
+                        throw deleteError; // If it's locked, an IOException is thrown
 
                     // Remove it from the parent's Folders collection
                     _parentViewModel.Folders.Remove(this);
@@ -623,6 +682,93 @@ namespace WTLayoutManager.ViewModels
         }
 
 
+        /// <summary>
+        /// Records the current content of some of the folder's JSON files in its version history.
+        /// </summary>
+        /// <remarks>
+        /// The history is best effort: a folder whose history cannot be written is still usable, it just cannot be undone.
+        /// The default LocalState folder belongs to Windows Terminal and has no history.
+        /// </remarks>
+        /// <param name="fileNames">The names of the files that may have changed.</param>
+        public void RecordHistory(IEnumerable<string> fileNames)
+        {
+            if (IsDefault || string.IsNullOrEmpty(Path) || !Directory.Exists(Path))
+                return;
+
+            try
+            {
+                using var history = new LayoutHistory(Path);
+                foreach (string fileName in fileNames)
+                {
+                    history.Record(fileName);
+                }
+            }
+            catch (IOException)
+            {
+                // best effort; see remarks
+            }
+        }
+
+        /// <summary>
+        /// Restores the most recently changed JSON file of the folder to its previous version.
+        /// </summary>
+        /// <remarks>
+        /// The restored version is recorded as a new version, so pressing undo again brings the change back.
+        /// Not allowed while a terminal runs on the folder, since it would overwrite the file on exit.
+        /// </remarks>
+        /// <param name="parameter">Ignored.</param>
+        private void ExecuteUndoLayoutChange(object? parameter)
+        {
+            if (!ValidateFolderPath(Path))
+                return;
+
+            if (!CanRunTerminal || !CanRunTerminalAs ||
+                RunningTerminals.IsRunning(Path, false) || RunningTerminals.IsRunning(Path, true))
+            {
+                _messageBoxService.ShowMessage("Close the terminal running on this folder first.", "Warning", DialogType.Warning);
+                return;
+            }
+
+            try
+            {
+                using var history = new LayoutHistory(Path);
+                if (!history.CanUndo)
+                {
+                    _messageBoxService.ShowMessage($"No earlier version of '{Name}' has been recorded.", "Information", DialogType.Information);
+                    return;
+                }
+
+                // The history rewrites the file; it must not write through a link shared with other copies.
+                _snapshotStore.Detach(Path);
+                history.Undo();
+            }
+            catch (Exception ex)
+            {
+                _messageBoxService.ShowMessage($"Failed to undo the last layout change.\n{ex.Message}", "Error", DialogType.Error);
+            }
+        }
+
+        /// <summary>
+        /// Pins the folder, so the retention budget never deletes it, or unpins it.
+        /// </summary>
+        /// <param name="parameter">Ignored.</param>
+        private void ExecuteTogglePin(object? parameter)
+        {
+            if (!ValidateFolderPath(Path) || IsDefault)
+                return;
+
+            try
+            {
+                LocalStateRetention.SetPinned(Path, !IsPinned);
+                IsPinned = !IsPinned;
+            }
+            catch (Exception ex)
+            {
+                _messageBoxService.ShowMessage($"Failed to change the pin of '{Name}'.\n{ex.Message}", "Error", DialogType.Error);
+            }
+        }
+
+
         /// <summary>
         /// Opens the folder in the file explorer using the folder path associated with this view model.
         /// </summary>
@@ -1,8 +1,10 @@
 ﻿using System.Collections.ObjectModel;
 using System.ComponentModel;
+using System.Diagnostics;
 using System.IO;
 using System.Windows.Data;
 using System.Windows.Input;
+using System.Windows.Threading;
 using WTLayoutManager.Models;
 using WTLayoutManager.Services;
 
@@ -18,25 +20,56 @@ namespace WTLayoutManager.ViewModels
     public class MainViewModel : BaseViewModel
     {
         private readonly ITerminalService _terminalService;
+        private readonly IFileDialogService _fileDialogService;
+        private string? _customBasePath;
+        private readonly List<FolderOperation> _folderOperations = new List<FolderOperation>();
+        private CancellationTokenSource _folderOperationCancellation = new CancellationTokenSource();
+        private double _folderOperationProgress;
         Dictionary<string, TerminalInfo>? _terminalDict;
         private string? _searchText;
         private TerminalListItem? _selectedTerminal;
+        private FolderScan? _folderScan;
+        private CancellationTokenSource? _folderScanCancellation;
+        private DispatcherTimer? _folderScanTimer;
+        private readonly List<int> _folderScanOrder = new List<int>();
+        private FolderWatch? _folderWatch;
+        private DispatcherTimer? _folderWatchTimer;
+        private readonly FolderSearchIndex _searchIndex = new FolderSearchIndex();
+        private readonly Dictionary<FolderViewModel, int> _searchIds = new Dictionary<FolderViewModel, int>();
+        private readonly Dictionary<int, FolderViewModel> _searchFolders = new Dictionary<int, FolderViewModel>();
+        private int _nextSearchId;
+        private Dictionary<FolderViewModel, int>? _searchRanks;
+        private bool _searchRefreshPending;
+
+        // Number of scanned folders turned into view-models per dispatcher tick
+        private const int FolderScanBatchSize = 32;
+
+        // How often a running copy or delete is polled for progress and finished folders
+        private static readonly TimeSpan FolderOperationPollInterval = TimeSpan.FromMilliseconds(50);
+
+        private const string ArchiveFilter = "WTLayoutManager archive (*.wtla)|*.wtla";
+
+        // We only care about these 3 possible files:
+        private static readonly string[] InterestingFiles = { "settings.json", "state.json", "elevated-state.json" };
 
         /// <summary>
         /// Initializes a new instance of the MainViewModel class.
         /// 
         /// This constructor loads installed terminals, creates a collection of FolderViewModels, 
-        /// and sets up commands for clearing search and reloading folders.
+        /// and sets up commands for clearing search, reloading, exporting and importing folders.
         /// 
         /// Parameters:
         ///     messageBoxService (IMessageBoxService): The message box service used for displaying messages.
+        ///     fileDialogService (IFileDialogService): The service asking for the archive to export to or import from.
         /// 
         /// Returns:
         ///     None
         /// </summary>
-        public MainViewModel(IMessageBoxService messageBoxService)
+        public MainViewModel(IMessageBoxService messageBoxService, IFileDialogService fileDialogService)
             : base(messageBoxService)
         {
+            _fileDialogService = fileDialogService;
+
             // Load installed terminals
             _terminalService = new TerminalService(_messageBoxService);
             Terminals = new ObservableCollection<TerminalListItem>(LoadInstalledTerminals());
@@ -53,6 +86,9 @@ namespace WTLayoutManager.ViewModels
             // LoadFolders();
             ClearSearchCommand = new RelayCommand(ExecuteClearSearchCommand);
             ReloadFoldersCommand = new RelayCommand(_ => LoadFolders());
+            ExportFoldersCommand = new RelayCommand(ExecuteExportFoldersCommand);
+            ImportFoldersCommand = new RelayCommand(ExecuteImportFoldersCommand);
+            CancelFolderOperationsCommand = new RelayCommand(ExecuteCancelFolderOperationsCommand);
         }
 
 
@@ -79,6 +115,7 @@ namespace WTLayoutManager.ViewModels
                     {
                         // Attach PropertyChanged event handler to the FolderViewModel instance
                         fvm.PropertyChanged += FolderViewModel_PropertyChanged;
+                        IndexFolder(fvm);
                     }
                 }
             }
@@ -93,10 +130,20 @@ namespace WTLayoutManager.ViewModels
                     {
                         // Detach PropertyChanged event handler from the FolderViewModel instance
                         fvm.PropertyChanged -= FolderViewModel_PropertyChanged;
+                        UnindexFolder(fvm);
                     }
                 }
             }
 
+            // Clear() reports a reset without the removed items
+            if (e.Action == System.Collections.Specialized.NotifyCollectionChangedAction.Reset)
+            {
+                _searchIndex.Clear();
+                _searchIds.Clear();
+                _searchFolders.Clear();
+            }
+            ScheduleSearchRefresh();
+
             // Update the TerminalsComboBoxEnabled property when folders change
             OnPropertyChanged(nameof(TerminalsComboBoxEnabled));
         }
@@ -121,6 +168,14 @@ namespace WTLayoutManager.ViewModels
             {
                 OnPropertyChanged(nameof(TerminalsComboBoxEnabled));
             }
+            else if (sender is FolderViewModel fvm &&
+                     (e.PropertyName == nameof(FolderViewModel.Name) ||
+                      e.PropertyName == nameof(FolderViewModel.Path) ||
+                      e.PropertyName == nameof(FolderViewModel.Files)))
+            {
+                IndexFolder(fvm);
+                ScheduleSearchRefresh();
+            }
         }
 
         // Property to disable the ComboBox if any folder is running a terminal.
@@ -161,6 +216,7 @@ namespace WTLayoutManager.ViewModels
                 {
                     _searchText = value;
                     OnPropertyChanged();
+                    UpdateSearchResults();
                     FoldersView.Refresh();
                 }
             }
@@ -168,6 +224,35 @@ namespace WTLayoutManager.ViewModels
 
         public ICommand ClearSearchCommand { get; }
         public ICommand ReloadFoldersCommand { get; }
+        public ICommand ExportFoldersCommand { get; }
+        public ICommand ImportFoldersCommand { get; }
+        public ICommand CancelFolderOperationsCommand { get; }
+
+        /// <summary>
+        /// Number of folder copies and deletes running in the background.
+        /// </summary>
+        public int FolderOperationCount => _folderOperations.Count;
+
+        /// <summary>
+        /// Percentage of the folders of the running copies and deletes that are done.
+        /// </summary>
+        public double FolderOperationProgress
+        {
+            get => _folderOperationProgress;
+            private set
+            {
+                if (_folderOperationProgress != value)
+                {
+                    _folderOperationProgress = value;
+                    OnPropertyChanged();
+                }
+            }
+        }
+
+        /// <summary>
+        /// Cancelled by <see cref="CancelFolderOperationsCommand"/>; pass it to the folder operations started.
+        /// </summary>
+        public CancellationToken FolderOperationToken => _folderOperationCancellation.Token;
 
         /// <summary>
         /// Clears the search text.
@@ -181,6 +266,135 @@ namespace WTLayoutManager.ViewModels
             SearchText = string.Empty;
         }
 
+        /// <summary>
+        /// Exports every listed folder of the selected terminal into a single archive file chosen by the user.
+        /// </summary>
+        /// <param name="parameter">Ignored parameter.</param>
+        /// <remarks>
+        /// Each folder is stored under its directory name, so the default folder is stored as "LocalState".
+        /// </remarks>
+        private void ExecuteExportFoldersCommand(object? parameter)
+        {
+            if (Folders.Count == 0)
+                return;
+
+            string? archivePath = _fileDialogService.AskSaveFile(ArchiveFilter, $"WTLayouts_{DateTime.Now:yyyyMMdd_HHmmss}.wtla");
+            if (archivePath == null)
+                return;
+
+            try
+            {
+                var folders = Folders
+                    .Where(folder => !string.IsNullOrEmpty(folder.Path))
+                    .Select(folder => new KeyValuePair<string, string>(Path.GetFileName(folder.Path!), folder.Path!));
+                LayoutArchive.Export(archivePath, folders);
+            }
+            catch (Exception ex)
+            {
+                _messageBoxService.ShowMessage($"Failed to export folders.\n{ex.Message}", "Error", DialogType.Error);
+            }
+        }
+
+        /// <summary>
+        /// Imports the folders of an archive file chosen by the user as new LocalState copies of the selected terminal.
+        /// </summary>
+        /// <param name="parameter">Ignored parameter.</param>
+        /// <remarks>
+        /// A folder whose name is already taken gets a numeric suffix. The folder watcher adds the imported
+        /// folders to the list; the list is reloaded when the base folder had to be created first.
+        /// </remarks>
+        private void ExecuteImportFoldersCommand(object? parameter)
+        {
+            if (_customBasePath == null)
+                return;
+
+            string? archivePath = _fileDialogService.AskOpenFile(ArchiveFilter);
+            if (archivePath == null)
+                return;
+
+            bool reload = !Directory.Exists(_customBasePath);
+            try
+            {
+                using var archive = new LayoutArchive(archivePath);
+                for (int i = 0; i < archive.FolderNames.Count; i++)
+                {
+                    string name = archive.FolderNames[i];
+                    string target = Path.Combine(_customBasePath, name);
+                    for (int suffix = 2; Directory.Exists(target); suffix++)
+                    {
+                        target = Path.Combine(_customBasePath, $"{name}_{suffix}");
+                    }
+                    archive.Extract(i, target);
+                }
+            }
+            catch (Exception ex)
+            {
+                _messageBoxService.ShowMessage($"Failed to import folders.\n{ex.Message}", "Error", DialogType.Error);
+            }
+
+            if (reload)
+                LoadFolders();
+        }
+
+        /// <summary>
+        /// Waits for a background folder copy or delete without blocking the UI thread, showing its progress.
+        /// </summary>
+        /// <param name="operation">The started operation; it is disposed when it completes.</param>
+        /// <returns>The result of every folder that finished. Folders cancelled before they started have none.</returns>
+        public async Task<List<FolderOperationResult>> RunFolderOperationAsync(FolderOperation operation)
+        {
+            var results = new List<FolderOperationResult>();
+            _folderOperations.Add(operation);
+            OnPropertyChanged(nameof(FolderOperationCount));
+            try
+            {
+                while (true)
+                {
+                    results.AddRange(operation.Drain(int.MaxValue));
+                    UpdateFolderOperationProgress();
+                    if (operation.IsCompleted)
+                        break;
+                    await Task.Delay(FolderOperationPollInterval);
+                }
+            }
+            finally
+            {
+                _folderOperations.Remove(operation);
+                operation.Dispose();
+                UpdateFolderOperationProgress();
+                OnPropertyChanged(nameof(FolderOperationCount));
+            }
+            return results;
+        }
+
+        /// <summary>
+        /// Recomputes <see cref="FolderOperationProgress"/> over every running operation.
+        /// </summary>
+        private void UpdateFolderOperationProgress()
+        {
+            long total = 0;
+            long done = 0;
+            foreach (var operation in _folderOperations)
+            {
+                var progress = operation.Progress;
+                total += progress.FoldersTotal;
+                done += progress.FoldersDone;
+            }
+            FolderOperationProgress = total == 0 ? 0 : 100.0 * done / total;
+        }
+
+        /// <summary>
+        /// Cancels the running folder copies and deletes. Folders already copied or deleted stay so.
+        /// </summary>
+        /// <param name="parameter">Ignored parameter.</param>
+        private void ExecuteCancelFolderOperationsCommand(object? parameter)
+        {
+            var cancellation = _folderOperationCancellation;
+            _folderOperationCancellation = new CancellationTokenSource();
+            cancellation.Cancel();
+            cancellation.Dispose();
+        }
+
 
         public Dictionary<string, TerminalInfo>? TerminalDict { get => _terminalDict; set => _terminalDict = value; }
 
@@ -188,7 +402,8 @@ namespace WTLayoutManager.ViewModels
         /// Filters a collection of folders based on a search text.
         /// 
         /// This function checks if the search text is null or whitespace, and if so, returns true.
-        /// Otherwise, it checks if the item is a FolderViewModel and if its name contains the search text.
+        /// Otherwise, it checks if the item is a FolderViewModel that matched the search text in the native search index,
+        /// which covers folder names, tab titles, profile names, command lines and starting directories.
         /// 
         /// Parameters:
         ///     item (object): The item to filter, expected to be a FolderViewModel.
@@ -199,16 +414,122 @@ namespace WTLayoutManager.ViewModels
         private bool FilterFolders(object item)
         {
             if (string.IsNullOrWhiteSpace(SearchText)) return true;
-            if (item is FolderViewModel fvm)
+            return item is FolderViewModel fvm && _searchRanks != null && _searchRanks.ContainsKey(fvm);
+        }
+
+        /// <summary>
+        /// Runs the search text against the search index and orders the view by rank while a search is active.
+        /// </summary>
+        private void UpdateSearchResults()
+        {
+            bool wasSearching = _searchRanks != null;
+            if (string.IsNullOrWhiteSpace(SearchText))
+            {
+                _searchRanks = null;
+            }
+            else
             {
-                if (fvm.Name != null)
+                var ids = _searchIndex.Query(SearchText);
+                _searchRanks = new Dictionary<FolderViewModel, int>(ids.Count);
+                for (int rank = 0; rank < ids.Count; rank++)
                 {
-                    return fvm.Name
-                              .ToLowerInvariant()
-                              .Contains(SearchText.ToLowerInvariant());
+                    if (_searchFolders.TryGetValue(ids[rank], out var folder))
+                        _searchRanks[folder] = rank;
+                }
+            }
+
+            // Setting CustomSort refreshes the view, so only do it when searching starts or stops
+            if (FoldersView is ListCollectionView view && wasSearching != (_searchRanks != null))
+            {
+                view.CustomSort = _searchRanks == null
+                    ? null
+                    : Comparer<object>.Create((a, b) => SearchRank(a).CompareTo(SearchRank(b)));
+            }
+        }
+
+        /// <summary>
+        /// Returns the rank of a folder in the current search results; unranked items sort last.
+        /// </summary>
+        private int SearchRank(object item)
+        {
+            return item is FolderViewModel fvm && _searchRanks != null && _searchRanks.TryGetValue(fvm, out int rank)
+                ? rank
+                : int.MaxValue;
+        }
+
+        /// <summary>
+        /// Re-runs the active search once the current batch of folder changes has been processed.
+        /// </summary>
+        private void ScheduleSearchRefresh()
+        {
+            if (_searchRanks == null || _searchRefreshPending)
+                return;
+
+            _searchRefreshPending = true;
+            Dispatcher.CurrentDispatcher.BeginInvoke(DispatcherPriority.Background, new Action(() =>
+            {
+                _searchRefreshPending = false;
+                UpdateSearchResults();
+                FoldersView.Refresh();
+            }));
+        }
+
+        /// <summary>
+        /// Adds a folder to the search index, or re-indexes it after its name or files changed.
+        /// </summary>
+        /// <param name="folder">The folder view-model.</param>
+        private void IndexFolder(FolderViewModel folder)
+        {
+            if (!_searchIds.TryGetValue(folder, out int id))
+            {
+                id = _nextSearchId++;
+                _searchIds[folder] = id;
+                _searchFolders[id] = folder;
+            }
+            _searchIndex.Upsert(id, GetSearchTexts(folder));
+        }
+
+        /// <summary>
+        /// Removes a folder from the search index.
+        /// </summary>
+        /// <param name="folder">The folder view-model.</param>
+        private void UnindexFolder(FolderViewModel folder)
+        {
+            if (_searchIds.Remove(folder, out int id))
+            {
+                _searchFolders.Remove(id);
+                _searchIndex.Remove(id);
+            }
+        }
+
+        /// <summary>
+        /// Collects the searchable text of a folder: its name and, from its saved layouts, the tab titles and
+        /// the profile name, command line and starting directory of every pane.
+        /// </summary>
+        /// <param name="folder">The folder view-model.</param>
+        /// <returns>The pieces of text with the field they come from.</returns>
+        private static IEnumerable<KeyValuePair<FolderSearchField, string>> GetSearchTexts(FolderViewModel folder)
+        {
+            yield return new(FolderSearchField.FolderName, folder.Name ?? string.Empty);
+            if (folder.Files == null)
+                yield break;
+
+            foreach (var file in folder.Files)
+            {
+                if (file.TabStates == null)
+                    continue;
+
+                foreach (var tab in file.TabStates.TabStates)
+                {
+                    yield return new(FolderSearchField.TabTitle, tab.TabTitle ?? string.Empty);
+                    foreach (var pane in tab.Panes)
+                    {
+                        yield return new(FolderSearchField.ProfileName, pane.ProfileName ?? string.Empty);
+                        yield return new(FolderSearchField.StartingDirectory, pane.StartingDirectory ?? string.Empty);
+                        yield return new(FolderSearchField.Commandline, pane.Commandline ?? string.Empty);
+                    }
                 }
             }
-            return false;
         }
 
         /// <summary>
@@ -223,7 +544,9 @@ namespace WTLayoutManager.ViewModels
         /// </summary>
         private void LoadFolders()
         {
-            // 1) Clear existing folder view-models
+            // 1) Stop streaming folders of the previous selection and clear existing folder view-models
+            StopFolderScan();
+            StopFolderWatch();
             Folders.Clear();
 
             // 2) Guard clauses: if dictionary or selection is null, do nothing
@@ -253,6 +576,10 @@ namespace WTLayoutManager.ViewModels
         /// 
         /// This function clears any existing items from the Folders collection before re-populating it with the default and custom folders.
         /// 
+        /// The folder models are built on the native scanner threads and streamed into Folders as they complete,
+        /// so the UI thread never parses JSON. Switching terminals cancels the scan of the previous one.
+        /// Afterwards the folders are watched, so snapshots added, removed or rewritten on disk are applied one folder at a time.
+        /// 
         /// Parameters:
         ///     info (TerminalInfo): The terminal information used to determine the folder paths.
         /// 
@@ -262,8 +589,13 @@ namespace WTLayoutManager.ViewModels
         private void LoadFoldersForTerminal(TerminalInfo info)
         {
             // Clear any existing items from Folders before re-populating
+            StopFolderScan();
+            StopFolderWatch();
             Folders.Clear();
 
+            // Icon files on disk may have changed since the last load
+            ProfileIcons.Reset();
+
             // 1) Default LocalState folder path
             //    Example: %LOCALAPPDATA%\Packages\<familyName>\LocalState
             string defaultFolderPath = Path.Combine(
@@ -272,14 +604,15 @@ namespace WTLayoutManager.ViewModels
                 info.FamilyName,
                 "LocalState");
 
-            // Create a FolderModel for the default folder
-            var defaultFolderModel = CreateFolderModel(
-                folderPath: defaultFolderPath,
-                folderName: "LocalState (Default)", // or just "LocalState"
-                isDefault: true);
-
-            // Convert the FolderModel into FolderViewModel and add to Folders collection
-            Folders.Add(new FolderViewModel(defaultFolderModel, this, _messageBoxService));
+            var scanFolders = new List<ScannedFolder>
+            {
+                new ScannedFolder
+                {
+                    Path = defaultFolderPath,
+                    Name = "LocalState (Default)", // or just "LocalState"
+                    IsDefault = true
+                }
+            };
 
             // 2) Virtual/“custom” LocalState folders
             //    Located under: %LOCALAPPDATA%\WTLayoutManager\<familyName>
@@ -288,28 +621,206 @@ namespace WTLayoutManager.ViewModels
                 Environment.GetFolderPath(Environment.SpecialFolder.LocalApplicationData),
                 "WTLayoutManager",
                 info.FamilyName);
+            _customBasePath = customBasePath;
 
-            if (Directory.Exists(customBasePath))
+            // For each subfolder, treat it as a "LocalState" copy (none if the base folder does not exist)
+            foreach (string subDir in FolderScan.EnumerateSubfolders(customBasePath))
             {
-                // For each subfolder, treat it as a "LocalState" copy
-                foreach (string subDir in Directory.GetDirectories(customBasePath))
+                // We'll use the subfolder name for display, or you might store a separate metadata file
+                scanFolders.Add(new ScannedFolder
                 {
-                    // We'll use the subfolder name for display, or you might store a separate metadata file
-                    string folderName = Path.GetFileName(subDir);
+                    Path = subDir,
+                    Name = Path.GetFileName(subDir),
+                    IsDefault = false
+                });
+            }
+
+            // 3) Build the folder models on the native scanner threads and add them as they complete,
+            //    so the window stays responsive with hundreds of snapshots.
+            _folderScanCancellation = new CancellationTokenSource();
+            _folderScan = FolderScan.Start(
+                scanFolders,
+                folder => CreateFolderModel(folder.Path, folder.Name, folder.IsDefault),
+                _folderScanCancellation.Token);
 
-                    var customFolderModel = CreateFolderModel(
-                        folderPath: subDir,
-                        folderName: folderName,
-                        isDefault: false);
+            _folderScanTimer = new DispatcherTimer(DispatcherPriority.Background)
+            {
+                Interval = TimeSpan.FromMilliseconds(30)
+            };
+            _folderScanTimer.Tick += (_, _) => DrainFolderScan();
+            _folderScanTimer.Start();
+
+            // 4) Keep the list current while Windows Terminal or the user changes the folders on disk
+            _folderWatch = FolderWatch.Start(defaultFolderPath, customBasePath);
+            _folderWatchTimer = new DispatcherTimer(DispatcherPriority.Background)
+            {
+                Interval = TimeSpan.FromMilliseconds(250)
+            };
+            _folderWatchTimer.Tick += (_, _) => DrainFolderWatch();
+            _folderWatchTimer.Start();
+        }
+
+        /// <summary>
+        /// Adds the folders finished by the running scan to the Folders collection.
+        /// 
+        /// Folders complete out of order; each one is inserted at the position it had in the scan list,
+        /// so the collection ends up in the same order as a sequential load. The scan is stopped once
+        /// every folder has been added.
+        /// </summary>
+        private void DrainFolderScan()
+        {
+            if (_folderScan == null)
+                return;
 
-                    // Add
-                    Folders.Add(new FolderViewModel(customFolderModel, this, _messageBoxService));
+            foreach (var result in _folderScan.Drain(FolderScanBatchSize))
+            {
+                if (result.Error != null || result.Value is not FolderModel folderModel)
+                {
+                    _messageBoxService.ShowMessage($"Failed to load folder.\n{result.Folder.Path}\n{result.Error?.Message}", "Error", DialogType.Error);
+                    continue;
                 }
+
+                int position = _folderScanOrder.BinarySearch(result.Folder.Index);
+                position = position < 0 ? ~position : position;
+                _folderScanOrder.Insert(position, result.Folder.Index);
+                Folders.Insert(Math.Min(position, Folders.Count), new FolderViewModel(folderModel, this, _messageBoxService));
             }
 
-            // Done. Now Folders contains the default folder + any custom copies.
-            // The DataGrid or whatever UI is bound to FoldersView (GetDefaultView(Folders)) 
-            // and should refresh automatically.
+            if (_folderScan.IsCompleted)
+            {
+                StopFolderScan();
+                if (_customBasePath != null)
+                    _ = PruneFoldersAsync(_customBasePath);
+            }
+        }
+
+        /// <summary>
+        /// Cancels the running folder scan, if any, and waits for folders that are already being parsed.
+        /// </summary>
+        private void StopFolderScan()
+        {
+            _folderScanTimer?.Stop();
+            _folderScanTimer = null;
+
+            _folderScanCancellation?.Cancel();
+            _folderScan?.Dispose();
+            _folderScan = null;
+            _folderScanCancellation?.Dispose();
+            _folderScanCancellation = null;
+
+            _folderScanOrder.Clear();
+        }
+
+        /// <summary>
+        /// Deletes the least recently run copies that exceed the retention budget saved next to them.
+        /// </summary>
+        /// <remarks>
+        /// Nothing happens unless a budget was saved (e.g. with LayoutCli prune --save). The plan is computed on
+        /// native threads and the evicted copies go through the same background delete as the Delete button;
+        /// pinned copies and copies a terminal runs are kept. A copy that cannot be deleted stays listed and is
+        /// tried again at the next load.
+        /// </remarks>
+        /// <param name="customBasePath">The folder holding the copies of the current terminal.</param>
+        private async Task PruneFoldersAsync(string customBasePath)
+        {
+            try
+            {
+                var budget = RetentionBudget.Load(customBasePath);
+                if (!budget.IsLimited)
+                    return;
+
+                var plan = await Task.Run(() => LocalStateRetention.Plan(customBasePath, budget));
+                if (plan.Evicted.Count == 0 || customBasePath != _customBasePath)
+                    return;
+
+                var operation = FolderOperation.StartDelete(FolderViewModel.SnapshotStore, FolderViewModel.TrashPath, plan.Evicted, FolderOperationToken);
+                foreach (var result in await RunFolderOperationAsync(operation))
+                {
+                    if (result.Error == null && FindFolder(result.Path) is FolderViewModel folderViewModel)
+                        Folders.Remove(folderViewModel);
+                }
+            }
+            catch (Exception ex)
+            {
+                _messageBoxService.ShowMessage($"Failed to prune old folders.\n{ex.Message}", "Error", DialogType.Error);
+            }
+        }
+
+        /// <summary>
+        /// Applies the folder changes reported by the watcher since the last tick.
+        /// 
+        /// Deltas are held back while the initial scan is still streaming folders in; they stay queued in
+        /// the watcher and are applied once the scan has finished. A Rescan delta (notifications were lost)
+        /// reloads the whole list.
+        /// </summary>
+        private void DrainFolderWatch()
+        {
+            if (_folderWatch == null || _folderScan != null)
+                return;
+
+            foreach (var delta in _folderWatch.Drain())
+            {
+                if (delta.Kind == FolderDeltaKind.Rescan)
+                {
+                    LoadFolders();
+                    return;
+                }
+
+                var folderViewModel = FindFolder(delta.FolderPath);
+                if (delta.Kind == FolderDeltaKind.Removed)
+                {
+                    if (folderViewModel != null)
+                        Folders.Remove(folderViewModel);
+                    continue;
+                }
+
+                try
+                {
+                    if (folderViewModel == null)
+                    {
+                        if (Directory.Exists(delta.FolderPath))
+                            Folders.Add(new FolderViewModel(CreateFolderModel(delta.FolderPath, Path.GetFileName(delta.FolderPath), false), this, _messageBoxService));
+                    }
+                    else if (delta.Kind == FolderDeltaKind.Changed)
+                    {
+                        folderViewModel.Refresh(UpdateFolderModel(folderViewModel, delta.ChangedFiles));
+                        folderViewModel.RecordHistory(delta.ChangedFiles);
+                    }
+                    else
+                    {
+                        folderViewModel.Refresh(CreateFolderModel(delta.FolderPath, folderViewModel.Name!, folderViewModel.IsDefault));
+                    }
+                }
+                catch (Exception ex)
+                {
+                    // The previous contents stay listed; the next write to the folder retries.
+                    _messageBoxService.ShowMessage($"Failed to refresh folder.\n{delta.FolderPath}\n{ex.Message}", "Error", DialogType.Error);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Stops watching the folders of the current terminal.
+        /// </summary>
+        private void StopFolderWatch()
+        {
+            _folderWatchTimer?.Stop();
+            _folderWatchTimer = null;
+
+            _folderWatch?.Dispose();
+            _folderWatch = null;
+        }
+
+        /// <summary>
+        /// Finds the view-model of a folder by path, ignoring case and trailing separators.
+        /// </summary>
+        /// <param name="folderPath">The folder path reported by the watcher.</param>
+        /// <returns>The view-model, or null if the folder is not listed.</returns>
+        private FolderViewModel? FindFolder(string folderPath)
+        {
+            string wanted = Path.TrimEndingDirectorySeparator(folderPath);
+            return Folders.FirstOrDefault(f => f.Path != null &&
+                string.Equals(Path.TrimEndingDirectorySeparator(f.Path), wanted, StringComparison.OrdinalIgnoreCase));
         }
 
         /// <summary>
@@ -343,6 +854,9 @@ namespace WTLayoutManager.ViewModels
         /// The function also attempts to parse profile information and state data from the files, 
         /// and assigns the last modified time of the state.json file as the FolderModel's LastRun time if applicable.
         /// 
+        /// If the folder's binary sidecar cache still matches all three files, the FileModels are rebuilt from it
+        /// without parsing any JSON; otherwise the files are parsed and the cache is rewritten.
+        /// 
         /// Parameters:
         ///     folderPath (string): The path to the folder.
         ///     folderName (string): The name of the folder.
@@ -352,45 +866,56 @@ namespace WTLayoutManager.ViewModels
         ///     FolderModel: An instance of FolderModel representing the specified folder.
         /// </summary>
         private FolderModel CreateFolderModel(string folderPath, string folderName, bool isDefault)
+        {
+            long started = Stopwatch.GetTimestamp();
+            try
+            {
+                return LoadFolderModel(folderPath, folderName, isDefault);
+            }
+            finally
+            {
+                MetricsPublisher.Record(RuntimeHistogram.FolderLoad, Stopwatch.GetElapsedTime(started));
+            }
+        }
+
+        /// <summary>
+        /// Builds the model of a folder from its sidecar cache or its files; see <see cref="CreateFolderModel"/>.
+        /// </summary>
+        private FolderModel LoadFolderModel(string folderPath, string folderName, bool isDefault)
         {
             var model = new FolderModel
             {
                 Name = folderName,
                 Path = folderPath,
                 IsDefault = isDefault,
+                IsPinned = !isDefault && LocalStateRetention.IsPinned(folderPath),
                 Files = new List<FileModel>() // we’ll populate below
             };
 
-            // We only care about these 3 possible files:
-            var interestingFiles = new[] { "settings.json", "state.json", "elevated-state.json" };
+            // Warm path: the sidecar cache still matches every source file, so skip JSON entirely.
+            var cachedFiles = FolderLayoutCache.TryLoad(folderPath);
+            if (cachedFiles != null)
+            {
+                model.Files = cachedFiles;
+                model.LastRun = cachedFiles.FirstOrDefault(f => f.FileName == "state.json")?.LastModified;
+                return model;
+            }
+
+            // Capture the source keys before parsing, so the cache never describes newer contents.
+            var cacheSnapshot = FolderLayoutCache.Capture(folderPath);
 
             // Populate the list of FileModel if files exist
             var mapProfilesToIcons = new Dictionary<string, string>();
-            foreach (string fileName in interestingFiles)
+            foreach (string fileName in InterestingFiles)
             {
                 string fullPath = Path.Combine(folderPath, fileName);
                 if (File.Exists(fullPath))
                 {
-                    var fi = new FileInfo(fullPath);
-                    var tooltipProfiles = new ObservableCollection<ProfileInfo>(SettingsJsonParser.GetProfileInfos(fullPath));
-                    if (mapProfilesToIcons.Count == 0)
-                        mapProfilesToIcons = MapProfilesToIcons(tooltipProfiles);
-                    var stateTooltipVm = StateJsonParser.ParseState(fullPath, mapProfilesToIcons);
-                    var tooltipVm = new SettingsJsonTooltipViewModel
-                    {
-                        Profiles = tooltipProfiles
-                    };
-                    model.Files.Add(new FileModel
-                    {
-                        FileName = fi.Name,
-                        LastModified = fi.LastWriteTime,
-                        Size = fi.Length,
-                        Profiles = tooltipVm,
-                        TabStates = stateTooltipVm
-                    });
+                    var file = CreateFileModel(fullPath, ref mapProfilesToIcons);
+                    model.Files.Add(file);
                     if (model.LastRun == null && fileName == "state.json")
                     {
-                        model.LastRun = fi.LastWriteTime;
+                        model.LastRun = file.LastModified;
                     }
                 }
             }
@@ -398,9 +923,95 @@ namespace WTLayoutManager.ViewModels
             // Optionally, fill model.LastRun if you have logic to track that
             // model.LastRun = ...
 
+            FolderLayoutCache.Save(cacheSnapshot, model.Files);
+
             return model;
         }
 
+        /// <summary>
+        /// Rebuilds the model of a listed folder after some of its files changed on disk.
+        /// 
+        /// Only the changed files are parsed again; the FileModels of the other files are reused. When
+        /// settings.json changed every file is parsed again, because the tab icons in the state files
+        /// are resolved through the profiles of settings.json. The sidecar cache is rewritten.
+        /// </summary>
+        /// <param name="folder">The folder as currently listed.</param>
+        /// <param name="changedFiles">Names of the files the watcher saw change.</param>
+        /// <returns>The updated folder model.</returns>
+        private FolderModel UpdateFolderModel(FolderViewModel folder, IReadOnlyCollection<string> changedFiles)
+        {
+            var model = new FolderModel
+            {
+                Name = folder.Name,
+                Path = folder.Path,
+                IsDefault = folder.IsDefault,
+                Files = new List<FileModel>()
+            };
+
+            var cacheSnapshot = FolderLayoutCache.Capture(folder.Path!);
+            bool reparseAll = changedFiles.Contains("settings.json") || folder.Files == null;
+
+            var mapProfilesToIcons = new Dictionary<string, string>();
+            foreach (string fileName in InterestingFiles)
+            {
+                string fullPath = Path.Combine(folder.Path!, fileName);
+                if (!File.Exists(fullPath))
+                    continue;
+
+                var previous = reparseAll || changedFiles.Contains(fileName)
+                    ? null
+                    : folder.Files!.FirstOrDefault(f => f.FileName == fileName);
+                FileModel file;
+                if (previous?.Profiles != null)
+                {
+                    file = previous;
+                    if (mapProfilesToIcons.Count == 0)
+                        mapProfilesToIcons = MapProfilesToIcons(previous.Profiles.Profiles);
+                }
+                else
+                {
+                    file = CreateFileModel(fullPath, ref mapProfilesToIcons);
+                }
+
+                model.Files.Add(file);
+                if (model.LastRun == null && fileName == "state.json")
+                {
+                    model.LastRun = file.LastModified;
+                }
+            }
+
+            FolderLayoutCache.Save(cacheSnapshot, model.Files);
+
+            return model;
+        }
+
+        /// <summary>
+        /// Parses one of the JSON files of a LocalState folder.
+        /// </summary>
+        /// <param name="fullPath">Path of settings.json, state.json or elevated-state.json.</param>
+        /// <param name="mapProfilesToIcons">Profile icons of the folder; filled from the first file that lists profiles.</param>
+        /// <returns>The file model with its profiles and tab states.</returns>
+        private static FileModel CreateFileModel(string fullPath, ref Dictionary<string, string> mapProfilesToIcons)
+        {
+            var fi = new FileInfo(fullPath);
+            var tooltipProfiles = new ObservableCollection<ProfileInfo>(SettingsJsonParser.GetProfileInfos(fullPath));
+            if (mapProfilesToIcons.Count == 0)
+                mapProfilesToIcons = MapProfilesToIcons(tooltipProfiles);
+            var stateTooltipVm = StateJsonParser.ParseState(fullPath, mapProfilesToIcons);
+            var tooltipVm = new SettingsJsonTooltipViewModel
+            {
+                Profiles = tooltipProfiles
+            };
+            return new FileModel
+            {
+                FileName = fi.Name,
+                LastModified = fi.LastWriteTime,
+                Size = fi.Length,
+                Profiles = tooltipVm,
+                TabStates = stateTooltipVm
+            };
+        }
+
         /// <summary>
         /// Collapses all FolderViewModels in the Folders collection except for the specified keepOpen instance.
         /// </summary>
@@ -448,6 +1059,8 @@ namespace WTLayoutManager.ViewModels
         private IEnumerable<TerminalListItem> LoadInstalledTerminals()
         {
             _terminalDict = _terminalService.FindAllTerminals();
+            // A package may have been updated or removed; launch plans probe it again.
+            TerminalLaunchPlan.InvalidateAll();
             if (_terminalDict != null)
             {
                 return _terminalDict.Select(kvp => new TerminalListItem
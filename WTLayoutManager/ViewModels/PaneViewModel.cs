@@ -4,6 +4,9 @@
     {
         public string? ProfileName { get; set; }
         public string? Icon { get; set; }
+        // Command line and starting directory the pane was restored with, if any
+        public string? Commandline { get; set; }
+        public string? StartingDirectory { get; set; }
         // Geometry in normalized coordinates
         public double X { get; set; }      // Left position
         public double Y { get; set; }      // Top position
@@ -0,0 +1,135 @@
+﻿#include "pch.h"
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include <cstring>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ull;
+	constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4Full;
+	constexpr uint64_t Prime3 = 0x165667B19E3779F9ull;
+	constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ull;
+	constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ull;
+
+	inline uint64_t Rotl(uint64_t v, int r) noexcept
+	{
+		return (v << r) | (v >> (64 - r));
+	}
+
+	inline uint64_t Read64(const uint8_t* p) noexcept
+	{
+		uint64_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	inline uint32_t Read32(const uint8_t* p) noexcept
+	{
+		uint32_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	inline uint64_t Round(uint64_t acc, uint64_t input) noexcept
+	{
+		acc += input * Prime2;
+		acc = Rotl(acc, 31);
+		return acc * Prime1;
+	}
+
+	inline uint64_t MergeRound(uint64_t acc, uint64_t val) noexcept
+	{
+		acc ^= Round(0, val);
+		return acc * Prime1 + Prime4;
+	}
+}
+
+/**
+ * Computes the XXH64 hash of a memory block.
+ *
+ * @param data The bytes to hash.
+ * @param size Number of bytes.
+ * @param seed Hash seed.
+ * @return The 64-bit hash.
+ */
+uint64_t ContentHash::Hash64(const void* data, size_t size, uint64_t seed) noexcept
+{
+	const uint8_t* p = static_cast<const uint8_t*>(data);
+	const uint8_t* const end = p + size;
+	uint64_t h;
+
+	if (size >= 32)
+	{
+		uint64_t v1 = seed + Prime1 + Prime2;
+		uint64_t v2 = seed + Prime2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - Prime1;
+		const uint8_t* const limit = end - 32;
+		do
+		{
+			v1 = Round(v1, Read64(p));
+			v2 = Round(v2, Read64(p + 8));
+			v3 = Round(v3, Read64(p + 16));
+			v4 = Round(v4, Read64(p + 24));
+			p += 32;
+		} while (p <= limit);
+
+		h = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+		h = MergeRound(h, v1);
+		h = MergeRound(h, v2);
+		h = MergeRound(h, v3);
+		h = MergeRound(h, v4);
+	}
+	else
+	{
+		h = seed + Prime5;
+	}
+
+	h += static_cast<uint64_t>(size);
+
+	while (p + 8 <= end)
+	{
+		h ^= Round(0, Read64(p));
+		h = Rotl(h, 27) * Prime1 + Prime4;
+		p += 8;
+	}
+	if (p + 4 <= end)
+	{
+		h ^= static_cast<uint64_t>(Read32(p)) * Prime1;
+		h = Rotl(h, 23) * Prime2 + Prime3;
+		p += 4;
+	}
+	while (p < end)
+	{
+		h ^= static_cast<uint64_t>(*p) * Prime5;
+		h = Rotl(h, 11) * Prime1;
+		++p;
+	}
+
+	h ^= h >> 33;
+	h *= Prime2;
+	h ^= h >> 29;
+	h *= Prime3;
+	h ^= h >> 32;
+	return h;
+}
+
+/**
+ * Computes the XXH64 hash of a file by mapping it into memory.
+ *
+ * @param path The file to hash.
+ * @param hash Receives the hash of the file contents.
+ * @return false if the file could not be opened or mapped.
+ */
+bool ContentHash::HashFile(const std::filesystem::path& path, uint64_t& hash) noexcept
+{
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		return false;
+	}
+	hash = Hash64(file.data(), file.size());
+	return true;
+}
@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// Fast non-cryptographic content hashing (XXH64).
+		/// </summary>
+		/// <remarks>
+		/// Used to detect whether a settings / state file really changed when its size or timestamp
+		/// alone is not conclusive, e.g. after a snapshot was copied and got a new modification time.
+		/// </remarks>
+		class ContentHash
+		{
+		public:
+			/// <summary>
+			/// Computes the 64-bit XXH64 hash of a memory block.
+			/// </summary>
+			/// <param name="data">The bytes to hash; may be null when size is 0.</param>
+			/// <param name="size">Number of bytes.</param>
+			/// <param name="seed">Optional seed.</param>
+			WINAPIHELPERS_API static uint64_t Hash64(const void* data, size_t size, uint64_t seed = 0) noexcept;
+
+			/// <summary>
+			/// Computes the XXH64 hash of a file's contents.
+			/// </summary>
+			/// <param name="path">The file to hash.</param>
+			/// <param name="hash">Receives the hash.</param>
+			/// <returns>false if the file could not be read.</returns>
+			WINAPIHELPERS_API static bool HashFile(const std::filesystem::path& path, uint64_t& hash) noexcept;
+		};
+
+	}
+} // namespace WTLayoutManager::Services
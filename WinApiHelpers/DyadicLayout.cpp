@@ -0,0 +1,312 @@
+﻿#include "pch.h"
+#include "DyadicLayout.h"
+#include <cmath>
+#include <memory>
+#include <utility>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	/// One pane edge on a single axis; tag = pane index * 2 + (1 for the far edge).
+	struct Edge
+	{
+		uint64_t value;
+		uint32_t tag;
+	};
+
+	/// Below this many edges a straight insertion sort beats the radix passes.
+	constexpr size_t RadixThreshold = 64;
+
+	/**
+	 * Sorts a small number of edges in place by value.
+	 *
+	 * @param edges The edges to sort.
+	 * @param count Number of edges.
+	 */
+	void InsertionSort(Edge* edges, size_t count) noexcept
+	{
+		for (size_t i = 1; i < count; ++i)
+		{
+			Edge e = edges[i];
+			size_t j = i;
+			while (j > 0 && edges[j - 1].value > e.value)
+			{
+				edges[j] = edges[j - 1];
+				--j;
+			}
+			edges[j] = e;
+		}
+	}
+
+	/**
+	 * LSD radix sort of the edges by value, one byte per pass.
+	 *
+	 * All eight histograms are gathered in a single read of the input, and passes whose byte is
+	 * identical for every edge are skipped. Dyadic coordinates of realistic layouts only use a few
+	 * high bits, so most passes are skipped.
+	 *
+	 * @param edges The edges to sort.
+	 * @param scratch A buffer of the same size used as the ping-pong target.
+	 * @param count Number of edges.
+	 * @return The buffer (edges or scratch) holding the sorted sequence.
+	 */
+	Edge* RadixSort(Edge* edges, Edge* scratch, size_t count) noexcept
+	{
+		size_t histogram[8][256] = {};
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint64_t v = edges[i].value;
+			for (unsigned pass = 0; pass < 8; ++pass)
+			{
+				++histogram[pass][(v >> (pass * 8)) & 0xFF];
+			}
+		}
+
+		Edge* src = edges;
+		Edge* dst = scratch;
+		for (unsigned pass = 0; pass < 8; ++pass)
+		{
+			const unsigned shift = pass * 8;
+			size_t* bucket = histogram[pass];
+			if (bucket[(src[0].value >> shift) & 0xFF] == count)
+			{
+				continue; // every edge has the same digit, the pass would be a plain copy
+			}
+
+			size_t offset = 0;
+			for (unsigned digit = 0; digit < 256; ++digit)
+			{
+				size_t n = bucket[digit];
+				bucket[digit] = offset;
+				offset += n;
+			}
+			for (size_t i = 0; i < count; ++i)
+			{
+				dst[bucket[(src[i].value >> shift) & 0xFF]++] = src[i];
+			}
+			std::swap(src, dst);
+		}
+		return src;
+	}
+
+	/**
+	 * Sorts the edges of one axis and turns them into grid line indices.
+	 *
+	 * @param edges The edges to sort; 2 * paneCount entries.
+	 * @param scratch Ping-pong buffer of the same size.
+	 * @param paneCount Number of panes.
+	 * @param placements Receives the result for every pane.
+	 * @param start The placement member receiving the grid line index of the near edge.
+	 * @param span The placement member receiving the number of cells covered (at least 1).
+	 * @return The number of cells on this axis.
+	 */
+	int32_t RankAxis(
+		Edge* edges,
+		Edge* scratch,
+		size_t paneCount,
+		GridPlacement* placements,
+		int32_t GridPlacement::* start,
+		int32_t GridPlacement::* span) noexcept
+	{
+		const size_t count = paneCount * 2;
+		Edge* sorted = edges;
+		if (count < RadixThreshold)
+		{
+			InsertionSort(edges, count);
+		}
+		else
+		{
+			sorted = RadixSort(edges, scratch, count);
+		}
+
+		// Equal numerators are the same grid line; no tolerance is involved.
+		int32_t line = -1;
+		uint64_t previous = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (line < 0 || sorted[i].value != previous)
+			{
+				++line;
+				previous = sorted[i].value;
+			}
+			const size_t pane = sorted[i].tag >> 1;
+			if (sorted[i].tag & 1)
+			{
+				placements[pane].*span = line; // far edge; converted to a span below
+			}
+			else
+			{
+				placements[pane].*start = line;
+			}
+		}
+
+		for (size_t pane = 0; pane < paneCount; ++pane)
+		{
+			const int32_t cells = placements[pane].*span - placements[pane].*start;
+			placements[pane].*span = cells > 0 ? cells : 1;
+		}
+		return line > 0 ? line : 1;
+	}
+}
+
+/**
+ * Returns the rectangle covering the whole tab.
+ *
+ * @return A DyadicRect of { 0, 0, Unit, Unit }.
+ */
+DyadicRect DyadicLayout::Root() noexcept
+{
+	return DyadicRect{ 0, 0, Unit, Unit };
+}
+
+/**
+ * Splits the focused pane in half, mirroring the Windows Terminal "splitPane" semantics
+ * used by StateJsonParser: the new pane takes the half on the requested side.
+ *
+ * @param focused The pane being split; updated to the half it keeps.
+ * @param created Receives the rectangle of the new pane.
+ * @param direction The side the new pane is placed on.
+ * @return false if the side being halved is already one unit wide, or the direction is None.
+ */
+bool DyadicLayout::Split(DyadicRect& focused, DyadicRect& created, SplitDirection direction) noexcept
+{
+	created = focused;
+	if (direction == SplitDirection::None)
+	{
+		return false;
+	}
+	const bool horizontal = direction == SplitDirection::Left || direction == SplitDirection::Right;
+	const uint64_t extent = horizontal ? focused.width : focused.height;
+	if (extent < 2 || (extent & 1) != 0)
+	{
+		return false;
+	}
+
+	const uint64_t half = extent >> 1;
+	switch (direction)
+	{
+	case SplitDirection::Left:
+		created.width = half;
+		focused.x += half;
+		focused.width = half;
+		break;
+	case SplitDirection::Right:
+		created.x += half;
+		created.width = half;
+		focused.width = half;
+		break;
+	case SplitDirection::Up:
+		created.height = half;
+		focused.y += half;
+		focused.height = half;
+		break;
+	case SplitDirection::Down:
+		created.y += half;
+		created.height = half;
+		focused.height = half;
+		break;
+	case SplitDirection::None:
+		break;
+	}
+	return true;
+}
+
+/**
+ * Replays the "splitPane" actions of one tab on exact geometry.
+ *
+ * @param splits The splits in order; split i creates pane i + 1.
+ * @param count Number of splits.
+ * @param panes Receives count + 1 rectangles, the first one covering the whole tab before the splits.
+ */
+void DyadicLayout::Replay(const PaneSplit* splits, size_t count, DyadicRect* panes) noexcept
+{
+	panes[0] = Root();
+	for (size_t i = 0; i < count; ++i)
+	{
+		DyadicRect& created = panes[i + 1];
+		if (splits[i].focused > i || splits[i].direction == SplitDirection::None)
+		{
+			created = DyadicRect{ 0, 0, 0, 0 };
+			continue;
+		}
+		Split(panes[splits[i].focused], created, splits[i].direction);
+	}
+}
+
+/**
+ * Converts a coordinate in [0, 1] into its numerator over 2^63.
+ *
+ * @param value The coordinate; NaN and negative values map to 0, values above 1 to Unit.
+ * @return The dyadic numerator.
+ */
+uint64_t DyadicLayout::FromDouble(double value) noexcept
+{
+	if (!(value > 0.0))
+	{
+		return 0;
+	}
+	if (value >= 1.0)
+	{
+		return Unit;
+	}
+	return static_cast<uint64_t>(std::nearbyint(std::ldexp(value, PrecisionBits)));
+}
+
+/**
+ * Converts a numerator over 2^63 back into a coordinate in [0, 1].
+ *
+ * @param value The dyadic numerator.
+ * @return The coordinate as a double.
+ */
+double DyadicLayout::ToDouble(uint64_t value) noexcept
+{
+	return std::ldexp(static_cast<double>(value), -static_cast<int>(PrecisionBits));
+}
+
+/**
+ * Computes grid placement for each pane from its exact geometry.
+ *
+ * Collects the near and far edge of every pane per axis, sorts them (insertion sort for small
+ * tabs, radix sort otherwise), merges equal numerators into a single grid line and derives each
+ * pane's row / column and span from the line indices of its edges.
+ *
+ * @param panes The pane rectangles.
+ * @param count Number of panes.
+ * @param placements Receives one placement per pane.
+ * @param rows Receives the number of grid rows.
+ * @param columns Receives the number of grid columns.
+ */
+void DyadicLayout::ComputeGrid(
+	const DyadicRect* panes,
+	size_t count,
+	GridPlacement* placements,
+	int32_t& rows,
+	int32_t& columns)
+{
+	rows = columns = 0;
+	if (count == 0)
+	{
+		return;
+	}
+
+	const size_t edgeCount = count * 2;
+	std::unique_ptr<Edge[]> edges(new Edge[edgeCount * 2]);
+	Edge* scratch = edges.get() + edgeCount;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const uint32_t tag = static_cast<uint32_t>(i) << 1;
+		edges[i * 2] = Edge{ panes[i].x, tag };
+		edges[i * 2 + 1] = Edge{ panes[i].x + panes[i].width, tag | 1 };
+	}
+	columns = RankAxis(edges.get(), scratch, count, placements, &GridPlacement::column, &GridPlacement::columnSpan);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const uint32_t tag = static_cast<uint32_t>(i) << 1;
+		edges[i * 2] = Edge{ panes[i].y, tag };
+		edges[i * 2 + 1] = Edge{ panes[i].y + panes[i].height, tag | 1 };
+	}
+	rows = RankAxis(edges.get(), scratch, count, placements, &GridPlacement::row, &GridPlacement::rowSpan);
+}
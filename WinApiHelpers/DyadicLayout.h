@@ -0,0 +1,143 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// Direction of a "splitPane" action, relative to the pane being split.
+		/// </summary>
+		enum class SplitDirection : uint8_t
+		{
+			Left,
+			Right,
+			Up,
+			Down,
+			None        // not a direction StateJsonParser recognises; the new pane gets no area
+		};
+
+		/// <summary>
+		/// One replayed "splitPane" action: the pane that had focus and the side the new pane went to.
+		/// </summary>
+		struct PaneSplit
+		{
+			uint32_t focused;          // index of the split pane; lower than the index of the pane created
+			SplitDirection direction;
+		};
+
+		/// <summary>
+		/// Pane rectangle expressed as exact dyadic rationals.
+		/// </summary>
+		/// <remarks>
+		/// Every member is the numerator of a fraction whose denominator is DyadicLayout::Unit (2^63),
+		/// so the whole tab is { 0, 0, Unit, Unit }. Because every split halves a side, all reachable
+		/// coordinates are exact and two edges coincide if and only if their numerators are equal.
+		/// </remarks>
+		struct DyadicRect
+		{
+			uint64_t x;
+			uint64_t y;
+			uint64_t width;
+			uint64_t height;
+		};
+
+		/// <summary>
+		/// Row / column placement of a pane inside the tab grid.
+		/// </summary>
+		struct GridPlacement
+		{
+			int32_t row;
+			int32_t column;
+			int32_t rowSpan;
+			int32_t columnSpan;
+		};
+
+		/// <summary>
+		/// Tolerance-free layout kernel for Windows Terminal tab layouts.
+		/// </summary>
+		/// <remarks>
+		/// Replays pane splits on integer geometry and converts the resulting rectangles into
+		/// grid rows / columns by radix sorting and deduplicating the pane edges.
+		/// </remarks>
+		class DyadicLayout
+		{
+		public:
+			/// <summary>
+			/// Number of fractional bits of every coordinate.
+			/// </summary>
+			static constexpr unsigned PrecisionBits = 63;
+
+			/// <summary>
+			/// Numerator representing the full width / height of a tab.
+			/// </summary>
+			static constexpr uint64_t Unit = uint64_t{ 1 } << PrecisionBits;
+
+			/// <summary>
+			/// Returns the rectangle covering the whole tab.
+			/// </summary>
+			WINAPIHELPERS_API static DyadicRect Root() noexcept;
+
+			/// <summary>
+			/// Splits the focused pane in half in the given direction.
+			/// </summary>
+			/// <param name="focused">The pane being split; shrunk in place to the half it keeps.</param>
+			/// <param name="created">Receives the half occupied by the new pane.</param>
+			/// <param name="direction">The side of the focused pane the new pane is placed on.</param>
+			/// <returns>false if the split side is already at full precision (2^-63) and cannot be halved again.</returns>
+			/// <remarks>
+			/// When the split cannot be represented the focused pane is left untouched and the new pane
+			/// shares its rectangle, which the grid computation then collapses into the same cell.
+			/// </remarks>
+			WINAPIHELPERS_API static bool Split(DyadicRect& focused, DyadicRect& created, SplitDirection direction) noexcept;
+
+			/// <summary>
+			/// Replays the splits of one tab, starting from the pane the tab was opened with.
+			/// </summary>
+			/// <param name="splits">The splits in order; split i creates pane i + 1.</param>
+			/// <param name="count">Number of splits.</param>
+			/// <param name="panes">Receives count + 1 rectangles; panes[0] is the first pane of the tab.</param>
+			/// <remarks>
+			/// A split with direction None, or whose focused index does not name an earlier pane, creates
+			/// an empty rectangle at the origin and leaves the other panes untouched.
+			/// </remarks>
+			WINAPIHELPERS_API static void Replay(const PaneSplit* splits, size_t count, DyadicRect* panes) noexcept;
+
+			/// <summary>
+			/// Converts a coordinate in [0, 1] into its dyadic numerator.
+			/// </summary>
+			/// <remarks>
+			/// Exact for every value produced by repeatedly halving 1.0 up to PrecisionBits times;
+			/// anything finer is rounded to the nearest representable numerator.
+			/// </remarks>
+			WINAPIHELPERS_API static uint64_t FromDouble(double value) noexcept;
+
+			/// <summary>
+			/// Converts a dyadic numerator back into a coordinate in [0, 1].
+			/// </summary>
+			WINAPIHELPERS_API static double ToDouble(uint64_t value) noexcept;
+
+			/// <summary>
+			/// Computes grid rows / columns for a set of pane rectangles.
+			/// </summary>
+			/// <param name="panes">The pane rectangles of one tab.</param>
+			/// <param name="count">Number of entries in panes and placements.</param>
+			/// <param name="placements">Receives the placement of every pane, in the same order.</param>
+			/// <param name="rows">Receives the number of grid rows.</param>
+			/// <param name="columns">Receives the number of grid columns.</param>
+			/// <remarks>
+			/// Runs in O(n) for large tabs (LSD radix sort of the edge numerators) and never allocates
+			/// more than two scratch arrays of 2 * count edges. Degenerate panes get a span of 1.
+			/// </remarks>
+			WINAPIHELPERS_API static void ComputeGrid(
+				const DyadicRect* panes,
+				size_t count,
+				GridPlacement* placements,
+				int32_t& rows,
+				int32_t& columns);
+		};
+
+	}
+} // namespace WTLayoutManager::Services
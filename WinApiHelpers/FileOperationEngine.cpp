@@ -0,0 +1,600 @@
+﻿#include "pch.h"
+#include "FileOperationEngine.h"
+#include "ContentHash.h"
+#include "FolderScanner.h"
+#include "SnapshotStore.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace WTLayoutManager::Services;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	/// One folder of the operation.
+	struct Job
+	{
+		fs::path source;  // the folder to copy, or the folder to delete
+		fs::path target;  // the copy; unused by deletes
+		std::error_code error;
+	};
+
+	/**
+	 * Compares two file names, ignoring the case of ASCII letters.
+	 */
+	bool SameName(std::u16string_view a, std::u16string_view b) noexcept
+	{
+		if (a.size() != b.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			char16_t x = a[i];
+			char16_t y = b[i];
+			if (x >= u'A' && x <= u'Z')
+			{
+				x = static_cast<char16_t>(x - u'A' + u'a');
+			}
+			if (y >= u'A' && y <= u'Z')
+			{
+				y = static_cast<char16_t>(y - u'A' + u'a');
+			}
+			if (x != y)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Returns a name for a folder moved into the trash, unique within this process and unlikely to clash
+	 * with other processes.
+	 */
+	fs::path TrashName(const fs::path& folder)
+	{
+		static std::atomic<uint64_t> counter{ 0 };
+		const uint64_t seed[3] = {
+			counter.fetch_add(1, std::memory_order_relaxed),
+			static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()),
+			reinterpret_cast<uintptr_t>(&counter)
+		};
+		wchar_t suffix[24];
+		std::swprintf(suffix, 24, L".%016llx", static_cast<unsigned long long>(ContentHash::Hash64(seed, sizeof(seed))));
+		fs::path name = folder.filename();
+		name += suffix;
+		return name;
+	}
+
+#if defined(__linux__)
+	/**
+	 * Copies the rest of a file with read and write.
+	 */
+	bool CopyByReading(int in, int out, std::error_code& ec)
+	{
+		char buffer[64 * 1024];
+		for (;;)
+		{
+			const ssize_t read = ::read(in, buffer, sizeof(buffer));
+			if (read == 0)
+			{
+				return true;
+			}
+			if (read < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				ec.assign(errno, std::generic_category());
+				return false;
+			}
+			for (ssize_t written = 0; written < read;)
+			{
+				const ssize_t n = ::write(out, buffer + written, static_cast<size_t>(read - written));
+				if (n < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					ec.assign(errno, std::generic_category());
+					return false;
+				}
+				written += n;
+			}
+		}
+	}
+#endif
+}
+
+/**
+ * State of one bulk operation, shared with the scanner threads.
+ */
+struct FileOperationEngine::State
+{
+	std::optional<SnapshotStore> store;
+	fs::path trashDir;
+	bool deleting = false;
+	bool started = false;
+	std::vector<Job> jobs;
+	size_t reported = 0;  // jobs past this index purge trash leftovers and are not reported
+	std::vector<std::u16string> fileNames;
+
+	std::atomic<bool> cancelled{ false };
+	std::atomic<size_t> remaining{ 0 };
+	std::atomic<size_t> jobsDone{ 0 };
+	std::atomic<size_t> jobsFailed{ 0 };
+	std::atomic<uint64_t> filesDone{ 0 };
+	std::atomic<uint64_t> bytesDone{ 0 };
+
+	// Last, so the workers are joined before the jobs they use are destroyed.
+	FolderScanner scanner;
+
+	bool IsSelected(const fs::path& file) const
+	{
+		if (fileNames.empty())
+		{
+			return true;
+		}
+		const std::u16string name = file.filename().u16string();
+		for (const std::u16string& selected : fileNames)
+		{
+			if (SameName(name, selected))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool RemoveTree(const fs::path& folder, std::error_code& ec) const
+	{
+		if (store)
+		{
+			return store->RemoveTree(folder, ec);
+		}
+		fs::remove_all(folder, ec);
+		return !ec;
+	}
+
+	bool MoveToTrash(const fs::path& folder, fs::path& trashed, std::error_code& ec) const;
+	void Copy(Job& job);
+	void Delete(Job& job);
+	void Finish(size_t index);
+
+	static void* RunJob(void* context, size_t index);
+};
+
+/**
+ * Renames a folder into the trash directory.
+ *
+ * @param folder The folder.
+ * @param trashed Receives the new path; empty if the folder did not exist.
+ * @param ec Receives the error.
+ * @return false if the folder could not be moved (it is then left as it was).
+ */
+bool FileOperationEngine::State::MoveToTrash(const fs::path& folder, fs::path& trashed, std::error_code& ec) const
+{
+	ec.clear();
+	trashed.clear();
+	if (!fs::exists(folder, ec))
+	{
+		return !ec;
+	}
+
+	fs::create_directories(trashDir, ec);
+	if (!ec)
+	{
+		const fs::path candidate = trashDir / TrashName(folder);
+		fs::rename(folder, candidate, ec);
+		if (!ec)
+		{
+			trashed = candidate;
+			return true;
+		}
+	}
+	if (ec == std::errc::cross_device_link)
+	{
+		// The trash is on another volume; delete in place instead.
+		ec.clear();
+		trashed = folder;
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Copies the selected files of one folder.
+ *
+ * @param job The folder; receives the first error.
+ */
+void FileOperationEngine::State::Copy(Job& job)
+{
+	std::error_code ec;
+	if (!fs::is_directory(job.source, ec))
+	{
+		job.error = ec ? ec : std::make_error_code(std::errc::no_such_file_or_directory);
+		return;
+	}
+	const bool created = !fs::exists(job.target, ec);
+
+	if (!fs::create_directories(job.target, ec) && ec)
+	{
+		job.error = ec;
+		return;
+	}
+	for (fs::recursive_directory_iterator it(job.source, ec), end; !ec && it != end; it.increment(ec))
+	{
+		if (cancelled.load(std::memory_order_acquire))
+		{
+			ec = std::make_error_code(std::errc::operation_canceled);
+			break;
+		}
+
+		const fs::path target = job.target / it->path().lexically_relative(job.source);
+		if (it->is_directory(ec))
+		{
+			fs::create_directories(target, ec);
+			continue;
+		}
+		if (ec || !it->is_regular_file(ec) || !IsSelected(it->path()))
+		{
+			continue;
+		}
+
+		const uintmax_t size = it->file_size(ec);
+		if (store)
+		{
+			store->Place(it->path(), target, ec);
+		}
+		else
+		{
+			CopyFileContents(it->path(), target, ec);
+		}
+		if (!ec)
+		{
+			filesDone.fetch_add(1, std::memory_order_relaxed);
+			bytesDone.fetch_add(size, std::memory_order_relaxed);
+		}
+	}
+
+	job.error = ec;
+	if (ec && created)
+	{
+		// Do not leave a half-copied folder behind.
+		fs::path trashed;
+		std::error_code ignored;
+		if (MoveToTrash(job.target, trashed, ignored) && !trashed.empty())
+		{
+			RemoveTree(trashed, ignored);
+		}
+	}
+}
+
+/**
+ * Deletes one folder: moves it into the trash, then deletes it from there.
+ *
+ * @param job The folder; receives the error if it could not be moved.
+ */
+void FileOperationEngine::State::Delete(Job& job)
+{
+	fs::path trashed;
+	if (!MoveToTrash(job.source, trashed, job.error) || trashed.empty())
+	{
+		return;
+	}
+
+	// Whatever cannot be deleted now stays in the trash for the next delete.
+	std::error_code ignored;
+	RemoveTree(trashed, ignored);
+}
+
+/**
+ * Counts a finished job; the last delete job collects the store's garbage.
+ */
+void FileOperationEngine::State::Finish(size_t index)
+{
+	if (index < reported)
+	{
+		if (jobs[index].error)
+		{
+			jobsFailed.fetch_add(1, std::memory_order_relaxed);
+		}
+		jobsDone.fetch_add(1, std::memory_order_release);
+	}
+	if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 && deleting && store)
+	{
+		store->CollectGarbage();
+	}
+}
+
+/**
+ * Runs one job on a scanner thread.
+ *
+ * @param context The engine state.
+ * @param index The job.
+ * @return The job, handed back through the completion queue.
+ */
+void* FileOperationEngine::State::RunJob(void* context, size_t index)
+{
+	State& state = *static_cast<State*>(context);
+	Job& job = state.jobs[index];
+	if (state.deleting)
+	{
+		if (index < state.reported)
+		{
+			state.Delete(job);
+		}
+		else
+		{
+			std::error_code ignored;
+			state.RemoveTree(job.source, ignored);
+		}
+	}
+	else
+	{
+		state.Copy(job);
+	}
+	state.Finish(index);
+	return &job;
+}
+
+/**
+ * \brief Creates an idle engine.
+ */
+FileOperationEngine::FileOperationEngine(const SnapshotStore* store, fs::path trashDir)
+	: m_state(std::make_unique<State>())
+{
+	if (store != nullptr)
+	{
+		m_state->store.emplace(*store);
+	}
+	m_state->trashDir = std::move(trashDir);
+}
+
+/**
+ * \brief Destructor, cancels the operation and joins the workers.
+ */
+FileOperationEngine::~FileOperationEngine()
+{
+	Cancel();
+	Wait();
+}
+
+/**
+ * Copies a file with the fastest primitive of the platform.
+ *
+ * @param source The file to copy.
+ * @param target The file to create or replace.
+ * @param ec Receives the error.
+ * @return true on success.
+ */
+bool FileOperationEngine::CopyFileContents(const fs::path& source, const fs::path& target, std::error_code& ec)
+{
+	ec.clear();
+#if defined(_WIN32)
+	// CopyFile2 copies in the kernel (with block cloning on ReFS and Dev Drive) and keeps the attributes.
+	COPYFILE2_EXTENDED_PARAMETERS parameters{};
+	parameters.dwSize = sizeof(parameters);
+	const HRESULT hr = ::CopyFile2(source.c_str(), target.c_str(), &parameters);
+	if (FAILED(hr))
+	{
+		ec.assign(HRESULT_FACILITY(hr) == FACILITY_WIN32 ? HRESULT_CODE(hr) : static_cast<int>(hr), std::system_category());
+		return false;
+	}
+	return true;
+#elif defined(__linux__)
+	const int in = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+	if (in < 0)
+	{
+		ec.assign(errno, std::generic_category());
+		return false;
+	}
+	struct stat info {};
+	if (::fstat(in, &info) != 0)
+	{
+		ec.assign(errno, std::generic_category());
+		::close(in);
+		return false;
+	}
+	const int out = ::open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, info.st_mode & 0777);
+	if (out < 0)
+	{
+		ec.assign(errno, std::generic_category());
+		::close(in);
+		return false;
+	}
+
+	// copy_file_range reflinks on Btrfs and XFS and copies without a round trip through user space
+	// elsewhere; it is refused across file systems on older kernels, where the loop takes over.
+	bool copied = false;
+	bool fallback = false;
+	for (;;)
+	{
+		const ssize_t n = ::copy_file_range(in, nullptr, out, nullptr, 1u << 30, 0);
+		if (n > 0)
+		{
+			continue;
+		}
+		if (n == 0)
+		{
+			copied = true;
+			break;
+		}
+		if (errno == EINTR)
+		{
+			continue;
+		}
+		if (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)
+		{
+			fallback = true;
+			break;
+		}
+		ec.assign(errno, std::generic_category());
+		break;
+	}
+	if (fallback)
+	{
+		// Nothing was copied yet when these errors occur, so both offsets are still where they started.
+		copied = CopyByReading(in, out, ec);
+	}
+	if (::close(out) != 0 && copied)
+	{
+		ec.assign(errno, std::generic_category());
+		copied = false;
+	}
+	::close(in);
+	return copied;
+#else
+	return fs::copy_file(source, target, fs::copy_options::overwrite_existing, ec);
+#endif
+}
+
+/**
+ * Starts copying folders on the scanner threads.
+ *
+ * @param jobs The folders.
+ * @param jobCount Number of folders.
+ * @param fileNames The file names to copy; null for all.
+ * @param fileNameCount Number of file names.
+ * @param workers Number of threads; 0 for one per hardware thread.
+ * @return false if the engine was already started.
+ */
+bool FileOperationEngine::StartCopy(
+	const FileCopyJob* jobs,
+	size_t jobCount,
+	const std::u16string_view* fileNames,
+	size_t fileNameCount,
+	unsigned workers)
+{
+	State& state = *m_state;
+	if (state.started)
+	{
+		return false;
+	}
+
+	state.jobs.reserve(jobCount);
+	for (size_t i = 0; i < jobCount; ++i)
+	{
+		state.jobs.push_back(Job{ jobs[i].source, jobs[i].target, {} });
+	}
+	for (size_t i = 0; fileNames != nullptr && i < fileNameCount; ++i)
+	{
+		state.fileNames.emplace_back(fileNames[i]);
+	}
+	state.reported = jobCount;
+	state.remaining.store(jobCount, std::memory_order_relaxed);
+	state.started = true;
+	return state.scanner.Start(state.jobs.size(), &State::RunJob, &state, workers);
+}
+
+/**
+ * Starts deleting folders on the scanner threads. Leftovers in the trash are appended as extra jobs.
+ *
+ * @param folders The folders.
+ * @param folderCount Number of folders.
+ * @param workers Number of threads; 0 for one per hardware thread.
+ * @return false if the engine was already started.
+ */
+bool FileOperationEngine::StartDelete(const fs::path* folders, size_t folderCount, unsigned workers)
+{
+	State& state = *m_state;
+	if (state.started)
+	{
+		return false;
+	}
+
+	state.deleting = true;
+	state.jobs.reserve(folderCount);
+	for (size_t i = 0; i < folderCount; ++i)
+	{
+		state.jobs.push_back(Job{ folders[i], {}, {} });
+	}
+	state.reported = folderCount;
+	for (const fs::path& leftover : FolderScanner::EnumerateSubfolders(state.trashDir))
+	{
+		state.jobs.push_back(Job{ leftover, {}, {} });
+	}
+	state.remaining.store(state.jobs.size(), std::memory_order_relaxed);
+	state.started = true;
+	return state.scanner.Start(state.jobs.size(), &State::RunJob, &state, workers);
+}
+
+/**
+ * Stops handing out jobs and interrupts running copies between two files.
+ */
+void FileOperationEngine::Cancel() noexcept
+{
+	m_state->cancelled.store(true, std::memory_order_release);
+	m_state->scanner.Cancel();
+}
+
+/**
+ * Joins every worker thread.
+ */
+void FileOperationEngine::Wait()
+{
+	m_state->scanner.Wait();
+}
+
+/**
+ * Checks whether every worker has exited.
+ */
+bool FileOperationEngine::IsFinished() const noexcept
+{
+	return !m_state->started || m_state->scanner.IsFinished();
+}
+
+/**
+ * Reads the counters of the operation.
+ *
+ * @return A snapshot of the counters; they are read one by one, not atomically together.
+ */
+FileOperationProgress FileOperationEngine::Progress() const noexcept
+{
+	const State& state = *m_state;
+	FileOperationProgress progress{};
+	progress.jobsTotal = state.reported;
+	progress.jobsDone = state.jobsDone.load(std::memory_order_acquire);
+	progress.jobsFailed = state.jobsFailed.load(std::memory_order_relaxed);
+	progress.filesDone = state.filesDone.load(std::memory_order_relaxed);
+	progress.bytesDone = state.bytesDone.load(std::memory_order_relaxed);
+	return progress;
+}
+
+/**
+ * Takes the next finished folder, skipping the trash purges.
+ *
+ * @param completion Receives the folder index and its error.
+ * @return false if nothing is available right now.
+ */
+bool FileOperationEngine::TryTake(FileOperationCompletion& completion) noexcept
+{
+	State& state = *m_state;
+	FolderScanCompletion finished;
+	while (state.scanner.TryTake(finished))
+	{
+		if (finished.index < state.reported)
+		{
+			completion.job = finished.index;
+			completion.error = static_cast<const Job*>(finished.result)->error;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,150 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		class SnapshotStore;
+
+		/// <summary>
+		/// A folder to copy.
+		/// </summary>
+		struct FileCopyJob
+		{
+			std::filesystem::path source;
+			std::filesystem::path target;
+		};
+
+		/// <summary>
+		/// One finished folder of a bulk operation.
+		/// </summary>
+		struct FileOperationCompletion
+		{
+			size_t job;             // index of the folder in the list passed to StartCopy or StartDelete
+			std::error_code error;  // empty on success; operation_canceled if cancelled while running
+		};
+
+		/// <summary>
+		/// Counters of a bulk operation; read while it runs.
+		/// </summary>
+		struct FileOperationProgress
+		{
+			size_t jobsTotal;
+			size_t jobsDone;
+			size_t jobsFailed;
+			uint64_t filesDone;
+			uint64_t bytesDone;
+		};
+
+		/// <summary>
+		/// Copies or deletes many LocalState folders in the background.
+		/// </summary>
+		/// <remarks>
+		/// Each folder is one job; the jobs run on a FolderScanner, so they are spread over the hardware
+		/// threads and their completions are streamed to a single consumer (the UI). A copy places the
+		/// files of a folder one after the other, through the snapshot store when one is given (clone,
+		/// link or copy) and through CopyFileContents otherwise; a copy that fails or is cancelled halfway
+		/// removes the folder it created. A delete first renames the folder into the trash directory, which
+		/// either moves the whole folder or, if a file in it is locked, leaves it untouched, and only then
+		/// deletes the renamed tree; what cannot be deleted stays in the trash and is purged by the next
+		/// delete. The trash directory must be on the same volume as the folders. Once every delete job has
+		/// finished, the store's unused objects are collected. Cancel stops jobs that have not started and
+		/// interrupts copies between two files.
+		/// </remarks>
+		class FileOperationEngine
+		{
+		public:
+			/// <param name="store">The snapshot store to place and remove files through; may be null.
+			/// The engine keeps its own copy.</param>
+			/// <param name="trashDir">The directory deleted and discarded folders are renamed into.</param>
+			WINAPIHELPERS_API FileOperationEngine(const SnapshotStore* store, std::filesystem::path trashDir);
+
+			/// <summary>
+			/// Cancels the operation and waits for the jobs that are running.
+			/// </summary>
+			WINAPIHELPERS_API ~FileOperationEngine();
+
+			FileOperationEngine(const FileOperationEngine&) = delete;
+			FileOperationEngine& operator=(const FileOperationEngine&) = delete;
+
+			/// <summary>
+			/// Copies a file, replacing the target: CopyFile2 on Windows, copy_file_range on Linux (which
+			/// clones or copies in the kernel), a read/write loop where neither applies.
+			/// </summary>
+			/// <returns>false on error; a partially written target may be left behind.</returns>
+			WINAPIHELPERS_API static bool CopyFileContents(
+				const std::filesystem::path& source,
+				const std::filesystem::path& target,
+				std::error_code& ec);
+
+			/// <summary>
+			/// Starts copying folders.
+			/// </summary>
+			/// <param name="jobs">The folders to copy; every target is created if needed.</param>
+			/// <param name="jobCount">Number of folders.</param>
+			/// <param name="fileNames">The file names to copy, compared case-insensitively; other files are
+			/// skipped. Null copies every file.</param>
+			/// <param name="fileNameCount">Number of file names.</param>
+			/// <param name="workers">Number of threads; 0 uses one per hardware thread.</param>
+			/// <returns>false if the engine was already started.</returns>
+			WINAPIHELPERS_API bool StartCopy(
+				const FileCopyJob* jobs,
+				size_t jobCount,
+				const std::u16string_view* fileNames,
+				size_t fileNameCount,
+				unsigned workers = 0);
+
+			/// <summary>
+			/// Starts deleting folders, and purging what earlier deletes left in the trash.
+			/// </summary>
+			/// <param name="folders">The folders to delete; a missing folder counts as deleted.</param>
+			/// <param name="folderCount">Number of folders.</param>
+			/// <param name="workers">Number of threads; 0 uses one per hardware thread.</param>
+			/// <returns>false if the engine was already started.</returns>
+			WINAPIHELPERS_API bool StartDelete(
+				const std::filesystem::path* folders,
+				size_t folderCount,
+				unsigned workers = 0);
+
+			/// <summary>
+			/// Stops starting new jobs and interrupts running copies.
+			/// </summary>
+			WINAPIHELPERS_API void Cancel() noexcept;
+
+			/// <summary>
+			/// Blocks until every job has finished or was cancelled.
+			/// </summary>
+			WINAPIHELPERS_API void Wait();
+
+			/// <summary>
+			/// Returns true once no job is running any more. Completions may still be waiting to be taken.
+			/// </summary>
+			WINAPIHELPERS_API bool IsFinished() const noexcept;
+
+			/// <summary>
+			/// Reads the counters.
+			/// </summary>
+			WINAPIHELPERS_API FileOperationProgress Progress() const noexcept;
+
+			/// <summary>
+			/// Takes the next finished folder; single consumer only. Jobs that were cancelled before
+			/// they started produce no completion.
+			/// </summary>
+			/// <returns>false if nothing is available right now.</returns>
+			WINAPIHELPERS_API bool TryTake(FileOperationCompletion& completion) noexcept;
+
+		private:
+			struct State;
+			std::unique_ptr<State> m_state;
+		};
+
+	}
+} // namespace WTLayoutManager::Services
@@ -0,0 +1,261 @@
+﻿#include "pch.h"
+#include "FolderScanner.h"
+#include "MpscQueue.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <system_error>
+#include <thread>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	constexpr uint64_t PackRange(uint32_t begin, uint32_t end) noexcept
+	{
+		return (static_cast<uint64_t>(end) << 32) | begin;
+	}
+
+	constexpr uint32_t RangeBegin(uint64_t range) noexcept
+	{
+		return static_cast<uint32_t>(range);
+	}
+
+	constexpr uint32_t RangeEnd(uint64_t range) noexcept
+	{
+		return static_cast<uint32_t>(range >> 32);
+	}
+
+	/// The indices a worker still has to process; padded so neighbours do not share a cache line.
+	struct alignas(64) WorkerRange
+	{
+		std::atomic<uint64_t> range{ 0 };
+	};
+
+	/**
+	 * Takes the first index of a worker's own range.
+	 *
+	 * @param own The worker's range.
+	 * @param index Receives the index.
+	 * @return false if the range is empty.
+	 */
+	bool TakeOwn(WorkerRange& own, uint32_t& index) noexcept
+	{
+		uint64_t current = own.range.load(std::memory_order_acquire);
+		for (;;)
+		{
+			const uint32_t begin = RangeBegin(current);
+			const uint32_t end = RangeEnd(current);
+			if (begin >= end)
+			{
+				return false;
+			}
+			if (own.range.compare_exchange_weak(current, PackRange(begin + 1, end), std::memory_order_acq_rel, std::memory_order_acquire))
+			{
+				index = begin;
+				return true;
+			}
+		}
+	}
+
+	/**
+	 * Moves the back half of a victim's range (at least one index) into an empty own range.
+	 *
+	 * @param victim The range to steal from.
+	 * @param own The thief's range; must be empty, so no other thread modifies it concurrently.
+	 * @return false if the victim had nothing left.
+	 */
+	bool Steal(WorkerRange& victim, WorkerRange& own) noexcept
+	{
+		uint64_t current = victim.range.load(std::memory_order_acquire);
+		for (;;)
+		{
+			const uint32_t begin = RangeBegin(current);
+			const uint32_t end = RangeEnd(current);
+			if (begin >= end)
+			{
+				return false;
+			}
+			const uint32_t split = begin + (end - begin) / 2;
+			if (victim.range.compare_exchange_weak(current, PackRange(begin, split), std::memory_order_acq_rel, std::memory_order_acquire))
+			{
+				own.range.store(PackRange(split, end), std::memory_order_release);
+				return true;
+			}
+		}
+	}
+}
+
+struct FolderScanner::State
+{
+	FolderScanWork work = nullptr;
+	void* context = nullptr;
+	std::unique_ptr<WorkerRange[]> ranges;
+	unsigned workerCount = 0;
+	std::vector<std::thread> threads;
+	std::atomic<bool> cancelled{ false };
+	std::atomic<unsigned> running{ 0 };
+	MpscQueue<FolderScanCompletion> completions;
+
+	/**
+	 * Worker loop: drain the own range, then steal until every range is empty.
+	 *
+	 * @param self Index of this worker.
+	 */
+	void Run(unsigned self)
+	{
+		WorkerRange& own = ranges[self];
+		for (;;)
+		{
+			uint32_t index;
+			while (!cancelled.load(std::memory_order_acquire) && TakeOwn(own, index))
+			{
+				completions.Push(FolderScanCompletion{ index, work(context, index) });
+			}
+			if (cancelled.load(std::memory_order_acquire))
+			{
+				break;
+			}
+
+			bool stolen = false;
+			for (unsigned step = 1; step < workerCount && !stolen; ++step)
+			{
+				stolen = Steal(ranges[(self + step) % workerCount], own);
+			}
+			if (!stolen)
+			{
+				break; // every range is empty; indices in flight belong to a thief that is still running
+			}
+		}
+		running.fetch_sub(1, std::memory_order_acq_rel);
+	}
+};
+
+/**
+ * \brief Constructor, creates an idle scanner.
+ */
+FolderScanner::FolderScanner()
+	: m_state(std::make_unique<State>())
+{
+}
+
+/**
+ * \brief Destructor, cancels the scan and joins the workers.
+ */
+FolderScanner::~FolderScanner()
+{
+	Cancel();
+	Wait();
+}
+
+/**
+ * Lists the immediate subfolders of a folder.
+ *
+ * @param folder The folder to list.
+ * @return The subfolders in the order the file system returns them.
+ */
+std::vector<std::filesystem::path> FolderScanner::EnumerateSubfolders(const std::filesystem::path& folder)
+{
+	std::vector<std::filesystem::path> subfolders;
+	std::error_code ec;
+	std::filesystem::directory_iterator it(folder, ec);
+	for (const std::filesystem::directory_iterator end; !ec && it != end; it.increment(ec))
+	{
+		std::error_code typeError;
+		if (it->is_directory(typeError))
+		{
+			subfolders.push_back(it->path());
+		}
+	}
+	return subfolders;
+}
+
+/**
+ * Splits the folders into one range per worker and starts the workers.
+ *
+ * @param count Number of folders.
+ * @param work The per-folder work.
+ * @param context Passed to work.
+ * @param workers Requested number of threads; 0 for one per hardware thread.
+ * @return false if the scanner was already started or count does not fit in 32 bits.
+ */
+bool FolderScanner::Start(size_t count, FolderScanWork work, void* context, unsigned workers)
+{
+	State& state = *m_state;
+	if (state.ranges || count > UINT32_MAX || work == nullptr)
+	{
+		return false;
+	}
+
+	if (workers == 0)
+	{
+		workers = std::max(1u, std::thread::hardware_concurrency());
+	}
+	workers = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(workers, count)));
+
+	state.work = work;
+	state.context = context;
+	state.workerCount = workers;
+	state.ranges.reset(new WorkerRange[workers]);
+	for (unsigned i = 0; i < workers; ++i)
+	{
+		const uint32_t begin = static_cast<uint32_t>(count * i / workers);
+		const uint32_t end = static_cast<uint32_t>(count * (i + 1) / workers);
+		state.ranges[i].range.store(PackRange(begin, end), std::memory_order_relaxed);
+	}
+
+	state.running.store(count == 0 ? 0 : workers, std::memory_order_release);
+	if (count == 0)
+	{
+		return true;
+	}
+	state.threads.reserve(workers);
+	for (unsigned i = 0; i < workers; ++i)
+	{
+		state.threads.emplace_back([&state, i]() { state.Run(i); });
+	}
+	return true;
+}
+
+/**
+ * Stops the workers from starting new folders.
+ */
+void FolderScanner::Cancel() noexcept
+{
+	m_state->cancelled.store(true, std::memory_order_release);
+}
+
+/**
+ * Joins every worker thread.
+ */
+void FolderScanner::Wait()
+{
+	for (std::thread& thread : m_state->threads)
+	{
+		if (thread.joinable())
+		{
+			thread.join();
+		}
+	}
+}
+
+/**
+ * Takes the next finished folder.
+ *
+ * @param completion Receives the folder index and its result.
+ * @return false if nothing is available right now.
+ */
+bool FolderScanner::TryTake(FolderScanCompletion& completion) noexcept
+{
+	return m_state->completions.TryPop(completion);
+}
+
+/**
+ * Checks whether every worker has exited.
+ *
+ * @return true if no further results will be produced.
+ */
+bool FolderScanner::IsFinished() const noexcept
+{
+	return m_state->running.load(std::memory_order_acquire) == 0;
+}
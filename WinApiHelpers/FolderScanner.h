@@ -0,0 +1,98 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// Per-folder work executed on a scanner thread.
+		/// </summary>
+		/// <param name="context">The context passed to FolderScanner::Start.</param>
+		/// <param name="index">Index of the folder in the list passed to Start.</param>
+		/// <returns>An opaque result handed back through FolderScanner::TryTake.</returns>
+		typedef void* (*FolderScanWork)(void* context, size_t index);
+
+		/// <summary>
+		/// One finished folder.
+		/// </summary>
+		struct FolderScanCompletion
+		{
+			size_t index;
+			void* result;
+		};
+
+		/// <summary>
+		/// Runs per-folder work over a work-stealing thread pool and streams the results.
+		/// </summary>
+		/// <remarks>
+		/// The folders are split into one contiguous index range per worker. A worker takes indices from
+		/// the front of its own range and, once it runs dry, steals the back half of another worker's
+		/// range; both are single compare-and-swap operations on the packed (begin, end) pair, so no lock
+		/// is taken. Finished folders are pushed to a lock-free completion queue that a single consumer
+		/// (the UI) drains at its own pace. Cancel stops workers from starting new folders; folders that
+		/// are already running finish normally.
+		/// </remarks>
+		class FolderScanner
+		{
+		public:
+			WINAPIHELPERS_API FolderScanner();
+
+			/// <summary>
+			/// Cancels the scan and waits for the workers. Results that were not taken are dropped
+			/// without being released; drain them first if they own resources.
+			/// </summary>
+			WINAPIHELPERS_API ~FolderScanner();
+
+			FolderScanner(const FolderScanner&) = delete;
+			FolderScanner& operator=(const FolderScanner&) = delete;
+
+			/// <summary>
+			/// Lists the immediate subfolders of a folder, in file system order.
+			/// </summary>
+			/// <returns>The subfolders; empty if the folder does not exist or cannot be read.</returns>
+			WINAPIHELPERS_API static std::vector<std::filesystem::path> EnumerateSubfolders(const std::filesystem::path& folder);
+
+			/// <summary>
+			/// Starts processing folder indices 0 .. count - 1.
+			/// </summary>
+			/// <param name="count">Number of folders.</param>
+			/// <param name="work">Called once per folder on a worker thread.</param>
+			/// <param name="context">Passed to every call of work.</param>
+			/// <param name="workers">Number of threads; 0 uses one per hardware thread. Never more than count.</param>
+			/// <returns>false if the scanner was already started.</returns>
+			WINAPIHELPERS_API bool Start(size_t count, FolderScanWork work, void* context, unsigned workers = 0);
+
+			/// <summary>
+			/// Stops handing out folders to the workers.
+			/// </summary>
+			WINAPIHELPERS_API void Cancel() noexcept;
+
+			/// <summary>
+			/// Blocks until every worker has exited.
+			/// </summary>
+			WINAPIHELPERS_API void Wait();
+
+			/// <summary>
+			/// Takes the next finished folder; single consumer only.
+			/// </summary>
+			/// <returns>false if no result is available right now.</returns>
+			WINAPIHELPERS_API bool TryTake(FolderScanCompletion& completion) noexcept;
+
+			/// <summary>
+			/// Returns true once every worker has exited (all folders done, or the scan was cancelled).
+			/// Results may still be waiting to be taken.
+			/// </summary>
+			WINAPIHELPERS_API bool IsFinished() const noexcept;
+
+		private:
+			struct State;
+			std::unique_ptr<State> m_state;
+		};
+
+	}
+} // namespace WTLayoutManager::Services
@@ -0,0 +1,680 @@
+﻿#include "pch.h"
+#include "FolderWatcher.h"
+#include "LayoutCache.h"
+#include "MpscQueue.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <unordered_map>
+#endif
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	/// How often a root folder that does not exist (yet) is looked for again.
+	constexpr std::chrono::milliseconds RootRetryInterval{ 1000 };
+
+	enum WatchRoot
+	{
+		DefaultRoot = 0,    // the default LocalState folder: its own files
+		BaseRoot = 1,       // the custom base folder: its subfolders and their files
+		RootCount = 2
+	};
+
+	enum class EntryAction
+	{
+		Added,
+		Removed,
+		Modified
+	};
+
+	/// Notifications of one folder collected since it was last published.
+	struct PendingFolder
+	{
+		Clock::time_point lastEvent;
+		uint32_t sources = 0;
+		bool structural = false;
+		bool sampled = false;
+		uint32_t samples = 0;
+		CacheSourceKey keys[LayoutCacheSourceCount]{};
+	};
+
+	/**
+	 * Returns the index of a source file name in LayoutCache::SourceNames, or -1.
+	 *
+	 * Names are compared case-insensitively (ASCII), as the Windows file system does.
+	 */
+	int SourceIndex(const std::filesystem::path& name)
+	{
+		const auto& s = name.native();
+		for (size_t i = 0; i < LayoutCacheSourceCount; ++i)
+		{
+			const std::string_view source = LayoutCache::SourceNames[i];
+			if (s.size() == source.size() && std::equal(s.begin(), s.end(), source.begin(), [](auto a, char b)
+				{
+					return (a >= 'A' && a <= 'Z' ? a + ('a' - 'A') : a) == b;
+				}))
+			{
+				return static_cast<int>(i);
+			}
+		}
+		return -1;
+	}
+
+	bool SameKeys(const CacheSourceKey (&a)[LayoutCacheSourceCount], const CacheSourceKey (&b)[LayoutCacheSourceCount])
+	{
+		for (size_t i = 0; i < LayoutCacheSourceCount; ++i)
+		{
+			if (a[i].present != b[i].present || a[i].size != b[i].size ||
+				a[i].lastWriteTime != b[i].lastWriteTime || a[i].contentHash != b[i].contentHash)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+struct FolderWatcher::State
+{
+	std::filesystem::path roots[RootCount];
+	std::chrono::milliseconds quiet{ DefaultQuietMilliseconds };
+	std::thread thread;
+	std::atomic<bool> stopping{ false };
+	MpscQueue<FolderChange> changes;
+	std::map<std::filesystem::path, PendingFolder> pending;
+
+#if defined(_WIN32)
+	HANDLE stopEvent = nullptr;
+#else
+	int stopPipe[2] = { -1, -1 };
+#endif
+
+	PendingFolder& Touch(const std::filesystem::path& folder, Clock::time_point now)
+	{
+		PendingFolder& p = pending[folder];
+		p.lastEvent = now;
+		return p;
+	}
+
+	/**
+	 * Files one raw notification under the folder it belongs to.
+	 *
+	 * @param root The watched root the notification came from.
+	 * @param relative Path of the changed entry relative to the root.
+	 * @param action What happened to the entry.
+	 * @param now Time of the notification.
+	 */
+	void Record(int root, const std::filesystem::path& relative, EntryAction action, Clock::time_point now)
+	{
+		std::vector<std::filesystem::path> parts;
+		for (const std::filesystem::path& part : relative)
+		{
+			if (!part.empty())
+			{
+				parts.push_back(part);
+			}
+		}
+
+		if (root == DefaultRoot)
+		{
+			const int source = parts.size() == 1 ? SourceIndex(parts[0]) : -1;
+			if (source >= 0)
+			{
+				Touch(roots[DefaultRoot], now).sources |= 1u << source;
+			}
+			return;
+		}
+
+		if (parts.empty())
+		{
+			return;
+		}
+		const std::filesystem::path folder = roots[BaseRoot] / parts[0];
+		if (parts.size() == 1)
+		{
+			if (action != EntryAction::Modified)
+			{
+				Touch(folder, now).structural = true; // resolved against the disk when published
+			}
+			return;
+		}
+		const int source = parts.size() == 2 ? SourceIndex(parts[1]) : -1;
+		if (source >= 0)
+		{
+			Touch(folder, now).sources |= 1u << source;
+		}
+	}
+
+	/**
+	 * Announces every existing subfolder of the base folder, used when the base folder appears.
+	 */
+	void RecordExistingSubfolders(Clock::time_point now)
+	{
+		std::error_code ec;
+		std::filesystem::directory_iterator it(roots[BaseRoot], ec);
+		for (const std::filesystem::directory_iterator end; !ec && it != end; it.increment(ec))
+		{
+			std::error_code typeError;
+			if (it->is_directory(typeError))
+			{
+				Touch(it->path(), now).structural = true;
+			}
+		}
+	}
+
+	void PublishRescan()
+	{
+		pending.clear();
+		changes.Push(FolderChange{ FolderChangeKind::Rescan, 0, std::filesystem::path() });
+	}
+
+	/**
+	 * Publishes the folders that have been quiet long enough and whose source files are stable.
+	 *
+	 * @param now The current time.
+	 */
+	void Flush(Clock::time_point now)
+	{
+		for (auto it = pending.begin(); it != pending.end();)
+		{
+			PendingFolder& p = it->second;
+			if (now - p.lastEvent < quiet)
+			{
+				++it;
+				continue;
+			}
+
+			const std::filesystem::path& folder = it->first;
+			if (p.structural)
+			{
+				std::error_code ec;
+				const bool exists = std::filesystem::is_directory(folder, ec);
+				changes.Push(FolderChange{ exists ? FolderChangeKind::Added : FolderChangeKind::Removed, 0, folder });
+				it = pending.erase(it);
+				continue;
+			}
+
+			// Torn read protection: publish only when two samples one quiet interval apart agree.
+			CacheSourceKey keys[LayoutCacheSourceCount]{};
+			LayoutCache::CaptureSources(folder, keys, true);
+			if ((p.sampled && SameKeys(keys, p.keys)) || p.samples + 1 >= MaxStabilitySamples)
+			{
+				changes.Push(FolderChange{ FolderChangeKind::Changed, p.sources, folder });
+				it = pending.erase(it);
+				continue;
+			}
+			std::copy(std::begin(keys), std::end(keys), std::begin(p.keys));
+			p.sampled = true;
+			++p.samples;
+			p.lastEvent = now;
+			++it;
+		}
+	}
+
+	/**
+	 * Returns how long the watcher thread may sleep before the next pending folder is due.
+	 */
+	std::chrono::milliseconds NextTimeout(Clock::time_point now) const
+	{
+		std::chrono::milliseconds timeout = RootRetryInterval;
+		for (const auto& entry : pending)
+		{
+			const auto due = std::chrono::duration_cast<std::chrono::milliseconds>(entry.second.lastEvent + quiet - now);
+			timeout = std::min(timeout, std::max(due, std::chrono::milliseconds(1)));
+		}
+		return timeout;
+	}
+
+	void Run();
+};
+
+#if defined(_WIN32)
+
+namespace
+{
+	constexpr DWORD NotifyBufferBytes = 64 * 1024;
+	constexpr DWORD NotifyFilter =
+		FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+
+	/// One directory handle with its pending overlapped ReadDirectoryChangesW.
+	struct DirectoryWatch
+	{
+		HANDLE directory = INVALID_HANDLE_VALUE;
+		HANDLE event = nullptr;
+		OVERLAPPED overlapped{};
+		std::unique_ptr<DWORD[]> buffer;   // DWORD aligned, as ReadDirectoryChangesW requires
+		BOOL subtree = FALSE;
+
+		bool IsOpen() const
+		{
+			return directory != INVALID_HANDLE_VALUE;
+		}
+
+		bool Issue()
+		{
+			ResetEvent(event);
+			overlapped = OVERLAPPED{};
+			overlapped.hEvent = event;
+			return ReadDirectoryChangesW(directory, buffer.get(), NotifyBufferBytes, subtree, NotifyFilter, nullptr, &overlapped, nullptr) != FALSE;
+		}
+
+		bool Open(const std::filesystem::path& path, bool watchSubtree)
+		{
+			directory = CreateFileW(
+				path.c_str(),
+				FILE_LIST_DIRECTORY,
+				FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				nullptr,
+				OPEN_EXISTING,
+				FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+				nullptr);
+			if (directory == INVALID_HANDLE_VALUE)
+			{
+				return false;
+			}
+			event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+			buffer.reset(new DWORD[NotifyBufferBytes / sizeof(DWORD)]);
+			subtree = watchSubtree ? TRUE : FALSE;
+			if (event == nullptr || !Issue())
+			{
+				Close();
+				return false;
+			}
+			return true;
+		}
+
+		void Close()
+		{
+			if (directory != INVALID_HANDLE_VALUE)
+			{
+				DWORD bytes = 0;
+				if (CancelIoEx(directory, &overlapped) || GetLastError() != ERROR_NOT_FOUND)
+				{
+					GetOverlappedResult(directory, &overlapped, &bytes, TRUE);
+				}
+				CloseHandle(directory);
+				directory = INVALID_HANDLE_VALUE;
+			}
+			if (event != nullptr)
+			{
+				CloseHandle(event);
+				event = nullptr;
+			}
+		}
+	};
+}
+
+/**
+ * Watcher thread (Windows): one overlapped ReadDirectoryChangesW per root, multiplexed with the
+ * stop event through WaitForMultipleObjects.
+ */
+void FolderWatcher::State::Run()
+{
+	DirectoryWatch watches[RootCount];
+	while (!stopping.load(std::memory_order_acquire))
+	{
+		Clock::time_point now = Clock::now();
+		for (int root = 0; root < RootCount; ++root)
+		{
+			if (!watches[root].IsOpen() && watches[root].Open(roots[root], root == BaseRoot) && root == BaseRoot)
+			{
+				RecordExistingSubfolders(now);
+			}
+		}
+
+		HANDLE handles[RootCount + 1] = { stopEvent };
+		int handleRoots[RootCount + 1] = { -1 };
+		DWORD count = 1;
+		for (int root = 0; root < RootCount; ++root)
+		{
+			if (watches[root].IsOpen())
+			{
+				handleRoots[count] = root;
+				handles[count++] = watches[root].event;
+			}
+		}
+
+		const DWORD wait = WaitForMultipleObjects(count, handles, FALSE, static_cast<DWORD>(NextTimeout(now).count()));
+		if (wait == WAIT_OBJECT_0)
+		{
+			break;
+		}
+		now = Clock::now();
+		if (wait > WAIT_OBJECT_0 && wait < WAIT_OBJECT_0 + count)
+		{
+			const int root = handleRoots[wait - WAIT_OBJECT_0];
+			DirectoryWatch& watch = watches[root];
+			DWORD bytes = 0;
+			if (!GetOverlappedResult(watch.directory, &watch.overlapped, &bytes, FALSE))
+			{
+				watch.Close(); // the folder was deleted or became inaccessible; reopened when it is back
+				PublishRescan();
+			}
+			else
+			{
+				if (bytes == 0)
+				{
+					PublishRescan(); // the notification buffer overflowed
+				}
+				else
+				{
+					const uint8_t* entry = reinterpret_cast<const uint8_t*>(watch.buffer.get());
+					for (;;)
+					{
+						const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry);
+						const std::wstring name(info->FileName, info->FileNameLength / sizeof(WCHAR));
+						EntryAction action = EntryAction::Modified;
+						if (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+						{
+							action = EntryAction::Added;
+						}
+						else if (info->Action == FILE_ACTION_REMOVED || info->Action == FILE_ACTION_RENAMED_OLD_NAME)
+						{
+							action = EntryAction::Removed;
+						}
+						Record(root, std::filesystem::path(name), action, now);
+						if (info->NextEntryOffset == 0)
+						{
+							break;
+						}
+						entry += info->NextEntryOffset;
+					}
+				}
+				if (!watch.Issue())
+				{
+					watch.Close();
+					PublishRescan();
+				}
+			}
+		}
+		Flush(now);
+	}
+
+	for (DirectoryWatch& watch : watches)
+	{
+		watch.Close();
+	}
+}
+
+#else
+
+namespace
+{
+	constexpr uint32_t InotifyEvents =
+		IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+	/// What an inotify watch descriptor observes: a root, or one subfolder of the base folder.
+	struct WatchTarget
+	{
+		int root;
+		std::filesystem::path subfolder;   // empty for the root itself
+	};
+}
+
+/**
+ * Watcher thread (Linux): one inotify instance; the roots and every subfolder of the base folder
+ * get their own watch, because inotify is not recursive.
+ */
+void FolderWatcher::State::Run()
+{
+	const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0)
+	{
+		return;
+	}
+
+	std::unordered_map<int, WatchTarget> targets;
+	int rootWatches[RootCount] = { -1, -1 };
+
+	auto watchSubfolder = [&](const std::filesystem::path& name)
+		{
+			const int wd = inotify_add_watch(fd, (roots[BaseRoot] / name).c_str(), InotifyEvents);
+			if (wd >= 0)
+			{
+				targets[wd] = WatchTarget{ BaseRoot, name };
+			}
+		};
+	auto unwatchSubfolder = [&](const std::filesystem::path& name)
+		{
+			for (auto it = targets.begin(); it != targets.end(); ++it)
+			{
+				if (it->second.root == BaseRoot && it->second.subfolder == name)
+				{
+					inotify_rm_watch(fd, it->first);
+					targets.erase(it);
+					return;
+				}
+			}
+		};
+
+	alignas(inotify_event) char buffer[64 * 1024];
+	while (!stopping.load(std::memory_order_acquire))
+	{
+		Clock::time_point now = Clock::now();
+		for (int root = 0; root < RootCount; ++root)
+		{
+			if (rootWatches[root] >= 0)
+			{
+				continue;
+			}
+			rootWatches[root] = inotify_add_watch(fd, roots[root].c_str(), InotifyEvents);
+			if (rootWatches[root] < 0)
+			{
+				continue;
+			}
+			targets[rootWatches[root]] = WatchTarget{ root, std::filesystem::path() };
+			if (root == BaseRoot)
+			{
+				std::error_code ec;
+				std::filesystem::directory_iterator it(roots[BaseRoot], ec);
+				for (const std::filesystem::directory_iterator end; !ec && it != end; it.increment(ec))
+				{
+					std::error_code typeError;
+					if (it->is_directory(typeError))
+					{
+						watchSubfolder(it->path().filename());
+					}
+				}
+				RecordExistingSubfolders(now);
+			}
+		}
+
+		pollfd fds[2] = { { fd, POLLIN, 0 }, { stopPipe[0], POLLIN, 0 } };
+		const int ready = poll(fds, 2, static_cast<int>(NextTimeout(now).count()));
+		if (ready < 0 && errno != EINTR)
+		{
+			break;
+		}
+		if (fds[1].revents != 0)
+		{
+			break;
+		}
+		now = Clock::now();
+
+		for (;;)
+		{
+			const ssize_t length = read(fd, buffer, sizeof(buffer));
+			if (length <= 0)
+			{
+				break;
+			}
+			for (ssize_t offset = 0; offset < length;)
+			{
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+				offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+				if (event->mask & IN_Q_OVERFLOW)
+				{
+					PublishRescan();
+					continue;
+				}
+				auto target = targets.find(event->wd);
+				if (target == targets.end())
+				{
+					continue;
+				}
+				const WatchTarget watched = target->second;
+				if (event->mask & IN_IGNORED)
+				{
+					targets.erase(target);
+					if (watched.subfolder.empty())
+					{
+						rootWatches[watched.root] = -1; // the root is gone; looked for again later
+						PublishRescan();
+					}
+					continue;
+				}
+				if (event->len == 0)
+				{
+					continue; // events about the watched directory itself
+				}
+
+				const std::filesystem::path name(event->name);
+				EntryAction action = EntryAction::Modified;
+				if (event->mask & (IN_CREATE | IN_MOVED_TO))
+				{
+					action = EntryAction::Added;
+				}
+				else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+				{
+					action = EntryAction::Removed;
+				}
+
+				if (watched.root == BaseRoot && watched.subfolder.empty() && (event->mask & IN_ISDIR))
+				{
+					if (action == EntryAction::Added)
+					{
+						watchSubfolder(name);
+					}
+					else if (action == EntryAction::Removed)
+					{
+						unwatchSubfolder(name);
+					}
+				}
+				Record(watched.root, watched.subfolder.empty() ? name : watched.subfolder / name, action, now);
+			}
+		}
+		Flush(now);
+	}
+
+	close(fd);
+}
+
+#endif
+
+/**
+ * \brief Constructor, creates an idle watcher.
+ */
+FolderWatcher::FolderWatcher()
+	: m_state(std::make_unique<State>())
+{
+}
+
+/**
+ * \brief Destructor, stops the watcher thread.
+ */
+FolderWatcher::~FolderWatcher()
+{
+	Stop();
+}
+
+/**
+ * Starts the watcher thread.
+ *
+ * @param defaultFolder The default LocalState folder.
+ * @param customBase The folder holding the LocalState copies.
+ * @param quietMilliseconds Coalescing interval.
+ * @return false if already running or the stop signal could not be created.
+ */
+bool FolderWatcher::Start(
+	const std::filesystem::path& defaultFolder,
+	const std::filesystem::path& customBase,
+	uint32_t quietMilliseconds)
+{
+	State& state = *m_state;
+	if (state.thread.joinable())
+	{
+		return false;
+	}
+
+	state.roots[DefaultRoot] = defaultFolder;
+	state.roots[BaseRoot] = customBase;
+	state.quiet = std::chrono::milliseconds(quietMilliseconds);
+	state.stopping.store(false, std::memory_order_release);
+
+#if defined(_WIN32)
+	state.stopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	if (state.stopEvent == nullptr)
+	{
+		return false;
+	}
+#else
+	if (pipe2(state.stopPipe, O_CLOEXEC) != 0)
+	{
+		return false;
+	}
+#endif
+
+	state.thread = std::thread([&state]() { state.Run(); });
+	return true;
+}
+
+/**
+ * Signals the watcher thread and waits for it.
+ */
+void FolderWatcher::Stop()
+{
+	State& state = *m_state;
+	if (!state.thread.joinable())
+	{
+		return;
+	}
+
+	state.stopping.store(true, std::memory_order_release);
+#if defined(_WIN32)
+	SetEvent(state.stopEvent);
+#else
+	const char signal = 0;
+	(void)!write(state.stopPipe[1], &signal, 1);
+#endif
+	state.thread.join();
+
+#if defined(_WIN32)
+	CloseHandle(state.stopEvent);
+	state.stopEvent = nullptr;
+#else
+	close(state.stopPipe[0]);
+	close(state.stopPipe[1]);
+	state.stopPipe[0] = state.stopPipe[1] = -1;
+#endif
+	state.pending.clear();
+}
+
+/**
+ * Takes the next published delta.
+ *
+ * @param change Receives the delta.
+ * @return false if nothing is available right now.
+ */
+bool FolderWatcher::TryTake(FolderChange& change)
+{
+	return m_state->changes.TryPop(change);
+}
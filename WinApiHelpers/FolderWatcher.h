@@ -0,0 +1,95 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// What happened to a LocalState folder.
+		/// </summary>
+		enum class FolderChangeKind : uint8_t
+		{
+			Added,      // a subfolder of the custom base folder appeared (created, copied or renamed in)
+			Removed,    // a subfolder of the custom base folder disappeared
+			Changed,    // source files of a folder were written and are stable again
+			Rescan      // notifications were lost (buffer overflow); the consumer must reload everything
+		};
+
+		/// <summary>
+		/// One coalesced change of a LocalState folder.
+		/// </summary>
+		struct FolderChange
+		{
+			FolderChangeKind kind;
+			uint32_t sources;               // Changed: bit i set when LayoutCache::SourceNames[i] changed
+			std::filesystem::path folder;   // empty for Rescan
+		};
+
+		/// <summary>
+		/// Watches the default LocalState folder and the custom LocalState copies for changes.
+		/// </summary>
+		/// <remarks>
+		/// Uses ReadDirectoryChangesW on Windows and inotify on Linux, on one background thread. Raw
+		/// notifications are coalesced per folder until the folder has been quiet for the configured
+		/// interval. A Changed delta is published only once two samples of the source files (size, time
+		/// and content hash) taken one quiet interval apart agree, so a state.json that Windows Terminal
+		/// is still rewriting is never reported half-written. Deltas are read by a single consumer.
+		/// A custom base folder that does not exist yet is picked up as soon as it is created.
+		/// </remarks>
+		class FolderWatcher
+		{
+		public:
+			/// <summary>
+			/// Default time a folder must be quiet before its changes are published.
+			/// </summary>
+			static constexpr uint32_t DefaultQuietMilliseconds = 250;
+
+			/// <summary>
+			/// Upper bound of samples taken for a folder that keeps changing; it is published after that.
+			/// </summary>
+			static constexpr uint32_t MaxStabilitySamples = 20;
+
+			WINAPIHELPERS_API FolderWatcher();
+
+			/// <summary>
+			/// Stops the watcher thread.
+			/// </summary>
+			WINAPIHELPERS_API ~FolderWatcher();
+
+			FolderWatcher(const FolderWatcher&) = delete;
+			FolderWatcher& operator=(const FolderWatcher&) = delete;
+
+			/// <summary>
+			/// Starts watching.
+			/// </summary>
+			/// <param name="defaultFolder">The default LocalState folder; its own source files are watched.</param>
+			/// <param name="customBase">The folder holding the LocalState copies, one subfolder each.</param>
+			/// <param name="quietMilliseconds">Time without notifications before a folder is sampled.</param>
+			/// <returns>false if the watcher is already running or its thread could not be started.</returns>
+			WINAPIHELPERS_API bool Start(
+				const std::filesystem::path& defaultFolder,
+				const std::filesystem::path& customBase,
+				uint32_t quietMilliseconds = DefaultQuietMilliseconds);
+
+			/// <summary>
+			/// Stops watching and joins the watcher thread. Deltas not yet taken remain available.
+			/// </summary>
+			WINAPIHELPERS_API void Stop();
+
+			/// <summary>
+			/// Takes the next published delta; single consumer only.
+			/// </summary>
+			/// <returns>false if no delta is available right now.</returns>
+			WINAPIHELPERS_API bool TryTake(FolderChange& change);
+
+		private:
+			struct State;
+			std::unique_ptr<State> m_state;
+		};
+
+	}
+} // namespace WTLayoutManager::Services
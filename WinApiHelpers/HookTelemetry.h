@@ -0,0 +1,314 @@
+﻿#pragma once
+
+/*
+ * Telemetry channel from the injected LocalState hook back to the manager.
+ *
+ * Header-only and free of WinApiHelpers dependencies, so the hook DLL can include it as is. The
+ * manager creates one channel per launch (HookTelemetryChannel) and passes its name to the terminal
+ * in the WT_HOOK_TELEMETRY environment variable. Every hooked process of the launch (wt.exe and the
+ * Windows Terminal it starts) claims a lane of its own, so each lane is a single-producer /
+ * single-consumer ring: the hook only stores its head and the manager only stores its tail. A full
+ * ring drops the event and counts it; the hook never waits for the manager. A hook built on the
+ * writer advertises that in the page header, so the manager only waits for events from hooks that send them.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// What a hook event reports.
+		/// </summary>
+		enum class HookEventKind : uint16_t
+		{
+			Attached = 1,           // the hook runs in processId; value is the lane
+			RedirectConfigured,     // value is 1 if LocalState is redirected, 0 if the variables were missing
+			InitCompleted,          // durationNanoseconds is the time the hook spent attaching
+			FileOpenRewritten,      // one rewritten open, if the hook reports them one by one
+			Detached
+		};
+
+		/// <summary>
+		/// The counters a hook keeps per lane.
+		/// </summary>
+		/// <remarks>Append only: the page layout, and so its version, depends on the count.</remarks>
+		enum class HookCounter : uint32_t
+		{
+			FileOpens,              // opens the hook looked at
+			FileOpensRewritten,     // opens it redirected to the LocalState copy
+			RedirectFailures,       // opens it meant to redirect but could not
+			Count
+		};
+
+		constexpr size_t HookCounterCount = static_cast<size_t>(HookCounter::Count);
+
+		/// <summary>
+		/// One event; timestamps are steady_clock nanoseconds, which share an epoch across processes.
+		/// </summary>
+		struct HookEvent
+		{
+			uint64_t timestampNanoseconds;
+			uint64_t durationNanoseconds;
+			uint64_t value;
+			uint32_t processId;
+			HookEventKind kind;
+			uint16_t reserved;
+		};
+
+		static_assert(sizeof(HookEvent) == 32, "Events are part of the shared page layout");
+
+		/// <summary>
+		/// What a hook advertises in the page header once it opens a channel.
+		/// </summary>
+		enum HookCapability : uint32_t
+		{
+			HookReportsProcesses = 1    // posts Attached from every process it is injected into
+		};
+
+		/// <summary>
+		/// The layout of a channel; all zero but the header is a channel no hook attached to.
+		/// </summary>
+		struct HookTelemetryPage
+		{
+			static constexpr uint32_t Magic = 0x4C544B48;   // "HKTL"
+			static constexpr uint32_t Version = 2;
+			static constexpr size_t LaneCount = 4;
+			static constexpr size_t LaneCapacity = 256;     // a power of two: positions are masked
+
+			struct alignas(64) Lane
+			{
+				std::atomic<uint32_t> owner;                // process id of the producer; 0 while free
+				alignas(64) std::atomic<uint64_t> head;     // events published; stored by the producer only
+				std::atomic<uint64_t> dropped;              // events lost to a full ring
+				std::atomic<uint64_t> counters[HookCounterCount];
+				alignas(64) std::atomic<uint64_t> tail;     // events consumed; stored by the consumer only
+				alignas(64) HookEvent events[LaneCapacity];
+			};
+
+			uint32_t magic;
+			uint32_t version;
+			uint32_t size;
+			uint32_t laneCount;
+			uint64_t createdNanoseconds;
+			std::atomic<uint32_t> capabilities;             // HookCapability flags; set by the hooks only
+			uint32_t reserved;
+			Lane lanes[LaneCount];
+		};
+
+		static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+			"Lanes are shared between processes");
+		static_assert((HookTelemetryPage::LaneCapacity & (HookTelemetryPage::LaneCapacity - 1)) == 0, "Positions are masked");
+
+		/// <summary>
+		/// The environment variable carrying the channel name to the hook.
+		/// </summary>
+		constexpr const wchar_t* HookTelemetryVariable = L"WT_HOOK_TELEMETRY";
+
+		/// <summary>
+		/// Returns the clock of the channel's timestamps, in nanoseconds.
+		/// </summary>
+		inline uint64_t HookTelemetryNow() noexcept
+		{
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count());
+		}
+
+		/// <summary>
+		/// The hook's end of a channel.
+		/// </summary>
+		/// <remarks>
+		/// Open maps the channel named by WT_HOOK_TELEMETRY, advertises HookReportsProcesses in the header,
+		/// claims a free lane and posts Attached; without the variable, or with every lane taken, the
+		/// writer stays closed and every call does nothing. A writer belongs to one process and must not
+		/// be used by two threads at once; counters may be added from any thread. Nothing here allocates,
+		/// so it may run while the loader lock is held.
+		/// </remarks>
+		class HookTelemetryWriter
+		{
+		public:
+			HookTelemetryWriter() noexcept = default;
+			~HookTelemetryWriter() { Close(); }
+
+			HookTelemetryWriter(const HookTelemetryWriter&) = delete;
+			HookTelemetryWriter& operator=(const HookTelemetryWriter&) = delete;
+
+			/// <summary>
+			/// Opens the channel named in the environment.
+			/// </summary>
+			/// <returns>false if there is none or it cannot be used; the hook runs on without telemetry.</returns>
+			bool Open() noexcept
+			{
+#if defined(_WIN32)
+				wchar_t name[128];
+				const DWORD length = ::GetEnvironmentVariableW(HookTelemetryVariable, name, static_cast<DWORD>(std::size(name)));
+				return length > 0 && length < std::size(name) && Open(name);
+#else
+				char variable[32];
+				size_t i = 0;
+				for (; HookTelemetryVariable[i] != L'\0'; ++i)
+				{
+					variable[i] = static_cast<char>(HookTelemetryVariable[i]);
+				}
+				variable[i] = '\0';
+				const char* name = std::getenv(variable);
+				return name != nullptr && OpenNarrow(name);
+#endif
+			}
+
+			/// <summary>
+			/// Opens a channel by name.
+			/// </summary>
+			bool Open(const wchar_t* name) noexcept
+			{
+				Close();
+#if defined(_WIN32)
+				HANDLE mapping = ::OpenFileMappingW(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, name);
+				if (mapping == nullptr)
+				{
+					return false;
+				}
+				void* view = ::MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(HookTelemetryPage));
+				::CloseHandle(mapping);     // the view keeps the mapping alive
+				return view != nullptr && Claim(static_cast<HookTelemetryPage*>(view));
+#else
+				char narrow[128];
+				size_t i = 0;
+				for (; name[i] != L'\0' && i + 1 < sizeof(narrow); ++i)
+				{
+					narrow[i] = static_cast<char>(name[i]);
+				}
+				narrow[i] = '\0';
+				return name[i] == L'\0' && OpenNarrow(narrow);
+#endif
+			}
+
+			bool IsOpen() const noexcept
+			{
+				return m_lane != nullptr;
+			}
+
+			/// <summary>
+			/// Publishes an event, or counts it as dropped if the manager has not caught up.
+			/// </summary>
+			void Post(HookEventKind kind, uint64_t value = 0, uint64_t durationNanoseconds = 0) noexcept
+			{
+				if (m_lane == nullptr)
+				{
+					return;
+				}
+				const uint64_t head = m_lane->head.load(std::memory_order_relaxed);
+				if (head - m_lane->tail.load(std::memory_order_acquire) >= HookTelemetryPage::LaneCapacity)
+				{
+					m_lane->dropped.fetch_add(1, std::memory_order_relaxed);
+					return;
+				}
+				HookEvent& event = m_lane->events[head & (HookTelemetryPage::LaneCapacity - 1)];
+				event.timestampNanoseconds = HookTelemetryNow();
+				event.durationNanoseconds = durationNanoseconds;
+				event.value = value;
+				event.processId = m_processId;
+				event.kind = kind;
+				event.reserved = 0;
+				m_lane->head.store(head + 1, std::memory_order_release);
+			}
+
+			/// <summary>
+			/// Adds to a counter; safe from any thread of the hooked process.
+			/// </summary>
+			void Add(HookCounter counter, uint64_t delta = 1) noexcept
+			{
+				if (m_lane != nullptr)
+				{
+					m_lane->counters[static_cast<size_t>(counter)].fetch_add(delta, std::memory_order_relaxed);
+				}
+			}
+
+			/// <summary>
+			/// Posts Detached and unmaps the channel. The lane stays claimed, so the manager reads what is left.
+			/// </summary>
+			void Close() noexcept
+			{
+				if (m_page == nullptr)
+				{
+					return;
+				}
+				Post(HookEventKind::Detached);
+#if defined(_WIN32)
+				::UnmapViewOfFile(m_page);
+#else
+				::munmap(m_page, sizeof(HookTelemetryPage));
+#endif
+				m_page = nullptr;
+				m_lane = nullptr;
+			}
+
+		private:
+#if !defined(_WIN32)
+			bool OpenNarrow(const char* name) noexcept
+			{
+				Close();
+				const int fd = ::shm_open(name, O_RDWR, 0);
+				if (fd < 0)
+				{
+					return false;
+				}
+				void* view = ::mmap(nullptr, sizeof(HookTelemetryPage), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				::close(fd);
+				return view != MAP_FAILED && Claim(static_cast<HookTelemetryPage*>(view));
+			}
+#endif
+
+			/// Checks the header, advertises the writer's capabilities, claims the first free lane and posts Attached.
+			bool Claim(HookTelemetryPage* page) noexcept
+			{
+				m_page = page;
+#if defined(_WIN32)
+				m_processId = ::GetCurrentProcessId();
+#else
+				m_processId = static_cast<uint32_t>(::getpid());
+#endif
+				if (page->magic == HookTelemetryPage::Magic && page->version == HookTelemetryPage::Version
+					&& page->size == sizeof(HookTelemetryPage) && page->laneCount == HookTelemetryPage::LaneCount)
+				{
+					page->capabilities.fetch_or(HookReportsProcesses, std::memory_order_release);
+					for (size_t i = 0; i < HookTelemetryPage::LaneCount; ++i)
+					{
+						uint32_t free = 0;
+						if (page->lanes[i].owner.compare_exchange_strong(free, m_processId, std::memory_order_acq_rel))
+						{
+							m_lane = &page->lanes[i];
+							Post(HookEventKind::Attached, i);
+							return true;
+						}
+					}
+				}
+#if defined(_WIN32)
+				::UnmapViewOfFile(page);
+#else
+				::munmap(page, sizeof(HookTelemetryPage));
+#endif
+				m_page = nullptr;
+				return false;
+			}
+
+			HookTelemetryPage* m_page = nullptr;
+			HookTelemetryPage::Lane* m_lane = nullptr;
+			uint32_t m_processId = 0;
+		};
+
+	}
+} // namespace WTLayoutManager::Services
@@ -0,0 +1,220 @@
+﻿#include "pch.h"
+#include "HookTelemetryChannel.h"
+#include <atomic>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <sddl.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+#if defined(_WIN32)
+	// Same as the metrics page: an elevated terminal must be able to attach to the app's channel.
+	constexpr const wchar_t* PageSecurity = L"D:P(A;;GA;;;SY)(A;;GA;;;BA)(A;;GA;;;IU)S:(ML;;NW;;;ME)";
+#endif
+
+	uint32_t CurrentProcessId() noexcept
+	{
+#if defined(_WIN32)
+		return ::GetCurrentProcessId();
+#else
+		return static_cast<uint32_t>(::getpid());
+#endif
+	}
+
+	/// Channels of this process are told apart by a sequence number.
+	std::atomic<uint32_t> s_sequence{ 0 };
+}
+
+struct HookTelemetryChannel::State
+{
+	HookTelemetryPage* page = nullptr;
+	std::wstring name;
+
+	~State()
+	{
+		Close();
+	}
+
+	void Close() noexcept
+	{
+		if (page != nullptr)
+		{
+#if defined(_WIN32)
+			::UnmapViewOfFile(page);
+#else
+			::munmap(page, sizeof(HookTelemetryPage));
+			::shm_unlink(std::string(name.begin(), name.end()).c_str());
+#endif
+			page = nullptr;
+		}
+		name.clear();
+	}
+};
+
+HookTelemetryChannel::HookTelemetryChannel()
+	: m_state(std::make_unique<State>())
+{
+}
+
+HookTelemetryChannel::~HookTelemetryChannel() = default;
+
+/**
+ * Creates the page of a new channel under a name unique to this process.
+ *
+ * @return true if the page is mapped and initialized.
+ */
+bool HookTelemetryChannel::Create()
+{
+	m_state->Close();
+
+	const std::wstring suffix = L"WTLayoutManager.HookTelemetry." + std::to_wstring(CurrentProcessId()) + L"." +
+		std::to_wstring(s_sequence.fetch_add(1, std::memory_order_relaxed));
+	void* view = nullptr;
+#if defined(_WIN32)
+	const std::wstring name = L"Local\\" + suffix;
+	SECURITY_ATTRIBUTES attributes{ sizeof(attributes), nullptr, FALSE };
+	PSECURITY_DESCRIPTOR descriptor = nullptr;
+	if (ConvertStringSecurityDescriptorToSecurityDescriptorW(PageSecurity, SDDL_REVISION_1, &descriptor, nullptr))
+	{
+		attributes.lpSecurityDescriptor = descriptor;
+	}
+	HANDLE mapping = ::CreateFileMappingW(INVALID_HANDLE_VALUE, &attributes, PAGE_READWRITE,
+		0, static_cast<DWORD>(sizeof(HookTelemetryPage)), name.c_str());
+	const DWORD error = ::GetLastError();
+	if (descriptor != nullptr)
+	{
+		::LocalFree(descriptor);
+	}
+	if (mapping == nullptr)
+	{
+		return false;
+	}
+	if (error == ERROR_ALREADY_EXISTS)
+	{
+		::CloseHandle(mapping); // left over by a process that had our id; never share a page with it
+		return false;
+	}
+	// The view keeps the mapping alive.
+	view = ::MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(HookTelemetryPage));
+	::CloseHandle(mapping);
+#else
+	const std::wstring name = L"/" + suffix;
+	const std::string narrow(name.begin(), name.end());
+	::shm_unlink(narrow.c_str()); // left over by a process that had our id
+	const int fd = ::shm_open(narrow.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0)
+	{
+		return false;
+	}
+	if (::ftruncate(fd, sizeof(HookTelemetryPage)) == 0)
+	{
+		view = ::mmap(nullptr, sizeof(HookTelemetryPage), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		view = view == MAP_FAILED ? nullptr : view;
+	}
+	::close(fd);
+	if (view == nullptr)
+	{
+		::shm_unlink(narrow.c_str());
+	}
+#endif
+	if (view == nullptr)
+	{
+		return false;
+	}
+
+	// A new page is zero, every lane free and empty; only the header needs writing, and the name is
+	// handed to the terminal after this, so no hook can see the page half initialized.
+	HookTelemetryPage* page = static_cast<HookTelemetryPage*>(view);
+	page->magic = HookTelemetryPage::Magic;
+	page->version = HookTelemetryPage::Version;
+	page->size = static_cast<uint32_t>(sizeof(HookTelemetryPage));
+	page->laneCount = static_cast<uint32_t>(HookTelemetryPage::LaneCount);
+	page->createdNanoseconds = HookTelemetryNow();
+	m_state->page = page;
+	m_state->name = name;
+	return true;
+}
+
+bool HookTelemetryChannel::IsOpen() const noexcept
+{
+	return m_state->page != nullptr;
+}
+
+const std::wstring& HookTelemetryChannel::Name() const noexcept
+{
+	return m_state->name;
+}
+
+uint32_t HookTelemetryChannel::Capabilities() const noexcept
+{
+	const HookTelemetryPage* page = m_state->page;
+	return page != nullptr ? page->capabilities.load(std::memory_order_acquire) : 0;
+}
+
+/**
+ * Drains the lanes.
+ *
+ * @param events Receives the events.
+ * @param capacity The size of the buffer; events that do not fit stay pending for the next call.
+ * @return The number of events stored.
+ */
+size_t HookTelemetryChannel::Read(HookEvent* events, size_t capacity) noexcept
+{
+	HookTelemetryPage* page = m_state->page;
+	if (page == nullptr)
+	{
+		return 0;
+	}
+	size_t count = 0;
+	for (HookTelemetryPage::Lane& lane : page->lanes)
+	{
+		if (count == capacity)
+		{
+			break;
+		}
+		if (lane.owner.load(std::memory_order_acquire) == 0)
+		{
+			break; // lanes are claimed in order
+		}
+		uint64_t tail = lane.tail.load(std::memory_order_relaxed);
+		const uint64_t head = lane.head.load(std::memory_order_acquire);
+		for (; tail != head && count < capacity; ++tail)
+		{
+			events[count++] = lane.events[tail & (HookTelemetryPage::LaneCapacity - 1)];
+		}
+		lane.tail.store(tail, std::memory_order_release);
+	}
+	return count;
+}
+
+HookTelemetryTotals HookTelemetryChannel::Totals() const noexcept
+{
+	HookTelemetryTotals totals{};
+	const HookTelemetryPage* page = m_state->page;
+	if (page == nullptr)
+	{
+		return totals;
+	}
+	for (const HookTelemetryPage::Lane& lane : page->lanes)
+	{
+		if (lane.owner.load(std::memory_order_acquire) == 0)
+		{
+			break;
+		}
+		++totals.lanes;
+		totals.dropped += lane.dropped.load(std::memory_order_relaxed);
+		for (size_t i = 0; i < HookCounterCount; ++i)
+		{
+			totals.counters[i] += lane.counters[i].load(std::memory_order_relaxed);
+		}
+	}
+	return totals;
+}
@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include "HookTelemetry.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// Totals of a channel across the lanes of every hooked process.
+		/// </summary>
+		struct HookTelemetryTotals
+		{
+			std::array<uint64_t, HookCounterCount> counters;
+			uint64_t dropped;       // events the hooks could not publish because a ring was full
+			uint32_t lanes;         // processes that attached
+		};
+
+		/// <summary>
+		/// The manager's end of a per-launch telemetry channel (see HookTelemetry.h).
+		/// </summary>
+		/// <remarks>
+		/// Create maps a fresh, uniquely named page; pass Name() to the terminal in WT_HOOK_TELEMETRY
+		/// (HookTelemetryVariable) and the hook injected into it attaches and posts events. Read and Totals
+		/// may be called from one thread at a time; the hooks write concurrently without waiting for it.
+		/// The page lives as long as the channel or the last hook that still maps it.
+		/// </remarks>
+		class HookTelemetryChannel
+		{
+		public:
+			WINAPIHELPERS_API HookTelemetryChannel();
+			WINAPIHELPERS_API ~HookTelemetryChannel();
+
+			HookTelemetryChannel(const HookTelemetryChannel&) = delete;
+			HookTelemetryChannel& operator=(const HookTelemetryChannel&) = delete;
+
+			/// <summary>
+			/// Maps a new channel, replacing any previous one.
+			/// </summary>
+			/// <returns>false if no page could be created; the launch goes on without telemetry.</returns>
+			WINAPIHELPERS_API bool Create();
+
+			WINAPIHELPERS_API bool IsOpen() const noexcept;
+
+			/// <summary>
+			/// The name the hook opens the channel by; empty while closed.
+			/// </summary>
+			WINAPIHELPERS_API const std::wstring& Name() const noexcept;
+
+			/// <summary>
+			/// The HookCapability flags the hooks that opened the channel advertised; 0 while none has.
+			/// </summary>
+			WINAPIHELPERS_API uint32_t Capabilities() const noexcept;
+
+			/// <summary>
+			/// Moves the pending events of every lane into a buffer, oldest first within a lane.
+			/// </summary>
+			/// <returns>The number of events stored, at most capacity.</returns>
+			WINAPIHELPERS_API size_t Read(HookEvent* events, size_t capacity) noexcept;
+
+			/// <summary>
+			/// Sums the counters of every lane.
+			/// </summary>
+			WINAPIHELPERS_API HookTelemetryTotals Totals() const noexcept;
+
+		private:
+			struct State;
+			std::unique_ptr<State> m_state;
+		};
+
+	}
+} // namespace WTLayoutManager::Services
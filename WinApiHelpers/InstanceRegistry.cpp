@@ -0,0 +1,449 @@
+﻿#include "pch.h"
+#include "InstanceRegistry.h"
+#include <atomic>
+#include <chrono>
+#include <cwctype>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <sddl.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	// The state word of a slot: the kind in the low two bits, a generation above them that every
+	// transition increments, so a reader or an unregister can tell that the slot changed under it.
+	// While a slot is being written the upper half holds the process that claimed it, so a claim
+	// abandoned by a writer that died is recognized from the word alone.
+	constexpr uint64_t KindMask = 3;
+	constexpr uint64_t Empty = 0;       // never used; ends a probe
+	constexpr uint64_t Writing = 1;     // claimed, fields being written
+	constexpr uint64_t Live = 2;
+	constexpr uint64_t Dead = 3;        // free for reuse, but a probe goes on past it
+
+	constexpr uint64_t GenerationMask = 0xFFFFFFFF;
+	constexpr int ClaimOwnerShift = 32;
+	constexpr uint64_t TokenGenerationMask = GenerationMask;
+
+	/// A claim is published within microseconds; one older than this belongs to a stalled or recycled owner.
+	constexpr uint64_t StaleClaimMs = 10000;
+
+	constexpr uint64_t ElevatedFlag = 1;
+
+	/// One cache line; every field is atomic because other processes write it concurrently.
+	struct alignas(64) InstanceSlot
+	{
+		std::atomic<uint64_t> state;
+		std::atomic<uint64_t> pathHash;
+		std::atomic<uint64_t> processStartTime;
+		std::atomic<uint64_t> registeredUnixMs;
+		std::atomic<uint32_t> processId;
+		std::atomic<uint32_t> ownerProcessId;
+		std::atomic<uint64_t> flags;
+		std::atomic<uint64_t> claim;    // the Writing state word whose claim time registeredUnixMs holds
+	};
+
+	static_assert(sizeof(InstanceSlot) == 64, "A slot is one cache line");
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "Slots are shared between processes");
+
+	/// All zero is a valid empty table, so the creator has nothing to initialize.
+	struct InstancePage
+	{
+		InstanceSlot slots[InstanceRegistry::Capacity];
+	};
+
+	static_assert((InstanceRegistry::Capacity & (InstanceRegistry::Capacity - 1)) == 0, "Probing masks the index");
+
+	constexpr uint64_t Next(uint64_t state, uint64_t kind) noexcept
+	{
+		return (((state & GenerationMask & ~KindMask) + (KindMask + 1)) & GenerationMask) | kind;
+	}
+
+	constexpr uint64_t Claim(uint64_t state, uint32_t ownerProcessId) noexcept
+	{
+		return Next(state, Writing) | (static_cast<uint64_t>(ownerProcessId) << ClaimOwnerShift);
+	}
+
+#if defined(_WIN32)
+	// Same as the metrics page: the elevated launcher and the app share it whichever creates it.
+	constexpr const wchar_t* PageSecurity = L"D:P(A;;GA;;;SY)(A;;GA;;;BA)(A;;GA;;;IU)S:(ML;;NW;;;ME)";
+#endif
+
+	InstancePage* MapPage() noexcept
+	{
+#if defined(_WIN32)
+		SECURITY_ATTRIBUTES attributes{ sizeof(attributes), nullptr, FALSE };
+		PSECURITY_DESCRIPTOR descriptor = nullptr;
+		if (ConvertStringSecurityDescriptorToSecurityDescriptorW(PageSecurity, SDDL_REVISION_1, &descriptor, nullptr))
+		{
+			attributes.lpSecurityDescriptor = descriptor;
+		}
+		HANDLE mapping = ::CreateFileMappingW(INVALID_HANDLE_VALUE, &attributes, PAGE_READWRITE,
+			0, static_cast<DWORD>(sizeof(InstancePage)), InstanceRegistry::PageName);
+		if (descriptor != nullptr)
+		{
+			::LocalFree(descriptor);
+		}
+		if (mapping == nullptr)
+		{
+			return nullptr;
+		}
+		// The view keeps the mapping alive.
+		void* view = ::MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(InstancePage));
+		::CloseHandle(mapping);
+		return static_cast<InstancePage*>(view);
+#else
+		const int fd = ::shm_open(InstanceRegistry::PageName, O_RDWR | O_CREAT, 0600);
+		if (fd < 0)
+		{
+			return nullptr;
+		}
+		// Whoever comes first extends the object; the new bytes are zero, an empty table.
+		struct stat st {};
+		if (::fstat(fd, &st) != 0 ||
+			(st.st_size < static_cast<off_t>(sizeof(InstancePage)) && ::ftruncate(fd, sizeof(InstancePage)) != 0))
+		{
+			::close(fd);
+			return nullptr;
+		}
+		void* view = ::mmap(nullptr, sizeof(InstancePage), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		return view == MAP_FAILED ? nullptr : static_cast<InstancePage*>(view);
+#endif
+	}
+
+	/// The page of this process, mapped on first use and until the process exits.
+	InstancePage& Page() noexcept
+	{
+		static InstancePage* const page = []() noexcept {
+			InstancePage* mapped = MapPage();
+			if (mapped != nullptr)
+			{
+				return mapped;
+			}
+			static InstancePage privatePage{};
+			return &privatePage;
+		}();
+		return *page;
+	}
+
+	/**
+	 * Reads the start time of a process, which together with its id identifies it.
+	 *
+	 * @return false if the process does not exist or cannot be queried.
+	 */
+	bool ProcessStartTime(uint32_t processId, uint64_t& startTime) noexcept
+	{
+#if defined(_WIN32)
+		HANDLE process = ::OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+		if (process == nullptr)
+		{
+			return false;
+		}
+		FILETIME created{}, exited{}, kernel{}, user{};
+		DWORD exitCode = 0;
+		const bool alive = ::GetProcessTimes(process, &created, &exited, &kernel, &user) &&
+			::GetExitCodeProcess(process, &exitCode) && exitCode == STILL_ACTIVE;
+		::CloseHandle(process);
+		startTime = (static_cast<uint64_t>(created.dwHighDateTime) << 32) | created.dwLowDateTime;
+		return alive;
+#else
+		try
+		{
+			std::ifstream file("/proc/" + std::to_string(processId) + "/stat");
+			std::string line;
+			if (!std::getline(file, line))
+			{
+				return false;
+			}
+			// Field 22 is the start time; fields are counted from the state (field 3) after the command.
+			size_t position = line.rfind(')');
+			if (position == std::string::npos || line.size() < position + 2)
+			{
+				return false;
+			}
+			position += 2;
+			if (line[position] == 'Z' || line[position] == 'X')
+			{
+				return false; // exited, not yet reaped
+			}
+			for (int field = 3; field < 22 && position != std::string::npos; ++field)
+			{
+				position = line.find(' ', position);
+				position = position == std::string::npos ? position : position + 1;
+			}
+			if (position == std::string::npos)
+			{
+				return false;
+			}
+			startTime = std::strtoull(line.c_str() + position, nullptr, 10);
+			return true;
+		}
+		catch (...)
+		{
+			return false;
+		}
+#endif
+	}
+
+	uint32_t CurrentProcessId() noexcept
+	{
+#if defined(_WIN32)
+		return ::GetCurrentProcessId();
+#else
+		return static_cast<uint32_t>(::getpid());
+#endif
+	}
+
+	/**
+	 * Copies a live slot without tearing.
+	 *
+	 * @param state Receives the state word the copy is consistent with.
+	 * @return false if the slot is not live.
+	 */
+	bool ReadSlot(const InstanceSlot& slot, RunningInstance& instance, uint64_t& state) noexcept
+	{
+		for (;;)
+		{
+			state = slot.state.load(std::memory_order_acquire);
+			if ((state & KindMask) != Live)
+			{
+				return false;
+			}
+			instance.pathHash = slot.pathHash.load(std::memory_order_relaxed);
+			instance.processId = slot.processId.load(std::memory_order_relaxed);
+			instance.ownerProcessId = slot.ownerProcessId.load(std::memory_order_relaxed);
+			instance.processStartTime = slot.processStartTime.load(std::memory_order_relaxed);
+			instance.registeredUnixMs = slot.registeredUnixMs.load(std::memory_order_relaxed);
+			instance.elevated = (slot.flags.load(std::memory_order_relaxed) & ElevatedFlag) != 0;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.state.load(std::memory_order_relaxed) == state)
+			{
+				return true;
+			}
+		}
+	}
+
+	bool IsAlive(const RunningInstance& instance) noexcept
+	{
+		uint64_t startTime = 0;
+		return ProcessStartTime(instance.processId, startTime) && startTime == instance.processStartTime;
+	}
+
+	/// Marks a slot dead if it still holds the state it was read with.
+	bool Kill(InstanceSlot& slot, uint64_t state) noexcept
+	{
+		return slot.state.compare_exchange_strong(state, Next(state, Dead), std::memory_order_acq_rel);
+	}
+
+	uint64_t UnixMilliseconds() noexcept
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count());
+	}
+
+	/**
+	 * Marks a claim dead if the process that made it exited, or if it was made too long ago.
+	 *
+	 * The claim time is trusted only once the claimer has stamped it with its state word; before that
+	 * the field may still hold the time of the slot's previous entry.
+	 *
+	 * @param state The Writing state word the slot was read with.
+	 * @return true if the claim was reclaimed.
+	 */
+	bool ReclaimAbandoned(InstanceSlot& slot, uint64_t state) noexcept
+	{
+		const uint32_t owner = static_cast<uint32_t>(state >> ClaimOwnerShift);
+		uint64_t startTime = 0;
+		bool abandoned = !ProcessStartTime(owner, startTime);
+		if (!abandoned && slot.claim.load(std::memory_order_acquire) == state)
+		{
+			const uint64_t claimed = slot.registeredUnixMs.load(std::memory_order_relaxed);
+			const uint64_t now = UnixMilliseconds();
+			abandoned = now > claimed && now - claimed > StaleClaimMs;
+		}
+		return abandoned && Kill(slot, state);
+	}
+}
+
+/**
+ * FNV-1a over the UTF-16 code units of the path, lowercased, with '/' as '\' and without trailing separators.
+ *
+ * @param folder The LocalState folder.
+ * @return The hash.
+ */
+uint64_t InstanceRegistry::HashPath(std::wstring_view folder) noexcept
+{
+	while (!folder.empty() && (folder.back() == L'\\' || folder.back() == L'/'))
+	{
+		folder.remove_suffix(1);
+	}
+	uint64_t hash = 14695981039346656037ull;
+	for (wchar_t ch : folder)
+	{
+		const uint16_t unit = static_cast<uint16_t>(ch == L'/' ? L'\\' : std::towlower(ch));
+		hash = (hash ^ (unit & 0xFF)) * 1099511628211ull;
+		hash = (hash ^ (unit >> 8)) * 1099511628211ull;
+	}
+	return hash;
+}
+
+/**
+ * Claims the first free or dead slot on the probe path of the folder.
+ *
+ * @param folder The LocalState folder.
+ * @param processId The terminal process.
+ * @param elevated Whether it runs elevated.
+ * @return The token, or 0.
+ */
+uint64_t InstanceRegistry::Register(std::wstring_view folder, uint32_t processId, bool elevated) noexcept
+{
+	uint64_t startTime = 0;
+	if (!ProcessStartTime(processId, startTime))
+	{
+		return 0;
+	}
+	const uint64_t hash = HashPath(folder);
+	const uint32_t owner = CurrentProcessId();
+
+	InstancePage& page = Page();
+	for (size_t probe = 0; probe < Capacity; ++probe)
+	{
+		const size_t index = static_cast<size_t>(hash + probe) & (Capacity - 1);
+		InstanceSlot& slot = page.slots[index];
+		uint64_t state = slot.state.load(std::memory_order_acquire);
+		if ((state & KindMask) == Live)
+		{
+			// Reclaim the slots of exited terminals on the way.
+			RunningInstance existing;
+			if (ReadSlot(slot, existing, state) && !IsAlive(existing) && Kill(slot, state))
+			{
+				state = Next(state, Dead);
+			}
+		}
+		else if ((state & KindMask) == Writing && ReclaimAbandoned(slot, state))
+		{
+			// ... and the claims of writers that died or stalled before publishing.
+			state = Next(state, Dead);
+		}
+		const uint64_t kind = state & KindMask;
+		if (kind != Empty && kind != Dead)
+		{
+			continue;
+		}
+		const uint64_t writing = Claim(state, owner);
+		if (!slot.state.compare_exchange_strong(state, writing, std::memory_order_acquire))
+		{
+			continue;
+		}
+		slot.registeredUnixMs.store(UnixMilliseconds(), std::memory_order_relaxed);
+		slot.claim.store(writing, std::memory_order_release);
+		slot.pathHash.store(hash, std::memory_order_relaxed);
+		slot.processId.store(processId, std::memory_order_relaxed);
+		slot.ownerProcessId.store(owner, std::memory_order_relaxed);
+		slot.processStartTime.store(startTime, std::memory_order_relaxed);
+		slot.flags.store(elevated ? ElevatedFlag : 0, std::memory_order_relaxed);
+		const uint64_t live = Next(writing, Live);
+		state = writing;
+		if (!slot.state.compare_exchange_strong(state, live, std::memory_order_release))
+		{
+			continue; // reclaimed as stale while this thread stalled; the slot is someone else's now
+		}
+		return (static_cast<uint64_t>(index + 1) << 48) | (live & TokenGenerationMask);
+	}
+	return 0;
+}
+
+void InstanceRegistry::Unregister(uint64_t token) noexcept
+{
+	const size_t index = static_cast<size_t>(token >> 48);
+	if (index == 0 || index > Capacity)
+	{
+		return;
+	}
+	InstanceSlot& slot = Page().slots[index - 1];
+	uint64_t state = slot.state.load(std::memory_order_acquire);
+	if ((state & TokenGenerationMask) == (token & TokenGenerationMask))
+	{
+		Kill(slot, state);
+	}
+}
+
+/**
+ * Probes the folder's slots until an empty one, skipping and sweeping entries of exited processes.
+ *
+ * @param folder The LocalState folder.
+ * @param elevated The elevation to match.
+ * @param instance Receives the entry.
+ * @return false if no live terminal runs the folder.
+ */
+bool InstanceRegistry::Find(std::wstring_view folder, bool elevated, RunningInstance& instance) noexcept
+{
+	const uint64_t hash = HashPath(folder);
+	InstancePage& page = Page();
+	for (size_t probe = 0; probe < Capacity; ++probe)
+	{
+		InstanceSlot& slot = page.slots[static_cast<size_t>(hash + probe) & (Capacity - 1)];
+		uint64_t state = slot.state.load(std::memory_order_acquire);
+		if ((state & KindMask) == Empty)
+		{
+			return false;
+		}
+		RunningInstance candidate;
+		if (!ReadSlot(slot, candidate, state) || candidate.pathHash != hash || candidate.elevated != elevated)
+		{
+			continue;
+		}
+		if (!IsAlive(candidate))
+		{
+			Kill(slot, state);
+			continue;
+		}
+		instance = candidate;
+		return true;
+	}
+	return false;
+}
+
+size_t InstanceRegistry::Sweep() noexcept
+{
+	size_t removed = 0;
+	for (InstanceSlot& slot : Page().slots)
+	{
+		RunningInstance instance;
+		uint64_t state = 0;
+		if (ReadSlot(slot, instance, state) ? !IsAlive(instance) && Kill(slot, state)
+			: (state & KindMask) == Writing && ReclaimAbandoned(slot, state))
+		{
+			++removed;
+		}
+	}
+	return removed;
+}
+
+std::vector<RunningInstance> InstanceRegistry::Snapshot()
+{
+	std::vector<RunningInstance> instances;
+	for (const InstanceSlot& slot : Page().slots)
+	{
+		RunningInstance instance;
+		uint64_t state = 0;
+		if (ReadSlot(slot, instance, state))
+		{
+			instances.push_back(instance);
+		}
+	}
+	return instances;
+}
@@ -0,0 +1,107 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// A terminal registered as running a LocalState folder.
+		/// </summary>
+		struct RunningInstance
+		{
+			uint64_t pathHash;
+			uint32_t processId;             // the WindowsTerminal.exe process
+			uint32_t ownerProcessId;        // the app or launcher that registered it
+			uint64_t processStartTime;      // tells a reused process id apart
+			uint64_t registeredUnixMs;
+			bool elevated;
+		};
+
+		/// <summary>
+		/// Machine-wide table of the terminals running a LocalState folder, in a named shared memory page.
+		/// </summary>
+		/// <remarks>
+		/// Every app instance and every elevated launcher maps the same page, so a layout started by any of
+		/// them, or before the app restarted, is found by all. The page is an open-addressed table of
+		/// Capacity slots probed linearly from the hash of the folder path. Each slot is guarded by one
+		/// atomic word holding its state and a generation: a writer claims a free or dead slot with a
+		/// compare-exchange and publishes it with a second one, a reader copies a slot and rereads the
+		/// word to detect a concurrent change, and removal is one compare-exchange to dead. Nothing ever
+		/// waits. A slot whose process exited, or whose process id was reused, is marked dead by whoever
+		/// meets it, so entries of crashed owners do not linger; so is a claim left unpublished because its
+		/// writer exited or stalled for seconds. If the page cannot be mapped a private table is used and
+		/// only this process sees its entries.
+		/// </remarks>
+		class InstanceRegistry
+		{
+		public:
+#if defined(_WIN32)
+			static constexpr const wchar_t* PageName = L"Local\\WTLayoutManager.Instances.v2";
+#else
+			static constexpr const char* PageName = "/WTLayoutManager.Instances.v2";
+#endif
+			static constexpr size_t Capacity = 256;
+
+			/// <summary>
+			/// Hashes a folder path, ignoring case, the separator style and trailing separators.
+			/// </summary>
+			WINAPIHELPERS_API static uint64_t HashPath(std::wstring_view folder) noexcept;
+
+			/// <summary>
+			/// Records that a terminal process runs a folder.
+			/// </summary>
+			/// <returns>The token to unregister with, or 0 if the process is gone or the table is full.</returns>
+			WINAPIHELPERS_API static uint64_t Register(std::wstring_view folder, uint32_t processId, bool elevated) noexcept;
+
+			/// <summary>
+			/// Removes an entry; does nothing if it was already swept.
+			/// </summary>
+			WINAPIHELPERS_API static void Unregister(uint64_t token) noexcept;
+
+			/// <summary>
+			/// Finds a live terminal running a folder with the given elevation.
+			/// </summary>
+			WINAPIHELPERS_API static bool Find(std::wstring_view folder, bool elevated, RunningInstance& instance) noexcept;
+
+			/// <summary>
+			/// Marks the entries of exited processes dead.
+			/// </summary>
+			/// <returns>The number of entries removed.</returns>
+			WINAPIHELPERS_API static size_t Sweep() noexcept;
+
+			/// <summary>
+			/// Returns every live entry.
+			/// </summary>
+			WINAPIHELPERS_API static std::vector<RunningInstance> Snapshot();
+		};
+
+		/// <summary>
+		/// Keeps a terminal registered for the lifetime of a scope.
+		/// </summary>
+		class RegisteredInstance
+		{
+		public:
+			RegisteredInstance(std::wstring_view folder, uint32_t processId, bool elevated) noexcept
+				: m_token(folder.empty() ? 0 : InstanceRegistry::Register(folder, processId, elevated))
+			{
+			}
+
+			~RegisteredInstance()
+			{
+				InstanceRegistry::Unregister(m_token);
+			}
+
+			RegisteredInstance(const RegisteredInstance&) = delete;
+			RegisteredInstance& operator=(const RegisteredInstance&) = delete;
+
+		private:
+			uint64_t m_token;
+		};
+
+	}
+} // namespace WTLayoutManager::Services
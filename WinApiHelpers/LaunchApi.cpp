@@ -0,0 +1,264 @@
+﻿#include "pch.h"
+#include "LaunchApi.h"
+#include "TerminalLauncher.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+using namespace WTLayoutManager::Services;
+
+/// The handle behind WTLM_Launch: a launch and the backend that started it.
+struct WTLM_Launch
+{
+	std::shared_ptr<LaunchBackend> backend;
+	std::unique_ptr<TerminalLaunch> launch;
+};
+
+namespace
+{
+	/**
+	 * Converts a borrowed UTF-16 string, decoding surrogate pairs where wchar_t is 32 bits wide.
+	 *
+	 * @return false if the string has a length but no characters.
+	 */
+	bool ToWide(const WTLM_String& text, std::wstring& wide)
+	{
+		wide.clear();
+		if (text.length == 0)
+		{
+			return true;
+		}
+		if (text.chars == nullptr)
+		{
+			return false;
+		}
+		if constexpr (sizeof(wchar_t) == sizeof(uint16_t))
+		{
+			wide.assign(reinterpret_cast<const wchar_t*>(text.chars), text.length);
+		}
+		else
+		{
+			wide.reserve(text.length);
+			for (uint32_t i = 0; i < text.length; ++i)
+			{
+				uint32_t unit = text.chars[i];
+				if (unit >= 0xD800 && unit < 0xDC00 && i + 1 < text.length
+					&& text.chars[i + 1] >= 0xDC00 && text.chars[i + 1] < 0xE000)
+				{
+					unit = 0x10000 + ((unit - 0xD800) << 10) + (text.chars[++i] - 0xDC00);
+				}
+				wide.push_back(static_cast<wchar_t>(unit));
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Splits a block of NUL-terminated NAME=VALUE entries; empty entries are skipped and a missing
+	 * last NUL is tolerated.
+	 */
+	void SplitEnvironment(const std::wstring& block, std::vector<std::wstring>& entries)
+	{
+		size_t start = 0;
+		while (start < block.size())
+		{
+			size_t end = block.find(L'\0', start);
+			if (end == std::wstring::npos)
+			{
+				end = block.size();
+			}
+			if (end > start)
+			{
+				entries.emplace_back(block, start, end - start);
+			}
+			start = end + 1;
+		}
+	}
+
+	/**
+	 * Validates a request and converts it.
+	 *
+	 * @return WTLM_OK, WTLM_E_VERSION or WTLM_E_INVALID_ARGUMENT.
+	 */
+	WTLM_Status ToRequest(const WTLM_LaunchRequest& source, TerminalLaunchRequest& request)
+	{
+		if (source.size != sizeof(WTLM_LaunchRequest))
+		{
+			return WTLM_E_VERSION;
+		}
+		const bool elevated = (source.flags & WTLM_LAUNCH_ELEVATED) != 0;
+		if ((source.flags & ~(WTLM_LAUNCH_ELEVATED | WTLM_LAUNCH_STAGGER_RESUME)) != 0
+			|| source.priority < static_cast<int32_t>(LaunchPriority::Idle) || source.priority > static_cast<int32_t>(LaunchPriority::High)
+			|| source.placement < static_cast<int32_t>(CorePlacement::Any) || source.placement > static_cast<int32_t>(CorePlacement::Performance)
+			|| source.cpuRatePercent > 100)
+		{
+			return WTLM_E_INVALID_ARGUMENT;
+		}
+
+		std::wstring environment;
+		if (!ToWide(source.applicationPath, request.applicationPath)
+			|| !ToWide(source.commandLine, request.commandLine)
+			|| !ToWide(source.hookPath, request.hookPath)
+			|| !ToWide(source.environment, environment)
+			|| !ToWide(source.launcherPath, request.launcherPath)
+			|| !ToWide(source.localStateFolder, request.localStateFolder)
+			|| request.applicationPath.empty()
+			|| request.hookPath.empty()
+			|| request.launcherPath.empty() == elevated)
+		{
+			return WTLM_E_INVALID_ARGUMENT;
+		}
+		SplitEnvironment(environment, request.environment);
+
+		request.policy.priority = static_cast<LaunchPriority>(source.priority);
+		request.policy.placement = static_cast<CorePlacement>(source.placement);
+		request.policy.affinityMask = source.affinityMask;
+		request.policy.queuePriority = source.queuePriority;
+		request.policy.staggerResume = (source.flags & WTLM_LAUNCH_STAGGER_RESUME) != 0;
+		request.policy.limits.memoryBytes = source.memoryLimitBytes;
+		request.policy.limits.cpuRatePercent = source.cpuRatePercent;
+		return WTLM_OK;
+	}
+
+	/// Copies a backend error to the caller's error, if it passed one.
+	void Report(const LaunchError& source, WTLM_LaunchError* error)
+	{
+		if (error == nullptr)
+		{
+			return;
+		}
+		error->systemError = source.code;
+		const char* event = source.event != nullptr ? source.event : "";
+		const size_t length = std::min(std::strlen(event), sizeof(error->event) - 1);
+		std::memcpy(error->event, event, length);
+		error->event[length] = '\0';
+	}
+}
+
+/**
+ * Returns the version of the flat launch API.
+ */
+uint32_t WTLM_GetApiVersion(void)
+{
+	return WTLM_LAUNCH_API_VERSION;
+}
+
+/**
+ * Starts a terminal through the installed backend.
+ *
+ * @param request The request; its strings are copied before this returns.
+ * @param launch Receives the handle, or null on error.
+ * @param error Receives the failed call on WTLM_E_FAILED; may be null.
+ * @return WTLM_OK or an error status.
+ */
+WTLM_Status WTLM_StartLaunch(const WTLM_LaunchRequest* request, WTLM_Launch** launch, WTLM_LaunchError* error)
+{
+	Report(LaunchError(), error);
+	if (launch == nullptr)
+	{
+		return WTLM_E_INVALID_ARGUMENT;
+	}
+	*launch = nullptr;
+	if (request == nullptr)
+	{
+		return WTLM_E_INVALID_ARGUMENT;
+	}
+
+	try
+	{
+		TerminalLaunchRequest native;
+		const WTLM_Status status = ToRequest(*request, native);
+		if (status != WTLM_OK)
+		{
+			return status;
+		}
+
+		std::shared_ptr<LaunchBackend> backend = LaunchBackend::Current();
+		if (!backend)
+		{
+			return WTLM_E_UNSUPPORTED;
+		}
+
+		auto handle = std::make_unique<WTLM_Launch>();
+		LaunchError failure;
+		handle->launch = backend->Start(native, failure);
+		if (!handle->launch)
+		{
+			Report(failure, error);
+			return WTLM_E_FAILED;
+		}
+		handle->backend = std::move(backend);
+		*launch = handle.release();
+		return WTLM_OK;
+	}
+	catch (const std::bad_alloc&)
+	{
+		return WTLM_E_OUT_OF_MEMORY;
+	}
+	catch (...)
+	{
+		return WTLM_E_FAILED;
+	}
+}
+
+/**
+ * Waits for the terminal of a launch to exit.
+ *
+ * @param launch The launch.
+ * @param timeoutMilliseconds The longest wait, or WTLM_WAIT_INFINITE.
+ * @param exitCode Receives the terminal's exit code on WTLM_OK.
+ * @param error Receives the failed call on WTLM_E_FAILED; may be null.
+ * @return WTLM_OK, WTLM_TIMEOUT or an error status.
+ */
+WTLM_Status WTLM_WaitLaunch(WTLM_Launch* launch, uint32_t timeoutMilliseconds, uint32_t* exitCode, WTLM_LaunchError* error)
+{
+	Report(LaunchError(), error);
+	if (launch == nullptr || exitCode == nullptr)
+	{
+		return WTLM_E_INVALID_ARGUMENT;
+	}
+
+	try
+	{
+		LaunchError failure;
+		switch (launch->launch->Wait(timeoutMilliseconds, *exitCode, failure))
+		{
+		case LaunchWaitResult::Exited:
+			return WTLM_OK;
+		case LaunchWaitResult::Timeout:
+			return WTLM_TIMEOUT;
+		default:
+			Report(failure, error);
+			return WTLM_E_FAILED;
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		return WTLM_E_OUT_OF_MEMORY;
+	}
+	catch (...)
+	{
+		return WTLM_E_FAILED;
+	}
+}
+
+/**
+ * Returns the terminal's process id.
+ *
+ * @param launch The launch, or null.
+ * @return The id, or 0.
+ */
+uint32_t WTLM_GetLaunchProcessId(const WTLM_Launch* launch)
+{
+	return launch != nullptr ? launch->launch->ProcessId() : 0;
+}
+
+/**
+ * Releases a launch.
+ *
+ * @param launch The launch, or null.
+ */
+void WTLM_CloseLaunch(WTLM_Launch* launch)
+{
+	delete launch;
+}
@@ -0,0 +1,94 @@
+﻿#pragma once
+
+/*
+ * Flat C launch API of WinApiHelpers.
+ *
+ * Everything crossing it is blittable: strings are UTF-16 pointers with lengths, borrowed only for
+ * the duration of a call, and a started launch is an opaque handle. A caller can P/Invoke it with
+ * pinned strings and no marshaling copies, without loading the C++/CLI wrapper. Exceptions never
+ * cross it. It launches through the installed LaunchBackend, so it can be exercised without
+ * starting processes.
+ */
+
+#include "WinApiHelpersExport.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WTLM_LAUNCH_API_VERSION 1u
+
+typedef int32_t WTLM_Status;
+
+#define WTLM_OK                     0
+#define WTLM_TIMEOUT                1       /* the terminal still runs */
+#define WTLM_E_INVALID_ARGUMENT     (-1)
+#define WTLM_E_VERSION              (-2)    /* the request's size field is not one this library knows */
+#define WTLM_E_FAILED               (-3)    /* a system call failed; see WTLM_LaunchError */
+#define WTLM_E_UNSUPPORTED          (-4)    /* no launch backend on this platform */
+#define WTLM_E_OUT_OF_MEMORY        (-5)
+
+#define WTLM_LAUNCH_ELEVATED        0x1u    /* start through the elevated launcher at launcherPath */
+#define WTLM_LAUNCH_STAGGER_RESUME  0x2u    /* resume only once the previous staggered terminal shows its window */
+
+#define WTLM_WAIT_INFINITE          0xFFFFFFFFu
+
+/* A UTF-16 string, not necessarily NUL-terminated; a null chars with a zero length is empty. */
+typedef struct WTLM_String
+{
+    const uint16_t* chars;
+    uint32_t length;                        /* in UTF-16 code units */
+    uint32_t reserved;
+} WTLM_String;
+
+typedef struct WTLM_LaunchRequest
+{
+    uint32_t size;                          /* sizeof(WTLM_LaunchRequest) */
+    uint32_t flags;                         /* WTLM_LAUNCH_* */
+    WTLM_String applicationPath;
+    WTLM_String commandLine;
+    WTLM_String hookPath;
+    WTLM_String environment;                /* NAME=VALUE entries added to the inherited environment, each ended by a NUL */
+    WTLM_String launcherPath;               /* required with WTLM_LAUNCH_ELEVATED */
+    WTLM_String localStateFolder;           /* optional: registers and accounts for the terminal under it */
+    int32_t priority;                       /* LaunchPriority: 0 idle to 4 high */
+    int32_t placement;                      /* CorePlacement: 0 any, 1 efficiency, 2 performance */
+    uint64_t affinityMask;                  /* 0 lets placement decide */
+    uint64_t memoryLimitBytes;              /* 0 for none */
+    uint32_t cpuRatePercent;                /* 0 for none, else 1 to 100 */
+    int32_t queuePriority;
+} WTLM_LaunchRequest;
+
+typedef struct WTLM_LaunchError
+{
+    uint32_t systemError;                   /* the Win32 error, or 0 */
+    char event[60];                         /* the log event, e.g. "launch.create_process", NUL-terminated */
+} WTLM_LaunchError;
+
+typedef struct WTLM_Launch WTLM_Launch;
+
+/* Returns WTLM_LAUNCH_API_VERSION of the loaded library. */
+WINAPIHELPERS_API uint32_t WTLM_GetApiVersion(void);
+
+/*
+ * Starts a terminal and returns once it runs, or for an elevated launch once the launcher runs.
+ * On success *launch receives a handle to close with WTLM_CloseLaunch. error may be null.
+ */
+WINAPIHELPERS_API WTLM_Status WTLM_StartLaunch(const WTLM_LaunchRequest* request, WTLM_Launch** launch, WTLM_LaunchError* error);
+
+/*
+ * Waits up to timeoutMilliseconds, or WTLM_WAIT_INFINITE, for the terminal to exit. Returns WTLM_OK
+ * with its exit code, WTLM_TIMEOUT, or an error. Not to be called on one launch from two threads at once.
+ */
+WINAPIHELPERS_API WTLM_Status WTLM_WaitLaunch(WTLM_Launch* launch, uint32_t timeoutMilliseconds, uint32_t* exitCode, WTLM_LaunchError* error);
+
+/* Returns the terminal's process id, or 0 while an elevated launch has not handed it over yet. */
+WINAPIHELPERS_API uint32_t WTLM_GetLaunchProcessId(const WTLM_Launch* launch);
+
+/* Releases a launch; a terminal that still runs keeps running. Null is ignored. */
+WINAPIHELPERS_API void WTLM_CloseLaunch(WTLM_Launch* launch);
+
+#ifdef __cplusplus
+}
+#endif
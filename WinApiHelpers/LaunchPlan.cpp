@@ -0,0 +1,92 @@
+﻿#include "pch.h"
+#include "LaunchPlan.h"
+#include <atomic>
+#include <filesystem>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	/// The executables of a package, in the order they are looked for.
+	constexpr const wchar_t* TerminalNames[] = { L"wt.exe", L"wtd.exe" };
+
+	/// Bumped by InvalidateAll; a plan compiled under an older generation is stale.
+	std::atomic<uint64_t> s_generation{ 0 };
+
+	bool IsFile(const std::filesystem::path& path)
+	{
+		std::error_code ec;
+		return std::filesystem::is_regular_file(path, ec);
+	}
+}
+
+/**
+ * Probes the package, checks the hook, and builds the request of a folder and its compiled forms.
+ *
+ * @param source The package, the folder and how to launch.
+ * @param missingFile Receives the executable last looked for or the hook if one is missing; else cleared.
+ * @param ec Receives no_such_file_or_directory if a file is missing; else cleared.
+ * @return The plan, or nullptr.
+ */
+std::shared_ptr<const LaunchPlan> LaunchPlan::Compile(const LaunchPlanSource& source, std::wstring& missingFile, std::error_code& ec)
+{
+	ec.clear();
+	missingFile.clear();
+
+	// Read first: an invalidation while the files are probed must leave this plan stale.
+	const uint64_t generation = s_generation.load(std::memory_order_acquire);
+
+	std::filesystem::path application;
+	bool found = false;
+	for (const wchar_t* name : TerminalNames)
+	{
+		application = std::filesystem::path(source.packageFolder) / name;
+		found = IsFile(application);
+		if (found)
+		{
+			break;
+		}
+	}
+	if (!found)
+	{
+		missingFile = application.wstring();
+	}
+	else if (!IsFile(source.hookPath))
+	{
+		missingFile = source.hookPath;
+	}
+	if (!missingFile.empty())
+	{
+		ec = std::make_error_code(std::errc::no_such_file_or_directory);
+		return nullptr;
+	}
+
+	std::shared_ptr<LaunchPlan> plan(new LaunchPlan());
+	plan->m_source = source;
+	plan->m_generation = generation;
+
+	TerminalLaunchRequest& request = plan->m_request;
+	request.applicationPath = application.wstring();
+	request.commandLine = L"\"" + request.applicationPath + L"\"";
+	request.hookPath = source.hookPath;
+	request.environment = {
+		L"WT_DEFAULT_LOCALSTATE=" + source.defaultLocalState,
+		L"WT_REDIRECT_LOCALSTATE=" + source.localStateFolder,
+		L"WT_HOOK_DLL_PATH=" + source.hookPath,
+	};
+	request.launcherPath = source.launcherPath;
+	request.localStateFolder = source.localStateFolder;
+	request.policy = source.policy;
+	request.compiled = CompiledLaunchRequest::Build(request);
+	return plan;
+}
+
+void LaunchPlan::InvalidateAll() noexcept
+{
+	s_generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+bool LaunchPlan::IsCurrent() const noexcept
+{
+	return m_generation == s_generation.load(std::memory_order_acquire);
+}
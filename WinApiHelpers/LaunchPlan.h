@@ -0,0 +1,80 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include "TerminalLauncher.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <system_error>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// What a launch plan is compiled from: a terminal package and a LocalState copy to run it on.
+		/// </summary>
+		struct LaunchPlanSource
+		{
+			std::wstring packageFolder;             // the installed location of the package; wt.exe, else wtd.exe, is launched from it
+			std::wstring defaultLocalState;         // the package's own LocalState, which the hook redirects from
+			std::wstring localStateFolder;          // the copy the terminal runs on
+			std::wstring hookPath;                  // the DLL injected into the terminal
+			std::wstring launcherPath;              // if set, the terminal is started elevated by this launcher
+			LaunchPolicy policy;
+		};
+
+		/// <summary>
+		/// Everything a Run click needs, resolved and built once per terminal package and folder.
+		/// </summary>
+		/// <remarks>
+		/// Compile probes the package for its executable, checks the hook, and builds the request with its
+		/// compiled forms (see CompiledLaunchRequest): the quoted command line, the environment merged with
+		/// this process's, and the elevated launcher's parameters. Starting a plan only adds the names of
+		/// the launch's telemetry channel and handoff pipe. A plan is immutable and may be launched from
+		/// several threads. It goes stale when InvalidateAll is called, which the app does when it
+		/// rereads the terminal packages or replaces the hook; a package update moves its installed
+		/// location, so a plan keyed by the location is not reused across one either.
+		/// </remarks>
+		class LaunchPlan
+		{
+		public:
+			/// <summary>
+			/// Resolves the terminal of a package and builds the plan of a folder.
+			/// </summary>
+			/// <param name="missingFile">Receives the file that was not found, if any.</param>
+			/// <returns>nullptr if the terminal or the hook is missing, with ec set.</returns>
+			WINAPIHELPERS_API static std::shared_ptr<const LaunchPlan> Compile(const LaunchPlanSource& source, std::wstring& missingFile, std::error_code& ec);
+
+			/// <summary>
+			/// Marks every plan compiled so far as stale.
+			/// </summary>
+			WINAPIHELPERS_API static void InvalidateAll() noexcept;
+
+			/// <summary>
+			/// False once InvalidateAll was called after the plan was compiled.
+			/// </summary>
+			WINAPIHELPERS_API bool IsCurrent() const noexcept;
+
+			const LaunchPlanSource& Source() const noexcept
+			{
+				return m_source;
+			}
+
+			/// <summary>
+			/// The request to pass to LaunchBackend::Start, with its compiled forms.
+			/// </summary>
+			const TerminalLaunchRequest& Request() const noexcept
+			{
+				return m_request;
+			}
+
+		private:
+			LaunchPlan() = default;
+
+			LaunchPlanSource m_source;
+			TerminalLaunchRequest m_request;
+			uint64_t m_generation = 0;
+		};
+
+	}
+} // namespace WTLayoutManager::Services
@@ -0,0 +1,529 @@
+﻿#include "pch.h"
+#include "LaunchScheduler.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cwchar>
+#include <mutex>
+#include <thread>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	enum class Stage
+	{
+		Pending,
+		Admitted,
+		Resumed
+	};
+
+	struct QueueEntry
+	{
+		uint64_t id;
+		int32_t queuePriority;
+		bool stagger;
+		Stage stage;
+		uint64_t admission;     // admission order, for staggered resume
+	};
+}
+
+struct LaunchQueue::State
+{
+	uint32_t window;
+	uint64_t nextId = 1;
+	uint64_t nextAdmission = 0;
+	std::vector<QueueEntry> entries;    // a workspace is a handful of launches; linear scans are fine
+
+	const QueueEntry* Find(uint64_t id) const
+	{
+		auto it = std::find_if(entries.begin(), entries.end(), [id](const QueueEntry& e) { return e.id == id; });
+		return it == entries.end() ? nullptr : &*it;
+	}
+
+	size_t Active() const
+	{
+		return static_cast<size_t>(std::count_if(entries.begin(), entries.end(),
+			[](const QueueEntry& e) { return e.stage != Stage::Pending; }));
+	}
+
+	/**
+	 * Admits pending launches, highest queue priority first, then oldest first, while the window has room.
+	 */
+	void Pump()
+	{
+		size_t active = Active();
+		while (active < window)
+		{
+			QueueEntry* next = nullptr;
+			for (QueueEntry& e : entries)
+			{
+				if (e.stage == Stage::Pending &&
+					(next == nullptr || e.queuePriority > next->queuePriority ||
+					(e.queuePriority == next->queuePriority && e.id < next->id)))
+				{
+					next = &e;
+				}
+			}
+			if (next == nullptr)
+			{
+				return;
+			}
+			next->stage = Stage::Admitted;
+			next->admission = nextAdmission++;
+			++active;
+		}
+	}
+};
+
+LaunchQueue::LaunchQueue(uint32_t window)
+	: m_state(std::make_unique<State>())
+{
+	m_state->window = std::max<uint32_t>(window, 1);
+}
+
+LaunchQueue::~LaunchQueue() = default;
+
+uint64_t LaunchQueue::Submit(int32_t queuePriority, bool staggerResume)
+{
+	const uint64_t id = m_state->nextId++;
+	m_state->entries.push_back({ id, queuePriority, staggerResume, Stage::Pending, 0 });
+	m_state->Pump();
+	return id;
+}
+
+bool LaunchQueue::IsAdmitted(uint64_t id) const
+{
+	const QueueEntry* entry = m_state->Find(id);
+	return entry != nullptr && entry->stage != Stage::Pending;
+}
+
+/**
+ * A launch that does not stagger may resume as soon as it is admitted. A staggered one waits until no
+ * other staggered launch is resumed and unfinished, and until every staggered launch admitted before it
+ * has resumed.
+ */
+bool LaunchQueue::MayResume(uint64_t id) const
+{
+	const QueueEntry* entry = m_state->Find(id);
+	if (entry == nullptr || entry->stage != Stage::Admitted)
+	{
+		return false;
+	}
+	if (!entry->stagger)
+	{
+		return true;
+	}
+	return std::none_of(m_state->entries.begin(), m_state->entries.end(), [entry](const QueueEntry& e) {
+		return e.stagger && (e.stage == Stage::Resumed ||
+			(e.stage == Stage::Admitted && e.admission < entry->admission));
+	});
+}
+
+void LaunchQueue::Resume(uint64_t id)
+{
+	for (QueueEntry& e : m_state->entries)
+	{
+		if (e.id == id && e.stage == Stage::Admitted)
+		{
+			e.stage = Stage::Resumed;
+		}
+	}
+}
+
+void LaunchQueue::Finish(uint64_t id)
+{
+	auto& entries = m_state->entries;
+	entries.erase(std::remove_if(entries.begin(), entries.end(), [id](const QueueEntry& e) { return e.id == id; }), entries.end());
+	m_state->Pump();
+}
+
+uint32_t LaunchQueue::Window() const noexcept
+{
+	return m_state->window;
+}
+
+size_t LaunchQueue::PendingCount() const noexcept
+{
+	return m_state->entries.size() - m_state->Active();
+}
+
+size_t LaunchQueue::ActiveCount() const noexcept
+{
+	return m_state->Active();
+}
+
+// --------------------------------------------------------------------------
+
+struct LaunchScheduler::State
+{
+	explicit State(uint32_t window) : queue(window)
+	{
+	}
+
+	std::mutex lock;
+	std::condition_variable changed;
+	LaunchQueue queue;
+};
+
+LaunchScheduler::LaunchScheduler(uint32_t window)
+	: m_state(std::make_unique<State>(window))
+{
+}
+
+LaunchScheduler::~LaunchScheduler() = default;
+
+LaunchScheduler& LaunchScheduler::Shared()
+{
+	static LaunchScheduler scheduler(std::clamp(std::thread::hardware_concurrency() / 2, 2u, 8u));
+	return scheduler;
+}
+
+/**
+ * Queues a launch and blocks until the window admits it.
+ *
+ * @param policy The queue priority and stagger setting are used.
+ * @return The launch id.
+ */
+uint64_t LaunchScheduler::Admit(const LaunchPolicy& policy)
+{
+	std::unique_lock<std::mutex> lock(m_state->lock);
+	const uint64_t id = m_state->queue.Submit(policy.queuePriority, policy.staggerResume);
+	m_state->changed.wait(lock, [this, id]() { return m_state->queue.IsAdmitted(id); });
+	return id;
+}
+
+void LaunchScheduler::WaitResume(uint64_t id)
+{
+	std::unique_lock<std::mutex> lock(m_state->lock);
+	m_state->changed.wait(lock, [this, id]() { return m_state->queue.MayResume(id) || !m_state->queue.IsAdmitted(id); });
+	m_state->queue.Resume(id);
+}
+
+void LaunchScheduler::Finish(uint64_t id)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_state->lock);
+		m_state->queue.Finish(id);
+	}
+	m_state->changed.notify_all();
+}
+
+/**
+ * Selects the processors of the lowest or highest efficiency class.
+ *
+ * @param efficiencyClasses Per logical processor of the first group; at most 64 are used.
+ * @param placement The placement.
+ * @return The affinity mask, or 0 for no restriction.
+ */
+uint64_t LaunchScheduler::PlacementMask(const std::vector<uint8_t>& efficiencyClasses, CorePlacement placement)
+{
+	const size_t count = std::min<size_t>(efficiencyClasses.size(), 64);
+	if (placement == CorePlacement::Any || count == 0)
+	{
+		return 0;
+	}
+	const auto [lowest, highest] = std::minmax_element(efficiencyClasses.begin(), efficiencyClasses.begin() + count);
+	if (*lowest == *highest)
+	{
+		return 0;
+	}
+	const uint8_t wanted = placement == CorePlacement::Efficiency ? *lowest : *highest;
+	uint64_t mask = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (efficiencyClasses[i] == wanted)
+		{
+			mask |= uint64_t{ 1 } << i;
+		}
+	}
+	return mask;
+}
+
+std::wstring LaunchScheduler::FormatPolicy(const LaunchPolicy& policy)
+{
+	return L"priority=" + std::to_wstring(static_cast<unsigned>(policy.priority)) +
+		L";placement=" + std::to_wstring(static_cast<unsigned>(policy.placement)) +
+		L";affinity=" + std::to_wstring(policy.affinityMask) +
+		L";queue=" + std::to_wstring(policy.queuePriority) +
+		L";stagger=" + (policy.staggerResume ? L"1" : L"0") +
+		L";memory=" + std::to_wstring(policy.limits.memoryBytes) +
+		L";cpurate=" + std::to_wstring(policy.limits.cpuRatePercent);
+}
+
+/**
+ * Parses key=value pairs separated by semicolons into a policy.
+ *
+ * @param text The formatted policy.
+ * @param policy Receives the values; keys that are missing keep their value.
+ * @return false if a value is not a number or out of range.
+ */
+bool LaunchScheduler::ParsePolicy(std::wstring_view text, LaunchPolicy& policy)
+{
+	LaunchPolicy parsed = policy;
+	while (!text.empty())
+	{
+		const size_t end = std::min(text.find(L';'), text.size());
+		const std::wstring_view pair = text.substr(0, end);
+		text.remove_prefix(std::min(end + 1, text.size()));
+		const size_t equals = pair.find(L'=');
+		if (equals == std::wstring_view::npos)
+		{
+			continue;
+		}
+		const std::wstring_view key = pair.substr(0, equals);
+		const std::wstring value(pair.substr(equals + 1));
+		if (value.empty() || value.find_first_not_of(L"-0123456789") != std::wstring::npos)
+		{
+			return false;
+		}
+		const long long number = std::wcstoll(value.c_str(), nullptr, 10);
+		if (key == L"priority" && number >= 0 && number <= static_cast<long long>(LaunchPriority::High))
+		{
+			parsed.priority = static_cast<LaunchPriority>(number);
+		}
+		else if (key == L"placement" && number >= 0 && number <= static_cast<long long>(CorePlacement::Performance))
+		{
+			parsed.placement = static_cast<CorePlacement>(number);
+		}
+		else if (key == L"affinity" && value[0] != L'-')
+		{
+			parsed.affinityMask = std::wcstoull(value.c_str(), nullptr, 10);
+		}
+		else if (key == L"queue" && number >= INT32_MIN && number <= INT32_MAX)
+		{
+			parsed.queuePriority = static_cast<int32_t>(number);
+		}
+		else if (key == L"stagger" && (number == 0 || number == 1))
+		{
+			parsed.staggerResume = number == 1;
+		}
+		else if (key == L"memory" && value[0] != L'-')
+		{
+			parsed.limits.memoryBytes = std::wcstoull(value.c_str(), nullptr, 10);
+		}
+		else if (key == L"cpurate" && number >= 0 && number <= 100)
+		{
+			parsed.limits.cpuRatePercent = static_cast<uint32_t>(number);
+		}
+		else if (key == L"priority" || key == L"placement" || key == L"affinity" || key == L"queue" || key == L"stagger" ||
+			key == L"memory" || key == L"cpurate")
+		{
+			return false;
+		}
+	}
+	policy = parsed;
+	return true;
+}
+
+// --------------------------------------------------------------------------
+
+namespace
+{
+	/// The simulation step.
+	constexpr double StepMilliseconds = 0.5;
+
+	/// A simulated restore that has not finished after this long is reported as is.
+	constexpr double SimulationLimitMilliseconds = 10 * 60 * 1000;
+
+	enum class Phase
+	{
+		Queued,
+		Creating,
+		Created,
+		Running,
+		Ready
+	};
+
+	struct SimulatedLaunch
+	{
+		uint64_t id;
+		Phase phase;
+		double createLeft;
+		double workLeft;
+		double readyAt;
+		double rate;            // work per millisecond granted in the current step
+	};
+
+	/// Something that wants CPU in the current step: a running launch or the foreground load.
+	struct Claim
+	{
+		int tier;
+		CorePlacement placement;
+		double demand;          // threads
+		double* rate;
+	};
+
+	/**
+	 * Shares the free cores of one pool among claims that may only use that pool.
+	 */
+	void GrantPool(std::vector<Claim*>& claims, double& freeCores, double speed)
+	{
+		double demand = 0;
+		for (Claim* c : claims)
+		{
+			demand += c->demand;
+		}
+		if (demand <= 0)
+		{
+			return;
+		}
+		const double granted = std::min(demand, freeCores);
+		for (Claim* c : claims)
+		{
+			*c->rate += granted * (c->demand / demand) * speed;
+		}
+		freeCores -= granted;
+	}
+}
+
+/**
+ * Simulates restoring a workspace under one policy.
+ *
+ * @param model The machine and the terminals.
+ * @param policy Applied to every terminal; per-terminal queue priorities come from the model when given.
+ * @param window The scheduler window; 0 admits every terminal at once.
+ * @return The ready times and the share of the foreground load that was served meanwhile.
+ */
+SimulationResult LaunchSimulation::Run(const WorkspaceModel& model, const LaunchPolicy& policy, uint32_t window)
+{
+	SimulationResult result{ 0, 0, 0, 1 };
+	const size_t count = model.terminalWork.size();
+	if (count == 0)
+	{
+		return result;
+	}
+
+	LaunchQueue queue(window == 0 ? static_cast<uint32_t>(count) : window);
+	std::vector<SimulatedLaunch> launches(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const int32_t queuePriority = i < model.queuePriorities.size() ? model.queuePriorities[i] : policy.queuePriority;
+		launches[i] = { queue.Submit(queuePriority, policy.staggerResume), Phase::Queued, model.createMilliseconds,
+			model.terminalWork[i], 0, 0 };
+	}
+
+	const double cores = static_cast<double>(model.performanceCores + model.efficiencyCores);
+	const int launchTier = static_cast<int>(policy.priority);
+	const int foregroundTier = static_cast<int>(LaunchPriority::Normal);
+	// Without efficiency cores there is nothing to place.
+	const CorePlacement placement = model.efficiencyCores == 0 || model.performanceCores == 0 ? CorePlacement::Any : policy.placement;
+
+	double foregroundDemand = 0;
+	double foregroundServed = 0;
+	double foregroundRate = 0;
+	size_t ready = 0;
+	double now = 0;
+	std::vector<Claim> claims;
+	while (ready < count && now < SimulationLimitMilliseconds)
+	{
+		// Advance the launches through the queue.
+		for (SimulatedLaunch& launch : launches)
+		{
+			if (launch.phase == Phase::Queued && queue.IsAdmitted(launch.id))
+			{
+				launch.phase = Phase::Creating;
+			}
+			if (launch.phase == Phase::Creating && launch.createLeft <= 0)
+			{
+				launch.phase = Phase::Created;
+			}
+			if (launch.phase == Phase::Created && queue.MayResume(launch.id))
+			{
+				queue.Resume(launch.id);
+				launch.phase = Phase::Running;
+			}
+		}
+
+		// Share the cores: strict priority between tiers, fair within a tier, restricted claims first.
+		claims.clear();
+		double runnable = model.foregroundLoad;
+		foregroundRate = 0;
+		if (model.foregroundLoad > 0)
+		{
+			claims.push_back({ foregroundTier, CorePlacement::Any, model.foregroundLoad, &foregroundRate });
+		}
+		for (SimulatedLaunch& launch : launches)
+		{
+			launch.rate = 0;
+			if (launch.phase == Phase::Running)
+			{
+				claims.push_back({ launchTier, placement, 1.0, &launch.rate });
+				runnable += 1;
+			}
+		}
+		double freePerformance = model.performanceCores;
+		double freeEfficiency = model.efficiencyCores;
+		for (int tier = static_cast<int>(LaunchPriority::High); tier >= 0; --tier)
+		{
+			std::vector<Claim*> efficiencyOnly, performanceOnly, any;
+			for (Claim& c : claims)
+			{
+				if (c.tier != tier)
+				{
+					continue;
+				}
+				(c.placement == CorePlacement::Efficiency ? efficiencyOnly :
+					c.placement == CorePlacement::Performance ? performanceOnly : any).push_back(&c);
+			}
+			GrantPool(efficiencyOnly, freeEfficiency, model.efficiencySpeed);
+			GrantPool(performanceOnly, freePerformance, 1.0);
+
+			// Unrestricted threads take the performance cores first.
+			double demand = 0;
+			for (Claim* c : any)
+			{
+				demand += c->demand;
+			}
+			if (demand > 0)
+			{
+				const double granted = std::min(demand, freePerformance + freeEfficiency);
+				const double onPerformance = std::min(granted, freePerformance);
+				const double onEfficiency = granted - onPerformance;
+				const double work = onPerformance + onEfficiency * model.efficiencySpeed;
+				for (Claim* c : any)
+				{
+					*c->rate += work * (c->demand / demand);
+				}
+				freePerformance -= onPerformance;
+				freeEfficiency -= onEfficiency;
+			}
+		}
+		const double throughput = 1.0 / (1.0 + model.contention * std::max(0.0, runnable - cores));
+
+		// Run the step.
+		now += StepMilliseconds;
+		foregroundDemand += model.foregroundLoad * StepMilliseconds;
+		foregroundServed += foregroundRate * throughput * StepMilliseconds;
+		for (SimulatedLaunch& launch : launches)
+		{
+			if (launch.phase == Phase::Creating)
+			{
+				launch.createLeft -= StepMilliseconds;
+			}
+			else if (launch.phase == Phase::Running)
+			{
+				launch.workLeft -= launch.rate * throughput * StepMilliseconds;
+				if (launch.workLeft <= 0)
+				{
+					launch.phase = Phase::Ready;
+					launch.readyAt = now;
+					queue.Finish(launch.id);
+					++ready;
+				}
+			}
+		}
+	}
+
+	double sum = 0;
+	result.firstReadyMilliseconds = now;
+	for (const SimulatedLaunch& launch : launches)
+	{
+		const double at = launch.phase == Phase::Ready ? launch.readyAt : now;
+		result.firstReadyMilliseconds = std::min(result.firstReadyMilliseconds, at);
+		result.allReadyMilliseconds = std::max(result.allReadyMilliseconds, at);
+		sum += at;
+	}
+	result.meanReadyMilliseconds = sum / static_cast<double>(count);
+	result.foregroundShare = foregroundDemand > 0 ? foregroundServed / foregroundDemand : 1;
+	return result;
+}
@@ -0,0 +1,247 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include "ResourceAccounting.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// The priority class a launched terminal runs at.
+		/// </summary>
+		enum class LaunchPriority : uint8_t
+		{
+			Idle,
+			BelowNormal,
+			Normal,
+			AboveNormal,
+			High
+		};
+
+		/// <summary>
+		/// Which cores a launched terminal may run on, on processors with more than one efficiency class.
+		/// </summary>
+		enum class CorePlacement : uint8_t
+		{
+			Any,
+			Efficiency,     // the most power-efficient cores only
+			Performance     // the fastest cores only
+		};
+
+		/// <summary>
+		/// How one terminal is launched.
+		/// </summary>
+		struct LaunchPolicy
+		{
+			LaunchPriority priority = LaunchPriority::Normal;
+			CorePlacement placement = CorePlacement::Any;
+			uint64_t affinityMask = 0;      // explicit processors; 0 lets placement decide
+			int32_t queuePriority = 0;      // queued launches start highest first, then in submission order
+			bool staggerResume = false;     // resume only once the previous staggered terminal shows its window
+			ResourceLimits limits;          // caps on the terminal and everything it starts
+		};
+
+		/// <summary>
+		/// The admission state machine of the launch scheduler, without threads or clocks.
+		/// </summary>
+		/// <remarks>
+		/// A launch is Pending until the window has room, Admitted while its process is created suspended,
+		/// Resumed once its main thread runs, and leaves the queue when it is Finished (its window appeared,
+		/// or it failed). At most window launches are Admitted or Resumed at once; pending launches are
+		/// admitted by queue priority, then in submission order. Staggered launches resume one at a time,
+		/// in admission order, each once the previous one finished. LaunchScheduler drives it with real
+		/// threads, LaunchSimulation with a virtual clock. Not thread-safe.
+		/// </remarks>
+		class LaunchQueue
+		{
+		public:
+			WINAPIHELPERS_API explicit LaunchQueue(uint32_t window);
+			WINAPIHELPERS_API ~LaunchQueue();
+
+			LaunchQueue(const LaunchQueue&) = delete;
+			LaunchQueue& operator=(const LaunchQueue&) = delete;
+
+			/// <summary>
+			/// Queues a launch and admits whatever fits in the window.
+			/// </summary>
+			/// <returns>The id of the launch.</returns>
+			WINAPIHELPERS_API uint64_t Submit(int32_t queuePriority, bool staggerResume);
+
+			WINAPIHELPERS_API bool IsAdmitted(uint64_t id) const;
+
+			/// <summary>
+			/// Returns whether an admitted launch may resume now.
+			/// </summary>
+			WINAPIHELPERS_API bool MayResume(uint64_t id) const;
+
+			/// <summary>
+			/// Records that an admitted launch resumed.
+			/// </summary>
+			WINAPIHELPERS_API void Resume(uint64_t id);
+
+			/// <summary>
+			/// Removes a launch in any state and admits the next pending ones.
+			/// </summary>
+			WINAPIHELPERS_API void Finish(uint64_t id);
+
+			WINAPIHELPERS_API uint32_t Window() const noexcept;
+			WINAPIHELPERS_API size_t PendingCount() const noexcept;
+			WINAPIHELPERS_API size_t ActiveCount() const noexcept;
+
+		private:
+			struct State;
+			std::unique_ptr<State> m_state;
+		};
+
+		/// <summary>
+		/// Bounds how many terminals start at once and staggers their resume.
+		/// </summary>
+		/// <remarks>
+		/// Restoring a workspace used to start every terminal at once, and every shell then competed for
+		/// the CPU while initializing. The blocking calls are made from the thread that performs the launch.
+		/// </remarks>
+		class LaunchScheduler
+		{
+		public:
+			WINAPIHELPERS_API explicit LaunchScheduler(uint32_t window);
+			WINAPIHELPERS_API ~LaunchScheduler();
+
+			LaunchScheduler(const LaunchScheduler&) = delete;
+			LaunchScheduler& operator=(const LaunchScheduler&) = delete;
+
+			/// <summary>
+			/// The scheduler shared by every launch of the process; its window is half the logical
+			/// processors, between 2 and 8.
+			/// </summary>
+			WINAPIHELPERS_API static LaunchScheduler& Shared();
+
+			/// <summary>
+			/// Waits until the launch is admitted.
+			/// </summary>
+			/// <returns>The id to pass to WaitResume and Finish.</returns>
+			WINAPIHELPERS_API uint64_t Admit(const LaunchPolicy& policy);
+
+			/// <summary>
+			/// Waits until the admitted launch may resume its main thread, and records that it did.
+			/// </summary>
+			WINAPIHELPERS_API void WaitResume(uint64_t id);
+
+			/// <summary>
+			/// Ends the launch: its window appeared, or it failed.
+			/// </summary>
+			WINAPIHELPERS_API void Finish(uint64_t id);
+
+			/// <summary>
+			/// Returns the processors of the first processor group that a placement selects.
+			/// </summary>
+			/// <param name="efficiencyClasses">The efficiency class of each logical processor; higher is faster.</param>
+			/// <param name="placement">The placement.</param>
+			/// <returns>0 (no restriction) for Any, or when every processor has the same class.</returns>
+			WINAPIHELPERS_API static uint64_t PlacementMask(const std::vector<uint8_t>& efficiencyClasses, CorePlacement placement);
+
+			/// <summary>
+			/// Formats a policy as one command-line argument, e.g. priority=2;placement=0;affinity=0;queue=0;stagger=0;memory=0;cpurate=0.
+			/// </summary>
+			WINAPIHELPERS_API static std::wstring FormatPolicy(const LaunchPolicy& policy);
+
+			/// <summary>
+			/// Parses FormatPolicy's output; unknown keys are ignored.
+			/// </summary>
+			/// <returns>false if a value is malformed or out of range.</returns>
+			WINAPIHELPERS_API static bool ParsePolicy(std::wstring_view text, LaunchPolicy& policy);
+
+		private:
+			struct State;
+			std::unique_ptr<State> m_state;
+		};
+
+		/// <summary>
+		/// Holds a launch admitted by a scheduler and finishes it when destroyed, so every failure path
+		/// frees its slot.
+		/// </summary>
+		class LaunchSlot
+		{
+		public:
+			LaunchSlot(LaunchScheduler& scheduler, const LaunchPolicy& policy)
+				: m_scheduler(scheduler), m_id(scheduler.Admit(policy))
+			{
+			}
+
+			~LaunchSlot()
+			{
+				Finish();
+			}
+
+			LaunchSlot(const LaunchSlot&) = delete;
+			LaunchSlot& operator=(const LaunchSlot&) = delete;
+
+			void WaitResume()
+			{
+				m_scheduler.WaitResume(m_id);
+			}
+
+			void Finish()
+			{
+				if (!m_finished)
+				{
+					m_finished = true;
+					m_scheduler.Finish(m_id);
+				}
+			}
+
+		private:
+			LaunchScheduler& m_scheduler;
+			uint64_t m_id;
+			bool m_finished = false;
+		};
+
+		/// <summary>
+		/// A machine and a workspace for LaunchSimulation.
+		/// </summary>
+		struct WorkspaceModel
+		{
+			uint32_t performanceCores = 4;
+			uint32_t efficiencyCores = 4;
+			double efficiencySpeed = 0.6;       // work per millisecond of an efficiency core, relative to a performance core
+			double foregroundLoad = 1.0;        // cores the user's other programs keep busy at normal priority
+			double createMilliseconds = 20;     // creating a suspended process and injecting the hook
+			double contention = 0.08;           // slowdown per runnable thread beyond the core count
+			std::vector<double> terminalWork;   // milliseconds of performance-core work until each window appears
+			std::vector<int32_t> queuePriorities;   // optional, per terminal
+		};
+
+		/// <summary>
+		/// What one simulated workspace restore took.
+		/// </summary>
+		struct SimulationResult
+		{
+			double firstReadyMilliseconds;
+			double allReadyMilliseconds;        // the time to ready of the whole workspace
+			double meanReadyMilliseconds;
+			double foregroundShare;             // the fraction of its demand the foreground load got
+		};
+
+		/// <summary>
+		/// Replays a workspace restore against a fake launch backend on a virtual clock.
+		/// </summary>
+		/// <remarks>
+		/// The launches go through the real LaunchQueue; the backend models process creation as a fixed
+		/// delay and terminal start-up as CPU work. Each millisecond the cores are shared by strict priority
+		/// tier and fairly within a tier, launches only run on the cores their placement allows, and a
+		/// machine with more runnable threads than cores loses throughput to contention. Portable, so
+		/// policies can be compared anywhere.
+		/// </remarks>
+		class LaunchSimulation
+		{
+		public:
+			WINAPIHELPERS_API static SimulationResult Run(const WorkspaceModel& model, const LaunchPolicy& policy, uint32_t window);
+		};
+
+	}
+} // namespace WTLayoutManager::Services
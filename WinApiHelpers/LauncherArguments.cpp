@@ -0,0 +1,86 @@
+﻿#include "pch.h"
+#include "LauncherArguments.h"
+#include <algorithm>   // std::find_if
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	// Trim leading / trailing spaces or tabs – optional, but handy.
+	/**
+	 * Removes leading and trailing whitespace from a wide string.
+	 *
+	 * @param s Reference to the wide string to be trimmed in-place
+	 * @remarks Uses a lambda function to identify non-whitespace characters
+	 * @remarks Modifies the input string by removing spaces and tabs from both ends
+	 */
+	inline void trim(std::wstring& s)
+	{
+		auto not_space = [](wchar_t ch) { return ch != L' ' && ch != L'\t'; };
+
+		s.erase(s.begin(), std::find_if(s.begin(), s.end(), not_space));         // left trim
+		s.erase(std::find_if(s.rbegin(), s.rend(), not_space).base(), s.end());  // right trim
+	}
+}
+
+/**
+ * Properly quotes an argument by escaping internal quotes.
+ *
+ * The result is built in one string, sized for the argument and its quotes up front.
+ *
+ * @param arg The argument to be quoted.
+ *
+ * @return The quoted argument as a wstring.
+ */
+std::wstring LauncherArguments::QuoteArgument(const std::wstring& arg)
+{
+	std::wstring result;
+	result.reserve(arg.size() + 2);
+	result += L'\"';
+	for (wchar_t ch : arg) {
+		if (ch == L'\"') {
+			result += L'\\';
+		}
+		result += ch;
+	}
+	result += L'\"';
+	return result;
+}
+
+// Decode "Name=Value;Name2=Value2" → vector<wstring>
+/**
+ * Splits an environment block string into individual environment variable entries.
+ *
+ * Parses a semicolon-delimited string of environment variables, trimming whitespace
+ * from each entry and filtering out empty entries.
+ *
+ * @param envStr A wide string containing environment variables in "NAME=VALUE" format
+ * @return A vector of individual environment variable entries
+ * @remarks Handles multiple environment variables separated by semicolons
+ * @remarks Whitespace around each entry is automatically trimmed
+ */
+std::vector<std::wstring> LauncherArguments::SplitEnvironment(const std::wstring& envStr)
+{
+	std::vector<std::wstring> result;
+
+	std::wstring::size_type start = 0;
+	while (start < envStr.length())
+	{
+		auto next = envStr.find(L';', start);
+		if (next == std::wstring::npos)
+		{
+			next = envStr.length();          // last segment
+		}
+
+		std::wstring token = envStr.substr(start, next - start);
+		trim(token);                         // optional
+
+		if (!token.empty())
+		{
+			result.push_back(std::move(token));
+		}
+
+		start = next + 1;                    // skip the semicolon
+	}
+	return result;
+}
@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <string>
+#include <vector>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// Encodes and decodes the command line of the elevated launcher.
+		/// </summary>
+		/// <remarks>
+		/// The app quotes each parameter with QuoteArgument and joins the environment entries with
+		/// semicolons; ElevatedLauncher splits them again with SplitEnvironment. Both sides use this
+		/// one implementation so the encoding cannot drift apart.
+		/// </remarks>
+		class LauncherArguments
+		{
+		public:
+			/// <summary>
+			/// Encloses an argument in quotes and escapes the quotes inside it.
+			/// </summary>
+			WINAPIHELPERS_API static std::wstring QuoteArgument(const std::wstring& arg);
+
+			/// <summary>
+			/// Splits a "Name=Value;Name2=Value2" argument into its entries.
+			/// </summary>
+			/// <returns>The entries without surrounding spaces or tabs; empty entries are dropped.</returns>
+			WINAPIHELPERS_API static std::vector<std::wstring> SplitEnvironment(const std::wstring& envStr);
+		};
+
+	}
+} // namespace WTLayoutManager::Services
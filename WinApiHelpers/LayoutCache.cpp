@@ -0,0 +1,445 @@
+﻿#include "pch.h"
+#include "LayoutCache.h"
+#include "ContentHash.h"
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	constexpr uint64_t AlignUp(uint64_t value) noexcept
+	{
+		return (value + 7) & ~uint64_t{ 7 };
+	}
+
+	/**
+	 * Checks that a section of count records of type T lies inside the mapping.
+	 */
+	template <typename T>
+	bool SectionFits(uint64_t offset, uint64_t count, size_t fileSize) noexcept
+	{
+		if (offset % alignof(T) != 0 || offset > fileSize)
+		{
+			return false;
+		}
+		return count <= (fileSize - offset) / sizeof(T);
+	}
+
+	bool StringFits(const CacheString& s, uint64_t stringsLength) noexcept
+	{
+		if (s.offset == CacheNullString.offset)
+		{
+			return s.length == 0;
+		}
+		return s.offset <= stringsLength && s.length <= stringsLength - s.offset;
+	}
+
+	bool RangeFits(uint32_t first, uint32_t count, uint32_t total) noexcept
+	{
+		return first <= total && count <= total - first;
+	}
+}
+
+/**
+ * Returns the sidecar cache path of a LocalState folder.
+ *
+ * @param folder The LocalState folder.
+ * @return folder / LayoutCache::FileName.
+ */
+std::filesystem::path LayoutCache::PathFor(const std::filesystem::path& folder)
+{
+	return folder / FileName;
+}
+
+/**
+ * Captures size, modification time and optionally content hash of every source file.
+ *
+ * Missing or unreadable files produce a zeroed key with present == 0.
+ *
+ * @param folder The LocalState folder.
+ * @param keys Receives one key per entry of SourceNames.
+ * @param hashContents Whether to hash the contents of present files.
+ */
+void LayoutCache::CaptureSources(
+	const std::filesystem::path& folder,
+	CacheSourceKey (&keys)[LayoutCacheSourceCount],
+	bool hashContents)
+{
+	for (size_t i = 0; i < LayoutCacheSourceCount; ++i)
+	{
+		CacheSourceKey& key = keys[i];
+		key = CacheSourceKey{};
+
+		std::error_code ec;
+		const std::filesystem::path path = folder / SourceNames[i];
+		const auto size = std::filesystem::file_size(path, ec);
+		if (ec)
+		{
+			continue;
+		}
+		const auto time = std::filesystem::last_write_time(path, ec);
+		if (ec)
+		{
+			continue;
+		}
+
+		key.present = 1;
+		key.size = static_cast<uint64_t>(size);
+		key.lastWriteTime = static_cast<int64_t>(time.time_since_epoch().count());
+		if (hashContents && !ContentHash::HashFile(path, key.contentHash))
+		{
+			key = CacheSourceKey{};
+		}
+	}
+}
+
+/**
+ * Applies the invalidation rules to one source file.
+ *
+ * @param stored The key recorded in the cache.
+ * @param current The key just captured (without hash).
+ * @param path The source file, hashed only when size matches but the time does not.
+ * @return true if the cached records still describe the file.
+ */
+bool LayoutCache::SourceUnchanged(
+	const CacheSourceKey& stored,
+	const CacheSourceKey& current,
+	const std::filesystem::path& path)
+{
+	if (stored.present != current.present)
+	{
+		return false;
+	}
+	if (!stored.present)
+	{
+		return true;
+	}
+	if (stored.size != current.size)
+	{
+		return false;
+	}
+	if (stored.lastWriteTime == current.lastWriteTime)
+	{
+		return true;
+	}
+
+	// Same size but touched: only the contents can tell.
+	uint64_t hash = 0;
+	return ContentHash::HashFile(path, hash) && hash == stored.contentHash;
+}
+
+// --------------------------------------------------------------------------
+
+LayoutCacheWriter::LayoutCacheWriter() = default;
+LayoutCacheWriter::~LayoutCacheWriter() = default;
+
+/**
+ * Stores a string once in the string table and returns its reference.
+ *
+ * @param s The string; a default-constructed view (null data) is stored as a null string.
+ * @return The reference to the (possibly shared) copy in the table.
+ */
+CacheString LayoutCacheWriter::Intern(std::u16string_view s)
+{
+	if (s.data() == nullptr)
+	{
+		return CacheNullString;
+	}
+	auto it = m_interned.find(std::u16string(s));
+	if (it != m_interned.end())
+	{
+		return it->second;
+	}
+	CacheString ref{ static_cast<uint32_t>(m_strings.size()), static_cast<uint32_t>(s.size()) };
+	m_strings.append(s);
+	m_interned.emplace(std::u16string(s), ref);
+	return ref;
+}
+
+/**
+ * Starts the records of a source file.
+ *
+ * @param source Index of the file in LayoutCache::SourceNames.
+ * @param hasTabs Whether the file produced tab states (even if empty).
+ */
+void LayoutCacheWriter::BeginFile(uint32_t source, bool hasTabs)
+{
+	m_files.push_back(CacheFileRecord{
+		source,
+		hasTabs ? CacheFileHasTabs : 0u,
+		static_cast<uint32_t>(m_profiles.size()), 0,
+		static_cast<uint32_t>(m_tabs.size()), 0 });
+}
+
+/**
+ * Adds a profile to the current file.
+ */
+void LayoutCacheWriter::AddProfile(std::u16string_view name, std::u16string_view icon)
+{
+	m_profiles.push_back(CacheProfileRecord{ Intern(name), Intern(icon) });
+	++m_files.back().profileCount;
+}
+
+/**
+ * Adds a tab to the current file; subsequent panes belong to it.
+ */
+void LayoutCacheWriter::BeginTab(std::u16string_view title, int32_t rows, int32_t columns)
+{
+	m_tabs.push_back(CacheTabRecord{ Intern(title), rows, columns, static_cast<uint32_t>(m_panes.size()), 0 });
+	++m_files.back().tabCount;
+}
+
+/**
+ * Adds a pane to the current tab.
+ */
+void LayoutCacheWriter::AddPane(
+	std::u16string_view profile,
+	std::u16string_view icon,
+	std::u16string_view commandline,
+	std::u16string_view startingDirectory,
+	std::u16string_view splitDirection,
+	double x, double y, double width, double height,
+	const GridPlacement& placement)
+{
+	m_panes.push_back(CachePaneRecord{
+		Intern(profile), Intern(icon), Intern(commandline), Intern(startingDirectory), Intern(splitDirection),
+		x, y, width, height, placement });
+	++m_tabs.back().paneCount;
+}
+
+/**
+ * Serializes the records and atomically replaces the folder's cache file.
+ *
+ * The image is written to a temporary file which is then renamed over the cache, so readers
+ * never observe a partially written cache.
+ *
+ * @param folder The LocalState folder.
+ * @param schema Version of the parsing rules that produced the records.
+ * @param keys The source keys captured before parsing.
+ * @return true on success.
+ */
+bool LayoutCacheWriter::Save(
+	const std::filesystem::path& folder,
+	uint32_t schema,
+	const CacheSourceKey (&keys)[LayoutCacheSourceCount]) const
+{
+	CacheHeader header{};
+	header.magic = LayoutCache::Magic;
+	header.version = LayoutCache::Version;
+	header.headerSize = static_cast<uint16_t>(sizeof(CacheHeader));
+	header.schema = schema;
+	header.sourceCount = static_cast<uint32_t>(LayoutCacheSourceCount);
+	std::memcpy(header.sources, keys, sizeof(header.sources));
+	header.fileCount = static_cast<uint32_t>(m_files.size());
+	header.profileCount = static_cast<uint32_t>(m_profiles.size());
+	header.tabCount = static_cast<uint32_t>(m_tabs.size());
+	header.paneCount = static_cast<uint32_t>(m_panes.size());
+
+	uint64_t offset = AlignUp(sizeof(CacheHeader));
+	header.filesOffset = offset;
+	offset = AlignUp(offset + m_files.size() * sizeof(CacheFileRecord));
+	header.profilesOffset = offset;
+	offset = AlignUp(offset + m_profiles.size() * sizeof(CacheProfileRecord));
+	header.tabsOffset = offset;
+	offset = AlignUp(offset + m_tabs.size() * sizeof(CacheTabRecord));
+	header.panesOffset = offset;
+	offset = AlignUp(offset + m_panes.size() * sizeof(CachePaneRecord));
+	header.stringsOffset = offset;
+	header.stringsLength = m_strings.size();
+	offset += m_strings.size() * sizeof(char16_t);
+
+	std::vector<uint8_t> image(static_cast<size_t>(offset), 0);
+	auto put = [&image](uint64_t at, const void* data, size_t bytes) {
+		if (bytes)
+		{
+			std::memcpy(image.data() + at, data, bytes);
+		}
+	};
+	put(header.filesOffset, m_files.data(), m_files.size() * sizeof(CacheFileRecord));
+	put(header.profilesOffset, m_profiles.data(), m_profiles.size() * sizeof(CacheProfileRecord));
+	put(header.tabsOffset, m_tabs.data(), m_tabs.size() * sizeof(CacheTabRecord));
+	put(header.panesOffset, m_panes.data(), m_panes.size() * sizeof(CachePaneRecord));
+	put(header.stringsOffset, m_strings.data(), m_strings.size() * sizeof(char16_t));
+	header.payloadHash = ContentHash::Hash64(image.data() + sizeof(CacheHeader), image.size() - sizeof(CacheHeader));
+	put(0, &header, sizeof(header));
+
+	const std::filesystem::path target = LayoutCache::PathFor(folder);
+	std::filesystem::path temp = target;
+	temp += ".tmp";
+	{
+		std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+		if (!out)
+		{
+			return false;
+		}
+		out.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size()));
+		if (!out)
+		{
+			out.close();
+			std::error_code ignored;
+			std::filesystem::remove(temp, ignored);
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(temp, target, ec);
+	if (ec)
+	{
+		std::error_code ignored;
+		std::filesystem::remove(temp, ignored);
+		return false;
+	}
+	return true;
+}
+
+// --------------------------------------------------------------------------
+
+LayoutCacheReader::LayoutCacheReader() noexcept
+	: m_header(nullptr), m_files(nullptr), m_profiles(nullptr), m_tabs(nullptr), m_panes(nullptr), m_strings(nullptr)
+{
+}
+
+/**
+ * Maps the cache of a folder, validates its structure and checks every source key.
+ *
+ * @param folder The LocalState folder.
+ * @param schema The schema the caller expects.
+ * @param current Receives the current (unhashed) keys of the source files.
+ * @return Fresh if the records can be used; otherwise the reason they cannot.
+ */
+CacheStatus LayoutCacheReader::Open(
+	const std::filesystem::path& folder,
+	uint32_t schema,
+	CacheSourceKey (&current)[LayoutCacheSourceCount])
+{
+	Close();
+	LayoutCache::CaptureSources(folder, current, false);
+
+	std::error_code ec;
+	const std::filesystem::path path = LayoutCache::PathFor(folder);
+	if (!std::filesystem::exists(path, ec))
+	{
+		return CacheStatus::Missing;
+	}
+	if (!m_file.Open(path) || !Validate())
+	{
+		Close();
+		return CacheStatus::Corrupt;
+	}
+	if (m_header->schema != schema)
+	{
+		Close();
+		return CacheStatus::Stale;
+	}
+	for (size_t i = 0; i < LayoutCacheSourceCount; ++i)
+	{
+		if (!LayoutCache::SourceUnchanged(m_header->sources[i], current[i], folder / LayoutCache::SourceNames[i]))
+		{
+			Close();
+			return CacheStatus::Stale;
+		}
+	}
+	return CacheStatus::Fresh;
+}
+
+/**
+ * Releases the mapping and resets all record pointers.
+ */
+void LayoutCacheReader::Close() noexcept
+{
+	m_file.Close();
+	m_header = nullptr;
+	m_files = nullptr;
+	m_profiles = nullptr;
+	m_tabs = nullptr;
+	m_panes = nullptr;
+	m_strings = nullptr;
+}
+
+/**
+ * Validates the header, section bounds, payload hash and every cross-reference,
+ * so the accessors can be used without further checks.
+ *
+ * @return true if the mapped image is a well-formed cache of the current version.
+ */
+bool LayoutCacheReader::Validate() noexcept
+{
+	const uint8_t* base = m_file.data();
+	const size_t size = m_file.size();
+	if (size < sizeof(CacheHeader))
+	{
+		return false;
+	}
+
+	const CacheHeader* h = reinterpret_cast<const CacheHeader*>(base);
+	if (h->magic != LayoutCache::Magic
+		|| h->version != LayoutCache::Version
+		|| h->headerSize != sizeof(CacheHeader)
+		|| h->sourceCount != LayoutCacheSourceCount)
+	{
+		return false;
+	}
+	if (!SectionFits<CacheFileRecord>(h->filesOffset, h->fileCount, size)
+		|| !SectionFits<CacheProfileRecord>(h->profilesOffset, h->profileCount, size)
+		|| !SectionFits<CacheTabRecord>(h->tabsOffset, h->tabCount, size)
+		|| !SectionFits<CachePaneRecord>(h->panesOffset, h->paneCount, size)
+		|| !SectionFits<char16_t>(h->stringsOffset, h->stringsLength, size))
+	{
+		return false;
+	}
+	if (ContentHash::Hash64(base + sizeof(CacheHeader), size - sizeof(CacheHeader)) != h->payloadHash)
+	{
+		return false;
+	}
+
+	const auto* files = reinterpret_cast<const CacheFileRecord*>(base + h->filesOffset);
+	const auto* profiles = reinterpret_cast<const CacheProfileRecord*>(base + h->profilesOffset);
+	const auto* tabs = reinterpret_cast<const CacheTabRecord*>(base + h->tabsOffset);
+	const auto* panes = reinterpret_cast<const CachePaneRecord*>(base + h->panesOffset);
+
+	for (uint32_t i = 0; i < h->fileCount; ++i)
+	{
+		if (files[i].source >= LayoutCacheSourceCount
+			|| !RangeFits(files[i].firstProfile, files[i].profileCount, h->profileCount)
+			|| !RangeFits(files[i].firstTab, files[i].tabCount, h->tabCount))
+		{
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < h->profileCount; ++i)
+	{
+		if (!StringFits(profiles[i].name, h->stringsLength) || !StringFits(profiles[i].icon, h->stringsLength))
+		{
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < h->tabCount; ++i)
+	{
+		if (!StringFits(tabs[i].title, h->stringsLength) || !RangeFits(tabs[i].firstPane, tabs[i].paneCount, h->paneCount))
+		{
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < h->paneCount; ++i)
+	{
+		if (!StringFits(panes[i].profile, h->stringsLength)
+			|| !StringFits(panes[i].icon, h->stringsLength)
+			|| !StringFits(panes[i].commandline, h->stringsLength)
+			|| !StringFits(panes[i].startingDirectory, h->stringsLength)
+			|| !StringFits(panes[i].splitDirection, h->stringsLength))
+		{
+			return false;
+		}
+	}
+
+	m_header = h;
+	m_files = files;
+	m_profiles = profiles;
+	m_tabs = tabs;
+	m_panes = panes;
+	m_strings = reinterpret_cast<const char16_t*>(base + h->stringsOffset);
+	return true;
+}
@@ -0,0 +1,307 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include "DyadicLayout.h"
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// Number of source files tracked per LocalState folder: settings.json, state.json, elevated-state.json.
+		/// </summary>
+		constexpr size_t LayoutCacheSourceCount = 3;
+
+		/// <summary>
+		/// Identity of one source file at the time its contents were parsed.
+		/// </summary>
+		struct CacheSourceKey
+		{
+			uint64_t size;
+			int64_t lastWriteTime;   // std::filesystem::file_time_type ticks (FILETIME on Windows)
+			uint64_t contentHash;    // XXH64 of the contents, 0 when not computed
+			uint32_t present;
+			uint32_t reserved;
+		};
+
+		/// <summary>
+		/// Reference to a UTF-16 string in the cache string table (offset and length in char16_t units).
+		/// </summary>
+		struct CacheString
+		{
+			uint32_t offset;
+			uint32_t length;
+		};
+
+		/// <summary>
+		/// Marks a string that was null (as opposed to empty) when it was written.
+		/// </summary>
+		constexpr CacheString CacheNullString{ 0xFFFFFFFFu, 0 };
+
+		/// <summary>
+		/// One parsed source file; points at its profiles and tabs.
+		/// </summary>
+		struct CacheFileRecord
+		{
+			uint32_t source;          // index into LayoutCache::SourceNames
+			uint32_t flags;           // CacheFileHasTabs when the file produced tab states
+			uint32_t firstProfile;
+			uint32_t profileCount;
+			uint32_t firstTab;
+			uint32_t tabCount;
+		};
+
+		constexpr uint32_t CacheFileHasTabs = 0x1;
+
+		/// <summary>
+		/// A visible settings.json profile and its resolved icon.
+		/// </summary>
+		struct CacheProfileRecord
+		{
+			CacheString name;
+			CacheString icon;
+		};
+
+		/// <summary>
+		/// A replayed tab and the range of its panes.
+		/// </summary>
+		struct CacheTabRecord
+		{
+			CacheString title;
+			int32_t rows;
+			int32_t columns;
+			uint32_t firstPane;
+			uint32_t paneCount;
+		};
+
+		/// <summary>
+		/// A replayed pane: profile, icon, command line, starting directory, split direction, geometry and
+		/// grid placement.
+		/// </summary>
+		struct CachePaneRecord
+		{
+			CacheString profile;
+			CacheString icon;
+			CacheString commandline;
+			CacheString startingDirectory;
+			CacheString splitDirection;
+			double x;
+			double y;
+			double width;
+			double height;
+			GridPlacement placement;
+		};
+
+		/// <summary>
+		/// Fixed header at the start of every sidecar cache file.
+		/// </summary>
+		/// <remarks>
+		/// All sections follow the header, 8-byte aligned, in the order files, profiles, tabs, panes,
+		/// strings. The payload checksum covers everything after the header.
+		/// </remarks>
+		struct CacheHeader
+		{
+			uint32_t magic;
+			uint16_t version;
+			uint16_t headerSize;
+			uint32_t schema;
+			uint32_t sourceCount;
+			CacheSourceKey sources[LayoutCacheSourceCount];
+			uint32_t fileCount;
+			uint32_t profileCount;
+			uint32_t tabCount;
+			uint32_t paneCount;
+			uint64_t filesOffset;
+			uint64_t profilesOffset;
+			uint64_t tabsOffset;
+			uint64_t panesOffset;
+			uint64_t stringsOffset;
+			uint64_t stringsLength;   // in char16_t units
+			uint64_t payloadHash;
+		};
+
+		/// <summary>
+		/// Result of opening a sidecar cache.
+		/// </summary>
+		enum class CacheStatus
+		{
+			Fresh,      // the cache matches every source file and can be used instead of parsing
+			Missing,    // no cache file
+			Stale,      // a source file was added, removed or changed, or the schema differs
+			Corrupt     // the cache file is truncated or fails validation
+		};
+
+		/// <summary>
+		/// Naming and invalidation rules of the per-folder sidecar cache.
+		/// </summary>
+		/// <remarks>
+		/// A source file is unchanged when it is present in both states and has the same size and
+		/// either the same modification time or, if the time differs, the same content hash. Hashing is
+		/// therefore only paid for files that were touched (e.g. copied) without being modified.
+		/// </remarks>
+		class LayoutCache
+		{
+		public:
+			/// <summary>
+			/// Magic value 'WTLC' at the start of the cache file.
+			/// </summary>
+			static constexpr uint32_t Magic = 0x434C5457;
+
+			/// <summary>
+			/// Version of the binary format described by CacheHeader and the record structs.
+			/// </summary>
+			static constexpr uint16_t Version = 2;
+
+			/// <summary>
+			/// File name of the sidecar inside each LocalState folder.
+			/// </summary>
+			static constexpr const char* FileName = "WTLayoutManager.cache";
+
+			/// <summary>
+			/// Source file names, indexed by CacheFileRecord::source.
+			/// </summary>
+			static constexpr const char* SourceNames[LayoutCacheSourceCount] = { "settings.json", "state.json", "elevated-state.json" };
+
+			/// <summary>
+			/// Returns the sidecar path for a LocalState folder.
+			/// </summary>
+			WINAPIHELPERS_API static std::filesystem::path PathFor(const std::filesystem::path& folder);
+
+			/// <summary>
+			/// Stats (and optionally hashes) the source files of a folder.
+			/// </summary>
+			/// <param name="folder">The LocalState folder.</param>
+			/// <param name="keys">Receives one key per source file.</param>
+			/// <param name="hashContents">Whether to compute the content hash of present files.</param>
+			WINAPIHELPERS_API static void CaptureSources(
+				const std::filesystem::path& folder,
+				CacheSourceKey (&keys)[LayoutCacheSourceCount],
+				bool hashContents);
+
+			/// <summary>
+			/// Checks whether a stored key still describes the file currently on disk.
+			/// </summary>
+			/// <param name="stored">The key recorded in the cache.</param>
+			/// <param name="current">The key just captured without hashing.</param>
+			/// <param name="path">Path of the source file, hashed only if needed.</param>
+			WINAPIHELPERS_API static bool SourceUnchanged(
+				const CacheSourceKey& stored,
+				const CacheSourceKey& current,
+				const std::filesystem::path& path);
+		};
+
+		/// <summary>
+		/// Collects parsed records and writes them as a sidecar cache.
+		/// </summary>
+		/// <remarks>
+		/// Records are appended in order: BeginFile, then its profiles or tabs; BeginTab, then its panes.
+		/// Identical strings are stored once; a default-constructed string view is stored as null.
+		/// </remarks>
+		class LayoutCacheWriter
+		{
+		public:
+			WINAPIHELPERS_API LayoutCacheWriter();
+			WINAPIHELPERS_API ~LayoutCacheWriter();
+
+			LayoutCacheWriter(const LayoutCacheWriter&) = delete;
+			LayoutCacheWriter& operator=(const LayoutCacheWriter&) = delete;
+
+			WINAPIHELPERS_API void BeginFile(uint32_t source, bool hasTabs);
+			WINAPIHELPERS_API void AddProfile(std::u16string_view name, std::u16string_view icon);
+			WINAPIHELPERS_API void BeginTab(std::u16string_view title, int32_t rows, int32_t columns);
+			WINAPIHELPERS_API void AddPane(
+				std::u16string_view profile,
+				std::u16string_view icon,
+				std::u16string_view commandline,
+				std::u16string_view startingDirectory,
+				std::u16string_view splitDirection,
+				double x, double y, double width, double height,
+				const GridPlacement& placement);
+
+			/// <summary>
+			/// Writes the cache next to the source files, atomically replacing any previous one.
+			/// </summary>
+			/// <param name="folder">The LocalState folder.</param>
+			/// <param name="schema">Caller-defined version of the parsing rules that produced the records.</param>
+			/// <param name="keys">Source keys captured (with hashes) before the files were parsed.</param>
+			/// <returns>false if the cache could not be written; the folder is left without a partial file.</returns>
+			WINAPIHELPERS_API bool Save(
+				const std::filesystem::path& folder,
+				uint32_t schema,
+				const CacheSourceKey (&keys)[LayoutCacheSourceCount]) const;
+
+		private:
+			CacheString Intern(std::u16string_view s);
+
+			std::vector<CacheFileRecord> m_files;
+			std::vector<CacheProfileRecord> m_profiles;
+			std::vector<CacheTabRecord> m_tabs;
+			std::vector<CachePaneRecord> m_panes;
+			std::u16string m_strings;
+			std::unordered_map<std::u16string, CacheString> m_interned;
+		};
+
+		/// <summary>
+		/// Maps a sidecar cache and exposes its records in place.
+		/// </summary>
+		/// <remarks>
+		/// Nothing is copied: record pointers and string views refer directly into the mapping and stay
+		/// valid until the reader is closed or destroyed.
+		/// </remarks>
+		class LayoutCacheReader
+		{
+		public:
+			WINAPIHELPERS_API LayoutCacheReader() noexcept;
+
+			/// <summary>
+			/// Maps and validates the cache of a folder.
+			/// </summary>
+			/// <param name="folder">The LocalState folder.</param>
+			/// <param name="schema">The schema the caller expects.</param>
+			/// <param name="current">Receives the current keys of the source files (size and time only).</param>
+			WINAPIHELPERS_API CacheStatus Open(
+				const std::filesystem::path& folder,
+				uint32_t schema,
+				CacheSourceKey (&current)[LayoutCacheSourceCount]);
+
+			WINAPIHELPERS_API void Close() noexcept;
+
+			const CacheHeader& header() const noexcept { return *m_header; }
+			const CacheFileRecord* files() const noexcept { return m_files; }
+			const CacheProfileRecord* profiles() const noexcept { return m_profiles; }
+			const CacheTabRecord* tabs() const noexcept { return m_tabs; }
+			const CachePaneRecord* panes() const noexcept { return m_panes; }
+
+			/// <summary>
+			/// Returns a view of a cached string; null strings come back with a null data pointer.
+			/// </summary>
+			std::u16string_view str(const CacheString& s) const noexcept
+			{
+				if (s.offset == CacheNullString.offset)
+				{
+					return std::u16string_view();
+				}
+				return std::u16string_view(m_strings + s.offset, s.length);
+			}
+
+		private:
+			bool Validate() noexcept;
+
+			MappedFile m_file;
+			const CacheHeader* m_header;
+			const CacheFileRecord* m_files;
+			const CacheProfileRecord* m_profiles;
+			const CacheTabRecord* m_tabs;
+			const CachePaneRecord* m_panes;
+			const char16_t* m_strings;
+		};
+
+	}
+} // namespace WTLayoutManager::Services
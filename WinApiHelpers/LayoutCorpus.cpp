@@ -0,0 +1,452 @@
+﻿#include "pch.h"
+#include "LayoutCorpus.h"
+#include <cstdio>
+#include <fstream>
+#include <string_view>
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	// Stream tags: every kind of content draws from its own stream, so growing one dimension does not
+	// shift the random values of another.
+	constexpr uint64_t ProfileStream = 1;
+	constexpr uint64_t SettingsStream = 2;
+	constexpr uint64_t StateStream = 3;
+	constexpr uint64_t ElevatedStateStream = 4;
+
+	/**
+	 * splitmix64: tiny, fast, and good enough for test data; the output only depends on the seed.
+	 */
+	class Random
+	{
+	public:
+		explicit Random(uint64_t seed) noexcept : m_state(seed)
+		{
+		}
+
+		uint64_t Next() noexcept
+		{
+			uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+
+		/// Returns a value in [0, bound); 0 if bound is 0.
+		uint32_t Below(uint32_t bound) noexcept
+		{
+			return static_cast<uint32_t>(((Next() >> 32) * bound) >> 32);
+		}
+
+		bool Chance(uint32_t percent) noexcept
+		{
+			return Below(100) < percent;
+		}
+
+		template <typename T, size_t N>
+		const T& Pick(const T (&items)[N]) noexcept
+		{
+			return items[Below(static_cast<uint32_t>(N))];
+		}
+
+	private:
+		uint64_t m_state;
+	};
+
+	/**
+	 * Derives the seed of one independent stream.
+	 *
+	 * @param seed The corpus seed.
+	 * @param tag The kind of content.
+	 * @param index The snapshot or profile the stream belongs to.
+	 */
+	uint64_t StreamSeed(uint64_t seed, uint64_t tag, uint64_t index) noexcept
+	{
+		Random mix(seed ^ (tag * 0xD1B54A32D192ED03ull) ^ (index * 0x8CB92BA72F3D8DD7ull));
+		mix.Next();
+		return mix.Next();
+	}
+
+	constexpr std::string_view ProfileNames[] = {
+		"Windows PowerShell", "Command Prompt", "PowerShell", "Ubuntu", "Git Bash", "Azure Cloud Shell",
+		"Developer PowerShell for VS 2022", "Developer Command Prompt for VS 2022", "Debian", "PowerShell 7 Preview" };
+
+	constexpr std::string_view Sources[] = {
+		"", "", "Windows.Terminal.PowershellCore", "Windows.Terminal.Wsl", "Windows.Terminal.Azure",
+		"Windows.Terminal.VisualStudio" };
+
+	constexpr std::string_view Commandlines[] = {
+		"%SystemRoot%\\System32\\WindowsPowerShell\\v1.0\\powershell.exe",
+		"%SystemRoot%\\System32\\cmd.exe",
+		"\"C:\\Program Files\\Git\\bin\\bash.exe\" --login -i",
+		"wsl.exe -d Ubuntu",
+		"pwsh.exe -NoLogo -Command \"Set-Location ~\"" };
+
+	constexpr std::string_view Directories[] = {
+		"%USERPROFILE%",
+		"C:\\src\\WTLayoutManager",
+		"D:\\work\\build\\x64\\Release\\",
+		"\\\\wsl$\\Ubuntu\\home\\dev",
+		"C:\\Users\\Public\\Documents\\Projets \xC3\xA9t\xC3\xA9" };
+
+	constexpr std::string_view TabTitles[] = {
+		"build", "logs", "server", "\"quoted\" title", "\xD0\x9F\xD1\x80\xD0\xBE\xD0\xB5\xD0\xBA\xD1\x82",
+		"C:\\tmp", "tab\twith tab" };
+
+	constexpr std::string_view Schemes[] = {
+		"Campbell", "Campbell Powershell", "One Half Dark", "One Half Light", "Solarized Dark", "Solarized Light",
+		"Tango Dark", "Vintage" };
+
+	void AppendString(std::string& out, std::string_view value)
+	{
+		static constexpr char Hex[] = "0123456789abcdef";
+		out.push_back('"');
+		for (const char c : value)
+		{
+			switch (c)
+			{
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\n': out += "\\n"; break;
+			case '\r': out += "\\r"; break;
+			case '\t': out += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+				{
+					out += "\\u00";
+					out.push_back(Hex[(c >> 4) & 0xF]);
+					out.push_back(Hex[c & 0xF]);
+				}
+				else
+				{
+					out.push_back(c);
+				}
+			}
+		}
+		out.push_back('"');
+	}
+
+	void AppendMember(std::string& out, std::string_view name, std::string_view value)
+	{
+		AppendString(out, name);
+		out.push_back(':');
+		AppendString(out, value);
+	}
+
+	void AppendGuid(std::string& out, Random& random)
+	{
+		static constexpr char Hex[] = "0123456789abcdef";
+		const uint64_t high = random.Next();
+		const uint64_t low = random.Next();
+		char text[39];
+		size_t n = 0;
+		text[n++] = '{';
+		for (int i = 0; i < 32; ++i)
+		{
+			if (i == 8 || i == 12 || i == 16 || i == 20)
+			{
+				text[n++] = '-';
+			}
+			const uint64_t word = i < 16 ? high : low;
+			text[n++] = Hex[(word >> (60 - 4 * (i % 16))) & 0xF];
+		}
+		text[n++] = '}';
+		AppendString(out, std::string_view(text, n));
+	}
+
+	std::string ProfileName(uint32_t index)
+	{
+		constexpr uint32_t count = static_cast<uint32_t>(std::size(ProfileNames));
+		std::string name(ProfileNames[index % count]);
+		if (index >= count)
+		{
+			name += ' ';
+			name += std::to_string(index / count + 1);
+		}
+		return name;
+	}
+
+	/// The guid and source of a profile are the same in every snapshot, as after copying a folder.
+	Random ProfileRandom(const LayoutCorpusShape& shape, uint32_t index) noexcept
+	{
+		return Random(StreamSeed(shape.seed, ProfileStream, index));
+	}
+
+	/**
+	 * Appends the fields shared by newTab and splitPane.
+	 *
+	 * @param out The document.
+	 * @param shape The corpus shape.
+	 * @param random The stream of the state file.
+	 */
+	void AppendPaneFields(std::string& out, const LayoutCorpusShape& shape, Random& random)
+	{
+		if (random.Chance(50))
+		{
+			out.push_back(',');
+			AppendMember(out, "commandline", random.Pick(Commandlines));
+		}
+		out.push_back(',');
+		// One pane in twenty names a profile that settings.json no longer lists.
+		if (shape.profileCount == 0 || random.Chance(5))
+		{
+			AppendMember(out, "profile", "Retired Profile");
+		}
+		else
+		{
+			AppendMember(out, "profile", ProfileName(random.Below(shape.profileCount)));
+		}
+		out += ",\"sessionId\":";
+		AppendGuid(out, random);
+	}
+
+	void AppendTab(std::string& out, const LayoutCorpusShape& shape, Random& random, uint32_t tab)
+	{
+		out += "{\"action\":\"newTab\"";
+		AppendPaneFields(out, shape, random);
+		out.push_back(',');
+		AppendMember(out, "startingDirectory", random.Pick(Directories));
+		out += ",\"suppressApplicationTitle\":false,";
+		AppendMember(out, "tabTitle", std::string(random.Pick(TabTitles)) + ' ' + std::to_string(tab + 1));
+		out.push_back('}');
+
+		// Split every pane of a level, one level at a time: the first pane always splits, so the tab
+		// reaches the requested depth, the others split three times in four.
+		const uint32_t depth = shape.splitDepth < LayoutCorpus::MaxSplitDepth ? shape.splitDepth : LayoutCorpus::MaxSplitDepth;
+		uint32_t panes = 1;
+		uint32_t focus = 0;
+		for (uint32_t level = 0; level < depth; ++level)
+		{
+			const uint32_t levelPanes = panes;
+			for (uint32_t pane = 0; pane < levelPanes; ++pane)
+			{
+				if (pane != 0 && !random.Chance(75))
+				{
+					continue;
+				}
+				if (focus != pane)
+				{
+					out += ",{\"action\":\"focusPane\",\"id\":";
+					out += std::to_string(pane);
+					out.push_back('}');
+				}
+				out += ",{\"action\":\"splitPane\"";
+				AppendPaneFields(out, shape, random);
+				out += ",\"size\":0.5,";
+				const bool second = random.Chance(50);
+				AppendMember(out, "split", level % 2 == 0 ? (second ? "left" : "right") : (second ? "up" : "down"));
+				if (random.Chance(50))
+				{
+					out.push_back(',');
+					AppendMember(out, "startingDirectory", random.Pick(Directories));
+				}
+				out += ",\"suppressApplicationTitle\":false}";
+				focus = panes++;
+			}
+		}
+
+		if (panes > 1 && random.Chance(50))
+		{
+			out += ",{\"action\":\"moveFocus\",";
+			AppendMember(out, "direction", random.Chance(50) ? "nextInOrder" : "previousInOrder");
+			out.push_back('}');
+		}
+	}
+
+	bool WriteFile(const fs::path& path, const std::string& content, std::error_code& ec)
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out.write(content.data(), static_cast<std::streamsize>(content.size()));
+		out.close();
+		if (!out)
+		{
+			ec = std::make_error_code(std::errc::io_error);
+			return false;
+		}
+		return true;
+	}
+}
+
+/**
+ * Renders the settings.json of one snapshot.
+ *
+ * Indented like the file Windows Terminal writes: one profile, scheme or action per line. Only
+ * defaultProfile differs between snapshots.
+ *
+ * @param shape The corpus shape.
+ * @param snapshot Index of the snapshot.
+ * @return The document, UTF-8.
+ */
+std::string LayoutCorpus::RenderSettings(const LayoutCorpusShape& shape, uint32_t snapshot)
+{
+	Random random(StreamSeed(shape.seed, SettingsStream, snapshot));
+	std::string out;
+	out.reserve(512 + static_cast<size_t>(shape.profileCount) * 192);
+
+	out += "{\r\n    \"$help\": \"https://aka.ms/terminal-documentation\",\r\n";
+	out += "    \"$schema\": \"https://aka.ms/terminal-profiles-schema\",\r\n";
+	out += "    \"actions\": \r\n    [\r\n";
+	out += "        { \"command\": { \"action\": \"copy\", \"singleLine\": false }, \"id\": \"User.copy.644BA8F2\", \"keys\": \"ctrl+c\" },\r\n";
+	out += "        { \"command\": \"paste\", \"id\": \"User.paste\", \"keys\": \"ctrl+v\" },\r\n";
+	out += "        { \"command\": { \"action\": \"splitPane\", \"split\": \"auto\", \"splitMode\": \"duplicate\" }, \"id\": \"User.splitPane.A6751878\", \"keys\": \"alt+shift+d\" }\r\n";
+	out += "    ],\r\n    \"copyFormatting\": \"none\",\r\n    \"copyOnSelect\": false,\r\n";
+	if (shape.profileCount != 0)
+	{
+		Random profile = ProfileRandom(shape, random.Below(shape.profileCount));
+		out += "    \"defaultProfile\": ";
+		AppendGuid(out, profile);
+		out += ",\r\n";
+	}
+	out += "    \"newTabMenu\": \r\n    [\r\n        { \"type\": \"remainingProfiles\" }\r\n    ],\r\n";
+	out += "    \"profiles\": \r\n    {\r\n        \"defaults\": { \"font\": { \"face\": \"Cascadia Mono\" } },\r\n";
+	out += "        \"list\": \r\n        [\r\n";
+	for (uint32_t i = 0; i < shape.profileCount; ++i)
+	{
+		Random profile = ProfileRandom(shape, i);
+		out += "            { ";
+		std::string guid;
+		AppendGuid(guid, profile);
+		const std::string_view source = profile.Pick(Sources);
+		if (source.empty())
+		{
+			AppendMember(out, "commandline", profile.Pick(Commandlines));
+			out += ", ";
+		}
+		out += "\"guid\": ";
+		out += guid;
+		out += ", \"hidden\": ";
+		out += profile.Chance(10) ? "true" : "false";
+		switch (profile.Below(4))
+		{
+		case 0:
+			out += ", ";
+			AppendMember(out, "icon", "ms-appx:///ProfileIcons/" + guid.substr(1, guid.size() - 2) + ".png");
+			break;
+		case 1:
+			out += ", ";
+			AppendMember(out, "icon", "%SystemRoot%\\System32\\cmd.exe");
+			break;
+		default:
+			break;
+		}
+		out += ", ";
+		AppendMember(out, "name", ProfileName(i));
+		if (!source.empty())
+		{
+			out += ", ";
+			AppendMember(out, "source", source);
+		}
+		out += i + 1 < shape.profileCount ? " },\r\n" : " }\r\n";
+	}
+	out += "        ]\r\n    },\r\n    \"schemes\": \r\n    [\r\n";
+	for (size_t i = 0; i < std::size(Schemes); ++i)
+	{
+		out += "        { \"background\": \"#0C0C0C\", \"black\": \"#0C0C0C\", \"blue\": \"#0037DA\", \"foreground\": \"#CCCCCC\", ";
+		AppendMember(out, "name", Schemes[i]);
+		out += i + 1 < std::size(Schemes) ? " },\r\n" : " }\r\n";
+	}
+	out += "    ],\r\n    \"themes\": []\r\n}";
+	return out;
+}
+
+/**
+ * Renders the state.json (or elevated-state.json) of one snapshot.
+ *
+ * Compact, like the file Windows Terminal writes. Every window has tabCount tabs of up to
+ * 2^splitDepth panes and ends with a switchToTab.
+ *
+ * @param shape The corpus shape.
+ * @param snapshot Index of the snapshot.
+ * @param elevated true for elevated-state.json, which draws from its own stream.
+ * @return The document, UTF-8.
+ */
+std::string LayoutCorpus::RenderState(const LayoutCorpusShape& shape, uint32_t snapshot, bool elevated)
+{
+	Random random(StreamSeed(shape.seed, elevated ? ElevatedStateStream : StateStream, snapshot));
+	std::string out;
+
+	out += "{\"dismissedMessages\":[\"setAsDefault\"],\"generatedProfiles\":[";
+	bool first = true;
+	for (uint32_t i = 0; i < shape.profileCount; ++i)
+	{
+		Random profile = ProfileRandom(shape, i);
+		std::string guid;
+		AppendGuid(guid, profile);
+		if (!profile.Pick(Sources).empty())
+		{
+			if (!first)
+			{
+				out.push_back(',');
+			}
+			out += guid;
+			first = false;
+		}
+	}
+	out += "],\"persistedWindowLayouts\":[";
+	for (uint32_t window = 0; window < shape.windowCount; ++window)
+	{
+		if (window != 0)
+		{
+			out.push_back(',');
+		}
+		out += "{\"initialPosition\":\"";
+		out += std::to_string(random.Below(1600));
+		out.push_back(',');
+		out += std::to_string(random.Below(900));
+		out += "\",\"initialSize\":{\"height\":";
+		out += std::to_string(400 + random.Below(800));
+		out += ",\"width\":";
+		out += std::to_string(600 + random.Below(1400));
+		out += "},\"launchMode\":\"default\",\"tabLayout\":[";
+		for (uint32_t tab = 0; tab < shape.tabCount; ++tab)
+		{
+			if (tab != 0)
+			{
+				out.push_back(',');
+			}
+			AppendTab(out, shape, random, tab);
+		}
+		if (shape.tabCount != 0)
+		{
+			out += ",{\"action\":\"switchToTab\",\"index\":";
+			out += std::to_string(random.Below(shape.tabCount));
+			out.push_back('}');
+		}
+		out += "]}";
+	}
+	out += "]}";
+	return out;
+}
+
+/**
+ * Writes the corpus.
+ *
+ * @param root The folder the snapshot folders are created in; created if needed.
+ * @param shape The corpus shape.
+ * @param ec Receives the error.
+ * @return false on error.
+ */
+bool LayoutCorpus::Generate(const fs::path& root, const LayoutCorpusShape& shape, std::error_code& ec)
+{
+	ec.clear();
+	for (uint32_t snapshot = 0; snapshot < shape.snapshotCount; ++snapshot)
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "snapshot-%05u", snapshot);
+		const fs::path folder = root / name;
+		fs::create_directories(folder, ec);
+		if (ec)
+		{
+			return false;
+		}
+		if (!WriteFile(folder / "settings.json", RenderSettings(shape, snapshot), ec) ||
+			!WriteFile(folder / "state.json", RenderState(shape, snapshot, false), ec) ||
+			(shape.elevatedState && !WriteFile(folder / "elevated-state.json", RenderState(shape, snapshot, true), ec)))
+		{
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,65 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// The size of a synthetic corpus; every dimension can be grown on its own.
+		/// </summary>
+		struct LayoutCorpusShape
+		{
+			uint64_t seed;           // the same seed and shape always produce the same bytes
+			uint32_t snapshotCount;  // LocalState folders
+			uint32_t windowCount;    // persisted windows per state file
+			uint32_t tabCount;       // tabs per window
+			uint32_t splitDepth;     // split levels per tab: up to 2^splitDepth panes; capped at MaxSplitDepth
+			uint32_t profileCount;   // profiles in settings.json
+			bool elevatedState;      // also write elevated-state.json
+		};
+
+		/// <summary>
+		/// Generates deterministic settings.json, state.json and elevated-state.json trees.
+		/// </summary>
+		/// <remarks>
+		/// Used to measure how parsing, replay and folder loading scale with the number of snapshots,
+		/// windows, tabs, panes and profiles. The files follow what Windows Terminal writes: every pane
+		/// is a newTab or splitPane action naming a profile of the folder's settings.json (plus the odd
+		/// unknown one), panes are reached through focusPane and moveFocus, and each window ends with a
+		/// switchToTab; settings.json also carries schemes, actions and generated profiles for the
+		/// scanner to skip. All randomness comes from a splitmix64 stream derived from the seed and the
+		/// snapshot index, so a snapshot renders the same whatever the snapshot count.
+		/// </remarks>
+		class LayoutCorpus
+		{
+		public:
+			static constexpr uint32_t MaxSplitDepth = 12;
+
+			/// <summary>
+			/// Renders the settings.json of one snapshot.
+			/// </summary>
+			WINAPIHELPERS_API static std::string RenderSettings(const LayoutCorpusShape& shape, uint32_t snapshot);
+
+			/// <summary>
+			/// Renders the state.json (or elevated-state.json) of one snapshot.
+			/// </summary>
+			WINAPIHELPERS_API static std::string RenderState(const LayoutCorpusShape& shape, uint32_t snapshot, bool elevated);
+
+			/// <summary>
+			/// Writes the corpus: one folder per snapshot, named snapshot-00000 and so on, under root.
+			/// Existing files are overwritten; other files are left alone.
+			/// </summary>
+			/// <returns>false on error, with ec set.</returns>
+			WINAPIHELPERS_API static bool Generate(
+				const std::filesystem::path& root,
+				const LayoutCorpusShape& shape,
+				std::error_code& ec);
+		};
+
+	}
+} // namespace WTLayoutManager::Services
@@ -0,0 +1,155 @@
+﻿#include "pch.h"
+#include "MappedFile.h"
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace WTLayoutManager::Services;
+
+/**
+ * \brief Constructor, creates an empty (unmapped) instance.
+ */
+MappedFile::MappedFile() noexcept
+	: m_data(nullptr), m_size(0), m_open(false)
+{
+}
+
+/**
+ * \brief Destructor, releases the mapping.
+ */
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+/**
+ * \brief Move constructor, takes ownership of the mapping of \a other.
+ */
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: m_data(std::exchange(other.m_data, nullptr)),
+	  m_size(std::exchange(other.m_size, 0)),
+	  m_open(std::exchange(other.m_open, false))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		m_data = std::exchange(other.m_data, nullptr);
+		m_size = std::exchange(other.m_size, 0);
+		m_open = std::exchange(other.m_open, false);
+	}
+	return *this;
+}
+
+/**
+ * Maps a whole file read-only.
+ *
+ * The file and mapping handles are closed right away; the view alone keeps the mapping alive.
+ *
+ * @param path The file to map.
+ * @return true on success, including for empty files.
+ */
+bool MappedFile::Open(const std::filesystem::path& path) noexcept
+{
+	Close();
+
+#if defined(_WIN32)
+	HANDLE hFile = ::CreateFileW(path.c_str(), GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size{};
+	if (!::GetFileSizeEx(hFile, &size) || static_cast<unsigned long long>(size.QuadPart) > SIZE_MAX)
+	{
+		::CloseHandle(hFile);
+		return false;
+	}
+	if (size.QuadPart == 0)
+	{
+		::CloseHandle(hFile);
+		m_open = true;
+		return true;
+	}
+
+	HANDLE hMapping = ::CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	::CloseHandle(hFile);
+	if (!hMapping)
+	{
+		return false;
+	}
+
+	void* view = ::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	::CloseHandle(hMapping);
+	if (!view)
+	{
+		return false;
+	}
+
+	m_data = static_cast<const uint8_t*>(view);
+	m_size = static_cast<size_t>(size.QuadPart);
+#else
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat st {};
+	if (::fstat(fd, &st) != 0 || st.st_size < 0)
+	{
+		::close(fd);
+		return false;
+	}
+	if (st.st_size == 0)
+	{
+		::close(fd);
+		m_open = true;
+		return true;
+	}
+
+	void* view = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (view == MAP_FAILED)
+	{
+		return false;
+	}
+
+	m_data = static_cast<const uint8_t*>(view);
+	m_size = static_cast<size_t>(st.st_size);
+#endif
+
+	m_open = true;
+	return true;
+}
+
+/**
+ * Releases the mapping, if any. Safe to call repeatedly.
+ */
+void MappedFile::Close() noexcept
+{
+	if (m_data)
+	{
+#if defined(_WIN32)
+		::UnmapViewOfFile(m_data);
+#else
+		::munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+	}
+	m_data = nullptr;
+	m_size = 0;
+	m_open = false;
+}
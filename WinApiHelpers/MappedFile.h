@@ -0,0 +1,53 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// Read-only memory mapping of a whole file.
+		/// </summary>
+		/// <remarks>
+		/// Uses CreateFileMapping / MapViewOfFile on Windows and mmap elsewhere. The file is opened with
+		/// full sharing so Windows Terminal can keep rewriting it while it is mapped. Empty files are
+		/// "mapped" successfully with a null data pointer and a size of 0.
+		/// </remarks>
+		class MappedFile
+		{
+		public:
+			WINAPIHELPERS_API MappedFile() noexcept;
+			WINAPIHELPERS_API ~MappedFile();
+
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator=(const MappedFile&) = delete;
+
+			WINAPIHELPERS_API MappedFile(MappedFile&& other) noexcept;
+			WINAPIHELPERS_API MappedFile& operator=(MappedFile&& other) noexcept;
+
+			/// <summary>
+			/// Maps the given file, releasing any previous mapping.
+			/// </summary>
+			/// <returns>false if the file could not be opened or mapped.</returns>
+			WINAPIHELPERS_API bool Open(const std::filesystem::path& path) noexcept;
+
+			/// <summary>
+			/// Releases the mapping.
+			/// </summary>
+			WINAPIHELPERS_API void Close() noexcept;
+
+			const uint8_t* data() const noexcept { return m_data; }
+			size_t size() const noexcept { return m_size; }
+			bool is_open() const noexcept { return m_open; }
+
+		private:
+			const uint8_t* m_data;
+			size_t m_size;
+			bool m_open;
+		};
+
+	}
+} // namespace WTLayoutManager::Services
@@ -0,0 +1,81 @@
+﻿#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// Unbounded lock-free multi-producer / single-consumer queue.
+		/// </summary>
+		/// <remarks>
+		/// Node-based (Vyukov): Push is one atomic exchange and never blocks; TryPop may only be called
+		/// from one thread at a time. A push that is still linking its node is not yet visible, so TryPop
+		/// can briefly report an empty queue while a producer is mid-push; consumers simply poll again.
+		/// Native only: not for inclusion from /clr translation units.
+		/// </remarks>
+		template <typename T>
+		class MpscQueue
+		{
+		public:
+			MpscQueue() : m_head(new Node()), m_tail(m_head.load(std::memory_order_relaxed))
+			{
+			}
+
+			~MpscQueue()
+			{
+				Node* node = m_tail;
+				while (node != nullptr)
+				{
+					Node* next = node->next.load(std::memory_order_relaxed);
+					delete node;
+					node = next;
+				}
+			}
+
+			MpscQueue(const MpscQueue&) = delete;
+			MpscQueue& operator=(const MpscQueue&) = delete;
+
+			/// <summary>
+			/// Appends a value; safe to call from any number of threads.
+			/// </summary>
+			void Push(T value)
+			{
+				Node* node = new Node();
+				node->value = std::move(value);
+				Node* previous = m_head.exchange(node, std::memory_order_acq_rel);
+				previous->next.store(node, std::memory_order_release);
+			}
+
+			/// <summary>
+			/// Removes the oldest value; consumer thread only.
+			/// </summary>
+			/// <returns>false if no completed push is available.</returns>
+			bool TryPop(T& value)
+			{
+				Node* tail = m_tail;
+				Node* next = tail->next.load(std::memory_order_acquire);
+				if (next == nullptr)
+				{
+					return false;
+				}
+				value = std::move(next->value);
+				m_tail = next; // next becomes the new stub
+				delete tail;
+				return true;
+			}
+
+		private:
+			struct Node
+			{
+				std::atomic<Node*> next{ nullptr };
+				T value{};
+			};
+
+			alignas(64) std::atomic<Node*> m_head;   // producers
+			alignas(64) Node* m_tail;                // consumer
+		};
+
+	}
+} // namespace WTLayoutManager::Services
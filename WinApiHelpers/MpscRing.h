@@ -0,0 +1,118 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// Bounded lock-free multi-producer / single-consumer ring.
+		/// </summary>
+		/// <remarks>
+		/// Every cell carries a sequence number (Vyukov): a producer claims a cell with one compare-exchange
+		/// on the enqueue position and publishes it by storing the sequence, so TryPush never waits and
+		/// never allocates; when the ring is full it fails and the caller decides what to drop. Unlike
+		/// MpscQueue the memory is allocated once. TryPop may only be called from one thread at a time.
+		/// Native only: not for inclusion from /clr translation units.
+		/// </remarks>
+		template <typename T>
+		class MpscRing
+		{
+		public:
+			/// <summary>
+			/// Creates a ring of at least capacity cells, rounded up to a power of two.
+			/// </summary>
+			explicit MpscRing(size_t capacity)
+			{
+				size_t size = 2;
+				while (size < capacity)
+				{
+					size <<= 1;
+				}
+				m_mask = size - 1;
+				m_cells = std::make_unique<Cell[]>(size);
+				for (size_t i = 0; i < size; ++i)
+				{
+					m_cells[i].sequence.store(i, std::memory_order_relaxed);
+				}
+			}
+
+			MpscRing(const MpscRing&) = delete;
+			MpscRing& operator=(const MpscRing&) = delete;
+
+			size_t Capacity() const noexcept
+			{
+				return m_mask + 1;
+			}
+
+			/// <summary>
+			/// Claims a cell and fills it through write(T&amp;); safe to call from any number of threads.
+			/// </summary>
+			/// <returns>false if the ring is full.</returns>
+			template <typename Writer>
+			bool TryPush(Writer&& write) noexcept
+			{
+				size_t position = m_enqueue.load(std::memory_order_relaxed);
+				Cell* cell;
+				for (;;)
+				{
+					cell = &m_cells[position & m_mask];
+					const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+					const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+					if (difference == 0)
+					{
+						if (m_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+						{
+							break;
+						}
+					}
+					else if (difference < 0)
+					{
+						return false; // the consumer has not freed this cell yet
+					}
+					else
+					{
+						position = m_enqueue.load(std::memory_order_relaxed);
+					}
+				}
+				write(cell->value);
+				cell->sequence.store(position + 1, std::memory_order_release);
+				return true;
+			}
+
+			/// <summary>
+			/// Hands the oldest value to read(T&amp;) and frees its cell; consumer thread only.
+			/// </summary>
+			/// <returns>false if no completed push is available.</returns>
+			template <typename Reader>
+			bool TryPop(Reader&& read)
+			{
+				Cell& cell = m_cells[m_dequeue & m_mask];
+				if (cell.sequence.load(std::memory_order_acquire) != m_dequeue + 1)
+				{
+					return false;
+				}
+				read(cell.value);
+				cell.sequence.store(m_dequeue + m_mask + 1, std::memory_order_release);
+				++m_dequeue;
+				return true;
+			}
+
+		private:
+			struct Cell
+			{
+				std::atomic<size_t> sequence{ 0 };
+				T value{};
+			};
+
+			std::unique_ptr<Cell[]> m_cells;
+			size_t m_mask = 0;
+			alignas(64) std::atomic<size_t> m_enqueue{ 0 };   // producers
+			alignas(64) size_t m_dequeue = 0;                 // consumer
+		};
+
+	}
+} // namespace WTLayoutManager::Services
@@ -0,0 +1,549 @@
+﻿#include "pch.h"
+#include "NativeLog.h"
+#include "MpscRing.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace WTLayoutManager::Services;
+namespace fs = std::filesystem;
+
+namespace
+{
+	/// How long the writer sleeps when the ring is empty; records wait at most this long to be written.
+	constexpr std::chrono::milliseconds WriterInterval{ 50 };
+
+	constexpr size_t TextCapacity = 128;
+
+	/// One binary record, 256 bytes: everything a line needs, copied when the record is written.
+	struct LogRecord
+	{
+		struct Arg
+		{
+			const char* name;
+			union
+			{
+				int64_t i;
+				uint64_t u;
+			};
+			LogArg::Kind kind;
+			uint8_t textOffset;
+			uint8_t textLength;
+		};
+
+		int64_t unixNanoseconds;
+		uint32_t threadId;
+		uint32_t code;
+		const char* event;
+		LogLevel level;
+		uint8_t argCount;
+		Arg args[NativeLog::MaxArgs];
+		char text[TextCapacity];
+	};
+
+	static_assert(TextCapacity <= 255, "Text offsets are bytes");
+
+	constexpr const char* LevelNames[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR" };
+
+	struct LogState
+	{
+		std::mutex control;                         // Start and Stop only
+		std::atomic<bool> running{ false };
+		std::atomic<uint8_t> minimumLevel{ static_cast<uint8_t>(LogLevel::Info) };
+		std::atomic<uint64_t> dropped{ 0 };
+
+		// Allocated by the first Start and never replaced, so a producer that raced a Stop still
+		// pushes into valid memory; its record is written after the next Start.
+		std::unique_ptr<MpscRing<LogRecord>> ring;
+
+		std::mutex wakeLock;
+		std::condition_variable wake;
+		bool stopRequested = false;
+		std::thread writer;
+
+		// Writer thread only.
+		NativeLogOptions options;
+		fs::path path;
+		std::ofstream file;
+		uint64_t fileSize = 0;
+		uint64_t reportedDrops = 0;
+		std::string lines;
+
+		void Run();
+		bool Drain();
+		void Flush();
+		void Roll();
+	};
+
+	/**
+	 * Returns the process-wide log. It is never destroyed: a writer thread still running at exit must
+	 * not meet a destroyed std::thread.
+	 */
+	LogState& State()
+	{
+		static LogState* const state = new LogState();
+		return *state;
+	}
+
+	uint32_t CurrentThreadId() noexcept
+	{
+#if defined(_WIN32)
+		return ::GetCurrentThreadId();
+#else
+		static thread_local const uint32_t id = static_cast<uint32_t>(::syscall(SYS_gettid));
+		return id;
+#endif
+	}
+
+	/**
+	 * Encodes UTF-16 (or, where wchar_t is 32 bits, UTF-32) text as UTF-8, stopping before the first
+	 * character that does not fit.
+	 *
+	 * @return The number of bytes written.
+	 */
+	size_t EncodeUtf8(const wchar_t* text, size_t length, char* out, size_t room) noexcept
+	{
+		size_t written = 0;
+		for (size_t i = 0; i < length; ++i)
+		{
+			uint32_t c = static_cast<uint32_t>(text[i]);
+			if (sizeof(wchar_t) == 2 && c >= 0xD800 && c <= 0xDBFF && i + 1 < length)
+			{
+				const uint32_t low = static_cast<uint32_t>(text[i + 1]);
+				if (low >= 0xDC00 && low <= 0xDFFF)
+				{
+					c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+					++i;
+				}
+			}
+			if ((c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF)
+			{
+				c = 0xFFFD;
+			}
+			const size_t size = c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+			if (written + size > room)
+			{
+				break;
+			}
+			char* p = out + written;
+			switch (size)
+			{
+			case 1:
+				p[0] = static_cast<char>(c);
+				break;
+			case 2:
+				p[0] = static_cast<char>(0xC0 | (c >> 6));
+				p[1] = static_cast<char>(0x80 | (c & 0x3F));
+				break;
+			case 3:
+				p[0] = static_cast<char>(0xE0 | (c >> 12));
+				p[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+				p[2] = static_cast<char>(0x80 | (c & 0x3F));
+				break;
+			default:
+				p[0] = static_cast<char>(0xF0 | (c >> 18));
+				p[1] = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+				p[2] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+				p[3] = static_cast<char>(0x80 | (c & 0x3F));
+				break;
+			}
+			written += size;
+		}
+		return written;
+	}
+
+	/**
+	 * Copies UTF-8 text, cutting it at a character boundary.
+	 *
+	 * @return The number of bytes written.
+	 */
+	size_t CopyUtf8(const char* text, size_t length, char* out, size_t room) noexcept
+	{
+		size_t size = std::min(length, room);
+		if (size < length)
+		{
+			while (size > 0 && (static_cast<unsigned char>(text[size]) & 0xC0) == 0x80)
+			{
+				--size;
+			}
+		}
+		std::copy(text, text + size, out);
+		return size;
+	}
+
+	void AppendTimestamp(std::string& line, int64_t unixNanoseconds)
+	{
+		using namespace std::chrono;
+		const sys_time<nanoseconds> time{ nanoseconds(unixNanoseconds) };
+		const sys_days day = floor<days>(time);
+		const year_month_day date{ day };
+		const hh_mm_ss<microseconds> clock{ floor<microseconds>(time - day) };
+		char buffer[40];
+		const int size = std::snprintf(buffer, sizeof(buffer), "%04d-%02u-%02uT%02d:%02d:%02d.%06lldZ",
+			static_cast<int>(date.year()), static_cast<unsigned>(date.month()), static_cast<unsigned>(date.day()),
+			static_cast<int>(clock.hours().count()), static_cast<int>(clock.minutes().count()),
+			static_cast<int>(clock.seconds().count()), static_cast<long long>(clock.subseconds().count()));
+		line.append(buffer, static_cast<size_t>(size));
+	}
+
+	/**
+	 * Appends a text value, quoted and escaped when it is empty or contains spaces, quotes, '=' or
+	 * control characters.
+	 */
+	void AppendValue(std::string& line, std::string_view value)
+	{
+		const bool quote = value.empty() || std::any_of(value.begin(), value.end(), [](char c) {
+			return c == ' ' || c == '"' || c == '=' || static_cast<unsigned char>(c) < 0x20;
+		});
+		if (!quote)
+		{
+			line.append(value);
+			return;
+		}
+		line.push_back('"');
+		for (char c : value)
+		{
+			switch (c)
+			{
+			case '"': line.append("\\\""); break;
+			case '\\': line.append("\\\\"); break;
+			case '\n': line.append("\\n"); break;
+			case '\r': line.append("\\r"); break;
+			case '\t': line.append("\\t"); break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+				{
+					char escaped[8];
+					std::snprintf(escaped, sizeof(escaped), "\\x%02x", static_cast<unsigned>(static_cast<unsigned char>(c)));
+					line.append(escaped);
+				}
+				else
+				{
+					line.push_back(c);
+				}
+				break;
+			}
+		}
+		line.push_back('"');
+	}
+
+	/**
+	 * Formats a record as one logfmt line:
+	 * 2026-01-02T03:04:05.678901Z ERROR [1234] launch.create_process code=0x00000005 app="C:\\x y\\wt.exe"
+	 */
+	void AppendLine(std::string& line, const LogRecord& record)
+	{
+		AppendTimestamp(line, record.unixNanoseconds);
+		line.push_back(' ');
+		line.append(LevelNames[std::min<size_t>(static_cast<size_t>(record.level), std::size(LevelNames) - 1)]);
+		line.append(" [");
+		line.append(std::to_string(record.threadId));
+		line.append("] ");
+		line.append(record.event != nullptr ? record.event : "-");
+		if (record.code != 0)
+		{
+			char code[24];
+			std::snprintf(code, sizeof(code), " code=0x%08X", static_cast<unsigned>(record.code));
+			line.append(code);
+		}
+		for (uint8_t a = 0; a < record.argCount; ++a)
+		{
+			const LogRecord::Arg& arg = record.args[a];
+			line.push_back(' ');
+			line.append(arg.name != nullptr ? arg.name : "arg");
+			line.push_back('=');
+			switch (arg.kind)
+			{
+			case LogArg::Kind::Int:
+				line.append(std::to_string(arg.i));
+				break;
+			case LogArg::Kind::UInt:
+				line.append(std::to_string(arg.u));
+				break;
+			default:
+				AppendValue(line, std::string_view(record.text + arg.textOffset, arg.textLength));
+				break;
+			}
+		}
+		line.push_back('\n');
+	}
+
+	/**
+	 * Writes until a stop is requested, then writes whatever is left. The writer only sleeps once the
+	 * ring is empty, so a burst is written as fast as it can be formatted.
+	 */
+	void LogState::Run()
+	{
+		std::unique_lock<std::mutex> lock(wakeLock);
+		for (;;)
+		{
+			const bool stopping = stopRequested;
+			lock.unlock();
+			const bool busy = Drain();
+			lock.lock();
+			if (stopping)
+			{
+				return;
+			}
+			if (!busy)
+			{
+				wake.wait_for(lock, WriterInterval, [this]() { return stopRequested; });
+			}
+		}
+	}
+
+	/**
+	 * Formats the available records and appends the lines to the file.
+	 *
+	 * @return true if records were written.
+	 */
+	bool LogState::Drain()
+	{
+		const uint64_t drops = dropped.load(std::memory_order_relaxed);
+		if (drops != reportedDrops)
+		{
+			LogRecord notice{};
+			notice.unixNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::system_clock::now().time_since_epoch()).count();
+			notice.threadId = CurrentThreadId();
+			notice.event = "log.dropped";
+			notice.level = LogLevel::Warning;
+			notice.argCount = 1;
+			notice.args[0].name = "count";
+			notice.args[0].kind = LogArg::Kind::UInt;
+			notice.args[0].u = drops - reportedDrops;
+			AppendLine(lines, notice);
+			reportedDrops = drops;
+		}
+
+		size_t count = 0;
+		while (ring->TryPop([this](const LogRecord& record) { AppendLine(lines, record); }))
+		{
+			++count;
+			if (lines.size() >= 64 * 1024)
+			{
+				Flush();
+			}
+		}
+		Flush();
+		return count > 0;
+	}
+
+	void LogState::Flush()
+	{
+		if (lines.empty())
+		{
+			return;
+		}
+		if (fileSize > 0 && fileSize + lines.size() > options.maxFileBytes)
+		{
+			Roll();
+		}
+		if (file.is_open())
+		{
+			file.write(lines.data(), static_cast<std::streamsize>(lines.size()));
+			file.flush();
+			fileSize += lines.size();
+		}
+		lines.clear();
+	}
+
+	/**
+	 * Renames base.log to base.1.log, base.1.log to base.2.log and so on, dropping the oldest file,
+	 * and starts a new base.log.
+	 */
+	void LogState::Roll()
+	{
+		file.close();
+		std::error_code ec;
+		auto numbered = [this](uint32_t index) {
+			return options.directory / (options.baseName + "." + std::to_string(index) + ".log");
+		};
+		if (options.maxFiles > 1)
+		{
+			fs::remove(numbered(options.maxFiles - 1), ec);
+			for (uint32_t i = options.maxFiles - 1; i > 1; --i)
+			{
+				fs::rename(numbered(i - 1), numbered(i), ec);
+			}
+			fs::rename(path, numbered(1), ec);
+		}
+		file.open(path, std::ios::binary | std::ios::trunc);
+		fileSize = 0;
+	}
+}
+
+/**
+ * Starts the process-wide log.
+ *
+ * @param options Where and how to write; the ring capacity of the first Start is kept.
+ * @param ec Receives the error.
+ * @return true if the log is running.
+ */
+bool NativeLog::Start(const NativeLogOptions& options, std::error_code& ec)
+{
+	ec.clear();
+	LogState& state = State();
+	std::lock_guard<std::mutex> guard(state.control);
+	if (state.writer.joinable())
+	{
+		return true;
+	}
+	if (options.baseName.empty())
+	{
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+	fs::create_directories(options.directory, ec);
+	if (ec)
+	{
+		return false;
+	}
+
+	state.options = options;
+	state.path = options.directory / (options.baseName + ".log");
+	state.file.open(state.path, std::ios::binary | std::ios::app);
+	if (!state.file.is_open())
+	{
+		ec = std::make_error_code(std::errc::io_error);
+		return false;
+	}
+	std::error_code sizeError;
+	const uintmax_t size = fs::file_size(state.path, sizeError);
+	state.fileSize = sizeError ? 0 : static_cast<uint64_t>(size);
+
+	try
+	{
+		if (!state.ring)
+		{
+			state.ring = std::make_unique<MpscRing<LogRecord>>(std::max<uint32_t>(options.capacity, 2));
+		}
+		state.stopRequested = false;
+		state.writer = std::thread([&state]() { state.Run(); });
+	}
+	catch (const std::system_error& e)
+	{
+		state.file.close();
+		ec = e.code();
+		return false;
+	}
+	catch (const std::bad_alloc&)
+	{
+		state.file.close();
+		ec = std::make_error_code(std::errc::not_enough_memory);
+		return false;
+	}
+	state.minimumLevel.store(static_cast<uint8_t>(options.minimumLevel), std::memory_order_relaxed);
+	state.running.store(true, std::memory_order_release);
+	return true;
+}
+
+/**
+ * Stops the process-wide log after writing every queued record.
+ */
+void NativeLog::Stop()
+{
+	LogState& state = State();
+	std::lock_guard<std::mutex> guard(state.control);
+	if (!state.writer.joinable())
+	{
+		return;
+	}
+	state.running.store(false, std::memory_order_release);
+	{
+		std::lock_guard<std::mutex> lock(state.wakeLock);
+		state.stopRequested = true;
+	}
+	state.wake.notify_one();
+	state.writer.join();
+	state.file.close();
+}
+
+bool NativeLog::Enabled(LogLevel level) noexcept
+{
+	const LogState& state = State();
+	return state.running.load(std::memory_order_acquire) &&
+		static_cast<uint8_t>(level) >= state.minimumLevel.load(std::memory_order_relaxed);
+}
+
+/**
+ * Queues a record without blocking; drops it if the ring is full.
+ *
+ * @param level The severity.
+ * @param event What happened; a string literal.
+ * @param code A Win32 error, HRESULT or exit code; 0 for none.
+ * @param args Named arguments; text is copied into the record.
+ */
+void NativeLog::Write(LogLevel level, const char* event, uint32_t code, std::initializer_list<LogArg> args) noexcept
+{
+	if (!Enabled(level))
+	{
+		return;
+	}
+	LogState& state = State();
+	const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+	const uint32_t threadId = CurrentThreadId();
+
+	const bool pushed = state.ring->TryPush([&](LogRecord& record) {
+		record.unixNanoseconds = now;
+		record.threadId = threadId;
+		record.code = code;
+		record.event = event;
+		record.level = level;
+		record.argCount = 0;
+		size_t textUsed = 0;
+		for (const LogArg& arg : args)
+		{
+			if (record.argCount == MaxArgs)
+			{
+				break;
+			}
+			LogRecord::Arg& out = record.args[record.argCount++];
+			out.name = arg.name;
+			out.kind = arg.kind;
+			out.textOffset = static_cast<uint8_t>(textUsed);
+			out.textLength = 0;
+			switch (arg.kind)
+			{
+			case LogArg::Kind::Int:
+				out.i = arg.i;
+				break;
+			case LogArg::Kind::UInt:
+				out.u = arg.u;
+				break;
+			case LogArg::Kind::Text:
+				out.textLength = static_cast<uint8_t>(CopyUtf8(static_cast<const char*>(arg.data), arg.length,
+					record.text + textUsed, TextCapacity - textUsed));
+				break;
+			case LogArg::Kind::WideText:
+				out.textLength = static_cast<uint8_t>(EncodeUtf8(static_cast<const wchar_t*>(arg.data), arg.length,
+					record.text + textUsed, TextCapacity - textUsed));
+				break;
+			}
+			textUsed += out.textLength;
+		}
+	});
+	if (!pushed)
+	{
+		state.dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+uint64_t NativeLog::Dropped() noexcept
+{
+	return State().dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,161 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		enum class LogLevel : uint8_t
+		{
+			Trace,
+			Debug,
+			Info,
+			Warning,
+			Error
+		};
+
+		/// <summary>
+		/// A named, typed argument of a log record. Names must be string literals; text is copied.
+		/// </summary>
+		struct LogArg
+		{
+			enum class Kind : uint8_t
+			{
+				Int,
+				UInt,
+				Text,
+				WideText
+			};
+
+			const char* name;
+			Kind kind;
+			int64_t i = 0;
+			uint64_t u = 0;
+			const void* data = nullptr;
+			size_t length = 0;
+
+			template <typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+			LogArg(const char* name, T value) noexcept
+				: name(name), kind(std::is_signed_v<T> ? Kind::Int : Kind::UInt)
+			{
+				if constexpr (std::is_signed_v<T>)
+				{
+					i = value;
+				}
+				else
+				{
+					u = value;
+				}
+			}
+
+			LogArg(const char* name, std::string_view value) noexcept
+				: name(name), kind(Kind::Text), data(value.data()), length(value.size())
+			{
+			}
+
+			LogArg(const char* name, std::wstring_view value) noexcept
+				: name(name), kind(Kind::WideText), data(value.data()), length(value.size())
+			{
+			}
+
+			LogArg(const char* name, const char* value) noexcept
+				: LogArg(name, std::string_view(value ? value : ""))
+			{
+			}
+
+			LogArg(const char* name, const wchar_t* value) noexcept
+				: LogArg(name, std::wstring_view(value ? value : L""))
+			{
+			}
+		};
+
+		struct NativeLogOptions
+		{
+			std::filesystem::path directory;
+			std::string baseName;                   // files are baseName.log, baseName.1.log, ...
+			uint64_t maxFileBytes = 1024 * 1024;    // the current file is rolled over past this size
+			uint32_t maxFiles = 4;                  // including the current one
+			LogLevel minimumLevel = LogLevel::Info;
+			uint32_t capacity = 4096;               // records buffered between producers and the writer
+		};
+
+		/// <summary>
+		/// Process-wide asynchronous structured log for the native components.
+		/// </summary>
+		/// <remarks>
+		/// Write copies a fixed-size binary record (timestamp, thread, level, event, code and up to
+		/// MaxArgs typed arguments) into a lock-free bounded MPSC ring and returns; it never takes a
+		/// lock, never allocates and never touches the file system, so it is safe on the launch path.
+		/// A background thread drains the ring, formats each record as one logfmt line and appends it
+		/// to a rolling set of files. When the ring is full the record is dropped and counted, and the
+		/// next line written says how many were lost. Before Start and after Stop, Write does nothing.
+		/// Text arguments are truncated to fit the record.
+		/// </remarks>
+		class NativeLog
+		{
+		public:
+			static constexpr size_t MaxArgs = 4;
+
+			/// <summary>
+			/// Opens the current log file and starts the writer thread; does nothing if already started.
+			/// </summary>
+			/// <returns>false on error, with ec set.</returns>
+			WINAPIHELPERS_API static bool Start(const NativeLogOptions& options, std::error_code& ec);
+
+			/// <summary>
+			/// Writes every queued record, then stops the writer thread and closes the file.
+			/// </summary>
+			WINAPIHELPERS_API static void Stop();
+
+			/// <summary>
+			/// Returns whether a record of this level would be kept.
+			/// </summary>
+			WINAPIHELPERS_API static bool Enabled(LogLevel level) noexcept;
+
+			/// <summary>
+			/// Queues a record.
+			/// </summary>
+			/// <param name="level">The severity.</param>
+			/// <param name="event">What happened, as a string literal, e.g. "launch.create_process".</param>
+			/// <param name="code">A Win32 error, HRESULT or exit code; 0 for none.</param>
+			/// <param name="args">The first MaxArgs arguments are kept.</param>
+			WINAPIHELPERS_API static void Write(LogLevel level, const char* event, uint32_t code,
+				std::initializer_list<LogArg> args = {}) noexcept;
+
+			/// <summary>
+			/// Returns the number of records dropped because the ring was full.
+			/// </summary>
+			WINAPIHELPERS_API static uint64_t Dropped() noexcept;
+		};
+
+		/// <summary>
+		/// Starts the native log for the lifetime of a scope, e.g. the main function of a tool.
+		/// </summary>
+		class NativeLogSession
+		{
+		public:
+			explicit NativeLogSession(const NativeLogOptions& options)
+			{
+				std::error_code ec;
+				NativeLog::Start(options, ec);
+			}
+
+			~NativeLogSession()
+			{
+				NativeLog::Stop();
+			}
+
+			NativeLogSession(const NativeLogSession&) = delete;
+			NativeLogSession& operator=(const NativeLogSession&) = delete;
+		};
+
+	}
+} // namespace WTLayoutManager::Services
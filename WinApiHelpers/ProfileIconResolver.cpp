@@ -0,0 +1,417 @@
+﻿#include "pch.h"
+#include "ProfileIconResolver.h"
+#include "RuntimeMetrics.h"
+#include "StringPool.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <shared_mutex>
+#include <system_error>
+#include <unordered_map>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cstdlib>
+#endif
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	/// Stems of every PNG in WTLayoutManager/Assets, in any case; both builds generate BundledAssets.inc
+	/// from the folder, one u"stem", line per file.
+	constexpr std::u16string_view BundledAssets[] = {
+#include "BundledAssets.inc"
+	};
+
+	constexpr size_t AssetCount = sizeof(BundledAssets) / sizeof(BundledAssets[0]);
+
+	/// Slots of the perfect hash table; a power of two a few times larger than AssetCount keeps the seed search short.
+	constexpr size_t AssetSlotCount = 64;
+
+	static_assert(AssetCount > 0 && AssetCount <= AssetSlotCount / 2, "Size AssetSlotCount to the assets in WTLayoutManager/Assets");
+
+	constexpr char16_t ToLowerAscii(char16_t c) noexcept
+	{
+		return (c >= u'A' && c <= u'Z') ? static_cast<char16_t>(c + (u'a' - u'A')) : c;
+	}
+
+	/// Seeded FNV-1a over the lowercased UTF-16 units, matching the case-insensitive resource lookup of WPF.
+	constexpr uint32_t HashStem(std::u16string_view stem, uint32_t seed) noexcept
+	{
+		uint32_t h = 2166136261u ^ seed;
+		for (char16_t c : stem)
+		{
+			h = (h ^ ToLowerAscii(c)) * 16777619u;
+		}
+		return h ^ (h >> 15);
+	}
+
+	/// Finds the first seed that sends every bundled stem to its own slot.
+	constexpr uint32_t FindAssetSeed() noexcept
+	{
+		for (uint32_t seed = 0;; ++seed)
+		{
+			bool used[AssetSlotCount] = {};
+			bool collision = false;
+			for (std::u16string_view stem : BundledAssets)
+			{
+				const size_t slot = HashStem(stem, seed) % AssetSlotCount;
+				if (used[slot])
+				{
+					collision = true;
+					break;
+				}
+				used[slot] = true;
+			}
+			if (!collision)
+			{
+				return seed;
+			}
+		}
+	}
+
+	constexpr uint32_t AssetSeed = FindAssetSeed();
+
+	/// Slot -> index into BundledAssets, -1 for empty slots.
+	constexpr std::array<int8_t, AssetSlotCount> BuildAssetSlots() noexcept
+	{
+		std::array<int8_t, AssetSlotCount> slots{};
+		for (int8_t& slot : slots)
+		{
+			slot = -1;
+		}
+		for (size_t i = 0; i < AssetCount; ++i)
+		{
+			slots[HashStem(BundledAssets[i], AssetSeed) % AssetSlotCount] = static_cast<int8_t>(i);
+		}
+		return slots;
+	}
+
+	constexpr std::array<int8_t, AssetSlotCount> AssetSlots = BuildAssetSlots();
+
+	/// Facts about a profile that the icon rules test.
+	enum ProfileTrait : uint8_t
+	{
+		SourceWsl = 1 << 0,             // source ends with ".Wsl"
+		SourceGit = 1 << 1,             // source ends with "Git"
+		SourceVisualStudio = 1 << 2,    // source ends with ".VisualStudio"
+		NameWindowsPowerShell = 1 << 3, // name contains "Windows PowerShell"
+		NamePowerShell = 1 << 4,        // name contains "PowerShell"
+		NamePreview = 1 << 5,           // name contains "Preview"
+		NameCommandPrompt = 1 << 6,     // name contains "Command Prompt"
+	};
+
+	constexpr size_t TraitCombinations = 1 << 7;
+
+	/// Icon rules in priority order: the first rule whose traits are all present wins.
+	struct IconRule
+	{
+		uint8_t traits;
+		std::u16string_view asset;
+	};
+
+	constexpr IconRule IconRules[] = {
+		{ SourceWsl, u"wsl.png" },
+		{ SourceGit, u"git-bash.png" },
+		{ SourceVisualStudio | NameWindowsPowerShell, u"vs-powershell.png" },
+		{ SourceVisualStudio | NamePowerShell, u"vs-pwsh.png" },
+		{ SourceVisualStudio | NameCommandPrompt, u"vs-cmd.png" },
+		{ NameWindowsPowerShell, u"powershell.png" },
+		{ NamePowerShell | NamePreview, u"pwsh-preview.png" },
+		{ NamePowerShell, u"pwsh.png" },
+	};
+
+	constexpr std::u16string_view FallbackAsset = u"cmd.png";
+
+	/// Trait combination -> asset, precomputed from the ordered rules.
+	constexpr std::array<std::u16string_view, TraitCombinations> BuildDecisionTable() noexcept
+	{
+		std::array<std::u16string_view, TraitCombinations> table{};
+		for (size_t traits = 0; traits < TraitCombinations; ++traits)
+		{
+			table[traits] = FallbackAsset;
+			for (const IconRule& rule : IconRules)
+			{
+				if ((traits & rule.traits) == rule.traits)
+				{
+					table[traits] = rule.asset;
+					break;
+				}
+			}
+		}
+		return table;
+	}
+
+	constexpr std::array<std::u16string_view, TraitCombinations> DecisionTable = BuildDecisionTable();
+
+	bool EndsWith(std::u16string_view s, std::u16string_view suffix) noexcept
+	{
+		return s.size() >= suffix.size() && s.substr(s.size() - suffix.size()) == suffix;
+	}
+
+	bool Contains(std::u16string_view s, std::u16string_view part) noexcept
+	{
+		return s.find(part) != std::u16string_view::npos;
+	}
+
+	std::u16string_view RuleAsset(std::u16string_view source, std::u16string_view name) noexcept
+	{
+		uint8_t traits = 0;
+		traits |= EndsWith(source, u".Wsl") ? SourceWsl : 0;
+		traits |= EndsWith(source, u"Git") ? SourceGit : 0;
+		traits |= EndsWith(source, u".VisualStudio") ? SourceVisualStudio : 0;
+		traits |= Contains(name, u"Windows PowerShell") ? NameWindowsPowerShell : 0;
+		traits |= Contains(name, u"PowerShell") ? NamePowerShell : 0;
+		traits |= Contains(name, u"Preview") ? NamePreview : 0;
+		traits |= Contains(name, u"Command Prompt") ? NameCommandPrompt : 0;
+		return DecisionTable[traits];
+	}
+
+	/// Same set of characters as .NET's char.IsWhiteSpace.
+	bool IsWhiteSpace(char16_t c) noexcept
+	{
+		return (c >= 0x09 && c <= 0x0D) || c == 0x20 || c == 0x85 || c == 0xA0 || c == 0x1680 ||
+			(c >= 0x2000 && c <= 0x200A) || c == 0x2028 || c == 0x2029 || c == 0x202F || c == 0x205F || c == 0x3000;
+	}
+
+	bool IsNullOrWhiteSpace(std::u16string_view s) noexcept
+	{
+		for (char16_t c : s)
+		{
+			if (!IsWhiteSpace(c))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// Last path segment, as Path.GetFileName on Windows.
+	std::u16string_view FileName(std::u16string_view path) noexcept
+	{
+		const size_t slash = path.find_last_of(u"\\/");
+		return slash == std::u16string_view::npos ? path : path.substr(slash + 1);
+	}
+
+	std::u16string AssetUri(std::u16string_view fileName)
+	{
+		std::u16string uri(ProfileIconResolver::AssetUriPrefix);
+		uri.append(fileName);
+		return uri;
+	}
+
+#if defined(_WIN32)
+	std::u16string ExpandEnvironment(std::u16string_view s)
+	{
+		const std::wstring input(reinterpret_cast<const wchar_t*>(s.data()), s.size());
+		DWORD length = ExpandEnvironmentStringsW(input.c_str(), nullptr, 0);
+		if (length == 0)
+		{
+			return std::u16string(s);
+		}
+		std::wstring output(length, L'\0');
+		length = ExpandEnvironmentStringsW(input.c_str(), output.data(), length);
+		if (length == 0 || length > output.size())
+		{
+			return std::u16string(s);
+		}
+		output.resize(length - 1);
+		return std::u16string(reinterpret_cast<const char16_t*>(output.data()), output.size());
+	}
+
+	bool PathExists(const std::u16string& path)
+	{
+		return !path.empty() && GetFileAttributesW(reinterpret_cast<const wchar_t*>(path.c_str())) != INVALID_FILE_ATTRIBUTES;
+	}
+#else
+	/// Replaces %NAME% with the variable's value; unknown variables are left as they are.
+	std::u16string ExpandEnvironment(std::u16string_view s)
+	{
+		std::u16string output;
+		size_t i = 0;
+		while (i < s.size())
+		{
+			const size_t open = s.find(u'%', i);
+			const size_t close = open == std::u16string_view::npos ? open : s.find(u'%', open + 1);
+			if (close == std::u16string_view::npos)
+			{
+				output.append(s.substr(i));
+				break;
+			}
+			output.append(s.substr(i, open - i));
+			const std::string name = std::filesystem::path(std::u16string(s.substr(open + 1, close - open - 1))).string();
+			const char* value = close > open + 1 ? std::getenv(name.c_str()) : nullptr;
+			if (value != nullptr)
+			{
+				output.append(std::filesystem::path(value).u16string());
+				i = close + 1;
+			}
+			else
+			{
+				output.append(s.substr(open, close - open));
+				i = close; // the closing '%' may open the next variable
+			}
+		}
+		return output;
+	}
+
+	bool PathExists(const std::u16string& path)
+	{
+		std::error_code ec;
+		return !path.empty() && std::filesystem::exists(std::filesystem::path(path), ec);
+	}
+#endif
+
+	std::u16string ResolveUncached(std::u16string_view guid, std::u16string_view icon, std::u16string_view source, std::u16string_view name)
+	{
+		if (IsNullOrWhiteSpace(icon))
+		{
+			const std::u16string_view stem = FileName(guid);
+			if (ProfileIconResolver::IsBundledAsset(stem))
+			{
+				std::u16string uri = AssetUri(stem);
+				uri.append(u".png");
+				return uri;
+			}
+			return AssetUri(RuleAsset(source, name));
+		}
+
+		if (icon.substr(0, 11) == u"ms-appx:///")
+		{
+			return AssetUri(FileName(icon));
+		}
+
+		std::u16string expanded = ExpandEnvironment(icon);
+		if (PathExists(expanded))
+		{
+			return expanded;
+		}
+		return AssetUri(RuleAsset(source, name));
+	}
+
+	/// Process-wide memo of resolved icons, as ids in the shared string pool.
+	struct IconMemo
+	{
+		std::shared_mutex lock;
+		std::unordered_map<std::u16string, uint32_t> entries;
+	};
+
+	IconMemo& Memo()
+	{
+		static IconMemo memo;
+		return memo;
+	}
+
+	/// Appends a length-prefixed field so that different field splits never produce the same key.
+	void AppendKeyField(std::u16string& key, std::u16string_view field)
+	{
+		const size_t length = field.size();
+		key.push_back(static_cast<char16_t>(length & 0xFFFF));
+		key.push_back(static_cast<char16_t>((length >> 16) & 0xFFFF));
+		key.append(field);
+	}
+}
+
+/**
+ * Checks whether a stem names one of the bundled PNG assets.
+ *
+ * One hash and at most one string comparison: the slot table is a perfect hash computed at
+ * compile time over the bundled file names.
+ *
+ * @param stem File name without the ".png" extension.
+ * @return true if Assets/{stem}.png is part of the application.
+ */
+bool ProfileIconResolver::IsBundledAsset(std::u16string_view stem) noexcept
+{
+	const int8_t index = AssetSlots[HashStem(stem, AssetSeed) % AssetSlotCount];
+	if (index < 0)
+	{
+		return false;
+	}
+	const std::u16string_view candidate = BundledAssets[index];
+	if (candidate.size() != stem.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < stem.size(); ++i)
+	{
+		if (ToLowerAscii(stem[i]) != ToLowerAscii(candidate[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Returns the icon for a profile.
+ *
+ * @param guid The profile guid.
+ * @param icon The profile icon.
+ * @param source The profile source.
+ * @param name The profile name.
+ * @return A file path or a pack URI of a bundled asset.
+ */
+std::u16string ProfileIconResolver::Resolve(
+	std::u16string_view guid,
+	std::u16string_view icon,
+	std::u16string_view source,
+	std::u16string_view name)
+{
+	return std::u16string(StringPool::Shared().View(ResolveId(guid, icon, source, name)));
+}
+
+/**
+ * Returns the interned icon for a profile, computing it only the first time a given
+ * (guid, icon, source, name) combination is seen.
+ *
+ * @param guid The profile guid.
+ * @param icon The profile icon.
+ * @param source The profile source.
+ * @param name The profile name.
+ * @return The id of the icon in StringPool::Shared().
+ */
+uint32_t ProfileIconResolver::ResolveId(
+	std::u16string_view guid,
+	std::u16string_view icon,
+	std::u16string_view source,
+	std::u16string_view name)
+{
+	std::u16string key;
+	key.reserve(guid.size() + icon.size() + source.size() + name.size() + 8);
+	AppendKeyField(key, guid);
+	AppendKeyField(key, icon);
+	AppendKeyField(key, source);
+	AppendKeyField(key, name);
+
+	IconMemo& memo = Memo();
+	{
+		std::shared_lock<std::shared_mutex> read(memo.lock);
+		auto it = memo.entries.find(key);
+		if (it != memo.entries.end())
+		{
+			RuntimeMetrics::Add(MetricCounter::ProfileIconHits);
+			return it->second;
+		}
+	}
+	RuntimeMetrics::Add(MetricCounter::ProfileIconMisses);
+
+	// Resolve outside the lock: the file system probe may be slow, and racing threads agree on the result.
+	const uint32_t resolved = StringPool::Shared().Intern(ResolveUncached(guid, icon, source, name));
+	std::unique_lock<std::shared_mutex> write(memo.lock);
+	return memo.entries.try_emplace(std::move(key), resolved).first->second;
+}
+
+/**
+ * Forgets every memoized result, e.g. before folders are reloaded.
+ */
+void ProfileIconResolver::ClearMemo()
+{
+	IconMemo& memo = Memo();
+	std::unique_lock<std::shared_mutex> write(memo.lock);
+	memo.entries.clear();
+}
@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// Resolves the icon shown for a settings.json profile.
+		/// </summary>
+		/// <remarks>
+		/// Resolution order: a bundled Assets/{guid}.png, an "ms-appx:///" icon mapped onto the bundled
+		/// asset of the same name, an existing file after environment variable expansion, then the
+		/// source / name rules (WSL, Git, Visual Studio shells, PowerShell) and finally cmd.png.
+		/// Results are interned in StringPool::Shared() and memoized process-wide per (guid, icon, source,
+		/// name); call ClearMemo when icon files on disk or the environment may have changed. All members
+		/// are thread-safe.
+		/// </remarks>
+		class ProfileIconResolver
+		{
+		public:
+			/// <summary>
+			/// Prefix of every bundled asset URI.
+			/// </summary>
+			static constexpr std::u16string_view AssetUriPrefix = u"pack://application:,,,/WTLayoutManager;component/Assets/";
+
+			/// <summary>
+			/// Returns the icon path or pack URI for a profile.
+			/// </summary>
+			/// <param name="guid">The profile "guid"; empty when missing.</param>
+			/// <param name="icon">The profile "icon"; empty when missing.</param>
+			/// <param name="source">The profile "source"; empty when missing.</param>
+			/// <param name="name">The profile "name"; empty when missing.</param>
+			WINAPIHELPERS_API static std::u16string Resolve(
+				std::u16string_view guid,
+				std::u16string_view icon,
+				std::u16string_view source,
+				std::u16string_view name);
+
+			/// <summary>
+			/// Returns the id of the icon path or pack URI in StringPool::Shared(); never StringPool::NullId.
+			/// </summary>
+			WINAPIHELPERS_API static uint32_t ResolveId(
+				std::u16string_view guid,
+				std::u16string_view icon,
+				std::u16string_view source,
+				std::u16string_view name);
+
+			/// <summary>
+			/// Checks whether Assets/{stem}.png is bundled with the application (case-insensitive).
+			/// </summary>
+			WINAPIHELPERS_API static bool IsBundledAsset(std::u16string_view stem) noexcept;
+
+			/// <summary>
+			/// Forgets every memoized result.
+			/// </summary>
+			WINAPIHELPERS_API static void ClearMemo();
+		};
+
+	}
+} // namespace WTLayoutManager::Services
@@ -0,0 +1,624 @@
+﻿#include "pch.h"
+#include "ResourceAccounting.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <sddl.h>
+#else
+#include <cerrno>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <string_view>
+#include <unordered_map>
+#include <unistd.h>
+#endif
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+#if defined(_WIN32)
+	// Full access for SYSTEM and administrators; interactive users may only query and wait, so the app
+	// can account for the elevated launcher's terminals without being able to terminate them.
+	constexpr const wchar_t* AccountSecurity = L"D:P(A;;GA;;;SY)(A;;GA;;;BA)(A;;0x100004;;;IU)S:(ML;;NW;;;ME)";
+
+	std::error_code LastError()
+	{
+		return std::error_code(static_cast<int>(::GetLastError()), std::system_category());
+	}
+#else
+	/// One process as read from /proc.
+	struct ProcEntry
+	{
+		int pid;
+		int ppid;
+		uint64_t startTicks;
+		uint64_t cpuTicks;
+		uint64_t rssPages;
+	};
+
+	/// Reads /proc/<pid>/stat; the command name may contain spaces and parentheses.
+	bool ReadProcEntry(int pid, ProcEntry& entry)
+	{
+		std::ifstream file("/proc/" + std::to_string(pid) + "/stat");
+		std::string line;
+		if (!std::getline(file, line))
+		{
+			return false;
+		}
+		const size_t close = line.rfind(')');
+		if (close == std::string::npos)
+		{
+			return false;
+		}
+		// Fields from 3 (state) on; field n is at index n - 3.
+		std::vector<std::string_view> fields;
+		std::string_view rest(line.data() + close + 1, line.size() - close - 1);
+		while (!rest.empty())
+		{
+			const size_t start = rest.find_first_not_of(' ');
+			if (start == std::string_view::npos)
+			{
+				break;
+			}
+			rest.remove_prefix(start);
+			const size_t end = std::min(rest.find(' '), rest.size());
+			fields.push_back(rest.substr(0, end));
+			rest.remove_prefix(end);
+		}
+		if (fields.size() < 22)
+		{
+			return false;
+		}
+		auto number = [&fields](size_t field) { return std::strtoull(std::string(fields[field - 3]).c_str(), nullptr, 10); };
+		entry.pid = pid;
+		entry.ppid = static_cast<int>(number(4));
+		entry.cpuTicks = number(14) + number(15);
+		entry.startTicks = number(22);
+		entry.rssPages = number(24);
+		return true;
+	}
+
+	/// Reads the bytes read and written by a process from /proc/<pid>/io, which only its owner may read.
+	void ReadProcIo(int pid, uint64_t& readBytes, uint64_t& writeBytes)
+	{
+		std::ifstream file("/proc/" + std::to_string(pid) + "/io");
+		std::string key;
+		uint64_t value = 0;
+		while (file >> key >> value)
+		{
+			if (key == "rchar:")
+			{
+				readBytes = value;
+			}
+			else if (key == "wchar:")
+			{
+				writeBytes = value;
+			}
+		}
+	}
+
+	std::vector<ProcEntry> ReadProcesses()
+	{
+		std::vector<ProcEntry> entries;
+		DIR* proc = ::opendir("/proc");
+		if (proc == nullptr)
+		{
+			return entries;
+		}
+		while (const dirent* item = ::readdir(proc))
+		{
+			char* end = nullptr;
+			const long pid = std::strtol(item->d_name, &end, 10);
+			ProcEntry entry;
+			if (pid > 0 && *end == '\0' && ReadProcEntry(static_cast<int>(pid), entry))
+			{
+				entries.push_back(entry);
+			}
+		}
+		::closedir(proc);
+		return entries;
+	}
+#endif
+}
+
+#if defined(_WIN32)
+struct ProcessTreeAccount::State
+{
+	HANDLE job = nullptr;
+
+	~State()
+	{
+		if (job != nullptr)
+		{
+			::CloseHandle(job);
+		}
+	}
+};
+#else
+struct ProcessTreeAccount::State
+{
+	/// A process is identified by its pid and start time, so a reused pid is not mistaken for it.
+	struct Key
+	{
+		int pid;
+		uint64_t startTicks;
+
+		bool operator==(const Key& other) const noexcept { return pid == other.pid && startTicks == other.startTicks; }
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const noexcept { return std::hash<uint64_t>()((static_cast<uint64_t>(key.pid) << 40) ^ key.startTicks); }
+	};
+
+	struct Seen
+	{
+		uint64_t cpuTicks = 0;
+		uint64_t readBytes = 0;
+		uint64_t writeBytes = 0;
+	};
+
+	std::vector<Key> roots;
+	std::unordered_map<Key, Seen, KeyHash> seen;    // every member so far, with the usage last read
+	uint64_t peakMemoryBytes = 0;
+};
+#endif
+
+ProcessTreeAccount::ProcessTreeAccount()
+	: m_state(std::make_unique<State>())
+{
+}
+
+ProcessTreeAccount::~ProcessTreeAccount() = default;
+
+/**
+ * Creates a job object with the given limits.
+ *
+ * @param limits The memory and CPU rate caps; zero fields are not enforced.
+ * @param name The object name, secured so interactive users may only query it; nullptr for none.
+ * @param ec Receives the error.
+ * @return The container, or nullptr on error.
+ */
+std::unique_ptr<ProcessTreeAccount> ProcessTreeAccount::Create(const ResourceLimits& limits, const wchar_t* name, std::error_code& ec)
+{
+	ec.clear();
+	std::unique_ptr<ProcessTreeAccount> account(new ProcessTreeAccount());
+#if defined(_WIN32)
+	SECURITY_ATTRIBUTES attributes{ sizeof(attributes), nullptr, FALSE };
+	PSECURITY_DESCRIPTOR descriptor = nullptr;
+	if (name != nullptr && ::ConvertStringSecurityDescriptorToSecurityDescriptorW(AccountSecurity, SDDL_REVISION_1, &descriptor, nullptr))
+	{
+		attributes.lpSecurityDescriptor = descriptor;
+	}
+	account->m_state->job = ::CreateJobObjectW(&attributes, name);
+	if (account->m_state->job == nullptr)
+	{
+		ec = LastError();
+	}
+	if (descriptor != nullptr)
+	{
+		::LocalFree(descriptor);
+	}
+	if (ec)
+	{
+		return nullptr;
+	}
+
+	if (limits.memoryBytes != 0)
+	{
+		JOBOBJECT_EXTENDED_LIMIT_INFORMATION extended{};
+		extended.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_JOB_MEMORY;
+		extended.JobMemoryLimit = static_cast<SIZE_T>(limits.memoryBytes);
+		if (!::SetInformationJobObject(account->m_state->job, JobObjectExtendedLimitInformation, &extended, sizeof(extended)))
+		{
+			ec = LastError();
+			return nullptr;
+		}
+	}
+	if (limits.cpuRatePercent != 0)
+	{
+		JOBOBJECT_CPU_RATE_CONTROL_INFORMATION rate{};
+		rate.ControlFlags = JOB_OBJECT_CPU_RATE_CONTROL_ENABLE | JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP;
+		rate.CpuRate = std::clamp<DWORD>(limits.cpuRatePercent, 1, 100) * 100; // in 1/100 of a percent
+		if (!::SetInformationJobObject(account->m_state->job, JobObjectCpuRateControlInformation, &rate, sizeof(rate)))
+		{
+			ec = LastError();
+			return nullptr;
+		}
+	}
+#else
+	(void)limits;
+	(void)name;
+#endif
+	return account;
+}
+
+/**
+ * Opens a job object created by another process, polling until it exists.
+ *
+ * @param name The object name.
+ * @param timeoutMilliseconds How long to wait for the creator.
+ * @param ec Receives the error: the last open error on timeout, operation_not_supported off Windows.
+ * @return The container, or nullptr.
+ */
+std::unique_ptr<ProcessTreeAccount> ProcessTreeAccount::Open(const wchar_t* name, uint32_t timeoutMilliseconds, std::error_code& ec)
+{
+	ec.clear();
+#if defined(_WIN32)
+	std::unique_ptr<ProcessTreeAccount> account(new ProcessTreeAccount());
+	const ULONGLONG deadline = ::GetTickCount64() + timeoutMilliseconds;
+	DWORD delay = 5;
+	for (;;)
+	{
+		account->m_state->job = ::OpenJobObjectW(JOB_OBJECT_QUERY | SYNCHRONIZE, FALSE, name);
+		if (account->m_state->job != nullptr)
+		{
+			return account;
+		}
+		ec = LastError();
+		if (::GetTickCount64() >= deadline)
+		{
+			return nullptr;
+		}
+		::Sleep(delay);
+		delay = delay < 25 ? delay * 2 : 50;
+	}
+#else
+	(void)name;
+	(void)timeoutMilliseconds;
+	ec = std::make_error_code(std::errc::operation_not_supported);
+	return nullptr;
+#endif
+}
+
+std::wstring ProcessTreeAccount::LauncherAccountName(uint32_t launcherProcessId)
+{
+	return L"Local\\WTLayoutManager.Terminal." + std::to_wstring(launcherProcessId);
+}
+
+/**
+ * Adds a process to the container.
+ *
+ * @param processId The process, ideally still suspended.
+ * @param ec Receives the error.
+ * @return false on error.
+ */
+bool ProcessTreeAccount::Assign(uint32_t processId, std::error_code& ec)
+{
+	ec.clear();
+#if defined(_WIN32)
+	HANDLE process = ::OpenProcess(PROCESS_SET_QUOTA | PROCESS_TERMINATE, FALSE, processId);
+	if (process == nullptr)
+	{
+		ec = LastError();
+		return false;
+	}
+	const bool assigned = ::AssignProcessToJobObject(m_state->job, process) != FALSE;
+	if (!assigned)
+	{
+		ec = LastError();
+	}
+	::CloseHandle(process);
+	return assigned;
+#else
+	ProcEntry entry;
+	if (!ReadProcEntry(static_cast<int>(processId), entry))
+	{
+		ec = std::make_error_code(std::errc::no_such_process);
+		return false;
+	}
+	m_state->roots.push_back({ entry.pid, entry.startTicks });
+	m_state->seen.emplace(State::Key{ entry.pid, entry.startTicks }, State::Seen{});
+	return true;
+#endif
+}
+
+/**
+ * Reads the totals of the container. Not thread-safe.
+ *
+ * @param usage Receives the totals.
+ * @return false if they could not be read.
+ */
+bool ProcessTreeAccount::Sample(ResourceUsage& usage) noexcept
+{
+#if defined(_WIN32)
+	JOBOBJECT_BASIC_AND_IO_ACCOUNTING_INFORMATION accounting{};
+	JOBOBJECT_EXTENDED_LIMIT_INFORMATION extended{};
+	if (!::QueryInformationJobObject(m_state->job, JobObjectBasicAndIoAccountingInformation, &accounting, sizeof(accounting), nullptr) ||
+		!::QueryInformationJobObject(m_state->job, JobObjectExtendedLimitInformation, &extended, sizeof(extended), nullptr))
+	{
+		return false;
+	}
+	// Times are in 100 ns units.
+	usage.cpuMicroseconds = static_cast<uint64_t>(accounting.BasicInfo.TotalUserTime.QuadPart + accounting.BasicInfo.TotalKernelTime.QuadPart) / 10;
+	usage.peakMemoryBytes = extended.PeakJobMemoryUsed;
+	usage.readBytes = accounting.IoInfo.ReadTransferCount;
+	usage.writeBytes = accounting.IoInfo.WriteTransferCount;
+	usage.activeProcesses = accounting.BasicInfo.ActiveProcesses;
+	usage.totalProcesses = accounting.BasicInfo.TotalProcesses;
+	return true;
+#else
+	try
+	{
+		State& state = *m_state;
+		const std::vector<ProcEntry> entries = ReadProcesses();
+
+		// Members are the known processes still alive and, transitively, their children.
+		std::unordered_map<int, std::vector<size_t>> children;
+		std::vector<size_t> pending;
+		for (size_t i = 0; i < entries.size(); ++i)
+		{
+			children[entries[i].ppid].push_back(i);
+			if (state.seen.count({ entries[i].pid, entries[i].startTicks }) != 0)
+			{
+				pending.push_back(i);
+			}
+		}
+		std::vector<bool> member(entries.size(), false);
+		for (size_t i : pending)
+		{
+			member[i] = true;
+		}
+		while (!pending.empty())
+		{
+			const size_t parent = pending.back();
+			pending.pop_back();
+			auto found = children.find(entries[parent].pid);
+			if (found == children.end())
+			{
+				continue;
+			}
+			for (size_t child : found->second)
+			{
+				if (!member[child] && entries[child].startTicks >= entries[parent].startTicks)
+				{
+					member[child] = true;
+					pending.push_back(child);
+				}
+			}
+		}
+
+		static const long ticksPerSecond = std::max(1L, ::sysconf(_SC_CLK_TCK));
+		static const long pageBytes = std::max(1L, ::sysconf(_SC_PAGESIZE));
+		uint64_t memoryBytes = 0;
+		uint32_t active = 0;
+		for (size_t i = 0; i < entries.size(); ++i)
+		{
+			if (!member[i])
+			{
+				continue;
+			}
+			State::Seen& seen = state.seen[{ entries[i].pid, entries[i].startTicks }];
+			seen.cpuTicks = entries[i].cpuTicks;
+			ReadProcIo(entries[i].pid, seen.readBytes, seen.writeBytes);
+			memoryBytes += entries[i].rssPages * static_cast<uint64_t>(pageBytes);
+			++active;
+		}
+		state.peakMemoryBytes = std::max(state.peakMemoryBytes, memoryBytes);
+
+		ResourceUsage totals;
+		uint64_t cpuTicks = 0;
+		for (const auto& [key, seen] : state.seen)
+		{
+			cpuTicks += seen.cpuTicks;
+			totals.readBytes += seen.readBytes;
+			totals.writeBytes += seen.writeBytes;
+		}
+		totals.cpuMicroseconds = cpuTicks * 1000000 / static_cast<uint64_t>(ticksPerSecond);
+		totals.peakMemoryBytes = state.peakMemoryBytes;
+		totals.activeProcesses = active;
+		totals.totalProcesses = static_cast<uint32_t>(state.seen.size());
+		usage = totals;
+		return true;
+	}
+	catch (...)
+	{
+		return false;
+	}
+#endif
+}
+
+// --------------------------------------------------------------------------
+
+namespace
+{
+	/// Adds the usage of one launch to the totals of a folder.
+	void Accumulate(ResourceUsage& total, const ResourceUsage& launch)
+	{
+		total.cpuMicroseconds += launch.cpuMicroseconds;
+		total.peakMemoryBytes = std::max(total.peakMemoryBytes, launch.peakMemoryBytes);
+		total.readBytes += launch.readBytes;
+		total.writeBytes += launch.writeBytes;
+		total.activeProcesses += launch.activeProcesses;
+		total.totalProcesses += launch.totalProcesses;
+	}
+}
+
+struct ResourceLedger::State
+{
+	struct Live
+	{
+		uint64_t id;
+		std::wstring folder;
+		std::shared_ptr<ProcessTreeAccount> account;
+		ResourceUsage last;
+	};
+
+	mutable std::mutex lock;
+	std::mutex sampling;                            // ProcessTreeAccount::Sample is not thread-safe
+	std::condition_variable wake;
+	uint64_t nextId = 1;
+	std::vector<Live> live;
+	std::map<std::wstring, FolderResources> folders; // launches, and the totals of released launches
+	bool samplerRunning = false;
+
+	/**
+	 * Samples the live containers until none is left. Runs on a detached thread; the state outlives it
+	 * because the ledger is never destroyed.
+	 */
+	void Sample()
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		for (;;)
+		{
+			wake.wait_for(guard, std::chrono::milliseconds(SampleIntervalMilliseconds), [this]() { return live.empty(); });
+			if (live.empty())
+			{
+				samplerRunning = false;
+				return;
+			}
+
+			std::vector<std::pair<uint64_t, std::shared_ptr<ProcessTreeAccount>>> accounts;
+			accounts.reserve(live.size());
+			for (const Live& entry : live)
+			{
+				accounts.emplace_back(entry.id, entry.account);
+			}
+			guard.unlock();
+
+			std::vector<std::pair<uint64_t, ResourceUsage>> samples;
+			{
+				std::lock_guard<std::mutex> sample(sampling);
+				for (auto& [id, account] : accounts)
+				{
+					ResourceUsage usage;
+					if (account->Sample(usage))
+					{
+						samples.emplace_back(id, usage);
+					}
+				}
+			}
+			accounts.clear();
+
+			guard.lock();
+			for (const auto& [id, usage] : samples)
+			{
+				auto found = std::find_if(live.begin(), live.end(), [id = id](const Live& e) { return e.id == id; });
+				if (found != live.end())
+				{
+					found->last = usage;
+				}
+			}
+		}
+	}
+
+	/// The totals of a folder, live launches included; the caller holds the lock.
+	FolderResources Combine(const FolderResources& folder) const
+	{
+		FolderResources combined = folder;
+		for (const Live& entry : live)
+		{
+			if (entry.folder == folder.folder)
+			{
+				Accumulate(combined.usage, entry.last);
+				++combined.running;
+			}
+		}
+		return combined;
+	}
+};
+
+ResourceLedger::ResourceLedger()
+	: m_state(std::make_unique<State>())
+{
+}
+
+ResourceLedger::~ResourceLedger() = default;
+
+ResourceLedger& ResourceLedger::Shared()
+{
+	// Never destroyed: the sampler thread may still run when the process exits.
+	static ResourceLedger* ledger = new ResourceLedger();
+	return *ledger;
+}
+
+/**
+ * Records a container for a folder and starts the sampler if it is not running.
+ *
+ * @param folder The LocalState folder the terminal was launched for.
+ * @param account The container.
+ * @return The id to release it with.
+ */
+uint64_t ResourceLedger::Track(const std::wstring& folder, std::unique_ptr<ProcessTreeAccount> account)
+{
+	State& state = *m_state;
+	std::lock_guard<std::mutex> guard(state.lock);
+	const uint64_t id = state.nextId++;
+	state.live.push_back({ id, folder, std::shared_ptr<ProcessTreeAccount>(std::move(account)), ResourceUsage{} });
+	FolderResources& totals = state.folders[folder];
+	totals.folder = folder;
+	++totals.launches;
+	if (!state.samplerRunning)
+	{
+		state.samplerRunning = true;
+		std::thread([&state]() { state.Sample(); }).detach();
+	}
+	return id;
+}
+
+/**
+ * Folds the final usage of a container into its folder and closes it.
+ *
+ * @param id The id Track returned.
+ */
+void ResourceLedger::Release(uint64_t id)
+{
+	State& state = *m_state;
+	State::Live released;
+	{
+		std::lock_guard<std::mutex> guard(state.lock);
+		auto found = std::find_if(state.live.begin(), state.live.end(), [id](const State::Live& e) { return e.id == id; });
+		if (found == state.live.end())
+		{
+			return;
+		}
+		released = std::move(*found);
+		state.live.erase(found);
+	}
+	state.wake.notify_all();
+
+	{
+		std::lock_guard<std::mutex> sample(state.sampling);
+		ResourceUsage usage;
+		if (released.account->Sample(usage))
+		{
+			released.last = usage;
+		}
+	}
+	released.last.activeProcesses = 0;
+
+	std::lock_guard<std::mutex> guard(state.lock);
+	Accumulate(state.folders[released.folder].usage, released.last);
+}
+
+bool ResourceLedger::Find(const std::wstring& folder, FolderResources& resources) const
+{
+	std::lock_guard<std::mutex> guard(m_state->lock);
+	auto found = m_state->folders.find(folder);
+	if (found == m_state->folders.end())
+	{
+		return false;
+	}
+	resources = m_state->Combine(found->second);
+	return true;
+}
+
+std::vector<FolderResources> ResourceLedger::Snapshot() const
+{
+	std::lock_guard<std::mutex> guard(m_state->lock);
+	std::vector<FolderResources> folders;
+	folders.reserve(m_state->folders.size());
+	for (const auto& [name, totals] : m_state->folders)
+	{
+		folders.push_back(m_state->Combine(totals));
+	}
+	return folders;
+}
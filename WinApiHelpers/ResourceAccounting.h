@@ -0,0 +1,178 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// Optional caps on everything a launched terminal tree uses together; 0 means no cap.
+		/// </summary>
+		struct ResourceLimits
+		{
+			uint64_t memoryBytes = 0;       // committed memory of all processes
+			uint32_t cpuRatePercent = 0;    // share of all processors, 1 to 100
+		};
+
+		/// <summary>
+		/// What a process tree used so far.
+		/// </summary>
+		struct ResourceUsage
+		{
+			uint64_t cpuMicroseconds = 0;   // user and kernel time of every process, exited ones included
+			uint64_t peakMemoryBytes = 0;
+			uint64_t readBytes = 0;
+			uint64_t writeBytes = 0;
+			uint32_t activeProcesses = 0;
+			uint32_t totalProcesses = 0;
+		};
+
+		/// <summary>
+		/// An accounting container for one launched terminal and every process it starts.
+		/// </summary>
+		/// <remarks>
+		/// On Windows this is a job object: a process assigned while suspended takes its children along,
+		/// the system keeps the totals of exited processes, and limits are enforced. Elsewhere the tree is
+		/// rebuilt from /proc on every sample; processes that exit between two samples keep the usage last
+		/// seen, and limits are not enforced.
+		/// </remarks>
+		class ProcessTreeAccount
+		{
+		public:
+			WINAPIHELPERS_API ~ProcessTreeAccount();
+
+			ProcessTreeAccount(const ProcessTreeAccount&) = delete;
+			ProcessTreeAccount& operator=(const ProcessTreeAccount&) = delete;
+
+			/// <summary>
+			/// Creates an empty container.
+			/// </summary>
+			/// <param name="limits">The caps to enforce.</param>
+			/// <param name="name">A name another process may open it by (Windows only), or nullptr.</param>
+			/// <returns>nullptr on error, with ec set.</returns>
+			WINAPIHELPERS_API static std::unique_ptr<ProcessTreeAccount> Create(const ResourceLimits& limits, const wchar_t* name, std::error_code& ec);
+
+			/// <summary>
+			/// Opens a named container for sampling, waiting up to timeoutMilliseconds for it to be created.
+			/// </summary>
+			/// <returns>nullptr on error or timeout, with ec set.</returns>
+			WINAPIHELPERS_API static std::unique_ptr<ProcessTreeAccount> Open(const wchar_t* name, uint32_t timeoutMilliseconds, std::error_code& ec);
+
+			/// <summary>
+			/// The name the elevated launcher gives the container of its target, so the app can open it.
+			/// </summary>
+			WINAPIHELPERS_API static std::wstring LauncherAccountName(uint32_t launcherProcessId);
+
+			/// <summary>
+			/// Adds a process, and the processes it starts from now on, to the container. Assign before
+			/// the process is resumed, or its first children are missed.
+			/// </summary>
+			WINAPIHELPERS_API bool Assign(uint32_t processId, std::error_code& ec);
+
+			/// <summary>
+			/// Reads the current totals.
+			/// </summary>
+			WINAPIHELPERS_API bool Sample(ResourceUsage& usage) noexcept;
+
+		private:
+			ProcessTreeAccount();
+
+			struct State;
+			std::unique_ptr<State> m_state;
+		};
+
+		/// <summary>
+		/// The resources of the terminals launched for one LocalState folder.
+		/// </summary>
+		struct FolderResources
+		{
+			std::wstring folder;
+			ResourceUsage usage;            // sums over every launch, peak memory is the highest of one launch
+			uint32_t launches = 0;
+			uint32_t running = 0;
+		};
+
+		/// <summary>
+		/// Process-wide record of what the terminals of each LocalState folder used.
+		/// </summary>
+		/// <remarks>
+		/// Tracked containers are sampled by a background thread every SampleIntervalMilliseconds while any
+		/// is running, so reading the ledger never waits on the system. Released containers are sampled one
+		/// last time and folded into the totals of their folder. Folders are compared as given.
+		/// </remarks>
+		class ResourceLedger
+		{
+		public:
+			static constexpr uint32_t SampleIntervalMilliseconds = 2000;
+
+			/// <summary>
+			/// The ledger of the process; it is never destroyed.
+			/// </summary>
+			WINAPIHELPERS_API static ResourceLedger& Shared();
+
+			/// <summary>
+			/// Starts recording a container for a folder.
+			/// </summary>
+			/// <returns>The id to release it with.</returns>
+			WINAPIHELPERS_API uint64_t Track(const std::wstring& folder, std::unique_ptr<ProcessTreeAccount> account);
+
+			/// <summary>
+			/// Takes a last sample, adds it to the folder and closes the container.
+			/// </summary>
+			WINAPIHELPERS_API void Release(uint64_t id);
+
+			/// <summary>
+			/// Returns the resources of one folder.
+			/// </summary>
+			/// <returns>false if nothing was launched for it.</returns>
+			WINAPIHELPERS_API bool Find(const std::wstring& folder, FolderResources& resources) const;
+
+			/// <summary>
+			/// Returns the resources of every folder something was launched for.
+			/// </summary>
+			WINAPIHELPERS_API std::vector<FolderResources> Snapshot() const;
+
+		private:
+			ResourceLedger();
+			~ResourceLedger();
+
+			struct State;
+			std::unique_ptr<State> m_state;
+		};
+
+		/// <summary>
+		/// Tracks a container in the shared ledger for the lifetime of a scope, e.g. while a launch waits
+		/// for its terminal to exit.
+		/// </summary>
+		class TrackedAccount
+		{
+		public:
+			/// <param name="account">May be null, then nothing is tracked.</param>
+			TrackedAccount(const std::wstring& folder, std::unique_ptr<ProcessTreeAccount> account)
+				: m_id(account ? ResourceLedger::Shared().Track(folder, std::move(account)) : 0)
+			{
+			}
+
+			~TrackedAccount()
+			{
+				if (m_id != 0)
+				{
+					ResourceLedger::Shared().Release(m_id);
+				}
+			}
+
+			TrackedAccount(const TrackedAccount&) = delete;
+			TrackedAccount& operator=(const TrackedAccount&) = delete;
+
+		private:
+			uint64_t m_id = 0;
+		};
+
+	}
+} // namespace WTLayoutManager::Services
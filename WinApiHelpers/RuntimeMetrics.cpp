@@ -0,0 +1,383 @@
+﻿#include "pch.h"
+#include "RuntimeMetrics.h"
+#include <atomic>
+#include <bit>
+#include <cmath>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <sddl.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	/// A counter on a cache line of its own, so processes bumping different counters do not contend.
+	struct alignas(64) CounterSlot
+	{
+		std::atomic<int64_t> value;
+	};
+
+	struct alignas(64) HistogramSlot
+	{
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> sum;
+		std::atomic<uint64_t> buckets[MetricBucketCount];
+	};
+
+	/**
+	 * The shared page. The header is written once by the process that creates the page, magic last;
+	 * after that the page is only ever added to.
+	 */
+	struct MetricsPage
+	{
+		static constexpr uint32_t Magic = 0x4D4C5457; // "WTLM"
+		static constexpr uint32_t Version = 2;
+
+		std::atomic<uint32_t> magic;
+		uint32_t version;
+		uint32_t size;
+		uint32_t counterCount;
+		uint32_t histogramCount;
+		uint32_t bucketCount;
+		uint64_t createdUnixMs;
+		CounterSlot counters[MetricCounterCount];
+		HistogramSlot histograms[MetricHistogramCount];
+	};
+
+	static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<int64_t>::is_always_lock_free &&
+		std::atomic<uint32_t>::is_always_lock_free, "The metrics page is shared between processes and needs address-free atomics");
+	static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) && sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+		"The metrics page layout must not depend on the standard library");
+
+	constexpr const char* CounterNames[] = {
+		"launches_started", "launches_succeeded", "launches_failed", "launches_normal", "launches_elevated",
+		"terminal_discovery_retries", "terminal_discovery_timeouts", "state_parses", "settings_parses",
+		"layout_cache_hits", "layout_cache_misses", "profile_icon_hits", "profile_icon_misses", "watched_processes",
+		"hook_attaches", "hook_file_opens_rewritten", "hook_redirect_failures", "hook_events_dropped" };
+	static_assert(std::size(CounterNames) == MetricCounterCount, "Every counter needs a name");
+
+	constexpr const char* HistogramNames[] = {
+		"terminal_discovery_us", "state_parse_us", "settings_parse_us", "folder_load_us", "hook_attach_us", "hook_init_us" };
+	static_assert(std::size(HistogramNames) == MetricHistogramCount, "Every histogram needs a name");
+
+#if defined(_WIN32)
+	// Full access for SYSTEM, administrators and interactive users, and a medium integrity label, so the
+	// elevated launcher and the app can share the page whichever of them creates it.
+	constexpr const wchar_t* PageSecurity = L"D:P(A;;GA;;;SY)(A;;GA;;;BA)(A;;GA;;;IU)S:(ML;;NW;;;ME)";
+#endif
+
+	void Initialize(MetricsPage& page) noexcept
+	{
+		page.version = MetricsPage::Version;
+		page.size = static_cast<uint32_t>(sizeof(MetricsPage));
+		page.counterCount = static_cast<uint32_t>(MetricCounterCount);
+		page.histogramCount = static_cast<uint32_t>(MetricHistogramCount);
+		page.bucketCount = static_cast<uint32_t>(MetricBucketCount);
+		page.createdUnixMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count());
+		page.magic.store(MetricsPage::Magic, std::memory_order_release);
+	}
+
+	/**
+	 * Creates or opens the shared page for writing.
+	 *
+	 * @return The page, or nullptr if it cannot be mapped.
+	 */
+	MetricsPage* MapPage() noexcept
+	{
+#if defined(_WIN32)
+		SECURITY_ATTRIBUTES attributes{ sizeof(attributes), nullptr, FALSE };
+		PSECURITY_DESCRIPTOR descriptor = nullptr;
+		if (ConvertStringSecurityDescriptorToSecurityDescriptorW(PageSecurity, SDDL_REVISION_1, &descriptor, nullptr))
+		{
+			attributes.lpSecurityDescriptor = descriptor;
+		}
+		HANDLE mapping = ::CreateFileMappingW(INVALID_HANDLE_VALUE, &attributes, PAGE_READWRITE,
+			0, static_cast<DWORD>(sizeof(MetricsPage)), RuntimeMetrics::PageName);
+		const bool created = mapping != nullptr && ::GetLastError() != ERROR_ALREADY_EXISTS;
+		if (descriptor != nullptr)
+		{
+			::LocalFree(descriptor);
+		}
+		if (mapping == nullptr)
+		{
+			return nullptr;
+		}
+		// The view keeps the mapping alive.
+		void* view = ::MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(MetricsPage));
+		::CloseHandle(mapping);
+		if (view == nullptr)
+		{
+			return nullptr;
+		}
+#else
+		int fd = ::shm_open(RuntimeMetrics::PageName, O_RDWR | O_CREAT | O_EXCL, 0600);
+		const bool created = fd >= 0;
+		if (!created)
+		{
+			if (errno != EEXIST)
+			{
+				return nullptr;
+			}
+			fd = ::shm_open(RuntimeMetrics::PageName, O_RDWR, 0);
+			if (fd < 0)
+			{
+				return nullptr;
+			}
+		}
+		// An opener that overtakes the creator extends the object itself, to the same zero-filled size.
+		struct stat st {};
+		if (::fstat(fd, &st) != 0 ||
+			(st.st_size < static_cast<off_t>(sizeof(MetricsPage)) && ::ftruncate(fd, sizeof(MetricsPage)) != 0))
+		{
+			::close(fd);
+			return nullptr;
+		}
+		void* view = ::mmap(nullptr, sizeof(MetricsPage), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (view == MAP_FAILED)
+		{
+			return nullptr;
+		}
+#endif
+		MetricsPage* page = static_cast<MetricsPage*>(view);
+		if (created)
+		{
+			Initialize(*page);
+		}
+		return page;
+	}
+
+	/**
+	 * Returns the page of this process, mapping it on first use. It stays mapped until the process exits.
+	 */
+	MetricsPage& Page() noexcept
+	{
+		static MetricsPage* const page = []() noexcept {
+			MetricsPage* mapped = MapPage();
+			if (mapped != nullptr)
+			{
+				return mapped;
+			}
+			static MetricsPage privatePage{};
+			return &privatePage;
+		}();
+		return *page;
+	}
+}
+
+/**
+ * Adds to a counter.
+ *
+ * @param counter The counter.
+ * @param delta The amount; negative to lower a gauge.
+ */
+void RuntimeMetrics::Add(MetricCounter counter, int64_t delta) noexcept
+{
+	const size_t index = static_cast<size_t>(counter);
+	if (index < MetricCounterCount)
+	{
+		Page().counters[index].value.fetch_add(delta, std::memory_order_relaxed);
+	}
+}
+
+/**
+ * Records a duration.
+ *
+ * @param histogram The histogram.
+ * @param microseconds The duration.
+ */
+void RuntimeMetrics::Record(MetricHistogram histogram, uint64_t microseconds) noexcept
+{
+	const size_t index = static_cast<size_t>(histogram);
+	if (index < MetricHistogramCount)
+	{
+		HistogramSlot& slot = Page().histograms[index];
+		slot.count.fetch_add(1, std::memory_order_relaxed);
+		slot.sum.fetch_add(microseconds, std::memory_order_relaxed);
+		slot.buckets[BucketOf(microseconds)].fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+/**
+ * Returns the bucket a value falls in: the bit width of the value, capped at the last bucket.
+ */
+size_t RuntimeMetrics::BucketOf(uint64_t value) noexcept
+{
+	const size_t width = static_cast<size_t>(std::bit_width(value));
+	return width < MetricBucketCount ? width : MetricBucketCount - 1;
+}
+
+uint64_t RuntimeMetrics::BucketUpperBound(size_t bucket) noexcept
+{
+	return bucket + 1 < MetricBucketCount ? uint64_t{ 1 } << bucket : UINT64_MAX;
+}
+
+/**
+ * Estimates a quantile from the bucket counts.
+ *
+ * @param histogram The histogram.
+ * @param quantile Between 0 and 1.
+ * @return The upper bound of the first bucket at which the cumulative count reaches the quantile.
+ */
+uint64_t RuntimeMetrics::Quantile(const MetricsSnapshot::Histogram& histogram, double quantile) noexcept
+{
+	uint64_t total = 0;
+	for (uint64_t count : histogram.buckets)
+	{
+		total += count;
+	}
+	if (total == 0)
+	{
+		return 0;
+	}
+	const double clamped = quantile < 0 ? 0 : (quantile > 1 ? 1 : quantile);
+	uint64_t target = static_cast<uint64_t>(std::ceil(clamped * static_cast<double>(total)));
+	target = target == 0 ? 1 : target;
+	uint64_t cumulative = 0;
+	for (size_t i = 0; i < MetricBucketCount; ++i)
+	{
+		cumulative += histogram.buckets[i];
+		if (cumulative >= target)
+		{
+			return BucketUpperBound(i);
+		}
+	}
+	return UINT64_MAX;
+}
+
+const char* RuntimeMetrics::CounterName(MetricCounter counter) noexcept
+{
+	const size_t index = static_cast<size_t>(counter);
+	return index < MetricCounterCount ? CounterNames[index] : "";
+}
+
+const char* RuntimeMetrics::HistogramName(MetricHistogram histogram) noexcept
+{
+	const size_t index = static_cast<size_t>(histogram);
+	return index < MetricHistogramCount ? HistogramNames[index] : "";
+}
+
+// --------------------------------------------------------------------------
+
+struct MetricsReader::State
+{
+	const MetricsPage* page = nullptr;
+
+	void Close() noexcept
+	{
+		if (page != nullptr)
+		{
+#if defined(_WIN32)
+			::UnmapViewOfFile(page);
+#else
+			::munmap(const_cast<MetricsPage*>(page), sizeof(MetricsPage));
+#endif
+			page = nullptr;
+		}
+	}
+};
+
+MetricsReader::MetricsReader()
+	: m_state(std::make_unique<State>())
+{
+}
+
+MetricsReader::~MetricsReader()
+{
+	m_state->Close();
+}
+
+/**
+ * Maps the page read-only and checks that its layout is the one this build knows.
+ *
+ * @return false if the page does not exist yet, is still being initialized, or has another layout.
+ */
+bool MetricsReader::Open()
+{
+	m_state->Close();
+#if defined(_WIN32)
+	HANDLE mapping = ::OpenFileMappingW(FILE_MAP_READ, FALSE, RuntimeMetrics::PageName);
+	if (mapping == nullptr)
+	{
+		return false;
+	}
+	const void* view = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(MetricsPage));
+	::CloseHandle(mapping);
+	if (view == nullptr)
+	{
+		return false;
+	}
+#else
+	const int fd = ::shm_open(RuntimeMetrics::PageName, O_RDONLY, 0);
+	if (fd < 0)
+	{
+		return false;
+	}
+	struct stat st {};
+	if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(MetricsPage)))
+	{
+		::close(fd);
+		return false;
+	}
+	void* view = ::mmap(nullptr, sizeof(MetricsPage), PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (view == MAP_FAILED)
+	{
+		return false;
+	}
+#endif
+	m_state->page = static_cast<const MetricsPage*>(view);
+
+	const MetricsPage& page = *m_state->page;
+	if (page.magic.load(std::memory_order_acquire) != MetricsPage::Magic ||
+		page.version != MetricsPage::Version ||
+		page.size != sizeof(MetricsPage) ||
+		page.counterCount != MetricCounterCount ||
+		page.histogramCount != MetricHistogramCount ||
+		page.bucketCount != MetricBucketCount)
+	{
+		m_state->Close();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Copies the page.
+ *
+ * @param snapshot Receives the values.
+ * @return false if the page is not open.
+ */
+bool MetricsReader::Read(MetricsSnapshot& snapshot) const noexcept
+{
+	const MetricsPage* page = m_state->page;
+	if (page == nullptr)
+	{
+		return false;
+	}
+	snapshot.createdUnixMs = page->createdUnixMs;
+	for (size_t i = 0; i < MetricCounterCount; ++i)
+	{
+		snapshot.counters[i] = page->counters[i].value.load(std::memory_order_relaxed);
+	}
+	for (size_t i = 0; i < MetricHistogramCount; ++i)
+	{
+		const HistogramSlot& slot = page->histograms[i];
+		snapshot.histograms[i].count = slot.count.load(std::memory_order_relaxed);
+		snapshot.histograms[i].sum = slot.sum.load(std::memory_order_relaxed);
+		for (size_t b = 0; b < MetricBucketCount; ++b)
+		{
+			snapshot.histograms[i].buckets[b] = slot.buckets[b].load(std::memory_order_relaxed);
+		}
+	}
+	return true;
+}
@@ -0,0 +1,188 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// The counters of the metrics page. All are monotonic except WatchedProcesses, a gauge.
+		/// </summary>
+		/// <remarks>Append only: the page layout, and so its version, depends on the order.</remarks>
+		enum class MetricCounter : uint32_t
+		{
+			LaunchesStarted,
+			LaunchesSucceeded,          // the process started and its Windows Terminal was found
+			LaunchesFailed,
+			NormalLaunches,
+			ElevatedLaunches,
+			TerminalDiscoveryRetries,   // snapshots of the process list that did not find the terminal
+			TerminalDiscoveryTimeouts,
+			StateParses,
+			SettingsParses,
+			LayoutCacheHits,
+			LayoutCacheMisses,
+			ProfileIconHits,
+			ProfileIconMisses,
+			WatchedProcesses,           // processes currently waited on
+			HookAttaches,               // processes the injected hook reported from
+			HookFileOpensRewritten,     // file opens the hook redirected to the LocalState copy
+			HookRedirectFailures,       // file opens the hook meant to redirect but could not
+			HookEventsDropped,          // hook events lost to a full telemetry ring
+			Count
+		};
+
+		/// <summary>
+		/// The duration histograms of the metrics page; every value is in microseconds.
+		/// </summary>
+		/// <remarks>Append only, like MetricCounter.</remarks>
+		enum class MetricHistogram : uint32_t
+		{
+			TerminalDiscovery,          // from the resumed launcher process to the Windows Terminal handle
+			StateParse,                 // reading and deserializing a state file
+			SettingsParse,              // reading the profiles of a settings.json
+			FolderLoad,                 // building the model of one LocalState folder
+			HookAttach,                 // from the resumed launcher process to the hook reporting from Windows Terminal
+			HookInit,                   // time the hook spent attaching, as it reports it
+			Count
+		};
+
+		constexpr size_t MetricCounterCount = static_cast<size_t>(MetricCounter::Count);
+		constexpr size_t MetricHistogramCount = static_cast<size_t>(MetricHistogram::Count);
+
+		/// <summary>
+		/// Number of histogram buckets: bucket 0 holds 0, bucket i holds [2^(i-1), 2^i), the last one
+		/// everything above.
+		/// </summary>
+		constexpr size_t MetricBucketCount = 32;
+
+		/// <summary>
+		/// A copy of the metrics page taken by MetricsReader.
+		/// </summary>
+		struct MetricsSnapshot
+		{
+			struct Histogram
+			{
+				uint64_t count;
+				uint64_t sum;
+				uint64_t buckets[MetricBucketCount];
+			};
+
+			uint64_t createdUnixMs;
+			int64_t counters[MetricCounterCount];
+			Histogram histograms[MetricHistogramCount];
+		};
+
+		/// <summary>
+		/// Publishes launcher and parser counters in a named, versioned shared memory page.
+		/// </summary>
+		/// <remarks>
+		/// Every process that loads WinApiHelpers maps the same page on first use: the app, the elevated
+		/// launcher and any tool. Updates are single relaxed atomic adds on the page, so they cost about
+		/// as much as an uncontended interlocked instruction and never wait for a reader; readers map
+		/// the page read-only and copy it whenever they like. The page is named after its layout
+		/// version, so an old reader never misreads a newer layout. If the page cannot be mapped the
+		/// updates go to a private copy and are simply not visible.
+		/// </remarks>
+		class RuntimeMetrics
+		{
+		public:
+#if defined(_WIN32)
+			static constexpr const wchar_t* PageName = L"Local\\WTLayoutManager.Metrics.v2";
+#else
+			static constexpr const char* PageName = "/WTLayoutManager.Metrics.v2";
+#endif
+
+			/// <summary>
+			/// Adds delta to a counter; use a negative delta to lower the gauge.
+			/// </summary>
+			WINAPIHELPERS_API static void Add(MetricCounter counter, int64_t delta = 1) noexcept;
+
+			/// <summary>
+			/// Records a duration in microseconds.
+			/// </summary>
+			WINAPIHELPERS_API static void Record(MetricHistogram histogram, uint64_t microseconds) noexcept;
+
+			/// <summary>
+			/// Returns the bucket a value falls in.
+			/// </summary>
+			WINAPIHELPERS_API static size_t BucketOf(uint64_t value) noexcept;
+
+			/// <summary>
+			/// Returns the exclusive upper bound of a bucket; UINT64_MAX for the last one.
+			/// </summary>
+			WINAPIHELPERS_API static uint64_t BucketUpperBound(size_t bucket) noexcept;
+
+			/// <summary>
+			/// Estimates a quantile as the upper bound of the bucket that reaches it.
+			/// </summary>
+			/// <param name="histogram">The histogram.</param>
+			/// <param name="quantile">Between 0 and 1.</param>
+			/// <returns>0 for an empty histogram.</returns>
+			WINAPIHELPERS_API static uint64_t Quantile(const MetricsSnapshot::Histogram& histogram, double quantile) noexcept;
+
+			WINAPIHELPERS_API static const char* CounterName(MetricCounter counter) noexcept;
+			WINAPIHELPERS_API static const char* HistogramName(MetricHistogram histogram) noexcept;
+		};
+
+		/// <summary>
+		/// Records the time from construction to destruction in a histogram.
+		/// </summary>
+		class MetricTimer
+		{
+		public:
+			explicit MetricTimer(MetricHistogram histogram) noexcept
+				: m_histogram(histogram), m_start(std::chrono::steady_clock::now())
+			{
+			}
+
+			~MetricTimer()
+			{
+				const auto elapsed = std::chrono::steady_clock::now() - m_start;
+				RuntimeMetrics::Record(m_histogram,
+					static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+			}
+
+			MetricTimer(const MetricTimer&) = delete;
+			MetricTimer& operator=(const MetricTimer&) = delete;
+
+		private:
+			MetricHistogram m_histogram;
+			std::chrono::steady_clock::time_point m_start;
+		};
+
+		/// <summary>
+		/// Maps the metrics page read-only and copies it.
+		/// </summary>
+		class MetricsReader
+		{
+		public:
+			WINAPIHELPERS_API MetricsReader();
+			WINAPIHELPERS_API ~MetricsReader();
+
+			MetricsReader(const MetricsReader&) = delete;
+			MetricsReader& operator=(const MetricsReader&) = delete;
+
+			/// <summary>
+			/// Maps the page.
+			/// </summary>
+			/// <returns>false if no process has published metrics yet, or the page has another layout.</returns>
+			WINAPIHELPERS_API bool Open();
+
+			/// <summary>
+			/// Copies the page. Each value is read atomically; the copy as a whole is not a consistent cut.
+			/// </summary>
+			/// <returns>false if the page is not open.</returns>
+			WINAPIHELPERS_API bool Read(MetricsSnapshot& snapshot) const noexcept;
+
+		private:
+			struct State;
+			std::unique_ptr<State> m_state;
+		};
+
+	}
+} // namespace WTLayoutManager::Services
@@ -0,0 +1,583 @@
+﻿#include "pch.h"
+#include "SearchIndex.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <unordered_map>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SEARCH_INDEX_SSE2 1
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#include <arm_neon.h>
+#define SEARCH_INDEX_NEON 1
+#endif
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	/// Ranking weight of each SearchField.
+	constexpr uint32_t FieldWeights[] = { 16, 8, 6, 4, 3 };
+
+	/// Match quality of a term inside one piece of text; the score of a term is weight times quality.
+	enum MatchQuality : uint32_t
+	{
+		NoMatch = 0,
+		InnerMatch = 1,
+		WordMatch = 2,
+		PrefixMatch = 3,
+		ExactMatch = 4
+	};
+
+	constexpr uint32_t MaxTermScore = FieldWeights[0] * ExactMatch;
+
+	/**
+	 * Folds one UTF-16 code unit to lower case (ASCII, Latin-1, Latin Extended-A, Greek, Cyrillic).
+	 *
+	 * @param c The code unit.
+	 * @return The folded code unit; always a single unit, so folding never changes lengths.
+	 */
+	constexpr char16_t FoldChar(char16_t c) noexcept
+	{
+		if (c < 0x80)
+		{
+			return c >= u'A' && c <= u'Z' ? static_cast<char16_t>(c + 0x20) : c;
+		}
+		if (c >= 0xC0 && c <= 0xDE && c != 0xD7)
+		{
+			return static_cast<char16_t>(c + 0x20);
+		}
+		if (c >= 0x100 && c <= 0x17F)
+		{
+			// Upper case at even code points, except for the two runs where it is odd.
+			if (c == 0x130)
+			{
+				return u'i';
+			}
+			if (c == 0x178)
+			{
+				return 0xFF;
+			}
+			if (c == 0x131 || c == 0x138 || c == 0x149 || c == 0x17F)
+			{
+				return c;
+			}
+			if ((c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E))
+			{
+				return (c & 1) ? static_cast<char16_t>(c + 1) : c;
+			}
+			return (c & 1) ? c : static_cast<char16_t>(c + 1);
+		}
+		if (c >= 0x391 && c <= 0x3AB && c != 0x3A2)
+		{
+			return static_cast<char16_t>(c + 0x20);
+		}
+		if (c >= 0x410 && c <= 0x42F)
+		{
+			return static_cast<char16_t>(c + 0x20);
+		}
+		if (c >= 0x400 && c <= 0x40F)
+		{
+			return static_cast<char16_t>(c + 0x50);
+		}
+		return c;
+	}
+
+	/// Whitespace separates query terms; NUL also separates the pieces of a document's text.
+	constexpr bool IsSpace(char16_t c) noexcept
+	{
+		return c == 0 || c == u' ' || c == u'\t' || c == u'\r' || c == u'\n';
+	}
+
+	/// Characters after which a match counts as starting a word (path and command line separators included).
+	constexpr bool IsWordBreak(char16_t c) noexcept
+	{
+		return IsSpace(c) || c == u'\\' || c == u'/' || c == u'-' || c == u'_' || c == u'.' || c == u':' || c == u'"';
+	}
+
+	/**
+	 * Packs an n-gram (n = 1..3) into one key: the length above three 16-bit code units.
+	 */
+	constexpr uint64_t GramKey(const char16_t* s, size_t n) noexcept
+	{
+		uint64_t key = static_cast<uint64_t>(n) << 48;
+		for (size_t i = 0; i < n; ++i)
+		{
+			key |= static_cast<uint64_t>(s[i]) << (32 - 16 * i);
+		}
+		return key;
+	}
+
+	/**
+	 * Calls visit for every occurrence of a term in a text, until visit returns false.
+	 *
+	 * Candidate positions are found eight at a time by comparing the text with the first two code units of
+	 * the term; only those candidates are compared in full.
+	 *
+	 * @param text The text to search.
+	 * @param term The term; at least two code units.
+	 * @param visit Called with the position of each occurrence, in ascending order.
+	 */
+	template <typename Visit>
+	void ForEachOccurrence(std::u16string_view text, std::u16string_view term, Visit&& visit)
+	{
+		if (text.size() < term.size())
+		{
+			return;
+		}
+		const char16_t* s = text.data();
+		const size_t termBytes = term.size() * sizeof(char16_t);
+		const size_t end = text.size() - term.size() + 1;   // positions where the term still fits
+
+		size_t i = 0;
+#if defined(SEARCH_INDEX_SSE2)
+		const __m128i first = _mm_set1_epi16(static_cast<short>(term[0]));
+		const __m128i second = _mm_set1_epi16(static_cast<short>(term[1]));
+		for (; i + 8 <= end; i += 8)
+		{
+			const __m128i a = _mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i)), first);
+			const __m128i b = _mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 1)), second);
+			unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(a, b)));
+			while (mask != 0)
+			{
+				const unsigned bit = static_cast<unsigned>(std::countr_zero(mask));
+				mask &= ~(3u << bit);   // two mask bits per code unit
+				const size_t pos = i + bit / 2;
+				if (std::memcmp(s + pos, term.data(), termBytes) == 0 && !visit(pos))
+				{
+					return;
+				}
+			}
+		}
+#elif defined(SEARCH_INDEX_NEON)
+		const uint16x8_t first = vdupq_n_u16(term[0]);
+		const uint16x8_t second = vdupq_n_u16(term[1]);
+		for (; i + 8 <= end; i += 8)
+		{
+			const uint16x8_t a = vceqq_u16(vld1q_u16(reinterpret_cast<const uint16_t*>(s + i)), first);
+			const uint16x8_t b = vceqq_u16(vld1q_u16(reinterpret_cast<const uint16_t*>(s + i + 1)), second);
+			uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vmovn_u16(vandq_u16(a, b))), 0);
+			while (mask != 0)
+			{
+				const unsigned bit = static_cast<unsigned>(std::countr_zero(mask));
+				mask &= ~(0xFFull << bit);   // eight mask bits per code unit
+				const size_t pos = i + bit / 8;
+				if (std::memcmp(s + pos, term.data(), termBytes) == 0 && !visit(pos))
+				{
+					return;
+				}
+			}
+		}
+#endif
+		for (; i < end; ++i)
+		{
+			if (s[i] == term[0] && std::memcmp(s + i, term.data(), termBytes) == 0 && !visit(i))
+			{
+				return;
+			}
+		}
+	}
+
+	/// A document containing an n-gram, with the score the n-gram gets as a whole query term.
+	struct Posting
+	{
+		uint32_t id;
+		uint32_t score;
+	};
+
+	bool operator<(const Posting& posting, uint32_t id) noexcept
+	{
+		return posting.id < id;
+	}
+
+	/**
+	 * Rates an occurrence of a term by where it starts in its piece of text.
+	 *
+	 * @param text The folded text of the document.
+	 * @param pieceOffset Start of the piece containing the occurrence.
+	 * @param pieceLength Length of that piece.
+	 * @param pos Start of the occurrence.
+	 * @param termLength Length of the term.
+	 */
+	MatchQuality Rate(const char16_t* text, size_t pieceOffset, size_t pieceLength, size_t pos, size_t termLength) noexcept
+	{
+		if (pos == pieceOffset)
+		{
+			return termLength == pieceLength ? ExactMatch : PrefixMatch;
+		}
+		return IsWordBreak(text[pos - 1]) ? WordMatch : InnerMatch;
+	}
+
+	/**
+	 * Intersects a sorted posting list into a sorted candidate list, in place.
+	 */
+	void Intersect(std::vector<uint32_t>& candidates, const std::vector<Posting>& list)
+	{
+		auto out = candidates.begin();
+		auto other = list.begin();
+		for (auto it = candidates.begin(); it != candidates.end() && other != list.end(); ++it)
+		{
+			other = std::lower_bound(other, list.end(), *it);
+			if (other != list.end() && other->id == *it)
+			{
+				*out++ = *it;
+			}
+		}
+		candidates.erase(out, candidates.end());
+	}
+}
+
+struct SearchIndex::State
+{
+	struct Piece
+	{
+		SearchField field;
+		uint32_t offset;
+		uint32_t length;
+	};
+
+	struct Document
+	{
+		std::u16string text;           // the folded pieces, each followed by a NUL
+		std::vector<Piece> pieces;
+		std::vector<uint64_t> grams;   // distinct n-gram keys, to unlink the document on removal
+	};
+
+	std::unordered_map<uint32_t, Document> documents;
+	std::unordered_map<uint64_t, std::vector<Posting>> postings;   // n-gram -> postings sorted by id
+
+	const std::vector<Posting>* Postings(uint64_t key) const
+	{
+		auto it = postings.find(key);
+		return it == postings.end() ? nullptr : &it->second;
+	}
+
+	void Unlink(uint32_t id, const Document& document)
+	{
+		for (uint64_t key : document.grams)
+		{
+			auto it = postings.find(key);
+			if (it == postings.end())
+			{
+				continue;
+			}
+			std::vector<Posting>& list = it->second;
+			auto pos = std::lower_bound(list.begin(), list.end(), id);
+			if (pos != list.end() && pos->id == id)
+			{
+				list.erase(pos);
+			}
+			if (list.empty())
+			{
+				postings.erase(it);
+			}
+		}
+	}
+};
+
+/**
+ * \brief Constructor, creates an empty index.
+ */
+SearchIndex::SearchIndex()
+	: m_state(std::make_unique<State>())
+{
+}
+
+/**
+ * \brief Destructor.
+ */
+SearchIndex::~SearchIndex() = default;
+
+/**
+ * Case folds text, eight code units at a time while they are ASCII.
+ *
+ * @param text The text to fold.
+ * @param folded Receives the folded text.
+ */
+void SearchIndex::Fold(std::u16string_view text, std::u16string& folded)
+{
+	folded.resize(text.size());
+	const char16_t* src = text.data();
+	char16_t* dst = folded.data();
+	size_t i = 0;
+#if defined(SEARCH_INDEX_SSE2)
+	const __m128i nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i beforeA = _mm_set1_epi16(u'A' - 1);
+	const __m128i afterZ = _mm_set1_epi16(u'Z' + 1);
+	const __m128i caseBit = _mm_set1_epi16(0x20);
+	for (; i + 8 <= text.size(); i += 8)
+	{
+		const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(block, nonAscii), zero)) != 0xFFFF)
+		{
+			for (size_t j = i; j < i + 8; ++j)
+			{
+				dst[j] = FoldChar(src[j]);
+			}
+			continue;
+		}
+		// All lanes are below 0x80, so the signed comparisons are exact.
+		const __m128i upper = _mm_and_si128(_mm_cmpgt_epi16(block, beforeA), _mm_cmplt_epi16(block, afterZ));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_add_epi16(block, _mm_and_si128(upper, caseBit)));
+	}
+#elif defined(SEARCH_INDEX_NEON)
+	for (; i + 8 <= text.size(); i += 8)
+	{
+		const uint16x8_t block = vld1q_u16(reinterpret_cast<const uint16_t*>(src + i));
+		if (vmaxvq_u16(block) >= 0x80)
+		{
+			for (size_t j = i; j < i + 8; ++j)
+			{
+				dst[j] = FoldChar(src[j]);
+			}
+			continue;
+		}
+		const uint16x8_t upper = vandq_u16(vcgeq_u16(block, vdupq_n_u16(u'A')), vcleq_u16(block, vdupq_n_u16(u'Z')));
+		vst1q_u16(reinterpret_cast<uint16_t*>(dst + i), vaddq_u16(block, vandq_u16(upper, vdupq_n_u16(0x20))));
+	}
+#endif
+	for (; i < text.size(); ++i)
+	{
+		dst[i] = FoldChar(src[i]);
+	}
+}
+
+/**
+ * Indexes a document, replacing its previous text.
+ *
+ * @param id The document id.
+ * @param texts The pieces of text.
+ * @param count Number of pieces.
+ */
+void SearchIndex::Upsert(uint32_t id, const SearchText* texts, size_t count)
+{
+	State& state = *m_state;
+	Remove(id);
+
+	State::Document document;
+	std::u16string folded;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (texts[i].text.empty())
+		{
+			continue;
+		}
+		Fold(texts[i].text, folded);
+		document.pieces.push_back(State::Piece{
+			texts[i].field,
+			static_cast<uint32_t>(document.text.size()),
+			static_cast<uint32_t>(folded.size()) });
+		document.text += folded;
+		document.text += u'\0';
+	}
+
+	// Every n-gram with its best score in this document, then reduced to one entry per n-gram.
+	std::vector<std::pair<uint64_t, uint32_t>> grams;
+	for (const State::Piece& piece : document.pieces)
+	{
+		const char16_t* s = document.text.data();
+		const uint32_t weight = FieldWeights[static_cast<size_t>(piece.field)];
+		for (size_t i = piece.offset; i < piece.offset + piece.length; ++i)
+		{
+			// Grams spanning whitespace are never queried: terms are split at whitespace.
+			for (size_t n = 1; n <= 3 && i + n <= piece.offset + piece.length && !IsSpace(s[i + n - 1]); ++n)
+			{
+				grams.emplace_back(GramKey(s + i, n), weight * Rate(s, piece.offset, piece.length, i, n));
+			}
+		}
+	}
+	std::sort(grams.begin(), grams.end(), [](const auto& a, const auto& b)
+		{
+			return a.first != b.first ? a.first < b.first : a.second > b.second;
+		});
+
+	for (size_t i = 0; i < grams.size(); ++i)
+	{
+		if (i > 0 && grams[i].first == grams[i - 1].first)
+		{
+			continue; // the first entry of each n-gram has the best score
+		}
+		document.grams.push_back(grams[i].first);
+		std::vector<Posting>& list = state.postings[grams[i].first];
+		list.insert(std::lower_bound(list.begin(), list.end(), id), Posting{ id, grams[i].second });
+	}
+	state.documents.emplace(id, std::move(document));
+}
+
+/**
+ * Removes a document and its postings.
+ *
+ * @param id The document id.
+ * @return false if the id was not indexed.
+ */
+bool SearchIndex::Remove(uint32_t id)
+{
+	State& state = *m_state;
+	auto it = state.documents.find(id);
+	if (it == state.documents.end())
+	{
+		return false;
+	}
+	state.Unlink(id, it->second);
+	state.documents.erase(it);
+	return true;
+}
+
+/**
+ * Removes every document.
+ */
+void SearchIndex::Clear()
+{
+	m_state->documents.clear();
+	m_state->postings.clear();
+}
+
+/**
+ * Returns the number of indexed documents.
+ */
+size_t SearchIndex::Size() const
+{
+	return m_state->documents.size();
+}
+
+/**
+ * Runs a query: candidates from the posting lists, then verification and ranking.
+ *
+ * Terms of up to three code units are n-grams themselves, so their posting lists are exact and
+ * already carry the score; only longer terms are confirmed against the document text.
+ *
+ * @param query The query text.
+ * @param hits Receives the ranked hits.
+ * @return Number of hits.
+ */
+size_t SearchIndex::Query(std::u16string_view query, std::vector<SearchHit>& hits) const
+{
+	const State& state = *m_state;
+	hits.clear();
+
+	std::u16string folded;
+	Fold(query, folded);
+	std::vector<std::u16string_view> terms;
+	for (size_t i = 0; i < folded.size();)
+	{
+		while (i < folded.size() && IsSpace(folded[i]))
+		{
+			++i;
+		}
+		const size_t begin = i;
+		while (i < folded.size() && !IsSpace(folded[i]))
+		{
+			++i;
+		}
+		if (i > begin)
+		{
+			terms.emplace_back(folded.data() + begin, i - begin);
+		}
+	}
+	if (terms.empty())
+	{
+		return 0;
+	}
+
+	// Posting lists every candidate must be in: the whole term when it is short, else its trigrams.
+	std::vector<const std::vector<Posting>*> lists;
+	std::vector<const std::vector<Posting>*> exact(terms.size(), nullptr);
+	for (size_t t = 0; t < terms.size(); ++t)
+	{
+		const std::u16string_view term = terms[t];
+		const size_t n = std::min<size_t>(term.size(), 3);
+		for (size_t i = 0; i + n <= term.size(); ++i)
+		{
+			const std::vector<Posting>* list = state.Postings(GramKey(term.data() + i, n));
+			if (list == nullptr)
+			{
+				return 0;
+			}
+			lists.push_back(list);
+		}
+		if (term.size() <= 3)
+		{
+			exact[t] = lists.back();
+		}
+	}
+	std::sort(lists.begin(), lists.end(), [](const auto* a, const auto* b) { return a->size() < b->size(); });
+	lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+	std::vector<uint32_t> candidates;
+	candidates.reserve(lists.front()->size());
+	for (const Posting& posting : *lists.front())
+	{
+		candidates.push_back(posting.id);
+	}
+	for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i)
+	{
+		Intersect(candidates, *lists[i]);
+	}
+
+	hits.reserve(candidates.size());
+	for (uint32_t id : candidates)
+	{
+		const State::Document* document = nullptr;
+		uint32_t score = 0;
+		bool matched = true;
+		for (size_t t = 0; t < terms.size() && matched; ++t)
+		{
+			if (exact[t] != nullptr)
+			{
+				score += std::lower_bound(exact[t]->begin(), exact[t]->end(), id)->score;
+				continue;
+			}
+
+			if (document == nullptr)
+			{
+				document = &state.documents.at(id);
+			}
+			const std::u16string_view term = terms[t];
+			uint32_t best = 0;
+			size_t piece = 0;
+			ForEachOccurrence(document->text, term, [&](size_t pos)
+				{
+					while (pos >= document->pieces[piece].offset + document->pieces[piece].length)
+					{
+						++piece;
+					}
+					const State::Piece& p = document->pieces[piece];
+					const uint32_t weight = FieldWeights[static_cast<size_t>(p.field)];
+					best = std::max<uint32_t>(best, weight * Rate(document->text.data(), p.offset, p.length, pos, term.size()));
+					return best < MaxTermScore;
+				});
+			matched = best != 0; // zero when every trigram occurs, but not contiguously
+			score += best;
+		}
+		if (matched)
+		{
+			hits.push_back(SearchHit{ id, score });
+		}
+	}
+
+	// Scores are small integers and the hits are already in id order: a counting sort by descending
+	// score keeps ties in id order in linear time.
+	uint32_t maxScore = 0;
+	for (const SearchHit& hit : hits)
+	{
+		maxScore = std::max(maxScore, hit.score);
+	}
+	std::vector<uint32_t> starts(maxScore + 2, 0);
+	for (const SearchHit& hit : hits)
+	{
+		++starts[maxScore - hit.score + 1];
+	}
+	for (size_t i = 1; i < starts.size(); ++i)
+	{
+		starts[i] += starts[i - 1];
+	}
+	std::vector<SearchHit> ranked(hits.size());
+	for (const SearchHit& hit : hits)
+	{
+		ranked[starts[maxScore - hit.score]++] = hit;
+	}
+	hits.swap(ranked);
+	return hits.size();
+}
@@ -0,0 +1,111 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// The part of a snapshot a piece of indexed text comes from; also its ranking weight, highest first.
+		/// </summary>
+		enum class SearchField : uint8_t
+		{
+			FolderName = 0,
+			TabTitle = 1,
+			ProfileName = 2,
+			StartingDirectory = 3,
+			Commandline = 4
+		};
+
+		/// <summary>
+		/// One piece of text of a document.
+		/// </summary>
+		struct SearchText
+		{
+			SearchField field;
+			std::u16string_view text;
+		};
+
+		/// <summary>
+		/// One matching document and its rank score (higher is better).
+		/// </summary>
+		struct SearchHit
+		{
+			uint32_t id;
+			uint32_t score;
+		};
+
+		/// <summary>
+		/// Incremental n-gram index over the searchable text of the listed snapshots.
+		/// </summary>
+		/// <remarks>
+		/// Every document (one snapshot folder, identified by a caller-chosen id) is case folded and split
+		/// into all 1-, 2- and 3-grams; each n-gram has a sorted posting list of the documents containing it.
+		/// A query term of one or two characters is answered by its posting list directly. Longer terms
+		/// intersect the posting lists of their trigrams, rarest first, and the few remaining candidates are
+		/// confirmed with a substring search of the folded text. Whitespace separates terms that must all
+		/// match. Hits are ranked by the best field and match position (whole text, prefix, word start,
+		/// anywhere) of every term. Case folding covers ASCII (vectorized), Latin-1, Latin Extended-A,
+		/// Greek and Cyrillic. Not thread-safe: calls must be serialized by the caller.
+		/// </remarks>
+		class SearchIndex
+		{
+		public:
+			WINAPIHELPERS_API SearchIndex();
+			WINAPIHELPERS_API ~SearchIndex();
+
+			SearchIndex(const SearchIndex&) = delete;
+			SearchIndex& operator=(const SearchIndex&) = delete;
+
+			/// <summary>
+			/// Adds a document, or replaces the text of an existing one.
+			/// </summary>
+			/// <param name="id">The document id.</param>
+			/// <param name="texts">The document's text, any number of pieces per field.</param>
+			/// <param name="count">Number of pieces.</param>
+			WINAPIHELPERS_API void Upsert(uint32_t id, const SearchText* texts, size_t count);
+
+			/// <summary>
+			/// Removes a document.
+			/// </summary>
+			/// <returns>false if the id is not indexed.</returns>
+			WINAPIHELPERS_API bool Remove(uint32_t id);
+
+			/// <summary>
+			/// Removes every document.
+			/// </summary>
+			WINAPIHELPERS_API void Clear();
+
+			/// <summary>
+			/// Number of indexed documents.
+			/// </summary>
+			WINAPIHELPERS_API size_t Size() const;
+
+			/// <summary>
+			/// Finds the documents matching every term of a query.
+			/// </summary>
+			/// <param name="query">Whitespace separated terms; an empty query matches nothing.</param>
+			/// <param name="hits">Receives the hits, best first; ties are ordered by id.</param>
+			/// <returns>Number of hits.</returns>
+			WINAPIHELPERS_API size_t Query(std::u16string_view query, std::vector<SearchHit>& hits) const;
+
+			/// <summary>
+			/// Case folds UTF-16 text with the rules used by the index.
+			/// </summary>
+			/// <param name="text">The text to fold.</param>
+			/// <param name="folded">Receives the folded text, same length as the input.</param>
+			WINAPIHELPERS_API static void Fold(std::u16string_view text, std::u16string& folded);
+
+		private:
+			struct State;
+			std::unique_ptr<State> m_state;
+		};
+
+	}
+} // namespace WTLayoutManager::Services
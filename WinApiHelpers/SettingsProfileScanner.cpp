@@ -0,0 +1,670 @@
+﻿#include "pch.h"
+#include "SettingsProfileScanner.h"
+#include <bit>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SETTINGS_SCANNER_SSE2 1
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#include <arm_neon.h>
+#define SETTINGS_SCANNER_NEON 1
+#endif
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	/**
+	 * Finds the first byte that belongs to the given set.
+	 *
+	 * Sixteen bytes are classified per step (SSE2 on x86 / x64, NEON on ARM64) into a bit mask of
+	 * matching positions; the first set bit is the result. The tail is searched byte by byte.
+	 *
+	 * @param p Start of the range.
+	 * @param end End of the range.
+	 * @return The first matching byte, or end.
+	 */
+	template <char... Set>
+	const char* FindFirst(const char* p, const char* end) noexcept
+	{
+#if defined(SETTINGS_SCANNER_SSE2)
+		while (end - p >= 16)
+		{
+			const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			__m128i hits = _mm_setzero_si128();
+			((hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(Set)))), ...);
+			const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+			if (mask != 0)
+			{
+				return p + std::countr_zero(mask);
+			}
+			p += 16;
+		}
+#elif defined(SETTINGS_SCANNER_NEON)
+		while (end - p >= 16)
+		{
+			const uint8x16_t block = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+			uint8x16_t hits = vdupq_n_u8(0);
+			((hits = vorrq_u8(hits, vceqq_u8(block, vdupq_n_u8(static_cast<uint8_t>(Set))))), ...);
+			// Narrow every byte of the comparison result to a nibble: 4 mask bits per position.
+			const uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hits), 4)), 0);
+			if (mask != 0)
+			{
+				return p + (std::countr_zero(mask) >> 2);
+			}
+			p += 16;
+		}
+#endif
+		for (; p < end; ++p)
+		{
+			const char c = *p;
+			if (((c == Set) || ...))
+			{
+				return p;
+			}
+		}
+		return end;
+	}
+
+	/**
+	 * Forward-only cursor over a JSON document that descends only where asked to.
+	 */
+	class Scanner
+	{
+	public:
+		Scanner(const char* begin, const char* end) noexcept : m_p(begin), m_end(end)
+		{
+		}
+
+		char Peek() const noexcept
+		{
+			return m_p < m_end ? *m_p : '\0';
+		}
+
+		bool AtEnd() const noexcept
+		{
+			return m_p == m_end;
+		}
+
+		/**
+		 * Skips whitespace, line comments and block comments.
+		 *
+		 * @return false on an unterminated block comment.
+		 */
+		bool SkipTrivia() noexcept
+		{
+			while (m_p < m_end)
+			{
+				const char c = *m_p;
+				if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+				{
+					++m_p;
+				}
+				else if (c == '/' && m_end - m_p >= 2 && m_p[1] == '/')
+				{
+					m_p = FindFirst<'\n', '\r'>(m_p + 2, m_end);
+				}
+				else if (c == '/' && m_end - m_p >= 2 && m_p[1] == '*')
+				{
+					if (!SkipBlockComment())
+					{
+						return false;
+					}
+				}
+				else
+				{
+					break;
+				}
+			}
+			return true;
+		}
+
+		/**
+		 * Reads the string starting at the cursor.
+		 *
+		 * @param out Receives the raw contents between the quotes.
+		 * @return false if the string is not terminated.
+		 */
+		bool ReadString(std::string_view& out) noexcept
+		{
+			const char* start = ++m_p;
+			for (;;)
+			{
+				const char* q = FindFirst<'"', '\\'>(m_p, m_end);
+				if (q == m_end)
+				{
+					return false;
+				}
+				if (*q == '"')
+				{
+					out = std::string_view(start, static_cast<size_t>(q - start));
+					m_p = q + 1;
+					return true;
+				}
+				if (m_end - q < 2)
+				{
+					return false;
+				}
+				m_p = q + 2; // the escaped character can never end the string
+			}
+		}
+
+		/**
+		 * Reads a number or literal (true, false, null) starting at the cursor.
+		 *
+		 * @param out Receives the token.
+		 * @return false if there is no token at the cursor.
+		 */
+		bool ReadScalar(std::string_view& out) noexcept
+		{
+			const char* start = m_p;
+			while (m_p < m_end)
+			{
+				const char c = *m_p;
+				if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.')
+				{
+					++m_p;
+				}
+				else
+				{
+					break;
+				}
+			}
+			out = std::string_view(start, static_cast<size_t>(m_p - start));
+			return !out.empty();
+		}
+
+		/**
+		 * Skips the value starting at the cursor without materializing it.
+		 *
+		 * @return false if the value is malformed.
+		 */
+		bool SkipValue() noexcept
+		{
+			std::string_view ignored;
+			switch (Peek())
+			{
+			case '"':
+				return ReadString(ignored);
+			case '{':
+			case '[':
+				return SkipContainer();
+			default:
+				return ReadScalar(ignored);
+			}
+		}
+
+		/**
+		 * Visits the members of the object starting at the cursor.
+		 *
+		 * @param onMember Called with each raw key and the cursor on its value; must consume the value.
+		 * @return false if the object or a visited value is malformed.
+		 */
+		template <typename F>
+		bool ForEachMember(F&& onMember)
+		{
+			++m_p;
+			for (;;)
+			{
+				if (!SkipTrivia())
+				{
+					return false;
+				}
+				if (Peek() == '}')
+				{
+					++m_p; // empty object, or a trailing comma before the brace
+					return true;
+				}
+				std::string_view key;
+				if (Peek() != '"' || !ReadString(key) || !SkipTrivia() || Peek() != ':')
+				{
+					return false;
+				}
+				++m_p;
+				if (!SkipTrivia() || !onMember(key) || !SkipTrivia())
+				{
+					return false;
+				}
+				if (Peek() == ',')
+				{
+					++m_p;
+					continue;
+				}
+				if (Peek() == '}')
+				{
+					++m_p;
+					return true;
+				}
+				return false;
+			}
+		}
+
+		/**
+		 * Visits the elements of the array starting at the cursor.
+		 *
+		 * @param onElement Called with the cursor on each element; must consume the element.
+		 * @return false if the array or a visited element is malformed.
+		 */
+		template <typename F>
+		bool ForEachElement(F&& onElement)
+		{
+			++m_p;
+			for (;;)
+			{
+				if (!SkipTrivia())
+				{
+					return false;
+				}
+				if (Peek() == ']')
+				{
+					++m_p;
+					return true;
+				}
+				if (!onElement() || !SkipTrivia())
+				{
+					return false;
+				}
+				if (Peek() == ',')
+				{
+					++m_p;
+					continue;
+				}
+				if (Peek() == ']')
+				{
+					++m_p;
+					return true;
+				}
+				return false;
+			}
+		}
+
+	private:
+		bool SkipBlockComment() noexcept
+		{
+			const char* q = m_p + 2;
+			for (;;)
+			{
+				q = FindFirst<'*'>(q, m_end);
+				if (m_end - q < 2)
+				{
+					return false;
+				}
+				if (q[1] == '/')
+				{
+					m_p = q + 2;
+					return true;
+				}
+				++q;
+			}
+		}
+
+		/**
+		 * Skips a whole object or array by jumping from one structural byte to the next.
+		 *
+		 * Only quotes, brackets and comment starts are inspected; everything in between is passed
+		 * over sixteen bytes at a time.
+		 */
+		bool SkipContainer() noexcept
+		{
+			size_t depth = 0;
+			for (;;)
+			{
+				const char* q = FindFirst<'"', '{', '}', '[', ']', '/'>(m_p, m_end);
+				if (q == m_end)
+				{
+					return false;
+				}
+				m_p = q;
+				switch (*q)
+				{
+				case '"':
+				{
+					std::string_view ignored;
+					if (!ReadString(ignored))
+					{
+						return false;
+					}
+					break;
+				}
+				case '/':
+				{
+					const char* before = m_p;
+					if (!SkipTrivia() || m_p == before)
+					{
+						return false; // a lone '/' is not a comment
+					}
+					break;
+				}
+				case '{':
+				case '[':
+					++depth;
+					++m_p;
+					break;
+				default:
+					++m_p;
+					if (--depth == 0)
+					{
+						return true;
+					}
+					break;
+				}
+			}
+		}
+
+		const char* m_p;
+		const char* m_end;
+	};
+
+	/**
+	 * Compares a raw key with an ASCII name, decoding the key only if it contains escapes.
+	 */
+	bool KeyIs(std::string_view key, std::string_view name)
+	{
+		if (key.find('\\') == std::string_view::npos)
+		{
+			return key == name;
+		}
+		std::u16string decoded;
+		if (!SettingsProfileScanner::Decode(key, decoded) || decoded.size() != name.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < name.size(); ++i)
+		{
+			if (decoded[i] != static_cast<char16_t>(name[i]))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Reads a string member, treating null and non-string values as missing (last one wins).
+	 */
+	bool ReadStringField(Scanner& scanner, std::string_view& field)
+	{
+		field = std::string_view();
+		if (scanner.Peek() == '"')
+		{
+			return scanner.ReadString(field);
+		}
+		return scanner.SkipValue();
+	}
+
+	bool ReadProfile(Scanner& scanner, SettingsProfileFields& profile)
+	{
+		return scanner.ForEachMember([&](std::string_view key)
+			{
+				if (KeyIs(key, "name"))
+				{
+					return ReadStringField(scanner, profile.name);
+				}
+				if (KeyIs(key, "icon"))
+				{
+					return ReadStringField(scanner, profile.icon);
+				}
+				if (KeyIs(key, "source"))
+				{
+					return ReadStringField(scanner, profile.source);
+				}
+				if (KeyIs(key, "guid"))
+				{
+					return ReadStringField(scanner, profile.guid);
+				}
+				if (KeyIs(key, "hidden"))
+				{
+					std::string_view token;
+					profile.hidden = false;
+					if (scanner.Peek() == '"' || scanner.Peek() == '{' || scanner.Peek() == '[')
+					{
+						return scanner.SkipValue();
+					}
+					if (!scanner.ReadScalar(token))
+					{
+						return false;
+					}
+					profile.hidden = token == "true";
+					return true;
+				}
+				return scanner.SkipValue();
+			});
+	}
+
+	bool ReadProfileList(Scanner& scanner, std::vector<SettingsProfileFields>& profiles)
+	{
+		profiles.clear(); // a repeated key replaces the earlier list
+		return scanner.ForEachElement([&]()
+			{
+				if (scanner.Peek() != '{')
+				{
+					return scanner.SkipValue();
+				}
+				SettingsProfileFields profile{};
+				if (!ReadProfile(scanner, profile))
+				{
+					return false;
+				}
+				profiles.push_back(profile);
+				return true;
+			});
+	}
+
+	/**
+	 * Appends a code point as UTF-16.
+	 */
+	void AppendCodePoint(std::u16string& out, uint32_t cp)
+	{
+		if (cp < 0x10000)
+		{
+			out.push_back(static_cast<char16_t>(cp));
+		}
+		else
+		{
+			cp -= 0x10000;
+			out.push_back(static_cast<char16_t>(0xD800 + (cp >> 10)));
+			out.push_back(static_cast<char16_t>(0xDC00 + (cp & 0x3FF)));
+		}
+	}
+
+	bool ParseHex4(const char* p, uint32_t& value)
+	{
+		value = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			const char c = p[i];
+			value <<= 4;
+			if (c >= '0' && c <= '9')
+			{
+				value |= static_cast<uint32_t>(c - '0');
+			}
+			else if (c >= 'a' && c <= 'f')
+			{
+				value |= static_cast<uint32_t>(c - 'a' + 10);
+			}
+			else if (c >= 'A' && c <= 'F')
+			{
+				value |= static_cast<uint32_t>(c - 'A' + 10);
+			}
+			else
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Decodes one UTF-8 sequence.
+	 *
+	 * @param p Start of the sequence; advanced past it (or past one byte if it is malformed).
+	 * @param end End of the input.
+	 * @return The code point, or U+FFFD for a malformed, overlong or surrogate sequence.
+	 */
+	uint32_t DecodeUtf8(const unsigned char*& p, const unsigned char* end)
+	{
+		const unsigned char lead = *p++;
+		size_t extra;
+		uint32_t cp;
+		uint32_t minimum;
+		if (lead >= 0xF0 && lead <= 0xF4)
+		{
+			extra = 3;
+			cp = lead & 0x07u;
+			minimum = 0x10000;
+		}
+		else if (lead >= 0xE0 && lead <= 0xEF)
+		{
+			extra = 2;
+			cp = lead & 0x0Fu;
+			minimum = 0x800;
+		}
+		else if (lead >= 0xC2 && lead <= 0xDF)
+		{
+			extra = 1;
+			cp = lead & 0x1Fu;
+			minimum = 0x80;
+		}
+		else
+		{
+			return 0xFFFD;
+		}
+
+		if (static_cast<size_t>(end - p) < extra)
+		{
+			return 0xFFFD;
+		}
+		for (size_t i = 0; i < extra; ++i)
+		{
+			if ((p[i] & 0xC0) != 0x80)
+			{
+				return 0xFFFD;
+			}
+			cp = (cp << 6) | (p[i] & 0x3Fu);
+		}
+		if (cp < minimum || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+		{
+			return 0xFFFD;
+		}
+		p += extra;
+		return cp;
+	}
+}
+
+/**
+ * Extracts name, hidden, icon, source and guid of every profile in profiles.list.
+ *
+ * Walks the root object member by member; "profiles" is entered, everything else is skipped as a
+ * whole. Inside profiles.list only the five fields are read, as views into the input.
+ *
+ * @param data The settings.json contents.
+ * @param size Size in bytes.
+ * @param profiles Receives the profiles in file order.
+ * @return false if the document is malformed; profiles is then left in an unspecified state.
+ */
+bool SettingsProfileScanner::Extract(const uint8_t* data, size_t size, std::vector<SettingsProfileFields>& profiles)
+{
+	profiles.clear();
+	const char* begin = reinterpret_cast<const char*>(data);
+	const char* end = begin + size;
+	if (size >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF)
+	{
+		begin += 3;
+	}
+
+	Scanner scanner(begin, end);
+	if (!scanner.SkipTrivia() || scanner.Peek() != '{')
+	{
+		return false;
+	}
+
+	const bool ok = scanner.ForEachMember([&](std::string_view key)
+		{
+			if (!KeyIs(key, "profiles"))
+			{
+				return scanner.SkipValue();
+			}
+			profiles.clear();
+			switch (scanner.Peek())
+			{
+			case '[':
+				return ReadProfileList(scanner, profiles); // legacy: "profiles" is the list itself
+			case '{':
+				return scanner.ForEachMember([&](std::string_view profilesKey)
+					{
+						if (KeyIs(profilesKey, "list") && scanner.Peek() == '[')
+						{
+							return ReadProfileList(scanner, profiles);
+						}
+						return scanner.SkipValue();
+					});
+			default:
+				return scanner.SkipValue();
+			}
+		});
+
+	return ok && scanner.SkipTrivia() && scanner.AtEnd();
+}
+
+/**
+ * Decodes the raw contents of a JSON string (UTF-8 with escape sequences) into UTF-16.
+ *
+ * @param raw The raw string contents.
+ * @param out Receives the decoded text.
+ * @return false if an escape sequence is invalid.
+ */
+bool SettingsProfileScanner::Decode(std::string_view raw, std::u16string& out)
+{
+	out.clear();
+	out.reserve(raw.size());
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(raw.data());
+	const unsigned char* end = p + raw.size();
+	while (p < end)
+	{
+		const unsigned char c = *p;
+		if (c < 0x80 && c != '\\')
+		{
+			out.push_back(static_cast<char16_t>(c));
+			++p;
+			continue;
+		}
+		if (c >= 0x80)
+		{
+			AppendCodePoint(out, DecodeUtf8(p, end));
+			continue;
+		}
+
+		if (end - p < 2)
+		{
+			return false;
+		}
+		const char escape = static_cast<char>(p[1]);
+		p += 2;
+		switch (escape)
+		{
+		case '"': out.push_back(u'"'); break;
+		case '\\': out.push_back(u'\\'); break;
+		case '/': out.push_back(u'/'); break;
+		case 'b': out.push_back(u'\b'); break;
+		case 'f': out.push_back(u'\f'); break;
+		case 'n': out.push_back(u'\n'); break;
+		case 'r': out.push_back(u'\r'); break;
+		case 't': out.push_back(u'\t'); break;
+		case 'u':
+		{
+			uint32_t unit;
+			if (end - p < 4 || !ParseHex4(reinterpret_cast<const char*>(p), unit))
+			{
+				return false;
+			}
+			p += 4;
+			out.push_back(static_cast<char16_t>(unit)); // surrogate pairs arrive as two escapes
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// The fields of one settings.json profile that the layout manager uses.
+		/// </summary>
+		/// <remarks>
+		/// String members are the raw contents between the quotes, pointing into the scanned buffer;
+		/// escape sequences are left in place (see SettingsProfileScanner::Decode). A member whose
+		/// data pointer is null was missing, null or not a string.
+		/// </remarks>
+		struct SettingsProfileFields
+		{
+			std::string_view name;
+			std::string_view icon;
+			std::string_view source;
+			std::string_view guid;
+			bool hidden;
+		};
+
+		/// <summary>
+		/// On-demand reader of profiles.list in a Windows Terminal settings.json.
+		/// </summary>
+		/// <remarks>
+		/// Only the path root / "profiles" / "list" / [*] is descended into; every other value
+		/// (schemes, actions, themes, profile properties that are not needed, ...) is skipped as a
+		/// whole by a vectorized search for the next structural byte, without materializing it.
+		/// Comments and trailing commas are accepted, matching TerminalJsonOptions. The legacy
+		/// layout where "profiles" is directly an array is accepted as well.
+		/// </remarks>
+		class SettingsProfileScanner
+		{
+		public:
+			/// <summary>
+			/// Extracts the profiles from a UTF-8 settings.json image.
+			/// </summary>
+			/// <param name="data">The file contents; a leading UTF-8 BOM is skipped.</param>
+			/// <param name="size">Size of the contents in bytes.</param>
+			/// <param name="profiles">Receives one entry per object in profiles.list, in file order.</param>
+			/// <returns>false if the visited part of the document is malformed.</returns>
+			/// <remarks>
+			/// Skipped subtrees are only checked for balanced brackets, terminated strings and
+			/// terminated comments; callers that need strict validation must parse the document fully.
+			/// </remarks>
+			WINAPIHELPERS_API static bool Extract(const uint8_t* data, size_t size, std::vector<SettingsProfileFields>& profiles);
+
+			/// <summary>
+			/// Decodes the raw contents of a JSON string into UTF-16.
+			/// </summary>
+			/// <param name="raw">A view returned by Extract.</param>
+			/// <param name="out">Receives the decoded text.</param>
+			/// <returns>false if an escape sequence is invalid; malformed UTF-8 decodes to U+FFFD.</returns>
+			WINAPIHELPERS_API static bool Decode(std::string_view raw, std::u16string& out);
+		};
+
+	}
+} // namespace WTLayoutManager::Services
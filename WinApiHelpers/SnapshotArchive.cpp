@@ -0,0 +1,814 @@
+﻿#include "pch.h"
+#include "SnapshotArchive.h"
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	// --------------------------------------------------------------------------
+	// Block codec
+	//
+	// A block is a sequence of (literals, match) pairs. Each starts with a token byte whose high nibble
+	// is the literal count and low nibble the match length minus MinMatch; a nibble of 15 is continued
+	// by bytes of 255 and a final byte below 255. The literals follow, then the little-endian 16-bit
+	// match offset and the match length continuation. The last pair has literals only.
+
+	constexpr size_t MinMatch = 4;
+	constexpr size_t LastLiterals = 5;      // the final bytes are always literals
+	constexpr size_t MatchSearchLimit = 12; // no match starts this close to the end
+	constexpr size_t MaxOffset = 65535;
+	constexpr int HashBits = 14;
+
+	inline uint32_t Read32(const uint8_t* p) noexcept
+	{
+		uint32_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	inline uint32_t HashSequence(uint32_t sequence) noexcept
+	{
+		return (sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	void PutLength(std::string& out, size_t length)
+	{
+		for (; length >= 255; length -= 255)
+		{
+			out.push_back(static_cast<char>(255));
+		}
+		out.push_back(static_cast<char>(length));
+	}
+
+	void PutSequence(std::string& out, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength)
+	{
+		const size_t matchCode = matchLength ? matchLength - MinMatch : 0;
+		out.push_back(static_cast<char>(((literalCount < 15 ? literalCount : 15) << 4) | (matchCode < 15 ? matchCode : 15)));
+		if (literalCount >= 15)
+		{
+			PutLength(out, literalCount - 15);
+		}
+		out.append(reinterpret_cast<const char*>(literals), literalCount);
+		if (matchLength)
+		{
+			out.push_back(static_cast<char>(offset & 0xFF));
+			out.push_back(static_cast<char>(offset >> 8));
+			if (matchCode >= 15)
+			{
+				PutLength(out, matchCode - 15);
+			}
+		}
+	}
+
+	bool GetLength(const uint8_t*& p, const uint8_t* end, size_t& length) noexcept
+	{
+		for (;;)
+		{
+			if (p == end)
+			{
+				return false;
+			}
+			const uint8_t b = *p++;
+			length += b;
+			if (b != 255)
+			{
+				return true;
+			}
+		}
+	}
+
+	// --------------------------------------------------------------------------
+	// File format
+
+	struct ArchiveHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t reserved;
+	};
+
+	struct IndexHeader
+	{
+		uint32_t blockCount;
+		uint32_t folderCount;
+		uint32_t fileCount;
+		uint32_t stringLength;  // in char16_t
+	};
+
+	struct BlockRecord
+	{
+		uint64_t offset;
+		uint32_t compressedSize;
+		uint32_t rawSize;
+		uint64_t hash;          // of the compressed bytes
+	};
+
+	struct FolderRecord
+	{
+		uint32_t nameOffset;    // in char16_t, into the string table
+		uint32_t nameLength;
+		uint32_t firstFile;
+		uint32_t fileCount;
+	};
+
+	struct FileRecord
+	{
+		uint32_t nameOffset;
+		uint32_t nameLength;
+		uint32_t block;
+		uint32_t offset;        // inside the decompressed block
+		uint32_t length;
+		uint32_t reserved;
+		uint64_t contentHash;
+		int64_t lastWriteTime;
+	};
+
+	struct ArchiveFooter
+	{
+		uint64_t indexOffset;
+		uint64_t indexSize;
+		uint64_t indexHash;
+		uint32_t version;
+		uint32_t magic;
+	};
+
+	static_assert(sizeof(ArchiveHeader) == 16 && sizeof(IndexHeader) == 16 && sizeof(BlockRecord) == 24 &&
+		sizeof(FolderRecord) == 16 && sizeof(FileRecord) == 40 && sizeof(ArchiveFooter) == 32, "archive layout");
+
+	// std::chrono::clock_cast is not available everywhere, so file times are converted through the offset
+	// between the two clocks now; the error is far below the stored millisecond resolution.
+	std::chrono::system_clock::duration FileClockOffset()
+	{
+		const auto file = std::filesystem::file_time_type::clock::now();
+		const auto system = std::chrono::system_clock::now();
+		return system.time_since_epoch() -
+			std::chrono::duration_cast<std::chrono::system_clock::duration>(file.time_since_epoch());
+	}
+
+	int64_t ToUnixMilliseconds(std::filesystem::file_time_type time)
+	{
+		const auto system = std::chrono::duration_cast<std::chrono::system_clock::duration>(time.time_since_epoch()) + FileClockOffset();
+		return std::chrono::duration_cast<std::chrono::milliseconds>(system).count();
+	}
+
+	std::filesystem::file_time_type FromUnixMilliseconds(int64_t milliseconds)
+	{
+		const auto file = std::chrono::milliseconds(milliseconds) - FileClockOffset();
+		return std::filesystem::file_time_type(
+			std::chrono::duration_cast<std::filesystem::file_time_type::duration>(file));
+	}
+
+	/**
+	 * Checks a stored name; names must be plain file names so extraction cannot escape the target folder.
+	 */
+	bool ValidName(std::u16string_view name) noexcept
+	{
+		if (name.empty() || name == u"." || name == u"..")
+		{
+			return false;
+		}
+		for (const char16_t c : name)
+		{
+			if (c < 0x20 || c == u'/' || c == u'\\' || c == u':')
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+/**
+ * Compresses a buffer with a greedy LZ77 parse over a hash table of 4-byte sequences.
+ *
+ * @param data The bytes to compress.
+ * @param size Number of bytes.
+ * @param compressed Receives the compressed bytes (replaced).
+ */
+void SnapshotArchive::Compress(const void* data, size_t size, std::string& compressed)
+{
+	const uint8_t* const src = static_cast<const uint8_t*>(data);
+	compressed.clear();
+	compressed.reserve(size / 2 + 16);
+
+	size_t anchor = 0;
+	if (size > MatchSearchLimit)
+	{
+		std::vector<uint32_t> table(size_t(1) << HashBits, 0);
+		const size_t searchEnd = size - MatchSearchLimit;
+		const size_t matchEnd = size - LastLiterals;
+		size_t pos = 1;
+		while (pos < searchEnd)
+		{
+			const uint32_t sequence = Read32(src + pos);
+			uint32_t& slot = table[HashSequence(sequence)];
+			size_t candidate = slot;
+			slot = static_cast<uint32_t>(pos);
+			if (pos - candidate > MaxOffset || Read32(src + candidate) != sequence)
+			{
+				// Skip faster through data that does not compress.
+				pos += 1 + ((pos - anchor) >> 6);
+				continue;
+			}
+
+			while (pos > anchor && candidate > 0 && src[pos - 1] == src[candidate - 1])
+			{
+				--pos;
+				--candidate;
+			}
+			size_t length = MinMatch;
+			while (pos + length < matchEnd && src[pos + length] == src[candidate + length])
+			{
+				++length;
+			}
+
+			PutSequence(compressed, src + anchor, pos - anchor, pos - candidate, length);
+			pos += length;
+			anchor = pos;
+			if (pos < searchEnd)
+			{
+				table[HashSequence(Read32(src + pos - 2))] = static_cast<uint32_t>(pos - 2);
+			}
+		}
+	}
+	PutSequence(compressed, src + anchor, size - anchor, 0, 0);
+}
+
+/**
+ * Decompresses a block, checking every length and offset against the buffers.
+ *
+ * @param data The compressed bytes.
+ * @param size Number of compressed bytes.
+ * @param rawSize The exact decompressed size.
+ * @param raw Receives the decompressed bytes (replaced).
+ * @return false if the block is malformed.
+ */
+bool SnapshotArchive::Decompress(const void* data, size_t size, size_t rawSize, std::string& raw)
+{
+	raw.assign(rawSize, '\0');
+	const uint8_t* p = static_cast<const uint8_t*>(data);
+	const uint8_t* const end = p + size;
+	uint8_t* const out = reinterpret_cast<uint8_t*>(raw.data());
+	size_t written = 0;
+
+	while (p < end)
+	{
+		const uint8_t token = *p++;
+		size_t literals = token >> 4;
+		if (literals == 15 && !GetLength(p, end, literals))
+		{
+			return false;
+		}
+		if (literals > static_cast<size_t>(end - p) || literals > rawSize - written)
+		{
+			return false;
+		}
+		std::memcpy(out + written, p, literals);
+		p += literals;
+		written += literals;
+		if (p == end)
+		{
+			break; // the last sequence has no match
+		}
+
+		if (end - p < 2)
+		{
+			return false;
+		}
+		const size_t offset = p[0] | (static_cast<size_t>(p[1]) << 8);
+		p += 2;
+		size_t length = token & 15;
+		if (length == 15 && !GetLength(p, end, length))
+		{
+			return false;
+		}
+		length += MinMatch;
+		if (offset == 0 || offset > written || length > rawSize - written)
+		{
+			return false;
+		}
+		const uint8_t* from = out + written - offset;
+		if (offset >= length)
+		{
+			std::memcpy(out + written, from, length);
+		}
+		else
+		{
+			for (size_t i = 0; i < length; ++i)
+			{
+				out[written + i] = from[i];
+			}
+		}
+		written += length;
+	}
+	return written == rawSize;
+}
+
+// --------------------------------------------------------------------------
+
+struct SnapshotArchiveWriter::State
+{
+	std::filesystem::path target;
+	std::filesystem::path temp;
+	std::ofstream out;
+	uint64_t offset = 0;
+	std::vector<BlockRecord> blocks;
+	std::vector<FolderRecord> folders;
+	std::vector<FileRecord> files;
+	std::u16string strings;
+	std::unordered_multimap<uint64_t, size_t> byHash;   // content hash -> file record
+	bool committed = false;
+
+	uint32_t AddString(std::u16string_view s)
+	{
+		const uint32_t at = static_cast<uint32_t>(strings.size());
+		strings.append(s);
+		return at;
+	}
+
+	/**
+	 * Reads back a block already written to the archive.
+	 */
+	bool LoadBlock(uint32_t block, std::string& raw)
+	{
+		const BlockRecord& record = blocks[block];
+		out.flush();
+		std::ifstream in(temp, std::ios::binary);
+		std::string compressed(record.compressedSize, '\0');
+		in.seekg(static_cast<std::streamoff>(record.offset));
+		in.read(compressed.data(), static_cast<std::streamsize>(compressed.size()));
+		return in && SnapshotArchive::Decompress(compressed.data(), compressed.size(), record.rawSize, raw);
+	}
+
+	bool Write(const void* data, size_t size)
+	{
+		out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		offset += size;
+		return static_cast<bool>(out);
+	}
+};
+
+SnapshotArchiveWriter::SnapshotArchiveWriter()
+	: m_state(std::make_unique<State>())
+{
+}
+
+SnapshotArchiveWriter::~SnapshotArchiveWriter()
+{
+	if (m_state->out.is_open())
+	{
+		m_state->out.close();
+	}
+	if (!m_state->committed && !m_state->temp.empty())
+	{
+		std::error_code ignored;
+		std::filesystem::remove(m_state->temp, ignored);
+	}
+}
+
+/**
+ * Starts an archive in a temporary file next to the target.
+ *
+ * @param archive The archive to create or replace.
+ * @param ec Receives the error.
+ * @return true on success.
+ */
+bool SnapshotArchiveWriter::Create(const std::filesystem::path& archive, std::error_code& ec)
+{
+	ec.clear();
+	State& s = *m_state;
+	s.target = archive;
+	s.temp = archive;
+	s.temp += ".tmp";
+	s.out.open(s.temp, std::ios::binary | std::ios::trunc);
+	const ArchiveHeader header{ SnapshotArchive::Magic, SnapshotArchive::Version, 0 };
+	if (!s.out || !s.Write(&header, sizeof(header)))
+	{
+		ec = std::make_error_code(std::errc::io_error);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Adds a folder: its new contents become one compressed block, contents already in the archive are
+ * referenced instead.
+ *
+ * @param name The folder name stored in the archive.
+ * @param folder The folder to read.
+ * @param fileNames The file names, relative to the folder.
+ * @param fileCount Number of file names.
+ * @param ec Receives the error.
+ * @return true on success.
+ */
+bool SnapshotArchiveWriter::AddFolder(
+	std::u16string_view name,
+	const std::filesystem::path& folder,
+	const std::u16string_view* fileNames,
+	size_t fileCount,
+	std::error_code& ec)
+{
+	ec.clear();
+	State& s = *m_state;
+	if (!s.out.is_open() || !ValidName(name))
+	{
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+
+	FolderRecord folderRecord{ s.AddString(name), static_cast<uint32_t>(name.size()), static_cast<uint32_t>(s.files.size()), 0 };
+	const uint32_t newBlock = static_cast<uint32_t>(s.blocks.size());
+	std::string raw;
+	std::string earlier;
+	uint32_t earlierBlock = UINT32_MAX;
+
+	for (size_t i = 0; i < fileCount; ++i)
+	{
+		if (!ValidName(fileNames[i]))
+		{
+			ec = std::make_error_code(std::errc::invalid_argument);
+			return false;
+		}
+		const std::filesystem::path path = folder / std::filesystem::path(std::u16string(fileNames[i]));
+		MappedFile file;
+		if (!file.Open(path))
+		{
+			continue;
+		}
+		std::error_code timeError;
+		const auto writeTime = std::filesystem::last_write_time(path, timeError);
+		const std::string_view content(reinterpret_cast<const char*>(file.data()), file.size());
+
+		FileRecord record{};
+		record.nameOffset = s.AddString(fileNames[i]);
+		record.nameLength = static_cast<uint32_t>(fileNames[i].size());
+		record.length = static_cast<uint32_t>(content.size());
+		record.contentHash = ContentHash::Hash64(content.data(), content.size());
+		record.lastWriteTime = timeError ? 0 : ToUnixMilliseconds(writeTime);
+
+		// Reuse identical contents stored before, after comparing the bytes.
+		bool found = false;
+		const auto range = s.byHash.equal_range(record.contentHash);
+		for (auto it = range.first; it != range.second && !found; ++it)
+		{
+			const FileRecord& other = s.files[it->second];
+			if (other.length != record.length)
+			{
+				continue;
+			}
+			const std::string* block = &raw;
+			if (other.block != newBlock)
+			{
+				if (other.block != earlierBlock && !s.LoadBlock(other.block, earlier))
+				{
+					continue;
+				}
+				earlierBlock = other.block;
+				block = &earlier;
+			}
+			if (std::string_view(*block).substr(other.offset, other.length) == content)
+			{
+				record.block = other.block;
+				record.offset = other.offset;
+				found = true;
+			}
+		}
+		if (!found)
+		{
+			record.block = newBlock;
+			record.offset = static_cast<uint32_t>(raw.size());
+			raw.append(content);
+			s.byHash.emplace(record.contentHash, s.files.size());
+		}
+		s.files.push_back(record);
+		++folderRecord.fileCount;
+	}
+
+	if (!raw.empty())
+	{
+		std::string compressed;
+		SnapshotArchive::Compress(raw.data(), raw.size(), compressed);
+		const BlockRecord block{ s.offset, static_cast<uint32_t>(compressed.size()), static_cast<uint32_t>(raw.size()),
+			ContentHash::Hash64(compressed.data(), compressed.size()) };
+		if (!s.Write(compressed.data(), compressed.size()))
+		{
+			ec = std::make_error_code(std::errc::io_error);
+			return false;
+		}
+		s.blocks.push_back(block);
+	}
+	s.folders.push_back(folderRecord);
+	return true;
+}
+
+/**
+ * Appends the index and the footer, then renames the archive over the target.
+ *
+ * @param ec Receives the error.
+ * @return true on success.
+ */
+bool SnapshotArchiveWriter::Commit(std::error_code& ec)
+{
+	ec.clear();
+	State& s = *m_state;
+	if (!s.out.is_open())
+	{
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+
+	const IndexHeader header{ static_cast<uint32_t>(s.blocks.size()), static_cast<uint32_t>(s.folders.size()),
+		static_cast<uint32_t>(s.files.size()), static_cast<uint32_t>(s.strings.size()) };
+	std::string index;
+	index.append(reinterpret_cast<const char*>(&header), sizeof(header));
+	index.append(reinterpret_cast<const char*>(s.blocks.data()), s.blocks.size() * sizeof(BlockRecord));
+	index.append(reinterpret_cast<const char*>(s.folders.data()), s.folders.size() * sizeof(FolderRecord));
+	index.append(reinterpret_cast<const char*>(s.files.data()), s.files.size() * sizeof(FileRecord));
+	index.append(reinterpret_cast<const char*>(s.strings.data()), s.strings.size() * sizeof(char16_t));
+
+	const ArchiveFooter footer{ s.offset, index.size(), ContentHash::Hash64(index.data(), index.size()),
+		SnapshotArchive::Version, SnapshotArchive::Magic };
+	const bool written = s.Write(index.data(), index.size()) && s.Write(&footer, sizeof(footer));
+	s.out.close();
+	if (!written || s.out.fail())
+	{
+		ec = std::make_error_code(std::errc::io_error);
+		return false;
+	}
+
+	std::filesystem::rename(s.temp, s.target, ec);
+	if (ec)
+	{
+		return false;
+	}
+	s.committed = true;
+	return true;
+}
+
+// --------------------------------------------------------------------------
+
+struct SnapshotArchiveReader::State
+{
+	MappedFile file;
+	std::vector<BlockRecord> blocks;
+	std::vector<FolderRecord> folders;
+	std::vector<FileRecord> files;
+	std::u16string strings;
+
+	// The last decompressed block, so the files of one folder decompress their block once.
+	mutable uint32_t cachedBlock = UINT32_MAX;
+	mutable std::string cached;
+
+	std::u16string_view String(uint32_t offset, uint32_t length) const
+	{
+		return std::u16string_view(strings).substr(offset, length);
+	}
+
+	bool LoadBlock(uint32_t block, std::error_code& ec) const
+	{
+		if (block == cachedBlock)
+		{
+			return true;
+		}
+		cachedBlock = UINT32_MAX;
+		const BlockRecord& record = blocks[block];
+		const uint8_t* data = file.data() + record.offset;
+		if (ContentHash::Hash64(data, record.compressedSize) != record.hash ||
+			!SnapshotArchive::Decompress(data, record.compressedSize, record.rawSize, cached))
+		{
+			ec = std::make_error_code(std::errc::illegal_byte_sequence);
+			return false;
+		}
+		cachedBlock = block;
+		return true;
+	}
+};
+
+SnapshotArchiveReader::SnapshotArchiveReader()
+	: m_state(std::make_unique<State>())
+{
+}
+
+SnapshotArchiveReader::~SnapshotArchiveReader() = default;
+
+/**
+ * Maps an archive and loads its index, checking that every record points inside the file.
+ *
+ * @param archive The archive.
+ * @param ec Receives the error.
+ * @return true on success.
+ */
+bool SnapshotArchiveReader::Open(const std::filesystem::path& archive, std::error_code& ec)
+{
+	ec.clear();
+	State& s = *m_state;
+	s.file.Close();
+	s.blocks.clear();
+	s.folders.clear();
+	s.files.clear();
+	s.strings.clear();
+	s.cachedBlock = UINT32_MAX;
+
+	if (!s.file.Open(archive))
+	{
+		ec = std::make_error_code(std::errc::no_such_file_or_directory);
+		return false;
+	}
+	const uint8_t* data = s.file.data();
+	const uint64_t size = s.file.size();
+	const auto invalid = [&ec]() {
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	};
+
+	ArchiveHeader header;
+	ArchiveFooter footer;
+	if (size < sizeof(header) + sizeof(footer))
+	{
+		return invalid();
+	}
+	std::memcpy(&header, data, sizeof(header));
+	std::memcpy(&footer, data + size - sizeof(footer), sizeof(footer));
+	if (header.magic != SnapshotArchive::Magic || header.version != SnapshotArchive::Version ||
+		footer.magic != SnapshotArchive::Magic || footer.version != SnapshotArchive::Version ||
+		footer.indexOffset < sizeof(header) || footer.indexOffset > size - sizeof(footer) ||
+		footer.indexSize != size - sizeof(footer) - footer.indexOffset || footer.indexSize < sizeof(IndexHeader) ||
+		ContentHash::Hash64(data + footer.indexOffset, footer.indexSize) != footer.indexHash)
+	{
+		return invalid();
+	}
+
+	const uint8_t* p = data + footer.indexOffset;
+	IndexHeader index;
+	std::memcpy(&index, p, sizeof(index));
+	const uint64_t expected = sizeof(index) + uint64_t(index.blockCount) * sizeof(BlockRecord) +
+		uint64_t(index.folderCount) * sizeof(FolderRecord) + uint64_t(index.fileCount) * sizeof(FileRecord) +
+		uint64_t(index.stringLength) * sizeof(char16_t);
+	if (expected != footer.indexSize)
+	{
+		return invalid();
+	}
+	p += sizeof(index);
+	s.blocks.resize(index.blockCount);
+	s.folders.resize(index.folderCount);
+	s.files.resize(index.fileCount);
+	s.strings.resize(index.stringLength);
+	const auto take = [&p](void* to, size_t bytes) {
+		if (bytes)
+		{
+			std::memcpy(to, p, bytes);
+			p += bytes;
+		}
+	};
+	take(s.blocks.data(), s.blocks.size() * sizeof(BlockRecord));
+	take(s.folders.data(), s.folders.size() * sizeof(FolderRecord));
+	take(s.files.data(), s.files.size() * sizeof(FileRecord));
+	take(s.strings.data(), s.strings.size() * sizeof(char16_t));
+
+	for (const BlockRecord& block : s.blocks)
+	{
+		if (block.offset < sizeof(header) || block.offset > footer.indexOffset ||
+			block.compressedSize > footer.indexOffset - block.offset)
+		{
+			return invalid();
+		}
+	}
+	for (const FolderRecord& folder : s.folders)
+	{
+		if (uint64_t(folder.nameOffset) + folder.nameLength > s.strings.size() ||
+			uint64_t(folder.firstFile) + folder.fileCount > s.files.size() ||
+			!ValidName(s.String(folder.nameOffset, folder.nameLength)))
+		{
+			return invalid();
+		}
+	}
+	for (const FileRecord& file : s.files)
+	{
+		if (uint64_t(file.nameOffset) + file.nameLength > s.strings.size() || file.block >= s.blocks.size() ||
+			uint64_t(file.offset) + file.length > s.blocks[file.block].rawSize ||
+			!ValidName(s.String(file.nameOffset, file.nameLength)))
+		{
+			return invalid();
+		}
+	}
+	return true;
+}
+
+size_t SnapshotArchiveReader::FolderCount() const
+{
+	return m_state->folders.size();
+}
+
+ArchiveFolder SnapshotArchiveReader::Folder(size_t folder) const
+{
+	const FolderRecord& record = m_state->folders.at(folder);
+	return ArchiveFolder{ m_state->String(record.nameOffset, record.nameLength), record.fileCount };
+}
+
+ArchiveFile SnapshotArchiveReader::File(size_t folder, size_t file) const
+{
+	const FolderRecord& owner = m_state->folders.at(folder);
+	const FileRecord& record = m_state->files.at(owner.firstFile + file);
+	return ArchiveFile{ m_state->String(record.nameOffset, record.nameLength), record.length, record.contentHash, record.lastWriteTime };
+}
+
+/**
+ * Reads one file of a folder.
+ *
+ * @param folder The folder index.
+ * @param file The file index within the folder.
+ * @param content Receives the contents.
+ * @param ec Receives the error.
+ * @return false if the indices are out of range or the data is damaged.
+ */
+bool SnapshotArchiveReader::ReadFile(size_t folder, size_t file, std::string& content, std::error_code& ec) const
+{
+	ec.clear();
+	const State& s = *m_state;
+	if (folder >= s.folders.size() || file >= s.folders[folder].fileCount)
+	{
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+	const FileRecord& record = s.files[s.folders[folder].firstFile + file];
+	if (!s.LoadBlock(record.block, ec))
+	{
+		return false;
+	}
+	content.assign(s.cached, record.offset, record.length);
+	if (ContentHash::Hash64(content.data(), content.size()) != record.contentHash)
+	{
+		ec = std::make_error_code(std::errc::illegal_byte_sequence);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Writes the files of a folder into a target folder, each through a temporary file, keeping their
+ * modification times.
+ *
+ * @param folder The folder index.
+ * @param target The folder to write to.
+ * @param ec Receives the error.
+ * @return true on success.
+ */
+bool SnapshotArchiveReader::Extract(size_t folder, const std::filesystem::path& target, std::error_code& ec) const
+{
+	ec.clear();
+	if (folder >= m_state->folders.size())
+	{
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+	std::filesystem::create_directories(target, ec);
+	if (ec)
+	{
+		return false;
+	}
+
+	std::string content;
+	for (size_t i = 0; i < m_state->folders[folder].fileCount; ++i)
+	{
+		if (!ReadFile(folder, i, content, ec))
+		{
+			return false;
+		}
+		const ArchiveFile file = File(folder, i);
+		const std::filesystem::path path = target / std::filesystem::path(std::u16string(file.name));
+		std::filesystem::path temp = path;
+		temp += ".tmp";
+		{
+			std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+			out.write(content.data(), static_cast<std::streamsize>(content.size()));
+			if (!out)
+			{
+				out.close();
+				std::error_code ignored;
+				std::filesystem::remove(temp, ignored);
+				ec = std::make_error_code(std::errc::io_error);
+				return false;
+			}
+		}
+		if (file.lastWriteTime != 0)
+		{
+			std::error_code ignored;
+			std::filesystem::last_write_time(temp, FromUnixMilliseconds(file.lastWriteTime), ignored);
+		}
+		std::filesystem::rename(temp, path, ec);
+		if (ec)
+		{
+			std::error_code ignored;
+			std::filesystem::remove(temp, ignored);
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,162 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// Layout of a snapshot archive, shared by the writer and the reader.
+		/// </summary>
+		/// <remarks>
+		/// An archive holds many LocalState folders in one file: a header, one compressed block per folder
+		/// with the contents of its files, then the index and a fixed-size footer pointing at it. The index
+		/// lists, per file, its folder, name, block, offset and length inside the decompressed block, and
+		/// XXH64 hash; a file whose contents already occur earlier in the archive (the same settings.json in
+		/// many snapshots) points at the earlier block instead of being stored again. Blocks use a
+		/// self-contained LZ77 codec (LZ4 style: 64 KiB window, token bytes, no entropy coding), so any file
+		/// is read by decompressing only its own block. Hashes of the index, of every block and of every
+		/// file are checked when read.
+		/// </remarks>
+		struct SnapshotArchive
+		{
+			/// <summary>
+			/// Magic value 'WTLA' at the start and the end of the archive.
+			/// </summary>
+			static constexpr uint32_t Magic = 0x414C5457;
+
+			/// <summary>
+			/// Version of the format.
+			/// </summary>
+			static constexpr uint32_t Version = 1;
+
+			/// <summary>
+			/// Compresses a buffer with the archive's block codec.
+			/// </summary>
+			/// <param name="data">The bytes to compress.</param>
+			/// <param name="size">Number of bytes.</param>
+			/// <param name="compressed">Receives the compressed bytes.</param>
+			WINAPIHELPERS_API static void Compress(const void* data, size_t size, std::string& compressed);
+
+			/// <summary>
+			/// Decompresses a block produced by Compress.
+			/// </summary>
+			/// <param name="data">The compressed bytes.</param>
+			/// <param name="size">Number of compressed bytes.</param>
+			/// <param name="rawSize">The exact size of the decompressed data.</param>
+			/// <param name="raw">Receives the decompressed bytes.</param>
+			/// <returns>false if the block is malformed or does not decompress to rawSize bytes.</returns>
+			WINAPIHELPERS_API static bool Decompress(const void* data, size_t size, size_t rawSize, std::string& raw);
+		};
+
+		/// <summary>
+		/// A folder stored in an archive.
+		/// </summary>
+		struct ArchiveFolder
+		{
+			std::u16string_view name;
+			uint32_t fileCount;
+		};
+
+		/// <summary>
+		/// A file stored in an archive.
+		/// </summary>
+		struct ArchiveFile
+		{
+			std::u16string_view name;
+			uint32_t length;
+			uint64_t contentHash;
+			int64_t lastWriteTime;  // milliseconds since the Unix epoch (UTC)
+		};
+
+		/// <summary>
+		/// Writes an archive one folder at a time; memory use is bounded by the largest folder.
+		/// </summary>
+		class SnapshotArchiveWriter
+		{
+		public:
+			WINAPIHELPERS_API SnapshotArchiveWriter();
+
+			/// <summary>
+			/// Discards an archive that was not committed.
+			/// </summary>
+			WINAPIHELPERS_API ~SnapshotArchiveWriter();
+
+			SnapshotArchiveWriter(const SnapshotArchiveWriter&) = delete;
+			SnapshotArchiveWriter& operator=(const SnapshotArchiveWriter&) = delete;
+
+			/// <summary>
+			/// Starts an archive; it is written next to the target and only replaces it on Commit.
+			/// </summary>
+			WINAPIHELPERS_API bool Create(const std::filesystem::path& archive, std::error_code& ec);
+
+			/// <summary>
+			/// Adds the given files of a folder; missing files are skipped.
+			/// </summary>
+			/// <param name="name">The folder name stored in the archive.</param>
+			/// <param name="folder">The folder to read.</param>
+			/// <param name="fileNames">The file names, relative to the folder.</param>
+			/// <param name="fileCount">Number of file names.</param>
+			/// <param name="ec">Receives the error.</param>
+			WINAPIHELPERS_API bool AddFolder(
+				std::u16string_view name,
+				const std::filesystem::path& folder,
+				const std::u16string_view* fileNames,
+				size_t fileCount,
+				std::error_code& ec);
+
+			/// <summary>
+			/// Writes the index and replaces the target file.
+			/// </summary>
+			WINAPIHELPERS_API bool Commit(std::error_code& ec);
+
+		private:
+			struct State;
+			std::unique_ptr<State> m_state;
+		};
+
+		/// <summary>
+		/// Reads an archive through a memory mapping; only the index is read when it is opened.
+		/// </summary>
+		class SnapshotArchiveReader
+		{
+		public:
+			WINAPIHELPERS_API SnapshotArchiveReader();
+			WINAPIHELPERS_API ~SnapshotArchiveReader();
+
+			SnapshotArchiveReader(const SnapshotArchiveReader&) = delete;
+			SnapshotArchiveReader& operator=(const SnapshotArchiveReader&) = delete;
+
+			/// <summary>
+			/// Opens an archive and checks its index.
+			/// </summary>
+			WINAPIHELPERS_API bool Open(const std::filesystem::path& archive, std::error_code& ec);
+
+			WINAPIHELPERS_API size_t FolderCount() const;
+			WINAPIHELPERS_API ArchiveFolder Folder(size_t folder) const;
+			WINAPIHELPERS_API ArchiveFile File(size_t folder, size_t file) const;
+
+			/// <summary>
+			/// Reads one file, decompressing only the block that holds it.
+			/// </summary>
+			WINAPIHELPERS_API bool ReadFile(size_t folder, size_t file, std::string& content, std::error_code& ec) const;
+
+			/// <summary>
+			/// Writes every file of a folder into a target folder, which is created if needed.
+			/// </summary>
+			WINAPIHELPERS_API bool Extract(size_t folder, const std::filesystem::path& target, std::error_code& ec) const;
+
+		private:
+			struct State;
+			std::unique_ptr<State> m_state;
+		};
+
+	}
+} // namespace WTLayoutManager::Services
@@ -0,0 +1,1136 @@
+﻿#include "pch.h"
+#include "SnapshotHistory.h"
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	// --------------------------------------------------------------------------
+	// JSON tree
+
+	enum class JsonKind : uint8_t
+	{
+		Null,
+		False,
+		True,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	struct JsonMember;
+
+	/// A parsed JSON value. Numbers and strings keep their source text (strings without the quotes and
+	/// with their escapes), so a value is written back exactly as it was read.
+	struct JsonNode
+	{
+		JsonKind kind = JsonKind::Null;
+		std::string text;
+		std::vector<JsonNode> items;
+		std::vector<JsonMember> members;
+	};
+
+	struct JsonMember
+	{
+		std::string key;
+		JsonNode value;
+	};
+
+	constexpr int MaxDepth = 256;
+
+	bool Equal(const JsonNode& a, const JsonNode& b)
+	{
+		if (a.kind != b.kind || a.text != b.text || a.items.size() != b.items.size() || a.members.size() != b.members.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < a.items.size(); ++i)
+		{
+			if (!Equal(a.items[i], b.items[i]))
+			{
+				return false;
+			}
+		}
+		for (size_t i = 0; i < a.members.size(); ++i)
+		{
+			if (a.members[i].key != b.members[i].key || !Equal(a.members[i].value, b.members[i].value))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// Strict JSON parser: comments, trailing commas and a byte order mark are rejected, which makes the
+	/// caller keep such files in full.
+	class JsonParser
+	{
+	public:
+		explicit JsonParser(std::string_view text) noexcept
+			: m_p(text.data()), m_end(text.data() + text.size())
+		{
+		}
+
+		bool ParseDocument(JsonNode& node)
+		{
+			if (!ParseValue(node, 0))
+			{
+				return false;
+			}
+			SkipSpace();
+			return m_p == m_end;
+		}
+
+	private:
+		const char* m_p;
+		const char* m_end;
+
+		void SkipSpace() noexcept
+		{
+			while (m_p < m_end && (*m_p == ' ' || *m_p == '\n' || *m_p == '\r' || *m_p == '\t'))
+			{
+				++m_p;
+			}
+		}
+
+		bool Literal(const char* word, size_t length) noexcept
+		{
+			if (static_cast<size_t>(m_end - m_p) < length || std::memcmp(m_p, word, length) != 0)
+			{
+				return false;
+			}
+			m_p += length;
+			return true;
+		}
+
+		bool ParseString(std::string& raw)
+		{
+			++m_p; // opening quote
+			const char* start = m_p;
+			while (m_p < m_end)
+			{
+				const unsigned char c = static_cast<unsigned char>(*m_p);
+				if (c == '"')
+				{
+					raw.assign(start, m_p);
+					++m_p;
+					return true;
+				}
+				if (c < 0x20)
+				{
+					return false;
+				}
+				if (c == '\\')
+				{
+					if (++m_p == m_end)
+					{
+						return false;
+					}
+					if (*m_p == 'u')
+					{
+						for (int i = 0; i < 4; ++i)
+						{
+							if (++m_p == m_end || !std::isxdigit(static_cast<unsigned char>(*m_p)))
+							{
+								return false;
+							}
+						}
+					}
+					else if (!std::strchr("\"\\/bfnrt", *m_p))
+					{
+						return false;
+					}
+				}
+				++m_p;
+			}
+			return false;
+		}
+
+		bool ParseNumber(std::string& raw)
+		{
+			const char* start = m_p;
+			if (*m_p == '-')
+			{
+				++m_p;
+			}
+			const char* digits = m_p;
+			while (m_p < m_end && ((*m_p >= '0' && *m_p <= '9') || *m_p == '.' || *m_p == 'e' || *m_p == 'E' ||
+				*m_p == '+' || *m_p == '-'))
+			{
+				++m_p;
+			}
+			if (m_p == digits || *digits < '0' || *digits > '9')
+			{
+				return false;
+			}
+			raw.assign(start, m_p);
+			return true;
+		}
+
+		bool ParseValue(JsonNode& node, int depth)
+		{
+			SkipSpace();
+			if (m_p == m_end || depth > MaxDepth)
+			{
+				return false;
+			}
+
+			switch (*m_p)
+			{
+			case '{':
+			{
+				node.kind = JsonKind::Object;
+				++m_p;
+				SkipSpace();
+				if (m_p < m_end && *m_p == '}')
+				{
+					++m_p;
+					return true;
+				}
+				for (;;)
+				{
+					SkipSpace();
+					if (m_p == m_end || *m_p != '"')
+					{
+						return false;
+					}
+					JsonMember& member = node.members.emplace_back();
+					if (!ParseString(member.key))
+					{
+						return false;
+					}
+					SkipSpace();
+					if (m_p == m_end || *m_p != ':')
+					{
+						return false;
+					}
+					++m_p;
+					if (!ParseValue(member.value, depth + 1))
+					{
+						return false;
+					}
+					SkipSpace();
+					if (m_p < m_end && *m_p == ',')
+					{
+						++m_p;
+						continue;
+					}
+					if (m_p < m_end && *m_p == '}')
+					{
+						++m_p;
+						return true;
+					}
+					return false;
+				}
+			}
+			case '[':
+			{
+				node.kind = JsonKind::Array;
+				++m_p;
+				SkipSpace();
+				if (m_p < m_end && *m_p == ']')
+				{
+					++m_p;
+					return true;
+				}
+				for (;;)
+				{
+					if (!ParseValue(node.items.emplace_back(), depth + 1))
+					{
+						return false;
+					}
+					SkipSpace();
+					if (m_p < m_end && *m_p == ',')
+					{
+						++m_p;
+						continue;
+					}
+					if (m_p < m_end && *m_p == ']')
+					{
+						++m_p;
+						return true;
+					}
+					return false;
+				}
+			}
+			case '"':
+				node.kind = JsonKind::String;
+				return ParseString(node.text);
+			case 't':
+				node.kind = JsonKind::True;
+				return Literal("true", 4);
+			case 'f':
+				node.kind = JsonKind::False;
+				return Literal("false", 5);
+			case 'n':
+				node.kind = JsonKind::Null;
+				return Literal("null", 4);
+			default:
+				node.kind = JsonKind::Number;
+				return ParseNumber(node.text);
+			}
+		}
+	};
+
+	bool ParseJson(std::string_view text, JsonNode& node)
+	{
+		node = JsonNode();
+		return JsonParser(text).ParseDocument(node);
+	}
+
+	void Indent(std::string& out, int depth)
+	{
+		out.push_back('\n');
+		out.append(static_cast<size_t>(depth) * 4, ' ');
+	}
+
+	/**
+	 * Writes a value; pretty printed with four spaces when indented, on one line otherwise.
+	 */
+	void WriteJson(const JsonNode& node, std::string& out, bool indented, int depth = 0)
+	{
+		switch (node.kind)
+		{
+		case JsonKind::Null:
+			out += "null";
+			break;
+		case JsonKind::False:
+			out += "false";
+			break;
+		case JsonKind::True:
+			out += "true";
+			break;
+		case JsonKind::Number:
+			out += node.text;
+			break;
+		case JsonKind::String:
+			out.push_back('"');
+			out += node.text;
+			out.push_back('"');
+			break;
+		case JsonKind::Array:
+			out.push_back('[');
+			for (size_t i = 0; i < node.items.size(); ++i)
+			{
+				if (i)
+				{
+					out.push_back(',');
+				}
+				if (indented)
+				{
+					Indent(out, depth + 1);
+				}
+				WriteJson(node.items[i], out, indented, depth + 1);
+			}
+			if (indented && !node.items.empty())
+			{
+				Indent(out, depth);
+			}
+			out.push_back(']');
+			break;
+		case JsonKind::Object:
+			out.push_back('{');
+			for (size_t i = 0; i < node.members.size(); ++i)
+			{
+				if (i)
+				{
+					out.push_back(',');
+				}
+				if (indented)
+				{
+					Indent(out, depth + 1);
+				}
+				out.push_back('"');
+				out += node.members[i].key;
+				out += indented ? "\": " : "\":";
+				WriteJson(node.members[i].value, out, indented, depth + 1);
+			}
+			if (indented && !node.members.empty())
+			{
+				Indent(out, depth);
+			}
+			out.push_back('}');
+			break;
+		}
+	}
+
+	// --------------------------------------------------------------------------
+	// Structural deltas
+	//
+	// A delta is a JSON array of operations, each an array [op, path, argument]:
+	//   ["set", path, value]     replace the value at path; an object key that does not exist is appended
+	//   ["insert", path, value]  insert value into an array before the index at path
+	//   ["remove", path, count]  remove an object key, or count array items starting at the index at path
+	// A path is an array of object keys and array indices; the empty path is the document itself.
+
+	/// One step of a path: an object key, or an array index when key is null.
+	struct PathStep
+	{
+		const std::string* key;
+		size_t index;
+	};
+
+	class DeltaWriter
+	{
+	public:
+		explicit DeltaWriter(std::string& out) noexcept
+			: m_out(out)
+		{
+		}
+
+		void Diff(const JsonNode& a, const JsonNode& b)
+		{
+			if (a.kind != b.kind || a.kind < JsonKind::Array)
+			{
+				if (!Equal(a, b))
+				{
+					Set(b);
+				}
+			}
+			else if (a.kind == JsonKind::Array)
+			{
+				DiffArrays(a, b);
+			}
+			else
+			{
+				DiffObjects(a, b);
+			}
+		}
+
+	private:
+		std::string& m_out;
+		std::vector<PathStep> m_path;
+
+		void BeginOp(const char* op)
+		{
+			m_out.push_back(m_out.size() > 1 ? ',' : '[');
+			m_out += "[\"";
+			m_out += op;
+			m_out += "\",[";
+			for (size_t i = 0; i < m_path.size(); ++i)
+			{
+				if (i)
+				{
+					m_out.push_back(',');
+				}
+				if (m_path[i].key)
+				{
+					m_out.push_back('"');
+					m_out += *m_path[i].key;
+					m_out.push_back('"');
+				}
+				else
+				{
+					m_out += std::to_string(m_path[i].index);
+				}
+			}
+			m_out += "],";
+		}
+
+		void Set(const JsonNode& value)
+		{
+			BeginOp("set");
+			WriteJson(value, m_out, false);
+			m_out.push_back(']');
+		}
+
+		void DiffArrays(const JsonNode& a, const JsonNode& b)
+		{
+			const size_t na = a.items.size();
+			const size_t nb = b.items.size();
+			size_t prefix = 0;
+			while (prefix < na && prefix < nb && Equal(a.items[prefix], b.items[prefix]))
+			{
+				++prefix;
+			}
+			size_t suffix = 0;
+			while (prefix + suffix < na && prefix + suffix < nb && Equal(a.items[na - 1 - suffix], b.items[nb - 1 - suffix]))
+			{
+				++suffix;
+			}
+
+			// Pair up the differing middle items, then insert or remove the surplus.
+			const size_t middleA = na - prefix - suffix;
+			const size_t middleB = nb - prefix - suffix;
+			const size_t paired = middleA < middleB ? middleA : middleB;
+			for (size_t i = 0; i < paired; ++i)
+			{
+				m_path.push_back(PathStep{ nullptr, prefix + i });
+				Diff(a.items[prefix + i], b.items[prefix + i]);
+				m_path.pop_back();
+			}
+			for (size_t i = paired; i < middleB; ++i)
+			{
+				m_path.push_back(PathStep{ nullptr, prefix + i });
+				BeginOp("insert");
+				WriteJson(b.items[prefix + i], m_out, false);
+				m_out.push_back(']');
+				m_path.pop_back();
+			}
+			if (middleA > paired)
+			{
+				m_path.push_back(PathStep{ nullptr, prefix + paired });
+				BeginOp("remove");
+				m_out += std::to_string(middleA - paired);
+				m_out.push_back(']');
+				m_path.pop_back();
+			}
+		}
+
+		void DiffObjects(const JsonNode& a, const JsonNode& b)
+		{
+			std::unordered_map<std::string_view, size_t> inB;
+			inB.reserve(b.members.size());
+			for (size_t i = 0; i < b.members.size(); ++i)
+			{
+				if (!inB.emplace(b.members[i].key, i).second)
+				{
+					Set(b); // duplicate keys: positions are ambiguous
+					return;
+				}
+			}
+
+			// The kept keys must appear in the same order and before the new ones; otherwise the member order
+			// cannot be reproduced by removals and appends, so the object is replaced.
+			std::unordered_map<std::string_view, size_t> inA;
+			inA.reserve(a.members.size());
+			size_t next = 0;
+			for (const JsonMember& member : a.members)
+			{
+				if (!inA.emplace(member.key, 0).second)
+				{
+					Set(b);
+					return;
+				}
+				const auto found = inB.find(member.key);
+				if (found != inB.end())
+				{
+					if (found->second != next)
+					{
+						Set(b);
+						return;
+					}
+					++next;
+				}
+			}
+
+			for (const JsonMember& member : a.members)
+			{
+				const auto found = inB.find(member.key);
+				m_path.push_back(PathStep{ &member.key, 0 });
+				if (found == inB.end())
+				{
+					BeginOp("remove");
+					m_out += "1]";
+				}
+				else
+				{
+					Diff(member.value, b.members[found->second].value);
+				}
+				m_path.pop_back();
+			}
+			for (size_t i = next; i < b.members.size(); ++i)
+			{
+				m_path.push_back(PathStep{ &b.members[i].key, 0 });
+				Set(b.members[i].value);
+				m_path.pop_back();
+			}
+		}
+	};
+
+	/**
+	 * Writes the delta that turns a into b.
+	 *
+	 * @return The delta, "[]" when the values are equal.
+	 */
+	std::string MakeDelta(const JsonNode& a, const JsonNode& b)
+	{
+		std::string out;
+		DeltaWriter(out).Diff(a, b);
+		if (out.empty())
+		{
+			out.push_back('[');
+		}
+		out.push_back(']');
+		return out;
+	}
+
+	bool ParseIndex(const JsonNode& step, size_t& index)
+	{
+		if (step.kind != JsonKind::Number || step.text.empty() || step.text.size() > 9)
+		{
+			return false;
+		}
+		index = 0;
+		for (const char c : step.text)
+		{
+			if (c < '0' || c > '9')
+			{
+				return false;
+			}
+			index = index * 10 + static_cast<size_t>(c - '0');
+		}
+		return true;
+	}
+
+	JsonMember* FindMember(JsonNode& node, const std::string& key)
+	{
+		for (JsonMember& member : node.members)
+		{
+			if (member.key == key)
+			{
+				return &member;
+			}
+		}
+		return nullptr;
+	}
+
+	/**
+	 * Applies a delta to a document.
+	 *
+	 * @return false if the delta is malformed or does not fit the document.
+	 */
+	bool ApplyDelta(JsonNode& document, std::string_view delta)
+	{
+		JsonNode ops;
+		if (!ParseJson(delta, ops) || ops.kind != JsonKind::Array)
+		{
+			return false;
+		}
+
+		for (JsonNode& op : ops.items)
+		{
+			if (op.kind != JsonKind::Array || op.items.size() != 3 || op.items[0].kind != JsonKind::String ||
+				op.items[1].kind != JsonKind::Array)
+			{
+				return false;
+			}
+			const std::string& name = op.items[0].text;
+			std::vector<JsonNode>& path = op.items[1].items;
+			JsonNode& argument = op.items[2];
+
+			if (path.empty())
+			{
+				if (name != "set")
+				{
+					return false;
+				}
+				document = std::move(argument);
+				continue;
+			}
+
+			JsonNode* parent = &document;
+			for (size_t i = 0; i + 1 < path.size(); ++i)
+			{
+				size_t index;
+				if (parent->kind == JsonKind::Object && path[i].kind == JsonKind::String)
+				{
+					JsonMember* member = FindMember(*parent, path[i].text);
+					if (!member)
+					{
+						return false;
+					}
+					parent = &member->value;
+				}
+				else if (parent->kind == JsonKind::Array && ParseIndex(path[i], index) && index < parent->items.size())
+				{
+					parent = &parent->items[index];
+				}
+				else
+				{
+					return false;
+				}
+			}
+
+			const JsonNode& last = path.back();
+			if (parent->kind == JsonKind::Object && last.kind == JsonKind::String)
+			{
+				JsonMember* member = FindMember(*parent, last.text);
+				if (name == "set")
+				{
+					if (member)
+					{
+						member->value = std::move(argument);
+					}
+					else
+					{
+						parent->members.push_back(JsonMember{ last.text, std::move(argument) });
+					}
+				}
+				else if (name == "remove" && member)
+				{
+					parent->members.erase(parent->members.begin() + (member - parent->members.data()));
+				}
+				else
+				{
+					return false;
+				}
+				continue;
+			}
+
+			size_t index;
+			if (parent->kind != JsonKind::Array || !ParseIndex(last, index))
+			{
+				return false;
+			}
+			std::vector<JsonNode>& items = parent->items;
+			size_t count;
+			if (name == "set" && index < items.size())
+			{
+				items[index] = std::move(argument);
+			}
+			else if (name == "insert" && index <= items.size())
+			{
+				items.insert(items.begin() + static_cast<ptrdiff_t>(index), std::move(argument));
+			}
+			else if (name == "remove" && ParseIndex(argument, count) && index + count <= items.size())
+			{
+				items.erase(items.begin() + static_cast<ptrdiff_t>(index), items.begin() + static_cast<ptrdiff_t>(index + count));
+			}
+			else
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// --------------------------------------------------------------------------
+	// File format
+
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t reserved;
+	};
+
+	enum RecordKind : uint8_t
+	{
+		CheckpointRecord = 1,
+		DeltaRecord = 2
+	};
+
+	struct RecordHeader
+	{
+		uint32_t source;
+		uint8_t kind;
+		uint8_t reserved[3];
+		uint32_t payloadSize;
+		uint32_t reserved2;
+		int64_t timestamp;
+		uint64_t contentHash;
+		uint64_t payloadHash;
+	};
+
+	static_assert(sizeof(FileHeader) == 16, "FileHeader layout");
+	static_assert(sizeof(RecordHeader) == 40, "RecordHeader layout");
+
+	int64_t NowMilliseconds()
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+}
+
+struct SnapshotHistory::State
+{
+	struct Entry
+	{
+		HistoryRecord record;
+		uint64_t payloadOffset;
+		ptrdiff_t previous;
+		uint32_t chainPosition; // versions since the last checkpoint of the chain
+	};
+
+	/// Parsed newest version of a source, kept to diff the next version against.
+	struct Newest
+	{
+		size_t index;
+		bool valid;
+		JsonNode tree;
+	};
+
+	std::filesystem::path path;
+	uint32_t interval = DefaultCheckpointInterval;
+	std::vector<Entry> entries;
+	uint64_t validEnd = 0;
+	std::map<uint32_t, Newest> newest;
+
+	/**
+	 * Rebuilds the tree of a version from its checkpoint and the deltas after it.
+	 *
+	 * @param index The version.
+	 * @param tree Receives the tree.
+	 * @param checkpointText Receives the stored text when the version is itself a checkpoint.
+	 * @return false if the chain cannot be read or a stored text is not strict JSON.
+	 */
+	bool Rebuild(size_t index, JsonNode* tree, std::string* checkpointText, std::error_code& ec) const
+	{
+		std::vector<size_t> chain;
+		for (ptrdiff_t i = static_cast<ptrdiff_t>(index); ; i = entries[static_cast<size_t>(i)].previous)
+		{
+			if (i < 0)
+			{
+				ec = std::make_error_code(std::errc::illegal_byte_sequence);
+				return false;
+			}
+			chain.push_back(static_cast<size_t>(i));
+			if (entries[static_cast<size_t>(i)].record.checkpoint)
+			{
+				break;
+			}
+		}
+
+		MappedFile file;
+		if (!file.Open(path) || file.size() < validEnd)
+		{
+			ec = std::make_error_code(std::errc::io_error);
+			return false;
+		}
+		const char* data = reinterpret_cast<const char*>(file.data());
+		auto payload = [&](size_t i) {
+			const Entry& e = entries[i];
+			return std::string_view(data + e.payloadOffset, e.record.storedSize);
+		};
+
+		if (checkpointText && chain.size() == 1)
+		{
+			checkpointText->assign(payload(chain[0]));
+			return true;
+		}
+		if (!ParseJson(payload(chain.back()), *tree))
+		{
+			ec = std::make_error_code(std::errc::illegal_byte_sequence);
+			return false;
+		}
+		for (size_t i = chain.size() - 1; i-- > 0;)
+		{
+			if (!ApplyDelta(*tree, payload(chain[i])))
+			{
+				ec = std::make_error_code(std::errc::illegal_byte_sequence);
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+/**
+ * Returns the path of the history file of a LocalState folder.
+ *
+ * @param folder The LocalState folder.
+ * @return folder / SnapshotHistory::FileName.
+ */
+std::filesystem::path SnapshotHistory::PathFor(const std::filesystem::path& folder)
+{
+	return folder / FileName;
+}
+
+SnapshotHistory::SnapshotHistory()
+	: m_state(std::make_unique<State>())
+{
+}
+
+SnapshotHistory::~SnapshotHistory() = default;
+
+/**
+ * Opens a history file and indexes its records; a torn record at the end is ignored.
+ *
+ * @param path The history file.
+ * @param checkpointInterval Versions per chain between two full copies.
+ * @param ec Receives the error.
+ * @return true on success.
+ */
+bool SnapshotHistory::Open(const std::filesystem::path& path, uint32_t checkpointInterval, std::error_code& ec)
+{
+	ec.clear();
+	State& s = *m_state;
+	s = State();
+	s.path = path;
+	s.interval = checkpointInterval ? checkpointInterval : 1;
+
+	if (!std::filesystem::exists(path, ec))
+	{
+		return !ec;
+	}
+
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		ec = std::make_error_code(std::errc::io_error);
+		return false;
+	}
+	const uint8_t* data = file.data();
+	const uint64_t size = file.size();
+	if (size == 0)
+	{
+		return true;
+	}
+
+	FileHeader header;
+	if (size < sizeof(header) || (std::memcpy(&header, data, sizeof(header)), header.magic != Magic) || header.version != Version)
+	{
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+
+	uint64_t offset = sizeof(header);
+	std::map<uint32_t, size_t> last;
+	while (size - offset >= sizeof(RecordHeader))
+	{
+		RecordHeader rh;
+		std::memcpy(&rh, data + offset, sizeof(rh));
+		const uint64_t payloadOffset = offset + sizeof(rh);
+		if ((rh.kind != CheckpointRecord && rh.kind != DeltaRecord) || rh.payloadSize > size - payloadOffset ||
+			ContentHash::Hash64(data + payloadOffset, rh.payloadSize) != rh.payloadHash)
+		{
+			break;
+		}
+
+		State::Entry entry{};
+		entry.record = HistoryRecord{ rh.source, rh.kind == CheckpointRecord, rh.payloadSize, rh.timestamp, rh.contentHash };
+		entry.payloadOffset = payloadOffset;
+		const auto previous = last.find(rh.source);
+		entry.previous = previous == last.end() ? -1 : static_cast<ptrdiff_t>(previous->second);
+		if (!entry.record.checkpoint)
+		{
+			if (entry.previous < 0)
+			{
+				break;
+			}
+			entry.chainPosition = s.entries[static_cast<size_t>(entry.previous)].chainPosition + 1;
+		}
+		last[rh.source] = s.entries.size();
+		s.entries.push_back(entry);
+		offset = payloadOffset + rh.payloadSize;
+	}
+	s.validEnd = offset;
+	return true;
+}
+
+size_t SnapshotHistory::Count() const
+{
+	return m_state->entries.size();
+}
+
+bool SnapshotHistory::GetRecord(size_t index, HistoryRecord& record) const
+{
+	if (index >= m_state->entries.size())
+	{
+		return false;
+	}
+	record = m_state->entries[index].record;
+	return true;
+}
+
+ptrdiff_t SnapshotHistory::Previous(size_t index) const
+{
+	return index < m_state->entries.size() ? m_state->entries[index].previous : -1;
+}
+
+ptrdiff_t SnapshotHistory::Latest(uint32_t source) const
+{
+	const auto& entries = m_state->entries;
+	for (size_t i = entries.size(); i-- > 0;)
+	{
+		if (entries[i].record.source == source)
+		{
+			return static_cast<ptrdiff_t>(i);
+		}
+	}
+	return -1;
+}
+
+/**
+ * Records a version of a source, as a delta against the previous version when that is smaller.
+ *
+ * @param source The file id.
+ * @param content The file's content.
+ * @param appended Set to false when the content equals the newest version of the source.
+ * @param ec Receives the error.
+ * @return false on error.
+ */
+bool SnapshotHistory::Append(uint32_t source, std::string_view content, bool& appended, std::error_code& ec)
+{
+	ec.clear();
+	appended = false;
+	State& s = *m_state;
+	const uint64_t contentHash = ContentHash::Hash64(content.data(), content.size());
+	const ptrdiff_t previous = Latest(source);
+	if (previous >= 0 && s.entries[static_cast<size_t>(previous)].record.contentHash == contentHash)
+	{
+		return true;
+	}
+
+	JsonNode tree;
+	const bool structured = ParseJson(content, tree);
+
+	// The tree of the previous version, to diff against; rebuilt from the file after a reopen.
+	bool checkpoint = previous < 0 || !structured ||
+		s.entries[static_cast<size_t>(previous)].chainPosition + 1 >= s.interval;
+	State::Newest* base = nullptr;
+	if (!checkpoint)
+	{
+		auto it = s.newest.find(source);
+		if (it == s.newest.end() || it->second.index != static_cast<size_t>(previous))
+		{
+			State::Newest rebuilt{ static_cast<size_t>(previous), false, JsonNode() };
+			std::error_code rebuildError;
+			rebuilt.valid = s.Rebuild(rebuilt.index, &rebuilt.tree, nullptr, rebuildError);
+			it = s.newest.insert_or_assign(source, std::move(rebuilt)).first;
+		}
+		base = &it->second;
+		checkpoint = !base->valid;
+	}
+
+	std::string delta;
+	if (!checkpoint)
+	{
+		delta = MakeDelta(base->tree, tree);
+		checkpoint = delta.size() >= content.size();
+	}
+	const std::string_view payload = checkpoint ? content : std::string_view(delta);
+
+	RecordHeader rh{};
+	rh.source = source;
+	rh.kind = checkpoint ? CheckpointRecord : DeltaRecord;
+	rh.payloadSize = static_cast<uint32_t>(payload.size());
+	rh.timestamp = NowMilliseconds();
+	rh.contentHash = contentHash;
+	rh.payloadHash = ContentHash::Hash64(payload.data(), payload.size());
+
+	// Drop a torn record left by a crash before appending.
+	std::error_code sizeError;
+	const uintmax_t fileSize = std::filesystem::file_size(s.path, sizeError);
+	if (!sizeError && fileSize != s.validEnd)
+	{
+		std::filesystem::resize_file(s.path, s.validEnd, ec);
+		if (ec)
+		{
+			return false;
+		}
+	}
+
+	{
+		std::ofstream out(s.path, std::ios::binary | std::ios::app);
+		if (!out)
+		{
+			ec = std::make_error_code(std::errc::io_error);
+			return false;
+		}
+		if (s.validEnd == 0)
+		{
+			const FileHeader header{ Magic, Version, 0 };
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		}
+		out.write(reinterpret_cast<const char*>(&rh), sizeof(rh));
+		out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+		out.flush();
+		if (!out)
+		{
+			ec = std::make_error_code(std::errc::io_error);
+			return false;
+		}
+	}
+
+	State::Entry entry{};
+	entry.record = HistoryRecord{ source, checkpoint, rh.payloadSize, rh.timestamp, contentHash };
+	entry.payloadOffset = (s.validEnd ? s.validEnd : sizeof(FileHeader)) + sizeof(RecordHeader);
+	entry.previous = previous;
+	entry.chainPosition = checkpoint ? 0 : s.entries[static_cast<size_t>(previous)].chainPosition + 1;
+	s.validEnd = entry.payloadOffset + payload.size();
+	s.entries.push_back(entry);
+
+	if (structured)
+	{
+		s.newest.insert_or_assign(source, State::Newest{ s.entries.size() - 1, true, std::move(tree) });
+	}
+	else
+	{
+		s.newest.erase(source);
+	}
+	appended = true;
+	return true;
+}
+
+/**
+ * Reconstructs the content of a version.
+ *
+ * @param index The version.
+ * @param content Receives the content.
+ * @param ec Receives the error.
+ * @return false if the version does not exist or cannot be rebuilt.
+ */
+bool SnapshotHistory::Restore(size_t index, std::string& content, std::error_code& ec) const
+{
+	ec.clear();
+	content.clear();
+	if (index >= m_state->entries.size())
+	{
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return false;
+	}
+
+	JsonNode tree;
+	if (!m_state->Rebuild(index, &tree, &content, ec))
+	{
+		return false;
+	}
+	if (!m_state->entries[index].record.checkpoint)
+	{
+		WriteJson(tree, content, true);
+	}
+	return true;
+}
+
+/**
+ * Writes a version to a file through a temporary file in the same folder.
+ *
+ * @param index The version.
+ * @param target The file to replace.
+ * @param ec Receives the error.
+ * @return true on success.
+ */
+bool SnapshotHistory::RestoreFile(size_t index, const std::filesystem::path& target, std::error_code& ec) const
+{
+	std::string content;
+	if (!Restore(index, content, ec))
+	{
+		return false;
+	}
+
+	std::filesystem::path temp = target;
+	temp += ".restore";
+	{
+		std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+		out.write(content.data(), static_cast<std::streamsize>(content.size()));
+		if (!out)
+		{
+			out.close();
+			std::error_code ignored;
+			std::filesystem::remove(temp, ignored);
+			ec = std::make_error_code(std::errc::io_error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temp, target, ec);
+	if (ec)
+	{
+		std::error_code ignored;
+		std::filesystem::remove(temp, ignored);
+		return false;
+	}
+	return true;
+}
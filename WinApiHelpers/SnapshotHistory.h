@@ -0,0 +1,134 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// One recorded version of a file of a LocalState folder.
+		/// </summary>
+		struct HistoryRecord
+		{
+			uint32_t source;        // caller-defined file id, e.g. an index into LayoutCache::SourceNames
+			bool checkpoint;        // stored in full rather than as a delta
+			uint32_t storedSize;    // bytes stored for this version
+			int64_t timestamp;      // milliseconds since the Unix epoch (UTC)
+			uint64_t contentHash;   // XXH64 of the version's content
+		};
+
+		/// <summary>
+		/// Versioned history of the JSON files of one LocalState folder, kept in a single append-only file.
+		/// </summary>
+		/// <remarks>
+		/// Each file (source) forms its own chain of versions. The first version of a chain, and then every
+		/// checkpointInterval-th one, is stored in full; the others are stored as structural deltas against
+		/// the previous version of the same source: a list of set, insert and remove operations on
+		/// paths such as ["persistedWindowLayouts",0,"tabLayout",3]. Arrays are diffed after trimming their
+		/// common prefix and suffix, so inserting or closing a tab costs one operation. A version is stored in
+		/// full instead when it is not strict JSON (settings.json with comments) or when its delta would not
+		/// be smaller. Restoring a version therefore reads at most one checkpoint and checkpointInterval - 1
+		/// deltas. Checkpoints restore byte for byte; delta versions restore to equivalent JSON, re-indented
+		/// with four spaces. Every record carries a hash of its payload, so a record torn by a crash is
+		/// dropped on open and overwritten by the next append. Not thread-safe.
+		/// </remarks>
+		class SnapshotHistory
+		{
+		public:
+			/// <summary>
+			/// Default number of versions per chain between two full copies.
+			/// </summary>
+			static constexpr uint32_t DefaultCheckpointInterval = 16;
+
+			/// <summary>
+			/// Magic value 'WTLH' at the start of the history file.
+			/// </summary>
+			static constexpr uint32_t Magic = 0x484C5457;
+
+			/// <summary>
+			/// Version of the record format.
+			/// </summary>
+			static constexpr uint32_t Version = 1;
+
+			/// <summary>
+			/// Name of the history file inside a LocalState folder.
+			/// </summary>
+			static constexpr const char* FileName = "WTLayoutManager.history";
+
+			/// <summary>
+			/// Returns the path of the history file of a LocalState folder.
+			/// </summary>
+			WINAPIHELPERS_API static std::filesystem::path PathFor(const std::filesystem::path& folder);
+
+			WINAPIHELPERS_API SnapshotHistory();
+			WINAPIHELPERS_API ~SnapshotHistory();
+
+			SnapshotHistory(const SnapshotHistory&) = delete;
+			SnapshotHistory& operator=(const SnapshotHistory&) = delete;
+
+			/// <summary>
+			/// Opens a history file and reads its record index. A missing file is an empty history; it is
+			/// created by the first append.
+			/// </summary>
+			/// <param name="path">The history file.</param>
+			/// <param name="checkpointInterval">Versions per chain between two full copies (at least 1).</param>
+			/// <param name="ec">Receives the error.</param>
+			/// <returns>false if the file exists but is not a history file or cannot be read.</returns>
+			WINAPIHELPERS_API bool Open(const std::filesystem::path& path, uint32_t checkpointInterval, std::error_code& ec);
+
+			/// <summary>
+			/// Number of recorded versions, all sources together.
+			/// </summary>
+			WINAPIHELPERS_API size_t Count() const;
+
+			/// <summary>
+			/// Describes a recorded version.
+			/// </summary>
+			/// <returns>false if the index is out of range.</returns>
+			WINAPIHELPERS_API bool GetRecord(size_t index, HistoryRecord& record) const;
+
+			/// <summary>
+			/// Returns the index of the version of the same source that precedes a version, or -1.
+			/// </summary>
+			WINAPIHELPERS_API ptrdiff_t Previous(size_t index) const;
+
+			/// <summary>
+			/// Returns the index of the newest version of a source, or -1.
+			/// </summary>
+			WINAPIHELPERS_API ptrdiff_t Latest(uint32_t source) const;
+
+			/// <summary>
+			/// Records a new version of a source.
+			/// </summary>
+			/// <param name="source">The file id.</param>
+			/// <param name="content">The file's content.</param>
+			/// <param name="appended">Set to false when the content equals the newest version of the source.</param>
+			/// <param name="ec">Receives the error.</param>
+			/// <returns>false on error.</returns>
+			WINAPIHELPERS_API bool Append(uint32_t source, std::string_view content, bool& appended, std::error_code& ec);
+
+			/// <summary>
+			/// Reconstructs the content of a recorded version.
+			/// </summary>
+			/// <returns>false if the index is out of range or the history is damaged.</returns>
+			WINAPIHELPERS_API bool Restore(size_t index, std::string& content, std::error_code& ec) const;
+
+			/// <summary>
+			/// Writes a recorded version to a file, replacing it (through a temporary file and a rename).
+			/// </summary>
+			WINAPIHELPERS_API bool RestoreFile(size_t index, const std::filesystem::path& target, std::error_code& ec) const;
+
+		private:
+			struct State;
+			std::unique_ptr<State> m_state;
+		};
+
+	}
+} // namespace WTLayoutManager::Services
@@ -0,0 +1,314 @@
+﻿#include "pch.h"
+#include "SnapshotRetention.h"
+#include "FolderScanner.h"
+#include "InstanceRegistry.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	/**
+	 * Milliseconds since the Unix epoch of a file time.
+	 */
+	int64_t UnixMilliseconds(std::filesystem::file_time_type time)
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::file_clock::to_sys(time).time_since_epoch()).count();
+	}
+
+	/**
+	 * Returns the wide form of a path the instance registry keys folders by; UTF-32 where wchar_t is
+	 * 32 bits wide, whatever the locale.
+	 */
+	std::wstring RegistryKey(const std::filesystem::path& folder)
+	{
+#if defined(_WIN32)
+		return folder.wstring();
+#else
+		const std::u32string text = folder.u32string();
+		return std::wstring(text.begin(), text.end());
+#endif
+	}
+
+	/**
+	 * Orders copies most recently run first; copies run at the same time by path, so a plan is stable.
+	 */
+	bool RunMoreRecently(const RetentionEntry& a, const RetentionEntry& b)
+	{
+		if (a.lastRunUnixMs != b.lastRunUnixMs)
+		{
+			return a.lastRunUnixMs > b.lastRunUnixMs;
+		}
+		return a.folder < b.folder;
+	}
+
+	void* MeasureWork(void* context, size_t index)
+	{
+		std::vector<RetentionEntry>& entries = *static_cast<std::vector<RetentionEntry>*>(context);
+		entries[index] = SnapshotRetention::Measure(entries[index].folder);
+		return nullptr;
+	}
+}
+
+/**
+ * Reads "maxCount=" and "maxBytes=" lines from the policy file.
+ *
+ * @param baseFolder The folder holding the copies.
+ * @return The policy; limits the file does not set are off.
+ */
+RetentionPolicy SnapshotRetention::LoadPolicy(const std::filesystem::path& baseFolder)
+{
+	RetentionPolicy policy;
+	std::ifstream input(baseFolder / PolicyFileName);
+	std::string line;
+	while (std::getline(input, line))
+	{
+		const size_t equals = line.find('=');
+		if (equals == std::string::npos)
+		{
+			continue;
+		}
+		const std::string key = line.substr(0, equals);
+		const char* value = line.c_str() + equals + 1;
+		char* end = nullptr;
+		const unsigned long long number = std::strtoull(value, &end, 10);
+		if (end == value || *value == '-')
+		{
+			continue;
+		}
+		if (key == "maxCount")
+		{
+			policy.maxCount = static_cast<uint32_t>(std::min<unsigned long long>(number, UINT32_MAX));
+		}
+		else if (key == "maxBytes")
+		{
+			policy.maxBytes = number;
+		}
+	}
+	return policy;
+}
+
+/**
+ * Writes the policy file through a temporary file, so a reader never sees half of it.
+ *
+ * @return false on error, with ec set.
+ */
+bool SnapshotRetention::SavePolicy(const std::filesystem::path& baseFolder, const RetentionPolicy& policy, std::error_code& ec)
+{
+	ec.clear();
+	std::filesystem::create_directories(baseFolder, ec);
+	if (ec)
+	{
+		return false;
+	}
+	const std::filesystem::path file = baseFolder / PolicyFileName;
+	std::filesystem::path temp = file;
+	temp += ".tmp";
+	{
+		std::ofstream output(temp, std::ios::binary | std::ios::trunc);
+		output << "maxCount=" << policy.maxCount << "\n" << "maxBytes=" << policy.maxBytes << "\n";
+		if (!output.flush())
+		{
+			ec = std::make_error_code(std::errc::io_error);
+			return false;
+		}
+	}
+	std::filesystem::rename(temp, file, ec);
+	return !ec;
+}
+
+bool SnapshotRetention::IsPinned(const std::filesystem::path& folder)
+{
+	std::error_code ec;
+	return std::filesystem::is_regular_file(folder / PinFileName, ec);
+}
+
+/**
+ * Creates or removes the pin file of a copy.
+ *
+ * @return false on error, with ec set; pinning a pinned copy or unpinning an unpinned one succeeds.
+ */
+bool SnapshotRetention::SetPinned(const std::filesystem::path& folder, bool pinned, std::error_code& ec)
+{
+	ec.clear();
+	const std::filesystem::path file = folder / PinFileName;
+	if (!pinned)
+	{
+		std::filesystem::remove(file, ec);
+		return !ec;
+	}
+	if (!std::filesystem::is_directory(folder, ec))
+	{
+		ec = ec ? ec : std::make_error_code(std::errc::no_such_file_or_directory);
+		return false;
+	}
+	std::ofstream output(file, std::ios::binary | std::ios::app);
+	if (!output)
+	{
+		ec = std::make_error_code(std::errc::permission_denied);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Measures one copy: the sizes of its files, recursively, and the time it was last run.
+ *
+ * @param folder The copy.
+ * @return The entry; a copy that cannot be read has no files and is ordered by the folder's own time.
+ */
+RetentionEntry SnapshotRetention::Measure(const std::filesystem::path& folder)
+{
+	RetentionEntry entry{};
+	entry.folder = folder;
+	entry.action = RetentionAction::Keep;
+
+	std::error_code ec;
+	const std::filesystem::file_time_type lastRun = std::filesystem::last_write_time(folder / "state.json", ec);
+	entry.hasLastRun = !ec;
+	if (ec)
+	{
+		// Never run: the copy counts from the time it was made.
+		const std::filesystem::file_time_type made = std::filesystem::last_write_time(folder, ec);
+		entry.lastRunUnixMs = ec ? 0 : UnixMilliseconds(made);
+	}
+	else
+	{
+		entry.lastRunUnixMs = UnixMilliseconds(lastRun);
+	}
+
+	std::filesystem::recursive_directory_iterator it(folder, std::filesystem::directory_options::skip_permission_denied, ec);
+	for (const std::filesystem::recursive_directory_iterator end; !ec && it != end; it.increment(ec))
+	{
+		std::error_code fileError;
+		if (it->is_regular_file(fileError))
+		{
+			const uintmax_t size = it->file_size(fileError);
+			if (!fileError)
+			{
+				entry.bytes += size;
+				++entry.files;
+			}
+		}
+	}
+
+	entry.pinned = IsPinned(folder);
+	RunningInstance instance{};
+	const std::wstring key = RegistryKey(folder);
+	entry.running = InstanceRegistry::Find(key, false, instance) || InstanceRegistry::Find(key, true, instance);
+	return entry;
+}
+
+/**
+ * Measures the subfolders of a folder on a FolderScanner.
+ *
+ * @param baseFolder The folder holding the copies.
+ * @param workers Number of threads; 0 uses one per hardware thread.
+ * @return One entry per copy, in no particular order.
+ */
+std::vector<RetentionEntry> SnapshotRetention::Collect(const std::filesystem::path& baseFolder, unsigned workers)
+{
+	std::vector<RetentionEntry> entries;
+	for (std::filesystem::path& folder : FolderScanner::EnumerateSubfolders(baseFolder))
+	{
+		RetentionEntry entry{};
+		entry.folder = std::move(folder);
+		entries.push_back(std::move(entry));
+	}
+	if (!entries.empty())
+	{
+		FolderScanner scanner;
+		scanner.Start(entries.size(), MeasureWork, &entries, workers);
+		scanner.Wait();
+	}
+	return entries;
+}
+
+/**
+ * Keeps the most recently run copies that fit the budget once the protected copies are accounted for.
+ *
+ * The copies are walked most recently run first; the first unprotected copy that does not fit is
+ * evicted, and so is every unprotected copy run before it, so a large copy is never evicted to keep
+ * an older small one.
+ *
+ * @param entries The measured copies.
+ * @param policy The budget.
+ * @return The report, most recently run first.
+ */
+RetentionReport SnapshotRetention::Evaluate(std::vector<RetentionEntry> entries, const RetentionPolicy& policy)
+{
+	RetentionReport report{};
+	std::sort(entries.begin(), entries.end(), RunMoreRecently);
+
+	uint64_t count = 0;
+	uint64_t bytes = 0;
+	for (RetentionEntry& entry : entries)
+	{
+		entry.action = entry.pinned ? RetentionAction::KeepPinned
+			: entry.running ? RetentionAction::KeepRunning
+			: RetentionAction::Keep;
+		if (entry.action != RetentionAction::Keep)
+		{
+			++count;
+			bytes += entry.bytes;
+		}
+	}
+
+	bool full = false;
+	for (RetentionEntry& entry : entries)
+	{
+		if (entry.action != RetentionAction::Keep)
+		{
+			continue;
+		}
+		full = full
+			|| (policy.maxCount != 0 && count + 1 > policy.maxCount)
+			|| (policy.maxBytes != 0 && bytes + entry.bytes > policy.maxBytes);
+		if (full)
+		{
+			entry.action = RetentionAction::Evict;
+			continue;
+		}
+		++count;
+		bytes += entry.bytes;
+	}
+
+	for (const RetentionEntry& entry : entries)
+	{
+		if (entry.action == RetentionAction::Evict)
+		{
+			++report.evictedCount;
+			report.evictedBytes += entry.bytes;
+		}
+		else
+		{
+			++report.keptCount;
+			report.keptBytes += entry.bytes;
+		}
+	}
+	report.entries = std::move(entries);
+	return report;
+}
+
+RetentionReport SnapshotRetention::Plan(const std::filesystem::path& baseFolder, const RetentionPolicy& policy)
+{
+	return Evaluate(Collect(baseFolder), policy);
+}
+
+std::vector<std::filesystem::path> SnapshotRetention::Evicted(const RetentionReport& report)
+{
+	std::vector<std::filesystem::path> folders;
+	for (auto it = report.entries.rbegin(); it != report.entries.rend(); ++it)
+	{
+		if (it->action == RetentionAction::Evict)
+		{
+			folders.push_back(it->folder);
+		}
+	}
+	return folders;
+}
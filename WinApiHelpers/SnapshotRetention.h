@@ -0,0 +1,139 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// The budget of the LocalState copies of one terminal package; 0 leaves a limit off.
+		/// </summary>
+		struct RetentionPolicy
+		{
+			uint32_t maxCount = 0;      // copies kept, pinned and running ones included
+			uint64_t maxBytes = 0;      // bytes of the files of the copies kept, pinned and running ones included
+
+			bool IsLimited() const noexcept
+			{
+				return maxCount != 0 || maxBytes != 0;
+			}
+		};
+
+		/// <summary>
+		/// What the policy decided for a copy.
+		/// </summary>
+		enum class RetentionAction : uint8_t
+		{
+			Keep,
+			KeepPinned,     // protected by its pin, whatever the budget
+			KeepRunning,    // protected because a terminal runs it
+			Evict
+		};
+
+		/// <summary>
+		/// A LocalState copy as the policy sees it.
+		/// </summary>
+		struct RetentionEntry
+		{
+			std::filesystem::path folder;
+			int64_t lastRunUnixMs;      // state.json's last write, as the folder list shows it; else the folder's
+			bool hasLastRun;            // false if the copy has no state.json
+			uint64_t bytes;
+			uint32_t files;
+			bool pinned;
+			bool running;
+			RetentionAction action;
+		};
+
+		/// <summary>
+		/// The outcome of a policy over every copy; the entries are in most recently run first order.
+		/// </summary>
+		struct RetentionReport
+		{
+			std::vector<RetentionEntry> entries;
+			uint32_t keptCount;
+			uint64_t keptBytes;
+			uint32_t evictedCount;
+			uint64_t evictedBytes;
+		};
+
+		/// <summary>
+		/// Keeps the LocalState copies of a terminal package within a count and size budget.
+		/// </summary>
+		/// <remarks>
+		/// Copies are ordered by last run, the time Windows Terminal last wrote their state.json, and the
+		/// least recently run ones are evicted until the rest fits the budget. Pinned copies (with a pin
+		/// file) and copies a terminal runs (in the InstanceRegistry) are never evicted; they still use the
+		/// budget, so they push unprotected copies out first. Evaluation is a pure function of the entries,
+		/// so a plan is a dry run; pruning deletes the evicted folders through FileOperationEngine, which
+		/// leaves a folder whose files are locked untouched. Sizes are the sizes of the files of a copy;
+		/// what a copy shares with others through the SnapshotStore is freed by the store's collection
+		/// once the last copy using it is gone.
+		/// </remarks>
+		class SnapshotRetention
+		{
+		public:
+			/// <summary>
+			/// Name of the file that pins a copy.
+			/// </summary>
+			static constexpr const char* PinFileName = "WTLayoutManager.pinned";
+
+			/// <summary>
+			/// Name of the policy file, next to the copies it applies to.
+			/// </summary>
+			static constexpr const char* PolicyFileName = "WTLayoutManager.retention";
+
+			/// <summary>
+			/// Reads the policy of the copies under a folder.
+			/// </summary>
+			/// <returns>No limits if the folder has no policy file; unknown or malformed lines are skipped.</returns>
+			WINAPIHELPERS_API static RetentionPolicy LoadPolicy(const std::filesystem::path& baseFolder);
+
+			/// <summary>
+			/// Writes the policy of the copies under a folder, replacing the previous one.
+			/// </summary>
+			WINAPIHELPERS_API static bool SavePolicy(const std::filesystem::path& baseFolder, const RetentionPolicy& policy, std::error_code& ec);
+
+			WINAPIHELPERS_API static bool IsPinned(const std::filesystem::path& folder);
+
+			/// <summary>
+			/// Pins or unpins a copy.
+			/// </summary>
+			WINAPIHELPERS_API static bool SetPinned(const std::filesystem::path& folder, bool pinned, std::error_code& ec);
+
+			/// <summary>
+			/// Reads the last run, size, pin and running terminal of a copy.
+			/// </summary>
+			WINAPIHELPERS_API static RetentionEntry Measure(const std::filesystem::path& folder);
+
+			/// <summary>
+			/// Measures every copy under a folder, spread over the hardware threads.
+			/// </summary>
+			WINAPIHELPERS_API static std::vector<RetentionEntry> Collect(const std::filesystem::path& baseFolder, unsigned workers = 0);
+
+			/// <summary>
+			/// Applies a policy to measured copies.
+			/// </summary>
+			/// <param name="entries">The copies; their actions are ignored and set in the report.</param>
+			/// <param name="policy">The budget.</param>
+			WINAPIHELPERS_API static RetentionReport Evaluate(std::vector<RetentionEntry> entries, const RetentionPolicy& policy);
+
+			/// <summary>
+			/// Collects and evaluates the copies under a folder; nothing is deleted.
+			/// </summary>
+			WINAPIHELPERS_API static RetentionReport Plan(const std::filesystem::path& baseFolder, const RetentionPolicy& policy);
+
+			/// <summary>
+			/// Returns the folders a report evicts, least recently run first; pass them to
+			/// FileOperationEngine::StartDelete to prune.
+			/// </summary>
+			WINAPIHELPERS_API static std::vector<std::filesystem::path> Evicted(const RetentionReport& report);
+		};
+
+	}
+} // namespace WTLayoutManager::Services
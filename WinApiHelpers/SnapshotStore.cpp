@@ -0,0 +1,455 @@
+﻿#include "pch.h"
+#include "SnapshotStore.h"
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+using namespace WTLayoutManager::Services;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	/// Temporary files in the store start with this character; finished objects never do.
+	constexpr wchar_t TempPrefix = L'~';
+
+	/// Age after which a leftover temporary file (from a crashed ingest) is collected.
+	constexpr auto TempExpiry = std::chrono::hours(1);
+
+	/**
+	 * Returns a file name that is unique within this process and unlikely to clash with other processes.
+	 *
+	 * @param suffix The file name extension, including the dot.
+	 * @return The name, starting with TempPrefix.
+	 */
+	fs::path UniqueTempName(const wchar_t* suffix)
+	{
+		static std::atomic<uint64_t> counter{ 0 };
+		const uint64_t seed[3] = {
+			counter.fetch_add(1, std::memory_order_relaxed),
+			static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()),
+			reinterpret_cast<uintptr_t>(&counter)
+		};
+		wchar_t name[40];
+		std::swprintf(name, 40, L"%c%016llx%ls", TempPrefix,
+			static_cast<unsigned long long>(ContentHash::Hash64(seed, sizeof(seed))), suffix);
+		return fs::path(name);
+	}
+
+	/**
+	 * Deletes one name of a file, even if the file is read-only, without changing the attributes of
+	 * its other hard links.
+	 *
+	 * @param path The file to delete.
+	 * @param ec Receives the error.
+	 * @return true if the file was deleted or did not exist.
+	 */
+	bool RemoveLink(const fs::path& path, std::error_code& ec)
+	{
+		ec.clear();
+#if defined(_WIN32)
+		// The read-only attribute belongs to the file, not to the name, so clearing it to delete one link
+		// would make the shared object writable; FILE_DISPOSITION_FLAG_IGNORE_READONLY_ATTRIBUTE avoids that.
+		HANDLE file = ::CreateFileW(path.c_str(), DELETE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr, OPEN_EXISTING, FILE_FLAG_OPEN_REPARSE_POINT | FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			const DWORD error = ::GetLastError();
+			if (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND)
+			{
+				return true;
+			}
+			ec.assign(static_cast<int>(error), std::system_category());
+			return false;
+		}
+
+		FILE_DISPOSITION_INFO_EX disposition{};
+		disposition.Flags = FILE_DISPOSITION_FLAG_DELETE | FILE_DISPOSITION_FLAG_POSIX_SEMANTICS |
+			FILE_DISPOSITION_FLAG_IGNORE_READONLY_ATTRIBUTE;
+		const BOOL deleted = ::SetFileInformationByHandle(file, FileDispositionInfoEx, &disposition, sizeof(disposition));
+		const DWORD error = deleted ? ERROR_SUCCESS : ::GetLastError();
+		::CloseHandle(file);
+		if (deleted)
+		{
+			return true;
+		}
+		if (error != ERROR_INVALID_PARAMETER && error != ERROR_NOT_SUPPORTED)
+		{
+			ec.assign(static_cast<int>(error), std::system_category());
+			return false;
+		}
+
+		// File systems without the extended disposition (FAT): clear the attribute and delete normally.
+		fs::permissions(path, fs::perms::owner_write, fs::perm_options::add, ec);
+		ec.clear();
+#endif
+		fs::remove(path, ec);
+		return !ec;
+	}
+
+	/**
+	 * Removes the write permission of a file (the read-only attribute on Windows).
+	 */
+	void MakeReadOnly(const fs::path& path, std::error_code& ec)
+	{
+		fs::permissions(path, fs::perms::owner_write | fs::perms::group_write | fs::perms::others_write,
+			fs::perm_options::remove, ec);
+	}
+
+	/**
+	 * Gives the owner write permission on a file (clears the read-only attribute on Windows).
+	 */
+	void MakeWritable(const fs::path& path, std::error_code& ec)
+	{
+		fs::permissions(path, fs::perms::owner_write, fs::perm_options::add, ec);
+	}
+
+	/**
+	 * Creates target as a copy-on-write clone of source.
+	 *
+	 * @return false if the file system cannot clone (target is not left behind).
+	 */
+	bool TryReflink(const fs::path& source, const fs::path& target)
+	{
+#if defined(__linux__) && defined(FICLONE)
+		const int in = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+		if (in < 0)
+		{
+			return false;
+		}
+		const int out = ::open(target.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+		if (out < 0)
+		{
+			::close(in);
+			return false;
+		}
+		const bool cloned = ::ioctl(out, FICLONE, in) == 0;
+		::close(out);
+		::close(in);
+		if (!cloned)
+		{
+			::unlink(target.c_str());
+		}
+		return cloned;
+#else
+		// Windows has no user-mode clone call for whole files; CopyFile2 (behind std::filesystem::copy_file)
+		// already clones blocks on ReFS and Dev Drive volumes, so the ingest copy below gets it for free.
+		(void)source;
+		(void)target;
+		return false;
+#endif
+	}
+
+	/**
+	 * Compares the contents of two files.
+	 */
+	bool SameContents(const fs::path& a, const fs::path& b)
+	{
+		MappedFile left;
+		MappedFile right;
+		if (!left.Open(a) || !right.Open(b) || left.size() != right.size())
+		{
+			return false;
+		}
+		return left.size() == 0 || std::memcmp(left.data(), right.data(), left.size()) == 0;
+	}
+
+	/**
+	 * Copies source to target, replacing it, and makes the copy writable.
+	 */
+	SnapshotPlacement CopyPrivate(const fs::path& source, const fs::path& target, std::error_code& ec)
+	{
+		if (!fs::copy_file(source, target, fs::copy_options::overwrite_existing, ec))
+		{
+			return SnapshotPlacement::Failed;
+		}
+		std::error_code ignored;
+		MakeWritable(target, ignored);
+		return SnapshotPlacement::Copied;
+	}
+}
+
+/**
+ * \brief Creates a store over an object directory; nothing is touched until the first call.
+ */
+SnapshotStore::SnapshotStore(fs::path objectsDir, bool allowReflink)
+	: m_objectsDir(std::move(objectsDir)), m_allowReflink(allowReflink)
+{
+}
+
+/**
+ * Returns the path of the object holding contents with a given hash and size.
+ *
+ * @param hash The XXH64 of the contents.
+ * @param size The size of the contents in bytes.
+ * @return objectsDir/xx/hhhhhhhhhhhhhhhh-size, xx being the top byte of the hash.
+ */
+fs::path SnapshotStore::ObjectPath(uint64_t hash, uint64_t size) const
+{
+	wchar_t dir[3];
+	wchar_t name[48];
+	std::swprintf(dir, 3, L"%02x", static_cast<unsigned>(hash >> 56));
+	std::swprintf(name, 48, L"%016llx-%llu", static_cast<unsigned long long>(hash), static_cast<unsigned long long>(size));
+	return m_objectsDir / dir / name;
+}
+
+/**
+ * Places a file into a snapshot: a clone when the file system supports it, otherwise a hard link to the
+ * deduplicated object, otherwise a copy.
+ *
+ * @param source The file to copy.
+ * @param target The snapshot file to create or replace.
+ * @param ec Receives the error when Failed is returned.
+ * @return How the file was placed.
+ */
+SnapshotPlacement SnapshotStore::Place(const fs::path& source, const fs::path& target, std::error_code& ec) const
+{
+	ec.clear();
+	if (!RemoveLink(target, ec))
+	{
+		return SnapshotPlacement::Failed;
+	}
+	if (m_allowReflink && TryReflink(source, target))
+	{
+		return SnapshotPlacement::Reflinked;
+	}
+
+	uint64_t hash = 0;
+	std::error_code sizeError;
+	const uintmax_t size = fs::file_size(source, sizeError);
+	if (sizeError || !ContentHash::HashFile(source, hash))
+	{
+		return CopyPrivate(source, target, ec);
+	}
+
+	fs::path object = ObjectPath(hash, size);
+	std::error_code storeError;
+	if (!fs::exists(object, storeError))
+	{
+		// Ingest through a private copy: the source may be rewritten while we read it, so the object is
+		// named after what was actually copied, not after the hash computed above.
+		const fs::path dir = object.parent_path();
+		fs::create_directories(dir, storeError);
+		const fs::path temp = dir / UniqueTempName(L".tmp");
+		if (storeError || !fs::copy_file(source, temp, storeError))
+		{
+			return CopyPrivate(source, target, ec);
+		}
+
+		uint64_t copiedHash = 0;
+		const uintmax_t copiedSize = fs::file_size(temp, storeError);
+		if (storeError || !ContentHash::HashFile(temp, copiedHash))
+		{
+			RemoveLink(temp, storeError);
+			return CopyPrivate(source, target, ec);
+		}
+		object = ObjectPath(copiedHash, copiedSize);
+		fs::create_directories(object.parent_path(), storeError);
+		MakeReadOnly(temp, storeError);
+		if (fs::exists(object, storeError))
+		{
+			// Another ingest won the race; keep its object.
+			RemoveLink(temp, storeError);
+		}
+		else
+		{
+			fs::rename(temp, object, storeError);
+			if (storeError)
+			{
+				std::error_code ignored;
+				RemoveLink(temp, ignored);
+				return CopyPrivate(source, target, ec);
+			}
+		}
+	}
+
+	if (!SameContents(source, object))
+	{
+		// Hash collision, or the source changed since it was hashed.
+		return CopyPrivate(source, target, ec);
+	}
+
+	fs::create_hard_link(object, target, storeError);
+	if (storeError)
+	{
+		// Different volume, file system without hard links, link limit reached, or the object was just
+		// collected by another process.
+		return CopyPrivate(source, target, ec);
+	}
+	return SnapshotPlacement::Linked;
+}
+
+/**
+ * Replaces the shared files of a snapshot with private writable copies.
+ *
+ * @param folder The snapshot folder.
+ * @param ec Receives the first error; the remaining files are still processed.
+ * @return Number of files detached.
+ */
+size_t SnapshotStore::Detach(const fs::path& folder, std::error_code& ec) const
+{
+	ec.clear();
+	std::vector<fs::path> files;
+	std::error_code walkError;
+	for (fs::recursive_directory_iterator it(folder, walkError), end; !walkError && it != end; it.increment(walkError))
+	{
+		if (it->is_regular_file(walkError))
+		{
+			files.push_back(it->path());
+		}
+	}
+	if (walkError && walkError != std::errc::no_such_file_or_directory)
+	{
+		ec = walkError;
+	}
+
+	size_t detached = 0;
+	for (const fs::path& file : files)
+	{
+		std::error_code fileError;
+		const uintmax_t links = fs::hard_link_count(file, fileError);
+		if (fileError)
+		{
+			continue;
+		}
+		if (links <= 1)
+		{
+			// A private file left read-only (its object was deleted by hand); make it usable again.
+			const fs::perms perms = fs::status(file, fileError).permissions();
+			if (!fileError && (perms & fs::perms::owner_write) == fs::perms::none)
+			{
+				MakeWritable(file, fileError);
+			}
+			continue;
+		}
+
+		const fs::path temp = file.parent_path() / UniqueTempName(L".detach");
+		if (fs::copy_file(file, temp, fileError))
+		{
+			MakeWritable(temp, fileError);
+			if (!fileError && RemoveLink(file, fileError))
+			{
+				fs::rename(temp, file, fileError);
+				if (!fileError)
+				{
+					++detached;
+					continue;
+				}
+			}
+			std::error_code ignored;
+			RemoveLink(temp, ignored);
+		}
+		if (!ec)
+		{
+			ec = fileError;
+		}
+	}
+	return detached;
+}
+
+/**
+ * Deletes a snapshot folder and everything in it.
+ *
+ * @param folder The snapshot folder.
+ * @param ec Receives the first error.
+ * @return true if the folder is gone.
+ */
+bool SnapshotStore::RemoveTree(const fs::path& folder, std::error_code& ec) const
+{
+	ec.clear();
+	std::vector<fs::path> files;
+	std::error_code walkError;
+	for (fs::recursive_directory_iterator it(folder, walkError), end; !walkError && it != end; it.increment(walkError))
+	{
+		if (!it->is_directory(walkError))
+		{
+			files.push_back(it->path());
+		}
+	}
+
+	for (const fs::path& file : files)
+	{
+		std::error_code fileError;
+		if (!RemoveLink(file, fileError) && !ec)
+		{
+			ec = fileError;
+		}
+	}
+
+	std::error_code dirError;
+	fs::remove_all(folder, dirError);
+	if (dirError && !ec)
+	{
+		ec = dirError;
+	}
+	return !ec;
+}
+
+/**
+ * Deletes the objects that are no longer linked from any snapshot, and temporary files left behind
+ * by interrupted ingests.
+ *
+ * @return Number and total size of the files deleted.
+ */
+SnapshotGarbage SnapshotStore::CollectGarbage() const
+{
+	SnapshotGarbage garbage{ 0, 0 };
+	const auto now = fs::file_time_type::clock::now();
+
+	std::error_code ec;
+	for (fs::directory_iterator dirs(m_objectsDir, ec), end; !ec && dirs != end; dirs.increment(ec))
+	{
+		std::error_code dirError;
+		if (!dirs->is_directory(dirError))
+		{
+			continue;
+		}
+
+		for (fs::directory_iterator files(dirs->path(), dirError); !dirError && files != end; files.increment(dirError))
+		{
+			std::error_code fileError;
+			const fs::path& path = files->path();
+			const uintmax_t size = files->file_size(fileError);
+			if (fileError)
+			{
+				continue;
+			}
+
+			bool unused;
+			if (path.filename().native().front() == TempPrefix)
+			{
+				const auto written = files->last_write_time(fileError);
+				unused = !fileError && now - written > TempExpiry;
+			}
+			else
+			{
+				// The store holds one link; every snapshot file sharing the object adds one.
+				const uintmax_t links = files->hard_link_count(fileError);
+				unused = !fileError && links == 1;
+			}
+
+			if (unused && RemoveLink(path, fileError))
+			{
+				++garbage.objects;
+				garbage.bytes += size;
+			}
+		}
+
+		// Only succeeds once the directory is empty.
+		fs::remove(dirs->path(), dirError);
+	}
+	return garbage;
+}
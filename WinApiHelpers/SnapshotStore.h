@@ -0,0 +1,94 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <cstdint>
+#include <filesystem>
+#include <system_error>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// How a file was placed into a snapshot.
+		/// </summary>
+		enum class SnapshotPlacement : uint8_t
+		{
+			Failed,
+			Reflinked,  // copy-on-write clone of the source; shares blocks, independent file
+			Linked,     // hard link to a read-only object of the store
+			Copied      // plain copy (the store is on another volume, or links are not supported)
+		};
+
+		/// <summary>
+		/// Result of a garbage collection pass.
+		/// </summary>
+		struct SnapshotGarbage
+		{
+			uint64_t objects;
+			uint64_t bytes;
+		};
+
+		/// <summary>
+		/// Content-addressed store that lets snapshots share identical files.
+		/// </summary>
+		/// <remarks>
+		/// Objects live under objectsDir as xx/&lt;XXH64&gt;-&lt;size&gt;, read-only. Placing a file first tries
+		/// a copy-on-write clone of the source (FICLONE on Linux); otherwise the contents are ingested once
+		/// and the snapshot file becomes a hard link to the object, so duplicating a snapshot writes no data.
+		/// An object's hard link count is its reference count: an object with a single link is referenced
+		/// by no snapshot and is removed by CollectGarbage. Because linked files share one inode, a snapshot
+		/// must be detached (its shared files replaced by private copies) before anything writes to it, e.g.
+		/// before Windows Terminal is started on it. Objects are verified byte for byte before being shared,
+		/// so a hash collision degrades to a copy.
+		/// </remarks>
+		class SnapshotStore
+		{
+		public:
+			/// <param name="objectsDir">The object directory; created on first use. Must be on the same
+			/// volume as the snapshots for hard links to be possible.</param>
+			/// <param name="allowReflink">Whether Place may clone files; false always goes through the objects,
+			/// as on a file system without clones.</param>
+			WINAPIHELPERS_API explicit SnapshotStore(std::filesystem::path objectsDir, bool allowReflink = true);
+
+			/// <summary>
+			/// Places a copy of source at target, replacing target if it exists.
+			/// </summary>
+			/// <param name="source">The file to copy; it may be live (e.g. in the default LocalState).</param>
+			/// <param name="target">The file to create inside a snapshot.</param>
+			/// <param name="ec">Receives the error when Failed is returned.</param>
+			WINAPIHELPERS_API SnapshotPlacement Place(
+				const std::filesystem::path& source,
+				const std::filesystem::path& target,
+				std::error_code& ec) const;
+
+			/// <summary>
+			/// Replaces every shared (hard linked) file of a snapshot with a private writable copy.
+			/// </summary>
+			/// <param name="folder">The snapshot folder; searched recursively.</param>
+			/// <param name="ec">Receives the first error.</param>
+			/// <returns>Number of files detached.</returns>
+			WINAPIHELPERS_API size_t Detach(const std::filesystem::path& folder, std::error_code& ec) const;
+
+			/// <summary>
+			/// Deletes a snapshot folder, including its read-only shared files, without touching the objects.
+			/// </summary>
+			/// <returns>false if something could not be deleted; ec has the first error.</returns>
+			WINAPIHELPERS_API bool RemoveTree(const std::filesystem::path& folder, std::error_code& ec) const;
+
+			/// <summary>
+			/// Deletes the objects no snapshot links to any more.
+			/// </summary>
+			WINAPIHELPERS_API SnapshotGarbage CollectGarbage() const;
+
+			/// <summary>
+			/// Returns the object path for a content hash and size.
+			/// </summary>
+			WINAPIHELPERS_API std::filesystem::path ObjectPath(uint64_t hash, uint64_t size) const;
+
+		private:
+			std::filesystem::path m_objectsDir;
+			bool m_allowReflink;
+		};
+
+	}
+} // namespace WTLayoutManager::Services
@@ -0,0 +1,278 @@
+﻿#include "pch.h"
+#include "StringPool.h"
+#include "ContentHash.h"
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <vector>
+
+using namespace WTLayoutManager::Services;
+
+namespace
+{
+	struct Entry
+	{
+		const char16_t* chars;
+		uint32_t length;
+	};
+
+	/// A lookup table slot; id 0 marks a free slot.
+	struct Slot
+	{
+		uint32_t hash;
+		uint32_t id;
+	};
+
+	/// Ids are split over segments that double in size, so the directory grows without moving entries.
+	constexpr uint64_t FirstSegmentEntries = 1024;
+	constexpr size_t SegmentCount = 23;         // FirstSegmentEntries * (2^23 - 1) covers every 32-bit id
+
+	constexpr size_t ShardCount = 16;
+	constexpr size_t FirstShardSlots = 64;
+
+	/// Characters per arena block; longer strings get a block of their own.
+	constexpr size_t BlockChars = 32 * 1024;
+
+	/// Characters of every empty string, so that an empty string never reads as the null view.
+	constexpr char16_t EmptyChars[1] = {};
+
+	uint64_t HashText(std::u16string_view text) noexcept
+	{
+		return ContentHash::Hash64(text.data(), text.size() * sizeof(char16_t));
+	}
+
+	void LocateEntry(uint32_t id, size_t& segment, uint64_t& offset) noexcept
+	{
+		segment = static_cast<size_t>(std::bit_width(id / FirstSegmentEntries + 1) - 1);
+		offset = id - FirstSegmentEntries * ((uint64_t(1) << segment) - 1);
+	}
+
+	struct Shard
+	{
+		std::shared_mutex lock;
+		std::vector<Slot> slots = std::vector<Slot>(FirstShardSlots);
+		size_t used = 0;
+	};
+}
+
+struct StringPool::State
+{
+	Shard shards[ShardCount];
+
+	std::mutex append;                              // guards the arena and the directory growth
+	std::atomic<Entry*> segments[SegmentCount] = {};
+	std::atomic<uint32_t> count{ 1 };               // NullId is taken from the start
+	std::vector<std::unique_ptr<char16_t[]>> blocks;
+	char16_t* cursor = nullptr;
+	size_t remaining = 0;
+
+	std::atomic<uint64_t> arenaBytes{ 0 };
+	std::atomic<uint64_t> lookups{ 0 };
+	std::atomic<uint64_t> hits{ 0 };
+
+	~State()
+	{
+		for (std::atomic<Entry*>& segment : segments)
+		{
+			delete[] segment.load(std::memory_order_relaxed);
+		}
+	}
+
+	const Entry* Find(uint32_t id) const noexcept
+	{
+		if (id == NullId || id >= count.load(std::memory_order_acquire))
+		{
+			return nullptr;
+		}
+		size_t segment;
+		uint64_t offset;
+		LocateEntry(id, segment, offset);
+		return &segments[segment].load(std::memory_order_acquire)[offset];
+	}
+
+	bool Equals(uint32_t id, std::u16string_view text) const noexcept
+	{
+		const Entry* entry = Find(id);
+		return entry->length == text.size()
+			&& std::memcmp(entry->chars, text.data(), text.size() * sizeof(char16_t)) == 0;
+	}
+
+	/**
+	 * Looks a string up in one shard; the caller holds the shard's lock.
+	 *
+	 * @return The index of the slot holding the string, or of the free slot where it belongs.
+	 */
+	size_t Probe(const Shard& shard, uint32_t hash, std::u16string_view text) const noexcept
+	{
+		const size_t mask = shard.slots.size() - 1;
+		for (size_t i = hash & mask;; i = (i + 1) & mask)
+		{
+			const Slot& slot = shard.slots[i];
+			if (slot.id == NullId || (slot.hash == hash && Equals(slot.id, text)))
+			{
+				return i;
+			}
+		}
+	}
+
+	/**
+	 * Doubles the table of a shard that is half full; the caller holds the shard's lock exclusively.
+	 */
+	static void Grow(Shard& shard)
+	{
+		std::vector<Slot> slots(shard.slots.size() * 2);
+		const size_t mask = slots.size() - 1;
+		for (const Slot& slot : shard.slots)
+		{
+			if (slot.id == NullId)
+			{
+				continue;
+			}
+			size_t i = slot.hash & mask;
+			while (slots[i].id != NullId)
+			{
+				i = (i + 1) & mask;
+			}
+			slots[i] = slot;
+		}
+		shard.slots.swap(slots);
+	}
+
+	/**
+	 * Copies a string into the arena and publishes its id.
+	 */
+	uint32_t Append(std::u16string_view text)
+	{
+		std::lock_guard<std::mutex> lock(append);
+		const uint32_t id = count.load(std::memory_order_relaxed);
+		if (id == UINT32_MAX)
+		{
+			throw std::length_error("string pool is full");
+		}
+
+		const char16_t* chars = EmptyChars;
+		if (text.size() > BlockChars / 4)
+		{
+			// A long string gets a block of its own and leaves the current block open.
+			blocks.push_back(std::make_unique<char16_t[]>(text.size()));
+			arenaBytes.fetch_add(text.size() * sizeof(char16_t), std::memory_order_relaxed);
+			std::memcpy(blocks.back().get(), text.data(), text.size() * sizeof(char16_t));
+			chars = blocks.back().get();
+		}
+		else if (!text.empty())
+		{
+			if (text.size() > remaining)
+			{
+				blocks.push_back(std::make_unique<char16_t[]>(BlockChars));
+				arenaBytes.fetch_add(BlockChars * sizeof(char16_t), std::memory_order_relaxed);
+				cursor = blocks.back().get();
+				remaining = BlockChars;
+			}
+			std::memcpy(cursor, text.data(), text.size() * sizeof(char16_t));
+			chars = cursor;
+			cursor += text.size();
+			remaining -= text.size();
+		}
+
+		size_t segment;
+		uint64_t offset;
+		LocateEntry(id, segment, offset);
+		Entry* entries = segments[segment].load(std::memory_order_relaxed);
+		if (entries == nullptr)
+		{
+			entries = new Entry[FirstSegmentEntries << segment];
+			segments[segment].store(entries, std::memory_order_release);
+		}
+		entries[offset] = Entry{ chars, static_cast<uint32_t>(text.size()) };
+		count.store(id + 1, std::memory_order_release);
+		return id;
+	}
+};
+
+StringPool::StringPool()
+	: m_state(std::make_unique<State>())
+{
+}
+
+StringPool::~StringPool() = default;
+
+StringPool& StringPool::Shared()
+{
+	static StringPool pool;
+	return pool;
+}
+
+/**
+ * Interns a string.
+ *
+ * @param text The string; a null view is not interned.
+ * @return Its id, or NullId for a null view.
+ */
+uint32_t StringPool::Intern(std::u16string_view text)
+{
+	if (text.data() == nullptr)
+	{
+		return NullId;
+	}
+	State& state = *m_state;
+	state.lookups.fetch_add(1, std::memory_order_relaxed);
+
+	const uint64_t hash = HashText(text);
+	Shard& shard = state.shards[hash >> 60];
+	const uint32_t slotHash = static_cast<uint32_t>(hash);
+	{
+		std::shared_lock<std::shared_mutex> read(shard.lock);
+		const Slot& slot = shard.slots[state.Probe(shard, slotHash, text)];
+		if (slot.id != NullId)
+		{
+			state.hits.fetch_add(1, std::memory_order_relaxed);
+			return slot.id;
+		}
+	}
+
+	std::unique_lock<std::shared_mutex> write(shard.lock);
+	Slot& slot = shard.slots[state.Probe(shard, slotHash, text)];
+	if (slot.id != NullId)
+	{
+		// Another thread added it between the two locks.
+		state.hits.fetch_add(1, std::memory_order_relaxed);
+		return slot.id;
+	}
+	const uint32_t id = state.Append(text);
+	slot = Slot{ slotHash, id };
+	if (++shard.used * 2 > shard.slots.size())
+	{
+		State::Grow(shard);
+	}
+	return id;
+}
+
+/**
+ * Returns the characters of an interned string.
+ *
+ * @param id An id returned by Intern.
+ * @return The string, valid for the lifetime of the pool; a null view for NullId or an unknown id.
+ */
+std::u16string_view StringPool::View(uint32_t id) const noexcept
+{
+	const Entry* entry = m_state->Find(id);
+	return entry == nullptr ? std::u16string_view() : std::u16string_view(entry->chars, entry->length);
+}
+
+uint32_t StringPool::Size() const noexcept
+{
+	return m_state->count.load(std::memory_order_acquire);
+}
+
+StringPoolStats StringPool::Stats() const noexcept
+{
+	StringPoolStats stats{};
+	stats.strings = Size() - 1;
+	stats.arenaBytes = m_state->arenaBytes.load(std::memory_order_relaxed);
+	stats.lookups = m_state->lookups.load(std::memory_order_relaxed);
+	stats.hits = m_state->hits.load(std::memory_order_relaxed);
+	return stats;
+}
@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		/// <summary>
+		/// Counters of a string pool.
+		/// </summary>
+		struct StringPoolStats
+		{
+			uint32_t strings;       // distinct strings interned
+			uint64_t arenaBytes;    // bytes of the arena blocks holding their characters
+			uint64_t lookups;       // calls to Intern with a non-null view
+			uint64_t hits;          // lookups that found the string already interned
+		};
+
+		/// <summary>
+		/// Append-only pool of UTF-16 strings, each identified by a 32-bit id.
+		/// </summary>
+		/// <remarks>
+		/// Profile names, icon paths, tab titles, command lines and starting directories repeat across every
+		/// snapshot of the same settings; the parsing layer interns them so that each distinct string is kept
+		/// once and parsed layouts refer to ids. Characters live in arena blocks that are never moved or freed,
+		/// so a view returned by View stays valid for the lifetime of the pool. Id 0 is the null view; an empty
+		/// string has an id of its own. The lookup table is split into shards by hash: finding an interned
+		/// string takes one shard's shared lock, and only a new string takes it exclusively. All members are
+		/// thread-safe.
+		/// </remarks>
+		class StringPool
+		{
+		public:
+			static constexpr uint32_t NullId = 0;
+
+			WINAPIHELPERS_API StringPool();
+			WINAPIHELPERS_API ~StringPool();
+
+			StringPool(const StringPool&) = delete;
+			StringPool& operator=(const StringPool&) = delete;
+
+			/// <summary>
+			/// Returns the id of a string, adding it to the pool the first time it is seen.
+			/// </summary>
+			/// <param name="text">The string; a default-constructed view yields NullId.</param>
+			WINAPIHELPERS_API uint32_t Intern(std::u16string_view text);
+
+			/// <summary>
+			/// Returns the characters of an id; NullId and unknown ids yield a null view.
+			/// </summary>
+			WINAPIHELPERS_API std::u16string_view View(uint32_t id) const noexcept;
+
+			/// <summary>
+			/// Number of ids handed out, NullId included; every id below it is valid.
+			/// </summary>
+			WINAPIHELPERS_API uint32_t Size() const noexcept;
+
+			WINAPIHELPERS_API StringPoolStats Stats() const noexcept;
+
+			/// <summary>
+			/// The process-wide pool shared by the parsers and the managed wrappers.
+			/// </summary>
+			WINAPIHELPERS_API static StringPool& Shared();
+
+		private:
+			struct State;
+			std::unique_ptr<State> m_state;
+		};
+
+	}
+} // namespace WTLayoutManager::Services
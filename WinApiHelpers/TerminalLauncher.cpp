@@ -0,0 +1,871 @@
+﻿#include "pch.h"
+#include "TerminalLauncher.h"
+#include "HookTelemetry.h"
+#include "LauncherArguments.h"
+#include <algorithm>
+#include <cstring>
+#include <cwchar>
+#include <filesystem>
+#include <mutex>
+
+#if defined(_WIN32)
+#include "WinApiHelpers.h"
+#include "NativeLog.h"
+#include "RuntimeMetrics.h"
+#include "ResourceAccounting.h"
+#include "InstanceRegistry.h"
+#include "HookTelemetryChannel.h"
+#include <chrono>
+#include <optional>
+#endif
+
+using namespace WTLayoutManager::Services;
+
+#if !defined(_WIN32)
+extern char** environ;
+#endif
+
+namespace
+{
+	/**
+	 * Merges the environment of this process with entries, as CreateMergedEnvironmentBlock does.
+	 *
+	 * @param entries NAME=VALUE entries, appended after the inherited variables.
+	 * @return The entries of the merged environment, each NUL terminated, without the block's final NUL.
+	 */
+	std::vector<wchar_t> MergedEnvironment(const std::vector<std::wstring>& entries)
+	{
+		std::vector<wchar_t> block;
+#if defined(_WIN32)
+		std::unique_ptr<wchar_t[]> merged(WinApiHelpers::CreateMergedEnvironmentBlock(entries));
+		if (merged)
+		{
+			const wchar_t* end = merged.get();
+			while (*end != L'\0')
+			{
+				end += wcslen(end) + 1;
+			}
+			block.assign(merged.get(), end);
+			return block;
+		}
+#else
+		for (char** variable = environ; *variable != nullptr; ++variable)
+		{
+			const char* entry = *variable;
+			block.insert(block.end(), entry, entry + strlen(entry));
+			block.push_back(L'\0');
+		}
+#endif
+		for (const std::wstring& entry : entries)
+		{
+			block.insert(block.end(), entry.begin(), entry.end());
+			block.push_back(L'\0');
+		}
+		return block;
+	}
+}
+
+#if defined(_WIN32)
+
+namespace
+{
+	/// How long a launch keeps its scheduler slot while the terminal initializes.
+	constexpr DWORD TerminalReadyTimeoutMilliseconds = 10000;
+
+	/// How long an elevated launch waits for the launcher to create the accounting container of its target.
+	constexpr uint32_t LauncherAccountTimeoutMilliseconds = 3000;
+
+	/// How long a launch waits for a reporting hook to report from Windows Terminal before it searches the process list.
+	constexpr std::chrono::milliseconds HookAttachTimeout{ 3000 };
+
+	/// A reporting hook reports from wt.exe as soon as it runs; one that has not by then was replaced by
+	/// a hook that does not report.
+	constexpr std::chrono::milliseconds HookSilence{ 250 };
+
+	/**
+	 * Logs a failed call of a launch.
+	 *
+	 * @param event The log event, e.g. "launch.create_process".
+	 * @param code The Win32 error.
+	 * @param appPath The application being launched.
+	 * @param error Receives the event and the code.
+	 */
+	void Fail(const char* event, DWORD code, const std::wstring& appPath, LaunchError& error)
+	{
+		NativeLog::Write(LogLevel::Error, event, code, { LogArg("app", appPath.c_str()) });
+		error.event = event;
+		error.code = code;
+	}
+
+	/**
+	 * Counts a launch in the runtime metrics: started when constructed, failed when destroyed unless
+	 * Succeeded() was called first, so every error path is counted.
+	 */
+	class LaunchMetrics
+	{
+	public:
+		explicit LaunchMetrics(bool elevated)
+		{
+			RuntimeMetrics::Add(MetricCounter::LaunchesStarted);
+			RuntimeMetrics::Add(elevated ? MetricCounter::ElevatedLaunches : MetricCounter::NormalLaunches);
+		}
+
+		~LaunchMetrics()
+		{
+			if (!m_succeeded)
+			{
+				RuntimeMetrics::Add(MetricCounter::LaunchesFailed);
+			}
+		}
+
+		LaunchMetrics(const LaunchMetrics&) = delete;
+		LaunchMetrics& operator=(const LaunchMetrics&) = delete;
+
+		void Succeeded()
+		{
+			if (!m_succeeded)
+			{
+				m_succeeded = true;
+				RuntimeMetrics::Add(MetricCounter::LaunchesSucceeded);
+			}
+		}
+
+	private:
+		bool m_succeeded = false;
+	};
+
+	/**
+	 * Keeps the WatchedProcesses gauge raised while a process is waited on.
+	 */
+	class WatchedProcess
+	{
+	public:
+		WatchedProcess() { RuntimeMetrics::Add(MetricCounter::WatchedProcesses); }
+		~WatchedProcess() { RuntimeMetrics::Add(MetricCounter::WatchedProcesses, -1); }
+
+		WatchedProcess(const WatchedProcess&) = delete;
+		WatchedProcess& operator=(const WatchedProcess&) = delete;
+	};
+
+	/// The hook DLLs that advertised HookReportsProcesses on their last launch.
+	std::mutex ReportingHooksLock;
+	std::vector<std::string> ReportingHooks;
+
+	/**
+	 * Whether the hook reported on its last launch. A hook only runs once its process is resumed, too
+	 * late for the launch to learn this from its own channel, so the launch goes by the previous one.
+	 */
+	bool HookReports(const char* hookPath)
+	{
+		std::lock_guard<std::mutex> lock(ReportingHooksLock);
+		return std::find(ReportingHooks.begin(), ReportingHooks.end(), hookPath) != ReportingHooks.end();
+	}
+
+	/// Records whether the hook advertised HookReportsProcesses on a launch.
+	void RecordHookReports(const char* hookPath, bool reports)
+	{
+		std::lock_guard<std::mutex> lock(ReportingHooksLock);
+		const auto found = std::find(ReportingHooks.begin(), ReportingHooks.end(), hookPath);
+		if (reports && found == ReportingHooks.end())
+		{
+			ReportingHooks.emplace_back(hookPath);
+		}
+		else if (!reports && found != ReportingHooks.end())
+		{
+			ReportingHooks.erase(found);
+		}
+	}
+
+	/**
+	 * Puts a suspended process in an accounting container of its own.
+	 *
+	 * A launch that cannot be accounted for still runs; the failure is logged.
+	 *
+	 * @param processId The suspended process.
+	 * @param limits The caps of the container.
+	 * @param appPath The application being launched.
+	 *
+	 * @return The container, or nullptr if it could not be created or assigned.
+	 */
+	std::unique_ptr<ProcessTreeAccount> AccountFor(DWORD processId, const ResourceLimits& limits, const std::wstring& appPath)
+	{
+		std::error_code ec;
+		std::unique_ptr<ProcessTreeAccount> account = ProcessTreeAccount::Create(limits, nullptr, ec);
+		if (account && !account->Assign(processId, ec))
+		{
+			account.reset();
+		}
+		if (!account)
+		{
+			NativeLog::Write(LogLevel::Warning, "launch.accounting", static_cast<uint32_t>(ec.value()), { LogArg("app", appPath.c_str()) });
+		}
+		return account;
+	}
+
+	/**
+	 * A terminal this process waits for: registered as running its folder and accounted for until it exits.
+	 *
+	 * A launch closed while its terminal still runs leaves the registry entry, which is swept once the
+	 * terminal exits, so the folder keeps being reported as running.
+	 */
+	class Win32Launch : public TerminalLaunch
+	{
+	public:
+		Win32Launch(const TerminalLaunchRequest& request, bool elevated)
+			: m_metrics(elevated), m_appPath(request.applicationPath), m_folder(request.localStateFolder), m_elevated(elevated)
+		{
+		}
+
+		uint32_t ProcessId() const noexcept override
+		{
+			return m_processId;
+		}
+
+		void* WaitHandle() const noexcept override
+		{
+			return m_terminal.get();
+		}
+
+		LaunchWaitResult Wait(uint32_t timeoutMilliseconds, uint32_t& exitCode, LaunchError& error) override
+		{
+			if (!m_exited)
+			{
+				WatchedProcess watched;
+				const LaunchWaitResult result = WaitForExit(timeoutMilliseconds, error);
+				if (result != LaunchWaitResult::Exited)
+				{
+					return result;
+				}
+			}
+			exitCode = m_exitCode;
+			return LaunchWaitResult::Exited;
+		}
+
+	protected:
+		/// Takes over the terminal once it runs.
+		void Attach(HandlePtr terminal)
+		{
+			m_terminal = std::move(terminal);
+			m_processId = GetProcessId(m_terminal.get());
+			m_metrics.Succeeded();
+			if (!m_folder.empty())
+			{
+				m_registration = InstanceRegistry::Register(m_folder, m_processId, m_elevated);
+			}
+		}
+
+		/// Records the exit code and stops accounting for the tree.
+		void Exited(DWORD exitCode)
+		{
+			m_exitCode = exitCode;
+			m_exited = true;
+			InstanceRegistry::Unregister(m_registration);
+			m_registration = 0;
+			m_tracked.reset();
+			SummarizeHook();
+		}
+
+		/**
+		 * Creates the telemetry channel of the hook.
+		 *
+		 * @return The name to pass in HookTelemetryVariable, or an empty name if no channel could be created.
+		 */
+		const std::wstring& OpenHookChannel()
+		{
+			if (!m_hook.Create())
+			{
+				NativeLog::Write(LogLevel::Warning, "launch.hook_channel", GetLastError(), { LogArg("app", m_appPath.c_str()) });
+			}
+			return m_hook.Name();
+		}
+
+		/**
+		 * Creates the telemetry channel of the hook and names it in the environment of the launch.
+		 *
+		 * @param environment The variables the request adds to the terminal's environment.
+		 * @return The variables plus the channel's, or the variables alone if no channel could be created.
+		 */
+		std::vector<std::wstring> WithHookChannel(const std::vector<std::wstring>& environment)
+		{
+			std::vector<std::wstring> result = environment;
+			const std::wstring& name = OpenHookChannel();
+			if (!name.empty())
+			{
+				result.push_back(std::wstring(HookTelemetryVariable) + L"=" + name);
+			}
+			return result;
+		}
+
+		/// Consumes the events the hook posted since the last call.
+		void DrainHook()
+		{
+			HookEvent events[64];
+			size_t count;
+			while ((count = m_hook.Read(events, std::size(events))) != 0)
+			{
+				for (size_t i = 0; i < count; ++i)
+				{
+					const HookEvent& event = events[i];
+					switch (event.kind)
+					{
+					case HookEventKind::Attached:
+						m_hookProcesses.push_back(event.processId);
+						RuntimeMetrics::Add(MetricCounter::HookAttaches);
+						break;
+					case HookEventKind::RedirectConfigured:
+						if (event.value == 0)
+						{
+							NativeLog::Write(LogLevel::Warning, "hook.not_redirected", 0,
+								{ LogArg("app", m_appPath.c_str()), LogArg("pid", event.processId) });
+						}
+						break;
+					case HookEventKind::InitCompleted:
+						RuntimeMetrics::Record(MetricHistogram::HookInit, event.durationNanoseconds / 1000);
+						break;
+					default:
+						break;
+					}
+				}
+			}
+		}
+
+		/// Publishes what the hook counted and logs it, once the terminal exited.
+		void SummarizeHook()
+		{
+			if (!m_hook.IsOpen())
+			{
+				return;
+			}
+			DrainHook();
+			const HookTelemetryTotals totals = m_hook.Totals();
+			const uint64_t opens = totals.counters[static_cast<size_t>(HookCounter::FileOpens)];
+			const uint64_t rewritten = totals.counters[static_cast<size_t>(HookCounter::FileOpensRewritten)];
+			const uint64_t failures = totals.counters[static_cast<size_t>(HookCounter::RedirectFailures)];
+			RuntimeMetrics::Add(MetricCounter::HookFileOpensRewritten, static_cast<int64_t>(rewritten));
+			RuntimeMetrics::Add(MetricCounter::HookRedirectFailures, static_cast<int64_t>(failures));
+			RuntimeMetrics::Add(MetricCounter::HookEventsDropped, static_cast<int64_t>(totals.dropped));
+			NativeLog::Write(LogLevel::Info, "hook.summary", 0, {
+				LogArg("app", m_appPath.c_str()),
+				LogArg("processes", totals.lanes),
+				LogArg("opens", opens),
+				LogArg("rewritten", rewritten),
+				LogArg("failures", failures),
+				LogArg("dropped", totals.dropped) });
+		}
+
+		virtual LaunchWaitResult WaitForExit(uint32_t timeoutMilliseconds, LaunchError& error)
+		{
+			return WaitForTerminal(timeoutMilliseconds, error);
+		}
+
+		LaunchWaitResult WaitForTerminal(DWORD timeoutMilliseconds, LaunchError& error)
+		{
+			const DWORD wait = WaitForSingleObject(m_terminal.get(), timeoutMilliseconds);
+			if (wait == WAIT_TIMEOUT)
+			{
+				return LaunchWaitResult::Timeout;
+			}
+			DWORD exitCode = 0;
+			if (wait != WAIT_OBJECT_0 || !GetExitCodeProcess(m_terminal.get(), &exitCode))
+			{
+				Fail("launch.exit_code", GetLastError(), m_appPath, error);
+				return LaunchWaitResult::Failed;
+			}
+			Exited(exitCode);
+			return LaunchWaitResult::Exited;
+		}
+
+		LaunchMetrics m_metrics;
+		std::wstring m_appPath;
+		std::wstring m_folder;
+		std::optional<TrackedAccount> m_tracked;
+		HookTelemetryChannel m_hook;
+		std::vector<uint32_t> m_hookProcesses;  // the processes the hook reported from, in order
+
+	private:
+		bool m_elevated;
+		HandlePtr m_terminal;
+		uint32_t m_processId = 0;
+		uint64_t m_registration = 0;
+		bool m_exited = false;
+		DWORD m_exitCode = 0;
+	};
+
+	/**
+	 * A terminal started by this process with the hook DLL injected.
+	 */
+	class DirectLaunch final : public Win32Launch
+	{
+	public:
+		explicit DirectLaunch(const TerminalLaunchRequest& request)
+			: Win32Launch(request, false)
+		{
+		}
+
+		/**
+		 * Waits for a slot of the shared scheduler, creates the process suspended at the policy's priority,
+		 * restricts its affinity (inherited by the terminal it starts), resumes it when the scheduler
+		 * allows, and keeps the slot until the terminal's window is ready. A compiled request is started
+		 * from its prebuilt command line, environment and hook path.
+		 *
+		 * @return false on error, with error set.
+		 */
+		bool Start(const TerminalLaunchRequest& request, LaunchError& error)
+		{
+			const LaunchPolicy& policy = request.policy;
+			const CompiledLaunchRequest* compiled = request.compiled.get();
+
+			// CreateProcess may write to the command line.
+			std::vector<wchar_t> commandLine;
+			std::unique_ptr<wchar_t[]> merged;
+			std::string converted;
+			DWORD dwCreationFlags = WinApiHelpers::PriorityClassFlag(policy.priority) | CREATE_NEW_CONSOLE | CREATE_NEW_PROCESS_GROUP | CREATE_SUSPENDED;
+			if (compiled != nullptr)
+			{
+				commandLine = compiled->commandLine;
+				merged = compiled->EnvironmentBlock(OpenHookChannel());
+				dwCreationFlags |= CREATE_UNICODE_ENVIRONMENT;
+			}
+			else
+			{
+				commandLine.assign(request.commandLine.begin(), request.commandLine.end());
+				commandLine.push_back(L'\0');
+				const std::vector<std::wstring> environment = WithHookChannel(request.environment);
+				if (!environment.empty())
+				{
+					merged.reset(WinApiHelpers::CreateMergedEnvironmentBlock(environment));
+					dwCreationFlags |= CREATE_UNICODE_ENVIRONMENT;
+				}
+				converted = WinApiHelpers::WideToUtf8(request.hookPath);
+			}
+			const char* hook = compiled != nullptr ? compiled->hookPath.c_str() : converted.c_str();
+
+			STARTUPINFOEXW si{ sizeof(si) };
+			si.StartupInfo.wShowWindow = SW_SHOWDEFAULT;
+			process_info_raii pi;
+
+			LaunchSlot slot(LaunchScheduler::Shared(), policy);
+			BOOL success = WinApiHelpers::DetourCreateProcessWithDllExWrap(
+				request.applicationPath.c_str(),
+				commandLine.data(),
+				nullptr, nullptr,   // security attrs
+				FALSE,              // inherit handles
+				dwCreationFlags,
+				merged.get(),       // Custom environment block
+				nullptr,            // cwd
+				&si.StartupInfo,
+				(PROCESS_INFORMATION*)pi,
+				hook,               // *** injected DLL
+				nullptr);           // default create-process routine
+
+			if (!success)
+			{
+				Fail("launch.create_process", GetLastError(), m_appPath, error);
+				return false;
+			}
+
+			if (!WinApiHelpers::ApplyLaunchPolicy(pi.pi.hProcess, policy))
+			{
+				NativeLog::Write(LogLevel::Warning, "launch.policy", GetLastError(), { LogArg("app", m_appPath.c_str()) });
+			}
+			m_tracked.emplace(m_folder, AccountFor(pi.pi.dwProcessId, policy.limits, m_appPath));
+
+			slot.WaitResume();
+			ResumeThread(pi.pi.hThread);
+
+			// Only a hook that reported before is waited for; any other launch searches the process list at once.
+			HandlePtr terminal = HookReports(hook) ? WaitForHookedTerminal(pi.pi.dwProcessId) : HandlePtr();
+			if (terminal.get() == nullptr)
+			{
+				terminal = WinApiHelpers::GetWindowsTerminalHandle(pi.pi.dwProcessId);
+			}
+			// The hook ran in wt.exe before it started the terminal, so it has advertised by now if it ever does.
+			RecordHookReports(hook, (m_hook.Capabilities() & HookReportsProcesses) != 0);
+			if (terminal.get() == nullptr)
+			{
+				Fail("launch.terminal_not_found", ERROR_NOT_FOUND, m_appPath, error);
+				return false;
+			}
+			// The priority class is not inherited above normal; the affinity already is.
+			SetPriorityClass(terminal.get(), WinApiHelpers::PriorityClassFlag(policy.priority));
+
+			// The slot is held while the terminal initializes, so the window bounds the terminals competing
+			// for the CPU at once.
+			WinApiHelpers::WaitForTerminalWindow(terminal.get(), TerminalReadyTimeoutMilliseconds);
+			slot.Finish();
+			Attach(std::move(terminal));
+			return true;
+		}
+
+	private:
+		/**
+		 * Opens a process the hook reported from if it is a Windows Terminal.
+		 *
+		 * @return The process, with the rights GetWindowsTerminalHandle asks for, or an empty handle.
+		 */
+		static HandlePtr OpenHookedTerminal(DWORD processId)
+		{
+			HandlePtr process(OpenProcess(SYNCHRONIZE | PROCESS_QUERY_INFORMATION | PROCESS_SET_INFORMATION, FALSE, processId));
+			if (!process)
+			{
+				process.reset(OpenProcess(SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId));
+			}
+			wchar_t image[MAX_PATH];
+			DWORD length = MAX_PATH;
+			if (!process || !QueryFullProcessImageNameW(process.get(), 0, image, &length))
+			{
+				return HandlePtr();
+			}
+			const wchar_t* name = wcsrchr(image, L'\\');
+			name = name != nullptr ? name + 1 : image;
+			return _wcsicmp(name, L"WindowsTerminal.exe") == 0 ? std::move(process) : HandlePtr();
+		}
+
+		/**
+		 * Waits for the hook to report from the Windows Terminal that wt.exe starts.
+		 *
+		 * The events are polled from the channel, which costs a few loads per poll where the process list
+		 * costs a snapshot. Called only for a hook that reported on its last launch; if it does not report
+		 * from wt.exe within HookSilence, the caller falls back to searching the process list.
+		 *
+		 * @param launcherId The resumed wt.exe.
+		 * @return The terminal, or an empty handle.
+		 */
+		HandlePtr WaitForHookedTerminal(DWORD launcherId)
+		{
+			if (!m_hook.IsOpen())
+			{
+				return HandlePtr();
+			}
+			const auto resumed = std::chrono::steady_clock::now();
+			size_t checked = 0;
+			DWORD delay = 1;
+			for (;;)
+			{
+				DrainHook();
+				for (; checked < m_hookProcesses.size(); ++checked)
+				{
+					if (m_hookProcesses[checked] == launcherId)
+					{
+						continue;
+					}
+					HandlePtr terminal = OpenHookedTerminal(m_hookProcesses[checked]);
+					if (terminal)
+					{
+						const uint64_t elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+							std::chrono::steady_clock::now() - resumed).count());
+						RuntimeMetrics::Record(MetricHistogram::HookAttach, elapsed);
+						RuntimeMetrics::Record(MetricHistogram::TerminalDiscovery, elapsed);
+						return terminal;
+					}
+				}
+				const auto elapsed = std::chrono::steady_clock::now() - resumed;
+				if (elapsed >= HookAttachTimeout || (m_hookProcesses.empty() && elapsed >= HookSilence))
+				{
+					NativeLog::Write(LogLevel::Warning, "launch.hook_silent", ERROR_TIMEOUT, {
+						LogArg("app", m_appPath.c_str()), LogArg("processes", m_hookProcesses.size()) });
+					return HandlePtr();
+				}
+				WinApiHelpers::Sleep(delay);
+				delay = delay < 8 ? delay * 2 : 10;
+			}
+		}
+	};
+
+	/**
+	 * A terminal started by the elevated launcher.
+	 *
+	 * The policy and the LocalState folder are passed to the launcher, which applies the policy to the
+	 * target process. Once the terminal runs, the launcher hands a handle to it back through a pipe and
+	 * exits, and the terminal is registered and waited for here. If the pipe cannot be created or the
+	 * handoff fails, the launcher registers the terminal and stays until it exits, and its exit code is
+	 * the terminal's.
+	 */
+	class ElevatedLaunch final : public Win32Launch
+	{
+	public:
+		explicit ElevatedLaunch(const TerminalLaunchRequest& request)
+			: Win32Launch(request, true)
+		{
+		}
+
+		/**
+		 * Starts the launcher, holding the scheduler slot until it runs.
+		 *
+		 * @return false on error, with error set.
+		 */
+		bool Start(const TerminalLaunchRequest& request, LaunchError& error)
+		{
+			std::wstring handoffName;
+			m_handoff = WinApiHelpers::CreateHandoffPipe(handoffName);
+			if (!m_handoff)
+			{
+				NativeLog::Write(LogLevel::Warning, "launch.handoff", GetLastError(), { LogArg("app", m_appPath.c_str()) });
+			}
+
+			// The launcher splits the environment at semicolons. The hook in the elevated terminal reports
+			// through the channel too; it is only counted and summarized, since the launcher finds the terminal.
+			std::wstring parameters;
+			if (request.compiled)
+			{
+				parameters = request.compiled->LauncherParameters(OpenHookChannel(), handoffName);
+			}
+			else
+			{
+				std::wstring environment;
+				for (const std::wstring& entry : WithHookChannel(request.environment))
+				{
+					environment += entry;
+					environment += L';';
+				}
+				parameters = LauncherArguments::QuoteArgument(request.applicationPath)
+					+ L" " + LauncherArguments::QuoteArgument(request.commandLine)
+					+ L" " + LauncherArguments::QuoteArgument(environment)
+					+ L" " + LauncherArguments::QuoteArgument(request.hookPath)
+					+ L" " + LauncherArguments::QuoteArgument(LaunchScheduler::FormatPolicy(request.policy))
+					+ L" " + LauncherArguments::QuoteArgument(m_folder)
+					+ L" " + LauncherArguments::QuoteArgument(handoffName);
+			}
+
+			shellexecuteinfow_raii sei;
+			sei.sei.cbSize = sizeof(sei);
+			sei.sei.fMask = SEE_MASK_NOCLOSEPROCESS;
+			sei.sei.lpVerb = L"runas"; // Request elevation (UAC prompt)
+			sei.sei.lpFile = request.launcherPath.c_str();
+			sei.sei.lpParameters = parameters.c_str();
+			sei.sei.nShow = SW_HIDE;
+
+			LaunchSlot slot(LaunchScheduler::Shared(), request.policy);
+			slot.WaitResume();
+			if (!ShellExecuteEx((SHELLEXECUTEINFOW*)sei))
+			{
+				Fail("launch.elevate", GetLastError(), m_appPath, error);
+				return false;
+			}
+			slot.Finish();
+			m_launcher.reset(sei.sei.hProcess);
+			sei.sei.hProcess = INVALID_HANDLE_VALUE;
+
+			// The launcher creates the container of its target under a name derived from its process id.
+			std::error_code accountError;
+			std::unique_ptr<ProcessTreeAccount> account = ProcessTreeAccount::Open(
+				ProcessTreeAccount::LauncherAccountName(GetProcessId(m_launcher.get())).c_str(), LauncherAccountTimeoutMilliseconds, accountError);
+			if (!account)
+			{
+				NativeLog::Write(LogLevel::Warning, "launch.accounting", static_cast<uint32_t>(accountError.value()), { LogArg("app", m_appPath.c_str()) });
+			}
+			m_tracked.emplace(m_folder, std::move(account));
+			return true;
+		}
+
+		void* WaitHandle() const noexcept override
+		{
+			return m_launcher ? m_launcher.get() : Win32Launch::WaitHandle();
+		}
+
+	protected:
+		LaunchWaitResult WaitForExit(uint32_t timeoutMilliseconds, LaunchError& error) override
+		{
+			const ULONGLONG started = GetTickCount64();
+			if (m_launcher)
+			{
+				// After a handoff the launcher exits once the terminal runs.
+				const DWORD wait = WaitForSingleObject(m_launcher.get(), timeoutMilliseconds);
+				if (wait == WAIT_TIMEOUT)
+				{
+					return LaunchWaitResult::Timeout;
+				}
+
+				DWORD terminalId = 0;
+				HandlePtr terminal = m_handoff ? WinApiHelpers::ReceiveHandoff(m_handoff.get(), terminalId) : HandlePtr();
+				m_handoff.reset();
+				if (!terminal)
+				{
+					DWORD exitCode = 0;
+					if (wait != WAIT_OBJECT_0 || !GetExitCodeProcess(m_launcher.get(), &exitCode))
+					{
+						Fail("launch.exit_code", GetLastError(), m_appPath, error);
+						return LaunchWaitResult::Failed;
+					}
+					m_launcher.reset();
+					if (exitCode == static_cast<DWORD>(-1))
+					{
+						// The launcher logged why in ElevatedLauncher.log.
+						Fail("launch.launcher_failed", exitCode, m_appPath, error);
+						return LaunchWaitResult::Failed;
+					}
+					if (exitCode == 0)
+					{
+						m_metrics.Succeeded();
+					}
+					Exited(exitCode);
+					return LaunchWaitResult::Exited;
+				}
+				m_launcher.reset();
+				Attach(std::move(terminal));
+			}
+
+			DWORD remaining = timeoutMilliseconds;
+			if (timeoutMilliseconds != LaunchBackend::Infinite)
+			{
+				const ULONGLONG elapsed = GetTickCount64() - started;
+				remaining = elapsed >= timeoutMilliseconds ? 0 : static_cast<DWORD>(timeoutMilliseconds - elapsed);
+			}
+			return WaitForTerminal(remaining, error);
+		}
+
+	private:
+		HandlePtr m_launcher;
+		HandlePtr m_handoff;
+	};
+
+	class Win32LaunchBackend final : public LaunchBackend
+	{
+	public:
+		std::unique_ptr<TerminalLaunch> Start(const TerminalLaunchRequest& request, LaunchError& error) override
+		{
+			if (request.launcherPath.empty())
+			{
+				auto launch = std::make_unique<DirectLaunch>(request);
+				if (!launch->Start(request, error))
+				{
+					return nullptr;
+				}
+				return launch;
+			}
+			auto launch = std::make_unique<ElevatedLaunch>(request);
+			if (!launch->Start(request, error))
+			{
+				return nullptr;
+			}
+			return launch;
+		}
+	};
+
+	std::shared_ptr<LaunchBackend> DefaultBackend()
+	{
+		return std::make_shared<Win32LaunchBackend>();
+	}
+}
+
+#else
+
+namespace
+{
+	std::shared_ptr<LaunchBackend> DefaultBackend()
+	{
+		return nullptr;
+	}
+}
+
+#endif
+
+namespace
+{
+	std::mutex BackendLock;
+
+	std::shared_ptr<LaunchBackend>& InstalledBackend()
+	{
+		static std::shared_ptr<LaunchBackend> backend = DefaultBackend();
+		return backend;
+	}
+}
+
+/**
+ * Prebuilds what starting a request takes but the names of its telemetry channel and handoff pipe.
+ *
+ * @param request The request; its environment is merged with this process's environment now.
+ * @return The compiled forms.
+ */
+std::shared_ptr<const CompiledLaunchRequest> CompiledLaunchRequest::Build(const TerminalLaunchRequest& request)
+{
+	auto compiled = std::make_shared<CompiledLaunchRequest>();
+	compiled->commandLine.assign(request.commandLine.begin(), request.commandLine.end());
+	compiled->commandLine.push_back(L'\0');
+	const std::u8string hook = std::filesystem::path(request.hookPath).u8string();
+	compiled->hookPath.assign(hook.begin(), hook.end());
+
+	const std::wstring channel = std::wstring(HookTelemetryVariable) + L"=";
+	if (request.launcherPath.empty())
+	{
+		std::vector<std::wstring> entries = request.environment;
+		entries.push_back(channel);
+		compiled->environment = MergedEnvironment(entries);
+		compiled->environment.pop_back();   // the channel's entry is last, left open for its name
+	}
+	else
+	{
+		// The environment argument is quoted whole and cut before its closing quote; the channel name
+		// needs no escaping, and the entry is closed in the tail.
+		std::wstring environment;
+		for (const std::wstring& entry : request.environment)
+		{
+			environment += entry;
+			environment += L';';
+		}
+		environment += channel;
+		compiled->launcherHead = LauncherArguments::QuoteArgument(request.applicationPath)
+			+ L" " + LauncherArguments::QuoteArgument(request.commandLine)
+			+ L" " + LauncherArguments::QuoteArgument(environment);
+		compiled->launcherHead.pop_back();
+		compiled->launcherTail = L";\" " + LauncherArguments::QuoteArgument(request.hookPath)
+			+ L" " + LauncherArguments::QuoteArgument(LaunchScheduler::FormatPolicy(request.policy))
+			+ L" " + LauncherArguments::QuoteArgument(request.localStateFolder)
+			+ L" ";
+	}
+	return compiled;
+}
+
+/**
+ * Completes the environment block with the name of a launch's channel.
+ *
+ * @param channelName The channel, or empty to leave the variable empty, which the hook ignores.
+ * @return The double NUL terminated block.
+ */
+std::unique_ptr<wchar_t[]> CompiledLaunchRequest::EnvironmentBlock(const std::wstring& channelName) const
+{
+	std::unique_ptr<wchar_t[]> block(new wchar_t[environment.size() + channelName.size() + 2]);
+	wchar_t* end = std::copy(environment.begin(), environment.end(), block.get());
+	end = std::copy(channelName.begin(), channelName.end(), end);
+	end[0] = L'\0';
+	end[1] = L'\0';
+	return block;
+}
+
+/**
+ * Completes the launcher's parameters with the names of a launch's channel and handoff pipe.
+ *
+ * @param channelName The channel, or empty.
+ * @param handoffName The pipe, or empty if the launch has none.
+ * @return The parameters.
+ */
+std::wstring CompiledLaunchRequest::LauncherParameters(const std::wstring& channelName, const std::wstring& handoffName) const
+{
+	const std::wstring handoff = LauncherArguments::QuoteArgument(handoffName);
+	std::wstring parameters;
+	parameters.reserve(launcherHead.size() + channelName.size() + launcherTail.size() + handoff.size());
+	parameters.append(launcherHead).append(channelName).append(launcherTail).append(handoff);
+	return parameters;
+}
+
+/**
+ * Returns the installed backend.
+ *
+ * @return The backend, or nullptr on a platform without a default one.
+ */
+std::shared_ptr<LaunchBackend> LaunchBackend::Current()
+{
+	std::lock_guard<std::mutex> lock(BackendLock);
+	return InstalledBackend();
+}
+
+/**
+ * Replaces the backend.
+ *
+ * @param backend The new backend, or nullptr for the default one.
+ */
+void LaunchBackend::Install(std::shared_ptr<LaunchBackend> backend)
+{
+	std::lock_guard<std::mutex> lock(BackendLock);
+	InstalledBackend() = backend ? std::move(backend) : DefaultBackend();
+}
@@ -0,0 +1,143 @@
+﻿#pragma once
+
+#include "WinApiHelpersExport.h"
+#include "LaunchScheduler.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace WTLayoutManager {
+	namespace Services {
+
+		struct TerminalLaunchRequest;
+
+		/// <summary>
+		/// The forms of a request the Windows backend starts a terminal from, built once by a LaunchPlan.
+		/// </summary>
+		/// <remarks>
+		/// The environment is the inherited one merged with the request's, frozen when the request is
+		/// compiled; it ends with the telemetry variable (HookTelemetryVariable) left open, so a launch
+		/// only appends the name of its channel, or nothing, and the terminating NULs. The launcher's
+		/// parameters are split around the same place, and the launch appends its handoff pipe.
+		/// </remarks>
+		struct CompiledLaunchRequest
+		{
+			std::vector<wchar_t> commandLine;       // NUL terminated; CreateProcess gets a copy it may write to
+			std::vector<wchar_t> environment;       // NUL separated entries, the last one open
+			std::string hookPath;                   // UTF-8, as Detours takes it
+			std::wstring launcherHead;              // the launcher's parameters up to the channel name
+			std::wstring launcherTail;              // the rest of the environment argument and what follows, but the pipe
+
+			/// <summary>
+			/// Builds the compiled forms of a request; an elevated request gets the launcher's parameters,
+			/// a direct one the environment block.
+			/// </summary>
+			WINAPIHELPERS_API static std::shared_ptr<const CompiledLaunchRequest> Build(const TerminalLaunchRequest& request);
+
+			/// <summary>
+			/// Returns the environment block of a launch whose channel has the given name, or none if empty.
+			/// </summary>
+			WINAPIHELPERS_API std::unique_ptr<wchar_t[]> EnvironmentBlock(const std::wstring& channelName) const;
+
+			/// <summary>
+			/// Returns the launcher's parameters of a launch with the given channel and handoff pipe.
+			/// </summary>
+			WINAPIHELPERS_API std::wstring LauncherParameters(const std::wstring& channelName, const std::wstring& handoffName) const;
+		};
+
+		/// <summary>
+		/// What to launch.
+		/// </summary>
+		struct TerminalLaunchRequest
+		{
+			std::wstring applicationPath;
+			std::wstring commandLine;
+			std::wstring hookPath;                  // the DLL injected into the terminal
+			std::vector<std::wstring> environment;  // NAME=VALUE entries added to the inherited environment
+			std::wstring launcherPath;              // if set, the terminal is started elevated by this launcher
+			std::wstring localStateFolder;          // registers and accounts for the terminal under it; may be empty
+			LaunchPolicy policy;
+			std::shared_ptr<const CompiledLaunchRequest> compiled;  // set by a LaunchPlan; the Windows backend then starts from it
+			                                                        // instead of commandLine, environment and hookPath
+		};
+
+		/// <summary>
+		/// Why a launch failed: the event it was logged as and the system error.
+		/// </summary>
+		struct LaunchError
+		{
+			const char* event = nullptr;
+			uint32_t code = 0;
+		};
+
+		enum class LaunchWaitResult : uint8_t
+		{
+			Exited,
+			Timeout,
+			Failed
+		};
+
+		/// <summary>
+		/// A started terminal, owned by whoever waits for it.
+		/// </summary>
+		/// <remarks>
+		/// Wait may be called again after a timeout, and returns the same exit code once the terminal exited.
+		/// It must not be called from two threads at once. Destroying a launch does not end the terminal.
+		/// </remarks>
+		class TerminalLaunch
+		{
+		public:
+			virtual ~TerminalLaunch() = default;
+
+			/// <summary>
+			/// The terminal process, or 0 while an elevated launch has not handed it over yet.
+			/// </summary>
+			virtual uint32_t ProcessId() const noexcept = 0;
+
+			/// <summary>
+			/// Waits up to timeoutMilliseconds, or LaunchBackend::Infinite, for the terminal to exit.
+			/// </summary>
+			virtual LaunchWaitResult Wait(uint32_t timeoutMilliseconds, uint32_t& exitCode, LaunchError& error) = 0;
+
+			/// <summary>
+			/// The Win32 handle the next Wait waits on, signalled once Wait(0) makes progress: the launcher
+			/// of an elevated launch until it hands the terminal over, then the terminal. Lets a caller wait
+			/// without a thread; nullptr if the backend has none, and the caller then blocks in Wait.
+			/// </summary>
+			virtual void* WaitHandle() const noexcept { return nullptr; }
+		};
+
+		/// <summary>
+		/// Starts terminals for the wrapper and the flat launch API.
+		/// </summary>
+		/// <remarks>
+		/// The default backend launches for real on Windows and does not exist elsewhere. Tests and hosts
+		/// may install another one; launches already started keep the backend that started them.
+		/// </remarks>
+		class LaunchBackend
+		{
+		public:
+			static constexpr uint32_t Infinite = 0xFFFFFFFF;
+
+			virtual ~LaunchBackend() = default;
+
+			/// <summary>
+			/// Starts a terminal and returns once it runs, or for an elevated launch once the launcher runs.
+			/// </summary>
+			/// <returns>nullptr on error, with error set; the failure is already logged.</returns>
+			virtual std::unique_ptr<TerminalLaunch> Start(const TerminalLaunchRequest& request, LaunchError& error) = 0;
+
+			/// <summary>
+			/// The installed backend, or nullptr if there is none on this platform.
+			/// </summary>
+			WINAPIHELPERS_API static std::shared_ptr<LaunchBackend> Current();
+
+			/// <summary>
+			/// Replaces the backend; nullptr restores the default one.
+			/// </summary>
+			WINAPIHELPERS_API static void Install(std::shared_ptr<LaunchBackend> backend);
+		};
+
+	}
+} // namespace WTLayoutManager::Services
@@ -1,11 +1,23 @@
 ﻿#include "pch.h"
 #include "WinApiHelpers.h"
+#include "RuntimeMetrics.h"
 #include <strsafe.h>
 #include <tlhelp32.h>
 #include <detours.h>
+#include <atomic>
 
 using namespace WTLayoutManager::Services;
 
+// What an elevated launcher writes to a handoff pipe; the handle is valid in the reading process.
+struct HandoffReply
+{
+	uint32_t magic;
+	uint32_t processId;
+	uint64_t processHandle;
+};
+
+static constexpr uint32_t HandoffMagic = 0x31464857; // "WHF1"
+
 /**
  * \brief A RAII wrapper for SHELLEXECUTEINFOW.
  *
@@ -218,41 +230,32 @@ LPWSTR WinApiHelpers::CreateMergedEnvironmentBlock(const std::vector<std::wstrin
 		return nullptr;
 	}
 
-	// Convert parent's environment block into a vector for easy manipulation.
-	std::vector<std::wstring> envVars;
+	// Measure the parent's block in place; it is copied whole, without a string per variable.
+	// parentSize holds the total number of wchar_t's (excluding the final extra null)
 	LPTSTR lpszVariable = (LPTSTR)parentEnv;
 	while (*lpszVariable)
 	{
-		envVars.push_back(std::wstring(lpszVariable));
-		int len = lstrlen(lpszVariable) + 1;
-		lpszVariable += len;
+		lpszVariable += lstrlen(lpszVariable) + 1;
 	}
-	// Calculate the size of the parent's environment block.
-	// parentSize now holds the total number of wchar_t's (excluding the final extra null)
 	size_t parentSize = lpszVariable - parentEnv;
 
-	FreeEnvironmentStringsW(parentEnv);
-
-	// Append or override with additional variables.
+	// Append the additional variables.
 	// (For simplicity, we'll just append here.)
 	// Calculate the total size needed for the merged environment block.
 	size_t totalSize = parentSize;
 	for (const auto& var : additionalVars) {
-		size_t len = var.length() + 1;
-		envVars.push_back(var);
-		totalSize += len;
+		totalSize += var.length() + 1;
 	}
 	totalSize++; // final extra null terminator
 
 	// Allocate the merged environment block.
 	LPWSTR mergedEnv = new WCHAR[totalSize];
-	WCHAR* cur = mergedEnv;
-	for (const auto& var : envVars) {
+	wmemcpy(mergedEnv, parentEnv, parentSize);
+	FreeEnvironmentStringsW(parentEnv);
+	WCHAR* cur = mergedEnv + parentSize;
+	for (const auto& var : additionalVars) {
 		size_t len = var.length() + 1;
-		if (FAILED(StringCchCopy(cur, len, var.c_str()))) {
-			delete[] mergedEnv;
-			return nullptr;
-		}
+		wmemcpy(cur, var.c_str(), len);
 		cur += len;
 	}
 	*cur = (TCHAR)0; // double null termination
@@ -325,13 +328,18 @@ void WinApiHelpers::Sleep(_In_ DWORD dwMilliseconds)
  */
 HandlePtr WinApiHelpers::GetWindowsTerminalHandle(DWORD wtPid)
 {
+	MetricTimer timer(MetricHistogram::TerminalDiscovery);
 	DWORD parentPid = wtPid;
 	HANDLE hReal = nullptr;
+	auto retry = []() {
+		RuntimeMetrics::Add(MetricCounter::TerminalDiscoveryRetries);
+		WinApiHelpers::Sleep(50);
+	};
 	for (int i = 0; i < 60 && !hReal; ++i) {
 		HANDLE hSnap = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
 		if (hSnap == INVALID_HANDLE_VALUE)
 		{
-			WinApiHelpers::Sleep(50);
+			retry();
 			continue;
 		}
 		PROCESSENTRY32 pe{ sizeof(pe) };
@@ -339,18 +347,287 @@ HandlePtr WinApiHelpers::GetWindowsTerminalHandle(DWORD wtPid)
 			if (pe.th32ParentProcessID == parentPid
 				&& _wcsicmp(pe.szExeFile, L"WindowsTerminal.exe") == 0)
 			{
-				// open with SYNCHRONIZE so we can wait on it:
-				DWORD rights = SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION;
-				hReal = OpenProcess(rights, FALSE, pe.th32ProcessID);
+				// open with SYNCHRONIZE so we can wait on it, and if allowed with the rights the launch
+				// policy and WaitForInputIdle need:
+				hReal = OpenProcess(SYNCHRONIZE | PROCESS_QUERY_INFORMATION | PROCESS_SET_INFORMATION, FALSE, pe.th32ProcessID);
+				if (!hReal)
+				{
+					hReal = OpenProcess(SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pe.th32ProcessID);
+				}
 				break;
 			}
 		}
 		CloseHandle(hSnap);
 		if (!hReal)
 		{
-			WinApiHelpers::Sleep(50);
+			retry();
 		}
 	}
+	if (!hReal)
+	{
+		RuntimeMetrics::Add(MetricCounter::TerminalDiscoveryTimeouts);
+	}
 
 	return HandlePtr(hReal);
 }
+
+/**
+ * Maps a launch priority to its CreateProcess flag.
+ *
+ * @param[in] priority The priority.
+ * @return The priority class flag, NORMAL_PRIORITY_CLASS for unknown values.
+ */
+DWORD WinApiHelpers::PriorityClassFlag(LaunchPriority priority)
+{
+	switch (priority)
+	{
+	case LaunchPriority::Idle:
+		return IDLE_PRIORITY_CLASS;
+	case LaunchPriority::BelowNormal:
+		return BELOW_NORMAL_PRIORITY_CLASS;
+	case LaunchPriority::AboveNormal:
+		return ABOVE_NORMAL_PRIORITY_CLASS;
+	case LaunchPriority::High:
+		return HIGH_PRIORITY_CLASS;
+	default:
+		return NORMAL_PRIORITY_CLASS;
+	}
+}
+
+/**
+ * Reads the efficiency class of the logical processors of group 0 from the system CPU sets.
+ *
+ * @return One class per logical processor, indexed by processor number; empty on failure.
+ */
+std::vector<uint8_t> WinApiHelpers::GetEfficiencyClasses()
+{
+	ULONG length = 0;
+	GetSystemCpuSetInformation(nullptr, 0, &length, GetCurrentProcess(), 0);
+	if (length == 0)
+	{
+		return {};
+	}
+	std::vector<BYTE> buffer(length);
+	if (!GetSystemCpuSetInformation(reinterpret_cast<PSYSTEM_CPU_SET_INFORMATION>(buffer.data()), length, &length, GetCurrentProcess(), 0))
+	{
+		return {};
+	}
+
+	std::vector<uint8_t> classes;
+	for (ULONG offset = 0; offset + sizeof(DWORD) <= length; )
+	{
+		const auto* info = reinterpret_cast<const SYSTEM_CPU_SET_INFORMATION*>(buffer.data() + offset);
+		if (info->Size == 0)
+		{
+			break;
+		}
+		if (info->Type == CpuSetInformation && info->CpuSet.Group == 0 && info->CpuSet.LogicalProcessorIndex < 64)
+		{
+			const size_t index = info->CpuSet.LogicalProcessorIndex;
+			if (classes.size() <= index)
+			{
+				classes.resize(index + 1);
+			}
+			classes[index] = info->CpuSet.EfficiencyClass;
+		}
+		offset += info->Size;
+	}
+	return classes;
+}
+
+/**
+ * Sets the priority class and, if the policy restricts it, the affinity of a process.
+ *
+ * The affinity is the explicit mask of the policy, or the cores its placement selects, limited to the
+ * processors the process may use.
+ *
+ * @param[in] process The process, opened with PROCESS_SET_INFORMATION and PROCESS_QUERY_INFORMATION.
+ * @param[in] policy The launch policy.
+ * @return false if a setting could not be applied.
+ */
+bool WinApiHelpers::ApplyLaunchPolicy(HANDLE process, const LaunchPolicy& policy)
+{
+	bool applied = SetPriorityClass(process, PriorityClassFlag(policy.priority)) != FALSE;
+
+	uint64_t mask = policy.affinityMask;
+	if (mask == 0 && policy.placement != CorePlacement::Any)
+	{
+		static const std::vector<uint8_t> classes = GetEfficiencyClasses();
+		mask = LaunchScheduler::PlacementMask(classes, policy.placement);
+	}
+	if (mask != 0)
+	{
+		DWORD_PTR processMask = 0;
+		DWORD_PTR systemMask = 0;
+		if (GetProcessAffinityMask(process, &processMask, &systemMask))
+		{
+			mask &= systemMask;
+		}
+		applied = mask != 0 && SetProcessAffinityMask(process, static_cast<DWORD_PTR>(mask)) && applied;
+	}
+	return applied;
+}
+
+/**
+ * Waits for a terminal to reach its message loop, i.e. for its window to be ready.
+ *
+ * @param[in] terminal The terminal process, opened with PROCESS_QUERY_INFORMATION.
+ * @param[in] timeoutMilliseconds The longest wait.
+ * @return true if the terminal waits for input.
+ */
+bool WinApiHelpers::WaitForTerminalWindow(HANDLE terminal, DWORD timeoutMilliseconds)
+{
+	return WaitForInputIdle(terminal, timeoutMilliseconds) == 0;
+}
+
+/**
+ * Activates the first visible, unowned top-level window of a process.
+ *
+ * The caller must be allowed to set the foreground window, as the app is while handling a click.
+ *
+ * @param[in] processId The process, e.g. a running WindowsTerminal.exe.
+ * @return true if a window was found and brought to the foreground.
+ */
+bool WinApiHelpers::FocusProcessWindow(DWORD processId)
+{
+	struct Search
+	{
+		DWORD processId;
+		HWND window;
+	} search{ processId, nullptr };
+
+	EnumWindows([](HWND window, LPARAM parameter) -> BOOL {
+		Search& search = *reinterpret_cast<Search*>(parameter);
+		DWORD owner = 0;
+		GetWindowThreadProcessId(window, &owner);
+		if (owner == search.processId && IsWindowVisible(window) && GetWindow(window, GW_OWNER) == nullptr)
+		{
+			search.window = window;
+			return FALSE;
+		}
+		return TRUE;
+	}, reinterpret_cast<LPARAM>(&search));
+
+	if (search.window == nullptr)
+	{
+		return false;
+	}
+	if (IsIconic(search.window))
+	{
+		ShowWindow(search.window, SW_RESTORE);
+	}
+	return SetForegroundWindow(search.window) != FALSE;
+}
+
+/**
+ * Creates a single-instance, local-only message pipe with a name unique to this process.
+ *
+ * The pipe keeps the default security, which lets administrators write to it, so the elevated
+ * launcher can connect. FILE_FLAG_FIRST_PIPE_INSTANCE makes creation fail if another process took
+ * the name first.
+ *
+ * @param[out] name The pipe name.
+ * @return The server end, or an empty HandlePtr.
+ */
+HandlePtr WinApiHelpers::CreateHandoffPipe(std::wstring& name)
+{
+	static std::atomic<uint32_t> sequence{ 0 };
+	name = L"\\\\.\\pipe\\WTLayoutManager.Handoff." + std::to_wstring(GetCurrentProcessId()) + L"." + std::to_wstring(++sequence);
+	HANDLE pipe = CreateNamedPipeW(name.c_str(),
+		PIPE_ACCESS_INBOUND | FILE_FLAG_FIRST_PIPE_INSTANCE,
+		PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+		1, 0, sizeof(HandoffReply), 0, nullptr);
+	if (pipe == INVALID_HANDLE_VALUE)
+	{
+		name.clear();
+		return HandlePtr();
+	}
+	return HandlePtr(pipe);
+}
+
+/**
+ * Duplicates a process handle into the server of a handoff pipe and writes its value to the pipe.
+ *
+ * The receiver is the process that owns the pipe, as reported by the system, not whatever the
+ * command line claims. If the value cannot be written, the duplicate is closed in the receiver again.
+ *
+ * @param[in] pipeName The pipe name.
+ * @param[in] process The process to hand over.
+ * @return true if the receiver owns a handle now.
+ */
+bool WinApiHelpers::SendHandoff(const wchar_t* pipeName, HANDLE process)
+{
+	HANDLE client = CreateFileW(pipeName, GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+	if (client == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	HandlePtr pipe(client);
+
+	ULONG serverId = 0;
+	if (!GetNamedPipeServerProcessId(pipe.get(), &serverId))
+	{
+		return false;
+	}
+	HandlePtr server(OpenProcess(PROCESS_DUP_HANDLE, FALSE, serverId));
+	if (!server)
+	{
+		return false;
+	}
+
+	HANDLE remote = nullptr;
+	if (!DuplicateHandle(GetCurrentProcess(), process, server.get(), &remote, SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION, FALSE, 0))
+	{
+		return false;
+	}
+
+	HandoffReply reply{ HandoffMagic, GetProcessId(process), static_cast<uint64_t>(reinterpret_cast<uintptr_t>(remote)) };
+	DWORD written = 0;
+	if (!WriteFile(pipe.get(), &reply, sizeof(reply), &written, nullptr) || written != sizeof(reply))
+	{
+		DWORD error = GetLastError();
+		DuplicateHandle(server.get(), remote, nullptr, nullptr, 0, FALSE, DUPLICATE_CLOSE_SOURCE);
+		SetLastError(error);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Reads the reply of a launcher that has exited.
+ *
+ * A message written before the sender closed its end stays readable; a pipe nobody connected to
+ * fails at once with ERROR_PIPE_LISTENING, so this never waits. The handle is only adopted if it
+ * refers to the process the reply names, so a stale or mismatched reply is never waited on.
+ *
+ * @param[in] pipe The server end.
+ * @param[out] processId The id of the handed over process.
+ * @return The handle, or an empty HandlePtr.
+ */
+HandlePtr WinApiHelpers::ReceiveHandoff(HANDLE pipe, DWORD& processId)
+{
+	HandoffReply reply{};
+	DWORD read = 0;
+	if (!ReadFile(pipe, &reply, sizeof(reply), &read, nullptr) || read != sizeof(reply))
+	{
+		return HandlePtr();
+	}
+	if (reply.magic != HandoffMagic || reply.processHandle == 0)
+	{
+		SetLastError(ERROR_INVALID_DATA);
+		return HandlePtr();
+	}
+	HANDLE process = reinterpret_cast<HANDLE>(static_cast<uintptr_t>(reply.processHandle));
+	const DWORD actualId = GetProcessId(process);
+	if (actualId != reply.processId || actualId == 0)
+	{
+		if (actualId != 0)
+		{
+			CloseHandle(process); // a process handle of ours, to another process
+		}
+		SetLastError(ERROR_INVALID_DATA);
+		return HandlePtr();
+	}
+	processId = reply.processId;
+	return HandlePtr(process);
+}
@@ -6,26 +6,23 @@
 #include <string>
 #include <vector>
 #include <memory>
-
-#ifdef WINAPIHELPERS_EXPORTS   // Define this in your pure C++ DLL project settings
-#define WINAPIHELPERS_API __declspec(dllexport)
-#else
-#define WINAPIHELPERS_API __declspec(dllimport)
-#endif
+#include "WinApiHelpersExport.h"
+#include "LaunchScheduler.h"
 
 namespace WTLayoutManager {
 	namespace Services {
 
 		struct HandleCloser {
 			/// <summary>
-			/// Closes the given HANDLE and sets it to INVALID_HANDLE_VALUE.
+			/// Closes the given HANDLE.
 			/// </summary>
 			/// <param name="h">The HANDLE to close.</param>
 			/// <remarks>
 			/// If the HANDLE is already invalid or is INVALID_HANDLE_VALUE, no action is taken.
-			/// This function ignores any exceptions thrown by CloseHandle().
+			/// This function ignores any exceptions thrown by CloseHandle(). It takes the HANDLE by
+			/// value, as unique_ptr passes it.
 			/// </remarks>
-			void operator()(HANDLE& h) const noexcept {
+			void operator()(HANDLE h) const noexcept {
 				if (h && h != INVALID_HANDLE_VALUE)
 				{
 					__try
@@ -34,7 +31,6 @@ namespace WTLayoutManager {
 					}
 					__except (EXCEPTION_EXECUTE_HANDLER) {} // ignore any exceptions thrown by CloseHandle()
 				}
-				h = INVALID_HANDLE_VALUE;
 			}
 		};
 
@@ -128,6 +124,63 @@ namespace WTLayoutManager {
 			WINAPIHELPERS_API static void Sleep(_In_ DWORD dwMilliseconds);
 
 			WINAPIHELPERS_API static HandlePtr GetWindowsTerminalHandle(DWORD wtPid);
+
+			/// <summary>
+			/// Returns the CreateProcess priority class flag of a launch priority.
+			/// </summary>
+			WINAPIHELPERS_API static DWORD PriorityClassFlag(LaunchPriority priority);
+
+			/// <summary>
+			/// Returns the efficiency class of each logical processor of the first processor group,
+			/// or an empty vector if the system does not report them.
+			/// </summary>
+			WINAPIHELPERS_API static std::vector<uint8_t> GetEfficiencyClasses();
+
+			/// <summary>
+			/// Applies the priority class and the processor affinity of a policy to a process.
+			/// </summary>
+			/// <param name="process">Needs PROCESS_SET_INFORMATION.</param>
+			/// <param name="policy">The policy; a zero affinity mask and Any placement leave the affinity alone.</param>
+			/// <returns>false if either setting failed, with the last error set.</returns>
+			/// <remarks>
+			/// Affinity set on a suspended launcher is inherited by the terminal it starts.
+			/// </remarks>
+			WINAPIHELPERS_API static bool ApplyLaunchPolicy(HANDLE process, const LaunchPolicy& policy);
+
+			/// <summary>
+			/// Waits until a terminal finished initializing and waits for input, or the timeout elapsed.
+			/// </summary>
+			/// <returns>true if the terminal is idle.</returns>
+			WINAPIHELPERS_API static bool WaitForTerminalWindow(HANDLE terminal, DWORD timeoutMilliseconds);
+
+			/// <summary>
+			/// Brings the main window of a process to the foreground, restoring it if minimized.
+			/// </summary>
+			/// <returns>false if the process has no visible top-level window or it could not be activated.</returns>
+			WINAPIHELPERS_API static bool FocusProcessWindow(DWORD processId);
+
+			/// <summary>
+			/// Creates the pipe an elevated launcher hands the process it started back through.
+			/// </summary>
+			/// <param name="name">Receives the name to pass to the launcher.</param>
+			/// <returns>The reading end, or an empty HandlePtr on error, with the last error set.</returns>
+			WINAPIHELPERS_API static HandlePtr CreateHandoffPipe(std::wstring& name);
+
+			/// <summary>
+			/// Gives the process listening on a handoff pipe a handle to a process, so it can wait for it.
+			/// </summary>
+			/// <param name="pipeName">The name created by CreateHandoffPipe.</param>
+			/// <param name="process">The process to hand over; the listener gets SYNCHRONIZE and query rights only.</param>
+			/// <returns>false on error, with the last error set; the listener then receives nothing.</returns>
+			WINAPIHELPERS_API static bool SendHandoff(const wchar_t* pipeName, HANDLE process);
+
+			/// <summary>
+			/// Takes the handle sent through a handoff pipe. Call it once the sender exited; it never blocks.
+			/// </summary>
+			/// <param name="pipe">The reading end created by CreateHandoffPipe.</param>
+			/// <param name="processId">Receives the id of the handed over process.</param>
+			/// <returns>The process handle, or an empty HandlePtr if nothing was sent or the handle is not of processId.</returns>
+			WINAPIHELPERS_API static HandlePtr ReceiveHandoff(HANDLE pipe, DWORD& processId);
 		};
 
 	}
@@ -0,0 +1,14 @@
+#pragma once
+
+// Export macro shared by every WinApiHelpers header.
+// Kept free of <windows.h> so the portable parts of the library can be
+// compiled and exercised on non-Windows toolchains as well.
+#if defined(_WIN32)
+#ifdef WINAPIHELPERS_EXPORTS   // Define this in your pure C++ DLL project settings
+#define WINAPIHELPERS_API __declspec(dllexport)
+#else
+#define WINAPIHELPERS_API __declspec(dllimport)
+#endif
+#else
+#define WINAPIHELPERS_API __attribute__((visibility("default")))
+#endif
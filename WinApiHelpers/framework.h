@@ -1,5 +1,7 @@
 #pragma once
 
 #define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers
-// Windows Header Files
+// Windows Header Files; the portable sources also build without them (see CMakeLists.txt)
+#if defined(_WIN32)
 #include <windows.h>
+#endif